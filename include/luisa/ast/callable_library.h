@@ -17,10 +17,13 @@ private:
     struct DeserPackage {
         detail::FunctionBuilder *builder;
         luisa::unordered_map<uint64_t, luisa::shared_ptr<detail::FunctionBuilder>> callable_map;
+        // turns references to the object id of a raster stage into an ordinary variable
+        bool object_id_as_argument{false};
     };
     using CallableMap = luisa::unordered_map<luisa::string, luisa::shared_ptr<const detail::FunctionBuilder>>;
     CallableMap _callables;
     static void serialize_func_builder(detail::FunctionBuilder const &builder, luisa::vector<std::byte> &vec) noexcept;
+    static void serialize_func_builder_content(detail::FunctionBuilder const &builder, luisa::vector<std::byte> &vec) noexcept;
     static void deserialize_func_builder(detail::FunctionBuilder &builder, std::byte const *&ptr, DeserPackage &pack) noexcept;
     template<typename T>
     static void ser_value(T const &t, luisa::vector<std::byte> &vec) noexcept;
@@ -37,6 +40,10 @@ public:
     void add_callable(luisa::string_view name, luisa::shared_ptr<const detail::FunctionBuilder> callable) noexcept;
     void load(luisa::span<const std::byte> binary) noexcept;
     [[nodiscard]] luisa::vector<std::byte> serialize() const noexcept;
+    // Copies a kernel into a callable taking the kernel's arguments (with the same bindings)
+    // followed by the builtin variables it uses, so that it can be called from other kernels.
+    // Raster stages are accepted as well, their object id becomes a trailing uint argument.
+    [[nodiscard]] static luisa::shared_ptr<const detail::FunctionBuilder> kernel_to_callable(Function kernel) noexcept;
     CallableLibrary(CallableLibrary const &) = delete;
     CallableLibrary(CallableLibrary &&) noexcept;
     ~CallableLibrary() noexcept;
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <luisa/runtime/rhi/device_interface.h>
+
+namespace luisa::compute {
+
+// Backend-side recordings of command lists that are submitted repeatedly. The
+// backend converts the commands once and replays its converted form on every
+// dispatch; the commands are only read while creating or updating a recording.
+class CommandGraphExt : public DeviceExtension {
+
+protected:
+    ~CommandGraphExt() noexcept = default;
+
+public:
+    static constexpr luisa::string_view name = "CommandGraphExt";
+    // converts the commands, which must not carry callbacks or custom commands
+    [[nodiscard]] virtual uint64_t create_command_graph(
+        luisa::span<const luisa::unique_ptr<Command>> commands) noexcept = 0;
+    // converts the patched shader dispatches at `dirty_indices` of the commands again;
+    // dispatches already in flight keep executing the previous form
+    virtual void update_command_graph(
+        uint64_t handle, luisa::span<const luisa::unique_ptr<Command>> commands,
+        luisa::span<const size_t> dirty_indices) noexcept = 0;
+    virtual void destroy_command_graph(uint64_t handle) noexcept = 0;
+    // replays the recording in order with the other commands of the stream
+    virtual void dispatch_command_graph(uint64_t stream_handle, uint64_t handle) noexcept = 0;
+};
+
+}// namespace luisa::compute
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <luisa/core/stl/string.h>
+#include <luisa/runtime/rhi/device_interface.h>
+#include <luisa/backends/ext/shared_swapchain.h>
+
+namespace luisa::compute {
+
+// Memory and threading options of the CPU backend, passed through DeviceConfig::extension.
+struct CpuDeviceConfigExt : public DeviceConfigExt {
+    enum struct HugePages : uint8_t {
+        NONE,
+        // 2 MiB aligned allocations advised to be backed by transparent huge pages
+        TRANSPARENT,
+        // allocations from the preallocated huge page pool (falls back to TRANSPARENT)
+        EXPLICIT,
+    };
+    // applies to allocations of at least 2 MiB
+    HugePages huge_pages{HugePages::NONE};
+    // touch the pages of new resources from the worker threads that will process them
+    bool first_touch{false};
+    // pin the worker threads to the CPUs of each NUMA node and schedule dispatches per node
+    bool numa_pinned_workers{false};
+    // record shader creation profiles for the "shader_profile*" queries (or LUISA_SHADER_PROFILE=1)
+    bool shader_profile{false};
+    // when not empty, swapchains publish their frames into rings of shared memory
+    // instead of windows, see SharedFrameRing; window handles are ignored
+    luisa::string shared_swapchain_name;
+    SharedFrameFormat shared_swapchain_format{SharedFrameFormat::BGRA8};
+};
+
+}// namespace luisa::compute
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <luisa/runtime/rhi/command.h>
+#include <luisa/runtime/mipmap.h>
+#include <luisa/backends/ext/registry.h>
+
+namespace luisa::compute {
+
+// Fills levels 1, 2, ... of a 2D texture by repeatedly downsampling level 0.
+class GenerateMipmapsCommand final : public CustomCommand {
+    friend lc::validation::Stream;
+
+private:
+    uint64_t _handle;
+    PixelStorage _storage;
+    uint2 _size;
+    uint _level_count;
+    MipmapFilter _filter;
+    bool _srgb;
+
+public:
+    GenerateMipmapsCommand(uint64_t handle, PixelStorage storage, uint2 size,
+                           uint level_count, MipmapFilter filter, bool srgb) noexcept
+        : _handle{handle}, _storage{storage}, _size{size},
+          _level_count{level_count}, _filter{filter}, _srgb{srgb} {}
+    [[nodiscard]] auto handle() const noexcept { return _handle; }
+    [[nodiscard]] auto storage() const noexcept { return _storage; }
+    [[nodiscard]] auto size() const noexcept { return _size; }
+    [[nodiscard]] auto level_count() const noexcept { return _level_count; }
+    [[nodiscard]] auto filter() const noexcept { return _filter; }
+    // the color channels are stored in sRGB and filtered in linear space
+    [[nodiscard]] auto srgb() const noexcept { return _srgb; }
+    [[nodiscard]] uint64_t uuid() const noexcept override { return to_underlying(CustomCommandUUID::MIPMAP_GENERATE); }
+    LUISA_MAKE_COMMAND_COMMON(StreamTag::COMPUTE)
+};
+
+}// namespace luisa::compute
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <luisa/runtime/rhi/device_interface.h>
+#include <luisa/runtime/mipmap.h>
+
+namespace luisa::compute {
+
+// Implemented by backends that run GenerateMipmapsCommand natively. Streams
+// replace the commands that the extension does not accept, or all of them
+// without the extension, by compute dispatches before submission.
+class MipmapExt : public DeviceExtension {
+
+protected:
+    ~MipmapExt() noexcept = default;
+
+public:
+    static constexpr luisa::string_view name = "MipmapExt";
+    [[nodiscard]] virtual bool is_mipmap_generation_supported(
+        PixelStorage storage, MipmapFilter filter, bool srgb) const noexcept = 0;
+};
+
+}// namespace luisa::compute
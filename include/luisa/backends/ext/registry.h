@@ -23,6 +23,9 @@ enum struct CustomCommandUUID : uint32_t {
     CUDA_CUSTOM_COMMAND_BEGIN = 0x0400u,
     CUDA_LCUB_COMMAND = CUDA_CUSTOM_COMMAND_BEGIN,
 
+    MIPMAP_EXT_BEGIN = 0x0500u,
+    MIPMAP_GENERATE = MIPMAP_EXT_BEGIN,
+
     REGISTERED_END = 0xffffu,
 };
 
@@ -38,6 +41,7 @@ namespace luisa {
         case compute::CustomCommandUUID::DSTORAGE_READ: return "DSTORAGE_READ";
         case compute::CustomCommandUUID::DENOISER_DENOISE: return "DENOISER_DENOISE";
         case compute::CustomCommandUUID::CUDA_LCUB_COMMAND: return "CUDA_LCUB_COMMAND";
+        case compute::CustomCommandUUID::MIPMAP_GENERATE: return "MIPMAP_GENERATE";
         default: break;
     }
     return "UNKNOWN";
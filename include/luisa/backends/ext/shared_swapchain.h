@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace luisa::compute {
+
+// Pixel formats of the frames published by shared-memory swapchains.
+enum struct SharedFrameFormat : uint32_t {
+    RGBA8,
+    BGRA8,
+    // half-precision floats, for consumers of HDR frames
+    RGBA16F,
+};
+
+struct alignas(64) SharedFrameSlot {
+    // number of the frame in the slot, starting from 1
+    std::atomic<uint64_t> frame;
+    // readers pinning the slot, plus the writing bit while the presenter fills it
+    std::atomic<uint32_t> readers;
+    // when the frame was presented, in nanoseconds of std::chrono::steady_clock
+    int64_t present_time;
+};
+
+// Layout of the shared memory into which the CPU backend publishes the frames of its
+// swapchains when CpuDeviceConfigExt::shared_swapchain_name is set. The ring of each
+// swapchain is named "<shared_swapchain_name>.<index>" (with a leading slash, for
+// shm_open, on POSIX systems), where index counts the swapchains of the device from 0.
+// The header is followed by slot_count frames of height rows of row_pitch bytes.
+//
+// One process presents and any number of processes read the frames in place: a reader
+// pins the latest frame with acquire() and unpins it with release(), and the presenter
+// never writes into a pinned slot or into the slot of the latest frame. The fields of
+// the header are valid once latest is non-zero.
+struct alignas(64) SharedFrameRing {
+
+    static constexpr uint32_t magic_number = 0x53464c4cu;
+    static constexpr uint32_t max_slots = 16u;
+    static constexpr uint32_t writing_bit = 0x80000000u;
+    static constexpr size_t frame_alignment = 4096u;
+    static constexpr uint32_t no_frame = ~0u;
+
+    uint32_t magic;
+    uint32_t width;
+    uint32_t height;
+    SharedFrameFormat format;
+    uint32_t row_pitch;
+    uint32_t slot_count;
+    // distance between the frames of adjacent slots in bytes
+    uint64_t frame_stride;
+    // (frame << 8u) | slot of the latest frame, 0 before the first one
+    alignas(64) std::atomic<uint64_t> latest;
+    // frames presented and frames dropped because all the slots were in use
+    std::atomic<uint64_t> presented;
+    std::atomic<uint64_t> dropped;
+    // set when the swapchain is destroyed; no frame follows
+    std::atomic<uint32_t> closed;
+    SharedFrameSlot slots[max_slots];
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free);
+
+    [[nodiscard]] static constexpr size_t frame_offset() noexcept {
+        return (sizeof(SharedFrameRing) + frame_alignment - 1u) / frame_alignment * frame_alignment;
+    }
+    [[nodiscard]] static constexpr size_t mapping_size(uint32_t slot_count, size_t frame_stride) noexcept {
+        return frame_offset() + slot_count * frame_stride;
+    }
+    [[nodiscard]] std::byte *frame_data(uint32_t slot) noexcept {
+        return reinterpret_cast<std::byte *>(this) + frame_offset() + slot * frame_stride;
+    }
+    [[nodiscard]] const std::byte *frame_data(uint32_t slot) const noexcept {
+        return reinterpret_cast<const std::byte *>(this) + frame_offset() + slot * frame_stride;
+    }
+
+    // pins the slot of the latest frame and returns it, or no_frame before the first one
+    [[nodiscard]] uint32_t acquire() noexcept {
+        for (;;) {
+            auto l = latest.load(std::memory_order_acquire);
+            if (l == 0u) { return no_frame; }
+            auto slot = static_cast<uint32_t>(l & 0xffu);
+            auto &s = slots[slot];
+            // the presenter may have taken the slot for a newer frame since we read latest
+            if ((s.readers.fetch_add(1u, std::memory_order_acquire) & writing_bit) == 0u &&
+                s.frame.load(std::memory_order_relaxed) == l >> 8u) {
+                return slot;
+            }
+            s.readers.fetch_sub(1u, std::memory_order_release);
+        }
+    }
+    void release(uint32_t slot) noexcept {
+        slots[slot].readers.fetch_sub(1u, std::memory_order_release);
+    }
+};
+
+}// namespace luisa::compute
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstring>
+#include <new>
+#include <tuple>
+
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/base_sink.h>
 
@@ -14,25 +18,204 @@ namespace luisa {
 using spdlog::logger;
 using log_level = spdlog::level::level_enum;
 
+/// What to do with a message when the asynchronous log queue is full
+enum struct LogOverflowPolicy : uint8_t {
+    /// drop the message
+    DROP,
+    /// wait for the background thread to make room
+    BLOCK,
+    /// drop verbose and info messages, wait for warnings
+    DROP_BELOW_WARNING,
+};
+
 namespace detail {
 [[nodiscard]] LC_CORE_API luisa::logger &default_logger() noexcept;
 LC_CORE_API void set_sink(spdlog::sink_ptr sink) noexcept;
 LC_CORE_API spdlog::sink_ptr create_sink_with_callback(void (*callback)(LCLoggerMessage)) noexcept;
+
+// Asynchronous logging: messages are copied into fixed-size slots of a
+// lock-free ring and written to the sinks by a background thread. Messages
+// with compile-time format strings (FMT_STRING, as used by the LUISA_* macros)
+// and arguments of simple types (arithmetic, enums, vectors, matrices and
+// strings, which are copied) are formatted on the background thread; other
+// messages are formatted on the calling thread.
+static constexpr auto async_log_payload_size = 192u;
+struct alignas(16) AsyncLogPayload {
+    std::byte data[async_log_payload_size];
+};
+// formats the payload into `out`; payloads without formatter hold the message text
+using AsyncLogFormatter = void (*)(const std::byte *payload, fmt::memory_buffer &out);
+
+[[nodiscard]] LC_CORE_API bool async_logging_enabled() noexcept;
+// copies `size` bytes of `payload` into the queue, returns false if the message is dropped
+LC_CORE_API bool async_log_push(log_level level, AsyncLogFormatter formatter,
+                                const std::byte *payload, size_t size) noexcept;
+
+// reference to a string copied after the stored arguments
+struct AsyncLogString {
+    uint32_t offset;
+    uint32_t size;
+};
+
+template<typename T>
+[[nodiscard]] constexpr bool is_async_log_string() noexcept {
+    using U = std::remove_cvref_t<T>;
+    return std::is_convertible_v<const U &, luisa::string_view> &&
+           !std::is_same_v<U, std::nullptr_t>;
+}
+
+template<typename T>
+using async_log_stored_t = std::conditional_t<
+    is_async_log_string<T>(), AsyncLogString, std::remove_cvref_t<T>>;
+
+template<typename T>
+[[nodiscard]] constexpr bool is_async_log_deferrable() noexcept {
+    using U = std::remove_cvref_t<T>;
+    return is_async_log_string<T>() ||
+           std::is_arithmetic_v<U> || std::is_enum_v<U> ||
+           is_vector_v<U> || is_matrix_v<U>;
+}
+
+// compile-time formats have static storage, so only they may be referenced
+// after the call returns
+template<typename F>
+[[nodiscard]] constexpr bool is_compile_time_format() noexcept {
+    return std::is_base_of_v<fmt::detail::compile_string, std::remove_cvref_t<F>>;
+}
+
+// Both the synchronous and the asynchronous paths log a single string that is
+// not a compile-time format as is, like spdlog does, and format everything else,
+// so "{{" and "}}" in formats are unescaped even without arguments.
+template<typename F, typename... Args>
+[[nodiscard]] constexpr bool is_plain_log_message() noexcept {
+    return !is_compile_time_format<F>() && sizeof...(Args) == 0u &&
+           std::is_constructible_v<fmt::string_view, const F &>;
+}
+
+template<typename F, typename... Args>
+inline void format_log_message(fmt::memory_buffer &out, const F &f, const Args &...args) noexcept {
+    if constexpr (is_compile_time_format<F>() || sizeof...(Args) != 0u) {
+        // compile-time formats have been checked already
+        fmt::format_to(std::back_inserter(out), fmt::runtime(fmt::string_view{f}), args...);
+    } else {
+        fmt::format_to(std::back_inserter(out), "{}", f);
+    }
+}
+
+template<typename... Stored>
+struct AsyncLogArguments {
+    fmt::string_view format;
+    std::tuple<Stored...> args;
+};
+
+template<typename T>
+[[nodiscard]] inline size_t async_log_string_size(const T &arg) noexcept {
+    if constexpr (is_async_log_string<T>()) {
+        return luisa::string_view{arg}.size();
+    } else {
+        return 0u;
+    }
+}
+
+template<typename T>
+[[nodiscard]] inline auto async_log_store(const T &arg, std::byte *chars, size_t &offset) noexcept {
+    if constexpr (is_async_log_string<T>()) {
+        luisa::string_view s{arg};
+        std::memcpy(chars + offset, s.data(), s.size());
+        AsyncLogString stored{static_cast<uint32_t>(offset), static_cast<uint32_t>(s.size())};
+        offset += s.size();
+        return stored;
+    } else {
+        return arg;
+    }
+}
+
+template<typename T>
+[[nodiscard]] inline decltype(auto) async_log_load(const T &stored, const char *chars) noexcept {
+    if constexpr (std::is_same_v<T, AsyncLogString>) {
+        return luisa::string_view{chars + stored.offset, stored.size};
+    } else {
+        return (stored);
+    }
+}
+
+template<typename... Stored>
+void async_log_format(const std::byte *payload, fmt::memory_buffer &out) {
+    using Arguments = AsyncLogArguments<Stored...>;
+    auto &&arguments = *std::launder(reinterpret_cast<const Arguments *>(payload));
+    auto chars = reinterpret_cast<const char *>(payload + sizeof(Arguments));
+    std::apply([&](const auto &...args) noexcept {
+        fmt::format_to(std::back_inserter(out), fmt::runtime(arguments.format),
+                       async_log_load(args, chars)...);
+    },
+               arguments.args);
+}
+
+template<typename F, typename... Args>
+inline void async_log(log_level level, const F &f, const Args &...args) noexcept {
+    using Arguments = AsyncLogArguments<async_log_stored_t<Args>...>;
+    if constexpr (is_plain_log_message<F, Args...>()) {
+        fmt::string_view message{f};
+        async_log_push(level, nullptr, reinterpret_cast<const std::byte *>(message.data()), message.size());
+        return;
+    } else if constexpr (is_compile_time_format<F>() &&
+                         (is_async_log_deferrable<Args>() && ...) &&
+                         (std::is_trivially_copyable_v<async_log_stored_t<Args>> && ...) &&
+                         alignof(Arguments) <= alignof(AsyncLogPayload) &&
+                         sizeof(Arguments) <= async_log_payload_size) {
+        // the copied strings must fit after the arguments, otherwise format eagerly
+        auto string_size = (static_cast<size_t>(0u) + ... + async_log_string_size(args));
+        if (sizeof(Arguments) + string_size <= async_log_payload_size) {
+            AsyncLogPayload payload;
+            auto chars = payload.data + sizeof(Arguments);
+            auto offset = static_cast<size_t>(0u);
+            new (payload.data) Arguments{fmt::string_view{f}, {async_log_store(args, chars, offset)...}};
+            async_log_push(level, &async_log_format<async_log_stored_t<Args>...>,
+                           payload.data, sizeof(Arguments) + offset);
+            return;
+        }
+    }
+    // everything else is formatted into a copy on the calling thread
+    fmt::memory_buffer message;
+    format_log_message(message, f, args...);
+    async_log_push(level, nullptr,
+                   reinterpret_cast<const std::byte *>(message.data()),
+                   message.size());
+}
+
+template<typename F, typename... Args>
+inline void log_message(log_level level, const F &f, const Args &...args) noexcept {
+    auto &logger = default_logger();
+    if (!logger.should_log(level)) { return; }
+    if (async_logging_enabled()) {
+        async_log(level, f, args...);
+    } else if constexpr (is_plain_log_message<F, Args...>()) {
+        logger.log(level, fmt::string_view{f});
+    } else {
+        fmt::memory_buffer message;
+        format_log_message(message, f, args...);
+        logger.log(level, fmt::string_view{message.data(), message.size()});
+    }
+}
+
 }// namespace detail
 
+/// Flush the logs (defined below)
+LC_CORE_API void log_flush() noexcept;
+
 template<typename... Args>
 inline void log_verbose(Args &&...args) noexcept {
-    detail::default_logger().debug(std::forward<Args>(args)...);
+    detail::log_message(spdlog::level::debug, std::forward<Args>(args)...);
 }
 
 template<typename... Args>
 inline void log_info(Args &&...args) noexcept {
-    detail::default_logger().info(std::forward<Args>(args)...);
+    detail::log_message(spdlog::level::info, std::forward<Args>(args)...);
 }
 
 template<typename... Args>
 inline void log_warning(Args &&...args) noexcept {
-    detail::default_logger().warn(std::forward<Args>(args)...);
+    detail::log_message(spdlog::level::warn, std::forward<Args>(args)...);
 }
 
 template<typename... Args>
@@ -46,6 +229,8 @@ template<typename... Args>
             FMT_STRING("\n    {:>2} [0x{:012x}]: {} :: {} + {}"sv),
             i, t.address, t.module, t.symbol, t.offset));
     }
+    // errors are written synchronously, after all queued messages
+    log_flush();
     detail::default_logger().error("{}", error_message);
     std::abort();
 }
@@ -62,6 +247,20 @@ LC_CORE_API void log_level_error() noexcept;
 /// flush the logs
 LC_CORE_API void log_flush() noexcept;
 
+/**
+ * @brief Write logs from a background thread
+ *
+ * Messages are queued in a lock-free ring of `capacity` slots and formatted
+ * and written by a background thread. Errors are still written synchronously
+ * after the queued messages. Enabling again changes the capacity and policy.
+ */
+LC_CORE_API void log_async_enable(size_t capacity = 8192u,
+                                  LogOverflowPolicy policy = LogOverflowPolicy::DROP_BELOW_WARNING) noexcept;
+/// Flush the queued messages and go back to synchronous logging
+LC_CORE_API void log_async_disable() noexcept;
+/// Number of messages dropped since asynchronous logging was enabled
+[[nodiscard]] LC_CORE_API size_t log_async_dropped_count() noexcept;
+
 }// namespace luisa
 
 /**
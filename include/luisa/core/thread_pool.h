@@ -1,6 +1,8 @@
 #pragma once
 
 #include <future>
+#include <mutex>
+#include <condition_variable>
 
 #include <luisa/core/stl/functional.h>
 #include <luisa/core/stl/memory.h>
@@ -101,5 +103,26 @@ public:
     }
 };
 
+/// Run f(0), ..., f(n - 1) on the pool and wait for them, without waiting for other tasks of the pool
+template<typename F>
+void parallel_for(ThreadPool &pool, size_t n, F &&f) noexcept {
+    if (n == 0u) { return; }
+    if (n == 1u) {
+        f(0u);
+        return;
+    }
+    std::mutex mutex;
+    std::condition_variable cv;
+    auto remaining = n;
+    pool.parallel(static_cast<uint>(n), [&](uint i) noexcept {
+        f(i);
+        // notify under the lock, so that the waiter cannot return before we are done
+        std::scoped_lock lock{mutex};
+        if (--remaining == 0u) { cv.notify_one(); }
+    });
+    std::unique_lock lock{mutex};
+    cv.wait(lock, [&] { return remaining == 0u; });
+}
+
 }// namespace luisa
 
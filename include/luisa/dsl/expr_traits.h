@@ -304,6 +304,12 @@ class SOAView;
 template<typename T>
 class SOA;
 
+template<typename T, uint W>
+class AOSOAView;
+
+template<typename T, uint W>
+class AOSOA;
+
 namespace detail {
 
 template<typename T>
@@ -315,6 +321,12 @@ struct is_soa_expr_impl<SOAView<T>> : std::true_type {};
 template<typename T>
 struct is_soa_expr_impl<SOA<T>> : std::true_type {};
 
+template<typename T, uint W>
+struct is_soa_expr_impl<AOSOAView<T, W>> : std::true_type {};
+
+template<typename T, uint W>
+struct is_soa_expr_impl<AOSOA<T, W>> : std::true_type {};
+
 }// namespace detail
 
 template<typename T>
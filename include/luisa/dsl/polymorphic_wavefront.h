@@ -0,0 +1,134 @@
+#pragma once
+
+#include <luisa/runtime/buffer.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/shader.h>
+#include <luisa/runtime/command_list.h>
+#include <luisa/runtime/dispatch_buffer.h>
+#include <luisa/dsl/func.h>
+#include <luisa/dsl/polymorphic.h>
+
+namespace luisa::compute {
+
+/**
+ * @brief Buckets work items into one queue per polymorphic tag.
+ *
+ * Binning is a counting sort of the items by their tags: per-block histograms are
+ * accumulated into per-tag counts, an exclusive scan turns the counts into queue
+ * offsets, and each item index is scattered into the queue of its tag. The order
+ * of the items within a queue is unspecified. With indirect dispatch enabled, the
+ * scan also writes one dispatch per tag, covering the items of its queue with
+ * blocks of dispatch_block_size threads, into an indirect dispatch buffer.
+ */
+class LC_DSL_API PolymorphicQueue {
+
+public:
+    /// block size of the binning kernels
+    static constexpr auto block_size = 256u;
+    /// block size of the indirect dispatches
+    static constexpr auto dispatch_block_size = 64u;
+
+private:
+    uint _tag_count{0u};
+    uint _capacity{0u};
+    Buffer<uint> _bins; // counts, offsets and cursors of the queues
+    Buffer<uint> _items;// item indices, grouped by tag
+    IndirectDispatchBuffer _dispatch_buffer;
+    Shader1D<> _clear;
+    Shader1D<Buffer<uint>, uint> _count;
+    Shader1D<> _scan;
+    Shader1D<Buffer<uint>, uint> _scatter;
+
+public:
+    PolymorphicQueue(Device &device, uint tag_count, uint capacity, bool indirect = false) noexcept;
+    [[nodiscard]] auto tag_count() const noexcept { return _tag_count; }
+    [[nodiscard]] auto capacity() const noexcept { return _capacity; }
+    [[nodiscard]] auto is_indirect() const noexcept { return static_cast<bool>(_dispatch_buffer); }
+    /// Number of items in each queue
+    [[nodiscard]] auto counts() const noexcept { return _bins.view(0u, _tag_count); }
+    /// Offset of each queue in items()
+    [[nodiscard]] auto offsets() const noexcept { return _bins.view(_tag_count, _tag_count); }
+    /// Item indices of all queues, in the order of the tags
+    [[nodiscard]] auto items() const noexcept { return _items.view(); }
+    /// Per-tag dispatches of the items, only if indirect dispatch is enabled
+    [[nodiscard]] const IndirectDispatchBuffer &dispatch_buffer() const noexcept;
+    /// Bin the items in [0, n) by their tags, which must be less than tag_count()
+    void bin(CommandList &list, BufferView<uint> tags, uint n) const noexcept;
+};
+
+/**
+ * @brief Wavefront alternative to Polymorphic<T>::dispatch.
+ *
+ * Polymorphic<T>::dispatch switches over all implementations on every thread, so
+ * divergent tags execute the implementations serially within a warp on GPUs, and
+ * defeat branch prediction on CPUs. Instead, the wavefront bins the items by tag
+ * with a PolymorphicQueue and then runs one kernel per implementation over the
+ * items of its queue. The function is called with the implementation and the index
+ * of the item, and should access the state of the item through captured resources.
+ *
+ * Without indirect dispatch, each kernel is launched with min(n, max_threads)
+ * threads that stride over its queue, so an empty queue costs a launch only. With
+ * indirect dispatch, which not all backends support, each kernel is launched with
+ * one thread per item of its queue.
+ *
+ * Example:
+ * @code
+ * PolymorphicWavefront<Material> wavefront{
+ *     device, materials, pixel_count,
+ *     [&](const Material *material, Expr<uint> pixel) noexcept {
+ *         material->shade(state_buffer, pixel);
+ *     }};
+ * CommandList list;
+ * wavefront.dispatch(list, tag_buffer, pixel_count);
+ * stream << list.commit();
+ * @endcode
+ */
+template<typename T>
+class PolymorphicWavefront {
+
+public:
+    static constexpr auto default_max_threads = 65536u;
+    using Function = luisa::function<void(const T *, Expr<uint>)>;
+
+private:
+    PolymorphicQueue _queue;
+    luisa::vector<Shader1D<>> _shaders;
+    uint _max_threads;
+
+public:
+    PolymorphicWavefront(Device &device, const Polymorphic<T> &polymorphic, uint capacity,
+                         const Function &f, bool indirect = false,
+                         uint max_threads = default_max_threads) noexcept
+        : _queue{device, static_cast<uint>(polymorphic.size()), capacity, indirect},
+          _max_threads{std::max(max_threads, 1u)} {
+        _shaders.reserve(polymorphic.size());
+        for (auto tag = 0u; tag < polymorphic.size(); tag++) {
+            auto impl = polymorphic.impl(tag);
+            _shaders.emplace_back(device.compile<1>([&f, this, impl, tag] {
+                set_block_size(PolymorphicQueue::dispatch_block_size, 1u, 1u);
+                auto count = _queue.counts()->read(tag);
+                auto offset = _queue.offsets()->read(tag);
+                dsl::loop(dispatch_x(), count, dispatch_size_x(), [&](auto i) noexcept {
+                    f(impl, _queue.items()->read(offset + i));
+                });
+            }));
+        }
+    }
+
+    [[nodiscard]] auto &queue() const noexcept { return _queue; }
+
+    /// Run the implementations on the items in [0, n), tagged by tags
+    void dispatch(CommandList &list, BufferView<uint> tags, uint n) const noexcept {
+        if (n == 0u) { return; }
+        _queue.bin(list, tags, n);
+        for (auto tag = 0u; tag < _shaders.size(); tag++) {
+            if (_queue.is_indirect()) {
+                list << _shaders[tag]().dispatch(_queue.dispatch_buffer(), tag, 1u);
+            } else {
+                list << _shaders[tag]().dispatch(std::min(n, _max_threads));
+            }
+        }
+    }
+};
+
+}// namespace luisa::compute
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <bit>
+
 #include <luisa/dsl/var.h>
 #include <luisa/dsl/atomic.h>
 #include <luisa/dsl/builtin.h>
@@ -14,6 +16,12 @@ class SOAView;
 template<typename T>
 class SOA;
 
+template<typename T, uint W>
+class AOSOAView;
+
+template<typename T, uint W>
+class AOSOA;
+
 constexpr auto soa_cache_line_size = 32u;
 
 template<typename T>
@@ -21,6 +29,17 @@ template<typename T>
     return (size + (soa_cache_line_size - 1u)) / soa_cache_line_size * soa_cache_line_size;
 }
 
+// fields shorter than a cache line are packed instead of padded, so
+// that the tiles of AOSOA<T, W> stay dense for small tile widths
+template<typename T>
+[[nodiscard]] inline auto compute_soa_field_size(T size) noexcept {
+    if constexpr (is_dsl_v<T>) {
+        return dsl::ite(size < soa_cache_line_size, size, align_to_soa_cache_line(size));
+    } else {
+        return size < soa_cache_line_size ? size : align_to_soa_cache_line(size);
+    }
+}
+
 namespace detail {
 
 struct SOAExprBase {
@@ -539,7 +558,7 @@ public:
 
 public:
     [[nodiscard]] static auto compute_soa_size(auto n) noexcept {
-        return align_to_soa_cache_line(n * element_stride);
+        return compute_soa_field_size(n * element_stride);
     }
 
 public:
@@ -762,4 +781,219 @@ SOAView(const SOA<T> &) -> SOAView<T>;
 template<typename T>
 using SOAVar = Var<SOA<T>>;
 
+// AOSOA<T, W> splits the elements into tiles of W elements. Each tile is laid out
+// as an SOA<T> of size W, so accessing a whole element touches a few consecutive
+// cache lines instead of one line per field spread across the buffer.
+
+template<typename T, uint W>
+struct Expr<AOSOA<T, W>> {
+
+    static_assert(W != 0u && (W & (W - 1u)) == 0u,
+                  "The tile width of AOSOA must be a power of two.");
+
+private:
+    static constexpr auto tile_shift = static_cast<uint>(std::countr_zero(W));
+    Expr<Buffer<uint>> _buffer;
+    Expr<uint> _element_offset;
+
+public:
+    Expr(Expr<Buffer<uint>> buffer, Expr<uint> elem_offset) noexcept
+        : _buffer{buffer}, _element_offset{elem_offset} {}
+
+    Expr(AOSOAView<T, W> aosoa) noexcept
+        : Expr{aosoa.buffer(), aosoa.element_offset()} {}
+
+    Expr(const AOSOA<T, W> &aosoa) noexcept
+        : Expr{aosoa.view()} {}
+
+    [[nodiscard]] auto buffer() const noexcept { return _buffer; }
+    [[nodiscard]] auto element_offset() const noexcept { return _element_offset; }
+
+    /// SOA of the tile holding the element, e.g., tile(i).field.read(lane(i))
+    template<typename I>
+    [[nodiscard]] auto tile(I &&index) const noexcept {
+        auto i = dsl::def(std::forward<I>(index)) + element_offset();
+        auto tile_size = static_cast<uint>(AOSOAView<T, W>::tile_size());
+        return Expr<SOA<T>>{buffer(), (i >> tile_shift) * tile_size, W, 0u};
+    }
+
+    /// Index of the element in its tile
+    template<typename I>
+    [[nodiscard]] auto lane(I &&index) const noexcept {
+        return (dsl::def(std::forward<I>(index)) + element_offset()) & (W - 1u);
+    }
+
+    template<typename I>
+    [[nodiscard]] auto read(I &&index) const noexcept {
+        auto i = dsl::def(std::forward<I>(index));
+        return tile(i).read(lane(i));
+    }
+
+    template<typename I>
+    void write(I &&index, Expr<T> value) const noexcept {
+        auto i = dsl::def(std::forward<I>(index));
+        tile(i).write(lane(i), value);
+    }
+
+    [[nodiscard]] auto operator->() const noexcept { return this; }
+};
+
+template<typename T, uint W>
+struct Expr<AOSOAView<T, W>> : public Expr<AOSOA<T, W>> {
+    using Expr<AOSOA<T, W>>::Expr;
+};
+
+template<typename T, uint W>
+Expr(AOSOAView<T, W>) -> Expr<AOSOAView<T, W>>;
+
+template<typename T, uint W>
+Expr(const AOSOA<T, W> &) -> Expr<AOSOA<T, W>>;
+
+namespace detail {
+
+template<typename T, uint W>
+void callable_encode_soa(CallableInvoke &invoke, Expr<AOSOA<T, W>> aosoa) {
+    invoke << aosoa.buffer()
+           << aosoa.element_offset();
+}
+
+template<typename T, uint W>
+void callable_encode_soa(CallableInvoke &invoke, Expr<AOSOAView<T, W>> aosoa) {
+    invoke << aosoa.buffer()
+           << aosoa.element_offset();
+}
+
+}// namespace detail
+
+template<typename T, uint W>
+struct Var<AOSOA<T, W>> : public Expr<AOSOA<T, W>> {
+
+private:
+    // make the call sequential
+    Var(Expr<Buffer<uint>> buffer) noexcept
+        : Expr<AOSOA<T, W>>{buffer, Var<uint>{detail::ArgumentCreation{}}} {}
+
+public:
+    Var(detail::ArgumentCreation) noexcept
+        : Var{Var<Buffer<uint>>{detail::ArgumentCreation{}}} {}
+};
+
+template<typename T, uint W>
+struct Var<AOSOAView<T, W>> : public Var<AOSOA<T, W>> {
+    using Var<AOSOA<T, W>>::Var;
+};
+
+namespace detail {
+
+template<typename T, uint W>
+struct shader_argument_encode_count<AOSOA<T, W>> {
+    static constexpr uint value = 2u;
+};
+
+template<typename T, uint W>
+struct shader_argument_encode_count<AOSOAView<T, W>>
+    : public shader_argument_encode_count<AOSOA<T, W>> {};
+
+template<typename T, uint W>
+ShaderInvokeBase &ShaderInvokeBase::operator<<(AOSOAView<T, W> aosoa) noexcept {
+    return *this << aosoa.buffer()
+                 << aosoa.element_offset();
+}
+
+template<typename T, uint W>
+ShaderInvokeBase &ShaderInvokeBase::operator<<(const AOSOA<T, W> &aosoa) noexcept {
+    return *this << aosoa.view();
+}
+
+LC_DSL_API void error_aosoa_host_data_too_small(size_t size, size_t expected) noexcept;
+LC_DSL_API void aosoa_encode(const Type *type, uint tile_width, size_t tile_size,
+                             const void *aos, size_t n, uint *aosoa) noexcept;
+LC_DSL_API void aosoa_decode(const Type *type, uint tile_width, size_t tile_size,
+                             const uint *aosoa, size_t n, void *aos) noexcept;
+
+}// namespace detail
+
+template<typename T, uint W>
+class AOSOAView {
+
+public:
+    static constexpr auto tile_width = W;
+
+private:
+    BufferView<uint> _buffer;
+    uint _elem_offset{};
+    uint _elem_size{};
+
+public:
+    /// Number of uints in a tile
+    [[nodiscard]] static auto tile_size() noexcept {
+        return static_cast<size_t>(SOAView<T>::compute_soa_size(W));
+    }
+    /// Number of uints that hold n elements
+    [[nodiscard]] static auto compute_aosoa_size(size_t n) noexcept {
+        return (n + W - 1u) / W * tile_size();
+    }
+
+    /// Convert elements to the AOSOA layout, starting from the first tile
+    static void encode(luisa::span<const T> aos, luisa::span<uint> aosoa) noexcept {
+        if (aosoa.size() < compute_aosoa_size(aos.size())) [[unlikely]] {
+            detail::error_aosoa_host_data_too_small(aosoa.size(), compute_aosoa_size(aos.size()));
+        }
+        detail::aosoa_encode(Type::of<T>(), W, tile_size(), aos.data(), aos.size(), aosoa.data());
+    }
+    /// Convert elements from the AOSOA layout, starting from the first tile
+    static void decode(luisa::span<const uint> aosoa, luisa::span<T> aos) noexcept {
+        if (aosoa.size() < compute_aosoa_size(aos.size())) [[unlikely]] {
+            detail::error_aosoa_host_data_too_small(aosoa.size(), compute_aosoa_size(aos.size()));
+        }
+        detail::aosoa_decode(Type::of<T>(), W, tile_size(), aosoa.data(), aos.size(), aos.data());
+    }
+
+public:
+    AOSOAView() noexcept = default;
+    AOSOAView(BufferView<uint> buffer, size_t elem_offset, size_t elem_size) noexcept
+        : _buffer{buffer},
+          _elem_offset{static_cast<uint>(elem_offset)},
+          _elem_size{static_cast<uint>(elem_size)} {
+        auto buffer_end = this->buffer().offset() + compute_aosoa_size(elem_offset + elem_size);
+        if (!(buffer_end <= std::numeric_limits<uint>::max())) [[unlikely]] {
+            detail::error_soa_view_exceeds_uint_max();
+        }
+    }
+    [[nodiscard]] auto buffer() const noexcept { return _buffer; }
+    [[nodiscard]] auto element_offset() const noexcept { return _elem_offset; }
+    [[nodiscard]] auto element_size() const noexcept { return _elem_size; }
+    [[nodiscard]] auto operator->() const noexcept { return Expr<AOSOAView<T, W>>{*this}; }
+    [[nodiscard]] auto subview(size_t offset, size_t size) const noexcept {
+        if (!(offset + size <= this->element_size())) [[unlikely]] {
+            detail::error_soa_subview_out_of_range();
+        }
+        return AOSOAView{this->buffer(), this->element_offset() + offset, size};
+    }
+};
+
+template<typename T, uint W>
+class AOSOA : public AOSOAView<T, W> {
+
+private:
+    Buffer<uint> _buffer;
+
+private:
+    AOSOA(Buffer<uint> buffer, size_t size) noexcept
+        : AOSOAView<T, W>{buffer.view(), 0u, size},
+          _buffer{std::move(buffer)} {}
+
+public:
+    AOSOA() noexcept = default;
+    AOSOA(Device &device, size_t elem_count) noexcept
+        : AOSOA{device.create_buffer<uint>(AOSOAView<T, W>::compute_aosoa_size(elem_count)), elem_count} {}
+    [[nodiscard]] auto view() const noexcept { return AOSOAView<T, W>{*this}; }
+};
+
+template<typename T, uint W>
+AOSOAView(const AOSOA<T, W> &) -> AOSOAView<T, W>;
+
+template<typename T, uint W>
+using AOSOAVar = Var<AOSOA<T, W>>;
+
 }// namespace luisa::compute
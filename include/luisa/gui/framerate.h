@@ -13,6 +13,15 @@ public:
     using Clock = std::chrono::steady_clock;
     using Timepoint = Clock::time_point;
 
+    // durations of the recorded frames in seconds
+    struct Pacing {
+        double mean;
+        double min;
+        double max;
+        // standard deviation
+        double jitter;
+    };
+
 private:
     luisa::vector<double> _durations;
     luisa::vector<size_t> _frames;
@@ -23,8 +32,13 @@ public:
     explicit Framerate(size_t n = 5) noexcept;
     void clear() noexcept;
     void record(size_t frame_count = 1u) noexcept;
+    // records the frames since the last record as completed at time, e.g. when they
+    // were presented as reported by a SharedFrameRing; with no frames, only restarts
+    // the interval of the next record at time
+    void record(Timepoint time, size_t frame_count = 1u) noexcept;
     [[nodiscard]] double duration() const noexcept;
     [[nodiscard]] double report() const noexcept;
+    [[nodiscard]] Pacing pacing() const noexcept;
 };
 
 }
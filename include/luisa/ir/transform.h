@@ -1,12 +1,51 @@
 #pragma once
 
+#include <mutex>
+
 #include <luisa/core/dll_export.h>
 #include <luisa/core/stl/memory.h>
 #include <luisa/core/stl/string.h>
 #include <luisa/rust/ir.hpp>
 
 namespace luisa::compute {
+
+// A pipeline of IR transforms. Callables, including the ones called by the
+// kernels, are looked up in the cache of the pipeline by content hash, so that
+// the ones shared by many kernels are only transformed once; devices should
+// keep one pipeline for all their shaders. The modules passed in are replaced
+// by transformed copies. Transforms are serialized by the pipeline.
+class LC_IR_API IRTransformPipeline {
+
+public:
+    struct CacheStatistics {
+        size_t hits;
+        size_t misses;
+    };
+
+private:
+    ir::TransformPipeline *_pipeline{nullptr};
+    std::mutex _mutex;
+
+public:
+    explicit IRTransformPipeline(luisa::span<const luisa::string> transforms) noexcept;
+    ~IRTransformPipeline() noexcept;
+    IRTransformPipeline(IRTransformPipeline &&) noexcept = delete;
+    IRTransformPipeline(const IRTransformPipeline &) noexcept = delete;
+    IRTransformPipeline &operator=(IRTransformPipeline &&) noexcept = delete;
+    IRTransformPipeline &operator=(const IRTransformPipeline &) noexcept = delete;
+    // autodiff and forward autodiff, for kernels that use them
+    [[nodiscard]] static luisa::unique_ptr<IRTransformPipeline> create_auto() noexcept;
+    void transform(ir::CallableModule *m) noexcept;
+    void transform(ir::KernelModule *m) noexcept;
+    void clear_cache() noexcept;
+    [[nodiscard]] CacheStatistics cache_statistics() noexcept;
+};
+
+// one-shot transforms with a pipeline of their own, nothing is cached across calls
 LC_IR_API void transform_ir_callable_module(ir::CallableModule *m, luisa::span<const luisa::string> transforms) noexcept;
 LC_IR_API void transform_ir_kernel_module(ir::KernelModule *m, luisa::span<const luisa::string> transforms) noexcept;
 LC_IR_API void transform_ir_kernel_module_auto(ir::KernelModule *m) noexcept;
+// per-pass timings and callable cache hit rates accumulated over all pipelines
+[[nodiscard]] LC_IR_API luisa::string transform_ir_statistics() noexcept;
+LC_IR_API void transform_ir_statistics_reset() noexcept;
 }// namespace luisa::compute
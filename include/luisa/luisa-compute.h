@@ -99,6 +99,7 @@
 #include <luisa/runtime/buffer.h>
 #include <luisa/runtime/buffer_arena.h>
 #include <luisa/runtime/byte_buffer.h>
+#include <luisa/runtime/command_graph.h>
 #include <luisa/runtime/command_list.h>
 #include <luisa/runtime/context.h>
 #include <luisa/runtime/depth_format.h>
@@ -106,6 +107,7 @@
 #include <luisa/runtime/dispatch_buffer.h>
 #include <luisa/runtime/event.h>
 #include <luisa/runtime/image.h>
+#include <luisa/runtime/kernel_fusion.h>
 #include <luisa/runtime/mipmap.h>
 #include <luisa/runtime/raster/app_data.h>
 #include <luisa/runtime/raster/depth_buffer.h>
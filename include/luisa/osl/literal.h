@@ -34,6 +34,7 @@ public:
     [[nodiscard]] auto is_string() const noexcept { return _tag == Tag::STRING; }
     [[nodiscard]] int as_int() const noexcept;
     [[nodiscard]] float as_float() const noexcept;
+    [[nodiscard]] double as_double() const noexcept;
     [[nodiscard]] luisa::string_view as_string() const noexcept;
 
     // for debugging
@@ -5,6 +5,10 @@
 
 #include <luisa/osl/shader.h>
 
+namespace luisa {
+class ThreadPool;
+}// namespace luisa
+
 namespace luisa::compute::osl {
 
 class Shader;
@@ -19,13 +23,14 @@ class LC_OSL_API OSOParser {
 private:
     struct ShaderDecl;
     struct State {
-        luisa::string_view source;
+        const char *cursor;
+        const char *line_begin;
         uint32_t line;
-        uint32_t column;
     };
 
 private:
     State _state;
+    const char *_end;
     luisa::string_view _path;
     luisa::unique_ptr<ShaderDecl> _shader;
     luisa::vector<Shader::CodeMarker> _code_markers;
@@ -73,6 +78,8 @@ private:
     [[nodiscard]] bool _is_string() const noexcept;
     [[nodiscard]] bool _is_identifier() const noexcept;
     [[nodiscard]] bool _is_hint() const noexcept;
+    [[nodiscard]] luisa::string_view _scan_identifier() noexcept;
+    [[nodiscard]] luisa::string_view _scan_integer() noexcept;
     [[nodiscard]] luisa::string _parse_identifier() noexcept;
     [[nodiscard]] double _parse_number() noexcept;
     [[nodiscard]] luisa::string _parse_string(bool keep_quotes = false) noexcept;
@@ -85,8 +92,13 @@ private:
     [[nodiscard]] luisa::unique_ptr<Symbol> _parse_symbol() noexcept;
 
 public:
-    [[nodiscard]] static luisa::unique_ptr<Shader> parse(luisa::string_view source) noexcept;
+    // the path, if any, is only used in error messages
+    [[nodiscard]] static luisa::unique_ptr<Shader> parse(luisa::string_view source,
+                                                         luisa::string_view path = {}) noexcept;
     [[nodiscard]] static luisa::unique_ptr<Shader> parse_file(luisa::string_view path) noexcept;
+    // parses the files in parallel on the pool; the shaders are in the order of the paths
+    [[nodiscard]] static luisa::vector<luisa::unique_ptr<Shader>> parse_files(
+        luisa::span<const luisa::string> paths, ThreadPool &pool) noexcept;
 };
 
 }// namespace luisa::compute::osl
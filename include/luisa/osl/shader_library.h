@@ -0,0 +1,47 @@
+#pragma once
+
+#include <mutex>
+
+#include <luisa/core/dll_export.h>
+#include <luisa/core/thread_pool.h>
+#include <luisa/core/stl/filesystem.h>
+#include <luisa/core/stl/unordered_map.h>
+
+#include <luisa/osl/shader.h>
+
+namespace luisa::compute::osl {
+
+// Loads OSO files into shaders that are shared by all their users. Shaders are keyed
+// by the hash of the file contents, so a file is parsed only once however many times
+// (and through whichever paths) it is loaded. With a cache directory, parsed shaders
+// are also stored there in a binary form, which later loads read instead of parsing.
+class LC_OSL_API ShaderLibrary {
+
+public:
+    // bumped whenever the binary form of the shaders changes
+    static constexpr uint32_t cache_version = 1u;
+
+private:
+    luisa::filesystem::path _cache_directory;
+    ThreadPool _pool;
+    std::mutex _mutex;
+    luisa::unordered_map<uint64_t, luisa::unique_ptr<Shader>> _shaders;
+
+public:
+    explicit ShaderLibrary(luisa::filesystem::path cache_directory = {}) noexcept;
+    ~ShaderLibrary() noexcept;
+    ShaderLibrary(ShaderLibrary &&) noexcept = delete;
+    ShaderLibrary(const ShaderLibrary &) noexcept = delete;
+    ShaderLibrary &operator=(ShaderLibrary &&) noexcept = delete;
+    ShaderLibrary &operator=(const ShaderLibrary &) noexcept = delete;
+    [[nodiscard]] const Shader *load(luisa::string_view path) noexcept;
+    // loads the files in parallel; the shaders are in the order of the paths
+    [[nodiscard]] luisa::vector<const Shader *> load(luisa::span<const luisa::string> paths) noexcept;
+    [[nodiscard]] size_t size() noexcept;
+
+    // the binary form of the shaders in the cache; deserialize returns nullptr on malformed data
+    [[nodiscard]] static luisa::vector<std::byte> serialize(const Shader &shader) noexcept;
+    [[nodiscard]] static luisa::unique_ptr<Shader> deserialize(luisa::span<const std::byte> data) noexcept;
+};
+
+}// namespace luisa::compute::osl
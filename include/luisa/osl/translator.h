@@ -0,0 +1,66 @@
+#pragma once
+
+#include <mutex>
+
+#include <luisa/core/dll_export.h>
+#include <luisa/core/stl/memory.h>
+#include <luisa/core/stl/string.h>
+#include <luisa/core/stl/vector.h>
+#include <luisa/core/stl/unordered_map.h>
+
+#include <luisa/osl/symbol.h>
+
+namespace luisa::compute::detail {
+class FunctionBuilder;
+}// namespace luisa::compute::detail
+
+namespace luisa::compute::osl {
+
+class Shader;
+
+// Lowers OSL shaders into callables. The arguments of a callable are, in order, the
+// globals used by the shader (by reference), its parameters without specialized values
+// (by value) and its output parameters (by reference). Parameters with values known when
+// the shader network is built are folded into the callable along with everything computed
+// from them, e.g., branches on such parameters are resolved during the translation.
+class LC_OSL_API Translator {
+
+public:
+    // values of the parameters known when the shader network is built, by name;
+    // the components of triples and the elements of arrays are flattened
+    using Specialization = luisa::unordered_map<luisa::string, luisa::vector<double>>;
+
+    struct Argument {
+        Symbol::Tag tag;
+        luisa::string identifier;
+    };
+
+    struct Translation {
+        luisa::shared_ptr<const luisa::compute::detail::FunctionBuilder> function;
+        luisa::vector<Argument> arguments;
+    };
+
+private:
+    std::mutex _mutex;
+    luisa::unordered_map<uint64_t, luisa::unique_ptr<Translation>> _translations;
+    luisa::unordered_map<uint64_t, luisa::shared_ptr<const luisa::compute::detail::FunctionBuilder>> _functions;
+
+public:
+    Translator() noexcept;
+    ~Translator() noexcept;
+    Translator(Translator &&) noexcept = delete;
+    Translator(const Translator &) noexcept = delete;
+    Translator &operator=(Translator &&) noexcept = delete;
+    Translator &operator=(const Translator &) noexcept = delete;
+    // Translations are cached by the contents of the shaders and the specialized values, and
+    // identical callables are shared. Returns nullptr if the shader uses features that have no
+    // translation (e.g., closures and matrices), which are reported as warnings.
+    [[nodiscard]] const Translation *translate(const Shader &shader,
+                                               const Specialization &specialization = {}) noexcept;
+    // the number of distinct callables translated so far
+    [[nodiscard]] size_t function_count() noexcept;
+    // specializes all the (non-output) parameters to their default values
+    [[nodiscard]] static Specialization default_specialization(const Shader &shader) noexcept;
+};
+
+}// namespace luisa::compute::osl
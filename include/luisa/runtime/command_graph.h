@@ -0,0 +1,88 @@
+#pragma once
+
+#include <luisa/runtime/command_list.h>
+#include <luisa/runtime/stream_event.h>
+
+namespace luisa::compute {
+
+class DeviceInterface;
+struct CommandGraphCommit;
+
+template<typename T>
+class BufferView;
+
+// A command list recorded once and submitted repeatedly. Uniforms, dispatch sizes and
+// resource bindings of recorded shader dispatches can be patched in place between
+// submissions; patching never affects submissions that are already in flight.
+// Backends supporting CommandGraphExt convert the commands once and replay their
+// converted form, converting only patched dispatches again; on other backends each
+// submission emits a copy of the recorded commands.
+class LC_RUNTIME_API CommandGraph : concepts::Noncopyable {
+
+    friend struct CommandGraphCommit;
+
+public:
+    using CommandContainer = CommandList::CommandContainer;
+
+private:
+    struct Recording;
+    CommandContainer _commands;
+    // the backend recording, created on the first submission
+    luisa::unique_ptr<Recording> _recording;
+    // dispatches patched since the recording was last updated
+    luisa::vector<size_t> _dirty;
+
+private:
+    [[nodiscard]] ShaderDispatchCommand *_dispatch(size_t command_index) const noexcept;
+    [[nodiscard]] Argument &_argument(size_t command_index, size_t argument_index,
+                                      Argument::Tag tag) const noexcept;
+    void _set_uniform(size_t command_index, size_t argument_index,
+                      const void *data, size_t size) noexcept;
+    void _mark_dirty(size_t command_index) noexcept;
+    [[nodiscard]] CommandList _copy() const noexcept;
+    void _submit(DeviceInterface *device, uint64_t stream_handle) noexcept;
+
+public:
+    CommandGraph() noexcept;
+    // records the commands of the list; the list must not carry callbacks
+    explicit CommandGraph(CommandList &&list) noexcept;
+    CommandGraph(CommandGraph &&) noexcept;
+    CommandGraph &operator=(CommandGraph &&) noexcept;
+    ~CommandGraph() noexcept;
+
+    [[nodiscard]] auto size() const noexcept { return _commands.size(); }
+    [[nodiscard]] auto empty() const noexcept { return _commands.empty(); }
+    [[nodiscard]] auto commands() const noexcept { return luisa::span{_commands}; }
+
+    // patching of recorded shader dispatches, where argument_index
+    // indexes ShaderDispatchCommand::arguments() of the command;
+    // indirect and batched dispatches keep their dispatch sizes
+    void set_dispatch_size(size_t command_index, uint3 dispatch_size) noexcept;
+    void set_buffer(size_t command_index, size_t argument_index,
+                    uint64_t handle, size_t offset_bytes, size_t size_bytes) noexcept;
+    void set_texture(size_t command_index, size_t argument_index,
+                     uint64_t handle, uint32_t level) noexcept;
+    void set_bindless_array(size_t command_index, size_t argument_index, uint64_t handle) noexcept;
+    void set_accel(size_t command_index, size_t argument_index, uint64_t handle) noexcept;
+    template<typename T>
+    void set_buffer(size_t command_index, size_t argument_index, BufferView<T> view) noexcept {
+        set_buffer(command_index, argument_index, view.handle(), view.offset_bytes(), view.size_bytes());
+    }
+    template<typename T>
+        requires std::is_trivially_copyable_v<T>
+    void set_uniform(size_t command_index, size_t argument_index, const T &value) noexcept {
+        _set_uniform(command_index, argument_index, &value, sizeof(T));
+    }
+
+    // submits the recorded commands when streamed
+    [[nodiscard]] CommandGraphCommit commit() noexcept;
+};
+
+struct LC_RUNTIME_API CommandGraphCommit {
+    CommandGraph *graph;
+    void operator()(DeviceInterface *device, uint64_t stream_handle) noexcept;
+};
+
+LUISA_MARK_STREAM_EVENT_TYPE(CommandGraphCommit)
+
+}// namespace luisa::compute
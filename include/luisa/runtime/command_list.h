@@ -24,6 +24,9 @@ public:
 private:
     CommandContainer _commands;
     CallbackContainer _callbacks;
+    // set when a mipmap generation command is appended, so that streams only
+    // look for the commands to lower in the lists that have them
+    bool _has_mipmap_commands{false};
     bool _committed{false};
 
 public:
@@ -44,6 +47,7 @@ public:
     [[nodiscard]] CommandContainer steal_commands() noexcept;
     [[nodiscard]] CallbackContainer steal_callbacks() noexcept;
     [[nodiscard]] auto empty() const noexcept { return _commands.empty() && _callbacks.empty(); }
+    [[nodiscard]] auto has_mipmap_commands() const noexcept { return _has_mipmap_commands; }
     [[nodiscard]] Commit commit() noexcept;
 };
 
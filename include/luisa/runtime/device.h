@@ -26,10 +26,15 @@ class IndirectDispatchBuffer;
 class SparseBufferHeap;
 class SparseTextureHeap;
 class ByteBuffer;
+class ShaderCompileBatch;
+class KernelFusion;
 
 template<typename T>
 class SOA;
 
+template<typename T, uint W>
+class AOSOA;
+
 template<typename T>
 class Buffer;
 
@@ -221,6 +226,11 @@ public:
         return SOA<T>{*this, size};
     }
 
+    template<typename T, uint W>
+    [[nodiscard]] auto create_aosoa(size_t size) noexcept {
+        return AOSOA<T, W>{*this, size};
+    }
+
     template<typename T>
         requires(!is_custom_struct_v<T>)//backend-specific type not allowed
     [[nodiscard]] auto create_sparse_buffer(size_t size) noexcept {
@@ -273,6 +283,14 @@ public:
         static_cast<void>(this->compile<N>(std::forward<Kernel>(kernel), option));
     }
 
+    // see definition in runtime/shader_compile_batch.cpp
+    // compiles kernels concurrently on a thread pool with num_threads workers (0 for all cores)
+    [[nodiscard]] ShaderCompileBatch compile_batch(size_t num_threads = 0u) noexcept;
+
+    // see definition in runtime/kernel_fusion.cpp
+    // fuses runs of elementwise dispatches of the kernels compiled through it
+    [[nodiscard]] KernelFusion kernel_fusion(const ShaderOption &option = {}) noexcept;
+
 #ifdef LUISA_ENABLE_IR
     template<size_t N, typename... Args>
     [[nodiscard]] auto compile(const ir::KernelModule *const module,
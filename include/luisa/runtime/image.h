@@ -125,6 +125,14 @@ public:
         _check_is_valid();
         return this->view(0).copy_from(std::forward<U>(dst));
     }
+    // fill all levels but the first by downsampling level 0
+    [[nodiscard]] auto generate_mipmaps(MipmapFilter filter = MipmapFilter::BOX,
+                                        bool srgb = false) const noexcept
+        requires std::is_same_v<T, float>
+    {
+        _check_is_valid();
+        return detail::generate_mipmaps(handle(), _storage, _size, _mip_levels, filter, srgb);
+    }
     // DSL interface
     [[nodiscard]] auto operator->() const noexcept {
         _check_is_valid();
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <luisa/core/stl/unordered_map.h>
+#include <luisa/runtime/shader.h>
+#include <luisa/runtime/command_list.h>
+
+namespace luisa::compute {
+
+/**
+ * @brief Fuses back-to-back elementwise dispatches into generated kernels.
+ *
+ * Kernels compiled through the fusion object are registered as fusible. When a
+ * command list is passed to fuse(), every run of consecutive dispatches of
+ * registered kernels with the same dispatch size and block size is replaced by
+ * a single dispatch of a kernel that calls the original kernels in order on
+ * each thread. Fused kernels are generated from the kernels' ASTs and cached by
+ * the hashes of their stages.
+ *
+ * Fusion is opt-in because it is only correct for elementwise kernels: if one
+ * stage writes a resource that another stage of the same run accesses, each
+ * thread may only touch the elements that it writes. Kernels with shared memory,
+ * block synchronization, external functions or CPU callbacks are never fused.
+ * Registered shaders are identified by their handles, so they should be kept
+ * alive as long as the fusion object is used.
+ *
+ * Example:
+ * @code
+ * auto fusion = device.kernel_fusion();
+ * auto scale = fusion.compile(scale_kernel);
+ * auto clamp = fusion.compile(clamp_kernel);
+ * CommandList list;
+ * list << scale(buffer, 2.f).dispatch(n)
+ *      << clamp(buffer, 0.f, 1.f).dispatch(n);
+ * stream << fusion.fuse(std::move(list)).commit();
+ * @endcode
+ */
+class LC_RUNTIME_API KernelFusion {
+
+public:
+    /// maximum number of kernels fused into one dispatch
+    static constexpr auto max_stages = 8u;
+
+private:
+    struct Stage {
+        luisa::shared_ptr<const detail::FunctionBuilder> kernel;
+        luisa::shared_ptr<const detail::FunctionBuilder> callable;
+    };
+    struct FusedShader {
+        uint64_t handle;
+        size_t uniform_size;
+    };
+    DeviceInterface *_device{nullptr};
+    ShaderOption _option;
+    luisa::unordered_map<uint64_t, Stage> _stages;
+    luisa::unordered_map<uint64_t, FusedShader> _fused;
+
+private:
+    friend class Device;
+    KernelFusion(DeviceInterface *device, const ShaderOption &option) noexcept;
+    void _destroy() noexcept;
+    void _register(uint64_t shader_handle, luisa::shared_ptr<const detail::FunctionBuilder> kernel) noexcept;
+    [[nodiscard]] Stage *_stage(const Command *command) noexcept;
+    [[nodiscard]] const FusedShader &_fuse(luisa::span<Stage *const> stages) noexcept;
+    [[nodiscard]] luisa::unique_ptr<Command> _encode(const FusedShader &shader,
+                                                     luisa::span<const luisa::unique_ptr<Command>> commands) noexcept;
+
+public:
+    KernelFusion() noexcept = default;
+    KernelFusion(KernelFusion &&another) noexcept;
+    KernelFusion(const KernelFusion &) noexcept = delete;
+    KernelFusion &operator=(KernelFusion &&rhs) noexcept;
+    KernelFusion &operator=(const KernelFusion &) noexcept = delete;
+    ~KernelFusion() noexcept;
+
+    [[nodiscard]] explicit operator bool() const noexcept { return _device != nullptr; }
+
+    /// Compile a kernel and register it as fusible
+    template<size_t N, typename... Args>
+    [[nodiscard]] auto compile(const Kernel<N, Args...> &kernel,
+                               const ShaderOption &option = {}) noexcept {
+        Shader<N, Args...> shader{_device, kernel.function()->function(), option};
+        _register(shader.handle(), kernel.function());
+        return shader;
+    }
+    /// Rewrite the list, replacing runs of fusible dispatches with fused ones
+    [[nodiscard]] CommandList fuse(CommandList &&list) noexcept;
+    /// Number of fused kernels generated so far
+    [[nodiscard]] auto fused_kernel_count() const noexcept { return _fused.size(); }
+};
+
+}// namespace luisa::compute
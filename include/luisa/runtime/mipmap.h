@@ -1,9 +1,15 @@
 #pragma once
 
+#include <array>
+
 #include <luisa/runtime/rhi/command.h>
 
 namespace luisa::compute {
 
+class DeviceInterface;
+class CommandList;
+class MipmapExt;
+
 template<typename T>
 class Image;
 
@@ -22,6 +28,13 @@ class Buffer;
 template<typename T>
 class BufferView;
 
+enum struct MipmapFilter : uint32_t {
+    // average of the 2x2 texels below
+    BOX,
+    // 8-tap Kaiser-windowed sinc, sharper than BOX without visible ringing
+    KAISER,
+};
+
 namespace detail {
 
 class LC_RUNTIME_API MipmapView {
@@ -110,6 +123,36 @@ public:
     }
 };
 
+[[nodiscard]] LC_RUNTIME_API luisa::unique_ptr<Command> generate_mipmaps(
+    uint64_t handle, PixelStorage storage, uint2 size,
+    uint level_count, MipmapFilter filter, bool srgb) noexcept;
+
+// Replaces the GenerateMipmapsCommands that the device does not run natively
+// (see MipmapExt) by one compute dispatch per level, which filters the level
+// from the previous one like the CPU backend does. Streams create it on the
+// first such command; the kernels are built from the AST and compiled on use.
+class LC_RUNTIME_API MipmapFallback {
+
+private:
+    DeviceInterface *_device;
+    const MipmapExt *_ext;
+    // shader handles indexed by filter and sRGB-ness
+    std::array<uint64_t, 4u> _shaders;
+
+private:
+    [[nodiscard]] uint64_t _shader(MipmapFilter filter, bool srgb) noexcept;
+
+public:
+    explicit MipmapFallback(DeviceInterface *device) noexcept;
+    ~MipmapFallback() noexcept;
+    MipmapFallback(MipmapFallback &&) noexcept = delete;
+    MipmapFallback(const MipmapFallback &) noexcept = delete;
+    MipmapFallback &operator=(MipmapFallback &&) noexcept = delete;
+    MipmapFallback &operator=(const MipmapFallback &) noexcept = delete;
+    [[nodiscard]] static bool is_mipmap_command(const Command *command) noexcept;
+    [[nodiscard]] CommandList lower(CommandList &&list) noexcept;
+};
+
 [[nodiscard]] constexpr auto max_mip_levels(uint3 size, uint requested_levels) noexcept {
     auto max_size = std::max({size.x, size.y, size.z});
     auto max_levels = 0u;
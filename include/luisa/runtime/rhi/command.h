@@ -67,6 +67,7 @@ struct MutableCommandVisitor {
 
 class Command;
 class CommandList;
+class CommandGraph;
 
 #define LUISA_MAKE_COMMAND_COMMON_ACCEPT()                                                \
     void accept(CommandVisitor &visitor) const noexcept override { visitor.visit(this); } \
@@ -103,6 +104,7 @@ public:
     using Argument = luisa::compute::Argument;
 
 private:
+    friend class CommandGraph;
     uint64_t _handle;
     luisa::vector<std::byte> _argument_buffer;
     size_t _argument_count;
@@ -136,6 +138,7 @@ public:
         >;
 
 private:
+    friend class CommandGraph;
     DispatchSize _dispatch_size;
 
 public:
@@ -24,6 +24,12 @@ class SOA;
 template<typename T>
 class SOAView;
 
+template<typename T, uint W>
+class AOSOA;
+
+template<typename T, uint W>
+class AOSOAView;
+
 namespace detail {
 
 template<typename... Args>
@@ -61,6 +67,11 @@ struct prototype_to_shader_invocation<SOA<T>> {
     using type = SOAView<T>;
 };
 
+template<typename T, uint W>
+struct prototype_to_shader_invocation<AOSOA<T, W>> {
+    using type = AOSOAView<T, W>;
+};
+
 template<typename T>
 using prototype_to_shader_invocation_t = typename prototype_to_shader_invocation<T>::type;
 
@@ -122,6 +133,12 @@ public:
     template<typename T>
     ShaderInvokeBase &operator<<(SOAView<T> soa) noexcept;
 
+    template<typename T, uint W>
+    ShaderInvokeBase &operator<<(const AOSOA<T, W> &aosoa) noexcept;
+
+    template<typename T, uint W>
+    ShaderInvokeBase &operator<<(AOSOAView<T, W> aosoa) noexcept;
+
     template<typename T>
     ShaderInvokeBase &operator<<(T data) noexcept {
         _encoder.encode_uniform(&data, sizeof(T));
@@ -230,6 +247,8 @@ class Shader final : public Resource {
 
 private:
     friend class Device;
+    friend class ShaderCompileBatch;
+    friend class KernelFusion;
     uint _block_size[3];
     size_t _uniform_size{};
 
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <mutex>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/thread_pool.h>
+#include <luisa/core/stl/hash.h>
+#include <luisa/core/stl/unordered_map.h>
+#include <luisa/runtime/shader.h>
+
+namespace luisa::compute {
+
+/// Per-shader statistics collected by ShaderCompileBatch
+struct ShaderCompileStatistics {
+    /// user-provided shader name, or the hexadecimal kernel hash if empty
+    luisa::string name;
+    /// hash of the kernel function combined with the shader options
+    uint64_t hash{};
+    /// time spent in DSL tracing (milliseconds), zero for pre-traced kernels
+    double trace_time{};
+    /// time spent in backend codegen and compilation (milliseconds),
+    /// zero if the shader was de-duplicated against an earlier request
+    double compile_time{};
+    /// whether the shader reused the result of an identical kernel
+    bool deduplicated{false};
+};
+
+/**
+ * @brief Compiles many shaders concurrently on a managed thread pool.
+ *
+ * Kernels are traced (if given as plain functions) and compiled by the
+ * backend on worker threads. Identical kernels (same function hash and
+ * code-affecting shader options, i.e., regardless of the shader name unless
+ * compiling only) are compiled only once and share the resulting shader.
+ * The results are returned as shared futures of shared shader handles.
+ *
+ * Example:
+ * @code
+ * auto batch = device.compile_batch();
+ * auto a = batch.compile_async<1>([](BufferFloat buf) noexcept { ... });
+ * auto b = batch.compile_async(kernel_b);
+ * batch.wait();
+ * (*a.get())(buffer).dispatch(1024u);
+ * @endcode
+ */
+class LC_RUNTIME_API ShaderCompileBatch {
+
+public:
+    using Callback = luisa::function<void(const ShaderCompileStatistics &)>;
+
+private:
+    struct CompiledShader {
+        std::once_flag flag;
+        luisa::shared_ptr<void> shader;
+    };
+
+    struct State {
+        DeviceInterface *device{nullptr};
+        std::mutex mutex;
+        luisa::unordered_map<uint64_t, luisa::shared_ptr<CompiledShader>> shaders;
+        luisa::vector<ShaderCompileStatistics> statistics;
+        Callback callback;
+    };
+
+private:
+    luisa::shared_ptr<State> _state;
+    luisa::unique_ptr<ThreadPool> _pool;
+
+private:
+    friend class Device;
+    ShaderCompileBatch(DeviceInterface *device, size_t num_threads) noexcept;
+
+    [[nodiscard]] static size_t _allocate_statistics(State &state) noexcept;
+    [[nodiscard]] static uint64_t _compute_hash(Function kernel, const ShaderOption &option) noexcept;
+    [[nodiscard]] static luisa::shared_ptr<CompiledShader> _find_or_create(State &state, uint64_t hash) noexcept;
+    static void _finish(State &state, size_t index, ShaderCompileStatistics stats) noexcept;
+
+    template<size_t N, typename... Args>
+    [[nodiscard]] static auto _compile(State &state, size_t index, const Kernel<N, Args...> &kernel,
+                                       const ShaderOption &option, double trace_time) noexcept {
+        auto f = kernel.function()->function();
+        auto hash = _compute_hash(f, option);
+        auto compiled = _find_or_create(state, hash);
+        Clock clock;
+        auto deduplicated = true;
+        std::call_once(compiled->flag, [&] {
+            deduplicated = false;
+            auto shader = luisa::make_shared<Shader<N, Args...>>();
+            *shader = Shader<N, Args...>{state.device, f, option};
+            compiled->shader = std::move(shader);
+        });
+        ShaderCompileStatistics stats{
+            .name = option.name.empty() ? luisa::format("{:016x}", hash) : option.name,
+            .hash = hash,
+            .trace_time = trace_time,
+            .compile_time = deduplicated ? 0. : clock.toc(),
+            .deduplicated = deduplicated};
+        _finish(state, index, std::move(stats));
+        return luisa::static_pointer_cast<Shader<N, Args...>>(compiled->shader);
+    }
+
+public:
+    ShaderCompileBatch() noexcept = default;
+    ShaderCompileBatch(ShaderCompileBatch &&) noexcept = default;
+    ShaderCompileBatch(const ShaderCompileBatch &) noexcept = delete;
+    ShaderCompileBatch &operator=(ShaderCompileBatch &&) noexcept = default;
+    ShaderCompileBatch &operator=(const ShaderCompileBatch &) noexcept = delete;
+    ~ShaderCompileBatch() noexcept;
+
+    [[nodiscard]] explicit operator bool() const noexcept { return _state != nullptr; }
+
+    /// Compile an already traced kernel asynchronously
+    template<size_t N, typename... Args>
+    [[nodiscard]] auto compile_async(const Kernel<N, Args...> &kernel,
+                                     const ShaderOption &option = {}) noexcept {
+        auto index = _allocate_statistics(*_state);
+        return _pool->async([state = _state, index, kernel, option] {
+            return _compile(*state, index, kernel, option, 0.);
+        });
+    }
+
+    /// Trace and compile a kernel function asynchronously
+    template<size_t N, typename Func>
+        requires(std::negation_v<detail::is_dsl_kernel<std::remove_cvref_t<Func>>> && N >= 1 && N <= 3)
+    [[nodiscard]] auto compile_async(Func &&f, const ShaderOption &option = {}) noexcept {
+        auto index = _allocate_statistics(*_state);
+        return _pool->async([state = _state, index, f = std::forward<Func>(f), option]() mutable {
+            Clock clock;
+            if constexpr (N == 1u) {
+                Kernel1D kernel{std::move(f)};
+                return _compile(*state, index, kernel, option, clock.toc());
+            } else if constexpr (N == 2u) {
+                Kernel2D kernel{std::move(f)};
+                return _compile(*state, index, kernel, option, clock.toc());
+            } else {
+                Kernel3D kernel{std::move(f)};
+                return _compile(*state, index, kernel, option, clock.toc());
+            }
+        });
+    }
+
+    /// Set a callback invoked on the worker thread after each shader finishes
+    void set_callback(Callback callback) noexcept;
+    /// Block until all submitted shaders are compiled
+    void wait() noexcept;
+    /// Number of shaders requested so far (including de-duplicated ones)
+    [[nodiscard]] size_t size() const noexcept;
+    /// Snapshot of per-shader statistics, in request order
+    [[nodiscard]] luisa::vector<ShaderCompileStatistics> statistics() const noexcept;
+    /// Print a summary of the statistics to the log
+    void report() const noexcept;
+};
+
+}// namespace luisa::compute
@@ -100,7 +100,7 @@ public:
         detail::check_sparse_tex3d_unmap(_size, _tile_size, start_tile);
         return SparseUpdateTile{
             .handle = handle(),
-            .operations = SparseTextureMapOperation{
+            .operations = SparseTextureUnMapOperation{
                 .start_tile = start_tile,
                 .tile_count = tile_count,
                 .mip_level = mip_level}};
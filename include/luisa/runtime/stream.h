@@ -10,6 +10,10 @@
 
 namespace luisa::compute {
 
+namespace detail {
+class MipmapFallback;
+}// namespace detail
+
 class LC_RUNTIME_API Stream final : public Resource {
 
 public:
@@ -62,6 +66,8 @@ private:
     friend class Device;
     friend class DStorageExt;
     StreamTag _stream_tag{};
+    // created on the first mipmap generation command
+    luisa::shared_ptr<detail::MipmapFallback> _mipmap_fallback;
 
 private:
     explicit Stream(DeviceInterface *device, StreamTag stream_tag) noexcept;
@@ -56,6 +56,13 @@ typedef enum LCPixelFormat {
     LC_PIXEL_FORMAT_R32F,
     LC_PIXEL_FORMAT_RG32F,
     LC_PIXEL_FORMAT_RGBA32F,
+    LC_PIXEL_FORMAT_BC1_UNORM = 33,
+    LC_PIXEL_FORMAT_BC2_UNORM = 34,
+    LC_PIXEL_FORMAT_BC3_UNORM = 35,
+    LC_PIXEL_FORMAT_BC4_UNORM = 36,
+    LC_PIXEL_FORMAT_BC5_UNORM = 37,
+    LC_PIXEL_FORMAT_BC6H_UF16 = 38,
+    LC_PIXEL_FORMAT_BC7_UNORM = 39,
 } LCPixelFormat;
 
 typedef enum LCPixelStorage {
@@ -74,6 +81,13 @@ typedef enum LCPixelStorage {
     LC_PIXEL_STORAGE_FLOAT1,
     LC_PIXEL_STORAGE_FLOAT2,
     LC_PIXEL_STORAGE_FLOAT4,
+    LC_PIXEL_STORAGE_BC1 = 17,
+    LC_PIXEL_STORAGE_BC2 = 18,
+    LC_PIXEL_STORAGE_BC3 = 19,
+    LC_PIXEL_STORAGE_BC4 = 20,
+    LC_PIXEL_STORAGE_BC5 = 21,
+    LC_PIXEL_STORAGE_BC6 = 22,
+    LC_PIXEL_STORAGE_BC7 = 23,
 } LCPixelStorage;
 
 typedef enum LCSamplerAddress {
@@ -59,6 +59,13 @@ enum class PixelFormat {
     R32F,
     RG32F,
     RGBA32F,
+    BC1_UNORM = 33,
+    BC2_UNORM = 34,
+    BC3_UNORM = 35,
+    BC4_UNORM = 36,
+    BC5_UNORM = 37,
+    BC6H_UF16 = 38,
+    BC7_UNORM = 39,
 };
 
 enum class PixelStorage {
@@ -77,6 +84,13 @@ enum class PixelStorage {
     FLOAT1,
     FLOAT2,
     FLOAT4,
+    BC1 = 17,
+    BC2 = 18,
+    BC3 = 19,
+    BC4 = 20,
+    BC5 = 21,
+    BC6 = 22,
+    BC7 = 23,
 };
 
 enum class SamplerAddress {
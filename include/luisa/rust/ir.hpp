@@ -841,6 +841,11 @@ struct CBox {
     void (*destructor)(T*);
 };
 
+struct TransformCacheStatistics {
+    size_t hits;
+    size_t misses;
+};
+
 
 
 static const NodeRef INVALID_REF = NodeRef{ /* ._0 = */ 0 };
@@ -932,12 +937,23 @@ Module luisa_compute_ir_transform_auto(Module module);
 void luisa_compute_ir_transform_pipeline_add_transform(TransformPipeline *pipeline,
                                                        const char *name);
 
+TransformCacheStatistics luisa_compute_ir_transform_pipeline_cache_statistics(const TransformPipeline *pipeline);
+
+void luisa_compute_ir_transform_pipeline_clear_cache(TransformPipeline *pipeline);
+
 void luisa_compute_ir_transform_pipeline_destroy(TransformPipeline *pipeline);
 
 TransformPipeline *luisa_compute_ir_transform_pipeline_new();
 
 Module luisa_compute_ir_transform_pipeline_transform(TransformPipeline *pipeline, Module module);
 
+void luisa_compute_ir_transform_pipeline_transform_callable(TransformPipeline *pipeline,
+                                                            CallableModule *module);
+
+CBoxedSlice<uint8_t> luisa_compute_ir_transform_statistics_report();
+
+void luisa_compute_ir_transform_statistics_reset();
+
 size_t luisa_compute_ir_type_alignment(const CArc<Type> *ty);
 
 size_t luisa_compute_ir_type_size(const CArc<Type> *ty);
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <luisa/core/magic_enum.h>
 #include <luisa/core/logging.h>
 #include <luisa/ast/callable_library.h>
@@ -76,6 +78,9 @@ Variable CallableLibrary::deser_value(std::byte const *&ptr, DeserPackage &pack)
     v._type = deser_value<Type const *>(ptr, pack);
     v._uid = deser_value<uint32_t>(ptr, pack);
     v._tag = deser_value<Variable::Tag>(ptr, pack);
+    if (pack.object_id_as_argument && v._tag == Variable::Tag::OBJECT_ID) {
+        v._tag = Variable::Tag::LOCAL;
+    }
     return v;
 }
 template<>
@@ -711,6 +716,11 @@ void CallableLibrary::serialize_func_builder(detail::FunctionBuilder const &buil
                      "Callable cannot contain bound-argument.");
     }
     LUISA_ASSERT(builder._used_external_functions.empty(), "Callable cannot contain external-function.");
+    serialize_func_builder_content(builder, vec);
+}
+void CallableLibrary::serialize_func_builder_content(detail::FunctionBuilder const &builder, luisa::vector<std::byte> &vec) noexcept {
+    using namespace detail;
+    using namespace std::string_view_literals;
     // return type
     if (builder._return_type)
         ser_value(builder._return_type.value(), vec);
@@ -760,6 +770,43 @@ void CallableLibrary::serialize_func_builder(detail::FunctionBuilder const &buil
     // body
     ser_value(static_cast<Statement const &>(builder._body), vec);
 }
+luisa::shared_ptr<const detail::FunctionBuilder> CallableLibrary::kernel_to_callable(Function kernel) noexcept {
+    auto &&src = *kernel.builder();
+    LUISA_ASSERT(src.tag() == Function::Tag::KERNEL || src.tag() == Function::Tag::RASTER_STAGE,
+                 "Function is not a kernel or a raster stage.");
+    LUISA_ASSERT(src._used_external_functions.empty() && src._cpu_callbacks.empty(),
+                 "Kernels with external functions or CPU callbacks cannot be converted to callables.");
+    LUISA_ASSERT(src._shared_variables.empty() &&
+                     !src._propagated_builtin_callables.test(CallOp::SYNCHRONIZE_BLOCK),
+                 "Kernels with shared variables or block synchronization cannot be converted to callables.");
+    luisa::vector<std::byte> vec;
+    serialize_func_builder_content(src, vec);
+    auto f = luisa::make_shared<detail::FunctionBuilder>(Function::Tag::CALLABLE);
+    DeserPackage pack{.builder = f.get(),
+                      .object_id_as_argument = src.tag() == Function::Tag::RASTER_STAGE};
+    for (auto &&c : src._used_custom_callables) {
+        pack.callable_map.try_emplace(c->hash(), luisa::const_pointer_cast<detail::FunctionBuilder>(c));
+    }
+    auto ptr = static_cast<std::byte const *>(vec.data());
+    deserialize_func_builder(*f, ptr, pack);
+    f->_tag = Function::Tag::CALLABLE;
+    // kernels keep their captured arguments first, and callables bind them the same way
+    f->_bound_arguments.clear();
+    for (auto &&b : src._bound_arguments) { f->_bound_arguments.emplace_back(b); }
+    while (f->_bound_arguments.size() < f->_arguments.size()) { f->_bound_arguments.emplace_back(); }
+    // builtin variables of callables are passed as arguments
+    for (auto &&v : f->_builtin_variables) {
+        f->_arguments.emplace_back(v);
+        f->_bound_arguments.emplace_back();
+    }
+    // the object id of raster stages is no longer a builtin variable after deserialization
+    f->_builtin_variables.erase(
+        std::remove_if(f->_builtin_variables.begin(), f->_builtin_variables.end(),
+                       [](Variable v) noexcept { return !v.is_builtin(); }),
+        f->_builtin_variables.end());
+    f->_compute_hash();
+    return f;
+}
 CallableLibrary::CallableLibrary() noexcept = default;
 void CallableLibrary::load(luisa::span<const std::byte> binary) noexcept {
     _callables.clear();
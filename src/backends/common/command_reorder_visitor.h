@@ -10,6 +10,7 @@
 #include <luisa/runtime/rhi/argument.h>
 #include <luisa/core/logging.h>
 #include <luisa/backends/ext/raster_cmd.h>
+#include <luisa/backends/ext/mipmap_cmd.h>
 #include <luisa/vstl/stack_allocator.h>
 #include <luisa/vstl/arena_hash_map.h>
 
@@ -32,7 +33,7 @@ template<typename T>
 struct ReorderFuncTable{
     void lock_bindless(uint64_t bindless_handle) const noexcept{}
     void unlock_bindless(uint64_t bindless_handle) const noexcept{}
-    bool is_res_in_bindless(uint64_t bindless_handle, uint64_t resource_handle) const noexcept {}
+    template<typename F> void traverse_bindless(uint64_t bindless_handle, F &&f) const noexcept {} // f(uint64_t resource_handle)
     Usage get_usage(uint64_t shader_handle, size_t argument_index) const noexcept {}
     void update_bindless(uint64_t handle, luisa::span<const BindlessArrayUpdateCommand::Modification> modifications) const noexcept {}
     luisa::span<const Argument> shader_bindings(uint64_t handle) const noexcept {}
@@ -40,7 +41,7 @@ struct ReorderFuncTable{
 */
 concept ReorderFuncTable =
     requires(const T t, uint64_t uint64_v, size_t size_v, luisa::span<const BindlessArrayUpdateCommand::Modification> modification) {
-        requires(std::is_same_v<bool, decltype(t.is_res_in_bindless(uint64_v, uint64_v))>);
+        t.traverse_bindless(uint64_v, [](uint64_t) noexcept {});
         requires(std::is_same_v<Usage, decltype(t.get_usage(uint64_v, size_v))>);
         t.update_bindless(uint64_v, modification);
         t.lock_bindless(uint64_v);
@@ -83,11 +84,6 @@ public:
         }
         bool operator!=(Range const &r) const { return !operator==(r); }
     };
-    struct RangeHash {
-        size_t operator()(Range const &r) const {
-            return hash64(this, sizeof(Range), hash64_default_seed);
-        }
-    };
     struct ResourceView {
         int64_t read_layer = -1;
         int64_t write_layer = -1;
@@ -97,67 +93,121 @@ public:
         ResourceType type;
     };
     struct RangeHandle : public ResourceHandle {
-        using Map = vstd::ArenaHashMap<ArenaRef, Range, ResourceView, RangeHash>;
     private:
-        ResourceView max_view;
-        Map views;
+        // treap keyed by (min, max), each node caches the end and the latest layers of its subtree
+        struct Node {
+            Range range;
+            ResourceView view;
+            ResourceView subtree_view;
+            int64_t subtree_max;
+            uint64_t priority;
+            Node *left;
+            Node *right;
+        };
+        ArenaRef pool;
+        Node *root = nullptr;
+        uint64_t seed;
+        static void update(Node *n) {
+            n->subtree_view = n->view;
+            n->subtree_max = n->range.max;
+            for (auto c : {n->left, n->right}) {
+                if (c == nullptr) continue;
+                n->subtree_view.read_layer = std::max(n->subtree_view.read_layer, c->subtree_view.read_layer);
+                n->subtree_view.write_layer = std::max(n->subtree_view.write_layer, c->subtree_view.write_layer);
+                n->subtree_max = std::max(n->subtree_max, c->subtree_max);
+            }
+        }
+        template<typename F>
+        Node *emplace(Node *n, Range const &range, F const &f) {
+            if (n == nullptr) {
+                n = new (pool.allocate(sizeof(Node))) Node{};
+                n->range = range;
+                // splitmix64
+                seed += 0x9e3779b97f4a7c15ull;
+                auto z = seed;
+                z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9ull;
+                z = (z ^ (z >> 27u)) * 0x94d049bb133111ebull;
+                n->priority = z ^ (z >> 31u);
+                f(n->view);
+            } else if (range == n->range) {
+                f(n->view);
+            } else if (range.min < n->range.min || (range.min == n->range.min && range.max < n->range.max)) {
+                n->left = emplace(n->left, range, f);
+                if (n->left->priority > n->priority) {
+                    auto l = n->left;
+                    n->left = l->right;
+                    update(n);
+                    l->right = n;
+                    n = l;
+                }
+            } else {
+                n->right = emplace(n->right, range, f);
+                if (n->right->priority > n->priority) {
+                    auto r = n->right;
+                    n->right = r->left;
+                    update(n);
+                    r->left = n;
+                    n = r;
+                }
+            }
+            update(n);
+            return n;
+        }
+        // only visits subtrees that reach the range and may raise the layer
+        template<int64_t ResourceView::*member>
+        static void max_layer(Node const *n, Range const &range, int64_t &layer) {
+            while (n != nullptr && n->subtree_max > range.min && n->subtree_view.*member > layer) {
+                max_layer<member>(n->left, range, layer);
+                if (n->range.min >= range.max) return;
+                if (n->range.collide(range)) {
+                    layer = std::max(layer, n->view.*member);
+                }
+                n = n->right;
+            }
+        }
+
     public:
         RangeHandle(
-            ArenaRef &&pool) : views(16, std::move(pool)) {}
+            ArenaRef &&pool) : pool(std::move(pool)), seed(reinterpret_cast<uint64_t>(this)) {}
         auto get_max_write_layer(Range const &range) {
             int64_t layer = -1;
-            for (auto &&r : views) {
-                if (r.first.collide(range)) {
-                    layer = std::max<int64_t>(layer, r.second.write_layer);
-                    if (layer >= max_view.write_layer) {
-                        return layer;
-                    }
-                }
-            }
+            max_layer<&ResourceView::write_layer>(root, range, layer);
             return layer;
         }
         auto get_max_read_layer(Range const &range) {
             int64_t layer = -1;
-            for (auto &&r : views) {
-                if (r.first.collide(range)) {
-                    layer = std::max<int64_t>(layer, r.second.read_layer);
-                    if (layer >= max_view.read_layer) {
-                        return layer;
-                    }
-                }
-            }
+            max_layer<&ResourceView::read_layer>(root, range, layer);
             return layer;
         }
         void emplace_read_layer(Range const &range, int64_t layer) {
-            auto ite = views.try_emplace(range);
-            auto &read_layer = ite.first.value().read_layer;
-            if (ite.second) {
-                read_layer = layer;
-            } else {
-                read_layer = std::max<int64_t>(read_layer, layer);
-            }
-            max_view.read_layer = std::max(read_layer, max_view.read_layer);
+            root = emplace(root, range, [&](ResourceView &view) {
+                view.read_layer = std::max<int64_t>(view.read_layer, layer);
+            });
         }
         void emplace_write_layer(Range const &range, int64_t layer) {
-            auto ite = views.try_emplace(range);
-            auto &read_layer = ite.first.value().read_layer;
-            auto &write_layer = ite.first.value().write_layer;
-            if (ite.second) {
-                read_layer = layer;
-                write_layer = layer;
-            } else {
-                read_layer = std::max<int64_t>(read_layer, layer);
-                write_layer = std::max<int64_t>(write_layer, layer);
-            }
-            max_view.read_layer = std::max(read_layer, max_view.read_layer);
-            max_view.write_layer = std::max(write_layer, max_view.write_layer);
+            root = emplace(root, range, [&](ResourceView &view) {
+                view.read_layer = std::max<int64_t>(view.read_layer, layer);
+                view.write_layer = std::max<int64_t>(view.write_layer, layer);
+            });
         }
     };
     struct NoRangeHandle : public ResourceHandle {
         ResourceView view;
     };
+    struct WrittenLink {
+        uint64_t handle;
+        WrittenLink const *p_next;
+    };
     struct BindlessHandle : public ResourceHandle {
         ResourceView view;
+        // the contents are recorded in the reverse index
+        bool indexed;
+        // contents written in this command list
+        WrittenLink const *written;
+    };
+    struct BindlessLink {
+        BindlessHandle *bindless;
+        BindlessLink const *p_next;
     };
 
 private:
@@ -174,6 +224,8 @@ private:
     vstd::ArenaHashMap<ArenaRef, uint64_t, NoRangeHandle *> _no_range_resmap;
     vstd::ArenaHashMap<ArenaRef, uint64_t, BindlessHandle *> _bindless_map;
     vstd::ArenaHashMap<ArenaRef, uint64_t> _write_res_map;
+    // resource -> bindless arrays referencing it, built from the arrays used in this command list
+    vstd::ArenaHashMap<ArenaRef, uint64_t, BindlessLink const *> _bindless_index;
     int64_t _bindless_max_layer = -1;
     int64_t _max_mesh_level = -1;
     int64_t _max_accel_read_level = -1;
@@ -230,12 +282,10 @@ private:
     int64_t get_last_layer_write(RangeHandle *handle, Range range) {
         int64_t layer = handle->get_max_read_layer(range);
         if (_bindless_max_layer >= layer) {
-            for (auto &&i : _bindless_map) {
-                _func_table.lock_bindless(i.first);
-                if (_func_table.is_res_in_bindless(i.first, handle->handle)) {
-                    layer = std::max<int64_t>(layer, i.second->view.read_layer);
+            if (auto links = _bindless_index.find(handle->handle)) {
+                for (auto i = links.value(); i != nullptr; i = i->p_next) {
+                    layer = std::max<int64_t>(layer, i->bindless->view.read_layer);
                 }
-                _func_table.unlock_bindless(i.first);
             }
         }
         return layer + 1;
@@ -276,6 +326,58 @@ private:
     int64_t get_last_layer_read(BindlessHandle *handle) {
         return handle->view.write_layer + 1;
     }
+    void add_written(BindlessHandle *handle, uint64_t res) {
+        auto link = _arena.allocate_memory<WrittenLink, false>();
+        link->handle = res;
+        link->p_next = handle->written;
+        handle->written = link;
+    }
+    void mark_written(uint64_t res) {
+        if (!_write_res_map.try_emplace(res).second) return;
+        if (auto links = _bindless_index.find(res)) {
+            for (auto i = links.value(); i != nullptr; i = i->p_next) {
+                add_written(i->bindless, res);
+            }
+        }
+    }
+    void index_bindless(BindlessHandle *handle) {
+        if (handle->indexed) return;
+        handle->indexed = true;
+        _func_table.lock_bindless(handle->handle);
+        auto unlocker = vstd::scope_exit([&] {
+            _func_table.unlock_bindless(handle->handle);
+        });
+        _func_table.traverse_bindless(handle->handle, [&](uint64_t res) noexcept {
+            auto &links = _bindless_index.try_emplace(res, nullptr).first.value();
+            for (auto i = links; i != nullptr; i = i->p_next) {
+                if (i->bindless == handle) return;
+            }
+            auto link = _arena.allocate_memory<BindlessLink, false>();
+            link->bindless = handle;
+            link->p_next = links;
+            links = link;
+            if (_write_res_map.find(res)) {
+                add_written(handle, res);
+            }
+        });
+    }
+    void add_dispatch_bindless(uint64_t handle) {
+        _use_bindless_in_pass = true;
+        auto h = static_cast<BindlessHandle *>(get_handle(handle, ResourceType::Bindless));
+        index_bindless(h);
+        for (auto i = h->written; i != nullptr; i = i->p_next) {
+            add_dispatch_handle(
+                i->handle,
+                ResourceType::Texture_Buffer,
+                Range{},
+                false);
+        }
+        add_dispatch_handle(
+            handle,
+            ResourceType::Bindless,
+            Range(),
+            false);
+    }
     void add_command(Command const *cmd, int64_t layer) {
         if (_cmd_lists.size() <= layer) {
             _cmd_lists.resize(layer + 1);
@@ -356,7 +458,7 @@ private:
             default: {
                 auto handle = static_cast<RangeHandle *>(dst_handle);
                 handle->emplace_write_layer(range, layer);
-                _write_res_map.emplace(dst_handle->handle);
+                mark_written(dst_handle->handle);
             } break;
         }
     }
@@ -381,7 +483,7 @@ private:
                 auto handle = static_cast<RangeHandle *>(dst_handle);
                 layer = get_last_layer_write(handle, range);
                 handle->emplace_write_layer(range, layer);
-                _write_res_map.emplace(dst_handle->handle);
+                mark_written(dst_handle->handle);
             } break;
         }
 
@@ -443,7 +545,7 @@ private:
                 auto handle = static_cast<RangeHandle *>(dst_handle);
                 layer = std::max<int64_t>(layer, get_last_layer_write(handle, write_range));
                 handle->emplace_write_layer(write_range, layer);
-                _write_res_map.emplace(write_handle);
+                mark_written(write_handle);
             } break;
         }
         // set_read_layer
@@ -574,27 +676,7 @@ private:
                             ((uint)usage & (uint)Usage::WRITE) != 0);
 
                     } else if constexpr (std::is_same_v<T, Argument::BindlessArray>) {
-                        _use_bindless_in_pass = true;
-                        {
-                            _func_table.lock_bindless(t.handle);
-                            auto unlocker = vstd::scope_exit([&] {
-                                _func_table.unlock_bindless(t.handle);
-                            });
-                            for (auto &&res : _write_res_map) {
-                                if (_func_table.is_res_in_bindless(t.handle, res)) {
-                                    add_dispatch_handle(
-                                        res,
-                                        ResourceType::Texture_Buffer,
-                                        Range{},
-                                        false);
-                                }
-                            }
-                        }
-                        add_dispatch_handle(
-                            t.handle,
-                            ResourceType::Bindless,
-                            Range(),
-                            false);
+                        add_dispatch_bindless(t.handle);
                     } else {
                         _use_accel_in_pass = true;
                         add_dispatch_handle(
@@ -657,28 +739,7 @@ private:
                     ++arg_idx;
                 } break;
                 case Tag::BINDLESS_ARRAY: {
-                    auto &&arr = i.bindless_array;
-                    _use_bindless_in_pass = true;
-                    {
-                        _func_table.lock_bindless(arr.handle);
-                        auto unlocker = vstd::scope_exit([&] {
-                            _func_table.unlock_bindless(arr.handle);
-                        });
-                        for (auto &&res : _write_res_map) {
-                            if (_func_table.is_res_in_bindless(arr.handle, res)) {
-                                add_dispatch_handle(
-                                    res,
-                                    ResourceType::Texture_Buffer,
-                                    Range{},
-                                    false);
-                            }
-                        }
-                    }
-                    add_dispatch_handle(
-                        arr.handle,
-                        ResourceType::Bindless,
-                        Range(),
-                        false);
+                    add_dispatch_bindless(i.bindless_array.handle);
                     ++arg_idx;
                 } break;
                 case Tag::ACCEL: {
@@ -724,6 +785,7 @@ public:
           _no_range_resmap(64, ArenaRef{_arena}),
           _bindless_map(64, ArenaRef{_arena}),
           _write_res_map(64, ArenaRef{_arena}),
+          _bindless_index(64, ArenaRef{_arena}),
           _func_table(std::forward<FuncTable>(func_table)) {
     }
     void clear() noexcept {
@@ -741,6 +803,7 @@ public:
         re_construct_map(_no_range_resmap);
         re_construct_map(_bindless_map);
         re_construct_map(_write_res_map);
+        re_construct_map(_bindless_index);
     }
     ~CommandReorderVisitor() noexcept {}
     [[nodiscard]] auto command_lists() const noexcept {
@@ -831,11 +894,17 @@ public:
     void visit(const ClearDepthCommand *command) noexcept {
         add_command(command, set_write(command->handle(), Range{}, ResourceType::Texture_Buffer));
     }
+    void visit(const GenerateMipmapsCommand *command) noexcept {
+        add_command(command, set_write(command->handle(), copy_range(0, command->level_count()), ResourceType::Texture_Buffer));
+    }
 
     // BindlessArray : read multi resources
     void visit(const BindlessArrayUpdateCommand *command) noexcept override {
         _func_table.update_bindless(command->handle(), command->modifications());
-        add_command(command, set_write(command->handle(), Range(), ResourceType::Bindless));
+        auto handle = static_cast<BindlessHandle *>(get_handle(command->handle(), ResourceType::Bindless));
+        // index the new contents on the next use, stale entries only add dependencies
+        handle->indexed = false;
+        add_command(command, set_write(handle, Range()));
     }
 
     // Accel : conclude meshes and their buffer
@@ -878,6 +947,9 @@ public:
             case to_underlying(CustomCommandUUID::CUSTOM_DISPATCH):
                 visit(static_cast<CustomDispatchCommand const *>(command));
                 break;
+            case to_underlying(CustomCommandUUID::MIPMAP_GENERATE):
+                visit(static_cast<GenerateMipmapsCommand const *>(command));
+                break;
             default:
                 LUISA_ERROR("Custom command not supported by reorder.");
         }
@@ -0,0 +1,375 @@
+#include <bit>
+#include <cmath>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include <luisa/core/logging.h>
+#include <luisa/core/mathematics.h>
+#include <luisa/runtime/buffer.h>
+#include <luisa/runtime/stream.h>
+#include "rust_device_common.h"
+#include "rust_denoiser.h"
+
+namespace luisa::compute::rust {
+
+namespace detail {
+
+// weights of the 3x3 a-trous kernel along each axis
+constexpr std::array denoise_kernel{.25f, .5f, .25f};
+// differences of luminance are measured in this many standard deviations of the noise
+constexpr auto luminance_sigma = 4.f;
+// squared differences of albedo are scaled by this, i.e. they stop at about 0.1
+constexpr auto albedo_sharpness = 100.f;
+// colors are divided by albedos no darker than this, so that black surfaces keep their noise
+constexpr auto min_albedo = 1e-2f;
+// weight of the new frame in temporal mode, where the flow is trusted
+constexpr auto temporal_alpha = .2f;
+
+[[nodiscard]] inline bool is_valid(const Buffer<float> *buffer) noexcept {
+    return buffer != nullptr && *buffer;
+}
+
+[[nodiscard]] inline float *host_data(const Buffer<float> &buffer) noexcept {
+    return reinterpret_cast<float *>(reinterpret_cast<const RustBufferLayout *>(buffer.handle())->data);
+}
+
+[[nodiscard]] inline uint channels_of(const Buffer<float> &buffer, size_t pixel_count) noexcept {
+    return static_cast<uint>(buffer.size_bytes() / (sizeof(float) * pixel_count));
+}
+
+[[nodiscard]] inline float4 load_pixel(const float *data, uint channels, size_t i) noexcept {
+    auto p = data + i * channels;
+    return make_float4(p[0], channels > 1u ? p[1] : 0.f, channels > 2u ? p[2] : 0.f, channels > 3u ? p[3] : 1.f);
+}
+
+// the filter works on scalars, as the vector types would keep the loops from being vectorized
+[[nodiscard]] inline float luminance(float r, float g, float b) noexcept {
+    return .2126f * r + .7152f * g + .0722f * b;
+}
+
+// runs f(x, y) for each pixel, in tiles on the pool
+template<typename F>
+void for_each_pixel(ThreadPool &pool, uint2 resolution, F &&f) noexcept {
+    constexpr auto t = RustDenoiserExt::tile_size;
+    auto tiles = (resolution + t - 1u) / t;
+    parallel_for(pool, tiles.x * tiles.y, [&](size_t tile) noexcept {
+        auto x0 = static_cast<uint>(tile % tiles.x) * t;
+        auto y0 = static_cast<uint>(tile / tiles.x) * t;
+        auto x1 = std::min(x0 + t, resolution.x);
+        auto y1 = std::min(y0 + t, resolution.y);
+        for (auto y = y0; y < y1; y++) {
+            for (auto x = x0; x < x1; x++) { f(x, y); }
+        }
+    });
+}
+
+// e^-x for x >= 0 (and 0 for NaNs) to about 1e-5, written so that loops over it are
+// vectorized: x is clamped on its bits, where non-negative floats (and NaNs) order as
+// integers, and x / -ln2 is split into 2^i * 2^f with i rounded by the float adder
+[[nodiscard]] inline float exp_neg(float x) noexcept {
+    constexpr auto max_x = 87.f;// e^-87 is about the smallest normal float
+    constexpr auto round_bias = 12582912.f;// 1.5 * 2^23
+    x = std::bit_cast<float>(std::min(std::bit_cast<int32_t>(x), std::bit_cast<int32_t>(max_x)));
+    auto t = -1.442695041f * x;
+    auto rounded = t + round_bias;
+    auto f = t - (rounded - round_bias);
+    auto p = 1.f + f * (.6931472f + f * (.2402265f + f * (.05550411f + f * (.009618129f + f * .001333355f))));
+    auto i = std::bit_cast<int32_t>(rounded) - std::bit_cast<int32_t>(round_bias);
+    return std::bit_cast<float>((i + 127) << 23) * p;
+}
+
+// cos^128 of the angle between unit normals, and 0 for opposite ones (clamped on the bits
+// like in exp_neg); zero normals (e.g. of the background) only match each other
+[[nodiscard]] inline float normal_weight(float ax, float ay, float az, float bx, float by, float bz) noexcept {
+    auto w = ax * bx + ay * by + az * bz + (1.f - ax * ax - ay * ay - az * az) * (1.f - bx * bx - by * by - bz * bz);
+    w = std::bit_cast<float>(std::max(std::bit_cast<int32_t>(w), 0));
+    for (auto i = 0u; i < 7u; i++) { w *= w; }
+    return w;
+}
+
+// One pass of the a-trous filter on the planes (red, green, blue, variance of the
+// luminance) of a signal, with taps step pixels apart. Each row of a tile is
+// accumulated tap by tap, so that the innermost loops run over consecutive floats
+// without bounds checks. The guides are planes (x, y, z) as well.
+template<bool has_normals, bool has_albedos>
+void atrous_pass(ThreadPool &pool, uint2 resolution, int step, const float *normals, const float *albedos,
+                 const float *in, float *out) noexcept {
+    constexpr auto t = static_cast<int>(RustDenoiserExt::tile_size);
+    auto width = static_cast<int>(resolution.x);
+    auto height = static_cast<int>(resolution.y);
+    auto n = static_cast<size_t>(width) * height;
+    auto tiles_x = (width + t - 1) / t;
+    auto tiles_y = (height + t - 1) / t;
+    parallel_for(pool, tiles_x * tiles_y, [&](size_t tile) noexcept {
+        auto x0 = static_cast<int>(tile % tiles_x) * t;
+        auto y0 = static_cast<int>(tile / tiles_x) * t;
+        auto x1 = std::min(x0 + t, width);
+        auto y1 = std::min(y0 + t, height);
+        std::array<float, t> sum_r, sum_g, sum_b, sum_variance, total, center, inv_sigma;
+        for (auto y = y0; y < y1; y++) {
+            auto row = static_cast<size_t>(y) * width;
+            for (auto x = x0; x < x1; x++) {
+                auto i = row + x;
+                center[x - x0] = luminance(in[i], in[n + i], in[2u * n + i]);
+                inv_sigma[x - x0] = 1.f / (luminance_sigma * std::sqrt(std::max(in[3u * n + i], 0.f)) + 1e-6f);
+                sum_r[x - x0] = sum_g[x - x0] = sum_b[x - x0] = sum_variance[x - x0] = total[x - x0] = 0.f;
+            }
+            for (auto dy = -1; dy <= 1; dy++) {
+                auto qy = y + dy * step;
+                if (qy < 0 || qy >= height) { continue; }
+                for (auto dx = -1; dx <= 1; dx++) {
+                    // the pixels of the row whose tap falls inside the image
+                    auto begin = std::max(x0, -dx * step);
+                    auto end = std::min(x1, width - dx * step);
+                    auto tap = static_cast<ptrdiff_t>(qy) * width + dx * step;
+                    auto kernel = denoise_kernel[dx + 1] * denoise_kernel[dy + 1];
+                    for (auto x = begin; x < end; x++) {
+                        auto i = row + x;
+                        auto j = tap + x;
+                        auto r = in[j];
+                        auto g = in[n + j];
+                        auto b = in[2u * n + j];
+                        auto e = std::abs(luminance(r, g, b) - center[x - x0]) * inv_sigma[x - x0];
+                        if constexpr (has_albedos) {
+                            auto dr = albedos[j] - albedos[i];
+                            auto dg = albedos[n + j] - albedos[n + i];
+                            auto db = albedos[2u * n + j] - albedos[2u * n + i];
+                            e += (dr * dr + dg * dg + db * db) * albedo_sharpness;
+                        }
+                        auto w = kernel * exp_neg(e);
+                        if constexpr (has_normals) {
+                            w *= normal_weight(normals[i], normals[n + i], normals[2u * n + i],
+                                               normals[j], normals[n + j], normals[2u * n + j]);
+                        }
+                        sum_r[x - x0] += w * r;
+                        sum_g[x - x0] += w * g;
+                        sum_b[x - x0] += w * b;
+                        sum_variance[x - x0] += w * w * in[3u * n + j];
+                        total[x - x0] += w;
+                    }
+                }
+            }
+            // the center always contributes, so the total is positive
+            for (auto x = x0; x < x1; x++) {
+                auto i = row + x;
+                auto inv_total = 1.f / total[x - x0];
+                out[i] = sum_r[x - x0] * inv_total;
+                out[n + i] = sum_g[x - x0] * inv_total;
+                out[2u * n + i] = sum_b[x - x0] * inv_total;
+                out[3u * n + i] = sum_variance[x - x0] * inv_total * inv_total;
+            }
+        }
+    });
+}
+
+}// namespace detail
+
+RustDenoiserExt::RustDenoiserExt(DeviceInterface *device) noexcept
+    : _device{device} {}
+
+void RustDenoiserExt::_filter(Layer &layer, const Buffer<float> &input, const float *flow, uint flow_channels,
+                              const float *trust, uint trust_channels) noexcept {
+    auto resolution = _resolution;
+    auto width = resolution.x;
+    auto height = resolution.y;
+    auto n = static_cast<size_t>(width) * height;
+    auto data = detail::host_data(input);
+    auto normals = _normals.empty() ? nullptr : _normals.data();
+    auto albedos = _albedos.empty() ? nullptr : _albedos.data();
+    auto albedo = [albedos, n](size_t i) noexcept {
+        return max(make_float3(albedos[i], albedos[n + i], albedos[2u * n + i]), detail::min_albedo);
+    };
+    _history.resize(n);
+    _signal.resize(4u * n);
+    _filtered.resize(4u * n);
+
+    // accumulate over time and divide by the albedo
+    auto temporal = _mode.temporal && layer.has_history;
+    auto signal = _signal.data();
+    detail::for_each_pixel(_pool, resolution, [&](uint x, uint y) noexcept {
+        auto i = static_cast<size_t>(y) * width + x;
+        auto color = detail::load_pixel(data, layer.channels, i);
+        if (temporal) {
+            auto motion = flow == nullptr ? make_float2(0.f) :
+                                            make_float2(flow[i * flow_channels], flow[i * flow_channels + 1u]);
+            auto qx = std::lround(static_cast<float>(x) - motion.x);
+            auto qy = std::lround(static_cast<float>(y) - motion.y);
+            if (qx >= 0 && qx < width && qy >= 0 && qy < height) {
+                auto t = trust == nullptr ? 1.f : std::clamp(trust[i * trust_channels], 0.f, 1.f);
+                auto alpha = 1.f - (1.f - detail::temporal_alpha) * t;
+                auto previous = layer.history[static_cast<size_t>(qy) * width + qx];
+                color = make_float4(lerp(previous.xyz(), color.xyz(), alpha), color.w);
+            }
+        }
+        _history[i] = color;
+        auto c = albedos == nullptr ? color.xyz() : color.xyz() / albedo(i);
+        signal[i] = c.x;
+        signal[n + i] = c.y;
+        signal[2u * n + i] = c.z;
+    });
+    if (_mode.temporal) {
+        std::swap(layer.history, _history);
+        layer.has_history = true;
+    }
+
+    // estimate the variance of the luminance from the 3x3 neighborhood
+    detail::for_each_pixel(_pool, resolution, [&](uint x, uint y) noexcept {
+        auto sum = 0.f;
+        auto sum_sq = 0.f;
+        auto count = 0.f;
+        for (auto qy = y == 0u ? 0u : y - 1u; qy <= std::min(y + 1u, height - 1u); qy++) {
+            for (auto qx = x == 0u ? 0u : x - 1u; qx <= std::min(x + 1u, width - 1u); qx++) {
+                auto j = static_cast<size_t>(qy) * width + qx;
+                auto l = detail::luminance(signal[j], signal[n + j], signal[2u * n + j]);
+                sum += l;
+                sum_sq += l * l;
+                count += 1.f;
+            }
+        }
+        auto mean = sum / count;
+        signal[3u * n + static_cast<size_t>(y) * width + x] = std::max(sum_sq / count - mean * mean, 0.f);
+    });
+
+    // filter with the dilation doubling each pass
+    auto atrous = normals == nullptr ?
+                      (albedos == nullptr ? detail::atrous_pass<false, false> : detail::atrous_pass<false, true>) :
+                      (albedos == nullptr ? detail::atrous_pass<true, false> : detail::atrous_pass<true, true>);
+    auto source = &_signal;
+    auto target = &_filtered;
+    for (auto pass = 0u; pass < filter_passes; pass++) {
+        atrous(_pool, resolution, 1 << pass, normals, albedos, source->data(), target->data());
+        std::swap(source, target);
+    }
+
+    // multiply back by the albedo, pass the alpha through and upscale bilinearly if asked to
+    auto result = source->data();
+    auto texel = [&](size_t i) noexcept {
+        auto c = make_float3(result[i], result[n + i], result[2u * n + i]);
+        if (albedos != nullptr) { c *= albedo(i); }
+        return make_float4(c, layer.channels > 3u ? data[i * 4u + 3u] : 1.f);
+    };
+    auto scale = _mode.upscale ? 2u : 1u;
+    auto output_resolution = resolution * scale;
+    layer.output.resize(static_cast<size_t>(output_resolution.x) * output_resolution.y * layer.channels);
+    detail::for_each_pixel(_pool, output_resolution, [&](uint x, uint y) noexcept {
+        float4 color;
+        if (scale == 1u) {
+            color = texel(static_cast<size_t>(y) * width + x);
+        } else {
+            auto p = (make_float2(static_cast<float>(x), static_cast<float>(y)) + .5f) / static_cast<float>(scale) - .5f;
+            auto p0 = clamp(make_int2(static_cast<int>(std::floor(p.x)), static_cast<int>(std::floor(p.y))),
+                            make_int2(0), make_int2(resolution) - 1);
+            auto p1 = min(p0 + 1, make_int2(resolution) - 1);
+            auto f = clamp(p - make_float2(p0), 0.f, 1.f);
+            auto at = [&](int px, int py) noexcept { return texel(static_cast<size_t>(py) * width + px); };
+            color = lerp(lerp(at(p0.x, p0.y), at(p1.x, p0.y), f.x),
+                         lerp(at(p0.x, p1.y), at(p1.x, p1.y), f.x), f.y);
+        }
+        auto o = (static_cast<size_t>(y) * output_resolution.x + x) * layer.channels;
+        for (auto c = 0u; c < layer.channels; c++) { layer.output[o + c] = color[c]; }
+    });
+}
+
+void RustDenoiserExt::init(Stream &stream, DenoiserMode mode, DenoiserInput data, uint2 resolution) noexcept {
+    LUISA_ASSERT(detail::is_valid(data.beauty), "input image(beauty) is invalid!");
+    _mode = mode;
+    _resolution = resolution;
+    _guides = data;
+    _layers.clear();
+    auto pixel_count = static_cast<size_t>(resolution.x) * resolution.y;
+    auto add_layer = [&](const Buffer<float> &buffer) noexcept {
+        auto channels = detail::channels_of(buffer, pixel_count);
+        LUISA_ASSERT(channels == 3u || channels == 4u,
+                     "Denoised layers must have 3 or 4 channels, got {}.", channels);
+        _layers.emplace_back(Layer{channels, false, {}, {}});
+    };
+    add_layer(*data.beauty);
+    for (auto i = 0u; i < data.aov_size; i++) { add_layer(*data.aovs[i]); }
+}
+
+void RustDenoiserExt::process(Stream &stream, DenoiserInput input) noexcept {
+    LUISA_ASSERT(detail::is_valid(input.beauty), "input image(beauty) is invalid!");
+    LUISA_ASSERT(input.aov_size < _layers.size(), "Denoiser was initialized with {} AOVs, got {}.",
+                 _layers.size() - 1u, input.aov_size);
+    // the guides given to init are kept unless replaced
+    if (input.normal != nullptr) { _guides.normal = input.normal; }
+    if (input.albedo != nullptr) { _guides.albedo = input.albedo; }
+    if (input.flow != nullptr) { _guides.flow = input.flow; }
+    if (input.flowtrust != nullptr) { _guides.flowtrust = input.flowtrust; }
+    // the inputs are read in place
+    _device->synchronize_stream(stream.handle());
+    auto pixel_count = static_cast<size_t>(_resolution.x) * _resolution.y;
+    auto load_guide = [&](const Buffer<float> *buffer, luisa::vector<float> &guide, bool normalized) noexcept {
+        if (!detail::is_valid(buffer)) {
+            guide.clear();
+            return;
+        }
+        auto channels = detail::channels_of(*buffer, pixel_count);
+        auto data = detail::host_data(*buffer);
+        guide.resize(3u * pixel_count);
+        detail::for_each_pixel(_pool, _resolution, [&](uint x, uint y) noexcept {
+            auto i = static_cast<size_t>(y) * _resolution.x + x;
+            auto v = detail::load_pixel(data, channels, i).xyz();
+            if (normalized) {
+                auto l = length(v);
+                v = l > 0.f ? v / l : make_float3(0.f);
+            }
+            guide[i] = v.x;
+            guide[pixel_count + i] = v.y;
+            guide[2u * pixel_count + i] = v.z;
+        });
+    };
+    load_guide(_guides.normal, _normals, true);
+    load_guide(_guides.albedo, _albedos, false);
+    auto flow = detail::is_valid(_guides.flow) ? detail::host_data(*_guides.flow) : nullptr;
+    auto flow_channels = flow == nullptr ? 0u : detail::channels_of(*_guides.flow, pixel_count);
+    auto trust = detail::is_valid(_guides.flowtrust) ? detail::host_data(*_guides.flowtrust) : nullptr;
+    auto trust_channels = trust == nullptr ? 0u : detail::channels_of(*_guides.flowtrust, pixel_count);
+    _filter(_layers[0], *input.beauty, flow, flow_channels, trust, trust_channels);
+    for (auto i = 0u; i < input.aov_size; i++) {
+        _filter(_layers[i + 1u], *input.aovs[i], flow, flow_channels, trust, trust_channels);
+    }
+}
+
+void RustDenoiserExt::get_result(Stream &stream, Buffer<float> &output, int index) noexcept {
+    LUISA_ASSERT(index >= -1 && index + 1 < static_cast<int>(_layers.size()),
+                 "Invalid denoised layer {}.", index);
+    auto &&layer = _layers[index + 1];
+    auto size = layer.output.size() * sizeof(float);
+    if (output.size_bytes() != size) {
+        LUISA_WARNING_WITH_LOCATION("Denoised layer of {} bytes is copied to a buffer of {} bytes.",
+                                    size, output.size_bytes());
+    }
+    // earlier commands may still use the output
+    _device->synchronize_stream(stream.handle());
+    std::memcpy(detail::host_data(output), layer.output.data(), std::min(size, output.size_bytes()));
+}
+
+void RustDenoiserExt::destroy(Stream &stream) noexcept {
+    _guides = {};
+    _layers = {};
+    _normals = {};
+    _albedos = {};
+    _history = {};
+    _signal = {};
+    _filtered = {};
+}
+
+void RustDenoiserExt::denoise(Stream &stream, uint2 resolution, Buffer<float> const &image, Buffer<float> &output,
+                              Buffer<float> const &normal, Buffer<float> const &albedo, Buffer<float> **aovs, uint aov_size) noexcept {
+    DenoiserInput data{};
+    data.beauty = &image;
+    data.normal = &normal;
+    data.albedo = &albedo;
+    data.aovs = aovs;
+    data.aov_size = aov_size;
+    init(stream, DenoiserMode{}, data, resolution);
+    process(stream, data);
+    get_result(stream, output, -1);
+    destroy(stream);
+}
+
+}// namespace luisa::compute::rust
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <luisa/core/stl/vector.h>
+#include <luisa/core/thread_pool.h>
+#include <luisa/runtime/rhi/device_interface.h>
+#include <luisa/backends/ext/denoiser_ext.h>
+
+namespace luisa::compute::rust {
+
+// Denoising on the host for the CPU backend, after SVGF. The buffers are read in
+// place once the stream has drained. Colors are divided by the albedo (when given)
+// and, in temporal mode, blended with their history reprojected along the flow.
+// A few passes of an edge-avoiding a-trous wavelet filter follow, with the dilation
+// doubling each pass. Its weights stop at changes of luminance, relative to the
+// local variance, of normal and of albedo. Each pass runs over tiles of the image
+// on a thread pool, on planes of the channels that the compiler vectorizes. AOVs are
+// filtered with the same guides as the beauty; upscaling is bilinear.
+class RustDenoiserExt final : public DenoiserExt {
+
+public:
+    static constexpr auto tile_size = 64u;
+    static constexpr auto filter_passes = 5u;
+
+private:
+    struct Layer {
+        uint channels;
+        bool has_history;
+        luisa::vector<float4> history;
+        luisa::vector<float> output;
+    };
+
+private:
+    DeviceInterface *_device;
+    ThreadPool _pool;
+    uint2 _resolution{};
+    DenoiserInput _guides{};
+    luisa::vector<Layer> _layers;
+    // guides and scratch of the filter, shared by the layers; the guides
+    // and the signals are stored as planes of their channels
+    luisa::vector<float> _normals;
+    luisa::vector<float> _albedos;
+    luisa::vector<float4> _history;
+    luisa::vector<float> _signal;
+    luisa::vector<float> _filtered;
+
+private:
+    void _filter(Layer &layer, const Buffer<float> &input, const float *flow, uint flow_channels,
+                 const float *trust, uint trust_channels) noexcept;
+
+public:
+    explicit RustDenoiserExt(DeviceInterface *device) noexcept;
+    void denoise(Stream &stream, uint2 resolution, Buffer<float> const &image, Buffer<float> &output,
+                 Buffer<float> const &normal, Buffer<float> const &albedo, Buffer<float> **aovs, uint aov_size) noexcept override;
+    void init(Stream &stream, DenoiserMode mode, DenoiserInput data, uint2 resolution) noexcept override;
+    void process(Stream &stream, DenoiserInput input) noexcept override;
+    void get_result(Stream &stream, Buffer<float> &output, int index) noexcept override;
+    void destroy(Stream &stream) noexcept override;
+};
+
+}// namespace luisa::compute::rust
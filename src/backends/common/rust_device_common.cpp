@@ -8,58 +8,138 @@ using luisa::compute::ir::KernelModule;
 using luisa::compute::ir::Type;
 }// namespace luisa::compute::backend
 
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/stl/deque.h>
 #include <luisa/core/dynamic_module.h>
 #include <luisa/core/logging.h>
+#include <luisa/core/spin_mutex.h>
 #include <luisa/runtime/context.h>
 #include <luisa/runtime/rtx/triangle.h>
 #include <luisa/ir/ast2ir.h>
 #include <luisa/ir/transform.h>
 #include <luisa/runtime/rtx/aabb.h>
+#include <luisa/backends/ext/mipmap_cmd.h>
+#include <luisa/backends/ext/command_graph_ext.h>
 #include "rust_device_common.h"
+#include "rust_dstorage.h"
+#include "rust_raster.h"
+#include "rust_mipmap.h"
+#include "rust_tex_compress.h"
+#include "rust_denoiser.h"
+#include "rust_shared_swapchain.h"
 
 // must go last to avoid name conflicts
 #include <luisa/runtime/rhi/resource.h>
+#include <luisa/backends/ext/pinned_memory_ext.hpp>
+#include <luisa/backends/ext/cpu_config_ext.h>
 
 namespace luisa::compute::rust {
 
-class APICommandConverter final : public CommandVisitor {
+// Storage of converted command lists. Buffers go back to the pool once the backend
+// has executed their list (or once their command graph is destroyed), so
+// steady-state dispatches do not allocate.
+class APICommandBufferPool {
 
 public:
     class CommandBuffer {
 
     private:
-        luisa::vector<void *> _temp;
+        APICommandBufferPool *_pool;
+        luisa::vector<luisa::vector<std::byte>> _chunks;
+        size_t _chunk{0u};
+        size_t _offset{0u};
         luisa::vector<api::Command> _api_commands;
         CommandList::CallbackContainer _callbacks;
 
     public:
-        CommandBuffer(luisa::vector<void *> temp,
-                      luisa::vector<api::Command> api_commands,
-                      CommandList::CallbackContainer callbacks) noexcept
-            : _temp{std::move(temp)},
-              _api_commands{std::move(api_commands)},
-              _callbacks{std::move(callbacks)} {}
-
+        explicit CommandBuffer(APICommandBufferPool *pool) noexcept : _pool{pool} {}
+        // zero-initialized storage that lives until the list completes
+        template<typename T>
+        [[nodiscard]] T *allocate(size_t n) noexcept {
+            static_assert(std::is_trivially_destructible_v<T> && alignof(T) <= 16u);
+            auto size = luisa::align(sizeof(T) * n, 16u);
+            while (_chunk < _chunks.size() && _offset + size > _chunks[_chunk].size()) {
+                _chunk++;
+                _offset = 0u;
+            }
+            if (_chunk == _chunks.size()) {
+                auto last = _chunks.empty() ? 0u : _chunks.back().size();
+                _chunks.emplace_back(std::max<size_t>({size, last * 2u, 4096u}));
+            }
+            auto p = _chunks[_chunk].data() + _offset;
+            _offset += size;
+            memset(p, 0, size);
+            return reinterpret_cast<T *>(p);
+        }
+        [[nodiscard]] auto &api_commands() noexcept { return _api_commands; }
+        void set_callbacks(CommandList::CallbackContainer callbacks) noexcept {
+            _callbacks = std::move(callbacks);
+        }
         void on_completion() noexcept {
             for (auto &&callback : _callbacks) { callback(); }
-            for (auto p : _temp) {
-                luisa::deallocate_with_allocator(
-                    static_cast<std::byte *>(p));
+            _callbacks.clear();
+            recycle();
+        }
+        void recycle() noexcept {
+            _api_commands.clear();
+            // merge the chunks so that the next list of the same size fits into one
+            if (_chunks.size() > 1u) {
+                auto total = static_cast<size_t>(0u);
+                for (auto &&c : _chunks) { total += c.size(); }
+                _chunks.clear();
+                _chunks.emplace_back(total);
             }
+            _chunk = 0u;
+            _offset = 0u;
+            _pool->recycle(this);
         }
     };
 
 private:
-    luisa::vector<void *> _temp;// TODO: maybe it's more efficient to pool the allocations?
-    luisa::vector<api::Command> _converted;
+    spin_mutex _mutex;
+    luisa::vector<luisa::unique_ptr<CommandBuffer>> _free;
+
+public:
+    [[nodiscard]] luisa::unique_ptr<CommandBuffer> acquire() noexcept {
+        {
+            std::scoped_lock lock{_mutex};
+            if (!_free.empty()) {
+                auto buffer = std::move(_free.back());
+                _free.pop_back();
+                return buffer;
+            }
+        }
+        return luisa::make_unique<CommandBuffer>(this);
+    }
+    void recycle(CommandBuffer *buffer) noexcept {
+        std::scoped_lock lock{_mutex};
+        _free.emplace_back(buffer);
+    }
+};
+
+class APICommandConverter final : public CommandVisitor {
+
+public:
+    using CommandBuffer = APICommandBufferPool::CommandBuffer;
+
+private:
+    APICommandBufferPool &_pool;
+    luisa::unique_ptr<CommandBuffer> _buffer;
 
 private:
     template<typename T>
     [[nodiscard]] auto _create_temporary(size_t n) noexcept {
-        auto ptr = luisa::allocate_with_allocator<T>(n);
-        memset(ptr, 0, sizeof(T) * n);
-        _temp.emplace_back(ptr);
-        return ptr;
+        return _buffer->allocate<T>(n);
+    }
+    void _emplace(const api::Command &converted) noexcept {
+        _buffer->api_commands().emplace_back(converted);
     }
 
     using Tag = api::Command::Tag;
@@ -75,32 +155,108 @@ private:
                    api::AccelBuildRequest::FORCE_BUILD;
     }
 
-public:
-    void dispatch(api::DeviceInterface device, api::Stream stream,
-                  CommandList &&list) noexcept {
+    // arguments followed by the uniforms, each aligned to 16 bytes
+    [[nodiscard]] static size_t _argument_buffer_size(const ShaderDispatchCommand *command) noexcept {
+        static_assert(sizeof(api::Argument) >= 16u);
+        auto size = sizeof(api::Argument) * command->arguments().size();
+        for (auto &&arg : command->arguments()) {
+            if (arg.tag == Argument::Tag::UNIFORM) {
+                size += luisa::align(arg.uniform.size, 16u);
+            }
+        }
+        return size;
+    }
 
-        LUISA_ASSERT(_temp.empty(), "Temporary buffer leak.");
-        LUISA_ASSERT(_converted.empty(), "Command buffer leak.");
+    static void _convert_arguments(const ShaderDispatchCommand *command, api::Argument *args) noexcept {
+        auto n = command->arguments().size();
+        auto uniforms = reinterpret_cast<std::byte *>(args + n);
+        auto uniform_offset = static_cast<size_t>(0u);
+        for (size_t i = 0; i < n; i++) {
+            auto &&arg = command->arguments()[i];
+            switch (arg.tag) {
+                case Argument::Tag::BUFFER: {
+                    args[i].tag = api::Argument::Tag::BUFFER;
+                    args[i].BUFFER._0 = api::BufferArgument{
+                        .buffer = {arg.buffer.handle},
+                        .offset = arg.buffer.offset,
+                        .size = arg.buffer.size};
+                    break;
+                }
+                case Argument::Tag::TEXTURE: {
+                    args[i].tag = api::Argument::Tag::TEXTURE;
+                    args[i].TEXTURE._0 = api::TextureArgument{
+                        .texture = {arg.texture.handle},
+                        .level = arg.texture.level};
+                    break;
+                }
+                case Argument::Tag::UNIFORM: {
+                    auto data = command->uniform(arg.uniform);
+                    auto u = uniforms + uniform_offset;
+                    uniform_offset += luisa::align(data.size_bytes(), 16u);
+                    memcpy(u, data.data(), data.size_bytes());
+                    args[i].tag = api::Argument::Tag::UNIFORM;
+                    args[i].UNIFORM._0 = api::UniformArgument{
+                        .data = reinterpret_cast<const uint8_t *>(u),
+                        .size = data.size_bytes()};
+                    break;
+                }
+                case Argument::Tag::BINDLESS_ARRAY: {
+                    args[i].tag = api::Argument::Tag::BINDLESS_ARRAY;
+                    args[i].BINDLESS_ARRAY._0 = {arg.bindless_array.handle};
+                    break;
+                }
+                case Argument::Tag::ACCEL: {
+                    args[i].tag = api::Argument::Tag::ACCEL;
+                    args[i].ACCEL._0 = {arg.accel.handle};
+                    break;
+                }
+                default: LUISA_ERROR_WITH_LOCATION(
+                    "Unsupported shader argument type.");
+            }
+        }
+    }
 
-        _converted.reserve(list.commands().size());
-        for (auto &&cmd : list.commands()) { cmd->accept(*this); }
-        LUISA_ASSERT(_converted.size() == list.commands().size(),
+public:
+    explicit APICommandConverter(APICommandBufferPool &pool) noexcept : _pool{pool} {}
+    [[nodiscard]] luisa::unique_ptr<CommandBuffer> convert(
+        luisa::span<const luisa::unique_ptr<Command>> commands) noexcept {
+        _buffer = _pool.acquire();
+        auto &&converted = _buffer->api_commands();
+        converted.reserve(commands.size());
+        for (auto &&cmd : commands) { cmd->accept(*this); }
+        LUISA_ASSERT(converted.size() == commands.size(),
                      "Command list size mismatch.");
-
+        return std::move(_buffer);
+    }
+    void dispatch(api::DeviceInterface device, api::Stream stream,
+                  CommandList &&list) noexcept {
+        auto buffer = convert(list.commands());
+        auto &&converted = buffer->api_commands();
         api::CommandList converted_list{
-            .commands = _converted.data(),
-            .commands_count = _converted.size(),
+            .commands = converted.data(),
+            .commands_count = converted.size(),
         };
-        auto ctx = luisa::new_with_allocator<CommandBuffer>(
-            std::move(_temp), std::move(_converted), list.steal_callbacks());
+        buffer->set_callbacks(list.steal_callbacks());
         device.dispatch(
             device.device, stream, converted_list,
             [](uint8_t *ctx) noexcept {
-                auto cb = reinterpret_cast<CommandBuffer *>(ctx);
-                cb->on_completion();
-                luisa::delete_with_allocator(cb);
+                reinterpret_cast<CommandBuffer *>(ctx)->on_completion();
             },
-            reinterpret_cast<uint8_t *>(ctx));
+            reinterpret_cast<uint8_t *>(buffer.release()));
+    }
+    // converts a patched shader dispatch again into the storage of its converted form,
+    // which has the same layout as the dispatch differs only in argument values
+    static void patch(api::Command &converted, const ShaderDispatchCommand *command) noexcept {
+        LUISA_ASSERT(!command->is_indirect() && !command->is_multiple_dispatch(),
+                     "Indirect dispatch is not supported.");
+        LUISA_ASSERT(converted.tag == Tag::SHADER_DISPATCH &&
+                         converted.SHADER_DISPATCH._0.args_count == command->arguments().size(),
+                     "Patched command does not match its converted form.");
+        auto &&dispatch = converted.SHADER_DISPATCH._0;
+        _convert_arguments(command, const_cast<api::Argument *>(dispatch.args));
+        dispatch.dispatch_size = {command->dispatch_size().x,
+                                  command->dispatch_size().y,
+                                  command->dispatch_size().z};
     }
     void visit(const BufferUploadCommand *command) noexcept override {
         api::Command converted{.tag = Tag::BUFFER_UPLOAD};
@@ -109,7 +265,7 @@ public:
             .offset = command->offset(),
             .size = command->size(),
             .data = static_cast<const uint8_t *>(command->data())};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const BufferDownloadCommand *command) noexcept override {
         api::Command converted{.tag = Tag::BUFFER_DOWNLOAD};
@@ -118,7 +274,7 @@ public:
             .offset = command->offset(),
             .size = command->size(),
             .data = static_cast<uint8_t *>(command->data())};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const BufferCopyCommand *command) noexcept override {
         api::Command converted{.tag = Tag::BUFFER_COPY};
@@ -128,7 +284,7 @@ public:
             .dst = {command->dst_handle()},
             .dst_offset = command->dst_offset(),
             .size = command->size()};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const BufferToTextureCopyCommand *command) noexcept override {
         api::Command converted{.tag = Tag::BUFFER_TO_TEXTURE_COPY};
@@ -141,66 +297,15 @@ public:
             .texture_size = {command->size().x,
                              command->size().y,
                              command->size().z}};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const ShaderDispatchCommand *command) noexcept override {
         LUISA_ASSERT(!command->is_indirect(),
                      "Indirect dispatch is not supported.");
         auto n = command->arguments().size();
-        auto arg_buffer_size = sizeof(api::Argument) * n;
-        static_assert(sizeof(api::Argument) >= 16u);
-        for (auto &&arg : command->arguments()) {
-            if (arg.tag == Argument::Tag::UNIFORM) {
-                arg_buffer_size += luisa::align(arg.uniform.size, 16u);
-            }
-        }
-        auto temp = _create_temporary<std::byte>(arg_buffer_size);
-        auto args = reinterpret_cast<api::Argument *>(temp);
-        auto uniforms = reinterpret_cast<std::byte *>(args + n);
-        auto uniform_offset = static_cast<size_t>(0u);
-        for (size_t i = 0; i < n; i++) {
-            auto &&arg = command->arguments()[i];
-            switch (arg.tag) {
-                case Argument::Tag::BUFFER: {
-                    args[i].tag = api::Argument::Tag::BUFFER;
-                    args[i].BUFFER._0 = api::BufferArgument{
-                        .buffer = {arg.buffer.handle},
-                        .offset = arg.buffer.offset,
-                        .size = arg.buffer.size};
-                    break;
-                }
-                case Argument::Tag::TEXTURE: {
-                    args[i].tag = api::Argument::Tag::TEXTURE;
-                    args[i].TEXTURE._0 = api::TextureArgument{
-                        .texture = {arg.texture.handle},
-                        .level = arg.texture.level};
-                    break;
-                }
-                case Argument::Tag::UNIFORM: {
-                    auto data = command->uniform(arg.uniform);
-                    auto u = uniforms + uniform_offset;
-                    uniform_offset += luisa::align(data.size_bytes(), 16u);
-                    memcpy(u, data.data(), data.size_bytes());
-                    args[i].tag = api::Argument::Tag::UNIFORM;
-                    args[i].UNIFORM._0 = api::UniformArgument{
-                        .data = reinterpret_cast<const uint8_t *>(u),
-                        .size = data.size_bytes()};
-                    break;
-                }
-                case Argument::Tag::BINDLESS_ARRAY: {
-                    args[i].tag = api::Argument::Tag::BINDLESS_ARRAY;
-                    args[i].BINDLESS_ARRAY._0 = {arg.bindless_array.handle};
-                    break;
-                }
-                case Argument::Tag::ACCEL: {
-                    args[i].tag = api::Argument::Tag::ACCEL;
-                    args[i].ACCEL._0 = {arg.accel.handle};
-                    break;
-                }
-                default: LUISA_ERROR_WITH_LOCATION(
-                    "Unsupported shader argument type.");
-            }
-        }
+        auto args = reinterpret_cast<api::Argument *>(
+            _create_temporary<std::byte>(_argument_buffer_size(command)));
+        _convert_arguments(command, args);
         api::Command converted{.tag = Tag::SHADER_DISPATCH};
         converted.SHADER_DISPATCH._0 = api::ShaderDispatchCommand{
             .shader = {command->handle()},
@@ -209,7 +314,7 @@ public:
                               command->dispatch_size().z},
             .args = args,
             .args_count = n};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const TextureUploadCommand *command) noexcept override {
         api::Command converted{.tag = Tag::TEXTURE_UPLOAD};
@@ -221,7 +326,7 @@ public:
                      command->size().y,
                      command->size().z},
             .data = static_cast<const uint8_t *>(command->data())};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const TextureDownloadCommand *command) noexcept override {
         api::Command converted{.tag = Tag::TEXTURE_DOWNLOAD};
@@ -233,7 +338,7 @@ public:
                      command->size().y,
                      command->size().z},
             .data = static_cast<uint8_t *>(command->data())};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const TextureCopyCommand *command) noexcept override {
         api::Command converted{.tag = Tag::TEXTURE_COPY};
@@ -246,7 +351,7 @@ public:
                      command->size().z},
             .src_level = command->src_level(),
             .dst_level = command->dst_level()};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const TextureToBufferCopyCommand *command) noexcept override {
         api::Command converted{.tag = Tag::TEXTURE_TO_BUFFER_COPY};
@@ -259,7 +364,7 @@ public:
             .texture_size = {command->size().x,
                              command->size().y,
                              command->size().z}};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const AccelBuildCommand *command) noexcept override {
         auto n = command->modifications().size();
@@ -298,7 +403,7 @@ public:
             .modifications = m,
             .modifications_count = n,
             .update_instance_buffer_only = command->update_instance_buffer_only()};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const MeshBuildCommand *command) noexcept override {
         api::Command converted{.tag = Tag::MESH_BUILD};
@@ -313,7 +418,7 @@ public:
             .index_buffer_offset = command->triangle_buffer_offset(),
             .index_buffer_size = command->triangle_buffer_size(),
             .index_stride = sizeof(Triangle)};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const ProceduralPrimitiveBuildCommand *command) noexcept override {
         api::Command converted{.tag = Tag::PROCEDURAL_PRIMITIVE_BUILD};
@@ -323,7 +428,7 @@ public:
             .aabb_buffer = {command->aabb_buffer()},
             .aabb_buffer_offset = command->aabb_buffer_offset(),
             .aabb_count = command->aabb_buffer_size() / sizeof(AABB)};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const BindlessArrayUpdateCommand *command) noexcept override {
         auto n = command->modifications().size();
@@ -375,15 +480,195 @@ public:
             .handle = {command->handle()},
             .modifications = m,
             .modifications_count = n};
-        _converted.emplace_back(converted);
+        _emplace(converted);
     }
     void visit(const CustomCommand *command) noexcept override {
         LUISA_ERROR_WITH_LOCATION("Not implemented.");
     }
 };
 
+// Command graphs keep their converted command list and hand the same storage to
+// the backend on every dispatch. Patched dispatches are converted again in place
+// when no replay is in flight; otherwise the whole list is converted into new
+// storage, which the graph uses from then on.
+class RustCommandGraphExt final : public CommandGraphExt {
+
+private:
+    using CommandBuffer = APICommandBufferPool::CommandBuffer;
+    // shared by the graph and its replays in flight
+    using Recording = luisa::shared_ptr<CommandBuffer>;
+
+    APICommandBufferPool &_pool;
+    api::DeviceInterface _device;
+
+private:
+    [[nodiscard]] Recording _record(luisa::span<const luisa::unique_ptr<Command>> commands) noexcept {
+        for (auto &&cmd : commands) {
+            LUISA_ASSERT(cmd->tag() != Command::Tag::ECustomCommand,
+                         "Custom commands cannot be recorded into command graphs.");
+        }
+        auto buffer = APICommandConverter{_pool}.convert(commands);
+        return Recording{buffer.release(), [](CommandBuffer *b) noexcept { b->recycle(); }};
+    }
+
+public:
+    RustCommandGraphExt(APICommandBufferPool &pool, api::DeviceInterface device) noexcept
+        : _pool{pool}, _device{device} {}
+    [[nodiscard]] uint64_t create_command_graph(
+        luisa::span<const luisa::unique_ptr<Command>> commands) noexcept override {
+        auto recording = luisa::new_with_allocator<Recording>(_record(commands));
+        return reinterpret_cast<uint64_t>(recording);
+    }
+    void update_command_graph(uint64_t handle, luisa::span<const luisa::unique_ptr<Command>> commands,
+                              luisa::span<const size_t> dirty_indices) noexcept override {
+        auto &&recording = *reinterpret_cast<Recording *>(handle);
+        LUISA_ASSERT(recording->api_commands().size() == commands.size(),
+                     "Command graph size mismatch.");
+        // replays only ever release their references, so a unique recording stays unique
+        if (recording.use_count() != 1) {
+            recording = _record(commands);
+            return;
+        }
+        for (auto i : dirty_indices) {
+            LUISA_ASSERT(commands[i]->tag() == Command::Tag::EShaderDispatchCommand,
+                         "Only shader dispatches can be patched in command graphs.");
+            APICommandConverter::patch(recording->api_commands()[i],
+                                       static_cast<const ShaderDispatchCommand *>(commands[i].get()));
+        }
+    }
+    void destroy_command_graph(uint64_t handle) noexcept override {
+        luisa::delete_with_allocator(reinterpret_cast<Recording *>(handle));
+    }
+    void dispatch_command_graph(uint64_t stream_handle, uint64_t handle) noexcept override {
+        LUISA_ASSERT(RustDStorageExt::stream(stream_handle) == nullptr,
+                     "Command graphs cannot be dispatched to DStorage streams.");
+        auto replay = luisa::new_with_allocator<Recording>(*reinterpret_cast<Recording *>(handle));
+        auto &&converted = (*replay)->api_commands();
+        api::CommandList converted_list{
+            .commands = converted.data(),
+            .commands_count = converted.size(),
+        };
+        _device.dispatch(
+            _device.device, api::Stream{stream_handle}, converted_list,
+            [](uint8_t *ctx) noexcept {
+                luisa::delete_with_allocator(reinterpret_cast<Recording *>(ctx));
+            },
+            reinterpret_cast<uint8_t *>(replay));
+    }
+};
+
+// On the CPU backend device memory is host memory, so pinning simply
+// wraps the user allocation in a buffer without copying.
+class RustPinnedMemoryExt final : public PinnedMemoryExt {
+
+public:
+    using ImportHostBuffer = api::CreatedBufferInfo(api::Device, const void *, size_t, void *);
+
+private:
+    DeviceInterface *_device;
+    api::Device _api_device;
+    ImportHostBuffer *_import;
+
+protected:
+    [[nodiscard]] BufferCreationInfo _pin_host_memory(
+        const Type *elem_type, size_t elem_count,
+        void *host_ptr, const PinnedMemoryOption &option) noexcept override {
+        if (option.write_combined) {
+            LUISA_WARNING_WITH_LOCATION(
+                "Write-combined memory is not supported "
+                "on the CPU backend. Ignored.");
+        }
+        auto type = AST2IR::build_type(elem_type);
+        auto buffer = _import(_api_device, &type, elem_count, host_ptr);
+        BufferCreationInfo info{};
+        info.element_stride = buffer.element_stride;
+        info.total_size_bytes = buffer.total_size_bytes;
+        info.handle = buffer.resource.handle;
+        info.native_handle = buffer.resource.native_handle;
+        return info;
+    }
+
+    [[nodiscard]] BufferCreationInfo _allocate_pinned_memory(
+        const Type *elem_type, size_t elem_count,
+        const PinnedMemoryOption &option) noexcept override {
+        // ordinary buffers are already host-accessible
+        return _device->create_buffer(elem_type, elem_count);
+    }
+
+public:
+    RustPinnedMemoryExt(DeviceInterface *device, api::Device api_device, ImportHostBuffer *import) noexcept
+        : _device{device}, _api_device{api_device}, _import{import} {}
+    [[nodiscard]] DeviceInterface *device() const noexcept override { return _device; }
+};
+
+// Sparse resources of the CPU backend, mirrors cpu/sparse.rs
+struct RustSparseUpdate {
+    enum struct Kind : uint32_t {
+        BUFFER_MAP,
+        BUFFER_UNMAP,
+        TEXTURE_MAP,
+        TEXTURE_UNMAP,
+    };
+    uint64_t resource;
+    uint64_t heap;
+    Kind kind;
+    uint32_t mip_level;
+    std::array<uint32_t, 3> start_tile;
+    std::array<uint32_t, 3> tile_count;
+};
+
+struct RustSparseResourceInfo {
+    api::CreatedResourceInfo resource;
+    size_t element_stride;
+    size_t total_size_bytes;
+    size_t tile_size_bytes;
+    std::array<uint32_t, 3> tile_size;
+};
+
+struct RustSparseResourceInterface {
+    RustSparseResourceInfo (*create_buffer)(api::Device, const void *, size_t);
+    void (*destroy_buffer)(api::Device, uint64_t);
+    RustSparseResourceInfo (*create_texture)(api::Device, api::PixelFormat, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+    void (*destroy_texture)(api::Device, uint64_t);
+    api::CreatedResourceInfo (*allocate_heap)(api::Device, size_t);
+    void (*deallocate_heap)(api::Device, uint64_t);
+    void (*update)(api::Device, api::Stream, const RustSparseUpdate *, size_t);
+};
+
+// the backend reads its configuration as a JSON object, see CpuDeviceConfig in cpu/memory.rs
+[[nodiscard]] static luisa::string cpu_device_config_json(const DeviceConfig *config) noexcept {
+    if (config == nullptr || config->extension == nullptr) { return {}; }
+    auto ext = dynamic_cast<const CpuDeviceConfigExt *>(config->extension.get());
+    if (ext == nullptr) {
+        LUISA_WARNING_WITH_LOCATION("Ignoring unknown device config extension for the CPU backend.");
+        return {};
+    }
+    auto huge_pages = [ext] {
+        switch (ext->huge_pages) {
+            case CpuDeviceConfigExt::HugePages::TRANSPARENT: return "transparent";
+            case CpuDeviceConfigExt::HugePages::EXPLICIT: return "explicit";
+            default: break;
+        }
+        return "none";
+    }();
+    return luisa::format(
+        R"({{"huge_pages":"{}","first_touch":{},"numa_pinned_workers":{},"shader_profile":{}}})",
+        huge_pages, ext->first_touch, ext->numa_pinned_workers, ext->shader_profile);
+}
+
+// shader creation profiles are opt-in, the backend applies the same rule in cpu/mod.rs
+[[nodiscard]] static bool shader_profile_enabled(const DeviceConfig *config) noexcept {
+    if (auto env = std::getenv("LUISA_SHADER_PROFILE")) {
+        if (luisa::string_view{env} == "1") { return true; }
+    }
+    auto ext = config == nullptr ? nullptr : dynamic_cast<const CpuDeviceConfigExt *>(config->extension.get());
+    return ext != nullptr && ext->shader_profile;
+}
+
 // @Mike-Leo-Smith: fill-in the blanks pls
 class RustDevice final : public DeviceInterface {
+    // outlives the device, whose streams return buffers to it
+    APICommandBufferPool command_buffer_pool;
     api::DeviceInterface device{};
     api::LibInterface lib{};
     luisa::filesystem::path runtime_path;
@@ -393,20 +678,107 @@ class RustDevice final : public DeviceInterface {
 
     api::Context api_ctx{};
 
+    luisa::unique_ptr<RustPinnedMemoryExt> pinned_memory_ext;
+    luisa::unique_ptr<RustDStorageExt> dstorage_ext;
+    luisa::unique_ptr<RustRasterExt> raster_ext;
+    luisa::unique_ptr<RustMipmapGenerator> mipmap_generator;
+    luisa::unique_ptr<RustTexCompressExt> tex_compress_ext;
+    luisa::unique_ptr<RustDenoiserExt> denoiser_ext;
+    luisa::unique_ptr<RustSharedSwapchains> shared_swapchains;
+    luisa::unique_ptr<RustCommandGraphExt> command_graph_ext;
+    RustSparseResourceInterface sparse{};
+    // shared by all autodiff kernels of the device, so that their callables are cached
+    luisa::unique_ptr<IRTransformPipeline> ir_transforms{IRTransformPipeline::create_auto()};
+
+    // frontend stages of shader creation (AST -> IR, IR transforms), merged with the
+    // backend stages reported by the Rust side into a single Chrome trace; only the
+    // most recent stages are kept
+    static constexpr size_t max_frontend_stages = 1024u;
+    struct FrontendStage {
+        luisa::string name;
+        uint64_t kernel_hash;
+        uint64_t thread;
+        double start_us;
+        double duration_us;
+    };
+    bool shader_profile{false};
+    std::mutex frontend_profile_mutex;
+    luisa::deque<FrontendStage> frontend_profile;
+
+    template<typename F>
+    auto profile_stage(luisa::string_view name, uint64_t kernel_hash, F &&f) noexcept {
+        if (!shader_profile) { return std::forward<F>(f)(); }
+        using namespace std::chrono;
+        auto start = duration<double, std::micro>{system_clock::now().time_since_epoch()}.count();
+        Clock clock;
+        auto record = [&] {
+            FrontendStage stage{.name = luisa::string{name},
+                                .kernel_hash = kernel_hash,
+                                .thread = std::hash<std::thread::id>{}(std::this_thread::get_id()) & 0xffffffffu,
+                                .start_us = start,
+                                .duration_us = clock.toc() * 1e3};
+            LUISA_VERBOSE("Shader {:016x} {}: {} ms.", kernel_hash, name, stage.duration_us * 1e-3);
+            std::scoped_lock lock{frontend_profile_mutex};
+            if (frontend_profile.size() == max_frontend_stages) { frontend_profile.pop_front(); }
+            frontend_profile.emplace_back(std::move(stage));
+        };
+        if constexpr (std::is_void_v<std::invoke_result_t<F>>) {
+            std::forward<F>(f)();
+            record();
+        } else {
+            auto ret = std::forward<F>(f)();
+            record();
+            return ret;
+        }
+    }
+
+    [[nodiscard]] luisa::string backend_query(const char *property) noexcept {
+        auto result = device.query(device.device, property);
+        if (result == nullptr) { return {}; }
+        luisa::string s{result};
+        lib.free_string(result);
+        return s;
+    }
+
+    [[nodiscard]] luisa::string shader_profile_trace() noexcept {
+        luisa::string events;
+        {
+            std::scoped_lock lock{frontend_profile_mutex};
+            for (auto &&stage : frontend_profile) {
+                if (!events.empty()) { events.append(","); }
+                events.append(luisa::format(
+                    R"({{"name":"{}","cat":"frontend","ph":"X","ts":{:.3f},"dur":{:.3f},"pid":0,"tid":{},"args":{{"kernel":"{:016x}"}}}})",
+                    stage.name, stage.start_us, stage.duration_us, stage.thread, stage.kernel_hash));
+            }
+        }
+        // the backend returns a JSON array of events
+        auto backend_events = backend_query("shader_profile_events");
+        if (backend_events.size() > 2u) {
+            if (!events.empty()) { events.append(","); }
+            events.append(luisa::string_view{backend_events}.substr(1u, backend_events.size() - 2u));
+        }
+        return luisa::format(R"({{"traceEvents":[{}],"displayTimeUnit":"ms"}})", events);
+    }
+
 public:
     ~RustDevice() noexcept override {
+        // the rasterizer owns shaders and buffers of the device
+        raster_ext = nullptr;
         device.destroy_device(device);
         lib.destroy_context(api_ctx);
     }
 
-    RustDevice(Context &&ctx, luisa::filesystem::path runtime_path, string_view name) noexcept
+    RustDevice(Context &&ctx, luisa::filesystem::path runtime_path,
+               string_view name, const DeviceConfig *config) noexcept
         : DeviceInterface(std::move(ctx)),
-          runtime_path(std::move(runtime_path)) {
+          runtime_path(std::move(runtime_path)),
+          shader_profile{shader_profile_enabled(config)} {
         dll = DynamicModule::load(this->runtime_path, "luisa_compute_backend_impl");
         luisa_compute_lib_interface = dll.function<api::LibInterface()>("luisa_compute_lib_interface");
         lib = luisa_compute_lib_interface();
         api_ctx = lib.create_context(this->runtime_path.generic_string().c_str());
-        device = lib.create_device(api_ctx, name.data(), nullptr);
+        auto config_json = cpu_device_config_json(config);
+        device = lib.create_device(api_ctx, name.data(), config_json.c_str());
         lib.set_logger_callback([](api::LoggerMessage message) {
             luisa::string_view target(message.target);
             luisa::string_view level(message.level);
@@ -421,6 +793,36 @@ public:
                 LUISA_VERBOSE("[{}] {}", target, body);
             }
         });
+        command_graph_ext = luisa::make_unique<RustCommandGraphExt>(command_buffer_pool, device);
+        // the extensions below access resources through the memory of the CPU backend
+        // (see RustBufferLayout and RustTextureLayout), and the luisa_compute_cpu_* entry
+        // points expect its devices, so other backends of the library must not get them
+        if (name == "cpu") {
+            if (auto import = dll.address("luisa_compute_cpu_import_host_buffer")) {
+                pinned_memory_ext = luisa::make_unique<RustPinnedMemoryExt>(
+                    this, device.device,
+                    reinterpret_cast<RustPinnedMemoryExt::ImportHostBuffer *>(import));
+            }
+            if (auto sparse_interface = dll.address("luisa_compute_cpu_sparse_resource_interface")) {
+                sparse = reinterpret_cast<RustSparseResourceInterface (*)()>(sparse_interface)();
+            }
+            // DStorage reads write into buffers through their host pointers
+            dstorage_ext = luisa::make_unique<RustDStorageExt>(this);
+            // the rasterizer reads vertices and writes its scratch buffers through host pointers
+            raster_ext = luisa::make_unique<RustRasterExt>(this);
+            // mipmaps are filtered in place in the memory of the textures
+            mipmap_generator = luisa::make_unique<RustMipmapGenerator>();
+            // images are compressed on the host from their memory
+            tex_compress_ext = luisa::make_unique<RustTexCompressExt>(this);
+            // the denoiser reads its inputs and writes its outputs through host pointers
+            denoiser_ext = luisa::make_unique<RustDenoiserExt>(this);
+            // headless swapchains convert the presented images from their memory
+            if (auto ext = config == nullptr ? nullptr : dynamic_cast<const CpuDeviceConfigExt *>(config->extension.get());
+                ext != nullptr && !ext->shared_swapchain_name.empty()) {
+                shared_swapchains = luisa::make_unique<RustSharedSwapchains>(
+                    this, ext->shared_swapchain_name, ext->shared_swapchain_format);
+            }
+        }
     }
 
     void *native_handle() const noexcept override {
@@ -458,10 +860,14 @@ public:
         ResourceCreationInfo info{};
         info.handle = texture.handle;
         info.native_handle = texture.native_handle;
+        if (dstorage_ext != nullptr) { dstorage_ext->register_texture(info.handle, pixel_format_to_storage(format)); }
+        if (raster_ext != nullptr) { raster_ext->register_texture(info.handle, make_uint2(width, height)); }
         return info;
     }
 
     void destroy_texture(uint64_t handle) noexcept override {
+        if (dstorage_ext != nullptr) { dstorage_ext->unregister_texture(handle); }
+        if (raster_ext != nullptr) { raster_ext->unregister_texture(handle); }
         device.destroy_texture(device.device, api::Texture{handle});
     }
 
@@ -486,21 +892,52 @@ public:
     }
 
     void destroy_stream(uint64_t handle) noexcept override {
+        if (RustDStorageExt::stream(handle) != nullptr) {
+            RustDStorageExt::destroy_stream(handle);
+            return;
+        }
         device.destroy_stream(device.device, api::Stream{handle});
     }
 
     void synchronize_stream(uint64_t stream_handle) noexcept override {
+        if (auto s = RustDStorageExt::stream(stream_handle)) {
+            s->synchronize();
+            return;
+        }
         device.synchronize_stream(device.device, api::Stream{stream_handle});
     }
 
     void dispatch(uint64_t stream_handle, CommandList &&list) noexcept override {
-        APICommandConverter converter;
+        if (auto s = RustDStorageExt::stream(stream_handle)) {
+            s->dispatch(std::move(list));
+            return;
+        }
+        // raster and mipmap commands run on the host in order with the others
+        auto is_host_command = [this](const Command *command) noexcept {
+            return (raster_ext != nullptr && RustRasterExt::is_raster_command(command)) ||
+                   (mipmap_generator != nullptr && RustMipmapGenerator::is_mipmap_command(command));
+        };
+        if (std::any_of(list.commands().begin(), list.commands().end(),
+                        [&](auto &&cmd) noexcept { return is_host_command(cmd.get()); })) {
+            dispatch_host_commands(this, stream_handle, std::move(list), is_host_command, [&](const Command *command) noexcept {
+                if (RustMipmapGenerator::is_mipmap_command(command)) {
+                    mipmap_generator->generate(static_cast<const GenerateMipmapsCommand *>(command));
+                } else {
+                    raster_ext->execute(stream_handle, command);
+                }
+            });
+            return;
+        }
+        APICommandConverter converter{command_buffer_pool};
         converter.dispatch(device, api::Stream{stream_handle}, std::move(list));
     }
 
     SwapchainCreationInfo
     create_swapchain(uint64_t window_handle, uint64_t stream_handle, uint width, uint height, bool allow_hdr,
                      bool vsync, uint back_buffer_size) noexcept override {
+        if (shared_swapchains != nullptr) {
+            return shared_swapchains->create(width, height, allow_hdr, vsync, back_buffer_size);
+        }
         auto swapchain =
             device.create_swapchain(device.device, window_handle, api::Stream{stream_handle}, width, height,
                                     allow_hdr, vsync, back_buffer_size);
@@ -512,20 +949,29 @@ public:
     }
 
     void destroy_swap_chain(uint64_t handle) noexcept override {
+        if (shared_swapchains != nullptr) {
+            shared_swapchains->destroy(handle);
+            return;
+        }
         device.destroy_swapchain(device.device, api::Swapchain{handle});
     }
 
     void present_display_in_stream(uint64_t stream_handle, uint64_t swapchain_handle,
                                    uint64_t image_handle) noexcept override {
+        if (shared_swapchains != nullptr) {
+            shared_swapchains->present(stream_handle, swapchain_handle, image_handle);
+            return;
+        }
         device.present_display_in_stream(device.device, api::Stream{stream_handle},
                                          api::Swapchain{swapchain_handle}, api::Texture{image_handle});
     }
 
     ShaderCreationInfo create_shader(const ShaderOption &option, Function kernel) noexcept override {
-        auto shader = AST2IR::build_kernel(kernel);
+        auto hash = kernel.hash();
+        auto shader = profile_stage("ast2ir", hash, [&] { return AST2IR::build_kernel(kernel); });
         if (kernel.propagated_builtin_callables().test(CallOp::BACKWARD)) {
             shader->get()->module.flags |= ir::ModuleFlags_REQUIRES_REV_AD_TRANSFORM;
-            transform_ir_kernel_module_auto(shader->get());
+            profile_stage("ir_transform", hash, [&] { ir_transforms->transform(shader->get()); });
         }
         return create_shader(option, shader->get());
     }
@@ -573,10 +1019,18 @@ public:
     }
 
     void signal_event(uint64_t handle, uint64_t stream_handle, uint64_t value) noexcept override {
+        if (auto s = RustDStorageExt::stream(stream_handle)) {
+            s->signal(handle, value);
+            return;
+        }
         device.signal_event(device.device, api::Event{handle}, api::Stream{stream_handle}, value);
     }
 
     void wait_event(uint64_t handle, uint64_t stream_handle, uint64_t value) noexcept override {
+        if (auto s = RustDStorageExt::stream(stream_handle)) {
+            s->wait(handle, value);
+            return;
+        }
         device.wait_event(device.device, api::Event{handle}, api::Stream{stream_handle}, value);
     }
 
@@ -645,6 +1099,144 @@ public:
     void set_name(luisa::compute::Resource::Tag resource_tag, uint64_t resource_handle,
                   luisa::string_view name) noexcept override {
     }
+
+    SparseBufferCreationInfo create_sparse_buffer(const Type *element, size_t elem_count) noexcept override {
+        if (sparse.create_buffer == nullptr) { return DeviceInterface::create_sparse_buffer(element, elem_count); }
+        auto type = AST2IR::build_type(element);
+        auto buffer = sparse.create_buffer(device.device, &type, elem_count);
+        SparseBufferCreationInfo info{};
+        info.handle = buffer.resource.handle;
+        info.native_handle = buffer.resource.native_handle;
+        info.element_stride = buffer.element_stride;
+        info.total_size_bytes = buffer.total_size_bytes;
+        info.tile_size_bytes = buffer.tile_size_bytes;
+        return info;
+    }
+
+    void destroy_sparse_buffer(uint64_t handle) noexcept override {
+        if (sparse.destroy_buffer != nullptr) { sparse.destroy_buffer(device.device, handle); }
+    }
+
+    ResourceCreationInfo allocate_sparse_buffer_heap(size_t byte_size) noexcept override {
+        if (sparse.allocate_heap == nullptr) { return DeviceInterface::allocate_sparse_buffer_heap(byte_size); }
+        auto heap = sparse.allocate_heap(device.device, byte_size);
+        ResourceCreationInfo info{};
+        info.handle = heap.handle;
+        info.native_handle = heap.native_handle;
+        return info;
+    }
+
+    void deallocate_sparse_buffer_heap(uint64_t handle) noexcept override {
+        if (sparse.deallocate_heap != nullptr) { sparse.deallocate_heap(device.device, handle); }
+    }
+
+    ResourceCreationInfo allocate_sparse_texture_heap(size_t byte_size, bool is_compressed_type) noexcept override {
+        if (is_compressed_type) {
+            LUISA_WARNING_WITH_LOCATION("Block-compressed sparse textures are not supported on the CPU backend.");
+            return ResourceCreationInfo::make_invalid();
+        }
+        return allocate_sparse_buffer_heap(byte_size);
+    }
+
+    void deallocate_sparse_texture_heap(uint64_t handle) noexcept override {
+        deallocate_sparse_buffer_heap(handle);
+    }
+
+    SparseTextureCreationInfo create_sparse_texture(PixelFormat format, uint dimension,
+                                                    uint width, uint height, uint depth,
+                                                    uint mipmap_levels, bool simultaneous_access) noexcept override {
+        if (sparse.create_texture == nullptr) {
+            return DeviceInterface::create_sparse_texture(format, dimension, width, height, depth,
+                                                          mipmap_levels, simultaneous_access);
+        }
+        if (is_block_compressed(format)) {
+            LUISA_WARNING_WITH_LOCATION("Block-compressed sparse textures are not supported on the CPU backend.");
+            return SparseTextureCreationInfo::make_invalid();
+        }
+        auto texture = sparse.create_texture(device.device, (api::PixelFormat)format, dimension,
+                                             width, height, depth, mipmap_levels);
+        SparseTextureCreationInfo info{};
+        info.handle = texture.resource.handle;
+        info.native_handle = texture.resource.native_handle;
+        info.tile_size_bytes = texture.tile_size_bytes;
+        info.tile_size = make_uint3(texture.tile_size[0], texture.tile_size[1], texture.tile_size[2]);
+        if (dstorage_ext != nullptr) { dstorage_ext->register_texture(info.handle, pixel_format_to_storage(format)); }
+        if (raster_ext != nullptr) { raster_ext->register_texture(info.handle, make_uint2(width, height)); }
+        return info;
+    }
+
+    void destroy_sparse_texture(uint64_t handle) noexcept override {
+        if (dstorage_ext != nullptr) { dstorage_ext->unregister_texture(handle); }
+        if (raster_ext != nullptr) { raster_ext->unregister_texture(handle); }
+        if (sparse.destroy_texture != nullptr) { sparse.destroy_texture(device.device, handle); }
+    }
+
+    // the updates are applied on the stream in submission order
+    void update_sparse_resources(uint64_t stream_handle,
+                                 luisa::vector<SparseUpdateTile> &&update_tiles) noexcept override {
+        if (sparse.update == nullptr || update_tiles.empty()) { return; }
+        luisa::vector<RustSparseUpdate> updates;
+        updates.reserve(update_tiles.size());
+        for (auto &&tile : update_tiles) {
+            luisa::visit(
+                [&]<typename T>(const T &op) noexcept {
+                    RustSparseUpdate u{};
+                    u.resource = tile.handle;
+                    if constexpr (std::is_same_v<T, SparseBufferMapOperation>) {
+                        u.kind = RustSparseUpdate::Kind::BUFFER_MAP;
+                        u.heap = op.allocated_heap;
+                        u.start_tile = {op.start_tile, 0u, 0u};
+                        u.tile_count = {op.tile_count, 1u, 1u};
+                    } else if constexpr (std::is_same_v<T, SparseBufferUnMapOperation>) {
+                        u.kind = RustSparseUpdate::Kind::BUFFER_UNMAP;
+                        u.start_tile = {op.start_tile, 0u, 0u};
+                        u.tile_count = {op.tile_count, 1u, 1u};
+                    } else {
+                        if constexpr (std::is_same_v<T, SparseTextureMapOperation>) {
+                            u.kind = RustSparseUpdate::Kind::TEXTURE_MAP;
+                            u.heap = op.allocated_heap;
+                        } else {
+                            u.kind = RustSparseUpdate::Kind::TEXTURE_UNMAP;
+                        }
+                        u.mip_level = op.mip_level;
+                        u.start_tile = {op.start_tile.x, op.start_tile.y, op.start_tile.z};
+                        u.tile_count = {op.tile_count.x, op.tile_count.y, op.tile_count.z};
+                    }
+                    updates.emplace_back(u);
+                },
+                tile.operations);
+        }
+        sparse.update(device.device, api::Stream{stream_handle}, updates.data(), updates.size());
+    }
+
+    DeviceExtension *extension(luisa::string_view name) noexcept override {
+        if (name == PinnedMemoryExt::name) { return pinned_memory_ext.get(); }
+        if (name == DStorageExt::name) { return dstorage_ext.get(); }
+        if (name == RasterExt::name) { return raster_ext.get(); }
+        if (name == TexCompressExt::name) { return tex_compress_ext.get(); }
+        if (name == DenoiserExt::name) { return denoiser_ext.get(); }
+        if (name == CommandGraphExt::name) { return command_graph_ext.get(); }
+        if (name == MipmapExt::name) { return mipmap_generator.get(); }
+        return nullptr;
+    }
+
+    // Shader creation profiling (enabled by CpuDeviceConfigExt::shader_profile or LUISA_SHADER_PROFILE=1):
+    //   "shader_profile"       -> JSON summary (accumulated stage times, compilations, IR node count, source size, cache hits) per shader
+    //   "shader_profile_trace" -> Chrome trace JSON of the frontend and backend stages
+    //   "shader_profile_reset" -> clears all recorded profiles
+    // Sparse resources (CPU backend):
+    //   "sparse_memory"        -> JSON with the reserved, heap and mapped bytes of sparse resources
+    // Timeline events (CPU backend):
+    //   "event_latency"        -> JSON with signal-to-wake latency counters of host and stream waits
+    //   "event_latency_reset"  -> clears the counters
+    luisa::string query(luisa::string_view property) noexcept override {
+        if (property == "shader_profile_trace") { return shader_profile_trace(); }
+        if (property == "shader_profile_reset") {
+            std::scoped_lock lock{frontend_profile_mutex};
+            frontend_profile.clear();
+        }
+        return backend_query(luisa::string{property}.c_str());
+    }
 };
 
 luisa::compute::DeviceInterface *create(luisa::compute::Context &&ctx,
@@ -652,7 +1244,7 @@ luisa::compute::DeviceInterface *create(luisa::compute::Context &&ctx,
                                         luisa::string_view name) noexcept {
     auto path = ctx.runtime_directory();
     return luisa::new_with_allocator<luisa::compute::rust::RustDevice>(
-        std::move(ctx), std::move(path), "cpu");
+        std::move(ctx), std::move(path), "cpu", config);
 }
 
 void destroy(luisa::compute::DeviceInterface *device) noexcept {
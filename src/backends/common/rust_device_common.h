@@ -1,10 +1,64 @@
 #pragma once
 
+#include <array>
+
+#include <luisa/core/thread_pool.h>
+#include <luisa/runtime/command_list.h>
 #include <luisa/runtime/rhi/device_interface.h>
 
 namespace luisa::compute::rust {
 
 luisa::compute::DeviceInterface *create(luisa::compute::Context &&ctx, const luisa::compute::DeviceConfig *config, luisa::string_view name) noexcept;
 void destroy(luisa::compute::DeviceInterface *device) noexcept;
-}// namespace luisa::compute::rust
 
+// mirrors the leading fields of BufferImpl in cpu/resource.rs
+struct RustBufferLayout {
+    std::byte *data;
+    size_t size;
+};
+
+// mirrors the leading fields of TextureImpl in cpu/texture.rs; each level is stored
+// as a row-major grid of 4x4 blocks of row-major texels
+struct RustTextureLayout {
+    static constexpr auto block_size = 4u;
+    std::byte *data;
+    size_t data_size;
+    std::array<uint, 3u> size;
+    uint8_t dimension;
+    size_t pixel_stride_shift;
+    uint8_t mip_levels;
+    std::array<size_t, 16u> mip_offsets;
+};
+
+// Runs the commands for which is_host(command) holds on the calling thread with
+// run(command), each once everything before it on the stream has finished, and
+// dispatches the others to the device in order. Callbacks go with the last segment.
+template<typename IsHost, typename Run>
+void dispatch_host_commands(DeviceInterface *device, uint64_t stream_handle, CommandList &&list,
+                            IsHost &&is_host, Run &&run) noexcept {
+    auto callbacks = list.steal_callbacks();
+    auto commands = list.steal_commands();
+    luisa::vector<luisa::unique_ptr<Command>> pending;
+    auto flush = [&] {
+        if (pending.empty()) { return; }
+        auto segment = CommandList::create(pending.size());
+        for (auto &&cmd : pending) { segment << std::move(cmd); }
+        pending.clear();
+        device->dispatch(stream_handle, segment.commit().command_list());
+    };
+    for (auto &&cmd : commands) {
+        if (!is_host(cmd.get())) {
+            pending.emplace_back(std::move(cmd));
+            continue;
+        }
+        flush();
+        device->synchronize_stream(stream_handle);
+        run(cmd.get());
+    }
+    auto tail = CommandList::create(pending.size(), callbacks.size());
+    for (auto &&cmd : pending) { tail << std::move(cmd); }
+    for (auto &&callback : callbacks) { tail.add_callback(std::move(callback)); }
+    if (!tail.empty()) { device->dispatch(stream_handle, tail.commit().command_list()); }
+}
+
+}// namespace luisa::compute::rust
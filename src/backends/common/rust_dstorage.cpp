@@ -0,0 +1,896 @@
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#ifdef LUISA_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#define LUISA_RUST_DSTORAGE_IO_URING 1
+#endif
+
+#ifdef LUISA_COMPUTE_ENABLE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/magic_enum.h>
+#include <luisa/runtime/rhi/pixel.h>
+#include <luisa/backends/ext/dstorage_cmd.h>
+#include "rust_device_common.h"
+#include "rust_dstorage.h"
+
+namespace luisa::compute::rust {
+
+// Compressed sources follow the chunked layout of the Metal backend: a header,
+// one metadata entry per chunk, then the chunks. Chunks that do not shrink are
+// stored as-is, so the chunks can be decompressed independently and in parallel.
+struct RustCompressionChunkMetadata {
+    uint64_t is_compressed;
+    size_t file_offset;
+    size_t compressed_size;
+};
+
+struct RustCompressionFileHeader {
+
+    static constexpr auto rust_compression_magic = 0xc0dec0deu;
+    static constexpr auto default_chunk_size = static_cast<size_t>(64u * 1024u);
+    using ChunkMetadata = RustCompressionChunkMetadata;
+
+    uint magic;
+    DStorageCompression algorithm;
+    size_t size_bytes;
+    size_t chunk_size;
+    size_t chunk_count;
+    [[no_unique_address]] ChunkMetadata chunk_metadata[];
+};
+
+static_assert(sizeof(RustCompressionFileHeader) == 32u);
+
+struct RustDStorageFile {
+#ifdef LUISA_PLATFORM_WINDOWS
+    HANDLE handle;
+#else
+    int fd;
+#endif
+    size_t size_bytes;
+};
+
+struct RustDStoragePinnedMemory {
+    const std::byte *data;
+    size_t size_bytes;
+};
+
+struct RustFileRead {
+    const RustDStorageFile *file;
+    size_t offset;
+    std::byte *data;
+    size_t size;
+};
+
+class RustFileReader {
+public:
+    virtual ~RustFileReader() noexcept = default;
+    // blocks until all reads are completed
+    virtual void read(luisa::span<const RustFileRead> reads) noexcept = 0;
+    [[nodiscard]] static luisa::unique_ptr<RustFileReader> create(ThreadPool &pool) noexcept;
+};
+
+namespace detail {
+
+// large reads are split so that they are spread over the queue (or the threads)
+static constexpr auto dstorage_read_block_size = static_cast<size_t>(1024u * 1024u);
+
+void dstorage_split_reads(luisa::span<const RustFileRead> reads,
+                          luisa::vector<RustFileRead> &pieces) noexcept {
+    pieces.clear();
+    for (auto r : reads) {
+        for (auto offset = static_cast<size_t>(0u); offset < r.size; offset += dstorage_read_block_size) {
+            pieces.emplace_back(RustFileRead{
+                .file = r.file,
+                .offset = r.offset + offset,
+                .data = r.data + offset,
+                .size = std::min(dstorage_read_block_size, r.size - offset)});
+        }
+    }
+}
+
+void dstorage_read_file(RustFileRead r) noexcept {
+    while (r.size != 0u) {
+#ifdef LUISA_PLATFORM_WINDOWS
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(r.offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(r.offset >> 32u);
+        DWORD n = 0u;
+        auto size = static_cast<DWORD>(std::min<size_t>(r.size, 1u << 30u));
+        LUISA_ASSERT(ReadFile(r.file->handle, r.data, size, &n, &overlapped) && n != 0u,
+                     "Failed to read {} bytes at offset {}.", r.size, r.offset);
+#else
+        auto n = ::pread(r.file->fd, r.data, r.size, static_cast<off_t>(r.offset));
+        if (n < 0 && errno == EINTR) { continue; }
+        LUISA_ASSERT(n > 0, "Failed to read {} bytes at offset {}: {}.",
+                     r.size, r.offset, n == 0 ? "unexpected end of file" : std::strerror(errno));
+#endif
+        r.offset += n;
+        r.data += n;
+        r.size -= n;
+    }
+}
+
+// LZ4 block format, see https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+static constexpr auto lz4_hash_log = 12u;
+static constexpr auto lz4_min_match = static_cast<size_t>(4u);
+static constexpr auto lz4_last_literals = static_cast<size_t>(5u);
+static constexpr auto lz4_match_find_limit = static_cast<size_t>(12u);
+static constexpr auto lz4_max_offset = static_cast<size_t>(65535u);
+
+[[nodiscard]] inline auto lz4_read32(const std::byte *p) noexcept {
+    uint32_t x;
+    std::memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+[[nodiscard]] inline auto lz4_hash(uint32_t sequence) noexcept {
+    return (sequence * 2654435761u) >> (32u - lz4_hash_log);
+}
+
+inline void lz4_write_length(luisa::vector<std::byte> &out, size_t length) noexcept {
+    for (; length >= 255u; length -= 255u) { out.emplace_back(std::byte{255u}); }
+    out.emplace_back(static_cast<std::byte>(length));
+}
+
+// a match length of zero marks the last sequence, which only has literals
+inline void lz4_write_sequence(luisa::vector<std::byte> &out,
+                               const std::byte *literals, size_t literal_length,
+                               size_t offset, size_t match_length) noexcept {
+    auto token_index = out.size();
+    out.emplace_back();
+    auto token = std::min<size_t>(literal_length, 15u) << 4u;
+    if (literal_length >= 15u) { lz4_write_length(out, literal_length - 15u); }
+    out.insert(out.end(), literals, literals + literal_length);
+    if (match_length != 0u) {
+        out.emplace_back(static_cast<std::byte>(offset & 0xffu));
+        out.emplace_back(static_cast<std::byte>(offset >> 8u));
+        auto length = match_length - lz4_min_match;
+        token |= std::min<size_t>(length, 15u);
+        if (length >= 15u) { lz4_write_length(out, length - 15u); }
+    }
+    out[token_index] = static_cast<std::byte>(token);
+}
+
+// greedy single-probe matcher; smaller skip strengths skip ahead faster over incompressible data
+void lz4_compress(const std::byte *src, size_t size,
+                  luisa::vector<std::byte> &out, uint skip_strength) noexcept {
+    std::array<uint32_t, 1u << lz4_hash_log> table{};
+    auto anchor = static_cast<size_t>(0u);
+    if (size > lz4_match_find_limit) {
+        auto ip_limit = size - lz4_match_find_limit;
+        auto match_limit = size - lz4_last_literals;
+        for (auto ip = static_cast<size_t>(0u); ip < ip_limit;) {
+            auto sequence = lz4_read32(src + ip);
+            auto h = lz4_hash(sequence);
+            auto ref = static_cast<size_t>(table[h]);
+            table[h] = static_cast<uint32_t>(ip);
+            if (ref >= ip || ip - ref > lz4_max_offset || lz4_read32(src + ref) != sequence) {
+                ip += 1u + ((ip - anchor) >> skip_strength);
+                continue;
+            }
+            while (ip > anchor && ref > 0u && src[ip - 1u] == src[ref - 1u]) {
+                ip--;
+                ref--;
+            }
+            auto length = lz4_min_match;
+            while (ip + length < match_limit && src[ip + length] == src[ref + length]) { length++; }
+            lz4_write_sequence(out, src + anchor, ip - anchor, ip - ref, length);
+            ip += length;
+            anchor = ip;
+            table[lz4_hash(lz4_read32(src + ip - 2u))] = static_cast<uint32_t>(ip - 2u);
+        }
+    }
+    lz4_write_sequence(out, src + anchor, size - anchor, 0u, 0u);
+}
+
+// returns the decompressed size, or zero if the input is malformed
+[[nodiscard]] size_t lz4_decompress(const std::byte *src, size_t size,
+                                    std::byte *dst, size_t capacity) noexcept {
+    auto ip = static_cast<size_t>(0u);
+    auto op = static_cast<size_t>(0u);
+    auto read_length = [&](size_t length) noexcept -> luisa::optional<size_t> {
+        if (length != 15u) { return length; }
+        for (;;) {
+            if (ip >= size) { return luisa::nullopt; }
+            auto x = static_cast<size_t>(src[ip++]);
+            length += x;
+            if (x != 255u) { return length; }
+        }
+    };
+    while (ip < size) {
+        auto token = static_cast<size_t>(src[ip++]);
+        auto literal_length = read_length(token >> 4u);
+        if (!literal_length || *literal_length > size - ip || *literal_length > capacity - op) { return 0u; }
+        std::memcpy(dst + op, src + ip, *literal_length);
+        ip += *literal_length;
+        op += *literal_length;
+        if (ip == size) { return op; }
+        if (size - ip < 2u) { return 0u; }
+        auto offset = static_cast<size_t>(src[ip]) | (static_cast<size_t>(src[ip + 1u]) << 8u);
+        ip += 2u;
+        auto match_length = read_length(token & 15u);
+        if (offset == 0u || offset > op || !match_length ||
+            *match_length + lz4_min_match > capacity - op) { return 0u; }
+        auto length = *match_length + lz4_min_match;
+        if (offset >= length) {
+            std::memcpy(dst + op, dst + op - offset, length);
+        } else {
+            for (auto i = 0u; i < length; i++) { dst[op + i] = dst[op - offset + i]; }
+        }
+        op += length;
+    }
+    return 0u;
+}
+
+#ifdef LUISA_COMPUTE_ENABLE_ZLIB
+// raw deflate streams, the bitstream that GDeflate parallelizes
+[[nodiscard]] bool deflate_compress(const std::byte *src, size_t size,
+                                    luisa::vector<std::byte> &out, int level) noexcept {
+    z_stream stream{};
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) { return false; }
+    auto offset = out.size();
+    out.resize(offset + deflateBound(&stream, static_cast<uLong>(size)));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(src));
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = reinterpret_cast<Bytef *>(out.data() + offset);
+    stream.avail_out = static_cast<uInt>(out.size() - offset);
+    auto status = deflate(&stream, Z_FINISH);
+    out.resize(offset + stream.total_out);
+    deflateEnd(&stream);
+    return status == Z_STREAM_END;
+}
+
+[[nodiscard]] size_t deflate_decompress(const std::byte *src, size_t size,
+                                        std::byte *dst, size_t capacity) noexcept {
+    z_stream stream{};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) { return 0u; }
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<std::byte *>(src));
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = reinterpret_cast<Bytef *>(dst);
+    stream.avail_out = static_cast<uInt>(capacity);
+    auto status = inflate(&stream, Z_FINISH);
+    auto n = static_cast<size_t>(stream.total_out);
+    inflateEnd(&stream);
+    return status == Z_STREAM_END ? n : 0u;
+}
+#endif
+
+[[nodiscard]] auto dstorage_compress_chunk(DStorageCompression algorithm, DStorageCompressionQuality quality,
+                                           const std::byte *chunk_data, size_t chunk_size_bytes,
+                                           luisa::vector<std::byte> &result) noexcept {
+    auto compressed = false;
+    switch (algorithm) {
+        case DStorageCompression::LZ4:
+            lz4_compress(chunk_data, chunk_size_bytes, result,
+                         quality == DStorageCompressionQuality::Fastest ? 4u : 6u);
+            compressed = true;
+            break;
+#ifdef LUISA_COMPUTE_ENABLE_ZLIB
+        case DStorageCompression::GDeflate:
+            compressed = deflate_compress(chunk_data, chunk_size_bytes, result,
+                                          quality == DStorageCompressionQuality::Fastest ? Z_BEST_SPEED :
+                                          quality == DStorageCompressionQuality::Best    ? Z_BEST_COMPRESSION :
+                                                                                           Z_DEFAULT_COMPRESSION);
+            break;
+#endif
+        default: break;
+    }
+    if (!compressed || result.size() >= chunk_size_bytes) {
+        result.resize(chunk_size_bytes);
+        std::memcpy(result.data(), chunk_data, chunk_size_bytes);
+        return false;
+    }
+    return true;
+}
+
+[[nodiscard]] auto dstorage_decompress_chunk(DStorageCompression algorithm,
+                                             const std::byte *src, size_t size,
+                                             std::byte *dst, size_t capacity) noexcept {
+    switch (algorithm) {
+        case DStorageCompression::LZ4: return lz4_decompress(src, size, dst, capacity);
+#ifdef LUISA_COMPUTE_ENABLE_ZLIB
+        case DStorageCompression::GDeflate: return deflate_decompress(src, size, dst, capacity);
+#endif
+        default: break;
+    }
+    LUISA_ERROR_WITH_LOCATION("Unsupported compression algorithm: {}.", to_string(algorithm));
+}
+
+struct DStorageDecompression {
+    DStorageCompression algorithm;
+    const std::byte *src;
+    size_t src_size;
+    std::byte *dst;
+    size_t dst_size;
+};
+
+// decompresses the chunks of all the requests of a batch at once
+void dstorage_decompress(ThreadPool &pool, luisa::span<const DStorageDecompression> requests) noexcept {
+    struct Chunk {
+        DStorageCompression algorithm;
+        RustCompressionChunkMetadata metadata;
+        const std::byte *src;
+        std::byte *dst;
+        size_t size;
+    };
+    luisa::vector<Chunk> chunks;
+    for (auto &&r : requests) {
+        LUISA_ASSERT(r.src_size >= sizeof(RustCompressionFileHeader),
+                     "Compressed data is too small ({} bytes).", r.src_size);
+        auto header = reinterpret_cast<const RustCompressionFileHeader *>(r.src);
+        LUISA_ASSERT(header->magic == RustCompressionFileHeader::rust_compression_magic,
+                     "Invalid compressed data (magic = 0x{:08x}).", header->magic);
+        LUISA_ASSERT(header->algorithm == r.algorithm,
+                     "Data compressed with {} cannot be decompressed with {}.",
+                     to_string(header->algorithm), to_string(r.algorithm));
+        LUISA_ASSERT(header->size_bytes <= r.dst_size,
+                     "Decompressed size ({} bytes) exceeds the destination size ({} bytes).",
+                     header->size_bytes, r.dst_size);
+        LUISA_ASSERT(header->chunk_size != 0u &&
+                         header->chunk_count == (header->size_bytes + header->chunk_size - 1u) / header->chunk_size &&
+                         header->chunk_count <= (r.src_size - sizeof(RustCompressionFileHeader)) /
+                                                    sizeof(RustCompressionChunkMetadata),
+                     "Invalid compressed data (chunk_size = {}, chunk_count = {}).",
+                     header->chunk_size, header->chunk_count);
+        for (auto i = 0u; i < header->chunk_count; i++) {
+            auto metadata = header->chunk_metadata[i];
+            LUISA_ASSERT(metadata.file_offset <= r.src_size &&
+                             metadata.compressed_size <= r.src_size - metadata.file_offset,
+                         "Chunk {} is out of the compressed data.", i);
+            chunks.emplace_back(Chunk{
+                .algorithm = r.algorithm,
+                .metadata = metadata,
+                .src = r.src,
+                .dst = r.dst + i * header->chunk_size,
+                .size = std::min(header->chunk_size, header->size_bytes - i * header->chunk_size)});
+        }
+    }
+    parallel_for(pool, chunks.size(), [&chunks](size_t i) noexcept {
+        auto &&c = chunks[i];
+        auto src = c.src + c.metadata.file_offset;
+        if (!c.metadata.is_compressed) {
+            LUISA_ASSERT(c.metadata.compressed_size == c.size,
+                         "Stored chunk has {} bytes but {} are expected.",
+                         c.metadata.compressed_size, c.size);
+            std::memcpy(c.dst, src, c.size);
+        } else {
+            auto n = dstorage_decompress_chunk(c.algorithm, src, c.metadata.compressed_size, c.dst, c.size);
+            LUISA_ASSERT(n == c.size, "Failed to decompress chunk ({} bytes expected, {} decoded).", c.size, n);
+        }
+    });
+}
+
+}// namespace detail
+
+class RustThreadPoolFileReader final : public RustFileReader {
+
+private:
+    ThreadPool &_pool;
+    luisa::vector<RustFileRead> _pieces;
+
+public:
+    explicit RustThreadPoolFileReader(ThreadPool &pool) noexcept : _pool{pool} {}
+    void read(luisa::span<const RustFileRead> reads) noexcept override {
+        detail::dstorage_split_reads(reads, _pieces);
+        parallel_for(_pool, _pieces.size(), [this](size_t i) noexcept {
+            detail::dstorage_read_file(_pieces[i]);
+        });
+    }
+};
+
+#ifdef LUISA_RUST_DSTORAGE_IO_URING
+
+// A minimal io_uring driven through the raw system calls, so that no liburing is needed.
+// Reads are submitted directly into the destinations; short reads are resubmitted.
+class RustIOUringFileReader final : public RustFileReader {
+
+public:
+    static constexpr auto queue_depth = 64u;
+
+private:
+    int _fd{-1};
+    uint _entries{0u};
+    void *_sq_ring{MAP_FAILED};
+    void *_cq_ring{MAP_FAILED};
+    void *_sqes{MAP_FAILED};
+    size_t _sq_ring_size{0u};
+    size_t _cq_ring_size{0u};
+    size_t _sqes_size{0u};
+    uint *_sq_tail{nullptr};
+    uint *_sq_array{nullptr};
+    uint _sq_mask{0u};
+    uint *_cq_head{nullptr};
+    uint *_cq_tail{nullptr};
+    uint _cq_mask{0u};
+    io_uring_cqe *_cqes{nullptr};
+    luisa::vector<RustFileRead> _pieces;
+    luisa::vector<uint> _retries;
+
+private:
+    template<typename T>
+    [[nodiscard]] static auto _ring_field(void *ring, uint offset) noexcept {
+        return reinterpret_cast<T *>(static_cast<std::byte *>(ring) + offset);
+    }
+
+    void _enter(uint to_submit) noexcept {
+        for (;;) {
+            auto n = syscall(__NR_io_uring_enter, _fd, to_submit, 1u, IORING_ENTER_GETEVENTS, nullptr, 0u);
+            if (n >= 0) {
+                to_submit -= static_cast<uint>(n);
+                if (to_submit == 0u) { return; }
+            } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                LUISA_ERROR_WITH_LOCATION("Failed to submit io_uring reads: {}.", std::strerror(errno));
+            }
+        }
+    }
+
+public:
+    RustIOUringFileReader() noexcept {
+        io_uring_params params{};
+        _fd = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &params));
+        if (_fd < 0) {
+            LUISA_VERBOSE("Failed to create io_uring: {}.", std::strerror(errno));
+            return;
+        }
+        // IORING_OP_READ came with Linux 5.6, as did IORING_FEAT_RW_CUR_POS
+        if ((params.features & IORING_FEAT_RW_CUR_POS) == 0u) {
+            LUISA_VERBOSE("io_uring does not support IORING_OP_READ.");
+            return;
+        }
+        _entries = params.sq_entries;
+        _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint);
+        _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        auto single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0u;
+        if (single_mmap) { _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size); }
+        auto map = [this](size_t size, off_t offset) noexcept {
+            return mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, offset);
+        };
+        _sq_ring = map(_sq_ring_size, IORING_OFF_SQ_RING);
+        _cq_ring = single_mmap ? _sq_ring : map(_cq_ring_size, IORING_OFF_CQ_RING);
+        _sqes = map(_sqes_size, IORING_OFF_SQES);
+        if (!valid()) {
+            LUISA_VERBOSE("Failed to map io_uring: {}.", std::strerror(errno));
+            return;
+        }
+        _sq_tail = _ring_field<uint>(_sq_ring, params.sq_off.tail);
+        _sq_array = _ring_field<uint>(_sq_ring, params.sq_off.array);
+        _sq_mask = *_ring_field<uint>(_sq_ring, params.sq_off.ring_mask);
+        _cq_head = _ring_field<uint>(_cq_ring, params.cq_off.head);
+        _cq_tail = _ring_field<uint>(_cq_ring, params.cq_off.tail);
+        _cq_mask = *_ring_field<uint>(_cq_ring, params.cq_off.ring_mask);
+        _cqes = _ring_field<io_uring_cqe>(_cq_ring, params.cq_off.cqes);
+    }
+
+    ~RustIOUringFileReader() noexcept override {
+        if (_sqes != MAP_FAILED) { munmap(_sqes, _sqes_size); }
+        if (_cq_ring != MAP_FAILED && _cq_ring != _sq_ring) { munmap(_cq_ring, _cq_ring_size); }
+        if (_sq_ring != MAP_FAILED) { munmap(_sq_ring, _sq_ring_size); }
+        if (_fd >= 0) { close(_fd); }
+    }
+
+    [[nodiscard]] bool valid() const noexcept {
+        return _fd >= 0 && _entries != 0u &&
+               _sq_ring != MAP_FAILED && _cq_ring != MAP_FAILED && _sqes != MAP_FAILED;
+    }
+
+    void read(luisa::span<const RustFileRead> reads) noexcept override {
+        detail::dstorage_split_reads(reads, _pieces);
+        _retries.clear();
+        auto sqes = static_cast<io_uring_sqe *>(_sqes);
+        auto next = static_cast<size_t>(0u);
+        auto in_flight = 0u;
+        while (next < _pieces.size() || !_retries.empty() || in_flight != 0u) {
+            // fill the submission queue, we are its only producer
+            auto tail = *_sq_tail;
+            auto to_submit = 0u;
+            auto push = [&](uint index) noexcept {
+                auto &&r = _pieces[index];
+                auto slot = tail++ & _sq_mask;
+                auto &&sqe = sqes[slot];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = r.file->fd;
+                sqe.off = r.offset;
+                sqe.addr = reinterpret_cast<uint64_t>(r.data);
+                sqe.len = static_cast<uint>(r.size);
+                sqe.user_data = index;
+                _sq_array[slot] = slot;
+                to_submit++;
+            };
+            while (in_flight + to_submit < _entries && !_retries.empty()) {
+                push(_retries.back());
+                _retries.pop_back();
+            }
+            while (in_flight + to_submit < _entries && next < _pieces.size()) {
+                push(static_cast<uint>(next++));
+            }
+            std::atomic_ref{*_sq_tail}.store(tail, std::memory_order_release);
+            in_flight += to_submit;
+            _enter(to_submit);
+            // reap the completions
+            auto head = *_cq_head;
+            auto cq_tail = std::atomic_ref{*_cq_tail}.load(std::memory_order_acquire);
+            for (; head != cq_tail; head++) {
+                auto &&cqe = _cqes[head & _cq_mask];
+                auto index = static_cast<uint>(cqe.user_data);
+                auto &&r = _pieces[index];
+                in_flight--;
+                if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                    _retries.emplace_back(index);
+                    continue;
+                }
+                LUISA_ASSERT(cqe.res > 0, "Failed to read {} bytes at offset {}: {}.",
+                             r.size, r.offset,
+                             cqe.res == 0 ? "unexpected end of file" : std::strerror(-cqe.res));
+                auto n = static_cast<size_t>(cqe.res);
+                if (n < r.size) {
+                    r.offset += n;
+                    r.data += n;
+                    r.size -= n;
+                    _retries.emplace_back(index);
+                }
+            }
+            std::atomic_ref{*_cq_head}.store(head, std::memory_order_release);
+        }
+    }
+};
+
+#endif
+
+luisa::unique_ptr<RustFileReader> RustFileReader::create(ThreadPool &pool) noexcept {
+#ifdef LUISA_RUST_DSTORAGE_IO_URING
+    // LUISA_DSTORAGE_IO_URING=0: read files with the thread pool instead of io_uring
+    auto env = std::getenv("LUISA_DSTORAGE_IO_URING");
+    if (env == nullptr || luisa::string_view{env} != "0") {
+        if (auto reader = luisa::make_unique<RustIOUringFileReader>(); reader->valid()) {
+            return reader;
+        }
+        LUISA_WARNING_WITH_LOCATION("io_uring is not available. "
+                                    "Falling back to thread pool reads.");
+    }
+#endif
+    return luisa::make_unique<RustThreadPoolFileReader>(pool);
+}
+
+RustDStorageStream::RustDStorageStream(RustDStorageExt *ext) noexcept
+    : _ext{ext},
+      _backing_stream{ext->device()->create_stream(StreamTag::COPY).handle},
+      _reader{RustFileReader::create(ext->thread_pool())},
+      _worker{[this] { _run(); }} {}
+
+RustDStorageStream::~RustDStorageStream() noexcept {
+    synchronize();
+    {
+        std::scoped_lock lock{_mutex};
+        _stop = true;
+    }
+    _cv.notify_all();
+    _worker.join();
+    _ext->device()->destroy_stream(_backing_stream);
+}
+
+void RustDStorageStream::_enqueue(Task &&task) noexcept {
+    {
+        std::scoped_lock lock{_mutex};
+        _tasks.push(std::move(task));
+        _enqueued++;
+    }
+    _cv.notify_all();
+}
+
+void RustDStorageStream::_run() noexcept {
+    for (;;) {
+        luisa::optional<Task> task;
+        {
+            std::unique_lock lock{_mutex};
+            _cv.wait(lock, [this] { return _stop || !_tasks.empty(); });
+            if (_tasks.empty()) { return; }
+            task.emplace(std::move(_tasks.front()));
+            _tasks.pop();
+        }
+        auto device = _ext->device();
+        luisa::visit(
+            [&]<typename T>(T &t) noexcept {
+                if constexpr (std::is_same_v<T, CommandList>) {
+                    _process(std::move(t));
+                } else if constexpr (std::is_same_v<T, Signal>) {
+                    device->signal_event(t.event, _backing_stream, t.value);
+                } else {
+                    // the backing stream waits for texture uploads, the worker for its own reads
+                    device->wait_event(t.event, _backing_stream, t.value);
+                    device->synchronize_event(t.event, t.value);
+                }
+            },
+            *task);
+        {
+            std::scoped_lock lock{_mutex};
+            _finished++;
+        }
+        _cv.notify_all();
+    }
+}
+
+void RustDStorageStream::_process(CommandList &&list) noexcept {
+    luisa::vector<RustFileRead> reads;
+    luisa::vector<detail::DStorageDecompression> decompressions;
+    luisa::vector<luisa::vector<std::byte>> compressed_data;
+    luisa::vector<luisa::vector<std::byte>> texture_data;
+    auto uploads = CommandList::create();
+    for (auto &&command : list.commands()) {
+        LUISA_ASSERT(command->tag() == Command::Tag::ECustomCommand &&
+                         static_cast<const CustomCommand *>(command.get())->uuid() ==
+                             to_underlying(CustomCommandUUID::DSTORAGE_READ),
+                     "Only DStorage read commands can be dispatched to DStorage streams.");
+        auto cmd = static_cast<const DStorageReadCommand *>(command.get());
+        // the destination, which is written in place except for textures
+        auto dst = static_cast<std::byte *>(nullptr);
+        auto dst_size = static_cast<size_t>(0u);
+        luisa::visit(
+            [&]<typename T>(const T &r) noexcept {
+                if constexpr (std::is_same_v<T, DStorageReadCommand::BufferRequest>) {
+                    auto buffer = reinterpret_cast<const RustBufferLayout *>(r.handle);
+                    LUISA_ASSERT(r.offset_bytes <= buffer->size && r.size_bytes <= buffer->size - r.offset_bytes,
+                                 "Buffer request out of range.");
+                    dst = buffer->data + r.offset_bytes;
+                    dst_size = r.size_bytes;
+                } else if constexpr (std::is_same_v<T, DStorageReadCommand::TextureRequest>) {
+                    LUISA_ASSERT(r.offset[0] == 0u && r.offset[1] == 0u && r.offset[2] == 0u,
+                                 "Partial texture requests are not supported by DStorage on the CPU backend.");
+                    auto storage = _ext->texture_storage(r.handle);
+                    auto size = make_uint3(r.size[0], r.size[1], r.size[2]);
+                    auto &&data = texture_data.emplace_back();
+                    data.resize(pixel_storage_size(storage, size));
+                    dst = data.data();
+                    dst_size = data.size();
+                    uploads << luisa::make_unique<TextureUploadCommand>(r.handle, storage, r.level, size, dst);
+                } else {
+                    dst = static_cast<std::byte *>(r.data);
+                    dst_size = r.size_bytes;
+                }
+            },
+            cmd->request());
+        auto compression = cmd->compression();
+        luisa::visit(
+            [&]<typename T>(const T &s) noexcept {
+                if constexpr (std::is_same_v<T, DStorageReadCommand::FileSource>) {
+                    auto file = reinterpret_cast<const RustDStorageFile *>(s.handle);
+                    LUISA_ASSERT(s.offset_bytes <= file->size_bytes && s.size_bytes <= file->size_bytes - s.offset_bytes,
+                                 "File source out of range.");
+                    if (compression == DStorageCompression::None) {
+                        LUISA_ASSERT(s.size_bytes <= dst_size, "Source size exceeds the destination size.");
+                        reads.emplace_back(RustFileRead{file, s.offset_bytes, dst, s.size_bytes});
+                    } else {
+                        auto &&data = compressed_data.emplace_back();
+                        data.resize(s.size_bytes);
+                        reads.emplace_back(RustFileRead{file, s.offset_bytes, data.data(), s.size_bytes});
+                        decompressions.emplace_back(detail::DStorageDecompression{
+                            compression, data.data(), data.size(), dst, dst_size});
+                    }
+                } else {
+                    auto memory = reinterpret_cast<const RustDStoragePinnedMemory *>(s.handle);
+                    LUISA_ASSERT(s.offset_bytes <= memory->size_bytes && s.size_bytes <= memory->size_bytes - s.offset_bytes,
+                                 "Memory source out of range.");
+                    auto src = memory->data + s.offset_bytes;
+                    if (compression == DStorageCompression::None) {
+                        LUISA_ASSERT(s.size_bytes <= dst_size, "Source size exceeds the destination size.");
+                        std::memcpy(dst, src, s.size_bytes);
+                    } else {
+                        decompressions.emplace_back(detail::DStorageDecompression{
+                            compression, src, s.size_bytes, dst, dst_size});
+                    }
+                }
+            },
+            cmd->source());
+    }
+    // the whole batch is read at once, then decompressed at once
+    if (!reads.empty()) { _reader->read(reads); }
+    if (!decompressions.empty()) { detail::dstorage_decompress(_ext->thread_pool(), decompressions); }
+    for (auto &&callback : list.steal_callbacks()) {
+        uploads.add_callback(std::move(callback));
+    }
+    if (!uploads.empty()) {
+        if (!texture_data.empty()) {
+            uploads.add_callback([texture_data = std::move(texture_data)] {});
+        }
+        _ext->device()->dispatch(_backing_stream, uploads.commit().command_list());
+    }
+}
+
+void RustDStorageStream::dispatch(CommandList &&list) noexcept {
+    _enqueue(std::move(list));
+}
+
+void RustDStorageStream::signal(uint64_t event, uint64_t value) noexcept {
+    _enqueue(Signal{event, value});
+}
+
+void RustDStorageStream::wait(uint64_t event, uint64_t value) noexcept {
+    _enqueue(Wait{event, value});
+}
+
+void RustDStorageStream::synchronize() noexcept {
+    {
+        std::unique_lock lock{_mutex};
+        auto target = _enqueued;
+        _cv.wait(lock, [this, target] { return _finished >= target; });
+    }
+    _ext->device()->synchronize_stream(_backing_stream);
+}
+
+RustDStorageExt::RustDStorageExt(DeviceInterface *device) noexcept
+    : _device{device} {}
+
+RustDStorageExt::~RustDStorageExt() noexcept = default;
+
+ResourceCreationInfo RustDStorageExt::create_stream_handle(const DStorageStreamOption &option) noexcept {
+    static_assert(alignof(RustDStorageStream) > stream_handle_tag);
+    auto stream = luisa::new_with_allocator<RustDStorageStream>(this);
+    ResourceCreationInfo info{};
+    info.handle = reinterpret_cast<uint64_t>(stream) | stream_handle_tag;
+    info.native_handle = stream;
+    return info;
+}
+
+void RustDStorageExt::destroy_stream(uint64_t handle) noexcept {
+    luisa::delete_with_allocator(stream(handle));
+}
+
+DStorageExt::FileCreationInfo RustDStorageExt::open_file_handle(luisa::string_view path) noexcept {
+    luisa::string path_string{path};
+#ifdef LUISA_PLATFORM_WINDOWS
+    auto handle = CreateFileA(path_string.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size{};
+    if (handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(handle, &size)) {
+        if (handle != INVALID_HANDLE_VALUE) { CloseHandle(handle); }
+        LUISA_WARNING_WITH_LOCATION("Failed to open file '{}'.", path);
+        return FileCreationInfo::make_invalid();
+    }
+    auto file = luisa::new_with_allocator<RustDStorageFile>(
+        RustDStorageFile{handle, static_cast<size_t>(size.QuadPart)});
+#else
+    auto fd = ::open(path_string.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status {};
+    if (fd < 0 || fstat(fd, &status) != 0) {
+        LUISA_WARNING_WITH_LOCATION("Failed to open file '{}': {}.", path, std::strerror(errno));
+        if (fd >= 0) { ::close(fd); }
+        return FileCreationInfo::make_invalid();
+    }
+    auto file = luisa::new_with_allocator<RustDStorageFile>(
+        RustDStorageFile{fd, static_cast<size_t>(status.st_size)});
+#endif
+    FileCreationInfo info{};
+    info.handle = reinterpret_cast<uint64_t>(file);
+    info.native_handle = file;
+    info.size_bytes = file->size_bytes;
+    return info;
+}
+
+void RustDStorageExt::close_file_handle(uint64_t handle) noexcept {
+    auto file = reinterpret_cast<RustDStorageFile *>(handle);
+#ifdef LUISA_PLATFORM_WINDOWS
+    CloseHandle(file->handle);
+#else
+    ::close(file->fd);
+#endif
+    luisa::delete_with_allocator(file);
+}
+
+// host memory is directly accessible on the CPU backend, so nothing needs to be pinned
+DStorageExt::PinnedMemoryInfo RustDStorageExt::pin_host_memory(void *ptr, size_t size_bytes) noexcept {
+    auto memory = luisa::new_with_allocator<RustDStoragePinnedMemory>(
+        RustDStoragePinnedMemory{static_cast<const std::byte *>(ptr), size_bytes});
+    PinnedMemoryInfo info{};
+    info.handle = reinterpret_cast<uint64_t>(memory);
+    info.native_handle = ptr;
+    info.size_bytes = size_bytes;
+    return info;
+}
+
+void RustDStorageExt::unpin_host_memory(uint64_t handle) noexcept {
+    luisa::delete_with_allocator(reinterpret_cast<RustDStoragePinnedMemory *>(handle));
+}
+
+void RustDStorageExt::compress(const void *data, size_t size_bytes,
+                               Compression algorithm, CompressionQuality quality,
+                               luisa::vector<std::byte> &result) noexcept {
+
+    Clock clk;
+
+    if (size_bytes == 0u) {
+        LUISA_WARNING_WITH_LOCATION("Empty data to compress.");
+        return;
+    }
+
+    if (algorithm == DStorageCompression::None) {
+        LUISA_WARNING_WITH_LOCATION("No compression algorithm specified. "
+                                    "The data will be copied as-is.");
+        result.resize(size_bytes);
+        std::memcpy(result.data(), data, size_bytes);
+        return;
+    }
+
+    LUISA_ASSERT(algorithm == DStorageCompression::LZ4 ||
+                     algorithm == DStorageCompression::GDeflate,
+                 "Unsupported compression algorithm: {}.",
+                 to_string(algorithm));
+#ifndef LUISA_COMPUTE_ENABLE_ZLIB
+    if (algorithm == DStorageCompression::GDeflate) {
+        LUISA_WARNING_WITH_LOCATION("The CPU backend is built without zlib. "
+                                    "GDeflate chunks will be stored uncompressed.");
+    }
+#endif
+
+    auto chunk_size = RustCompressionFileHeader::default_chunk_size;
+    auto chunk_count = (size_bytes + chunk_size - 1u) / chunk_size;
+    luisa::vector<luisa::vector<std::byte>> chunks(chunk_count);
+    luisa::vector<uint8_t> chunk_is_compressed(chunk_count);
+    parallel_for(_pool, chunk_count, [&](size_t chunk) noexcept {
+        auto chunk_data = static_cast<const std::byte *>(data) + chunk * chunk_size;
+        auto chunk_size_bytes = std::min(chunk_size, size_bytes - chunk * chunk_size);
+        chunk_is_compressed[chunk] = detail::dstorage_compress_chunk(
+            algorithm, quality, chunk_data, chunk_size_bytes, chunks[chunk]);
+    });
+
+    auto total_size = sizeof(RustCompressionFileHeader) +
+                      sizeof(RustCompressionChunkMetadata) * chunk_count;
+    for (auto &&c : chunks) { total_size += c.size(); }
+    result.resize(sizeof(RustCompressionFileHeader) +
+                  sizeof(RustCompressionChunkMetadata) * chunk_count);
+    result.reserve(total_size);
+    *reinterpret_cast<RustCompressionFileHeader *>(result.data()) = {
+        .magic = RustCompressionFileHeader::rust_compression_magic,
+        .algorithm = algorithm,
+        .size_bytes = size_bytes,
+        .chunk_size = chunk_size,
+        .chunk_count = chunk_count,
+    };
+    for (auto chunk = 0u; chunk < chunk_count; chunk++) {
+        reinterpret_cast<RustCompressionFileHeader *>(result.data())->chunk_metadata[chunk] = {
+            .is_compressed = chunk_is_compressed[chunk],
+            .file_offset = result.size(),
+            .compressed_size = chunks[chunk].size()};
+        result.insert(result.end(), chunks[chunk].cbegin(), chunks[chunk].cend());
+    }
+
+    auto ratio = static_cast<double>(result.size_bytes()) / static_cast<double>(size_bytes);
+    LUISA_VERBOSE("Compressed {} bytes to {} bytes (ratio = {}) with {} in {} ms.",
+                  size_bytes, result.size_bytes(), ratio, to_string(algorithm), clk.toc());
+}
+
+void RustDStorageExt::register_texture(uint64_t handle, PixelStorage storage) noexcept {
+    std::scoped_lock lock{_texture_mutex};
+    _texture_storages.insert_or_assign(handle, storage);
+}
+
+void RustDStorageExt::unregister_texture(uint64_t handle) noexcept {
+    std::scoped_lock lock{_texture_mutex};
+    _texture_storages.erase(handle);
+}
+
+PixelStorage RustDStorageExt::texture_storage(uint64_t handle) noexcept {
+    std::scoped_lock lock{_texture_mutex};
+    auto iter = _texture_storages.find(handle);
+    LUISA_ASSERT(iter != _texture_storages.end(), "Texture {:016x} not found.", handle);
+    return iter->second;
+}
+
+}// namespace luisa::compute::rust
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <luisa/core/spin_mutex.h>
+#include <luisa/core/thread_pool.h>
+#include <luisa/core/stl/queue.h>
+#include <luisa/core/stl/unordered_map.h>
+#include <luisa/core/stl/variant.h>
+#include <luisa/runtime/rhi/pixel.h>
+#include <luisa/runtime/command_list.h>
+#include <luisa/backends/ext/dstorage_ext_interface.h>
+
+namespace luisa::compute::rust {
+
+class RustDStorageExt;
+class RustFileReader;
+
+// A DStorage stream of the CPU backend. Command lists are processed in order by a
+// worker thread: all reads of a list are submitted at once (to an io_uring when the
+// kernel supports it) and land directly in the destination buffers, compressed
+// sources are then decompressed chunk-by-chunk on the extension's thread pool.
+// Texture uploads, events and callbacks go through a backing stream of the device.
+class RustDStorageStream {
+
+private:
+    struct Signal {
+        uint64_t event;
+        uint64_t value;
+    };
+    struct Wait {
+        uint64_t event;
+        uint64_t value;
+    };
+    using Task = luisa::variant<CommandList, Signal, Wait>;
+
+private:
+    RustDStorageExt *_ext;
+    uint64_t _backing_stream;
+    luisa::unique_ptr<RustFileReader> _reader;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    luisa::queue<Task> _tasks;
+    uint64_t _enqueued{0u};
+    uint64_t _finished{0u};
+    bool _stop{false};
+    std::thread _worker;
+
+private:
+    void _enqueue(Task &&task) noexcept;
+    void _run() noexcept;
+    void _process(CommandList &&list) noexcept;
+
+public:
+    explicit RustDStorageStream(RustDStorageExt *ext) noexcept;
+    ~RustDStorageStream() noexcept;
+    RustDStorageStream(RustDStorageStream &&) noexcept = delete;
+    RustDStorageStream(const RustDStorageStream &) noexcept = delete;
+    RustDStorageStream &operator=(RustDStorageStream &&) noexcept = delete;
+    RustDStorageStream &operator=(const RustDStorageStream &) noexcept = delete;
+    void dispatch(CommandList &&list) noexcept;
+    void signal(uint64_t event, uint64_t value) noexcept;
+    void wait(uint64_t event, uint64_t value) noexcept;
+    void synchronize() noexcept;
+};
+
+class RustDStorageExt final : public DStorageExt {
+
+public:
+    // stream handles of the backend point to 8-byte aligned objects,
+    // so the lowest bit tells DStorage streams apart without a lookup
+    static constexpr uint64_t stream_handle_tag = 1u;
+
+private:
+    DeviceInterface *_device;
+    ThreadPool _pool;
+    spin_mutex _texture_mutex;
+    luisa::unordered_map<uint64_t, PixelStorage> _texture_storages;
+
+protected:
+    [[nodiscard]] ResourceCreationInfo create_stream_handle(const DStorageStreamOption &option) noexcept override;
+    [[nodiscard]] FileCreationInfo open_file_handle(luisa::string_view path) noexcept override;
+    void close_file_handle(uint64_t handle) noexcept override;
+    [[nodiscard]] PinnedMemoryInfo pin_host_memory(void *ptr, size_t size_bytes) noexcept override;
+    void unpin_host_memory(uint64_t handle) noexcept override;
+
+public:
+    explicit RustDStorageExt(DeviceInterface *device) noexcept;
+    ~RustDStorageExt() noexcept;
+    [[nodiscard]] DeviceInterface *device() const noexcept override { return _device; }
+    [[nodiscard]] auto &thread_pool() noexcept { return _pool; }
+    void compress(const void *data, size_t size_bytes,
+                  Compression algorithm, CompressionQuality quality,
+                  luisa::vector<std::byte> &result) noexcept override;
+
+    // textures of the backend are tiled, so texture requests are uploaded
+    // through the device, which needs the pixel storage of the texture
+    void register_texture(uint64_t handle, PixelStorage storage) noexcept;
+    void unregister_texture(uint64_t handle) noexcept;
+    [[nodiscard]] PixelStorage texture_storage(uint64_t handle) noexcept;
+
+    [[nodiscard]] static auto stream(uint64_t handle) noexcept {
+        return (handle & stream_handle_tag) == 0u ?
+                   nullptr :
+                   reinterpret_cast<RustDStorageStream *>(handle & ~stream_handle_tag);
+    }
+    static void destroy_stream(uint64_t handle) noexcept;
+};
+
+}// namespace luisa::compute::rust
@@ -0,0 +1,377 @@
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <algorithm>
+
+#include <luisa/core/logging.h>
+#include <luisa/core/magic_enum.h>
+#include <luisa/core/stl/vector.h>
+#include <luisa/backends/ext/mipmap_cmd.h>
+#include "rust_device_common.h"
+#include "rust_mipmap.h"
+
+namespace luisa::compute::rust {
+
+namespace detail {
+
+// a level of a texture in the blocked layout of the CPU backend
+struct MipmapLevel {
+    std::byte *data;
+    uint width;
+    uint height;
+    size_t pixel_stride_shift;
+
+    [[nodiscard]] std::byte *texel(uint x, uint y) const noexcept {
+        constexpr auto b = RustTextureLayout::block_size;
+        auto grid_width = (width + b - 1u) / b;
+        auto index = (x / b + y / b * grid_width) * b * b + x % b + y % b * b;
+        return data + (static_cast<size_t>(index) << pixel_stride_shift);
+    }
+};
+
+[[nodiscard]] MipmapLevel mipmap_level(const RustTextureLayout *texture, uint level) noexcept {
+    return MipmapLevel{.data = texture->data + texture->mip_offsets[level],
+                       .width = std::max(texture->size[0] >> level, 1u),
+                       .height = std::max(texture->size[1] >> level, 1u),
+                       .pixel_stride_shift = texture->pixel_stride_shift};
+}
+
+[[nodiscard]] float srgb_to_linear(float x) noexcept {
+    return x <= .04045f ? x * (1.f / 12.92f) : std::pow((x + .055f) * (1.f / 1.055f), 2.4f);
+}
+
+[[nodiscard]] float linear_to_srgb(float x) noexcept {
+    return x <= .0031308f ? x * 12.92f : 1.055f * std::pow(x, 1.f / 2.4f) - .055f;
+}
+
+// 8-bit sRGB values are decoded with a table and encoded by searching the linear
+// values halfway between adjacent codes, which rounds to the nearest code in sRGB
+struct MipmapSRGBTables {
+    std::array<float, 256u> decode{};
+    std::array<float, 255u> thresholds{};
+    MipmapSRGBTables() noexcept {
+        for (auto i = 0u; i < 256u; i++) { decode[i] = srgb_to_linear(static_cast<float>(i) / 255.f); }
+        for (auto i = 0u; i < 255u; i++) { thresholds[i] = srgb_to_linear((static_cast<float>(i) + .5f) / 255.f); }
+    }
+    [[nodiscard]] uint8_t encode(float x) const noexcept {
+        return static_cast<uint8_t>(std::upper_bound(thresholds.cbegin(), thresholds.cend(), x) - thresholds.cbegin());
+    }
+};
+
+[[nodiscard]] const MipmapSRGBTables &mipmap_srgb_tables() noexcept {
+    static MipmapSRGBTables tables;
+    return tables;
+}
+
+[[nodiscard]] constexpr uint mipmap_channel_count(PixelStorage storage) noexcept {
+    switch (storage) {
+        case PixelStorage::BYTE1:
+        case PixelStorage::SHORT1:
+        case PixelStorage::HALF1:
+        case PixelStorage::FLOAT1: return 1u;
+        case PixelStorage::BYTE2:
+        case PixelStorage::SHORT2:
+        case PixelStorage::HALF2:
+        case PixelStorage::FLOAT2: return 2u;
+        case PixelStorage::R11G11B10: return 3u;
+        default: break;
+    }
+    return 4u;
+}
+
+[[nodiscard]] float unorm_to_float(uint x, uint max) noexcept {
+    return static_cast<float>(x) / static_cast<float>(max);
+}
+
+[[nodiscard]] uint float_to_unorm(float x, uint max) noexcept {
+    return static_cast<uint>(std::clamp(x, 0.f, 1.f) * static_cast<float>(max) + .5f);
+}
+
+// unsigned 11- and 10-bit floats are halves without the sign and the lowest mantissa bits
+[[nodiscard]] float small_float_to_float(uint x, uint dropped_bits) noexcept {
+    return static_cast<float>(std::bit_cast<half>(static_cast<uint16_t>(x << dropped_bits)));
+}
+
+[[nodiscard]] uint float_to_small_float(float x, uint dropped_bits) noexcept {
+    auto h = static_cast<uint>(std::bit_cast<uint16_t>(half{std::max(x, 0.f)}));
+    auto max_finite = (0x7bffu >> dropped_bits);
+    return std::min((h + (1u << (dropped_bits - 1u))) >> dropped_bits, max_finite);
+}
+
+template<PixelStorage storage>
+[[nodiscard]] float4 mipmap_load(const std::byte *p, bool srgb) noexcept {
+    constexpr auto n = mipmap_channel_count(storage);
+    auto v = make_float4(0.f, 0.f, 0.f, 1.f);
+    if constexpr (storage == PixelStorage::BYTE1 || storage == PixelStorage::BYTE2 || storage == PixelStorage::BYTE4) {
+        std::array<uint8_t, 4u> c{};
+        std::memcpy(c.data(), p, n);
+        auto &&tables = mipmap_srgb_tables();
+        for (auto i = 0u; i < n; i++) { v[i] = srgb && i < 3u ? tables.decode[c[i]] : unorm_to_float(c[i], 255u); }
+        return v;
+    } else {
+        if constexpr (storage == PixelStorage::SHORT1 || storage == PixelStorage::SHORT2 || storage == PixelStorage::SHORT4) {
+            std::array<uint16_t, 4u> c{};
+            std::memcpy(c.data(), p, n * sizeof(uint16_t));
+            for (auto i = 0u; i < n; i++) { v[i] = unorm_to_float(c[i], 65535u); }
+        } else if constexpr (storage == PixelStorage::HALF1 || storage == PixelStorage::HALF2 || storage == PixelStorage::HALF4) {
+            std::array<half, 4u> c{};
+            std::memcpy(c.data(), p, n * sizeof(half));
+            for (auto i = 0u; i < n; i++) { v[i] = static_cast<float>(c[i]); }
+        } else if constexpr (storage == PixelStorage::FLOAT1 || storage == PixelStorage::FLOAT2 || storage == PixelStorage::FLOAT4) {
+            std::memcpy(&v, p, n * sizeof(float));
+        } else if constexpr (storage == PixelStorage::R10G10B10A2) {
+            uint x;
+            std::memcpy(&x, p, sizeof(x));
+            v = make_float4(unorm_to_float(x & 0x3ffu, 1023u), unorm_to_float((x >> 10u) & 0x3ffu, 1023u),
+                            unorm_to_float((x >> 20u) & 0x3ffu, 1023u), unorm_to_float(x >> 30u, 3u));
+        } else if constexpr (storage == PixelStorage::R11G11B10) {
+            uint x;
+            std::memcpy(&x, p, sizeof(x));
+            v = make_float4(small_float_to_float(x & 0x7ffu, 4u), small_float_to_float((x >> 11u) & 0x7ffu, 4u),
+                            small_float_to_float(x >> 22u, 5u), 1.f);
+        } else {
+            static_assert(always_false_v<decltype(storage)>, "Unsupported pixel storage.");
+        }
+        if (srgb) {
+            for (auto i = 0u; i < std::min(n, 3u); i++) { v[i] = srgb_to_linear(v[i]); }
+        }
+        return v;
+    }
+}
+
+template<PixelStorage storage>
+void mipmap_store(std::byte *p, float4 v, bool srgb) noexcept {
+    constexpr auto n = mipmap_channel_count(storage);
+    if constexpr (storage == PixelStorage::BYTE1 || storage == PixelStorage::BYTE2 || storage == PixelStorage::BYTE4) {
+        std::array<uint8_t, 4u> c{};
+        auto &&tables = mipmap_srgb_tables();
+        for (auto i = 0u; i < n; i++) {
+            c[i] = srgb && i < 3u ? tables.encode(v[i]) : static_cast<uint8_t>(float_to_unorm(v[i], 255u));
+        }
+        std::memcpy(p, c.data(), n);
+    } else {
+        if (srgb) {
+            for (auto i = 0u; i < std::min(n, 3u); i++) { v[i] = linear_to_srgb(v[i]); }
+        }
+        if constexpr (storage == PixelStorage::SHORT1 || storage == PixelStorage::SHORT2 || storage == PixelStorage::SHORT4) {
+            std::array<uint16_t, 4u> c{};
+            for (auto i = 0u; i < n; i++) { c[i] = static_cast<uint16_t>(float_to_unorm(v[i], 65535u)); }
+            std::memcpy(p, c.data(), n * sizeof(uint16_t));
+        } else if constexpr (storage == PixelStorage::HALF1 || storage == PixelStorage::HALF2 || storage == PixelStorage::HALF4) {
+            std::array<half, 4u> c{};
+            for (auto i = 0u; i < n; i++) { c[i] = half{v[i]}; }
+            std::memcpy(p, c.data(), n * sizeof(half));
+        } else if constexpr (storage == PixelStorage::FLOAT1 || storage == PixelStorage::FLOAT2 || storage == PixelStorage::FLOAT4) {
+            std::memcpy(p, &v, n * sizeof(float));
+        } else if constexpr (storage == PixelStorage::R10G10B10A2) {
+            auto x = float_to_unorm(v.x, 1023u) | (float_to_unorm(v.y, 1023u) << 10u) |
+                     (float_to_unorm(v.z, 1023u) << 20u) | (float_to_unorm(v.w, 3u) << 30u);
+            std::memcpy(p, &x, sizeof(x));
+        } else if constexpr (storage == PixelStorage::R11G11B10) {
+            auto x = float_to_small_float(v.x, 4u) | (float_to_small_float(v.y, 4u) << 11u) |
+                     (float_to_small_float(v.z, 5u) << 22u);
+            std::memcpy(p, &x, sizeof(x));
+        } else {
+            static_assert(always_false_v<decltype(storage)>, "Unsupported pixel storage.");
+        }
+    }
+}
+
+// calls f.operator()<storage>(), returns false if the storage cannot be filtered
+template<typename F>
+[[nodiscard]] bool mipmap_with_storage(PixelStorage storage, F &&f) noexcept {
+    switch (storage) {
+        case PixelStorage::BYTE1: f.template operator()<PixelStorage::BYTE1>(); return true;
+        case PixelStorage::BYTE2: f.template operator()<PixelStorage::BYTE2>(); return true;
+        case PixelStorage::BYTE4: f.template operator()<PixelStorage::BYTE4>(); return true;
+        case PixelStorage::SHORT1: f.template operator()<PixelStorage::SHORT1>(); return true;
+        case PixelStorage::SHORT2: f.template operator()<PixelStorage::SHORT2>(); return true;
+        case PixelStorage::SHORT4: f.template operator()<PixelStorage::SHORT4>(); return true;
+        case PixelStorage::HALF1: f.template operator()<PixelStorage::HALF1>(); return true;
+        case PixelStorage::HALF2: f.template operator()<PixelStorage::HALF2>(); return true;
+        case PixelStorage::HALF4: f.template operator()<PixelStorage::HALF4>(); return true;
+        case PixelStorage::FLOAT1: f.template operator()<PixelStorage::FLOAT1>(); return true;
+        case PixelStorage::FLOAT2: f.template operator()<PixelStorage::FLOAT2>(); return true;
+        case PixelStorage::FLOAT4: f.template operator()<PixelStorage::FLOAT4>(); return true;
+        case PixelStorage::R10G10B10A2: f.template operator()<PixelStorage::R10G10B10A2>(); return true;
+        case PixelStorage::R11G11B10: f.template operator()<PixelStorage::R11G11B10>(); return true;
+        default: break;
+    }
+    return false;
+}
+
+static constexpr auto mipmap_kaiser_taps = 8u;
+
+// Taps at offsets -3.5, ..., 3.5 around the center of a destination texel, in
+// texels of the source level: a sinc with the cutoff at the destination Nyquist
+// frequency, windowed by a Kaiser window (alpha = 4) of half-width 4.
+[[nodiscard]] std::array<float, mipmap_kaiser_taps> mipmap_kaiser_weights() noexcept {
+    constexpr auto alpha = 4.;
+    auto bessel_i0 = [](double x) noexcept {
+        auto sum = 1.;
+        auto term = 1.;
+        for (auto k = 1; k < 32; k++) {
+            term *= (x * .5 / k) * (x * .5 / k);
+            sum += term;
+        }
+        return sum;
+    };
+    std::array<double, mipmap_kaiser_taps> w{};
+    auto sum = 0.;
+    for (auto t = 0u; t < mipmap_kaiser_taps; t++) {
+        auto d = static_cast<double>(t) - (mipmap_kaiser_taps - 1u) * .5;
+        auto x = std::numbers::pi * d * .5;
+        auto r = d / 4.;
+        w[t] = std::sin(x) / x * bessel_i0(alpha * std::sqrt(1. - r * r)) / bessel_i0(alpha);
+        sum += w[t];
+    }
+    std::array<float, mipmap_kaiser_taps> weights{};
+    for (auto t = 0u; t < mipmap_kaiser_taps; t++) { weights[t] = static_cast<float>(w[t] / sum); }
+    return weights;
+}
+
+}// namespace detail
+
+bool RustMipmapGenerator::is_mipmap_command(const Command *command) noexcept {
+    return command->tag() == Command::Tag::ECustomCommand &&
+           static_cast<const CustomCommand *>(command)->uuid() ==
+               to_underlying(CustomCommandUUID::MIPMAP_GENERATE);
+}
+
+bool RustMipmapGenerator::is_mipmap_generation_supported(
+    PixelStorage storage, MipmapFilter filter, bool srgb) const noexcept {
+    return detail::mipmap_with_storage(storage, []<PixelStorage>() noexcept {});
+}
+
+void RustMipmapGenerator::generate(const GenerateMipmapsCommand *command) noexcept {
+    auto texture = reinterpret_cast<const RustTextureLayout *>(command->handle());
+    LUISA_ASSERT(texture->dimension == 2u, "Mipmaps can only be generated for 2D textures.");
+    LUISA_ASSERT(command->level_count() <= texture->mip_levels,
+                 "Cannot generate {} mipmap levels for a texture with {} levels.",
+                 command->level_count(), texture->mip_levels);
+    if (command->level_count() <= 1u) { return; }
+    switch (command->filter()) {
+        case MipmapFilter::BOX: _box(command); break;
+        case MipmapFilter::KAISER: _kaiser(command); break;
+    }
+}
+
+void RustMipmapGenerator::_box(const GenerateMipmapsCommand *command) noexcept {
+    auto texture = reinterpret_cast<const RustTextureLayout *>(command->handle());
+    auto srgb = command->srgb();
+    auto last_level = command->level_count() - 1u;
+    auto supported = detail::mipmap_with_storage(command->storage(), [&]<PixelStorage storage>() noexcept {
+        constexpr auto tile = box_tile_size;
+        // levels reduced from one tile of the base level before it is down to a texel
+        constexpr auto levels_per_pass = static_cast<uint>(std::countr_zero(tile));
+        for (auto base = 0u; base < last_level; base += levels_per_pass) {
+            auto src = detail::mipmap_level(texture, base);
+            auto tiles_x = (src.width + tile - 1u) / tile;
+            auto tiles_y = (src.height + tile - 1u) / tile;
+            auto pass_last = std::min(base + levels_per_pass, last_level);
+            parallel_for(_pool, tiles_x * tiles_y, [&](size_t index) noexcept {
+                // holds the current level of the tile, reduced in place
+                static thread_local std::array<float4, tile * tile> texels;
+                auto x0 = static_cast<uint>(index % tiles_x) * tile;
+                auto y0 = static_cast<uint>(index / tiles_x) * tile;
+                auto width = std::min(src.width - x0, tile);
+                auto height = std::min(src.height - y0, tile);
+                for (auto y = 0u; y < height; y++) {
+                    for (auto x = 0u; x < width; x++) {
+                        texels[y * tile + x] = detail::mipmap_load<storage>(src.texel(x0 + x, y0 + y), srgb);
+                    }
+                }
+                for (auto level = base + 1u; level <= pass_last; level++) {
+                    auto dst = detail::mipmap_level(texture, level);
+                    auto shift = level - base;
+                    // odd rows and columns at the end of a level are dropped, so
+                    // the tiles of every level nest in those of the base level
+                    auto dst_x0 = x0 >> shift;
+                    auto dst_y0 = y0 >> shift;
+                    auto dst_x1 = std::min((x0 + tile) >> shift, dst.width);
+                    auto dst_y1 = std::min((y0 + tile) >> shift, dst.height);
+                    if (dst_x1 <= dst_x0 || dst_y1 <= dst_y0) { break; }
+                    for (auto y = 0u; y < dst_y1 - dst_y0; y++) {
+                        auto r0 = 2u * y * tile;
+                        auto r1 = std::min(2u * y + 1u, height - 1u) * tile;
+                        for (auto x = 0u; x < dst_x1 - dst_x0; x++) {
+                            auto c0 = 2u * x;
+                            auto c1 = std::min(2u * x + 1u, width - 1u);
+                            auto v = (texels[r0 + c0] + texels[r0 + c1] + texels[r1 + c0] + texels[r1 + c1]) * .25f;
+                            // never overwrites a texel that is still to be read
+                            texels[y * tile + x] = v;
+                            detail::mipmap_store<storage>(dst.texel(dst_x0 + x, dst_y0 + y), v, srgb);
+                        }
+                    }
+                    width = dst_x1 - dst_x0;
+                    height = dst_y1 - dst_y0;
+                }
+            });
+        }
+    });
+    if (!supported) [[unlikely]] {
+        LUISA_WARNING_WITH_LOCATION(
+            "Cannot generate mipmaps for storage {}.",
+            luisa::to_string(command->storage()));
+    }
+}
+
+void RustMipmapGenerator::_kaiser(const GenerateMipmapsCommand *command) noexcept {
+    static auto weights = detail::mipmap_kaiser_weights();
+    auto texture = reinterpret_cast<const RustTextureLayout *>(command->handle());
+    auto srgb = command->srgb();
+    auto supported = detail::mipmap_with_storage(command->storage(), [&]<PixelStorage storage>() noexcept {
+        constexpr auto tile = kaiser_tile_size;
+        constexpr auto taps = detail::mipmap_kaiser_taps;
+        constexpr auto span = 2u * tile + taps - 2u;
+        for (auto level = 1u; level < command->level_count(); level++) {
+            auto src = detail::mipmap_level(texture, level - 1u);
+            auto dst = detail::mipmap_level(texture, level);
+            auto tiles_x = (dst.width + tile - 1u) / tile;
+            auto tiles_y = (dst.height + tile - 1u) / tile;
+            parallel_for(_pool, tiles_x * tiles_y, [&](size_t index) noexcept {
+                // the source texels under the tile and the horizontally filtered rows
+                static thread_local std::array<float4, span * span> source;
+                static thread_local std::array<float4, span * tile> rows;
+                auto x0 = static_cast<uint>(index % tiles_x) * tile;
+                auto y0 = static_cast<uint>(index / tiles_x) * tile;
+                auto width = std::min(dst.width - x0, tile);
+                auto height = std::min(dst.height - y0, tile);
+                auto source_width = 2u * width + taps - 2u;
+                auto source_height = 2u * height + taps - 2u;
+                // destination texel x is centered between source texels 2x and 2x + 1
+                auto sx0 = static_cast<int>(2u * x0) - static_cast<int>(taps / 2u - 1u);
+                auto sy0 = static_cast<int>(2u * y0) - static_cast<int>(taps / 2u - 1u);
+                for (auto y = 0u; y < source_height; y++) {
+                    auto sy = static_cast<uint>(std::clamp(sy0 + static_cast<int>(y), 0, static_cast<int>(src.height) - 1));
+                    for (auto x = 0u; x < source_width; x++) {
+                        auto sx = static_cast<uint>(std::clamp(sx0 + static_cast<int>(x), 0, static_cast<int>(src.width) - 1));
+                        source[y * span + x] = detail::mipmap_load<storage>(src.texel(sx, sy), srgb);
+                    }
+                }
+                for (auto y = 0u; y < source_height; y++) {
+                    for (auto x = 0u; x < width; x++) {
+                        auto v = make_float4(0.f);
+                        for (auto t = 0u; t < taps; t++) { v += weights[t] * source[y * span + 2u * x + t]; }
+                        rows[y * tile + x] = v;
+                    }
+                }
+                for (auto y = 0u; y < height; y++) {
+                    for (auto x = 0u; x < width; x++) {
+                        auto v = make_float4(0.f);
+                        for (auto t = 0u; t < taps; t++) { v += weights[t] * rows[(2u * y + t) * tile + x]; }
+                        detail::mipmap_store<storage>(dst.texel(x0 + x, y0 + y), v, srgb);
+                    }
+                }
+            });
+        }
+    });
+    if (!supported) [[unlikely]] {
+        LUISA_WARNING_WITH_LOCATION(
+            "Cannot generate mipmaps for storage {}.",
+            luisa::to_string(command->storage()));
+    }
+}
+
+}// namespace luisa::compute::rust
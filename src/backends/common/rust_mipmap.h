@@ -0,0 +1,41 @@
+#pragma once
+
+#include <luisa/core/thread_pool.h>
+#include <luisa/runtime/rhi/command.h>
+#include <luisa/backends/ext/mipmap_ext.h>
+
+namespace luisa::compute {
+class GenerateMipmapsCommand;
+}// namespace luisa::compute
+
+namespace luisa::compute::rust {
+
+// Generates the mipmaps of CPU textures in place, once the stream has drained.
+// The texture is processed in tiles of its blocked layout on a thread pool: with
+// the box filter each tile of the base level is decoded once and reduced through
+// the next six levels in a float buffer that stays in cache, so all levels come
+// from a single pass over the (largest) base level. The Kaiser filter reads
+// outside the 2x2 footprint and is applied level by level, tile by tile.
+class RustMipmapGenerator final : public MipmapExt {
+
+public:
+    // texels of the base level covered by one tile of a box-filtered pass
+    static constexpr auto box_tile_size = 64u;
+    // texels of the destination level covered by one tile of a Kaiser-filtered pass
+    static constexpr auto kaiser_tile_size = 32u;
+
+private:
+    ThreadPool _pool;
+
+private:
+    void _box(const GenerateMipmapsCommand *command) noexcept;
+    void _kaiser(const GenerateMipmapsCommand *command) noexcept;
+
+public:
+    [[nodiscard]] static bool is_mipmap_command(const Command *command) noexcept;
+    [[nodiscard]] bool is_mipmap_generation_supported(
+        PixelStorage storage, MipmapFilter filter, bool srgb) const noexcept override;
+    void generate(const GenerateMipmapsCommand *command) noexcept;
+};
+
+}// namespace luisa::compute::rust
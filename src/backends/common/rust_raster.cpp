@@ -0,0 +1,1135 @@
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/vector.h>
+#include <luisa/ast/function_builder.h>
+#include <luisa/ast/callable_library.h>
+#include <luisa/runtime/rhi/command_encoder.h>
+#include <luisa/runtime/raster/app_data.h>
+#include <luisa/backends/ext/raster_cmd.h>
+#include "rust_device_common.h"
+#include "rust_raster.h"
+
+namespace luisa::compute::rust {
+
+using compute::detail::FunctionBuilder;
+
+namespace detail {
+
+static constexpr auto raster_vertex_block_size = 256u;
+static constexpr auto raster_pixel_block_size = 64u;
+static constexpr auto raster_vertex_chunk_size = 4096u;
+static constexpr auto raster_triangle_chunk_size = 4096u;
+
+// vertex outputs and pixel outputs are either a single value or a flat structure
+[[nodiscard]] size_t raster_member_count(const Type *type) noexcept {
+    if (type == nullptr) { return 0u; }
+    return type->is_structure() ? type->members().size() : 1u;
+}
+
+[[nodiscard]] const Type *raster_member_type(const Type *type, size_t index) noexcept {
+    return type->is_structure() ? type->members()[index] : type;
+}
+
+[[nodiscard]] const Expression *raster_member(FunctionBuilder *fb, const Type *type,
+                                              const Expression *self, size_t index) noexcept {
+    return type->is_structure() ? fb->member(type->members()[index], self, index) : self;
+}
+
+// element type of the render target written by a pixel output, nullptr if unsupported
+[[nodiscard]] const Type *raster_target_element(const Type *type) noexcept {
+    if (!type->is_scalar() && !type->is_vector()) { return nullptr; }
+    auto elem = type->is_vector() ? type->element() : type;
+    return elem->is_float32() || elem->is_int32() || elem->is_uint32() ? elem : nullptr;
+}
+
+[[nodiscard]] const Expression *raster_declare_argument(FunctionBuilder *fb, Variable arg) noexcept {
+    switch (arg.tag()) {
+        case Variable::Tag::BUFFER: return fb->buffer(arg.type());
+        case Variable::Tag::TEXTURE: return fb->texture(arg.type());
+        case Variable::Tag::BINDLESS_ARRAY: return fb->bindless_array();
+        case Variable::Tag::ACCEL: return fb->accel();
+        default: break;
+    }
+    return fb->argument(arg.type());
+}
+
+// the object id of a stage becomes a trailing argument of its callable
+[[nodiscard]] bool raster_uses_object_id(Function stage, const FunctionBuilder &callable) noexcept {
+    auto extra = callable.arguments().subspan(stage.arguments().size());
+    return std::any_of(extra.begin(), extra.end(), [](Variable v) noexcept { return !v.is_builtin(); });
+}
+
+// pads a pixel output to 4 components, with 0 for the missing colors and 1 for alpha
+[[nodiscard]] const Expression *raster_expand(FunctionBuilder *fb, const Type *type, const Expression *value) noexcept {
+    auto elem = raster_target_element(type);
+    auto n = type->is_vector() ? type->dimension() : 1u;
+    if (n == 4u) { return value; }
+    auto constant = [&](uint x) noexcept -> const Expression * {
+        if (elem->is_float32()) { return fb->literal(elem, static_cast<float>(x)); }
+        if (elem->is_int32()) { return fb->literal(elem, static_cast<int>(x)); }
+        return fb->literal(elem, x);
+    };
+    std::array<const Expression *, 4u> c{};
+    for (auto i = 0u; i < 4u; i++) {
+        if (i < n) {
+            c[i] = n == 1u ? value : fb->swizzle(elem, value, 1u, i);
+        } else {
+            c[i] = constant(i == 3u ? 1u : 0u);
+        }
+    }
+    auto op = elem->is_float32() ? CallOp::MAKE_FLOAT4 :
+              elem->is_int32()   ? CallOp::MAKE_INT4 :
+                                   CallOp::MAKE_UINT4;
+    return fb->call(Type::vector(elem, 4u), op, {c[0], c[1], c[2], c[3]});
+}
+
+// src and dst must be cheap to evaluate more than once
+[[nodiscard]] const Expression *raster_blend(FunctionBuilder *fb, const BlendState &blend,
+                                             const Expression *src, const Expression *dst) noexcept {
+    auto t = Type::of<float4>();
+    if (blend.op == BlendOp::Min) { return fb->call(t, CallOp::MIN, {src, dst}); }
+    if (blend.op == BlendOp::Max) { return fb->call(t, CallOp::MAX, {src, dst}); }
+    auto one = fb->literal(t, make_float4(1.f));
+    auto factor = [&](BlendWeight w) noexcept -> const Expression * {
+        switch (w) {
+            case BlendWeight::Zero: return fb->literal(t, make_float4(0.f));
+            case BlendWeight::One: return one;
+            case BlendWeight::PrimColor: return src;
+            case BlendWeight::ImgColor: return dst;
+            case BlendWeight::PrimAlpha: return fb->swizzle(t, src, 4u, 0x3333u);
+            case BlendWeight::ImgAlpha: return fb->swizzle(t, dst, 4u, 0x3333u);
+            case BlendWeight::OneMinusPrimColor: return fb->binary(t, BinaryOp::SUB, one, src);
+            case BlendWeight::OneMinusImgColor: return fb->binary(t, BinaryOp::SUB, one, dst);
+            case BlendWeight::OneMinusPrimAlpha: return fb->binary(t, BinaryOp::SUB, one, fb->swizzle(t, src, 4u, 0x3333u));
+            case BlendWeight::OneMinusImgAlpha: return fb->binary(t, BinaryOp::SUB, one, fb->swizzle(t, dst, 4u, 0x3333u));
+        }
+        return one;
+    };
+    auto s = fb->binary(t, BinaryOp::MUL, src, factor(blend.prim_op));
+    auto d = fb->binary(t, BinaryOp::MUL, dst, factor(blend.img_op));
+    return fb->binary(t, blend.op == BlendOp::Add ? BinaryOp::ADD : BinaryOp::SUB, s, d);
+}
+
+// decodes a vertex attribute, missing components default to (0, 0, 0, 1)
+[[nodiscard]] float4 raster_decode_attribute(VertexElementFormat format, const std::byte *p) noexcept {
+    auto v = make_float4(0.f, 0.f, 0.f, 1.f);
+    auto load = [p]<typename T>(size_t i) noexcept {
+        T x;
+        std::memcpy(&x, p + i * sizeof(T), sizeof(T));
+        return x;
+    };
+    switch (format) {
+        case VertexElementFormat::XYZW8UNorm:
+            for (auto i = 0u; i < 4u; i++) { v[i] = static_cast<float>(load.operator()<uint8_t>(i)) * (1.f / 255.f); }
+            break;
+        case VertexElementFormat::XY16UNorm:
+            for (auto i = 0u; i < 2u; i++) { v[i] = static_cast<float>(load.operator()<uint16_t>(i)) * (1.f / 65535.f); }
+            break;
+        case VertexElementFormat::XYZW16UNorm:
+            for (auto i = 0u; i < 4u; i++) { v[i] = static_cast<float>(load.operator()<uint16_t>(i)) * (1.f / 65535.f); }
+            break;
+        case VertexElementFormat::XY16Float:
+            for (auto i = 0u; i < 2u; i++) { v[i] = static_cast<float>(load.operator()<half>(i)); }
+            break;
+        case VertexElementFormat::XYZW16Float:
+            for (auto i = 0u; i < 4u; i++) { v[i] = static_cast<float>(load.operator()<half>(i)); }
+            break;
+        case VertexElementFormat::X32Float: v.x = load.operator()<float>(0u); break;
+        case VertexElementFormat::XY32Float:
+            for (auto i = 0u; i < 2u; i++) { v[i] = load.operator()<float>(i); }
+            break;
+        case VertexElementFormat::XYZ32Float:
+            for (auto i = 0u; i < 3u; i++) { v[i] = load.operator()<float>(i); }
+            break;
+        case VertexElementFormat::XYZW32Float:
+            for (auto i = 0u; i < 4u; i++) { v[i] = load.operator()<float>(i); }
+            break;
+    }
+    return v;
+}
+
+void raster_store_attribute(AppData &v, VertexAttributeType type, float4 x) noexcept {
+    switch (type) {
+        case VertexAttributeType::Position: v.position = x.xyz(); break;
+        case VertexAttributeType::Normal: v.normal = x.xyz(); break;
+        case VertexAttributeType::Tangent: v.tangent = x; break;
+        case VertexAttributeType::Color: v.color = x; break;
+        case VertexAttributeType::UV0: v.uv[0] = x.xy(); break;
+        case VertexAttributeType::UV1: v.uv[1] = x.xy(); break;
+        case VertexAttributeType::UV2: v.uv[2] = x.xy(); break;
+        case VertexAttributeType::UV3: v.uv[3] = x.xy(); break;
+    }
+}
+
+[[nodiscard]] inline bool raster_depth_test(Comparison comparison, float z, float depth) noexcept {
+    switch (comparison) {
+        case Comparison::Never: return false;
+        case Comparison::Less: return z < depth;
+        case Comparison::Equal: return z == depth;
+        case Comparison::LessEqual: return z <= depth;
+        case Comparison::Greater: return z > depth;
+        case Comparison::NotEqual: return z != depth;
+        case Comparison::GreaterEqual: return z >= depth;
+        case Comparison::Always: return true;
+    }
+    return true;
+}
+
+[[nodiscard]] inline auto raster_pack_fragment(uint x, uint y, uint triangle, float b1, float b2) noexcept {
+    return make_uint4(x | (y << 16u), triangle, std::bit_cast<uint>(b1), std::bit_cast<uint>(b2));
+}
+
+}// namespace detail
+
+class RustRasterExt::Shader {
+
+public:
+    struct Pipeline {
+        uint64_t handle;
+        size_t argument_count;
+        size_t uniform_size;
+    };
+
+private:
+    DeviceInterface *_device;
+    MeshFormat _mesh_format;
+    ShaderOption _option;
+    luisa::shared_ptr<const FunctionBuilder> _vertex_callable;
+    luisa::shared_ptr<const FunctionBuilder> _pixel_callable;
+    const Type *_varying;
+    const Type *_output;
+    // unbound arguments of the stages, without the stage inputs
+    luisa::vector<Variable> _vertex_arguments;
+    luisa::vector<Variable> _pixel_arguments;
+    // whether each argument of a draw command is bound to the stages
+    luisa::vector<bool> _bound;
+    size_t _vertex_argument_count;
+    bool _vertex_object_id;
+    bool _pixel_object_id;
+    bool _side_effects{false};
+    Pipeline _vertex{};
+    std::mutex _mutex;
+    luisa::unordered_map<uint64_t, Pipeline> _pixel_pipelines;
+
+public:
+    Shader(DeviceInterface *device, const MeshFormat &mesh_format,
+           Function vert, Function pixel, const ShaderOption &option) noexcept
+        : _device{device}, _mesh_format{mesh_format}, _option{option},
+          _vertex_callable{CallableLibrary::kernel_to_callable(vert)},
+          _pixel_callable{CallableLibrary::kernel_to_callable(pixel)},
+          _varying{vert.return_type()}, _output{pixel.return_type()},
+          _vertex_argument_count{vert.arguments().size() - 1u},
+          _vertex_object_id{detail::raster_uses_object_id(vert, *_vertex_callable)},
+          _pixel_object_id{detail::raster_uses_object_id(pixel, *_pixel_callable)} {
+        // generated kernels must not share a name
+        _option.name.clear();
+        auto collect = [this](Function stage, luisa::vector<Variable> &unbound) noexcept {
+            for (auto i = 1u; i < stage.arguments().size(); i++) {
+                auto bound = !luisa::holds_alternative<luisa::monostate>(stage.bound_arguments()[i]);
+                _bound.emplace_back(bound);
+                if (!bound) { unbound.emplace_back(stage.arguments()[i]); }
+            }
+        };
+        collect(vert, _vertex_arguments);
+        collect(pixel, _pixel_arguments);
+        for (auto arg : pixel.arguments()) {
+            if (arg.is_resource() && (to_underlying(pixel.variable_usage(arg.uid())) & to_underlying(Usage::WRITE))) {
+                _side_effects = true;
+            }
+        }
+        // vertex kernel: transforms the vertices of a mesh, one instance per row
+        auto app_data = vert.arguments()[0].type();
+        auto kernel = FunctionBuilder::define_kernel([&] {
+            auto fb = FunctionBuilder::current();
+            fb->set_block_size(make_uint3(detail::raster_vertex_block_size, 1u, 1u));
+            auto uint_type = Type::of<uint>();
+            auto vertices = fb->buffer(Type::buffer(app_data));
+            auto varyings = fb->buffer(Type::buffer(_varying));
+            auto object_id = fb->argument(uint_type);
+            auto v = fb->local(app_data);
+            luisa::vector<const Expression *> args;
+            args.emplace_back(v);
+            for (auto arg : _vertex_arguments) { args.emplace_back(detail::raster_declare_argument(fb, arg)); }
+            if (_vertex_object_id) { args.emplace_back(object_id); }
+            auto x = fb->swizzle(uint_type, fb->dispatch_id(), 1u, 0x0u);
+            auto y = fb->swizzle(uint_type, fb->dispatch_id(), 1u, 0x1u);
+            auto width = fb->swizzle(uint_type, fb->dispatch_size(), 1u, 0x0u);
+            fb->assign(v, fb->call(app_data, CallOp::BUFFER_READ, {vertices, x}));
+            fb->assign(fb->member(uint_type, v, 6u), y);
+            auto index = fb->binary(uint_type, BinaryOp::ADD, fb->binary(uint_type, BinaryOp::MUL, y, width), x);
+            fb->call(CallOp::BUFFER_WRITE, {varyings, index, fb->call(_varying, _vertex_callable->function(), args)});
+        });
+        _vertex = {.handle = _device->create_shader(_option, kernel->function()).handle,
+                   .argument_count = kernel->unbound_arguments().size(),
+                   .uniform_size = ShaderDispatchCmdEncoder::compute_uniform_size(kernel->unbound_arguments())};
+    }
+
+    ~Shader() noexcept {
+        _device->destroy_shader(_vertex.handle);
+        for (auto &&[key, pipeline] : _pixel_pipelines) {
+            _device->destroy_shader(pipeline.handle);
+        }
+    }
+
+    [[nodiscard]] auto &&mesh_format() const noexcept { return _mesh_format; }
+    [[nodiscard]] auto varying() const noexcept { return _varying; }
+    [[nodiscard]] auto output_count() const noexcept { return detail::raster_member_count(_output); }
+    [[nodiscard]] auto side_effects() const noexcept { return _side_effects; }
+    [[nodiscard]] auto &&vertex_pipeline() const noexcept { return _vertex; }
+    [[nodiscard]] auto bound() const noexcept { return luisa::span{_bound}; }
+    [[nodiscard]] auto vertex_argument_count() const noexcept { return _vertex_argument_count; }
+
+    // pixel kernels depend on the number of render targets and the blend state, like PSOs
+    [[nodiscard]] const Pipeline &pixel_pipeline(uint rtv_count, const BlendState &blend) noexcept {
+        auto key = static_cast<uint64_t>(rtv_count);
+        if (blend.enable_blend) {
+            key |= (1ull << 8u) |
+                   (static_cast<uint64_t>(blend.op) << 16u) |
+                   (static_cast<uint64_t>(blend.prim_op) << 24u) |
+                   (static_cast<uint64_t>(blend.img_op) << 32u);
+        }
+        std::scoped_lock lock{_mutex};
+        if (auto iter = _pixel_pipelines.find(key); iter != _pixel_pipelines.end()) {
+            return iter->second;
+        }
+        auto kernel = FunctionBuilder::define_kernel([&] {
+            auto fb = FunctionBuilder::current();
+            fb->set_block_size(make_uint3(detail::raster_pixel_block_size, 1u, 1u));
+            auto uint_type = Type::of<uint>();
+            auto uint4_type = Type::of<uint4>();
+            auto float_type = Type::of<float>();
+            auto fragments = fb->buffer(Type::buffer(uint4_type));
+            auto triangles = fb->buffer(Type::buffer(uint4_type));
+            auto varyings = fb->buffer(Type::buffer(_varying));
+            luisa::fixed_vector<const Expression *, 8u> targets;
+            for (auto i = 0u; i < rtv_count; i++) {
+                auto elem = detail::raster_target_element(detail::raster_member_type(_output, i));
+                targets.emplace_back(fb->texture(Type::texture(elem, 2u)));
+            }
+            auto p = fb->local(_varying);
+            luisa::vector<const Expression *> args;
+            args.emplace_back(p);
+            for (auto arg : _pixel_arguments) { args.emplace_back(detail::raster_declare_argument(fb, arg)); }
+            // fragment: {x | y << 16, triangle, barycentrics of the second and third vertices}
+            auto fragment = fb->local(uint4_type);
+            fb->assign(fragment, fb->call(uint4_type, CallOp::BUFFER_READ,
+                                          {fragments, fb->swizzle(uint_type, fb->dispatch_id(), 1u, 0x0u)}));
+            // triangle: {vertex indices, object id}
+            auto triangle = fb->local(uint4_type);
+            fb->assign(triangle, fb->call(uint4_type, CallOp::BUFFER_READ,
+                                          {triangles, fb->swizzle(uint_type, fragment, 1u, 0x1u)}));
+            if (_pixel_object_id) { args.emplace_back(fb->swizzle(uint_type, triangle, 1u, 0x3u)); }
+            auto packed = fb->swizzle(uint_type, fragment, 1u, 0x0u);
+            auto x = fb->local(uint_type);
+            auto y = fb->local(uint_type);
+            fb->assign(x, fb->binary(uint_type, BinaryOp::BIT_AND, packed, fb->literal(uint_type, 0xffffu)));
+            fb->assign(y, fb->binary(uint_type, BinaryOp::SHR, packed, fb->literal(uint_type, 16u)));
+            std::array<const Expression *, 3u> b{};
+            std::array<const Expression *, 3u> v{};
+            for (auto k = 0u; k < 3u; k++) {
+                b[k] = fb->local(float_type);
+                v[k] = fb->local(_varying);
+                fb->assign(v[k], fb->call(_varying, CallOp::BUFFER_READ,
+                                          {varyings, fb->swizzle(uint_type, triangle, 1u, k)}));
+            }
+            fb->assign(b[1], fb->cast(float_type, CastOp::BITWISE, fb->swizzle(uint_type, fragment, 1u, 0x2u)));
+            fb->assign(b[2], fb->cast(float_type, CastOp::BITWISE, fb->swizzle(uint_type, fragment, 1u, 0x3u)));
+            fb->assign(b[0], fb->binary(float_type, BinaryOp::SUB,
+                                        fb->binary(float_type, BinaryOp::SUB, fb->literal(float_type, 1.f), b[1]), b[2]));
+            // the barycentrics are perspective-correct, other types are taken from the first vertex
+            for (auto i = 0u; i < detail::raster_member_count(_varying); i++) {
+                auto t = detail::raster_member_type(_varying, i);
+                auto m = [&](const Expression *e) noexcept { return detail::raster_member(fb, _varying, e, i); };
+                if (t->is_float32() || t->is_float32_vector()) {
+                    const Expression *sum = fb->binary(t, BinaryOp::MUL, m(v[0]), b[0]);
+                    for (auto k = 1u; k < 3u; k++) {
+                        sum = fb->binary(t, BinaryOp::ADD, sum, fb->binary(t, BinaryOp::MUL, m(v[k]), b[k]));
+                    }
+                    fb->assign(m(p), sum);
+                } else {
+                    fb->assign(m(p), m(v[0]));
+                }
+            }
+            // the position becomes (pixel center, z / w, w), as SV_Position
+            auto position = detail::raster_member(fb, _varying, p, 0u);
+            auto w = fb->local(float_type);
+            fb->assign(w, fb->swizzle(float_type, position, 1u, 0x3u));
+            auto half = fb->literal(float_type, .5f);
+            fb->assign(position, fb->call(
+                                     Type::of<float4>(), CallOp::MAKE_FLOAT4,
+                                     {fb->binary(float_type, BinaryOp::ADD, fb->cast(float_type, CastOp::STATIC, x), half),
+                                      fb->binary(float_type, BinaryOp::ADD, fb->cast(float_type, CastOp::STATIC, y), half),
+                                      fb->binary(float_type, BinaryOp::DIV, fb->swizzle(float_type, position, 1u, 0x2u), w),
+                                      w}));
+            if (_output == nullptr) {
+                fb->call(_pixel_callable->function(), args);
+                return;
+            }
+            auto output = fb->local(_output);
+            fb->assign(output, fb->call(_output, _pixel_callable->function(), args));
+            auto coord = fb->call(Type::of<uint2>(), CallOp::MAKE_UINT2, {x, y});
+            for (auto i = 0u; i < rtv_count; i++) {
+                auto t = detail::raster_member_type(_output, i);
+                auto elem = detail::raster_target_element(t);
+                const Expression *value = detail::raster_expand(fb, t, detail::raster_member(fb, _output, output, i));
+                if (blend.enable_blend && elem->is_float32()) {
+                    auto src = fb->local(Type::of<float4>());
+                    auto dst = fb->local(Type::of<float4>());
+                    fb->assign(src, value);
+                    fb->assign(dst, fb->call(Type::of<float4>(), CallOp::TEXTURE_READ, {targets[i], coord}));
+                    value = detail::raster_blend(fb, blend, src, dst);
+                }
+                fb->call(CallOp::TEXTURE_WRITE, {targets[i], coord, value});
+            }
+        });
+        Pipeline pipeline{.handle = _device->create_shader(_option, kernel->function()).handle,
+                          .argument_count = kernel->unbound_arguments().size(),
+                          .uniform_size = ShaderDispatchCmdEncoder::compute_uniform_size(kernel->unbound_arguments())};
+        LUISA_VERBOSE("Created raster pipeline {:016x} with {} render target(s).", kernel->hash(), rtv_count);
+        return _pixel_pipelines.try_emplace(key, pipeline).first->second;
+    }
+};
+
+struct RustRasterExt::DepthBuffer {
+    uint64_t handle;
+    DepthFormat format;
+    uint2 size;
+    luisa::vector<float> data;
+    // D16 and D32S8A24 are converted before the upload to the texture
+    luisa::vector<std::byte> staging;
+};
+
+RustRasterExt::RustRasterExt(DeviceInterface *device) noexcept
+    : _device{device} {}
+
+RustRasterExt::~RustRasterExt() noexcept {
+    for (auto scratch : {&_vertices, &_varyings, &_triangles, &_fragments}) {
+        if (scratch->handle != invalid_resource_handle) { _device->destroy_buffer(scratch->handle); }
+    }
+}
+
+std::byte *RustRasterExt::_reserve(Scratch &scratch, size_t size_bytes) noexcept {
+    if (scratch.size_bytes < size_bytes) {
+        if (scratch.handle != invalid_resource_handle) { _device->destroy_buffer(scratch.handle); }
+        // grow geometrically, the buffers are only touched after the stream has drained
+        auto n = (std::max(size_bytes, scratch.size_bytes * 3u / 2u) + sizeof(uint4) - 1u) / sizeof(uint4);
+        auto info = _device->create_buffer(Type::of<uint4>(), n);
+        scratch.handle = info.handle;
+        scratch.size_bytes = info.total_size_bytes;
+        scratch.data = reinterpret_cast<const RustBufferLayout *>(info.handle)->data;
+    }
+    return scratch.data;
+}
+
+ResourceCreationInfo RustRasterExt::create_raster_shader(const MeshFormat &mesh_format, Function vert,
+                                                         Function pixel, const ShaderOption &shader_option) noexcept {
+    if (pixel.propagated_builtin_callables().test(CallOp::RASTER_DISCARD)) {
+        LUISA_WARNING_WITH_LOCATION("Discarding pixels is not supported by the CPU rasterizer.");
+        return ResourceCreationInfo::make_invalid();
+    }
+    if (vert.arguments().empty() || pixel.arguments().empty() ||
+        vert.arguments()[0].type()->size() != sizeof(AppData)) {
+        LUISA_WARNING_WITH_LOCATION("Invalid raster stage arguments.");
+        return ResourceCreationInfo::make_invalid();
+    }
+    auto varying = vert.return_type();
+    auto valid_varying = varying != nullptr && varying == pixel.arguments()[0].type() &&
+                         detail::raster_member_type(varying, 0u) == Type::of<float4>();
+    for (auto i = 0u; valid_varying && i < detail::raster_member_count(varying); i++) {
+        auto t = detail::raster_member_type(varying, i);
+        valid_varying = t->is_scalar() || t->is_vector();
+    }
+    auto output = pixel.return_type();
+    auto valid_output = detail::raster_member_count(output) <= 8u;
+    for (auto i = 0u; valid_output && i < detail::raster_member_count(output); i++) {
+        valid_output = detail::raster_target_element(detail::raster_member_type(output, i)) != nullptr;
+    }
+    if (!valid_varying || !valid_output) {
+        LUISA_WARNING_WITH_LOCATION(
+            "Raster stages must pass scalars or vectors, starting with the position, "
+            "and write at most 8 scalar or vector outputs on the CPU backend.");
+        return ResourceCreationInfo::make_invalid();
+    }
+    auto shader = luisa::new_with_allocator<Shader>(_device, mesh_format, vert, pixel, shader_option);
+    return {.handle = reinterpret_cast<uint64_t>(shader), .native_handle = shader};
+}
+
+ResourceCreationInfo RustRasterExt::load_raster_shader(const MeshFormat &mesh_format,
+                                                       luisa::span<Type const *const> types,
+                                                       luisa::string_view ser_path) noexcept {
+    LUISA_WARNING_WITH_LOCATION("Loading raster shaders is not supported on the CPU backend.");
+    return ResourceCreationInfo::make_invalid();
+}
+
+void RustRasterExt::warm_up_pipeline_cache(uint64_t shader_handle,
+                                           luisa::span<PixelFormat const> render_target_formats,
+                                           DepthFormat depth_format,
+                                           const RasterState &state) noexcept {
+    auto shader = reinterpret_cast<Shader *>(shader_handle);
+    auto rtv_count = std::min(render_target_formats.size(), shader->output_count());
+    static_cast<void>(shader->pixel_pipeline(static_cast<uint>(rtv_count), state.blend_state));
+}
+
+void RustRasterExt::destroy_raster_shader(uint64_t handle) noexcept {
+    luisa::delete_with_allocator(reinterpret_cast<Shader *>(handle));
+}
+
+ResourceCreationInfo RustRasterExt::create_depth_buffer(DepthFormat format, uint width, uint height) noexcept {
+    // the depth is kept on the host, the texture is what DepthBuffer::to_img() views
+    auto pixel_format = [format] {
+        switch (format) {
+            case DepthFormat::D16: return PixelFormat::R16UNorm;
+            case DepthFormat::D32S8A24: return PixelFormat::RG32F;
+            default: break;
+        }
+        return PixelFormat::R32F;
+    }();
+    auto info = _device->create_texture(pixel_format, 2u, width, height, 1u, 1u, false);
+    auto depth = luisa::make_unique<DepthBuffer>();
+    depth->handle = info.handle;
+    depth->format = format;
+    depth->size = make_uint2(width, height);
+    depth->data.resize(static_cast<size_t>(width) * height, 1.f);
+    std::scoped_lock lock{_resource_mutex};
+    _depth_buffers.try_emplace(info.handle, std::move(depth));
+    return info;
+}
+
+void RustRasterExt::destroy_depth_buffer(uint64_t handle) noexcept {
+    {
+        std::scoped_lock lock{_resource_mutex};
+        _depth_buffers.erase(handle);
+    }
+    _device->destroy_texture(handle);
+}
+
+void RustRasterExt::register_texture(uint64_t handle, uint2 size) noexcept {
+    std::scoped_lock lock{_resource_mutex};
+    _texture_sizes.insert_or_assign(handle, size);
+}
+
+void RustRasterExt::unregister_texture(uint64_t handle) noexcept {
+    std::scoped_lock lock{_resource_mutex};
+    _texture_sizes.erase(handle);
+}
+
+uint2 RustRasterExt::_texture_size(uint64_t handle, uint level) noexcept {
+    std::scoped_lock lock{_resource_mutex};
+    auto iter = _texture_sizes.find(handle);
+    LUISA_ASSERT(iter != _texture_sizes.end(), "Texture {:016x} not found.", handle);
+    return max(iter->second >> level, make_uint2(1u));
+}
+
+RustRasterExt::DepthBuffer *RustRasterExt::_depth_buffer(uint64_t handle) noexcept {
+    std::scoped_lock lock{_resource_mutex};
+    auto iter = _depth_buffers.find(handle);
+    LUISA_ASSERT(iter != _depth_buffers.end(), "Depth buffer {:016x} not found.", handle);
+    return iter->second.get();
+}
+
+void RustRasterExt::_upload_depth(CommandList &list, DepthBuffer &depth) noexcept {
+    auto size = make_uint3(depth.size, 1u);
+    switch (depth.format) {
+        case DepthFormat::D16: {
+            depth.staging.resize(depth.data.size() * sizeof(uint16_t));
+            auto p = reinterpret_cast<uint16_t *>(depth.staging.data());
+            for (auto i = 0u; i < depth.data.size(); i++) {
+                p[i] = static_cast<uint16_t>(std::clamp(depth.data[i], 0.f, 1.f) * 65535.f + .5f);
+            }
+            list << luisa::make_unique<TextureUploadCommand>(depth.handle, PixelStorage::SHORT1, 0u, size, p);
+            break;
+        }
+        case DepthFormat::D32S8A24: {
+            depth.staging.resize(depth.data.size() * sizeof(float2));
+            auto p = reinterpret_cast<float2 *>(depth.staging.data());
+            for (auto i = 0u; i < depth.data.size(); i++) { p[i] = make_float2(depth.data[i], 0.f); }
+            list << luisa::make_unique<TextureUploadCommand>(depth.handle, PixelStorage::FLOAT2, 0u, size, p);
+            break;
+        }
+        default:
+            list << luisa::make_unique<TextureUploadCommand>(depth.handle, PixelStorage::FLOAT1, 0u, size, depth.data.data());
+            break;
+    }
+}
+
+struct RustRasterExt::Draw {
+
+    struct Mesh {
+        const RasterMesh *mesh;
+        uint vertex_count;
+        uint index_count;
+        const uint *indices;
+        size_t vertex_offset;
+        size_t varying_offset;
+        size_t triangle_offset;
+        size_t triangle_count;
+    };
+
+    static constexpr auto tile = static_cast<int>(tile_size);
+    static constexpr auto block = static_cast<int>(block_size);
+
+    RustRasterExt &ext;
+    uint64_t stream;
+    const DrawRasterSceneCommand *command;
+    Shader *shader;
+    const RasterState &state;
+    DepthBuffer *depth;
+    int4 clip;// [min_x, min_y, max_x, max_y)
+    uint rtv_count;
+    size_t varying_stride;
+    luisa::vector<Mesh> meshes;
+    size_t varying_count{0u};
+    size_t triangle_count{0u};
+    uint2 tile_count;
+
+    void encode_arguments(ComputeDispatchCmdEncoder &encoder, size_t begin, size_t count) const noexcept {
+        auto bound = shader->bound();
+        auto args = command->arguments();
+        for (auto i = begin; i < begin + count; i++) {
+            if (bound[i]) { continue; }
+            auto &&arg = args[i];
+            switch (arg.tag) {
+                case Argument::Tag::BUFFER:
+                    encoder.encode_buffer(arg.buffer.handle, arg.buffer.offset, arg.buffer.size);
+                    break;
+                case Argument::Tag::TEXTURE:
+                    encoder.encode_texture(arg.texture.handle, arg.texture.level);
+                    break;
+                case Argument::Tag::UNIFORM: {
+                    auto data = command->uniform(arg.uniform);
+                    encoder.encode_uniform(data.data(), data.size());
+                    break;
+                }
+                case Argument::Tag::BINDLESS_ARRAY:
+                    encoder.encode_bindless_array(arg.bindless_array.handle);
+                    break;
+                case Argument::Tag::ACCEL:
+                    encoder.encode_accel(arg.accel.handle);
+                    break;
+            }
+        }
+    }
+
+    // assembles the vertices on the host and runs the vertex kernel on each mesh
+    void transform() noexcept {
+        auto &&format = shader->mesh_format();
+        auto vertex_count = static_cast<size_t>(0u);
+        for (auto &&mesh : command->scene()) {
+            auto streams = mesh.vertex_buffers();
+            if (streams.size() != format.vertex_stream_count()) {
+                LUISA_WARNING_WITH_LOCATION("Mesh has {} vertex stream(s) but {} are expected. Skipping.",
+                                            streams.size(), format.vertex_stream_count());
+                continue;
+            }
+            Mesh m{.mesh = &mesh, .vertex_count = std::numeric_limits<uint>::max(), .indices = nullptr};
+            for (auto &&s : streams) {
+                m.vertex_count = std::min(m.vertex_count, static_cast<uint>(s.size() / s.stride()));
+            }
+            luisa::visit(
+                [&]<typename T>(const T &index) noexcept {
+                    if constexpr (std::is_same_v<T, uint>) {
+                        m.index_count = index;
+                        m.vertex_count = std::min(m.vertex_count, index);
+                    } else {
+                        m.index_count = static_cast<uint>(index.size());
+                        m.indices = reinterpret_cast<const uint *>(
+                            reinterpret_cast<const RustBufferLayout *>(index.handle())->data + index.offset_bytes());
+                        if (streams.empty()) {
+                            auto max_index = std::max_element(m.indices, m.indices + m.index_count);
+                            m.vertex_count = max_index == m.indices + m.index_count ? 0u : *max_index + 1u;
+                        }
+                    }
+                },
+                mesh.index());
+            m.triangle_count = static_cast<size_t>(m.index_count / 3u) * mesh.instance_count();
+            if (m.vertex_count == 0u || m.triangle_count == 0u) { continue; }
+            m.vertex_offset = vertex_count;
+            m.varying_offset = varying_count;
+            m.triangle_offset = triangle_count;
+            vertex_count += m.vertex_count;
+            varying_count += static_cast<size_t>(m.vertex_count) * mesh.instance_count();
+            triangle_count += m.triangle_count;
+            meshes.emplace_back(m);
+        }
+        if (meshes.empty()) { return; }
+        auto vertices = reinterpret_cast<AppData *>(ext._reserve(ext._vertices, vertex_count * sizeof(AppData)));
+        static_cast<void>(ext._reserve(ext._varyings, varying_count * varying_stride));
+        struct Chunk {
+            const Mesh *mesh;
+            uint begin;
+            uint end;
+        };
+        luisa::vector<Chunk> chunks;
+        for (auto &&m : meshes) {
+            for (auto begin = 0u; begin < m.vertex_count; begin += detail::raster_vertex_chunk_size) {
+                chunks.emplace_back(Chunk{&m, begin, std::min(begin + detail::raster_vertex_chunk_size, m.vertex_count)});
+            }
+        }
+        parallel_for(ext._pool, chunks.size(), [&](size_t i) noexcept {
+            auto c = chunks[i];
+            auto streams = c.mesh->mesh->vertex_buffers();
+            for (auto v = c.begin; v < c.end; v++) {
+                AppData a{};
+                a.vertex_id = v;
+                for (auto s = 0u; s < streams.size(); s++) {
+                    auto view = streams[s];
+                    auto p = reinterpret_cast<const RustBufferLayout *>(view.handle())->data +
+                             view.offset() + v * view.stride();
+                    // attributes are packed in the order of the mesh format
+                    for (auto attr : format.attributes(s)) {
+                        detail::raster_store_attribute(a, attr.type, detail::raster_decode_attribute(attr.format, p));
+                        p += VertexElementFormatStride(attr.format);
+                    }
+                }
+                vertices[c.mesh->vertex_offset + v] = a;
+            }
+        });
+        auto &&pipeline = shader->vertex_pipeline();
+        CommandList list;
+        for (auto &&m : meshes) {
+            ComputeDispatchCmdEncoder encoder{pipeline.handle, pipeline.argument_count, pipeline.uniform_size};
+            auto instance_count = m.mesh->instance_count();
+            encoder.encode_buffer(ext._vertices.handle, m.vertex_offset * sizeof(AppData), m.vertex_count * sizeof(AppData));
+            encoder.encode_buffer(ext._varyings.handle, m.varying_offset * varying_stride,
+                                  static_cast<size_t>(m.vertex_count) * instance_count * varying_stride);
+            auto object_id = m.mesh->object_id();
+            encoder.encode_uniform(&object_id, sizeof(object_id));
+            encode_arguments(encoder, 0u, shader->vertex_argument_count());
+            encoder.set_dispatch_size(make_uint3(m.vertex_count, instance_count, 1u));
+            list << std::move(encoder).build();
+        }
+        ext._device->dispatch(stream, list.commit().command_list());
+        ext._device->synchronize_stream(stream);
+    }
+
+    // the largest values of the edge functions over the pixel centers of a rectangle
+    [[nodiscard]] static bool overlaps(const Triangle &s, int4 rect) noexcept {
+        for (auto i = 0u; i < 3u; i++) {
+            auto x = s.a[i] > 0.f ? rect.z - .5 : rect.x + .5;
+            auto y = s.b[i] > 0.f ? rect.w - .5 : rect.y + .5;
+            if (s.c[i] + s.a[i] * x + s.b[i] * y < 0.) { return false; }
+        }
+        return true;
+    }
+
+    [[nodiscard]] static int4 intersect(int4 a, int4 b) noexcept {
+        return make_int4(std::max(a.x, b.x), std::max(a.y, b.y), std::min(a.z, b.z), std::min(a.w, b.w));
+    }
+
+    template<typename F>
+    void for_each_tile(const Triangle &s, F &&f) const noexcept {
+        auto x0 = (s.bbox.x - clip.x) / tile;
+        auto y0 = (s.bbox.y - clip.y) / tile;
+        auto x1 = (s.bbox.z - 1 - clip.x) / tile;
+        auto y1 = (s.bbox.w - 1 - clip.y) / tile;
+        for (auto ty = y0; ty <= y1; ty++) {
+            for (auto tx = x0; tx <= x1; tx++) {
+                auto rect = make_int4(clip.x + tx * tile, clip.y + ty * tile,
+                                      clip.x + (tx + 1) * tile, clip.y + (ty + 1) * tile);
+                if (overlaps(s, intersect(rect, s.bbox))) {
+                    f(static_cast<uint>(ty) * tile_count.x + static_cast<uint>(tx));
+                }
+            }
+        }
+    }
+
+    // 2D homogeneous triangle setup [Olano and Greer 1997], returns false if the triangle is culled
+    [[nodiscard]] bool setup(Triangle &s, uint4 triangle) const noexcept {
+        std::array<float4, 3u> p{};
+        for (auto k = 0u; k < 3u; k++) {
+            std::memcpy(&p[k], ext._varyings.data + triangle[k] * varying_stride, sizeof(float4));
+        }
+        auto all = [&p](auto &&f) noexcept { return f(p[0]) && f(p[1]) && f(p[2]); };
+        if (all([](float4 v) { return v.w <= 0.f; }) ||
+            all([](float4 v) { return v.x > v.w; }) || all([](float4 v) { return v.x < -v.w; }) ||
+            all([](float4 v) { return v.y > v.w; }) || all([](float4 v) { return v.y < -v.w; })) {
+            return false;
+        }
+        if (state.depth_clip && (all([](float4 v) { return v.z < 0.f; }) || all([](float4 v) { return v.z > v.w; }))) {
+            return false;
+        }
+        // viewport transform, applied before the division by w
+        auto vp = command->viewport();
+        auto h = vp.size * .5f;
+        auto o = vp.start + h;
+        std::array<std::array<double, 3u>, 3u> v{};
+        for (auto k = 0u; k < 3u; k++) {
+            v[k] = {static_cast<double>(p[k].x) * h.x + static_cast<double>(p[k].w) * o.x,
+                    -static_cast<double>(p[k].y) * h.y + static_cast<double>(p[k].w) * o.y,
+                    static_cast<double>(p[k].w)};
+        }
+        auto cross = [](const std::array<double, 3u> &a, const std::array<double, 3u> &b) noexcept {
+            return std::array<double, 3u>{a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+        };
+        // rows of the adjugate of [v0 v1 v2] are the edge functions
+        std::array<std::array<double, 3u>, 3u> e{cross(v[1], v[2]), cross(v[2], v[0]), cross(v[0], v[1])};
+        auto det = v[0][0] * e[0][0] + v[0][1] * e[0][1] + v[0][2] * e[0][2];
+        if (det == 0. || !std::isfinite(det)) { return false; }
+        // the determinant is positive for clockwise triangles
+        auto front = (det > 0.) != state.front_counter_clockwise;
+        if ((state.cull_mode == CullMode::Back && !front) ||
+            (state.cull_mode == CullMode::Front && front)) {
+            return false;
+        }
+        auto sign = det > 0. ? 1. : -1.;
+        auto inv_det = 1. / std::abs(det);
+        auto za = 0., zb = 0., zc = 0.;
+        for (auto i = 0u; i < 3u; i++) {
+            auto a = sign * e[i][0];
+            auto b = sign * e[i][1];
+            s.a[i] = static_cast<float>(a);
+            s.b[i] = static_cast<float>(b);
+            s.c[i] = sign * e[i][2];
+            // top-left rule: pixels on an edge belong to the triangle to its right or below
+            s.top_left[i] = a > 0. || (a == 0. && b > 0.);
+            // z / w is linear in screen space: sum(E_i * z_i) / |det|
+            za += a * p[i].z;
+            zb += b * p[i].z;
+            zc += s.c[i] * p[i].z;
+        }
+        s.za = static_cast<float>(za * inv_det);
+        s.zb = static_cast<float>(zb * inv_det);
+        s.zc = zc * inv_det;
+        s.bbox = clip;
+        if (all([](float4 v) { return v.w > 0.f; })) {
+            auto min_x = std::numeric_limits<double>::max(), min_y = min_x;
+            auto max_x = -min_x, max_y = -min_x;
+            for (auto k = 0u; k < 3u; k++) {
+                auto x = v[k][0] / v[k][2];
+                auto y = v[k][1] / v[k][2];
+                min_x = std::min(min_x, x), max_x = std::max(max_x, x);
+                min_y = std::min(min_y, y), max_y = std::max(max_y, y);
+            }
+            s.bbox = intersect(clip, make_int4(static_cast<int>(std::max(std::floor(min_x), -1.)),
+                                               static_cast<int>(std::max(std::floor(min_y), -1.)),
+                                               static_cast<int>(std::min(std::ceil(max_x), 65536.)),
+                                               static_cast<int>(std::min(std::ceil(max_y), 65536.))));
+        }
+        return s.bbox.x < s.bbox.z && s.bbox.y < s.bbox.w;
+    }
+
+    // sets up the triangles and bins them into tiles in primitive order
+    void bin() noexcept {
+        auto triangles = reinterpret_cast<uint4 *>(ext._reserve(ext._triangles, triangle_count * sizeof(uint4)));
+        tile_count = make_uint2((clip.z - clip.x + tile_size - 1u) / tile_size,
+                                (clip.w - clip.y + tile_size - 1u) / tile_size);
+        auto tiles = static_cast<size_t>(tile_count.x) * tile_count.y;
+        auto chunk_count = (triangle_count + detail::raster_triangle_chunk_size - 1u) / detail::raster_triangle_chunk_size;
+        ext._setups.resize(triangle_count);
+        ext._bin_counts.resize(chunk_count * tiles);
+        std::fill(ext._bin_counts.begin(), ext._bin_counts.end(), 0u);
+        auto chunk_range = [this](size_t c) noexcept {
+            auto begin = c * detail::raster_triangle_chunk_size;
+            return std::make_pair(begin, std::min(begin + detail::raster_triangle_chunk_size, triangle_count));
+        };
+        // pass 1: set up the triangles and count them per chunk and tile
+        parallel_for(ext._pool, chunk_count, [&](size_t c) noexcept {
+            auto [begin, end] = chunk_range(c);
+            auto counts = ext._bin_counts.data() + c * tiles;
+            auto mesh = std::upper_bound(meshes.cbegin(), meshes.cend(), begin,
+                                         [](size_t t, const Mesh &m) noexcept { return t < m.triangle_offset; }) -
+                        1;
+            for (auto t = begin; t < end; t++) {
+                while (t >= mesh->triangle_offset + mesh->triangle_count) { ++mesh; }
+                auto local = t - mesh->triangle_offset;
+                auto per_instance = mesh->index_count / 3u;
+                auto instance = local / per_instance;
+                auto first = (local % per_instance) * 3u;
+                auto base = mesh->varying_offset + instance * mesh->vertex_count;
+                auto valid = true;
+                uint4 triangle{0u, 0u, 0u, mesh->mesh->object_id()};
+                for (auto k = 0u; k < 3u; k++) {
+                    auto index = mesh->indices == nullptr ? static_cast<uint>(first + k) : mesh->indices[first + k];
+                    valid &= index < mesh->vertex_count;
+                    triangle[k] = static_cast<uint>(base + (index < mesh->vertex_count ? index : 0u));
+                }
+                triangles[t] = triangle;
+                auto &&s = ext._setups[t];
+                if (!valid || !setup(s, triangle)) {
+                    s.bbox = make_int4(0);
+                    continue;
+                }
+                for_each_tile(s, [counts](uint tile) noexcept { counts[tile]++; });
+            }
+        });
+        // exclusive scan, tile-major so that the bins of each tile are contiguous
+        ext._tiles.resize(tiles);
+        auto offset = 0u;
+        for (auto t = 0u; t < tiles; t++) {
+            ext._tiles[t].begin = offset;
+            for (auto c = 0u; c < chunk_count; c++) {
+                auto &&n = ext._bin_counts[c * tiles + t];
+                offset += std::exchange(n, offset);
+            }
+            ext._tiles[t].end = offset;
+        }
+        // pass 2: scatter the triangles into the bins
+        ext._bins.resize(offset);
+        parallel_for(ext._pool, chunk_count, [&](size_t c) noexcept {
+            auto [begin, end] = chunk_range(c);
+            auto offsets = ext._bin_counts.data() + c * tiles;
+            for (auto t = begin; t < end; t++) {
+                auto &&s = ext._setups[t];
+                if (s.bbox.x >= s.bbox.z) { continue; }
+                for_each_tile(s, [&](uint tile) noexcept { ext._bins[offsets[tile]++] = static_cast<uint>(t); });
+            }
+        });
+    }
+
+    // rasterizes the tiles in parallel and collects the fragments that pass the depth test
+    void rasterize() noexcept {
+        auto resolve = !state.blend_state.enable_blend && !shader->side_effects();
+        auto depth_test = depth != nullptr && state.depth_state.enable_depth;
+        auto depth_write = depth_test && state.depth_state.write;
+        auto comparison = state.depth_state.comparison;
+        constexpr auto pixel_count = tile_size * tile_size;
+        parallel_for(ext._pool, ext._tiles.size(), [&](size_t t) noexcept {
+            auto &&tile = ext._tiles[t];
+            tile.layer_count = 0u;
+            if (tile.begin == tile.end) { return; }
+            auto tx = static_cast<int>(t % tile_count.x);
+            auto ty = static_cast<int>(t / tile_count.x);
+            auto rect = intersect(clip, make_int4(clip.x + tx * tile, clip.y + ty * tile,
+                                                  clip.x + (tx + 1) * tile, clip.y + (ty + 1) * tile));
+            if (resolve) {
+                tile.visible.resize(pixel_count);
+                std::fill(tile.visible.begin(), tile.visible.end(), make_uint4(0u, ~0u, 0u, 0u));
+            } else {
+                tile.overdraw.resize(pixel_count);
+                std::fill(tile.overdraw.begin(), tile.overdraw.end(), static_cast<uint16_t>(0u));
+            }
+            auto emit = [&](uint x, uint y, uint triangle, float b1, float b2) noexcept {
+                auto fragment = detail::raster_pack_fragment(x, y, triangle, b1, b2);
+                auto local = (y - static_cast<uint>(rect.y)) * tile_size + (x - static_cast<uint>(rect.x));
+                if (resolve) {
+                    tile.visible[local] = fragment;
+                    return;
+                }
+                auto layer = tile.overdraw[local]++;
+                if (layer >= tile.layers.size()) { tile.layers.emplace_back(); }
+                if (layer >= tile.layer_count) {
+                    tile.layers[layer].clear();
+                    tile.layer_count = layer + 1u;
+                }
+                tile.layers[layer].emplace_back(fragment);
+            };
+            for (auto i = tile.begin; i < tile.end; i++) {
+                auto triangle = ext._bins[i];
+                auto &&s = ext._setups[triangle];
+                auto r = intersect(rect, s.bbox);
+                // 8x8 blocks aligned to the tile
+                for (auto by = rect.y + (r.y - rect.y) / block * block; by < r.w; by += block) {
+                    for (auto bx = rect.x + (r.x - rect.x) / block * block; bx < r.z; bx += block) {
+                        auto br = intersect(r, make_int4(bx, by, bx + block, by + block));
+                        if (!overlaps(s, br)) { continue; }
+                        // edge functions and depth at the first pixel center of the block
+                        std::array<float, 3u> e0{};
+                        for (auto k = 0u; k < 3u; k++) {
+                            e0[k] = static_cast<float>(s.c[k] + s.a[k] * (bx + .5) + s.b[k] * (by + .5));
+                        }
+                        auto z0 = static_cast<float>(s.zc + s.za * (bx + .5) + s.zb * (by + .5));
+                        // 2x2 quads aligned to the block, evaluated 4-wide
+                        for (auto qy = by + ((br.y - by) & ~1); qy < br.w; qy += 2) {
+                            for (auto qx = bx + ((br.x - bx) & ~1); qx < br.z; qx += 2) {
+                                std::array<std::array<float, 4u>, 3u> e{};
+                                std::array<float, 4u> z{};
+                                auto mask = 0u;
+                                for (auto q = 0u; q < 4u; q++) {
+                                    auto dx = static_cast<float>(qx - bx + static_cast<int>(q & 1u));
+                                    auto dy = static_cast<float>(qy - by + static_cast<int>(q >> 1u));
+                                    for (auto k = 0u; k < 3u; k++) { e[k][q] = e0[k] + s.a[k] * dx + s.b[k] * dy; }
+                                    z[q] = z0 + s.za * dx + s.zb * dy;
+                                }
+                                for (auto q = 0u; q < 4u; q++) {
+                                    auto x = qx + static_cast<int>(q & 1u);
+                                    auto y = qy + static_cast<int>(q >> 1u);
+                                    auto inside = x >= br.x && x < br.z && y >= br.y && y < br.w &&
+                                                  e[0][q] + e[1][q] + e[2][q] > 0.f;
+                                    for (auto k = 0u; k < 3u; k++) {
+                                        inside &= e[k][q] > 0.f || (e[k][q] == 0.f && s.top_left[k]);
+                                    }
+                                    mask |= static_cast<uint>(inside) << q;
+                                }
+                                for (auto q = 0u; mask != 0u && q < 4u; q++) {
+                                    if ((mask & (1u << q)) == 0u) { continue; }
+                                    auto x = static_cast<uint>(qx) + (q & 1u);
+                                    auto y = static_cast<uint>(qy) + (q >> 1u);
+                                    auto zq = z[q];
+                                    if (state.depth_clip) {
+                                        if (zq < 0.f || zq > 1.f) { continue; }
+                                    } else {
+                                        zq = std::clamp(zq, 0.f, 1.f);
+                                    }
+                                    if (depth_test) {
+                                        auto &&d = depth->data[y * depth->size.x + x];
+                                        if (!detail::raster_depth_test(comparison, zq, d)) { continue; }
+                                        if (depth_write) { d = zq; }
+                                    }
+                                    auto sum = e[0][q] + e[1][q] + e[2][q];
+                                    emit(x, y, triangle, e[1][q] / sum, e[2][q] / sum);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            if (resolve) {
+                // emit the visible fragments quad by quad
+                if (tile.layers.empty()) { tile.layers.emplace_back(); }
+                auto &&fragments = tile.layers.front();
+                fragments.clear();
+                auto w = static_cast<uint>(rect.z - rect.x);
+                auto h = static_cast<uint>(rect.w - rect.y);
+                for (auto qy = 0u; qy < h; qy += 2u) {
+                    for (auto qx = 0u; qx < w; qx += 2u) {
+                        for (auto q = 0u; q < 4u; q++) {
+                            auto x = qx + (q & 1u);
+                            auto y = qy + (q >> 1u);
+                            if (x < w && y < h) {
+                                auto f = tile.visible[y * tile_size + x];
+                                if (f.y != ~0u) { fragments.emplace_back(f); }
+                            }
+                        }
+                    }
+                }
+                tile.layer_count = fragments.empty() ? 0u : 1u;
+            }
+        });
+    }
+
+    // shades the fragments layer by layer and uploads the depth
+    void shade() noexcept {
+        auto tiles = ext._tiles.size();
+        auto layer_count = 0u;
+        for (auto &&tile : ext._tiles) { layer_count = std::max(layer_count, tile.layer_count); }
+        CommandList list;
+        if (layer_count != 0u) {
+            // fragments are stored layer by layer, tile by tile within each layer
+            luisa::vector<size_t> offsets(tiles * layer_count + 1u);
+            auto offset = static_cast<size_t>(0u);
+            for (auto layer = 0u; layer < layer_count; layer++) {
+                for (auto t = 0u; t < tiles; t++) {
+                    offsets[layer * tiles + t] = offset;
+                    auto &&tile = ext._tiles[t];
+                    if (layer < tile.layer_count) { offset += tile.layers[layer].size(); }
+                }
+            }
+            offsets.back() = offset;
+            auto fragments = reinterpret_cast<uint4 *>(ext._reserve(ext._fragments, offset * sizeof(uint4)));
+            parallel_for(ext._pool, tiles, [&](size_t t) noexcept {
+                auto &&tile = ext._tiles[t];
+                for (auto layer = 0u; layer < tile.layer_count; layer++) {
+                    auto &&f = tile.layers[layer];
+                    std::memcpy(fragments + offsets[layer * tiles + t], f.data(), f.size() * sizeof(uint4));
+                }
+            });
+            auto &&pipeline = shader->pixel_pipeline(rtv_count, state.blend_state);
+            auto rtvs = command->rtv_texs();
+            for (auto layer = 0u; layer < layer_count; layer++) {
+                auto begin = offsets[layer * tiles];
+                auto size = offsets[(layer + 1u) * tiles] - begin;
+                if (size == 0u) { continue; }
+                ComputeDispatchCmdEncoder encoder{pipeline.handle, pipeline.argument_count, pipeline.uniform_size};
+                encoder.encode_buffer(ext._fragments.handle, begin * sizeof(uint4), size * sizeof(uint4));
+                encoder.encode_buffer(ext._triangles.handle, 0u, triangle_count * sizeof(uint4));
+                encoder.encode_buffer(ext._varyings.handle, 0u, varying_count * varying_stride);
+                for (auto i = 0u; i < rtv_count; i++) {
+                    encoder.encode_texture(rtvs[i].handle, rtvs[i].level);
+                }
+                auto vertex_argument_count = shader->vertex_argument_count();
+                encode_arguments(encoder, vertex_argument_count, shader->bound().size() - vertex_argument_count);
+                encoder.set_dispatch_size(make_uint3(static_cast<uint>(size), 1u, 1u));
+                list << std::move(encoder).build();
+            }
+        }
+        if (depth != nullptr && state.depth_state.enable_depth && state.depth_state.write) {
+            ext._upload_depth(list, *depth);
+        }
+        if (!list.empty()) {
+            ext._device->dispatch(stream, list.commit().command_list());
+            // the scratch memory is reused by the next raster command
+            ext._device->synchronize_stream(stream);
+        }
+    }
+};
+
+void RustRasterExt::_draw(uint64_t stream_handle, const DrawRasterSceneCommand *command) noexcept {
+    auto shader = reinterpret_cast<Shader *>(command->handle());
+    auto &&state = command->raster_state();
+    if (state.topology != TopologyType::Triangle || state.fill_mode != FillMode::Solid) {
+        LUISA_WARNING_WITH_LOCATION("Only solid triangles are supported by the CPU rasterizer. Skipping draw.");
+        return;
+    }
+    if (state.stencil_state.enable_stencil) {
+        LUISA_WARNING_WITH_LOCATION("Stencil tests are not supported by the CPU rasterizer and will be ignored.");
+    }
+    if (command->arguments().size() != shader->bound().size()) {
+        LUISA_WARNING_WITH_LOCATION("Draw has {} argument(s) but the raster shader expects {}. Skipping draw.",
+                                    command->arguments().size(), shader->bound().size());
+        return;
+    }
+    // clip against the viewport and the render targets
+    auto viewport = command->viewport();
+    auto clip = make_int4(std::max(static_cast<int>(std::floor(viewport.start.x)), 0),
+                          std::max(static_cast<int>(std::floor(viewport.start.y)), 0),
+                          std::min(static_cast<int>(std::ceil(viewport.start.x + viewport.size.x)), 65535),
+                          std::min(static_cast<int>(std::ceil(viewport.start.y + viewport.size.y)), 65535));
+    auto rtvs = command->rtv_texs();
+    for (auto &&rtv : rtvs) {
+        auto size = make_int2(_texture_size(rtv.handle, rtv.level));
+        clip.z = std::min(clip.z, size.x);
+        clip.w = std::min(clip.w, size.y);
+    }
+    DepthBuffer *depth = nullptr;
+    if (auto dsv = command->dsv_tex(); dsv.handle != invalid_resource_handle) {
+        depth = _depth_buffer(dsv.handle);
+        clip.z = std::min(clip.z, static_cast<int>(depth->size.x));
+        clip.w = std::min(clip.w, static_cast<int>(depth->size.y));
+    }
+    if (clip.x >= clip.z || clip.y >= clip.w) { return; }
+    Draw draw{.ext = *this,
+              .stream = stream_handle,
+              .command = command,
+              .shader = shader,
+              .state = state,
+              .depth = depth,
+              .clip = clip,
+              .rtv_count = static_cast<uint>(std::min(rtvs.size(), shader->output_count())),
+              .varying_stride = shader->varying()->size()};
+    draw.transform();
+    if (draw.triangle_count == 0u) { return; }
+    draw.bin();
+    draw.rasterize();
+    draw.shade();
+}
+
+void RustRasterExt::_clear_depth(uint64_t stream_handle, const ClearDepthCommand *command) noexcept {
+    auto depth = _depth_buffer(command->handle());
+    std::fill(depth->data.begin(), depth->data.end(), command->value());
+    CommandList list;
+    _upload_depth(list, *depth);
+    _device->dispatch(stream_handle, list.commit().command_list());
+}
+
+bool RustRasterExt::is_raster_command(const Command *command) noexcept {
+    if (command->tag() != Command::Tag::ECustomCommand) { return false; }
+    auto uuid = static_cast<const CustomCommand *>(command)->uuid();
+    return uuid == to_underlying(CustomCommandUUID::RASTER_DRAW_SCENE) ||
+           uuid == to_underlying(CustomCommandUUID::RASTER_CLEAR_DEPTH);
+}
+
+void RustRasterExt::execute(uint64_t stream_handle, const Command *command) noexcept {
+    std::scoped_lock lock{_mutex};
+    if (static_cast<const CustomCommand *>(command)->uuid() ==
+        to_underlying(CustomCommandUUID::RASTER_CLEAR_DEPTH)) {
+        _clear_depth(stream_handle, static_cast<const ClearDepthCommand *>(command));
+    } else {
+        _draw(stream_handle, static_cast<const DrawRasterSceneCommand *>(command));
+    }
+}
+
+}// namespace luisa::compute::rust
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+
+#include <luisa/core/spin_mutex.h>
+#include <luisa/core/thread_pool.h>
+#include <luisa/core/stl/memory.h>
+#include <luisa/core/stl/unordered_map.h>
+#include <luisa/runtime/command_list.h>
+#include <luisa/runtime/raster/raster_state.h>
+#include <luisa/backends/ext/raster_ext_interface.h>
+
+namespace luisa::compute {
+class DrawRasterSceneCommand;
+class ClearDepthCommand;
+}// namespace luisa::compute
+
+namespace luisa::compute::rust {
+
+// A tile-binned software rasterizer for the CPU backend. Raster commands are executed
+// on the dispatching thread once the stream has drained:
+//   1. vertices are assembled on the host and transformed by a generated vertex kernel;
+//   2. triangles are set up in 2D homogeneous coordinates (no clipping is needed) and
+//      binned into screen tiles with a two-pass counting sort, keeping primitive order;
+//   3. tiles are rasterized in parallel with half-space tests on 8x8 blocks and 2x2
+//      quads, and the depth test is performed before shading;
+//   4. the surviving fragments, laid out quad by quad, are shaded and written to the
+//      render targets by a generated pixel kernel, one dispatch per overdraw layer.
+// Without blending, and if the pixel stage writes no resources, only the visible
+// fragment of each pixel is shaded. Stencil, discard, wireframe, points and lines are
+// not supported.
+class RustRasterExt final : public RasterExt {
+
+public:
+    static constexpr auto tile_size = 64u;
+    static constexpr auto block_size = 8u;
+
+    class Shader;
+    struct DepthBuffer;
+
+private:
+    // host-visible memory shared with the generated kernels
+    struct Scratch {
+        uint64_t handle{invalid_resource_handle};
+        size_t size_bytes{0u};
+        std::byte *data{nullptr};
+    };
+
+    // edge functions E(x, y) = a * x + b * y + c of a triangle in 2D homogeneous
+    // coordinates, scaled so that they are non-negative inside, and the plane of z/w
+    struct Triangle {
+        std::array<float, 3> a;
+        std::array<float, 3> b;
+        std::array<double, 3> c;
+        std::array<bool, 3> top_left;
+        float za;
+        float zb;
+        double zc;
+        int4 bbox;// [min_x, min_y, max_x, max_y), empty if culled
+    };
+
+    struct Draw;
+
+    struct Tile {
+        uint begin{0u};
+        uint end{0u};
+        uint layer_count{0u};
+        // without blending: the last visible fragment of each pixel
+        luisa::vector<uint4> visible;
+        // with blending: the k-th fragment of each pixel goes to layer k
+        luisa::vector<uint16_t> overdraw;
+        luisa::vector<luisa::vector<uint4>> layers;
+    };
+
+private:
+    DeviceInterface *_device;
+    ThreadPool _pool;
+    // serializes raster commands, which share the scratch memory below
+    std::mutex _mutex;
+    spin_mutex _resource_mutex;
+    luisa::unordered_map<uint64_t, uint2> _texture_sizes;
+    luisa::unordered_map<uint64_t, luisa::unique_ptr<DepthBuffer>> _depth_buffers;
+    Scratch _vertices;
+    Scratch _varyings;
+    Scratch _triangles;
+    Scratch _fragments;
+    luisa::vector<Triangle> _setups;
+    luisa::vector<uint> _bin_counts;
+    luisa::vector<uint> _bins;
+    luisa::vector<Tile> _tiles;
+
+private:
+    [[nodiscard]] std::byte *_reserve(Scratch &scratch, size_t size_bytes) noexcept;
+    [[nodiscard]] uint2 _texture_size(uint64_t handle, uint level) noexcept;
+    [[nodiscard]] DepthBuffer *_depth_buffer(uint64_t handle) noexcept;
+    void _upload_depth(CommandList &list, DepthBuffer &depth) noexcept;
+    void _clear_depth(uint64_t stream_handle, const ClearDepthCommand *command) noexcept;
+    void _draw(uint64_t stream_handle, const DrawRasterSceneCommand *command) noexcept;
+
+public:
+    explicit RustRasterExt(DeviceInterface *device) noexcept;
+    ~RustRasterExt() noexcept;
+    [[nodiscard]] DeviceInterface *device() const noexcept override { return _device; }
+
+    [[nodiscard]] ResourceCreationInfo create_raster_shader(
+        const MeshFormat &mesh_format,
+        Function vert,
+        Function pixel,
+        const ShaderOption &shader_option) noexcept override;
+    [[nodiscard]] ResourceCreationInfo load_raster_shader(
+        const MeshFormat &mesh_format,
+        luisa::span<Type const *const> types,
+        luisa::string_view ser_path) noexcept override;
+    void warm_up_pipeline_cache(
+        uint64_t shader_handle,
+        luisa::span<PixelFormat const> render_target_formats,
+        DepthFormat depth_format,
+        const RasterState &state) noexcept override;
+    void destroy_raster_shader(uint64_t handle) noexcept override;
+    [[nodiscard]] ResourceCreationInfo create_depth_buffer(DepthFormat format, uint width, uint height) noexcept override;
+    void destroy_depth_buffer(uint64_t handle) noexcept override;
+
+    // render targets are clipped against the sizes of the textures
+    void register_texture(uint64_t handle, uint2 size) noexcept;
+    void unregister_texture(uint64_t handle) noexcept;
+
+    [[nodiscard]] static bool is_raster_command(const Command *command) noexcept;
+    // runs a raster command once the stream has drained
+    void execute(uint64_t stream_handle, const Command *command) noexcept;
+};
+
+}// namespace luisa::compute::rust
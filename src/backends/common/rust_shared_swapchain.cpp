@@ -0,0 +1,278 @@
+#include <bit>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+
+#ifdef LUISA_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/magic_enum.h>
+#include <luisa/core/stl/format.h>
+#include <luisa/runtime/rhi/pixel.h>
+#include "rust_device_common.h"
+#include "rust_shared_swapchain.h"
+
+namespace luisa::compute::rust {
+
+struct RustSharedSwapchains::Swapchain {
+    luisa::string name;
+    void *mapping;
+    SharedFrameRing *ring;
+    size_t size_bytes;
+    bool vsync;
+    uint64_t frame;
+};
+
+namespace detail {
+
+[[nodiscard]] constexpr uint shared_frame_pixel_size(SharedFrameFormat format) noexcept {
+    return format == SharedFrameFormat::RGBA16F ? 8u : 4u;
+}
+
+// copies row y of the image out of its blocked layout, including the padding of the last block
+void load_texel_row(const RustTextureLayout *texture, uint y, uint blocks_x, std::byte *row) noexcept {
+    constexpr auto b = RustTextureLayout::block_size;
+    auto block_row_bytes = static_cast<size_t>(b) << texture->pixel_stride_shift;
+    for (auto bx = 0u; bx < blocks_x; bx++) {
+        auto index = (static_cast<size_t>(y / b) * blocks_x + bx) * b * b + y % b * b;
+        std::memcpy(row + bx * block_row_bytes, texture->data + (index << texture->pixel_stride_shift), block_row_bytes);
+    }
+}
+
+// The conversions below are loops over the channels of a row without branches, which
+// the compiler vectorizes: floats are clamped as integers and halves are converted by
+// moving their bits, flushing denormals to zero.
+
+void swap_red_blue(uint32_t *pixels, size_t n) noexcept {
+    for (auto i = static_cast<size_t>(0u); i < n; i++) {
+        auto p = pixels[i];
+        pixels[i] = (p & 0xff00ff00u) | (p >> 16u & 0xffu) | (p & 0xffu) << 16u;
+    }
+}
+
+void unpack_unorm8(const uint8_t *in, float *out, size_t n) noexcept {
+    for (auto i = static_cast<size_t>(0u); i < n; i++) {
+        out[i] = static_cast<float>(in[i]) * (1.f / 255.f);
+    }
+}
+
+void unpack_half(const uint16_t *in, float *out, size_t n) noexcept {
+    for (auto i = static_cast<size_t>(0u); i < n; i++) {
+        auto h = static_cast<uint>(in[i]);
+        auto magnitude = h & 0x7fffu;
+        auto bits = (magnitude << 13u) + (112u << 23u);
+        bits = magnitude < 0x0400u ? 0u : bits;
+        // infinities and NaNs keep their maximal exponent
+        bits = magnitude >= 0x7c00u ? bits + (112u << 23u) : bits;
+        out[i] = std::bit_cast<float>(bits | (h & 0x8000u) << 16u);
+    }
+}
+
+template<bool bgra>
+void pack_unorm8(const float *in, uint8_t *out, size_t pixels) noexcept {
+    for (auto i = static_cast<size_t>(0u); i < pixels; i++) {
+        for (auto c = 0u; c < 4u; c++) {
+            // negative values and NaNs with the sign bit are negative integers
+            auto bits = std::min(std::max(std::bit_cast<int32_t>(in[i * 4u + c]), 0), 0x3f800000);
+            auto v = std::bit_cast<float>(bits);
+            out[i * 4u + (bgra && c != 3u ? 2u - c : c)] = static_cast<uint8_t>(v * 255.f + .5f);
+        }
+    }
+}
+
+void pack_half(const float *in, uint16_t *out, size_t n) noexcept {
+    for (auto i = static_cast<size_t>(0u); i < n; i++) {
+        auto bits = std::bit_cast<uint>(in[i]);
+        auto sign = bits >> 16u & 0x8000u;
+        // saturates at 65504, as do NaNs
+        auto magnitude = std::min(bits & 0x7fffffffu, 0x477fe000u);
+        auto rounded = magnitude + 0x0fffu + (magnitude >> 13u & 1u);
+        auto h = (rounded >> 13u) - (112u << 10u);
+        h = magnitude < 0x38800000u ? 0u : h;
+        out[i] = static_cast<uint16_t>(h | sign);
+    }
+}
+
+// converts a row of texels of the given size into a row of the frame, through floats
+// unless the layouts of the texels and of the frame pixels agree
+void convert_texel_row(uint texel_size, SharedFrameFormat format, std::byte *texels,
+                       float *channels, std::byte *out, uint width) noexcept {
+    auto n = static_cast<size_t>(width) * 4u;
+    if (texel_size == 8u && format == SharedFrameFormat::RGBA16F) {
+        std::memcpy(out, texels, n * sizeof(uint16_t));
+        return;
+    }
+    if (texel_size == 4u && format != SharedFrameFormat::RGBA16F) {
+        std::memcpy(out, texels, n);
+        if (format == SharedFrameFormat::BGRA8) { swap_red_blue(reinterpret_cast<uint32_t *>(out), width); }
+        return;
+    }
+    auto source = reinterpret_cast<const float *>(texels);
+    if (texel_size == 4u) {
+        unpack_unorm8(reinterpret_cast<const uint8_t *>(texels), channels, n);
+        source = channels;
+    } else if (texel_size == 8u) {
+        unpack_half(reinterpret_cast<const uint16_t *>(texels), channels, n);
+        source = channels;
+    }
+    switch (format) {
+        case SharedFrameFormat::RGBA8: pack_unorm8<false>(source, reinterpret_cast<uint8_t *>(out), width); break;
+        case SharedFrameFormat::BGRA8: pack_unorm8<true>(source, reinterpret_cast<uint8_t *>(out), width); break;
+        case SharedFrameFormat::RGBA16F: pack_half(source, reinterpret_cast<uint16_t *>(out), n); break;
+    }
+}
+
+// takes a slot for writing, never the one of the latest frame, which readers may still acquire
+[[nodiscard]] uint claim_shared_frame_slot(SharedFrameRing &ring) noexcept {
+    auto latest = ring.latest.load(std::memory_order_relaxed);
+    auto latest_slot = latest == 0u ? SharedFrameRing::no_frame : static_cast<uint>(latest & 0xffu);
+    // starting after the latest slot, the oldest frames are overwritten first
+    for (auto i = 1u; i <= ring.slot_count; i++) {
+        auto slot = latest == 0u ? i - 1u : (latest_slot + i) % ring.slot_count;
+        if (slot == latest_slot) { continue; }
+        auto expected = 0u;
+        if (ring.slots[slot].readers.compare_exchange_strong(
+                expected, SharedFrameRing::writing_bit,
+                std::memory_order_acquire, std::memory_order_relaxed)) {
+            return slot;
+        }
+    }
+    return SharedFrameRing::no_frame;
+}
+
+}// namespace detail
+
+RustSharedSwapchains::RustSharedSwapchains(DeviceInterface *device, luisa::string name, SharedFrameFormat format) noexcept
+    : _device{device}, _name{std::move(name)}, _format{format} {}
+
+SwapchainCreationInfo RustSharedSwapchains::create(uint width, uint height, bool allow_hdr,
+                                                   bool vsync, uint back_buffer_size) noexcept {
+    auto index = _count.fetch_add(1u, std::memory_order_relaxed);
+    auto row_pitch = (width * detail::shared_frame_pixel_size(_format) + 63u) & ~63u;
+    constexpr auto alignment = SharedFrameRing::frame_alignment;
+    auto frame_stride = (static_cast<size_t>(row_pitch) * height + alignment - 1u) / alignment * alignment;
+    // one slot for the presenter, one for the latest frame and the others for readers
+    auto slot_count = std::clamp(back_buffer_size + 1u, 3u, SharedFrameRing::max_slots);
+    auto size_bytes = SharedFrameRing::mapping_size(slot_count, frame_stride);
+#ifdef LUISA_PLATFORM_WINDOWS
+    auto name = luisa::format("{}.{}", _name, index);
+    auto mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                      static_cast<DWORD>(size_bytes >> 32u),
+                                      static_cast<DWORD>(size_bytes), name.c_str());
+    auto memory = mapping == nullptr ? nullptr : MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size_bytes);
+    if (memory == nullptr) {
+        LUISA_ERROR_WITH_LOCATION("Failed to map shared memory '{}' of {} bytes (error {}).",
+                                  name, size_bytes, GetLastError());
+    }
+#else
+    auto name = luisa::format("/{}.{}", _name, index);
+    auto fd = shm_open(name.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(size_bytes)) != 0) {
+        LUISA_ERROR_WITH_LOCATION("Failed to create shared memory '{}' of {} bytes: {}.",
+                                  name, size_bytes, std::strerror(errno));
+    }
+    auto memory = mmap(nullptr, size_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        LUISA_ERROR_WITH_LOCATION("Failed to map shared memory '{}': {}.", name, std::strerror(errno));
+    }
+    void *mapping = nullptr;
+#endif
+    auto ring = new (memory) SharedFrameRing{};
+    ring->magic = SharedFrameRing::magic_number;
+    ring->width = width;
+    ring->height = height;
+    ring->format = _format;
+    ring->row_pitch = row_pitch;
+    ring->slot_count = slot_count;
+    ring->frame_stride = frame_stride;
+    auto swapchain = luisa::new_with_allocator<Swapchain>(
+        Swapchain{std::move(name), mapping, ring, size_bytes, vsync, 0u});
+    LUISA_VERBOSE("Created shared swapchain '{}' of {} slots with {}x{} {} frames.",
+                  swapchain->name, slot_count, width, height, luisa::to_string(_format));
+    SwapchainCreationInfo info{};
+    info.handle = reinterpret_cast<uint64_t>(swapchain);
+    info.native_handle = ring;
+    info.storage = allow_hdr ? PixelStorage::HALF4 : PixelStorage::BYTE4;
+    return info;
+}
+
+void RustSharedSwapchains::destroy(uint64_t handle) noexcept {
+    auto swapchain = reinterpret_cast<Swapchain *>(handle);
+    auto ring = swapchain->ring;
+    LUISA_VERBOSE("Destroyed shared swapchain '{}' after {} frames ({} dropped).",
+                  swapchain->name, ring->presented.load(std::memory_order_relaxed),
+                  ring->dropped.load(std::memory_order_relaxed));
+    // readers that have mapped the ring keep their mappings
+    ring->closed.store(1u, std::memory_order_release);
+#ifdef LUISA_PLATFORM_WINDOWS
+    UnmapViewOfFile(ring);
+    CloseHandle(swapchain->mapping);
+#else
+    munmap(ring, swapchain->size_bytes);
+    shm_unlink(swapchain->name.c_str());
+#endif
+    luisa::delete_with_allocator(swapchain);
+}
+
+void RustSharedSwapchains::present(uint64_t stream_handle, uint64_t swapchain_handle, uint64_t image_handle) noexcept {
+    auto swapchain = reinterpret_cast<Swapchain *>(swapchain_handle);
+    auto texture = reinterpret_cast<const RustTextureLayout *>(image_handle);
+    auto &ring = *swapchain->ring;
+    auto width = texture->size[0];
+    auto height = texture->size[1];
+    // BYTE4, HALF4 or FLOAT4 texels
+    auto texel_size = 1u << texture->pixel_stride_shift;
+    if (width != ring.width || height != ring.height || texel_size < 4u || texel_size > 16u) {
+        LUISA_WARNING_WITH_LOCATION("Cannot present a {}x{} image with {}-byte texels in "
+                                    "shared swapchain '{}' of {}x{} four-channel frames.",
+                                    width, height, texel_size, swapchain->name, ring.width, ring.height);
+        return;
+    }
+    // the image is read in place
+    _device->synchronize_stream(stream_handle);
+    auto slot = detail::claim_shared_frame_slot(ring);
+    if (slot == SharedFrameRing::no_frame && swapchain->vsync) {
+        Clock clock;
+        while (slot == SharedFrameRing::no_frame && clock.toc() < vsync_timeout_ms) {
+            std::this_thread::yield();
+            slot = detail::claim_shared_frame_slot(ring);
+        }
+    }
+    if (slot == SharedFrameRing::no_frame) {
+        ring.dropped.fetch_add(1u, std::memory_order_relaxed);
+        return;
+    }
+    constexpr auto b = RustTextureLayout::block_size;
+    auto blocks_x = (width + b - 1u) / b;
+    auto blocks_y = (height + b - 1u) / b;
+    auto frame = ring.frame_data(slot);
+    parallel_for(_pool, blocks_y, [&](size_t by) noexcept {
+        luisa::vector<float4> texels(blocks_x * b);
+        luisa::vector<float> channels(blocks_x * b * 4u);
+        for (auto y = static_cast<uint>(by) * b; y < std::min(static_cast<uint>(by + 1u) * b, height); y++) {
+            detail::load_texel_row(texture, y, blocks_x, reinterpret_cast<std::byte *>(texels.data()));
+            detail::convert_texel_row(texel_size, ring.format, reinterpret_cast<std::byte *>(texels.data()),
+                                      channels.data(), frame + static_cast<size_t>(y) * ring.row_pitch, width);
+        }
+    });
+    auto number = ++swapchain->frame;
+    auto &s = ring.slots[slot];
+    using namespace std::chrono_literals;
+    s.present_time = std::chrono::steady_clock::now().time_since_epoch() / 1ns;
+    s.frame.store(number, std::memory_order_relaxed);
+    s.readers.fetch_sub(SharedFrameRing::writing_bit, std::memory_order_release);
+    ring.latest.store(number << 8u | slot, std::memory_order_release);
+    ring.presented.fetch_add(1u, std::memory_order_relaxed);
+}
+
+}// namespace luisa::compute::rust
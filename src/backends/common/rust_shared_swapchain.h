@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+
+#include <luisa/core/thread_pool.h>
+#include <luisa/core/stl/string.h>
+#include <luisa/runtime/rhi/device_interface.h>
+#include <luisa/backends/ext/shared_swapchain.h>
+
+namespace luisa::compute::rust {
+
+// Headless swapchains of the CPU backend. Each one maps a SharedFrameRing and on
+// present, once the stream has drained, converts the image from its blocked layout
+// into the rows of a free slot, which is then published as the latest frame. Rows
+// are converted on a thread pool by loops over their channels that the compiler
+// vectorizes. When all the slots are in use the frame is dropped, or with vsync the
+// presenter waits for a reader to release one.
+class RustSharedSwapchains {
+
+public:
+    // a presenter with vsync drops the frame after waiting this long for a slot
+    static constexpr auto vsync_timeout_ms = 1000u;
+
+private:
+    struct Swapchain;
+
+private:
+    DeviceInterface *_device;
+    ThreadPool _pool;
+    luisa::string _name;
+    SharedFrameFormat _format;
+    std::atomic<uint> _count{0u};
+
+public:
+    RustSharedSwapchains(DeviceInterface *device, luisa::string name, SharedFrameFormat format) noexcept;
+    [[nodiscard]] SwapchainCreationInfo create(uint width, uint height, bool allow_hdr,
+                                               bool vsync, uint back_buffer_size) noexcept;
+    void destroy(uint64_t handle) noexcept;
+    void present(uint64_t stream_handle, uint64_t swapchain_handle, uint64_t image_handle) noexcept;
+};
+
+}// namespace luisa::compute::rust
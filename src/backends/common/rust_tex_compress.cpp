@@ -0,0 +1,526 @@
+#include <bit>
+#include <cmath>
+#include <array>
+#include <limits>
+#include <cstring>
+#include <algorithm>
+
+#include <luisa/core/logging.h>
+#include <luisa/core/mathematics.h>
+#include <luisa/core/magic_enum.h>
+#include <luisa/runtime/image.h>
+#include <luisa/runtime/buffer.h>
+#include <luisa/runtime/stream.h>
+#include "rust_device_common.h"
+#include "rust_tex_compress.h"
+
+namespace luisa::compute::rust {
+
+namespace detail {
+
+// the texels of a 4x4 block in row-major order
+using CompressBlock = std::array<float4, 16u>;
+using CompressIndices = std::array<uint, 16u>;
+
+// the bits of a compressed block, least significant first
+struct CompressedBits {
+    std::array<uint64_t, 2u> words{};
+    void put(uint offset, uint count, uint value) noexcept {
+        auto v = static_cast<uint64_t>(value) & ((uint64_t{1u} << count) - 1u);
+        words[offset / 64u] |= v << (offset % 64u);
+        if (offset % 64u + count > 64u) { words[1u] |= v >> (64u - offset % 64u); }
+    }
+    void store(std::byte *p, size_t size) const noexcept { std::memcpy(p, words.data(), size); }
+};
+
+template<typename T, uint n>
+[[nodiscard]] float4 load_texel(const std::byte *p) noexcept {
+    std::array<T, n> c{};
+    std::memcpy(c.data(), p, sizeof(c));
+    auto v = make_float4(0.f, 0.f, 0.f, 1.f);
+    for (auto i = 0u; i < n; i++) {
+        if constexpr (std::is_same_v<T, uint8_t>) {
+            v[i] = static_cast<float>(c[i]) * (1.f / 255.f);
+        } else if constexpr (std::is_same_v<T, uint16_t>) {
+            v[i] = static_cast<float>(c[i]) * (1.f / 65535.f);
+        } else {
+            v[i] = static_cast<float>(c[i]);
+        }
+    }
+    return v;
+}
+
+using TexelLoader = float4 (*)(const std::byte *) noexcept;
+
+[[nodiscard]] TexelLoader texel_loader(PixelStorage storage) noexcept {
+    switch (storage) {
+        case PixelStorage::BYTE1: return load_texel<uint8_t, 1u>;
+        case PixelStorage::BYTE2: return load_texel<uint8_t, 2u>;
+        case PixelStorage::BYTE4: return load_texel<uint8_t, 4u>;
+        case PixelStorage::SHORT1: return load_texel<uint16_t, 1u>;
+        case PixelStorage::SHORT2: return load_texel<uint16_t, 2u>;
+        case PixelStorage::SHORT4: return load_texel<uint16_t, 4u>;
+        case PixelStorage::HALF1: return load_texel<half, 1u>;
+        case PixelStorage::HALF2: return load_texel<half, 2u>;
+        case PixelStorage::HALF4: return load_texel<half, 4u>;
+        case PixelStorage::FLOAT1: return load_texel<float, 1u>;
+        case PixelStorage::FLOAT2: return load_texel<float, 2u>;
+        case PixelStorage::FLOAT4: return load_texel<float, 4u>;
+        default: break;
+    }
+    return nullptr;
+}
+
+// The first endpoint and the direction towards the second of a line through the
+// texels, along the principal axis of their distribution with each channel scaled
+// by the square root of its weight, trimmed to the extent of the projections.
+[[nodiscard]] std::pair<float4, float4> fit_line(const CompressBlock &texels, float4 weights) noexcept {
+    auto scale = sqrt(weights);
+    auto mean = make_float4(0.f);
+    for (auto &&t : texels) { mean += t * scale; }
+    mean *= 1.f / 16.f;
+    std::array<float4, 4u> covariance{};
+    auto lo = make_float4(std::numeric_limits<float>::max());
+    auto hi = make_float4(std::numeric_limits<float>::lowest());
+    for (auto &&t : texels) {
+        auto d = t * scale - mean;
+        for (auto i = 0u; i < 4u; i++) { covariance[i] += d[i] * d; }
+        lo = min(lo, d);
+        hi = max(hi, d);
+    }
+    // power iteration, starting from the diagonal of the bounding box
+    auto axis = hi - lo;
+    for (auto iteration = 0u; iteration < 8u; iteration++) {
+        auto next = covariance[0] * axis.x + covariance[1] * axis.y +
+                    covariance[2] * axis.z + covariance[3] * axis.w;
+        auto m = std::max({std::abs(next.x), std::abs(next.y), std::abs(next.z), std::abs(next.w)});
+        if (m == 0.f) { break; }
+        axis = next * (1.f / m);
+    }
+    auto length_squared = dot(axis, axis);
+    if (length_squared == 0.f) { return {mean / max(scale, 1e-6f), make_float4(0.f)}; }
+    axis *= 1.f / std::sqrt(length_squared);
+    auto t_min = std::numeric_limits<float>::max();
+    auto t_max = std::numeric_limits<float>::lowest();
+    for (auto &&t : texels) {
+        auto p = dot(t * scale - mean, axis);
+        t_min = std::min(t_min, p);
+        t_max = std::max(t_max, p);
+    }
+    auto inverse_scale = make_float4(1.f) / max(scale, 1e-6f);
+    return {(mean + t_min * axis) * inverse_scale, (t_max - t_min) * axis * inverse_scale};
+}
+
+// Gives each texel the index of the nearest palette entry and returns the weighted error.
+template<size_t n>
+[[nodiscard]] float assign_indices(const CompressBlock &texels, const std::array<float4, n> &palette,
+                                   float4 weights, CompressIndices &indices) noexcept {
+    auto error = 0.f;
+    for (auto i = 0u; i < 16u; i++) {
+        auto best = std::numeric_limits<float>::max();
+        for (auto k = 0u; k < n; k++) {
+            auto d = texels[i] - palette[k];
+            auto e = dot(d * d, weights);
+            if (e < best) {
+                best = e;
+                indices[i] = k;
+            }
+        }
+        error += best;
+    }
+    return error;
+}
+
+// The endpoints minimizing the squared error of the texels interpolated at the
+// fractions of their indices towards the second endpoint, if the fit is well-posed.
+template<size_t n>
+[[nodiscard]] bool least_squares(const CompressBlock &texels, const CompressIndices &indices,
+                                 const std::array<float, n> &fractions, float4 &e0, float4 &e1) noexcept {
+    auto aa = 0.f, ab = 0.f, bb = 0.f;
+    auto ax = make_float4(0.f);
+    auto bx = make_float4(0.f);
+    for (auto i = 0u; i < 16u; i++) {
+        auto b = fractions[indices[i]];
+        auto a = 1.f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        ax += a * texels[i];
+        bx += b * texels[i];
+    }
+    auto det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f) { return false; }
+    auto inverse = 1.f / det;
+    e0 = (bb * ax - ab * bx) * inverse;
+    e1 = (aa * bx - ab * ax) * inverse;
+    return true;
+}
+
+static constexpr std::array<uint, 16u> bc_weights4{0u, 4u, 9u, 13u, 17u, 21u, 26u, 30u,
+                                                   34u, 38u, 43u, 47u, 51u, 55u, 60u, 64u};
+
+[[nodiscard]] constexpr uint bc_interpolate(uint e0, uint e1, uint w) noexcept {
+    return ((64u - w) * e0 + w * e1 + 32u) >> 6u;
+}
+
+static constexpr auto bc_fractions4 = [] {
+    std::array<float, 16u> f{};
+    for (auto i = 0u; i < 16u; i++) { f[i] = static_cast<float>(bc_weights4[i]) / 64.f; }
+    return f;
+}();
+
+[[nodiscard]] uint4 expand_565(uint c) noexcept {
+    auto r = (c >> 11u) & 31u;
+    auto g = (c >> 5u) & 63u;
+    auto b = c & 31u;
+    return make_uint4((r << 3u) | (r >> 2u), (g << 2u) | (g >> 4u), (b << 3u) | (b >> 2u), 255u);
+}
+
+[[nodiscard]] uint quantize_565(float4 c) noexcept {
+    auto q = [](float x, float max) noexcept { return static_cast<uint>(std::clamp(x, 0.f, 1.f) * max + .5f); };
+    return (q(c.x, 31.f) << 11u) | (q(c.y, 63.f) << 5u) | q(c.z, 31.f);
+}
+
+// BC1 colors in four-color mode, which is the only one of BC3
+void encode_bc1_colors(const CompressBlock &texels, std::byte *block) noexcept {
+    constexpr auto weights = make_float4(1.f, 1.f, 1.f, 0.f);
+    constexpr std::array<float, 4u> fractions{0.f, 1.f, 1.f / 3.f, 2.f / 3.f};
+    auto [origin, direction] = fit_line(texels, weights);
+    auto e0 = origin + direction;
+    auto e1 = origin;
+    auto best_error = std::numeric_limits<float>::max();
+    auto best_c0 = 0u, best_c1 = 0u;
+    CompressIndices best_indices{};
+    for (auto iteration = 0u; iteration < 3u; iteration++) {
+        auto c0 = quantize_565(e0);
+        auto c1 = quantize_565(e1);
+        if (c0 < c1) { std::swap(c0, c1); }
+        auto p0 = expand_565(c0);
+        auto p1 = expand_565(c1);
+        // decoded exactly as in the four-color mode
+        std::array<float4, 4u> palette{make_float4(p0), make_float4(p1),
+                                       make_float4((2u * p0 + p1) / 3u),
+                                       make_float4((p0 + 2u * p1) / 3u)};
+        for (auto &&p : palette) { p *= 1.f / 255.f; }
+        CompressIndices indices{};
+        auto error = assign_indices(texels, palette, weights, indices);
+        if (error < best_error) {
+            best_error = error;
+            best_c0 = c0;
+            best_c1 = c1;
+            best_indices = indices;
+        }
+        if (c0 == c1 || !least_squares(texels, indices, fractions, e0, e1)) { break; }
+    }
+    auto packed = best_c0 | (best_c1 << 16u);
+    auto index_bits = 0u;
+    // with equal endpoints BC1 is in three-color mode, where index 0 is still the first endpoint
+    if (best_c0 != best_c1) {
+        for (auto i = 0u; i < 16u; i++) { index_bits |= best_indices[i] << (2u * i); }
+    }
+    std::memcpy(block, &packed, sizeof(packed));
+    std::memcpy(block + 4u, &index_bits, sizeof(index_bits));
+}
+
+// one channel in the eight-value mode of BC4, which is also the alpha of BC3
+void encode_bc4_channel(const CompressBlock &texels, uint channel, std::byte *block) noexcept {
+    CompressBlock values{};
+    for (auto i = 0u; i < 16u; i++) { values[i] = make_float4(std::clamp(texels[i][channel], 0.f, 1.f), 0.f, 0.f, 0.f); }
+    constexpr auto weights = make_float4(1.f, 0.f, 0.f, 0.f);
+    constexpr auto fractions = [] {
+        std::array<float, 8u> f{0.f, 1.f};
+        for (auto k = 2u; k < 8u; k++) { f[k] = static_cast<float>(k - 1u) / 7.f; }
+        return f;
+    }();
+    auto lo = 1.f, hi = 0.f;
+    for (auto &&v : values) {
+        lo = std::min(lo, v.x);
+        hi = std::max(hi, v.x);
+    }
+    auto e0 = make_float4(hi, 0.f, 0.f, 0.f);
+    auto e1 = make_float4(lo, 0.f, 0.f, 0.f);
+    auto best_error = std::numeric_limits<float>::max();
+    auto best_a0 = 0u, best_a1 = 0u;
+    CompressIndices best_indices{};
+    for (auto iteration = 0u; iteration < 3u; iteration++) {
+        auto a0 = static_cast<uint>(std::clamp(e0.x, 0.f, 1.f) * 255.f + .5f);
+        auto a1 = static_cast<uint>(std::clamp(e1.x, 0.f, 1.f) * 255.f + .5f);
+        if (a0 < a1) { std::swap(a0, a1); }
+        CompressIndices indices{};
+        auto error = 0.f;
+        if (a0 == a1) {
+            // six-value mode, where index 0 is still the first endpoint
+            for (auto &&v : values) {
+                auto d = v.x - static_cast<float>(a0) / 255.f;
+                error += d * d;
+            }
+        } else {
+            std::array<float4, 8u> palette{};
+            palette[0] = make_float4(static_cast<float>(a0) / 255.f, 0.f, 0.f, 0.f);
+            palette[1] = make_float4(static_cast<float>(a1) / 255.f, 0.f, 0.f, 0.f);
+            for (auto k = 2u; k < 8u; k++) {
+                auto a = ((8u - k) * a0 + (k - 1u) * a1 + 3u) / 7u;
+                palette[k] = make_float4(static_cast<float>(a) / 255.f, 0.f, 0.f, 0.f);
+            }
+            error = assign_indices(values, palette, weights, indices);
+        }
+        if (error < best_error) {
+            best_error = error;
+            best_a0 = a0;
+            best_a1 = a1;
+            best_indices = indices;
+        }
+        if (a0 == a1 || !least_squares(values, indices, fractions, e0, e1)) { break; }
+    }
+    CompressedBits bits;
+    bits.put(0u, 8u, best_a0);
+    bits.put(8u, 8u, best_a1);
+    for (auto i = 0u; i < 16u; i++) { bits.put(16u + 3u * i, 3u, best_indices[i]); }
+    bits.store(block, 8u);
+}
+
+// swaps the endpoints if the index of the first texel has its high bit set, which
+// the formats with 4-bit indices leave implicit
+template<typename Endpoint>
+void fix_anchor(Endpoint &e0, Endpoint &e1, CompressIndices &indices) noexcept {
+    if (indices[0] < 8u) { return; }
+    std::swap(e0, e1);
+    for (auto &&i : indices) { i = 15u - i; }
+}
+
+void encode_bc7_mode6(const CompressBlock &texels, float alpha_importance, std::byte *block) noexcept {
+    auto weights = make_float4(1.f, 1.f, 1.f, std::max(alpha_importance, 0.f));
+    CompressBlock clamped{};
+    for (auto i = 0u; i < 16u; i++) { clamped[i] = clamp(texels[i], 0.f, 1.f); }
+    auto [origin, direction] = fit_line(clamped, max(weights, 1e-3f));
+    auto e0 = origin;
+    auto e1 = origin + direction;
+    // 7-bit endpoints with a p-bit each, chosen on all four channels
+    auto quantize = [](float4 e) noexcept {
+        auto best = make_uint4(0u);
+        auto best_error = std::numeric_limits<float>::max();
+        for (auto p = 0u; p < 2u; p++) {
+            auto q = make_uint4(clamp((clamp(e, 0.f, 1.f) * 255.f - static_cast<float>(p)) * .5f + .5f, 0.f, 127.f));
+            auto v = (q << 1u) | p;
+            auto d = make_float4(v) * (1.f / 255.f) - e;
+            if (auto error = dot(d, d); error < best_error) {
+                best_error = error;
+                best = v;
+            }
+        }
+        return best;
+    };
+    auto best_error = std::numeric_limits<float>::max();
+    auto best_v0 = make_uint4(0u), best_v1 = make_uint4(0u);
+    CompressIndices best_indices{};
+    for (auto iteration = 0u; iteration < 3u; iteration++) {
+        auto v0 = quantize(clamp(e0, 0.f, 1.f));
+        auto v1 = quantize(clamp(e1, 0.f, 1.f));
+        std::array<float4, 16u> palette{};
+        for (auto k = 0u; k < 16u; k++) {
+            auto w = bc_weights4[k];
+            palette[k] = make_float4(static_cast<float>(bc_interpolate(v0.x, v1.x, w)),
+                                     static_cast<float>(bc_interpolate(v0.y, v1.y, w)),
+                                     static_cast<float>(bc_interpolate(v0.z, v1.z, w)),
+                                     static_cast<float>(bc_interpolate(v0.w, v1.w, w))) *
+                         (1.f / 255.f);
+        }
+        CompressIndices indices{};
+        auto error = assign_indices(clamped, palette, weights, indices);
+        if (error < best_error) {
+            best_error = error;
+            best_v0 = v0;
+            best_v1 = v1;
+            best_indices = indices;
+        }
+        if (!least_squares(clamped, indices, bc_fractions4, e0, e1)) { break; }
+    }
+    fix_anchor(best_v0, best_v1, best_indices);
+    CompressedBits bits;
+    bits.put(0u, 7u, 1u << 6u);
+    auto offset = 7u;
+    for (auto c = 0u; c < 4u; c++) {
+        bits.put(offset, 7u, best_v0[c] >> 1u);
+        bits.put(offset + 7u, 7u, best_v1[c] >> 1u);
+        offset += 14u;
+    }
+    // a p-bit is the lowest bit of every channel of its endpoint
+    bits.put(offset, 1u, best_v0.x & 1u);
+    bits.put(offset + 1u, 1u, best_v1.x & 1u);
+    offset += 2u;
+    for (auto i = 0u; i < 16u; i++) {
+        auto n = i == 0u ? 3u : 4u;
+        bits.put(offset, n, best_indices[i]);
+        offset += n;
+    }
+    bits.store(block, 16u);
+}
+
+// unsigned 10-bit BC6H endpoints and the half bits they decode to
+[[nodiscard]] constexpr uint bc6h_unquantize(uint x) noexcept {
+    if (x == 0u) { return 0u; }
+    if (x == 1023u) { return 0xffffu; }
+    return ((x << 16u) + 0x8000u) >> 10u;
+}
+
+[[nodiscard]] constexpr uint bc6h_finish(uint x) noexcept { return (x * 31u) >> 6u; }
+
+[[nodiscard]] uint bc6h_quantize(float h) noexcept {
+    auto x = static_cast<int>(std::lround((h - 15.5f) / 31.f));
+    auto best = 0u;
+    auto best_error = std::numeric_limits<float>::max();
+    for (auto c = x - 1; c <= x + 1; c++) {
+        auto q = static_cast<uint>(std::clamp(c, 0, 1023));
+        if (auto error = std::abs(static_cast<float>(bc6h_finish(bc6h_unquantize(q))) - h); error < best_error) {
+            best_error = error;
+            best = q;
+        }
+    }
+    return best;
+}
+
+void encode_bc6h_mode11(const CompressBlock &texels, std::byte *block) noexcept {
+    constexpr auto max_half = 31743.f;// 0x7bff, the largest finite half
+    constexpr auto weights = make_float4(1.f, 1.f, 1.f, 0.f);
+    // the fit is done on the bit patterns of the halves
+    CompressBlock bits_of_halves{};
+    for (auto i = 0u; i < 16u; i++) {
+        for (auto c = 0u; c < 3u; c++) {
+            // NaNs and negatives go to zero, as the unsigned format cannot hold them
+            auto h = std::bit_cast<uint16_t>(half{std::fmin(std::fmax(texels[i][c], 0.f), 65504.f)});
+            bits_of_halves[i][c] = static_cast<float>(h);
+        }
+    }
+    auto [origin, direction] = fit_line(bits_of_halves, weights);
+    auto e0 = origin;
+    auto e1 = origin + direction;
+    auto best_error = std::numeric_limits<float>::max();
+    auto best_q0 = make_uint3(0u), best_q1 = make_uint3(0u);
+    CompressIndices best_indices{};
+    for (auto iteration = 0u; iteration < 3u; iteration++) {
+        auto q0 = make_uint3(0u), q1 = make_uint3(0u);
+        for (auto c = 0u; c < 3u; c++) {
+            q0[c] = bc6h_quantize(std::clamp(e0[c], 0.f, max_half));
+            q1[c] = bc6h_quantize(std::clamp(e1[c], 0.f, max_half));
+        }
+        std::array<float4, 16u> palette{};
+        for (auto k = 0u; k < 16u; k++) {
+            for (auto c = 0u; c < 3u; c++) {
+                auto v = bc_interpolate(bc6h_unquantize(q0[c]), bc6h_unquantize(q1[c]), bc_weights4[k]);
+                palette[k][c] = static_cast<float>(bc6h_finish(v));
+            }
+        }
+        CompressIndices indices{};
+        auto error = assign_indices(bits_of_halves, palette, weights, indices);
+        if (error < best_error) {
+            best_error = error;
+            best_q0 = q0;
+            best_q1 = q1;
+            best_indices = indices;
+        }
+        if (!least_squares(bits_of_halves, indices, bc_fractions4, e0, e1)) { break; }
+    }
+    fix_anchor(best_q0, best_q1, best_indices);
+    CompressedBits bits;
+    bits.put(0u, 5u, 0x03u);
+    for (auto c = 0u; c < 3u; c++) {
+        bits.put(5u + 10u * c, 10u, best_q0[c]);
+        bits.put(35u + 10u * c, 10u, best_q1[c]);
+    }
+    auto offset = 65u;
+    for (auto i = 0u; i < 16u; i++) {
+        auto n = i == 0u ? 3u : 4u;
+        bits.put(offset, n, best_indices[i]);
+        offset += n;
+    }
+    bits.store(block, 16u);
+}
+
+void encode_block(PixelStorage target, const CompressBlock &texels, float alpha_importance, std::byte *block) noexcept {
+    switch (target) {
+        case PixelStorage::BC1: encode_bc1_colors(texels, block); break;
+        case PixelStorage::BC3:
+            encode_bc4_channel(texels, 3u, block);
+            encode_bc1_colors(texels, block + 8u);
+            break;
+        case PixelStorage::BC4: encode_bc4_channel(texels, 0u, block); break;
+        case PixelStorage::BC5:
+            encode_bc4_channel(texels, 0u, block);
+            encode_bc4_channel(texels, 1u, block + 8u);
+            break;
+        case PixelStorage::BC6: encode_bc6h_mode11(texels, block); break;
+        case PixelStorage::BC7: encode_bc7_mode6(texels, alpha_importance, block); break;
+        default: LUISA_ERROR_WITH_LOCATION("Unsupported block compression {}.", luisa::to_string(target));
+    }
+}
+
+}// namespace detail
+
+RustTexCompressExt::RustTexCompressExt(DeviceInterface *device) noexcept
+    : _device{device} {}
+
+TexCompressExt::Result RustTexCompressExt::_compress(Stream &stream, const Image<float> &src, const BufferView<uint> &result,
+                                                     PixelStorage target, float alpha_importance) noexcept {
+    auto loader = detail::texel_loader(src.storage());
+    if (loader == nullptr) {
+        LUISA_WARNING_WITH_LOCATION("Cannot compress images with storage {}.",
+                                    luisa::to_string(src.storage()));
+        return Result::Failed;
+    }
+    auto texture = reinterpret_cast<const RustTextureLayout *>(src.handle());
+    constexpr auto b = RustTextureLayout::block_size;
+    auto size = src.size();
+    auto blocks_x = (size.x + b - 1u) / b;
+    auto blocks_y = (size.y + b - 1u) / b;
+    auto block_bytes = pixel_storage_size(target, make_uint3(b, b, 1u));
+    if (result.size_bytes() < blocks_x * blocks_y * block_bytes) {
+        LUISA_WARNING_WITH_LOCATION("Buffer of {} bytes is too small for {} blocks of {} bytes.",
+                                    result.size_bytes(), blocks_x * blocks_y, block_bytes);
+        return Result::Failed;
+    }
+    // the image is read in place
+    _device->synchronize_stream(stream.handle());
+    auto buffer = reinterpret_cast<const RustBufferLayout *>(result.handle());
+    auto output = buffer->data + result.offset_bytes();
+    parallel_for(_pool, blocks_y, [&](size_t by) noexcept {
+        for (auto bx = 0u; bx < blocks_x; bx++) {
+            detail::CompressBlock texels{};
+            for (auto i = 0u; i < 16u; i++) {
+                // blocks over the edges repeat the last row and column
+                auto x = std::min(bx * b + i % b, size.x - 1u);
+                auto y = std::min(static_cast<uint>(by) * b + i / b, size.y - 1u);
+                auto index = (x / b + y / b * blocks_x) * b * b + x % b + y % b * b;
+                texels[i] = loader(texture->data + (static_cast<size_t>(index) << texture->pixel_stride_shift));
+            }
+            detail::encode_block(target, texels, alpha_importance,
+                                 output + (by * blocks_x + bx) * block_bytes);
+        }
+    });
+    return Result::Success;
+}
+
+TexCompressExt::Result RustTexCompressExt::compress_bc1(Stream &stream, Image<float> const &src, BufferView<uint> const &result) noexcept {
+    return _compress(stream, src, result, PixelStorage::BC1, 0.f);
+}
+
+TexCompressExt::Result RustTexCompressExt::compress_bc3(Stream &stream, Image<float> const &src, BufferView<uint> const &result) noexcept {
+    return _compress(stream, src, result, PixelStorage::BC3, 0.f);
+}
+
+TexCompressExt::Result RustTexCompressExt::compress_bc4(Stream &stream, Image<float> const &src, BufferView<uint> const &result) noexcept {
+    return _compress(stream, src, result, PixelStorage::BC4, 0.f);
+}
+
+TexCompressExt::Result RustTexCompressExt::compress_bc5(Stream &stream, Image<float> const &src, BufferView<uint> const &result) noexcept {
+    return _compress(stream, src, result, PixelStorage::BC5, 0.f);
+}
+
+TexCompressExt::Result RustTexCompressExt::compress_bc6h(Stream &stream, Image<float> const &src, BufferView<uint> const &result) noexcept {
+    return _compress(stream, src, result, PixelStorage::BC6, 0.f);
+}
+
+TexCompressExt::Result RustTexCompressExt::compress_bc7(Stream &stream, Image<float> const &src, BufferView<uint> const &result, float alpha_importance) noexcept {
+    return _compress(stream, src, result, PixelStorage::BC7, alpha_importance);
+}
+
+}// namespace luisa::compute::rust
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <luisa/core/thread_pool.h>
+#include <luisa/runtime/rhi/pixel.h>
+#include <luisa/runtime/rhi/device_interface.h>
+#include <luisa/backends/ext/tex_compress_ext.h>
+
+namespace luisa::compute::rust {
+
+// Block compression on the host for the CPU backend. The source image is read in
+// place once the stream has drained, and the rows of blocks are encoded in parallel
+// on a thread pool. The encoders work on the 16 texels of a block as fixed-size
+// arrays of vectors, so that their inner loops are vectorized by the compiler:
+// - BC1 and the colors of BC3: endpoints on the principal axis of the block,
+//   refined by least squares (BC1 is always opaque);
+// - BC4, BC5 and the alpha of BC3: min/max endpoints refined by least squares;
+// - BC6H: mode 11 (one region, 10-bit endpoints, 4-bit indices), fitted to the
+//   bit patterns of the halves, which interpolate almost logarithmically;
+// - BC7: mode 6 (one subset, RGBA endpoints of 7 bits with a p-bit each and 4-bit
+//   indices), with alpha errors weighted by the given alpha importance.
+class RustTexCompressExt final : public TexCompressExt {
+
+private:
+    DeviceInterface *_device;
+    ThreadPool _pool;
+
+private:
+    [[nodiscard]] Result _compress(Stream &stream, const Image<float> &src, const BufferView<uint> &result,
+                                   PixelStorage target, float alpha_importance) noexcept;
+
+public:
+    explicit RustTexCompressExt(DeviceInterface *device) noexcept;
+    Result compress_bc1(Stream &stream, Image<float> const &src, BufferView<uint> const &result) noexcept override;
+    Result compress_bc3(Stream &stream, Image<float> const &src, BufferView<uint> const &result) noexcept override;
+    Result compress_bc4(Stream &stream, Image<float> const &src, BufferView<uint> const &result) noexcept override;
+    Result compress_bc5(Stream &stream, Image<float> const &src, BufferView<uint> const &result) noexcept override;
+    Result compress_bc6h(Stream &stream, Image<float> const &src, BufferView<uint> const &result) noexcept override;
+    Result compress_bc7(Stream &stream, Image<float> const &src, BufferView<uint> const &result, float alpha_importance) noexcept override;
+    // there are no built-in shaders to compile on the host
+    Result check_builtin_shader() noexcept override { return Result::Success; }
+};
+
+}// namespace luisa::compute::rust
@@ -86,5 +86,5 @@ after_build(function(target)
 		copy_dll("release")
 	end
 end)
-add_files("**.cpp", "../common/rust_device_common.cpp")
+add_files("**.cpp", "../common/rust_device_common.cpp", "../common/rust_dstorage.cpp", "../common/rust_raster.cpp", "../common/rust_mipmap.cpp", "../common/rust_tex_compress.cpp", "../common/rust_denoiser.cpp", "../common/rust_shared_swapchain.cpp")
 target_end()
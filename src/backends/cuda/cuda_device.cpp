@@ -547,13 +547,21 @@ ShaderCreationInfo CUDADevice::_create_shader(luisa::string name,
     return info;
 }
 
+#ifdef LUISA_ENABLE_IR
+IRTransformPipeline *CUDADevice::_ir_transform_pipeline() noexcept {
+    std::scoped_lock lock{_ext_mutex};
+    if (!_ir_transforms) { _ir_transforms = IRTransformPipeline::create_auto(); }
+    return _ir_transforms.get();
+}
+#endif
+
 ShaderCreationInfo CUDADevice::create_shader(const ShaderOption &option, Function kernel) noexcept {
 
     if (kernel.propagated_builtin_callables().test(CallOp::BACKWARD)) {
 #ifdef LUISA_ENABLE_IR
         auto ir = AST2IR::build_kernel(kernel);
         ir->get()->module.flags |= ir::ModuleFlags_REQUIRES_REV_AD_TRANSFORM;
-        transform_ir_kernel_module_auto(ir->get());
+        _ir_transform_pipeline()->transform(ir->get());
         return create_shader(option, ir->get());
 #else
         LUISA_ERROR_WITH_LOCATION("Please enable IR for autodiff support");
@@ -11,6 +11,10 @@
 #include "optix_api.h"
 #include "cuda_shader_metadata.h"
 
+namespace luisa::compute {
+class IRTransformPipeline;
+}// namespace luisa::compute
+
 namespace luisa::compute::cuda {
 
 class CUDADenoiserExt;
@@ -97,6 +101,10 @@ private:
     std::mutex _ext_mutex;
     luisa::unique_ptr<CUDADenoiserExt> _denoiser_ext;
     luisa::unique_ptr<CUDADStorageExt> _dstorage_ext;
+#ifdef LUISA_ENABLE_IR
+    // created on the first autodiff kernel, guarded by _ext_mutex
+    luisa::unique_ptr<IRTransformPipeline> _ir_transforms;
+#endif
 
 private:
     [[nodiscard]] ShaderCreationInfo _create_shader(luisa::string name,
@@ -104,6 +112,9 @@ private:
                                                     luisa::span<const char *const> nvrtc_options,
                                                     const CUDAShaderMetadata &expected_metadata,
                                                     luisa::vector<ShaderDispatchCommand::Argument> bound_arguments) noexcept;
+#ifdef LUISA_ENABLE_IR
+    [[nodiscard]] IRTransformPipeline *_ir_transform_pipeline() noexcept;
+#endif
 
 public:
     CUDADevice(Context &&ctx, size_t device_id, const BinaryIO *io) noexcept;
@@ -24,8 +24,9 @@ struct ButtomCompactCmd {
     size_t size;
 };
 struct ReorderFuncTable {
-    bool is_res_in_bindless(uint64_t bindless_handle, uint64_t resource_handle) const noexcept {
-        return reinterpret_cast<BindlessArray *>(bindless_handle)->IsPtrInBindless(resource_handle);
+    template<typename F>
+    void traverse_bindless(uint64_t bindless_handle, F &&f) const noexcept {
+        reinterpret_cast<BindlessArray *>(bindless_handle)->TraversePtr(std::forward<F>(f));
     }
     Usage get_usage(uint64_t shader_handle, size_t argument_index) const noexcept {
         auto cs = reinterpret_cast<ComputeShader *>(shader_handle);
@@ -235,13 +235,21 @@ void LCDevice::dispatch(uint64 stream_handle, CommandList &&list) noexcept {
     }
 }
 
+#ifdef LUISA_ENABLE_IR
+IRTransformPipeline *LCDevice::GetIRTransformPipeline() {
+    std::lock_guard lck{extMtx};
+    if (!irTransforms) { irTransforms = IRTransformPipeline::create_auto(); }
+    return irTransforms.get();
+}
+#endif
+
 ShaderCreationInfo LCDevice::create_shader(const ShaderOption &option, Function kernel) noexcept {
 
     if (kernel.propagated_builtin_callables().test(CallOp::BACKWARD)) {
 #ifdef LUISA_ENABLE_IR
         auto ir = AST2IR::build_kernel(kernel);
         ir->get()->module.flags |= ir::ModuleFlags_REQUIRES_REV_AD_TRANSFORM;
-        transform_ir_kernel_module_auto(ir->get());
+        GetIRTransformPipeline()->transform(ir->get());
         return create_shader(option, ir->get());
 #else
         LUISA_ERROR_WITH_LOCATION("IR is not enabled in LuisaCompute. "
@@ -2,6 +2,9 @@
 #include <luisa/vstl/common.h>
 #include <luisa/runtime/device.h>
 #include <DXRuntime/Device.h>
+namespace luisa::compute {
+class IRTransformPipeline;
+}// namespace luisa::compute
 namespace lc::dx {
 using namespace luisa;
 using namespace luisa::compute;
@@ -28,6 +31,11 @@ public:
     Device nativeDevice;
     std::mutex extMtx;
     vstd::unordered_map<vstd::string, Ext> exts;
+#ifdef LUISA_ENABLE_IR
+    // created on the first autodiff kernel, guarded by extMtx
+    luisa::unique_ptr<IRTransformPipeline> irTransforms;
+    IRTransformPipeline *GetIRTransformPipeline();
+#endif
     //std::numeric_limits<size_t>::max();
     LCDevice(Context &&ctx, DeviceConfig const *settings);
     ~LCDevice();
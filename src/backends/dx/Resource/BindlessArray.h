@@ -51,6 +51,12 @@ public:
     bool IsPtrInBindless(size_t ptr) const {
         return ptrMap.find(ptr);
     }
+    template<typename F>
+    void TraversePtr(F &&f) const {
+        for (auto &&i : ptrMap) {
+            f(i.first);
+        }
+    }
     using Property = vstd::variant<
         BufferView,
         std::pair<TextureBase const *, Sampler>>;
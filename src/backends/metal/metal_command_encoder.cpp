@@ -1,6 +1,8 @@
 #include <luisa/core/pool.h>
 #include <luisa/core/logging.h>
+#include <luisa/core/magic_enum.h>
 #include <luisa/runtime/rhi/pixel.h>
+#include <luisa/backends/ext/mipmap_cmd.h>
 #include "metal_buffer.h"
 #include "metal_texture.h"
 #include "metal_accel.h"
@@ -263,6 +265,23 @@ void MetalCommandEncoder::visit(BindlessArrayUpdateCommand *command) noexcept {
 
 void MetalCommandEncoder::visit(CustomCommand *command) noexcept {
     _prepare_command_buffer();
+    if (command->uuid() == to_underlying(CustomCommandUUID::MIPMAP_GENERATE)) {
+        auto mipmap_command = static_cast<GenerateMipmapsCommand *>(command);
+        // streams lower the commands that MetalMipmapExt rejects
+        LUISA_ASSERT(MetalMipmapExt{}.is_mipmap_generation_supported(
+                         mipmap_command->storage(), mipmap_command->filter(), mipmap_command->srgb()),
+                     "Mipmap generation command (filter = {}, srgb = {}, storage = {}) "
+                     "is not supported in Metal backend.",
+                     luisa::to_string(mipmap_command->filter()), mipmap_command->srgb(),
+                     luisa::to_string(mipmap_command->storage()));
+        if (mipmap_command->level_count() > 1u) {
+            auto texture = reinterpret_cast<const MetalTexture *>(mipmap_command->handle())->handle();
+            auto encoder = _command_buffer->blitCommandEncoder();
+            encoder->generateMipmaps(texture);
+            encoder->endEncoding();
+        }
+        return;
+    }
     LUISA_ERROR_WITH_LOCATION(
         "Custom command (uuid = 0x{:04x}) is not "
         "supported in Metal backend.",
@@ -348,13 +348,21 @@ void MetalDevice::present_display_in_stream(uint64_t stream_handle, uint64_t swa
     });
 }
 
+#ifdef LUISA_ENABLE_IR
+IRTransformPipeline *MetalDevice::_ir_transform_pipeline() noexcept {
+    std::scoped_lock lock{_ext_mutex};
+    if (!_ir_transforms) { _ir_transforms = IRTransformPipeline::create_auto(); }
+    return _ir_transforms.get();
+}
+#endif
+
 ShaderCreationInfo MetalDevice::create_shader(const ShaderOption &option, Function kernel) noexcept {
 
     if (kernel.propagated_builtin_callables().test(CallOp::BACKWARD)) {
 #ifdef LUISA_ENABLE_IR
         auto ir = AST2IR::build_kernel(kernel);
         ir->get()->module.flags |= ir::ModuleFlags_REQUIRES_REV_AD_TRANSFORM;
-        transform_ir_kernel_module_auto(ir->get());
+        _ir_transform_pipeline()->transform(ir->get());
         return create_shader(option, ir->get());
 #else
         LUISA_ERROR_WITH_LOCATION("IR is not enabled in LuisaCompute. "
@@ -601,6 +609,11 @@ DeviceExtension *MetalDevice::extension(luisa::string_view name) noexcept {
             if (!_debug_capture_ext) { _debug_capture_ext = luisa::make_unique<MetalDebugCaptureExt>(this); }
             return _debug_capture_ext.get();
         }
+        if (name == MipmapExt::name) {
+            std::scoped_lock lock{_ext_mutex};
+            if (!_mipmap_ext) { _mipmap_ext = luisa::make_unique<MetalMipmapExt>(); }
+            return _mipmap_ext.get();
+        }
         LUISA_WARNING_WITH_LOCATION("Device extension \"{}\" is not supported on Metal.", name);
         return nullptr;
     });
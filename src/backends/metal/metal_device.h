@@ -4,12 +4,17 @@
 #include "../common/default_binary_io.h"
 #include "metal_api.h"
 
+namespace luisa::compute {
+class IRTransformPipeline;
+}// namespace luisa::compute
+
 namespace luisa::compute::metal {
 
 class MetalCompiler;
 class MetalDStorageExt;
 class MetalDebugCaptureExt;
 class MetalPinnedMemoryExt;
+class MetalMipmapExt;
 
 class MetalDevice : public DeviceInterface {
 
@@ -35,6 +40,14 @@ private:
     luisa::unique_ptr<MetalDStorageExt> _dstorage_ext;
     luisa::unique_ptr<MetalPinnedMemoryExt> _pinned_memory_ext;
     luisa::unique_ptr<MetalDebugCaptureExt> _debug_capture_ext;
+    luisa::unique_ptr<MetalMipmapExt> _mipmap_ext;
+#ifdef LUISA_ENABLE_IR
+    // created on the first autodiff kernel, guarded by _ext_mutex
+    luisa::unique_ptr<IRTransformPipeline> _ir_transforms;
+
+private:
+    [[nodiscard]] IRTransformPipeline *_ir_transform_pipeline() noexcept;
+#endif
 
 public:
     [[nodiscard]] auto handle() const noexcept { return _handle; }
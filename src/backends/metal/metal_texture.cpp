@@ -117,4 +117,14 @@ void MetalTexture::set_name(luisa::string_view name) noexcept {
     }
 }
 
+bool MetalMipmapExt::is_mipmap_generation_supported(
+    PixelStorage storage, MipmapFilter filter, bool srgb) const noexcept {
+    // 32-bit float formats are not filterable on every device
+    auto filterable = !is_block_compressed(storage) &&
+                      storage != PixelStorage::FLOAT1 &&
+                      storage != PixelStorage::FLOAT2 &&
+                      storage != PixelStorage::FLOAT4;
+    return filter == MipmapFilter::BOX && !srgb && filterable;
+}
+
 }// namespace luisa::compute::metal
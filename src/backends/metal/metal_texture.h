@@ -4,6 +4,7 @@
 
 #include <luisa/core/stl/string.h>
 #include <luisa/runtime/rhi/pixel.h>
+#include <luisa/backends/ext/mipmap_ext.h>
 #include "metal_api.h"
 
 namespace luisa::compute::metal {
@@ -33,5 +34,14 @@ public:
     void set_name(luisa::string_view name) noexcept;
 };
 
-}// namespace luisa::compute::metal
+// The blit encoder averages 2x2 texels of the stored values, which is the box
+// filter on linear textures with filterable formats. Streams lower the other
+// mipmap generation commands to compute dispatches.
+class MetalMipmapExt final : public MipmapExt {
 
+public:
+    [[nodiscard]] bool is_mipmap_generation_supported(
+        PixelStorage storage, MipmapFilter filter, bool srgb) const noexcept override;
+};
+
+}// namespace luisa::compute::metal
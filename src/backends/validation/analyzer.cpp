@@ -0,0 +1,81 @@
+#include "analyzer.h"
+#include <luisa/core/logging.h>
+namespace lc::validation {
+Analyzer &Analyzer::instance() {
+    static Analyzer analyzer;
+    return analyzer;
+}
+Analyzer::~Analyzer() {
+    _stop();
+}
+void Analyzer::configure(Config const &config) {
+    auto c = config;
+    c.sample_interval = std::max(c.sample_interval, 1u);
+    std::lock_guard lck{_config_mtx};
+    if (_configured) {
+        if (!(c == _config)) {
+            LUISA_WARNING("Validation layer: analyzer already configured for {} analysis "
+                          "tracking every {} command list(s), ignoring the conflicting configuration "
+                          "({} analysis, every {} command list(s)).",
+                          _config.async ? "asynchronous" : "synchronous", _config.sample_interval,
+                          c.async ? "asynchronous" : "synchronous", c.sample_interval);
+        }
+        return;
+    }
+    _configured = true;
+    _config = c;
+    if (_config.async) {
+        _stopped = false;
+        _thread = std::thread{[this] { _run(); }};
+    }
+    if (_config.async || _config.sample_interval > 1) {
+        LUISA_INFO("Validation layer: {} analysis, tracking every {} command list(s).",
+                   _config.async ? "asynchronous" : "synchronous", _config.sample_interval);
+    }
+}
+void Analyzer::_push(Task &&task) {
+    {
+        std::lock_guard lck{_queue_mtx};
+        _tasks.emplace_back(std::move(task));
+        ++_pushed;
+    }
+    _queue_cv.notify_one();
+}
+void Analyzer::_run() {
+    vstd::vector<Task> tasks;
+    for (;;) {
+        {
+            std::unique_lock lck{_queue_mtx};
+            _queue_cv.wait(lck, [&] { return _stopped || !_tasks.empty(); });
+            if (_tasks.empty()) return;
+            std::swap(tasks, _tasks);
+        }
+        {
+            std::lock_guard lck{_lock};
+            for (auto &&i : tasks) {
+                i();
+            }
+        }
+        {
+            std::lock_guard lck{_queue_mtx};
+            _finished += tasks.size();
+        }
+        tasks.clear();
+        _flush_cv.notify_all();
+    }
+}
+void Analyzer::flush() {
+    if (!_config.async) return;
+    std::unique_lock lck{_queue_mtx};
+    _flush_cv.wait(lck, [&] { return _finished == _pushed; });
+}
+void Analyzer::_stop() {
+    if (!_thread.joinable()) return;
+    {
+        std::lock_guard lck{_queue_mtx};
+        _stopped = true;
+    }
+    _queue_cv.notify_one();
+    _thread.join();
+}
+}// namespace lc::validation
@@ -0,0 +1,60 @@
+#pragma once
+#include <luisa/vstl/common.h>
+#include <luisa/core/stl/functional.h>
+#include <thread>
+#include <condition_variable>
+namespace lc::validation {
+// Owns the hazard-tracking state shared by all streams. In synchronous mode, analysis runs
+// on the calling thread under the global lock; in asynchronous mode, it is queued to a
+// background thread, and submitting threads only record compact access logs.
+class Analyzer {
+public:
+    struct Config {
+        bool async{false};
+        // track resource accesses of every N-th command list of each stream
+        uint32_t sample_interval{1};
+        [[nodiscard]] bool operator==(Config const &rhs) const noexcept {
+            return async == rhs.async && sample_interval == rhs.sample_interval;
+        }
+    };
+    using Task = luisa::move_only_function<void()>;
+
+private:
+    Config _config;
+    std::mutex _config_mtx;
+    bool _configured{false};
+    std::recursive_mutex _lock;
+    std::mutex _queue_mtx;
+    std::condition_variable _queue_cv;
+    std::condition_variable _flush_cv;
+    vstd::vector<Task> _tasks;
+    uint64_t _pushed{0};
+    uint64_t _finished{0};
+    bool _stopped{false};
+    std::thread _thread;
+    void _run();
+    void _push(Task &&task);
+    void _stop();
+
+public:
+    static Analyzer &instance();
+    Analyzer() = default;
+    ~Analyzer();
+    auto const &config() const { return _config; }
+    // the analyzer is shared by all validation devices, so only the first configuration is
+    // applied; later conflicting ones are ignored with a warning
+    void configure(Config const &config);
+    std::recursive_mutex &lock() { return _lock; }
+    template<typename F>
+    void execute(F &&f) {
+        if (_config.async) {
+            _push(Task{std::forward<F>(f)});
+        } else {
+            std::lock_guard lck{_lock};
+            f();
+        }
+    }
+    // waits until all queued analysis has finished
+    void flush();
+};
+}// namespace lc::validation
@@ -11,19 +11,35 @@
 #include "shader.h"
 #include "sparse_heap.h"
 #include "swap_chain.h"
+#include "analyzer.h"
 #include <luisa/ast/function_builder.h>
 #include "raster_ext_impl.h"
 #include "dstorage_ext_impl.h"
 #include <luisa/core/logging.h>
 #include <luisa/runtime/rhi/command.h>
 #include <luisa/backends/ext/registry.h>
+#include <luisa/backends/ext/command_graph_ext.h>
 namespace lc::validation {
 static vstd::unordered_map<uint64_t, StreamOption> stream_options;
 static std::mutex stream_mtx;
 
+static Analyzer::Config analyzer_config() {
+    Analyzer::Config config;
+    // LUISA_VALIDATION_ASYNC=1: analyze hazards on a background thread
+    if (auto env = std::getenv("LUISA_VALIDATION_ASYNC")) {
+        config.async = std::string_view{env} == "1";
+    }
+    // LUISA_VALIDATION_SAMPLE_INTERVAL=N: only track the resource accesses of every N-th command list of each stream
+    if (auto env = std::getenv("LUISA_VALIDATION_SAMPLE_INTERVAL")) {
+        config.sample_interval = static_cast<uint32_t>(std::strtoul(env, nullptr, 10));
+    }
+    return config;
+}
+
 Device::Device(Context &&ctx, luisa::shared_ptr<DeviceInterface> &&native) noexcept
     : DeviceInterface{std::move(ctx)},
       _native{std::move(native)} {
+    Analyzer::instance().configure(analyzer_config());
     auto raster_ext = static_cast<RasterExt *>(_native->extension(RasterExt::name));
     auto dstorage_ext = static_cast<DStorageExt *>(_native->extension(DStorageExt::name));
     if (raster_ext) {
@@ -275,9 +291,12 @@ luisa::string Device::query(luisa::string_view property) noexcept {
 DeviceExtension *Device::extension(luisa::string_view name) noexcept {
     auto iter = exts.find(name);
     if (iter != exts.end()) return iter->second.get();
+    // replays would bypass the checks, so command graphs submit copies through dispatch()
+    if (name == CommandGraphExt::name) return nullptr;
     return _native->extension(name);
 }
 Device::~Device() {
+    Analyzer::instance().flush();
     exts.clear();
 }
 void Device::set_name(luisa::compute::Resource::Tag resource_tag, uint64_t resource_handle, luisa::string_view name) noexcept {
@@ -0,0 +1,146 @@
+#pragma once
+#include <luisa/vstl/common.h>
+#include "range.h"
+namespace lc::validation {
+// Interval tree over ranges: a treap keyed by (range.min, slot), augmented with the
+// maximum range.max of each subtree, so overlap queries only visit colliding subtrees.
+template<typename T>
+class RangeTree {
+    static constexpr uint32_t null_node = std::numeric_limits<uint32_t>::max();
+    struct Node {
+        Range range;
+        T value;
+        uint64_t max_end;
+        uint32_t priority;
+        uint32_t left{null_node};
+        uint32_t right{null_node};
+    };
+    vstd::vector<Node> _nodes;
+    vstd::vector<uint32_t> _free_nodes;
+    uint32_t _root{null_node};
+    uint32_t _seed{0x9e3779b9u};
+    size_t _size{0};
+
+    bool _less(uint32_t a, uint64_t min, uint32_t b) const {
+        auto a_min = _nodes[a].range.min;
+        return a_min < min || (a_min == min && a < b);
+    }
+    void _update(uint32_t t) {
+        auto &n = _nodes[t];
+        n.max_end = n.range.max;
+        if (n.left != null_node) n.max_end = std::max(n.max_end, _nodes[n.left].max_end);
+        if (n.right != null_node) n.max_end = std::max(n.max_end, _nodes[n.right].max_end);
+    }
+    // l: keys less than (min, slot), r: the others
+    void _split(uint32_t t, uint64_t min, uint32_t slot, uint32_t &l, uint32_t &r) {
+        if (t == null_node) {
+            l = r = null_node;
+            return;
+        }
+        if (_less(t, min, slot)) {
+            _split(_nodes[t].right, min, slot, _nodes[t].right, r);
+            l = t;
+        } else {
+            _split(_nodes[t].left, min, slot, l, _nodes[t].left);
+            r = t;
+        }
+        _update(t);
+    }
+    uint32_t _merge(uint32_t l, uint32_t r) {
+        if (l == null_node) return r;
+        if (r == null_node) return l;
+        if (_nodes[l].priority > _nodes[r].priority) {
+            _nodes[l].right = _merge(_nodes[l].right, r);
+            _update(l);
+            return l;
+        }
+        _nodes[r].left = _merge(l, _nodes[r].left);
+        _update(r);
+        return r;
+    }
+    template<typename F>
+    void _query(uint32_t t, Range const &range, F &f, vstd::vector<uint32_t> &erased) {
+        if (t == null_node) return;
+        auto &n = _nodes[t];
+        if (n.max_end <= range.min) return;
+        _query(n.left, range, f, erased);
+        if (n.range.min >= range.max) return;
+        if (Range::collide(n.range, range) && !f(n.range, n.value)) {
+            erased.emplace_back(t);
+        }
+        _query(n.right, range, f, erased);
+    }
+    template<typename F>
+    void _for_each(uint32_t t, F &f, vstd::vector<uint32_t> &erased) {
+        if (t == null_node) return;
+        _for_each(_nodes[t].left, f, erased);
+        if (!f(_nodes[t].range, _nodes[t].value)) {
+            erased.emplace_back(t);
+        }
+        _for_each(_nodes[t].right, f, erased);
+    }
+    void _erase(uint32_t slot) {
+        auto min = _nodes[slot].range.min;
+        uint32_t l, m, r;
+        _split(_root, min, slot, l, m);
+        _split(m, min, slot + 1, m, r);
+        _root = _merge(l, r);
+        _free_nodes.emplace_back(slot);
+        --_size;
+    }
+    void _erase_all(vstd::vector<uint32_t> const &erased) {
+        for (auto i : erased) {
+            _erase(i);
+        }
+    }
+
+public:
+    size_t size() const { return _size; }
+    void insert(Range range, T value) {
+        uint32_t slot;
+        if (_free_nodes.empty()) {
+            slot = static_cast<uint32_t>(_nodes.size());
+            _nodes.emplace_back();
+        } else {
+            slot = _free_nodes.back();
+            _free_nodes.pop_back();
+        }
+        // xorshift32
+        _seed ^= _seed << 13;
+        _seed ^= _seed >> 17;
+        _seed ^= _seed << 5;
+        auto &n = _nodes[slot];
+        n.range = range;
+        n.value = std::move(value);
+        n.max_end = range.max;
+        n.priority = _seed;
+        n.left = null_node;
+        n.right = null_node;
+        uint32_t l, r;
+        _split(_root, range.min, slot, l, r);
+        _root = _merge(_merge(l, slot), r);
+        ++_size;
+    }
+    // Calls f(Range const &, T &) for every range colliding with `range`;
+    // entries for which f returns false are removed.
+    template<typename F>
+    void query(Range const &range, F &&f) {
+        vstd::vector<uint32_t> erased;
+        _query(_root, range, f, erased);
+        _erase_all(erased);
+    }
+    // Calls f(Range const &, T &) for every entry; entries for which f returns false are removed.
+    template<typename F>
+    void for_each(F &&f) {
+        vstd::vector<uint32_t> erased;
+        _for_each(_root, f, erased);
+        _erase_all(erased);
+    }
+    void clear() {
+        _nodes.clear();
+        _free_nodes.clear();
+        _root = null_node;
+        _size = 0;
+    }
+};
+}// namespace lc::validation
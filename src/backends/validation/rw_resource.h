@@ -1,17 +1,21 @@
 #pragma once
 #include "resource.h"
 #include <luisa/ast/usage.h>
-#include "range.h"
+#include "range_tree.h"
 namespace lc::validation {
 class Stream;
 using namespace luisa::compute;
 struct RWInfo {
+    uint64_t stream;
     Usage usage{Usage::NONE};
     uint64_t last_frame{0};
 };
 class RWResource : public Resource {
     friend struct ResMap;
-    vstd::unordered_map<uint64_t , RWInfo> _info;
+    friend class Stream;
+    // accesses of each stream, by range, that may still be in flight
+    RangeTree<RWInfo> _info;
+    size_t _prune_size{64};
     bool _non_simultaneous;
     uint64_t _handle;
 
@@ -26,7 +30,6 @@ public:
         set_usage(stream, this, usage, range);
     }
     auto non_simultaneous() const { return _non_simultaneous; }
-    auto const &info() const { return _info; }
     RWResource(RWResource &&) = delete;
     RWResource(RWResource const &) = delete;
     RWResource(uint64_t handle, Tag tag, bool non_simultaneous);
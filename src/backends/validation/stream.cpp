@@ -10,34 +10,37 @@
 #include "procedural_primitives.h"
 #include "shader.h"
 #include "swap_chain.h"
+#include "analyzer.h"
 #include <luisa/core/logging.h>
 #include <luisa/runtime/raster/raster_scene.h>
 #include <luisa/runtime/rtx/aabb.h>
 #include <luisa/backends/ext/raster_cmd.h>
 #include <luisa/backends/ext/dstorage_cmd.h>
+#include <luisa/backends/ext/mipmap_cmd.h>
 
 namespace lc::validation {
 Stream::Stream(uint64_t handle, StreamTag stream_tag) : RWResource{handle, Tag::STREAM, false}, _stream_tag{stream_tag} {}
-std::recursive_mutex stream_global_lock;
 void Stream::signal(Event *evt, uint64_t fence) {
-    std::lock_guard lck{stream_global_lock};
-    evt->signaled.force_emplace(this, Event::Signaled{fence, _executed_layer});
+    Analyzer::instance().execute([this, evt, fence, layer = executed_layer()] {
+        evt->signaled.force_emplace(this, Event::Signaled{fence, layer});
+    });
 }
 uint64_t Stream::stream_synced_frame(Stream *stream) const {
     auto iter = waited_stream.find(stream);
     if (iter == waited_stream.end()) {
         return stream->synced_layer();
     } else {
-        return iter->second;
+        return std::max(iter->second, stream->synced_layer());
     }
 }
 void Stream::wait(Event *evt, uint64_t fence) {
-    std::lock_guard lck{stream_global_lock};
-    for (auto &&i : evt->signaled) {
-        if (fence >= i.second.event_fence) {
-            waited_stream.force_emplace(i.first, i.second.stream_fence);
+    Analyzer::instance().execute([this, evt, fence] {
+        for (auto &&i : evt->signaled) {
+            if (fence >= i.second.event_fence) {
+                waited_stream.force_emplace(i.first, i.second.stream_fence);
+            }
         }
-    }
+    });
 }
 namespace detail {
 static vstd::string usage_name(Usage usage) {
@@ -52,50 +55,103 @@ static vstd::string usage_name(Usage usage) {
             return "none";
     }
 }
+static Usage usage_union(Usage lhs, Usage rhs) {
+    return static_cast<Usage>(luisa::to_underlying(lhs) | luisa::to_underlying(rhs));
+}
 }// namespace detail
-void Stream::check_compete() {
-    std::lock_guard lck{stream_global_lock};
-    for (auto &&iter : res_usages) {
-        auto res = iter.first;
-        for (auto &&stream_iter : res->info()) {
-            auto other_stream = RWResource::get<Stream>(stream_iter.first);
-            if (!other_stream || other_stream == this) continue;
-            auto synced_frame = stream_synced_frame(other_stream);
-            if (stream_iter.second.last_frame > synced_frame) {
-                // Texture type
-                if (res->non_simultaneous()) {
-                    LUISA_ERROR(
-                        "Non simultaneous-accessible resource {} is not allowed to be {} by {} and {} by {} simultaneously.",
-                        res->get_name(),
-                        detail::usage_name(stream_iter.second.usage),
-                        other_stream->get_name(),
-                        detail::usage_name(iter.second.usage),
-                        get_name());
-                } else {
-                    LUISA_WARNING(
-                        "Simultaneous-accessible resource {} is used to be {} by {} and {} by {} simultaneously.",
-                        res->get_name(),
-                        detail::usage_name(stream_iter.second.usage),
-                        other_stream->get_name(),
-                        detail::usage_name(iter.second.usage),
-                        get_name());
+void Stream::_analyze(uint64_t layer, vstd::vector<AccessRecord> const &records) {
+    // report each pair of resource and stream once per layer
+    vstd::vector<std::pair<RWResource *, Stream *>> reported;
+    auto report = [&](RWResource *res, Stream *other_stream, Usage other_usage, Usage usage) {
+        for (auto &&i : reported) {
+            if (i.first == res && i.second == other_stream) return;
+        }
+        reported.emplace_back(res, other_stream);
+        // Texture type
+        if (res->non_simultaneous()) {
+            LUISA_ERROR(
+                "Non simultaneous-accessible resource {} is not allowed to be {} by {} and {} by {} simultaneously.",
+                res->get_name(),
+                detail::usage_name(other_usage),
+                other_stream->get_name(),
+                detail::usage_name(usage),
+                get_name());
+        } else {
+            LUISA_WARNING(
+                "Simultaneous-accessible resource {} is used to be {} by {} and {} by {} simultaneously.",
+                res->get_name(),
+                detail::usage_name(other_usage),
+                other_stream->get_name(),
+                detail::usage_name(usage),
+                get_name());
+        }
+    };
+    for (auto &&record : records) {
+        auto res = record.res;
+        bool merged = false;
+        res->_info.query(record.range, [&](Range const &range, RWInfo &info) {
+            if (info.stream == handle()) {
+                if (range == record.range) {
+                    info.usage = info.last_frame == layer ? detail::usage_union(info.usage, record.usage) : record.usage;
+                    info.last_frame = layer;
+                    merged = true;
+                    return true;
                 }
+                return info.last_frame > synced_layer();
+            }
+            auto other_stream = RWResource::try_get<Stream>(info.stream);
+            // finished accesses can not collide with anything anymore
+            if (!other_stream || info.last_frame <= other_stream->synced_layer()) return false;
+            if (info.last_frame > stream_synced_frame(other_stream)) {
+                report(res, other_stream, info.usage, record.usage);
             }
+            return true;
+        });
+        if (!merged) {
+            res->_info.insert(record.range, RWInfo{handle(), record.usage, layer});
+        }
+        if (res->_info.size() > res->_prune_size) {
+            res->_info.for_each([](Range const &, RWInfo &info) {
+                auto stream = RWResource::try_get<Stream>(info.stream);
+                return stream && info.last_frame > stream->synced_layer();
+            });
+            res->_prune_size = std::max<size_t>(64, res->_info.size() * 2);
         }
     }
 }
+void Stream::check_compete() {
+    if (!_recording) return;
+    _recording = false;
+    if (_records.empty()) return;
+    Analyzer::instance().execute([this, layer = executed_layer(), records = std::move(_records)] {
+        _analyze(layer, records);
+    });
+    _records.clear();
+}
 void Stream::dispatch() {
-    std::lock_guard lck{stream_global_lock};
-    _executed_layer++;
-    res_usages.clear();
+    auto interval = Analyzer::instance().config().sample_interval;
+    _recording = _dispatch_count++ % interval == 0;
+    _records.clear();
+    _executed_layer.fetch_add(1, std::memory_order_relaxed);
+}
+void Stream::record(RWResource *res, Usage usage, Range range) {
+    if (!_recording) return;
+    for (auto &&i : _records) {
+        if (i.res == res && i.range == range) {
+            i.usage = detail::usage_union(i.usage, usage);
+            return;
+        }
+    }
+    _records.emplace_back(AccessRecord{res, range, usage});
 }
 void Stream::mark_shader_dispatch(DeviceInterface *dev, ShaderDispatchCommandBase *cmd, bool contain_bindings) {
     size_t arg_idx = 0;
     auto shader = RWResource::get<RWResource>(cmd->handle());
     auto mark_handle = [&](uint64_t &handle, Range range) -> std::pair<RWResource *, Usage> {
         auto res = RWResource::get<RWResource>(handle);
+        // the usage is checked on every list, only its recording is sampled
         auto usage = dev->shader_argument_usage(cmd->handle(), arg_idx);
-        res->set(this, usage, range);
+        if (_recording) res->set(this, usage, range);
         return {res, usage};
     };
     auto set_arg = [&](Argument &arg) {
@@ -152,7 +208,7 @@ void Stream::mark_shader_dispatch(DeviceInterface *dev, ShaderDispatchCommandBas
     Stream::mark_handle(cmd->handle(), Usage::READ, Range{});
 }
 void Stream::mark_handle(uint64_t v, Usage usage, Range range) {
-    if (v != invalid_resource_handle) {
+    if (_recording && v != invalid_resource_handle) {
         RWResource::get<RWResource>(v)->set(this, usage, range);
     }
 }
@@ -185,6 +241,13 @@ void Stream::custom(DeviceInterface *dev, Command *cmd) {
             auto c = static_cast<ClearDepthCommand *>(cmd);
             mark_handle(c->handle(), Usage::WRITE, Range{});
         } break;
+        case to_underlying(CustomCommandUUID::MIPMAP_GENERATE): {
+            auto c = static_cast<GenerateMipmapsCommand *>(cmd);
+            mark_handle(c->handle(), Usage::READ, Range{0, 1});
+            if (c->level_count() > 1u) {
+                mark_handle(c->handle(), Usage::WRITE, Range{1, c->level_count() - 1u});
+            }
+        } break;
         case to_underlying(CustomCommandUUID::RASTER_DRAW_SCENE): {
             auto c = static_cast<DrawRasterSceneCommand *>(cmd);
             mark_shader_dispatch(dev, c, false);
@@ -258,9 +321,7 @@ void Stream::custom(DeviceInterface *dev, Command *cmd) {
     }
 }
 void Stream::dispatch(DeviceInterface *dev, CommandList &cmd_list) {
-    std::lock_guard lck{stream_global_lock};
-    _executed_layer++;
-    res_usages.clear();
+    dispatch();
     dstorage_range_check.clear();
     using CmdTag = luisa::compute::Command::Tag;
     for (auto &&cmd_ptr : cmd_list.commands()) {
@@ -363,6 +424,9 @@ void Stream::dispatch(DeviceInterface *dev, CommandList &cmd_list) {
                     case to_underlying(CustomCommandUUID::DSTORAGE_READ):
                         Device::check_stream(handle(), StreamFunc::Custom, custom_cmd->uuid());
                         break;
+                    case to_underlying(CustomCommandUUID::MIPMAP_GENERATE):
+                        Device::check_stream(handle(), StreamFunc::Compute, custom_cmd->uuid());
+                        break;
                 }
                 custom(dev, cmd);
             } break;
@@ -370,34 +434,39 @@ void Stream::dispatch(DeviceInterface *dev, CommandList &cmd_list) {
         // TODO: resources record
     }
 }
-void Stream::sync_layer(uint64_t layer) {
-    std::lock_guard lck{stream_global_lock};
-    if (_synced_layer >= layer) return;
-    _synced_layer = layer;
+void Stream::_sync_layer(uint64_t layer) {
+    if (synced_layer() >= layer) return;
+    _synced_layer.store(layer, std::memory_order_relaxed);
     for (auto &&i : waited_stream) {
-        i.first->sync_layer(i.second);
+        i.first->_sync_layer(i.second);
     }
     waited_stream.clear();
 }
+void Stream::sync_layer(uint64_t layer) {
+    Analyzer::instance().execute([this, layer] {
+        _sync_layer(layer);
+    });
+}
 void Stream::sync() {
-    sync_layer(_executed_layer);
+    sync_layer(executed_layer());
 }
 void Event::sync(uint64_t fence) {
-    std::lock_guard lck{stream_global_lock};
-    vstd::vector<Stream *> removed_stream;
-    for (auto &&i : signaled) {
-        if (fence >= i.second.event_fence) {
-            i.first->sync_layer(i.second.stream_fence);
-            removed_stream.emplace_back(i.first);
+    Analyzer::instance().execute([this, fence] {
+        vstd::vector<Stream *> removed_stream;
+        for (auto &&i : signaled) {
+            if (fence >= i.second.event_fence) {
+                i.first->_sync_layer(i.second.stream_fence);
+                removed_stream.emplace_back(i.first);
+            }
         }
-    }
-    if (removed_stream.size() == signaled.size()) {
-        signaled.clear();
-    } else {
-        for (auto &&i : removed_stream) {
-            signaled.erase(i);
+        if (removed_stream.size() == signaled.size()) {
+            signaled.clear();
+        } else {
+            for (auto &&i : removed_stream) {
+                signaled.erase(i);
+            }
         }
-    }
+    });
 }
 vstd::string Stream::stream_tag() const {
     switch (_stream_tag) {
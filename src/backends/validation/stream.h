@@ -5,14 +5,16 @@
 #include <luisa/runtime/rhi/command.h>
 #include <luisa/runtime/command_list.h>
 #include "range.h"
+#include <atomic>
 namespace lc::validation {
 using namespace luisa::compute;
 class Event;
 class RWResource;
 class Stream;
-struct CompeteResource {
-    Usage usage{Usage::NONE};
-    vstd::vector<Range> ranges;
+struct AccessRecord {
+    RWResource *res;
+    Range range;
+    Usage usage;
 };
 
 class CustomDispatchArgumentVisitor;
@@ -20,11 +22,17 @@ class CustomDispatchArgumentVisitor;
 class Stream : public RWResource {
 
     friend class CustomDispatchArgumentVisitor;
+    friend class Event;
 
 private:
     StreamTag _stream_tag;
-    uint64_t _executed_layer{0};
-    uint64_t _synced_layer{0};
+    // written by the submitting thread
+    std::atomic_uint64_t _executed_layer{0};
+    uint64_t _dispatch_count{0};
+    bool _recording{false};
+    vstd::vector<AccessRecord> _records;
+    // owned by the analyzer
+    std::atomic_uint64_t _synced_layer{0};
     // other streams waiting for this stream
     vstd::unordered_map<Stream *, uint64_t> waited_stream;
     vstd::unordered_map<uint64_t, vstd::vector<Range>> dstorage_range_check;
@@ -32,19 +40,23 @@ private:
     void mark_handle(uint64_t v, Usage usage, Range range);
     void custom(DeviceInterface *dev, Command *cmd);
     void mark_shader_dispatch(DeviceInterface *dev, ShaderDispatchCommandBase *cmd, bool contain_bindings);
+    void _analyze(uint64_t layer, vstd::vector<AccessRecord> const &records);
+    void _sync_layer(uint64_t layer);
 
 public:
-    vstd::unordered_map<RWResource *, CompeteResource> res_usages;
-    auto executed_layer() const { return _executed_layer; }
-    auto synced_layer() const { return _synced_layer; }
+    auto executed_layer() const { return _executed_layer.load(std::memory_order_relaxed); }
+    auto synced_layer() const { return _synced_layer.load(std::memory_order_relaxed); }
     vstd::string stream_tag() const;
     Stream(uint64_t handle, StreamTag stream_tag);
+    // begins a new layer, sampled layers record their resource accesses
     void dispatch();
     void dispatch(DeviceInterface *dev, CommandList &cmd_list);
+    void record(RWResource *res, Usage usage, Range range);
     void sync();
     void sync_layer(uint64_t layer);
     void signal(Event *evt, uint64_t fence);
     void wait(Event *evt, uint64_t fence);
+    // hands the accesses recorded in the current layer to the analyzer
     void check_compete();
 };
 }// namespace lc::validation
@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <spdlog/details/os.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <luisa/core/logging.h>
 #include <luisa/vstl/functional.h>
@@ -9,6 +14,8 @@ namespace luisa {
 namespace detail {
 
 static std::mutex LOGGER_MUTEX;
+// serializes enabling and disabling asynchronous logging
+static std::mutex ASYNC_LOGGER_CONTROL_MUTEX;
 
 template<typename Mt>
 class SinkWithCallback : public spdlog::sinks::base_sink<Mt> {
@@ -61,6 +68,226 @@ LC_CORE_API spdlog::sink_ptr create_sink_with_callback(void (*callback)(LCLogger
         callback(m);
     });
  }
+
+// Bounded lock-free MPSC ring (after D. Vyukov's bounded MPMC queue): each slot
+// carries a sequence number telling producers whether it is free and the
+// consumer whether it is published. A single background thread formats and
+// writes the messages to the sinks of the default logger.
+class AsyncLogger {
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence;
+        log_level level;
+        uint32_t size;
+        AsyncLogFormatter formatter;
+        // message text that does not fit in the payload
+        luisa::string *overflow;
+        spdlog::log_clock::time_point time;
+        size_t thread_id;
+        AsyncLogPayload payload;
+    };
+
+private:
+    luisa::unique_ptr<Slot[]> _slots;
+    uint64_t _capacity;
+    LogOverflowPolicy _policy;
+    alignas(64) std::atomic<uint64_t> _enqueue_position{0u};
+    alignas(64) std::atomic<uint64_t> _dequeue_position{0u};
+    alignas(64) std::atomic<uint64_t> _pending{0u};
+    std::atomic<bool> _sleeping{false};
+    std::atomic<bool> _stop{false};
+    std::thread _thread;
+
+public:
+    std::atomic<size_t> dropped{0u};
+
+private:
+    void _wake_consumer() noexcept {
+        _pending.fetch_add(1u);
+        if (_sleeping.load()) { _pending.notify_one(); }
+    }
+    [[nodiscard]] bool _wait_when_full(log_level level) const noexcept {
+        switch (_policy) {
+            case LogOverflowPolicy::DROP: return false;
+            case LogOverflowPolicy::BLOCK: return true;
+            case LogOverflowPolicy::DROP_BELOW_WARNING: return level >= spdlog::level::warn;
+        }
+        return false;
+    }
+    void _write(const Slot &slot, fmt::memory_buffer &buffer) noexcept {
+        auto text = luisa::string_view{};
+        if (slot.overflow != nullptr) {
+            text = *slot.overflow;
+        } else if (slot.formatter != nullptr) {
+            buffer.clear();
+            slot.formatter(slot.payload.data, buffer);
+            text = luisa::string_view{buffer.data(), buffer.size()};
+        } else {
+            text = luisa::string_view{reinterpret_cast<const char *>(slot.payload.data), slot.size};
+        }
+        std::lock_guard lock{LOGGER_MUTEX};
+        spdlog::details::log_msg msg{slot.time, spdlog::source_loc{}, LOGGER.name(), slot.level,
+                                     spdlog::string_view_t{text.data(), text.size()}};
+        msg.thread_id = slot.thread_id;
+        auto flush = slot.level >= LOGGER.flush_level();
+        for (auto &&sink : LOGGER.sinks()) {
+            if (sink->should_log(msg.level)) {
+                sink->log(msg);
+                if (flush) { sink->flush(); }
+            }
+        }
+    }
+    void _run() noexcept {
+        fmt::memory_buffer buffer;
+        for (;;) {
+            auto position = _dequeue_position.load(std::memory_order_relaxed);
+            auto &slot = _slots[position % _capacity];
+            if (slot.sequence.load(std::memory_order_acquire) == position + 1u) {
+                _write(slot, buffer);
+                if (slot.overflow != nullptr) {
+                    luisa::delete_with_allocator(slot.overflow);
+                    slot.overflow = nullptr;
+                }
+                slot.sequence.store(position + _capacity, std::memory_order_release);
+                _dequeue_position.store(position + 1u, std::memory_order_release);
+                continue;
+            }
+            // the queue is empty: wake up flushers, then sleep until a producer arrives
+            _dequeue_position.notify_all();
+            if (_stop.load()) { break; }
+            _sleeping.store(true);
+            auto pending = _pending.load();
+            if (slot.sequence.load(std::memory_order_acquire) != position + 1u && !_stop.load()) {
+                _pending.wait(pending);
+            }
+            _sleeping.store(false);
+        }
+    }
+
+public:
+    AsyncLogger(size_t capacity, LogOverflowPolicy policy) noexcept
+        : _slots{luisa::make_unique<Slot[]>(std::max<size_t>(capacity, 2u))},
+          _capacity{std::max<size_t>(capacity, 2u)},
+          _policy{policy} {
+        for (auto i = 0u; i < _capacity; i++) {
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+            _slots[i].overflow = nullptr;
+        }
+        _thread = std::thread{[this] { _run(); }};
+    }
+    ~AsyncLogger() noexcept {
+        // drains the queue before stopping
+        _stop.store(true);
+        _pending.fetch_add(1u);
+        _pending.notify_one();
+        _thread.join();
+    }
+    AsyncLogger(AsyncLogger &&) noexcept = delete;
+    AsyncLogger(const AsyncLogger &) noexcept = delete;
+
+    bool push(log_level level, AsyncLogFormatter formatter,
+              const std::byte *payload, size_t size) noexcept {
+        auto position = _enqueue_position.load(std::memory_order_relaxed);
+        for (;;) {
+            auto &slot = _slots[position % _capacity];
+            auto sequence = slot.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+            if (diff == 0) {
+                if (_enqueue_position.compare_exchange_weak(
+                        position, position + 1u, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // full
+                if (!_wait_when_full(level)) {
+                    dropped.fetch_add(1u, std::memory_order_relaxed);
+                    return false;
+                }
+                _wake_consumer();
+                std::this_thread::yield();
+                position = _enqueue_position.load(std::memory_order_relaxed);
+            } else {
+                position = _enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+        auto &slot = _slots[position % _capacity];
+        slot.level = level;
+        slot.formatter = formatter;
+        slot.time = spdlog::log_clock::now();
+        slot.thread_id = spdlog::details::os::thread_id();
+        if (size <= async_log_payload_size) {
+            slot.size = static_cast<uint32_t>(size);
+            std::memcpy(slot.payload.data, payload, size);
+        } else {
+            // only preformatted text can exceed the payload
+            slot.size = 0u;
+            slot.overflow = luisa::new_with_allocator<luisa::string>(
+                reinterpret_cast<const char *>(payload), size);
+        }
+        slot.sequence.store(position + 1u, std::memory_order_release);
+        _wake_consumer();
+        return true;
+    }
+
+    void flush() noexcept {
+        auto target = _enqueue_position.load();
+        _wake_consumer();
+        for (;;) {
+            auto position = _dequeue_position.load(std::memory_order_acquire);
+            if (position >= target) { break; }
+            _dequeue_position.wait(position);
+        }
+    }
+};
+
+// producers register themselves before using the logger so that it is not
+// destroyed under them when asynchronous logging is disabled
+static std::atomic<AsyncLogger *> ASYNC_LOGGER{nullptr};
+static std::atomic<uint32_t> ASYNC_LOGGER_USERS{0u};
+static std::atomic<size_t> ASYNC_LOGGER_DROPPED{0u};
+
+static void stop_async_logger() noexcept {
+    std::lock_guard lock{ASYNC_LOGGER_CONTROL_MUTEX};
+    if (auto logger = ASYNC_LOGGER.exchange(nullptr)) {
+        while (ASYNC_LOGGER_USERS.load() != 0u) { std::this_thread::yield(); }
+        ASYNC_LOGGER_DROPPED.store(logger->dropped.load());
+        luisa::delete_with_allocator(logger);
+    }
+}
+
+// flushes the queue at exit, destroyed before LOGGER
+static struct AsyncLoggerGuard {
+    ~AsyncLoggerGuard() noexcept { stop_async_logger(); }
+} ASYNC_LOGGER_GUARD;
+
+LC_CORE_API bool async_logging_enabled() noexcept {
+    return ASYNC_LOGGER.load(std::memory_order_relaxed) != nullptr;
+}
+
+LC_CORE_API bool async_log_push(log_level level, AsyncLogFormatter formatter,
+                                const std::byte *payload, size_t size) noexcept {
+    ASYNC_LOGGER_USERS.fetch_add(1u);
+    auto logger = ASYNC_LOGGER.load();
+    auto pushed = false;
+    if (logger != nullptr) [[likely]] {
+        pushed = logger->push(level, formatter, payload, size);
+        ASYNC_LOGGER_USERS.fetch_sub(1u);
+    } else {
+        // disabled concurrently, write synchronously
+        ASYNC_LOGGER_USERS.fetch_sub(1u);
+        if (formatter == nullptr) {
+            LOGGER.log(level, spdlog::string_view_t{reinterpret_cast<const char *>(payload), size});
+        } else {
+            fmt::memory_buffer buffer;
+            formatter(payload, buffer);
+            LOGGER.log(level, spdlog::string_view_t{buffer.data(), buffer.size()});
+        }
+        pushed = true;
+    }
+    return pushed;
+}
+
 }// namespace detail
 
 void log_level_verbose() noexcept { detail::default_logger().set_level(spdlog::level::debug); }
@@ -68,7 +295,29 @@ void log_level_info() noexcept { detail::default_logger().set_level(spdlog::leve
 void log_level_warning() noexcept { detail::default_logger().set_level(spdlog::level::warn); }
 void log_level_error() noexcept { detail::default_logger().set_level(spdlog::level::err); }
 
-void log_flush() noexcept { detail::default_logger().flush(); }
+void log_flush() noexcept {
+    detail::ASYNC_LOGGER_USERS.fetch_add(1u);
+    if (auto logger = detail::ASYNC_LOGGER.load()) { logger->flush(); }
+    detail::ASYNC_LOGGER_USERS.fetch_sub(1u);
+    detail::default_logger().flush();
+}
+
+void log_async_enable(size_t capacity, LogOverflowPolicy policy) noexcept {
+    detail::stop_async_logger();
+    std::lock_guard lock{detail::ASYNC_LOGGER_CONTROL_MUTEX};
+    detail::ASYNC_LOGGER_DROPPED.store(0u);
+    detail::ASYNC_LOGGER.store(luisa::new_with_allocator<detail::AsyncLogger>(capacity, policy));
+}
+
+void log_async_disable() noexcept { detail::stop_async_logger(); }
+
+size_t log_async_dropped_count() noexcept {
+    detail::ASYNC_LOGGER_USERS.fetch_add(1u);
+    auto logger = detail::ASYNC_LOGGER.load();
+    auto dropped = logger != nullptr ? logger->dropped.load() : detail::ASYNC_LOGGER_DROPPED.load();
+    detail::ASYNC_LOGGER_USERS.fetch_sub(1u);
+    return dropped;
+}
 
 }// namespace luisa
 
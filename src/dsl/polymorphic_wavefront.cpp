@@ -0,0 +1,116 @@
+#include <luisa/core/logging.h>
+#include <luisa/dsl/shared.h>
+#include <luisa/dsl/dispatch_indirect.h>
+#include <luisa/dsl/polymorphic_wavefront.h>
+
+namespace luisa::compute {
+
+PolymorphicQueue::PolymorphicQueue(Device &device, uint tag_count, uint capacity, bool indirect) noexcept
+    : _tag_count{tag_count}, _capacity{capacity} {
+    LUISA_ASSERT(tag_count > 0u, "Polymorphic queues require at least one tag.");
+    LUISA_ASSERT(capacity > 0u, "Polymorphic queues require a non-zero capacity.");
+    _bins = device.create_buffer<uint>(tag_count * 3u);
+    _items = device.create_buffer<uint>(capacity);
+    if (indirect) { _dispatch_buffer = device.create_indirect_dispatch_buffer(tag_count); }
+
+    // layout of the bins: [counts | offsets | cursors]
+    auto counts = _bins.view(0u, tag_count);
+    auto offsets = _bins.view(tag_count, tag_count);
+    auto cursors = _bins.view(tag_count * 2u, tag_count);
+    auto items = _items.view();
+
+    _clear = device.compile<1>([counts] {
+        counts->write(dispatch_x(), 0u);
+    });
+
+    // threads of a block share a histogram, so that each block
+    // issues at most one global atomic operation per tag
+    _count = device.compile<1>([counts, tag_count](BufferUInt tags, UInt n) noexcept {
+        set_block_size(block_size, 1u, 1u);
+        Shared<uint> histogram{tag_count};
+        dsl::loop(thread_x(), def(tag_count), def(block_size), [&](auto t) noexcept {
+            histogram.write(t, 0u);
+        });
+        sync_block();
+        auto i = dispatch_x();
+        dsl::if_(i < n, [&] {
+            histogram.atomic(tags.read(i)).fetch_add(1u);
+        });
+        sync_block();
+        dsl::loop(thread_x(), def(tag_count), def(block_size), [&](auto t) noexcept {
+            auto count = histogram.read(t);
+            dsl::if_(count != 0u, [&] {
+                counts->atomic(t).fetch_add(count);
+            });
+        });
+    });
+
+    _scan = device.compile<1>([this, counts, offsets, cursors, tag_count] {
+        auto offset = def(0u);
+        dsl::loop(def(tag_count), [&](auto t) noexcept {
+            auto count = counts->read(t);
+            offsets->write(t, offset);
+            cursors->write(t, offset);
+            offset += count;
+        });
+        if (_dispatch_buffer) {
+            Expr<IndirectDispatchBuffer> dispatch_buffer{_dispatch_buffer};
+            dispatch_buffer.set_dispatch_count(tag_count);
+            dsl::loop(def(tag_count), [&](auto t) noexcept {
+                dispatch_buffer.set_kernel(t, luisa::make_uint3(dispatch_block_size, 1u, 1u),
+                                           dsl::make_uint3(counts->read(t), 1u, 1u), t);
+            });
+        }
+    });
+
+    // items are ranked within the block by the shared histogram, and
+    // each block reserves the ranges of its items in the queues at once
+    _scatter = device.compile<1>([items, cursors, tag_count](BufferUInt tags, UInt n) noexcept {
+        set_block_size(block_size, 1u, 1u);
+        Shared<uint> histogram{tag_count};
+        dsl::loop(thread_x(), def(tag_count), def(block_size), [&](auto t) noexcept {
+            histogram.write(t, 0u);
+        });
+        sync_block();
+        auto i = dispatch_x();
+        auto valid = i < n;
+        auto tag = def(0u);
+        auto rank = def(0u);
+        dsl::if_(valid, [&] {
+            tag = tags.read(i);
+            rank = histogram.atomic(tag).fetch_add(1u);
+        });
+        sync_block();
+        dsl::loop(thread_x(), def(tag_count), def(block_size), [&](auto t) noexcept {
+            auto count = histogram.read(t);
+            dsl::if_(count != 0u, [&] {
+                histogram.write(t, cursors->atomic(t).fetch_add(count));
+            });
+        });
+        sync_block();
+        dsl::if_(valid, [&] {
+            items->write(histogram.read(tag) + rank, i);
+        });
+    });
+}
+
+const IndirectDispatchBuffer &PolymorphicQueue::dispatch_buffer() const noexcept {
+    LUISA_ASSERT(is_indirect(), "Indirect dispatch is not enabled for the polymorphic queue.");
+    return _dispatch_buffer;
+}
+
+void PolymorphicQueue::bin(CommandList &list, BufferView<uint> tags, uint n) const noexcept {
+    LUISA_ASSERT(n <= _capacity && n <= tags.size(),
+                 "Cannot bin {} items into polymorphic queues "
+                 "with capacity {} from {} tags.",
+                 n, _capacity, tags.size());
+    if (n == 0u) { return; }
+    // the binning kernels synchronize blocks, so they run on whole blocks
+    auto block_count = (n + block_size - 1u) / block_size;
+    list << _clear().dispatch(_tag_count)
+         << _count(tags, n).dispatch(block_count * block_size)
+         << _scan().dispatch(1u)
+         << _scatter(tags, n).dispatch(block_count * block_size);
+}
+
+}// namespace luisa::compute
@@ -1,3 +1,5 @@
+#include <cstring>
+
 #include <luisa/core/logging.h>
 #include <luisa/dsl/soa.h>
 
@@ -15,4 +17,101 @@ void error_soa_index_out_of_range() noexcept {
     LUISA_ERROR_WITH_LOCATION("SOAView::operator[] out of range.");
 }
 
+void error_aosoa_host_data_too_small(size_t size, size_t expected) noexcept {
+    LUISA_ERROR_WITH_LOCATION("AOSOA host data too small: {} uints "
+                              "provided but {} required.",
+                              size, expected);
+}
+
+namespace {
+
+// a field stored as a separate array in SOA<T>
+struct SOAField {
+    size_t offset;     // in bytes, in the AoS element
+    size_t size;       // in bytes
+    size_t stride;     // in uints, in the SOA array
+    size_t tile_offset;// in uints, in an AOSOA tile
+};
+
+// mirrors the splitting of types by SOAView<T> and Expr<SOA<T>>: structures into
+// members, matrices into columns and vectors and arrays into elements of at least
+// the size of a uint; everything else is stored as a whole
+void collect_soa_fields(const Type *type, size_t offset, luisa::vector<SOAField> &fields) noexcept {
+    if (type->is_structure()) {
+        auto member_offset = static_cast<size_t>(0u);
+        for (auto m : type->members()) {
+            member_offset = (member_offset + m->alignment() - 1u) / m->alignment() * m->alignment();
+            collect_soa_fields(m, offset + member_offset, fields);
+            member_offset += m->size();
+        }
+    } else if (type->is_matrix()) {
+        auto column = Type::vector(type->element(), type->dimension());
+        for (auto i = 0u; i < type->dimension(); i++) {
+            collect_soa_fields(column, offset + i * column->size(), fields);
+        }
+    } else if ((type->is_vector() || type->is_array()) &&
+               type->element()->size() >= sizeof(uint)) {
+        auto element = type->element();
+        for (auto i = 0u; i < type->dimension(); i++) {
+            collect_soa_fields(element, offset + i * element->size(), fields);
+        }
+    } else {
+        auto stride = (type->size() + sizeof(uint) - 1u) / sizeof(uint);
+        fields.emplace_back(SOAField{offset, type->size(), stride, 0u});
+    }
+}
+
+[[nodiscard]] luisa::vector<SOAField> aosoa_fields(const Type *type, uint tile_width, size_t tile_size) noexcept {
+    luisa::vector<SOAField> fields;
+    collect_soa_fields(type, 0u, fields);
+    auto size = static_cast<size_t>(0u);
+    for (auto &&f : fields) {
+        f.tile_offset = size;
+        size += compute_soa_field_size(tile_width * f.stride);
+    }
+    LUISA_ASSERT(size == tile_size,
+                 "AOSOA tile layout mismatch for type {}: "
+                 "{} uints on host, {} uints on device.",
+                 type->description(), size, tile_size);
+    return fields;
+}
+
+}// namespace
+
+void aosoa_encode(const Type *type, uint tile_width, size_t tile_size,
+                  const void *aos, size_t n, uint *aosoa) noexcept {
+    auto fields = aosoa_fields(type, tile_width, tile_size);
+    auto src = static_cast<const std::byte *>(aos);
+    // the unused lanes of the last tile are zeroed
+    if (n % tile_width != 0u) {
+        std::memset(aosoa + n / tile_width * tile_size, 0, tile_size * sizeof(uint));
+    }
+    for (auto i = static_cast<size_t>(0u); i < n; i++) {
+        auto tile = aosoa + i / tile_width * tile_size;
+        auto lane = i % tile_width;
+        auto element = src + i * type->size();
+        for (auto &&f : fields) {
+            auto dst = tile + f.tile_offset + lane * f.stride;
+            if (f.size < f.stride * sizeof(uint)) {
+                std::memset(dst, 0, f.stride * sizeof(uint));
+            }
+            std::memcpy(dst, element + f.offset, f.size);
+        }
+    }
+}
+
+void aosoa_decode(const Type *type, uint tile_width, size_t tile_size,
+                  const uint *aosoa, size_t n, void *aos) noexcept {
+    auto fields = aosoa_fields(type, tile_width, tile_size);
+    auto dst = static_cast<std::byte *>(aos);
+    for (auto i = static_cast<size_t>(0u); i < n; i++) {
+        auto tile = aosoa + i / tile_width * tile_size;
+        auto lane = i % tile_width;
+        auto element = dst + i * type->size();
+        for (auto &&f : fields) {
+            std::memcpy(element + f.offset, tile + f.tile_offset + lane * f.stride, f.size);
+        }
+    }
+}
+
 }// namespace luisa::compute::detail
@@ -1,3 +1,7 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
 #include <luisa/gui/framerate.h>
 
 namespace luisa::compute {
@@ -22,14 +26,20 @@ double Framerate::duration() const noexcept {
 }
 
 void Framerate::record(size_t frame_count) noexcept {
-    if (_durations.size() == _history_size) {
-        _durations.erase(_durations.begin());
-        _frames.erase(_frames.begin());
+    record(Clock::now(), frame_count);
+}
+
+void Framerate::record(Timepoint time, size_t frame_count) noexcept {
+    if (frame_count != 0u) {
+        if (_durations.size() == _history_size) {
+            _durations.erase(_durations.begin());
+            _frames.erase(_frames.begin());
+        }
+        using namespace std::chrono_literals;
+        _durations.emplace_back(static_cast<double>((time - _last) / 1ns) * 1e-9);
+        _frames.emplace_back(frame_count);
     }
-    using namespace std::chrono_literals;
-    _durations.emplace_back(duration());
-    _frames.emplace_back(frame_count);
-    _last = Clock::now();
+    _last = time;
 }
 
 double Framerate::report() const noexcept {
@@ -43,5 +53,27 @@ double Framerate::report() const noexcept {
     return static_cast<double>(total_frame_count) / total_duration;
 }
 
+Framerate::Pacing Framerate::pacing() const noexcept {
+    Pacing pacing{0.0, std::numeric_limits<double>::max(), 0.0, 0.0};
+    auto total_frame_count = static_cast<size_t>(0u);
+    for (auto i = 0u; i < _durations.size(); i++) {
+        // the frames of a record are assumed to have taken equally long
+        auto d = _durations[i] / static_cast<double>(_frames[i]);
+        pacing.mean += _durations[i];
+        pacing.min = std::min(pacing.min, d);
+        pacing.max = std::max(pacing.max, d);
+        total_frame_count += _frames[i];
+    }
+    if (total_frame_count == 0u) { return {}; }
+    pacing.mean /= static_cast<double>(total_frame_count);
+    auto variance = 0.0;
+    for (auto i = 0u; i < _durations.size(); i++) {
+        auto e = _durations[i] / static_cast<double>(_frames[i]) - pacing.mean;
+        variance += e * e * static_cast<double>(_frames[i]);
+    }
+    pacing.jitter = std::sqrt(variance / static_cast<double>(total_frame_count));
+    return pacing;
+}
+
 }
 
@@ -4,29 +4,72 @@ namespace luisa::compute {
 
 namespace detail {
 
-template<typename M>
-void perform_ir_transform(M *m, luisa::span<const luisa::string> transforms) noexcept {
+[[nodiscard]] static auto create_ir_transform_pipeline(luisa::span<const luisa::string> transforms) noexcept {
     auto pipeline = ir::luisa_compute_ir_transform_pipeline_new();
     for (auto &&transform : transforms) {
         ir::luisa_compute_ir_transform_pipeline_add_transform(pipeline, transform.c_str());
     }
-    auto converted_module = ir::luisa_compute_ir_transform_pipeline_transform(pipeline, m->module);
-    ir::luisa_compute_ir_transform_pipeline_destroy(pipeline);
-    m->module = converted_module;
+    return pipeline;
 }
 
 }// namespace detail
 
+IRTransformPipeline::IRTransformPipeline(luisa::span<const luisa::string> transforms) noexcept
+    : _pipeline{compute::detail::create_ir_transform_pipeline(transforms)} {}
+
+IRTransformPipeline::~IRTransformPipeline() noexcept {
+    if (_pipeline != nullptr) { ir::luisa_compute_ir_transform_pipeline_destroy(_pipeline); }
+}
+
+luisa::unique_ptr<IRTransformPipeline> IRTransformPipeline::create_auto() noexcept {
+    static const luisa::string transforms[]{"autodiff", "fwd_autodiff"};
+    return luisa::make_unique<IRTransformPipeline>(transforms);
+}
+
+void IRTransformPipeline::transform(ir::CallableModule *m) noexcept {
+    std::scoped_lock lock{_mutex};
+    ir::luisa_compute_ir_transform_pipeline_transform_callable(_pipeline, m);
+}
+
+void IRTransformPipeline::transform(ir::KernelModule *m) noexcept {
+    std::scoped_lock lock{_mutex};
+    // write back the module so the cleared flags prevent re-running autodiff
+    m->module = ir::luisa_compute_ir_transform_pipeline_transform(_pipeline, m->module);
+}
+
+void IRTransformPipeline::clear_cache() noexcept {
+    std::scoped_lock lock{_mutex};
+    ir::luisa_compute_ir_transform_pipeline_clear_cache(_pipeline);
+}
+
+IRTransformPipeline::CacheStatistics IRTransformPipeline::cache_statistics() noexcept {
+    std::scoped_lock lock{_mutex};
+    auto stats = ir::luisa_compute_ir_transform_pipeline_cache_statistics(_pipeline);
+    return {stats.hits, stats.misses};
+}
+
 void transform_ir_callable_module(ir::CallableModule *m, luisa::span<const luisa::string> transforms) noexcept {
-    compute::detail::perform_ir_transform(m, transforms);
+    IRTransformPipeline{transforms}.transform(m);
 }
 
 void transform_ir_kernel_module(ir::KernelModule *m, luisa::span<const luisa::string> transforms) noexcept {
-    compute::detail::perform_ir_transform(m, transforms);
+    IRTransformPipeline{transforms}.transform(m);
 }
 
 void transform_ir_kernel_module_auto(ir::KernelModule *m) noexcept {
-    ir::luisa_compute_ir_transform_auto(m->module);
+    // write back the module so the cleared flags prevent re-running autodiff
+    m->module = ir::luisa_compute_ir_transform_auto(m->module);
+}
+
+luisa::string transform_ir_statistics() noexcept {
+    auto report = ir::luisa_compute_ir_transform_statistics_report();
+    luisa::string s{reinterpret_cast<const char *>(report.ptr), report.len};
+    ir::destroy_boxed_slice(report);
+    return s;
+}
+
+void transform_ir_statistics_reset() noexcept {
+    ir::luisa_compute_ir_transform_statistics_reset();
 }
 
 }// namespace luisa::compute
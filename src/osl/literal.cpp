@@ -55,6 +55,15 @@ float Literal::as_float() const noexcept {
     return static_cast<float>(_value.n);
 }
 
+double Literal::as_double() const noexcept {
+    if (!is_number()) {
+        LUISA_WARNING_WITH_LOCATION(
+            "Literal is not a double.");
+        return 0.;
+    }
+    return _value.n;
+}
+
 luisa::string_view Literal::as_string() const noexcept {
     if (!is_string()) {
         LUISA_WARNING_WITH_LOCATION(
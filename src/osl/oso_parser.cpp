@@ -1,5 +1,6 @@
+#include <array>
 #include <cmath>
-#include <fstream>
+#include <cstring>
 
 #include <luisa/core/logging.h>
 #include <luisa/core/stl/queue.h>
@@ -12,6 +13,8 @@
 #include <luisa/osl/instruction.h>
 #include <luisa/osl/oso_parser.h>
 
+#include "oso_utils.h"
+
 namespace luisa::compute::osl {
 
 struct OSOParser::ShaderDecl {
@@ -36,42 +39,84 @@ struct OSOParser::ShaderDecl {
 
 namespace detail {
 
+// classes of the characters, looked up in a table rather than with the locale-aware <cctype>
+enum CharClass : uint8_t {
+    CHAR_IDENTIFIER_HEAD = 1u << 0u,
+    CHAR_IDENTIFIER_BODY = 1u << 1u,
+    CHAR_NUMBER_HEAD = 1u << 2u,
+    CHAR_NUMBER_BODY = 1u << 3u,
+    CHAR_WHITESPACE = 1u << 4u,
+};
+
+static constexpr auto char_classes = [] {
+    std::array<uint8_t, 256u> classes{};
+    auto add = [&classes](luisa::string_view chars, uint8_t c) noexcept {
+        for (auto ch : chars) { classes[static_cast<uint8_t>(ch)] |= c; }
+    };
+    constexpr luisa::string_view letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    constexpr luisa::string_view digits = "0123456789";
+    add(letters, CHAR_IDENTIFIER_HEAD | CHAR_IDENTIFIER_BODY);
+    add(digits, CHAR_IDENTIFIER_BODY | CHAR_NUMBER_HEAD | CHAR_NUMBER_BODY);
+    add("_$", CHAR_IDENTIFIER_HEAD | CHAR_IDENTIFIER_BODY);
+    add(".", CHAR_IDENTIFIER_BODY | CHAR_NUMBER_HEAD | CHAR_NUMBER_BODY);
+    add("+-", CHAR_NUMBER_HEAD | CHAR_NUMBER_BODY);
+    add("eE", CHAR_NUMBER_BODY);
+    add(" \t\f\v\r", CHAR_WHITESPACE);
+    return classes;
+}();
+
+[[nodiscard]] inline auto is_char_of_class(char c, CharClass char_class) noexcept {
+    return (char_classes[static_cast<uint8_t>(c)] & char_class) != 0u;
+}
+
 [[nodiscard]] inline auto is_identifier_head(char c) noexcept {
-    return isalpha(c) || c == '_' || c == '$';
+    return is_char_of_class(c, CHAR_IDENTIFIER_HEAD);
 }
 
 [[nodiscard]] inline auto is_identifier_body(char c) noexcept {
-    return isalnum(c) || c == '_' || c == '$' || c == '.';
+    return is_char_of_class(c, CHAR_IDENTIFIER_BODY);
 }
 
 [[nodiscard]] inline auto is_number_head(char c) noexcept {
-    return isdigit(c) || c == '.' || c == '-' || c == '+';
+    return is_char_of_class(c, CHAR_NUMBER_HEAD);
 }
 
 [[nodiscard]] inline auto is_number_body(char c) noexcept {
-    return isdigit(c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-';
+    return is_char_of_class(c, CHAR_NUMBER_BODY);
+}
+
+[[nodiscard]] inline auto is_whitespace(char c) noexcept {
+    return is_char_of_class(c, CHAR_WHITESPACE);
 }
 
 }// namespace detail
 
 OSOParser::OSOParser(luisa::string_view source,
                      luisa::string_view path) noexcept
-    : _state{source, 0u, 0u}, _path{path} {}
+    : _state{source.data(), source.data(), 0u},
+      _end{source.data() + source.size()}, _path{path} {}
 
 OSOParser::~OSOParser() noexcept = default;
 
-luisa::unique_ptr<Shader> OSOParser::parse(luisa::string_view source) noexcept {
-    OSOParser parser{source};
+luisa::unique_ptr<Shader> OSOParser::parse(luisa::string_view source,
+                                           luisa::string_view path) noexcept {
+    OSOParser parser{source, path};
     return parser._parse();
 }
 
 luisa::unique_ptr<Shader> OSOParser::parse_file(luisa::string_view path) noexcept {
-    std::ifstream file{luisa::filesystem::path{path}};
-    LUISA_ASSERT(file.is_open(), "Failed to open file '{}'.", path);
-    luisa::string source{std::istreambuf_iterator<char>{file},
-                         std::istreambuf_iterator<char>{}};
-    OSOParser parser{source, path};
-    return parser._parse();
+    detail::MappedFile file{path};
+    LUISA_ASSERT(file.valid(), "Failed to open file '{}'.", path);
+    return parse(file.source(), path);
+}
+
+luisa::vector<luisa::unique_ptr<Shader>> OSOParser::parse_files(
+    luisa::span<const luisa::string> paths, ThreadPool &pool) noexcept {
+    luisa::vector<luisa::unique_ptr<Shader>> shaders(paths.size());
+    luisa::parallel_for(pool, paths.size(), [&](size_t i) noexcept {
+        shaders[i] = parse_file(paths[i]);
+    });
+    return shaders;
 }
 
 void OSOParser::_parse_shader_decl() noexcept {
@@ -120,7 +165,7 @@ luisa::unique_ptr<Symbol> OSOParser::_parse_symbol() noexcept {
     // symbol : SYMTYPE typespec arraylen_opt IDENTIFIER initial_values_opt hints_opt ENDOFLINE
     // arraylen_opt : '[' INT_LITERAL ']' | '[' ']'
     auto backup = _backup();
-    auto op = _parse_identifier();
+    auto op = _scan_identifier();
     using namespace std::string_view_literals;
     auto tag = [&op]() noexcept -> luisa::optional<Symbol::Tag> {
         if (op == "param"sv) { return Symbol::Tag::SYM_PARAM; }
@@ -247,7 +292,7 @@ luisa::vector<const Symbol *> OSOParser::_parse_arguments() noexcept {
     luisa::vector<const Symbol *> args;
     while (!_eol()) {
         if (!_is_identifier()) { break; }
-        auto ident = _parse_identifier();
+        auto ident = _scan_identifier();
         auto iter = _id_to_symbol.find(ident);
         LUISA_ASSERT(iter != _id_to_symbol.end(),
                      "Unknown symbol '{}' at {}.",
@@ -273,49 +318,71 @@ luisa::vector<int> OSOParser::_parse_jump_targets() noexcept {
     return targets;
 }
 
-luisa::string OSOParser::_parse_identifier() noexcept {
+luisa::string_view OSOParser::_scan_identifier() noexcept {
+    auto p_begin = _state.cursor;
     auto head = _read();
     LUISA_ASSERT(detail::is_identifier_head(head),
                  "Invalid identifier head '{}' at {}. "
                  "Expected [a-zA-Z_$].",
                  head, _location());
-    luisa::string result;
-    result.push_back(head);
-    while (!_eol()) {
-        auto c = _peek();
-        if (!detail::is_identifier_body(c)) { break; }
-        result.push_back(_read());
-    }
-    return result;
+    // tokens never span lines, so the cursor is advanced without tracking them
+    auto p = _state.cursor;
+    while (p != _end && detail::is_identifier_body(*p)) { p++; }
+    _state.cursor = p;
+    return {p_begin, static_cast<size_t>(p - p_begin)};
+}
+
+luisa::string_view OSOParser::_scan_integer() noexcept {
+    // only integers that print back as they are written, i.e., [-]?(0|[1-9][0-9]*) with
+    // few enough digits to be exact in a double; the cursor is unchanged if there is none
+    auto p_begin = _state.cursor;
+    auto p = p_begin;
+    if (p != _end && *p == '-') { p++; }
+    auto p_digits = p;
+    while (p != _end && *p >= '0' && *p <= '9') { p++; }
+    auto digits = p - p_digits;
+    if (digits == 0 || digits > 15 || (*p_digits == '0' && digits > 1) ||
+        (p != _end && detail::is_number_body(*p))) { return {}; }
+    _state.cursor = p;
+    return {p_begin, static_cast<size_t>(p - p_begin)};
+}
+
+luisa::string OSOParser::_parse_identifier() noexcept {
+    return luisa::string{_scan_identifier()};
 }
 
 double OSOParser::_parse_number() noexcept {
-    auto p_begin = _state.source.data();
+    auto p_begin = _state.cursor;
     auto head = _read();
     LUISA_ASSERT(detail::is_number_head(head),
                  "Invalid number head '{}' at {}. "
                  "Expected [0-9.].",
                  head, _location());
-    while (!_eol()) {
-        auto c = _peek();
-        if (!detail::is_number_body(c)) { break; }
-        static_cast<void>(_read());
-    }
+    auto p_end = _state.cursor;
+    while (p_end != _end && detail::is_number_body(*p_end)) { p_end++; }
+    _state.cursor = p_end;
     if (*p_begin == '+') { ++p_begin; }
-    auto p_end = _state.source.data();
-    auto p_ret = p_end;
-    auto x = std::strtod(p_begin, const_cast<char **>(&p_ret));
-    LUISA_ASSERT(p_ret == p_end,
+    // copied out, as the source (e.g., a mapped file) is not null-terminated
+    auto token = luisa::string_view{p_begin, static_cast<size_t>(p_end - p_begin)};
+    std::array<char, 64u> buffer{};
+    LUISA_ASSERT(token.size() < buffer.size(),
+                 "Invalid number '{}' at {}. "
+                 "Expected at most {} characters.",
+                 token, _location(), buffer.size() - 1u);
+    std::memcpy(buffer.data(), token.data(), token.size());
+    char *p_ret = nullptr;
+    auto x = std::strtod(buffer.data(), &p_ret);
+    LUISA_ASSERT(p_ret == buffer.data() + token.size(),
                  "Invalid number '{}' at {}. "
                  "Expected [0-9.].",
-                 luisa::string_view{p_begin, static_cast<size_t>(p_end - p_begin)}, _location());
+                 token, _location());
     return x;
 }
 
 luisa::string OSOParser::_parse_string(bool keep_quotes) noexcept {
     // parse the string without escape sequences
     if (keep_quotes) {
-        auto p_begin = _state.source.data();
+        auto p_begin = _state.cursor;
         _match('"');
         while (!_eol()) {
             auto c = _peek();
@@ -324,7 +391,7 @@ luisa::string OSOParser::_parse_string(bool keep_quotes) noexcept {
             if (c == '\\') { static_cast<void>(_read()); }
         }
         _match('"');
-        auto p_end = _state.source.data();
+        auto p_end = _state.cursor;
         return luisa::string{p_begin, static_cast<size_t>(p_end - p_begin)};
     }
     // handle escape sequences
@@ -374,7 +441,12 @@ Hint OSOParser::_parse_hint() noexcept {
         while (!_eol()) {
             if (_peek() == '}') { break; }
             if (_is_number()) {
-                args.emplace_back(luisa::format("{}", _parse_number()));
+                // integers, e.g., the ranges in %read and %write, need not go through doubles
+                if (auto integer = _scan_integer(); !integer.empty()) {
+                    args.emplace_back(integer);
+                } else {
+                    args.emplace_back(luisa::format("{}", _parse_number()));
+                }
             } else if (_is_string()) {
                 args.emplace_back(_parse_string(true));
             } else {
@@ -403,7 +475,7 @@ Hint OSOParser::_parse_hint() noexcept {
 const Type *OSOParser::_parse_type() noexcept {
     // typespec : simple_typename | CLOSURE simple_typename | STRUCT IDENTIFIER
     // simple_typename : COLORTYPE | FLOATTYPE | INTTYPE | MATRIXTYPE | NORMALTYPE | POINTTYPE | STRINGTYPE | VECTORTYPE | VOIDTYPE
-    auto ident = _parse_identifier();
+    auto ident = _scan_identifier();
     using namespace std::string_view_literals;
     luisa::unique_ptr<Type> type;
     if (ident == "closure") {
@@ -420,12 +492,12 @@ const Type *OSOParser::_parse_type() noexcept {
         type = luisa::make_unique<ClosureType>(gentype);
     } else if (ident == "struct") {
         _skip_whitespaces();
-        ident = _parse_identifier();
+        ident = _scan_identifier();
         if (auto iter = _id_to_type.find(ident);
             iter != _id_to_type.end()) {
             return iter->second;
         }
-        type = luisa::make_unique<StructType>(std::move(ident));
+        type = luisa::make_unique<StructType>(luisa::string{ident});
     } else {
         if (auto iter = _id_to_type.find(ident);
             iter != _id_to_type.end()) {
@@ -478,6 +550,8 @@ luisa::vector<Literal> OSOParser::_parse_initial_values() noexcept {
 
 luisa::vector<Hint> OSOParser::_parse_hints() noexcept {
     luisa::vector<Hint> hints;
+    // symbols usually come with %read and %write
+    if (_is_hint()) { hints.reserve(2u); }
     while (_is_hint()) {
         hints.emplace_back(_parse_hint());
         _skip_whitespaces();
@@ -593,18 +667,15 @@ luisa::unique_ptr<Shader> OSOParser::_parse() noexcept {
 
 char OSOParser::_peek() const noexcept {
     LUISA_ASSERT(!_eof(), "Unexpected EOF at {}.", _location());
-    return _state.source.front();
+    return *_state.cursor;
 }
 
 char OSOParser::_read() noexcept {
     LUISA_ASSERT(!_eof(), "Unexpected EOF at {}.", _location());
-    auto c = _state.source.front();
-    _state.source.remove_prefix(1);
+    auto c = *_state.cursor++;
     if (c == '\n') {
         _state.line++;
-        _state.column = 0u;
-    } else {
-        _state.column++;
+        _state.line_begin = _state.cursor;
     }
     return c;
 }
@@ -628,22 +699,23 @@ void OSOParser::_match_eol() noexcept {
 }
 
 luisa::string OSOParser::_location() const noexcept {
+    auto column = static_cast<uint32_t>(_state.cursor - _state.line_begin);
     return _path.empty() ?
                luisa::format("({}:{})",
                              _state.line + 1u,
-                             _state.column + 1u) :
+                             column + 1u) :
                luisa::format("({}:{}:{})",
                              _path,
                              _state.line + 1u,
-                             _state.column + 1u);
+                             column + 1u);
 }
 
 bool OSOParser::_eof() const noexcept {
-    return _state.source.empty();
+    return _state.cursor == _end;
 }
 
 bool OSOParser::_eol() const noexcept {
-    return _eof() || _peek() == '\n';
+    return _eof() || *_state.cursor == '\n';
 }
 
 bool OSOParser::_is_number() const noexcept {
@@ -663,17 +735,14 @@ bool OSOParser::_is_hint() const noexcept {
 }
 
 void OSOParser::_skip_whitespaces() noexcept {
-    auto is_whitespace = [](char c) noexcept {
-        return c == ' ' || c == '\t' || c == '\f' || c == '\v' || c == '\r';
-    };
-    while (!_eof() && is_whitespace(_peek())) {
-        static_cast<void>(_read());
-    }
-    if (!_eof() && _peek() == '#') {
-        while (!_eof() && !_eol()) {
-            static_cast<void>(_read());
-        }
+    // whitespaces and comments stop at line breaks, so lines need not be tracked
+    auto p = _state.cursor;
+    while (p != _end && detail::is_whitespace(*p)) { p++; }
+    if (p != _end && *p == '#') {
+        auto eol = static_cast<const char *>(std::memchr(p, '\n', _end - p));
+        p = eol == nullptr ? _end : eol;
     }
+    _state.cursor = p;
 }
 
 void OSOParser::_skip_empty_lines() noexcept {
@@ -0,0 +1,68 @@
+#ifdef LUISA_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "oso_utils.h"
+
+namespace luisa::compute::osl::detail {
+
+// an empty file is mapped to an empty (but valid) source
+static constexpr char empty_file[1]{};
+
+MappedFile::MappedFile(luisa::string_view path) noexcept {
+    luisa::string path_string{path};
+#ifdef LUISA_PLATFORM_WINDOWS
+    auto file = CreateFileA(path_string.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) { return; }
+    LARGE_INTEGER size{};
+    if (GetFileSizeEx(file, &size) && size.QuadPart == 0) {
+        _data = empty_file;
+    } else if (size.QuadPart > 0) {
+        if (auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+            if (auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) {
+                _data = static_cast<const char *>(view);
+                _size = static_cast<size_t>(size.QuadPart);
+                _mapping = mapping;
+            } else {
+                CloseHandle(mapping);
+            }
+        }
+    }
+    CloseHandle(file);
+#else
+    auto fd = ::open(path_string.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return; }
+    struct stat status {};
+    if (fstat(fd, &status) == 0) {
+        if (status.st_size == 0) {
+            _data = empty_file;
+        } else if (auto memory = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                   memory != MAP_FAILED) {
+            // the file is read front to back once
+            madvise(memory, status.st_size, MADV_SEQUENTIAL);
+            _data = static_cast<const char *>(memory);
+            _size = static_cast<size_t>(status.st_size);
+            _mapping = memory;
+        }
+    }
+    ::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() noexcept {
+    if (_mapping == nullptr) { return; }
+#ifdef LUISA_PLATFORM_WINDOWS
+    UnmapViewOfFile(_data);
+    CloseHandle(_mapping);
+#else
+    munmap(_mapping, _size);
+#endif
+}
+
+}// namespace luisa::compute::osl::detail
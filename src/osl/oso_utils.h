@@ -0,0 +1,27 @@
+#pragma once
+
+#include <luisa/core/thread_pool.h>
+#include <luisa/core/stl/string.h>
+
+namespace luisa::compute::osl::detail {
+
+// A read-only memory mapping of a whole file; empty if the file cannot be opened.
+class MappedFile {
+
+private:
+    const char *_data{nullptr};
+    size_t _size{0u};
+    void *_mapping{nullptr};
+
+public:
+    explicit MappedFile(luisa::string_view path) noexcept;
+    ~MappedFile() noexcept;
+    MappedFile(MappedFile &&) noexcept = delete;
+    MappedFile(const MappedFile &) noexcept = delete;
+    MappedFile &operator=(MappedFile &&) noexcept = delete;
+    MappedFile &operator=(const MappedFile &) noexcept = delete;
+    [[nodiscard]] auto valid() const noexcept { return _data != nullptr; }
+    [[nodiscard]] auto source() const noexcept { return luisa::string_view{_data, _size}; }
+};
+
+}// namespace luisa::compute::osl::detail
@@ -0,0 +1,440 @@
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/hash.h>
+
+#include <luisa/osl/type.h>
+#include <luisa/osl/literal.h>
+#include <luisa/osl/symbol.h>
+#include <luisa/osl/instruction.h>
+#include <luisa/osl/oso_parser.h>
+#include <luisa/osl/shader_library.h>
+
+#include "oso_utils.h"
+
+namespace luisa::compute::osl {
+
+namespace detail {
+
+static constexpr uint32_t shader_cache_magic = 0x43534f4cu;
+
+// Shaders are stored as their fields in order, with counts before lists and
+// lengths before strings; types and symbols are referred to by their indices.
+class ShaderCacheWriter {
+
+private:
+    luisa::vector<std::byte> _data;
+
+public:
+    template<typename T>
+    void put(T value) noexcept {
+        static_assert(std::is_trivially_copyable_v<T>);
+        auto offset = _data.size();
+        _data.resize(offset + sizeof(T));
+        std::memcpy(_data.data() + offset, &value, sizeof(T));
+    }
+    void put_string(luisa::string_view s) noexcept {
+        put(static_cast<uint32_t>(s.size()));
+        auto offset = _data.size();
+        _data.resize(offset + s.size());
+        std::memcpy(_data.data() + offset, s.data(), s.size());
+    }
+    void put_hints(luisa::span<const Hint> hints) noexcept {
+        put(static_cast<uint32_t>(hints.size()));
+        for (auto &&hint : hints) {
+            put_string(hint.identifier());
+            put(static_cast<uint32_t>(hint.args().size()));
+            for (auto &&arg : hint.args()) { put_string(arg); }
+        }
+    }
+    [[nodiscard]] auto data() noexcept { return std::move(_data); }
+};
+
+// reads back what ShaderCacheWriter wrote; once out of data, every read
+// returns zeros and ok() is false
+class ShaderCacheReader {
+
+private:
+    luisa::span<const std::byte> _data;
+    bool _ok{true};
+
+public:
+    explicit ShaderCacheReader(luisa::span<const std::byte> data) noexcept : _data{data} {}
+    [[nodiscard]] auto ok() const noexcept { return _ok; }
+    // marks the data as malformed
+    void fail() noexcept { _ok = false; }
+    template<typename T>
+    [[nodiscard]] T get() noexcept {
+        T value{};
+        if (_data.size() < sizeof(T)) {
+            _ok = false;
+            return value;
+        }
+        std::memcpy(&value, _data.data(), sizeof(T));
+        _data = _data.subspan(sizeof(T));
+        return value;
+    }
+    // the count of a list whose items take at least item_size bytes each
+    [[nodiscard]] uint32_t get_count(size_t item_size) noexcept {
+        auto n = get<uint32_t>();
+        if (static_cast<size_t>(n) * item_size > _data.size()) {
+            _ok = false;
+            return 0u;
+        }
+        return n;
+    }
+    [[nodiscard]] luisa::string get_string() noexcept {
+        auto n = get_count(1u);
+        luisa::string s{reinterpret_cast<const char *>(_data.data()), n};
+        _data = _data.subspan(n);
+        return s;
+    }
+    [[nodiscard]] luisa::vector<Hint> get_hints() noexcept {
+        luisa::vector<Hint> hints;
+        auto n = get_count(2u * sizeof(uint32_t));
+        hints.reserve(n);
+        for (auto i = 0u; i < n; i++) {
+            auto identifier = get_string();
+            luisa::vector<luisa::string> args(get_count(sizeof(uint32_t)));
+            for (auto &&arg : args) { arg = get_string(); }
+            hints.emplace_back(std::move(identifier), std::move(args));
+        }
+        return hints;
+    }
+};
+
+struct SymbolRecord {
+    Symbol::Tag tag;
+    uint32_t type;
+    int array_length;
+    int parent;
+    luisa::string identifier;
+    luisa::vector<Literal> initial_values;
+    luisa::vector<Hint> hints;
+    luisa::vector<uint32_t> children;
+};
+
+}// namespace detail
+
+ShaderLibrary::ShaderLibrary(luisa::filesystem::path cache_directory) noexcept
+    : _cache_directory{std::move(cache_directory)} {
+    if (_cache_directory.empty()) { return; }
+    std::error_code ec;
+    luisa::filesystem::create_directories(_cache_directory, ec);
+    if (ec) {
+        LUISA_WARNING_WITH_LOCATION("Failed to create OSO cache directory '{}': {}. "
+                                    "Parsed shaders will not be cached.",
+                                    luisa::to_string(_cache_directory), ec.message());
+        _cache_directory.clear();
+    }
+}
+
+ShaderLibrary::~ShaderLibrary() noexcept = default;
+
+const Shader *ShaderLibrary::load(luisa::string_view path) noexcept {
+    detail::MappedFile file{path};
+    if (!file.valid()) {
+        LUISA_WARNING_WITH_LOCATION("Failed to open file '{}'.", path);
+        return nullptr;
+    }
+    auto source = file.source();
+    auto hash = luisa::hash64(source.data(), source.size(), luisa::hash64_default_seed);
+    {
+        std::scoped_lock lock{_mutex};
+        if (auto iter = _shaders.find(hash); iter != _shaders.end()) {
+            return iter->second.get();
+        }
+    }
+    luisa::unique_ptr<Shader> shader;
+    luisa::filesystem::path cache_path;
+    if (!_cache_directory.empty()) {
+        cache_path = _cache_directory / luisa::format("{:016x}.osc", hash);
+        detail::MappedFile cache{luisa::to_string(cache_path)};
+        if (cache.valid()) {
+            auto data = cache.source();
+            if (shader = deserialize({reinterpret_cast<const std::byte *>(data.data()), data.size()});
+                shader == nullptr) {
+                LUISA_WARNING_WITH_LOCATION("Ignoring malformed cache '{}' of OSO file '{}'.",
+                                            luisa::to_string(cache_path), path);
+            }
+        }
+    }
+    if (shader == nullptr) {
+        shader = OSOParser::parse(source, path);
+        if (!cache_path.empty()) {
+            // written aside and renamed, so that concurrent loads never see partial files
+            auto data = serialize(*shader);
+            auto temp_path = cache_path;
+            temp_path += luisa::format(".{:x}.tmp", reinterpret_cast<uint64_t>(shader.get()));
+            auto written = false;
+            if (auto f = std::fopen(luisa::to_string(temp_path).c_str(), "wb")) {
+                written = std::fwrite(data.data(), 1u, data.size(), f) == data.size();
+                written = std::fclose(f) == 0 && written;
+            }
+            std::error_code ec;
+            if (written) { luisa::filesystem::rename(temp_path, cache_path, ec); }
+            if (!written || ec) {
+                LUISA_WARNING_WITH_LOCATION("Failed to write cache '{}' of OSO file '{}'.",
+                                            luisa::to_string(cache_path), path);
+                luisa::filesystem::remove(temp_path, ec);
+            }
+        }
+    }
+    // another thread may have loaded the same contents meanwhile
+    std::scoped_lock lock{_mutex};
+    return _shaders.try_emplace(hash, std::move(shader)).first->second.get();
+}
+
+luisa::vector<const Shader *> ShaderLibrary::load(luisa::span<const luisa::string> paths) noexcept {
+    luisa::vector<const Shader *> shaders(paths.size());
+    luisa::parallel_for(_pool, paths.size(), [&](size_t i) noexcept {
+        shaders[i] = load(paths[i]);
+    });
+    return shaders;
+}
+
+size_t ShaderLibrary::size() noexcept {
+    std::scoped_lock lock{_mutex};
+    return _shaders.size();
+}
+
+luisa::vector<std::byte> ShaderLibrary::serialize(const Shader &shader) noexcept {
+    detail::ShaderCacheWriter w;
+    w.put(detail::shader_cache_magic);
+    w.put(cache_version);
+    w.put_string(shader.osl_spec());
+    w.put(shader.osl_version_major());
+    w.put(shader.osl_version_minor());
+    w.put(static_cast<uint32_t>(shader.tag()));
+    w.put_string(shader.identifier());
+    w.put_hints(shader.hints());
+    // types
+    luisa::unordered_map<const Type *, uint32_t> type_indices;
+    for (auto &&type : shader.types()) {
+        type_indices.emplace(type.get(), static_cast<uint32_t>(type_indices.size()));
+    }
+    w.put(static_cast<uint32_t>(shader.types().size()));
+    for (auto &&type : shader.types()) {
+        w.put(static_cast<uint32_t>(type->tag()));
+        switch (type->tag()) {
+            case Type::Tag::SIMPLE:
+                w.put(static_cast<uint32_t>(static_cast<const SimpleType *>(type.get())->primitive()));
+                break;
+            case Type::Tag::STRUCT: {
+                auto fields = static_cast<const StructType *>(type.get())->fields();
+                w.put_string(type->identifier());
+                w.put(static_cast<uint32_t>(fields.size()));
+                for (auto &&field : fields) {
+                    w.put_string(field.name);
+                    w.put(type_indices.at(field.type));
+                    w.put(static_cast<uint64_t>(field.array_length));
+                }
+                break;
+            }
+            case Type::Tag::CLOSURE:
+                w.put(type_indices.at(static_cast<const ClosureType *>(type.get())->gentype()));
+                break;
+        }
+    }
+    // symbols
+    luisa::unordered_map<const Symbol *, uint32_t> symbol_indices;
+    for (auto &&symbol : shader.symbols()) {
+        symbol_indices.emplace(symbol.get(), static_cast<uint32_t>(symbol_indices.size()));
+    }
+    w.put(static_cast<uint32_t>(shader.symbols().size()));
+    for (auto &&symbol : shader.symbols()) {
+        w.put(static_cast<uint32_t>(symbol->tag()));
+        w.put(type_indices.at(symbol->type()));
+        w.put(static_cast<int32_t>(symbol->array_length()));
+        w.put(symbol->parent() == nullptr ? -1 : static_cast<int32_t>(symbol_indices.at(symbol->parent())));
+        w.put_string(symbol->identifier());
+        w.put(static_cast<uint32_t>(symbol->initial_values().size()));
+        for (auto &&value : symbol->initial_values()) {
+            w.put(static_cast<uint32_t>(value.tag()));
+            if (value.is_number()) {
+                w.put(value.as_double());
+            } else {
+                w.put_string(value.as_string());
+            }
+        }
+        w.put_hints(symbol->hints());
+        w.put(static_cast<uint32_t>(symbol->children().size()));
+        for (auto child : symbol->children()) { w.put(symbol_indices.at(child)); }
+    }
+    // instructions and code markers
+    w.put(static_cast<uint32_t>(shader.instructions().size()));
+    for (auto &&instruction : shader.instructions()) {
+        w.put_string(instruction->opcode());
+        w.put(static_cast<uint32_t>(instruction->args().size()));
+        for (auto arg : instruction->args()) { w.put(symbol_indices.at(arg)); }
+        w.put(static_cast<uint32_t>(instruction->jump_targets().size()));
+        for (auto target : instruction->jump_targets()) { w.put(static_cast<int32_t>(target)); }
+        w.put_hints(instruction->hints());
+    }
+    w.put(static_cast<uint32_t>(shader.code_markers().size()));
+    for (auto &&marker : shader.code_markers()) {
+        w.put_string(marker.identifier);
+        w.put(marker.instruction);
+    }
+    return w.data();
+}
+
+luisa::unique_ptr<Shader> ShaderLibrary::deserialize(luisa::span<const std::byte> data) noexcept {
+    detail::ShaderCacheReader r{data};
+    if (r.get<uint32_t>() != detail::shader_cache_magic ||
+        r.get<uint32_t>() != cache_version) { return nullptr; }
+    auto osl_spec = r.get_string();
+    auto version_major = r.get<uint32_t>();
+    auto version_minor = r.get<uint32_t>();
+    auto tag = r.get<uint32_t>();
+    if (tag > static_cast<uint32_t>(Shader::Tag::VOLUME)) { return nullptr; }
+    auto identifier = r.get_string();
+    auto hints = r.get_hints();
+    // types, with the fields of structs and the gentypes of closures set once all are created
+    struct TypeRecord {
+        Type::Tag tag;
+        uint32_t reference;
+        luisa::vector<StructType::Field> fields;
+        luisa::vector<uint32_t> field_types;
+    };
+    luisa::vector<TypeRecord> type_records(r.get_count(2u * sizeof(uint32_t)));
+    luisa::vector<luisa::unique_ptr<Type>> types(type_records.size());
+    for (auto i = 0u; i < types.size() && r.ok(); i++) {
+        auto &&record = type_records[i];
+        switch (record.tag = static_cast<Type::Tag>(r.get<uint32_t>())) {
+            case Type::Tag::SIMPLE: {
+                auto primitive = r.get<uint32_t>();
+                if (primitive > static_cast<uint32_t>(SimpleType::Primitive::STRING)) { return nullptr; }
+                types[i] = luisa::make_unique<SimpleType>(static_cast<SimpleType::Primitive>(primitive));
+                break;
+            }
+            case Type::Tag::STRUCT: {
+                types[i] = luisa::make_unique<StructType>(r.get_string());
+                record.fields.resize(r.get_count(2u * sizeof(uint32_t) + sizeof(uint64_t)));
+                record.field_types.resize(record.fields.size());
+                for (auto j = 0u; j < record.fields.size(); j++) {
+                    record.fields[j].name = r.get_string();
+                    record.field_types[j] = r.get<uint32_t>();
+                    record.fields[j].array_length = static_cast<size_t>(r.get<uint64_t>());
+                }
+                break;
+            }
+            case Type::Tag::CLOSURE: record.reference = r.get<uint32_t>(); break;
+            default: return nullptr;
+        }
+    }
+    if (!r.ok()) { return nullptr; }
+    for (auto i = 0u; i < types.size(); i++) {
+        auto &&record = type_records[i];
+        if (record.tag == Type::Tag::CLOSURE) {
+            if (record.reference >= types.size()) { return nullptr; }
+            auto gentype = types[record.reference].get();
+            if (gentype == nullptr || gentype->tag() != Type::Tag::SIMPLE ||
+                static_cast<const SimpleType *>(gentype)->primitive() != SimpleType::Primitive::COLOR) {
+                return nullptr;
+            }
+            types[i] = luisa::make_unique<ClosureType>(gentype);
+        }
+    }
+    for (auto i = 0u; i < types.size(); i++) {
+        auto &&record = type_records[i];
+        if (record.tag != Type::Tag::STRUCT) { continue; }
+        for (auto j = 0u; j < record.fields.size(); j++) {
+            if (record.field_types[j] >= types.size()) { return nullptr; }
+            record.fields[j].type = types[record.field_types[j]].get();
+        }
+        static_cast<StructType *>(types[i].get())->set_fields(std::move(record.fields));
+    }
+    // symbols, created parents first
+    luisa::vector<detail::SymbolRecord> symbol_records(r.get_count(6u * sizeof(uint32_t)));
+    for (auto &&record : symbol_records) {
+        auto symbol_tag = r.get<uint32_t>();
+        if (symbol_tag > static_cast<uint32_t>(Symbol::Tag::SYM_CONST)) { return nullptr; }
+        record.tag = static_cast<Symbol::Tag>(symbol_tag);
+        record.type = r.get<uint32_t>();
+        record.array_length = r.get<int32_t>();
+        record.parent = r.get<int32_t>();
+        record.identifier = r.get_string();
+        auto value_count = r.get_count(sizeof(uint32_t) + sizeof(uint32_t));
+        record.initial_values.reserve(value_count);
+        for (auto i = 0u; i < value_count; i++) {
+            auto value_tag = r.get<uint32_t>();
+            if (value_tag == static_cast<uint32_t>(Literal::Tag::NUMBER)) {
+                record.initial_values.emplace_back(r.get<double>());
+            } else if (value_tag == static_cast<uint32_t>(Literal::Tag::STRING)) {
+                record.initial_values.emplace_back(luisa::string_view{r.get_string()});
+            } else {
+                return nullptr;
+            }
+        }
+        record.hints = r.get_hints();
+        record.children.resize(r.get_count(sizeof(uint32_t)));
+        for (auto &&child : record.children) { child = r.get<uint32_t>(); }
+        if (!r.ok() || record.type >= types.size() ||
+            record.parent >= static_cast<int>(symbol_records.size())) { return nullptr; }
+    }
+    luisa::vector<luisa::unique_ptr<Symbol>> symbols(symbol_records.size());
+    luisa::vector<uint8_t> visiting(symbol_records.size(), 0u);
+    auto create_symbol = [&](auto &&self, uint32_t index) noexcept -> bool {
+        if (symbols[index] != nullptr) { return true; }
+        if (visiting[index]) { return false; }
+        visiting[index] = 1u;
+        auto &&record = symbol_records[index];
+        const Symbol *parent = nullptr;
+        if (record.parent >= 0) {
+            if (!self(self, static_cast<uint32_t>(record.parent))) { return false; }
+            parent = symbols[record.parent].get();
+            // checked here instead of asserted by add_child
+            if (!record.identifier.starts_with(parent->identifier())) { return false; }
+        }
+        symbols[index] = luisa::make_unique<Symbol>(
+            record.tag, types[record.type].get(), record.array_length, parent,
+            std::move(record.identifier), std::move(record.initial_values), std::move(record.hints));
+        return true;
+    };
+    for (auto i = 0u; i < symbols.size(); i++) {
+        if (!create_symbol(create_symbol, i)) { return nullptr; }
+    }
+    for (auto i = 0u; i < symbols.size(); i++) {
+        auto &&children = symbol_records[i].children;
+        for (auto j = 0u; j < children.size(); j++) {
+            auto child = children[j];
+            if (child >= symbols.size() || symbols[child]->parent() != symbols[i].get() ||
+                std::find(children.begin(), children.begin() + j, child) != children.begin() + j) {
+                return nullptr;
+            }
+            symbols[i]->add_child(symbols[child].get());
+        }
+    }
+    // instructions and code markers
+    luisa::vector<luisa::unique_ptr<Instruction>> instructions(r.get_count(4u * sizeof(uint32_t)));
+    for (auto &&instruction : instructions) {
+        auto opcode = r.get_string();
+        luisa::vector<const Symbol *> args(r.get_count(sizeof(uint32_t)));
+        for (auto &&arg : args) {
+            auto index = r.get<uint32_t>();
+            if (index >= symbols.size()) { return nullptr; }
+            arg = symbols[index].get();
+        }
+        luisa::vector<int> jump_targets(r.get_count(sizeof(int32_t)));
+        for (auto &&target : jump_targets) { target = r.get<int32_t>(); }
+        auto instruction_hints = r.get_hints();
+        if (!r.ok()) { return nullptr; }
+        instruction = luisa::make_unique<Instruction>(
+            std::move(opcode), std::move(args), std::move(jump_targets), std::move(instruction_hints));
+    }
+    luisa::vector<Shader::CodeMarker> code_markers(r.get_count(2u * sizeof(uint32_t)));
+    for (auto &&marker : code_markers) {
+        marker.identifier = r.get_string();
+        marker.instruction = r.get<uint32_t>();
+    }
+    if (!r.ok()) { return nullptr; }
+    return luisa::make_unique<Shader>(
+        std::move(osl_spec), version_major, version_minor,
+        static_cast<Shader::Tag>(tag), std::move(identifier), std::move(hints),
+        std::move(code_markers), std::move(types), std::move(symbols), std::move(instructions));
+}
+
+}// namespace luisa::compute::osl
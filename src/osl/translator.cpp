@@ -0,0 +1,1458 @@
+#include <cmath>
+#include <array>
+#include <utility>
+#include <limits>
+#include <algorithm>
+
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/hash.h>
+#include <luisa/core/stl/optional.h>
+#include <luisa/ast/type_registry.h>
+#include <luisa/ast/constant_data.h>
+#include <luisa/ast/function_builder.h>
+
+#include <luisa/osl/type.h>
+#include <luisa/osl/literal.h>
+#include <luisa/osl/symbol.h>
+#include <luisa/osl/instruction.h>
+#include <luisa/osl/shader.h>
+#include <luisa/osl/shader_library.h>
+#include <luisa/osl/translator.h>
+
+namespace luisa::compute::osl {
+
+using compute::detail::FunctionBuilder;
+
+namespace detail {
+
+using namespace std::string_view_literals;
+
+// the types of LuisaCompute, not the ones of OSL
+using compute::Type;
+
+// OSL values are ints, floats, strings (as their hashes) or triples of floats, possibly in arrays
+struct ValueShape {
+    enum struct Kind : uint8_t {
+        INT,
+        FLOAT,
+        STRING,
+    };
+    Kind kind;
+    uint8_t width;
+    [[nodiscard]] bool operator==(const ValueShape &) const noexcept = default;
+};
+
+using Kind = ValueShape::Kind;
+using Values = luisa::vector<double>;
+
+static constexpr ValueShape int_shape{Kind::INT, 1u};
+static constexpr ValueShape float_shape{Kind::FLOAT, 1u};
+static constexpr ValueShape triple_shape{Kind::FLOAT, 3u};
+
+[[nodiscard]] static luisa::optional<ValueShape> shape_of(const osl::Type *type) noexcept {
+    if (type->tag() != osl::Type::Tag::SIMPLE) { return luisa::nullopt; }
+    switch (static_cast<const SimpleType *>(type)->primitive()) {
+        case SimpleType::Primitive::INT: return int_shape;
+        case SimpleType::Primitive::FLOAT: return float_shape;
+        case SimpleType::Primitive::POINT:
+        case SimpleType::Primitive::NORMAL:
+        case SimpleType::Primitive::VECTOR:
+        case SimpleType::Primitive::COLOR: return triple_shape;
+        case SimpleType::Primitive::STRING: return ValueShape{Kind::STRING, 1u};
+        default: break;
+    }
+    return luisa::nullopt;
+}
+
+[[nodiscard]] static const Type *type_of(ValueShape shape) noexcept {
+    switch (shape.kind) {
+        case Kind::INT: return shape.width == 1u ? Type::of<int>() : Type::of<int3>();
+        case Kind::FLOAT: return shape.width == 1u ? Type::of<float>() : Type::of<float3>();
+        case Kind::STRING: return Type::of<uint>();
+    }
+    return nullptr;
+}
+
+[[nodiscard]] static const Type *bool_type_of(ValueShape shape) noexcept {
+    return shape.width == 1u ? Type::of<bool>() : Type::of<bool3>();
+}
+
+// the shape in which an operation on values of the two shapes is computed
+[[nodiscard]] static ValueShape promote(ValueShape a, ValueShape b) noexcept {
+    auto kind = a.kind == Kind::FLOAT || b.kind == Kind::FLOAT ? Kind::FLOAT : a.kind;
+    return {kind, std::max(a.width, b.width)};
+}
+
+[[nodiscard]] static uint string_hash(luisa::string_view s) noexcept {
+    return static_cast<uint>(luisa::hash64(s.data(), s.size(), luisa::hash64_default_seed));
+}
+
+// values as they are stored in the shape, i.e., ints truncated and floats rounded
+[[nodiscard]] static double round_to(Kind kind, double x) noexcept {
+    if (kind == Kind::INT) { return std::trunc(x); }
+    if (kind == Kind::FLOAT) { return static_cast<double>(static_cast<float>(x)); }
+    return x;
+}
+
+// the bases of splines as in OSL: a matrix of coefficients and the number of knots between segments
+struct SplineBasis {
+    luisa::string_view name;
+    uint step;
+    float m[4][4];
+};
+
+static constexpr SplineBasis spline_bases[] = {
+    {"catmull-rom"sv, 1u, {{-1.f / 2.f, 3.f / 2.f, -3.f / 2.f, 1.f / 2.f}, {2.f / 2.f, -5.f / 2.f, 4.f / 2.f, -1.f / 2.f}, {-1.f / 2.f, 0.f, 1.f / 2.f, 0.f}, {0.f, 2.f / 2.f, 0.f, 0.f}}},
+    {"bezier"sv, 3u, {{-1.f, 3.f, -3.f, 1.f}, {3.f, -6.f, 3.f, 0.f}, {-3.f, 3.f, 0.f, 0.f}, {1.f, 0.f, 0.f, 0.f}}},
+    {"bspline"sv, 1u, {{-1.f / 6.f, 3.f / 6.f, -3.f / 6.f, 1.f / 6.f}, {3.f / 6.f, -6.f / 6.f, 3.f / 6.f, 0.f}, {-3.f / 6.f, 0.f, 3.f / 6.f, 0.f}, {1.f / 6.f, 4.f / 6.f, 1.f / 6.f, 0.f}}},
+    {"hermite"sv, 2u, {{2.f, 1.f, -2.f, 1.f}, {-3.f, -2.f, 3.f, -1.f}, {0.f, 1.f, 0.f, 0.f}, {1.f, 0.f, 0.f, 0.f}}},
+    {"linear"sv, 1u, {{0.f, 0.f, 0.f, 0.f}, {0.f, 0.f, 0.f, 0.f}, {0.f, -1.f, 1.f, 0.f}, {0.f, 1.f, 0.f, 0.f}}},
+    {"constant"sv, 1u, {{0.f, 0.f, 0.f, 0.f}, {0.f, 0.f, 0.f, 0.f}, {0.f, 0.f, 0.f, 0.f}, {0.f, 1.f, 0.f, 0.f}}},
+};
+
+// componentwise math on floats, folded on the host with the same precision
+struct UnaryMath {
+    luisa::string_view opcode;
+    CallOp op;
+    float (*fold)(float) noexcept;
+};
+
+struct BinaryMath {
+    luisa::string_view opcode;
+    CallOp op;
+    float (*fold)(float, float) noexcept;
+};
+
+static constexpr UnaryMath unary_math[] = {
+    {"sin"sv, CallOp::SIN, [](float x) noexcept { return std::sin(x); }},
+    {"cos"sv, CallOp::COS, [](float x) noexcept { return std::cos(x); }},
+    {"tan"sv, CallOp::TAN, [](float x) noexcept { return std::tan(x); }},
+    {"asin"sv, CallOp::ASIN, [](float x) noexcept { return std::asin(x); }},
+    {"acos"sv, CallOp::ACOS, [](float x) noexcept { return std::acos(x); }},
+    {"atan"sv, CallOp::ATAN, [](float x) noexcept { return std::atan(x); }},
+    {"sinh"sv, CallOp::SINH, [](float x) noexcept { return std::sinh(x); }},
+    {"cosh"sv, CallOp::COSH, [](float x) noexcept { return std::cosh(x); }},
+    {"tanh"sv, CallOp::TANH, [](float x) noexcept { return std::tanh(x); }},
+    {"exp"sv, CallOp::EXP, [](float x) noexcept { return std::exp(x); }},
+    {"exp2"sv, CallOp::EXP2, [](float x) noexcept { return std::exp2(x); }},
+    {"log"sv, CallOp::LOG, [](float x) noexcept { return std::log(x); }},
+    {"log2"sv, CallOp::LOG2, [](float x) noexcept { return std::log2(x); }},
+    {"log10"sv, CallOp::LOG10, [](float x) noexcept { return std::log10(x); }},
+    {"floor"sv, CallOp::FLOOR, [](float x) noexcept { return std::floor(x); }},
+    {"ceil"sv, CallOp::CEIL, [](float x) noexcept { return std::ceil(x); }},
+    {"round"sv, CallOp::ROUND, [](float x) noexcept { return std::round(x); }},
+    {"trunc"sv, CallOp::TRUNC, [](float x) noexcept { return std::trunc(x); }},
+};
+
+static constexpr BinaryMath binary_math[] = {
+    {"pow"sv, CallOp::POW, [](float x, float y) noexcept { return std::pow(x, y); }},
+    {"atan2"sv, CallOp::ATAN2, [](float x, float y) noexcept { return std::atan2(x, y); }},
+};
+
+struct SymbolState {
+    ValueShape shape;
+    uint32_t length;// 0 for non-arrays
+    uint32_t writes;
+    uint32_t first_read;
+    uint32_t last_read;
+    const Type *type;
+    const Expression *storage;// created on the first use for locals
+    bool is_known;
+    bool is_specialized;// parameters that are not passed in
+    Values known;
+    luisa::string_view string;// of known string scalars
+};
+
+// the loops (and inlined functions with early returns) enclosing the instructions
+struct LoopContext {
+    bool is_function;
+    // set by breaks from the inner loop that wraps bodies with continues
+    const Expression *broken;
+};
+
+class ShaderTranslation {
+
+private:
+    const Shader &_shader;
+    const Translator::Specialization &_specialization;
+    luisa::unordered_map<const Symbol *, SymbolState> _states;
+    luisa::vector<uint32_t> _write_masks;
+    luisa::vector<Translator::Argument> _arguments;
+    luisa::vector<LoopContext> _loops;
+    FunctionBuilder *_builder{nullptr};
+    uint32_t _conditional_depth{0u};
+    uint32_t _region_end{0u};
+    uint32_t _pc{0u};
+    luisa::string _error;
+
+public:
+    ShaderTranslation(const Shader &shader,
+                      const Translator::Specialization &specialization) noexcept
+        : _shader{shader}, _specialization{specialization} {}
+    [[nodiscard]] auto error() const noexcept { return luisa::string_view{_error}; }
+    [[nodiscard]] auto &&arguments() noexcept { return std::move(_arguments); }
+
+private:
+    void _fail(luisa::string message) noexcept {
+        if (_error.empty()) {
+            auto instructions = _shader.instructions();
+            _error = _pc < instructions.size() ?
+                         luisa::format("{} (at instruction #{}: {})", message, _pc,
+                                       instructions[_pc]->dump()) :
+                         std::move(message);
+        }
+    }
+
+    [[nodiscard]] SymbolState &_state(const Symbol *symbol) noexcept { return _states.at(symbol); }
+
+    // the instructions of the code section that starts with the marker
+    [[nodiscard]] std::pair<uint32_t, uint32_t> _section(luisa::string_view marker) const noexcept {
+        auto markers = _shader.code_markers();
+        auto count = static_cast<uint32_t>(_shader.instructions().size());
+        for (auto i = 0u; i < markers.size(); i++) {
+            if (markers[i].identifier == marker) {
+                auto end = i + 1u < markers.size() ? markers[i + 1u].instruction : count;
+                return {markers[i].instruction, end};
+            }
+        }
+        return marker == "___main___"sv && markers.empty() ?
+                   std::make_pair(0u, count) :
+                   std::make_pair(0u, 0u);
+    }
+
+    [[nodiscard]] static Values _initial_values(const Symbol *symbol, ValueShape shape) noexcept {
+        Values values;
+        values.reserve(symbol->initial_values().size());
+        for (auto &&v : symbol->initial_values()) {
+            values.emplace_back(v.is_string() ?
+                                    static_cast<double>(string_hash(v.as_string())) :
+                                    round_to(shape.kind, v.as_double()));
+        }
+        return values;
+    }
+
+    void _prepare() noexcept {
+        auto instructions = _shader.instructions();
+        for (auto &&s : _shader.symbols()) {
+            auto symbol = s.get();
+            SymbolState state{};
+            state.first_read = std::numeric_limits<uint32_t>::max();
+            auto shape = shape_of(symbol->type());
+            if (!shape || (symbol->is_unbounded() && symbol->tag() != Symbol::Tag::SYM_PARAM &&
+                           symbol->tag() != Symbol::Tag::SYM_CONST)) {
+                // rejected if used by any instruction
+                state.type = nullptr;
+                _states.emplace(symbol, std::move(state));
+                continue;
+            }
+            state.shape = *shape;
+            auto initial_values = _initial_values(symbol, state.shape);
+            auto values = &initial_values;
+            Values specialized;
+            if (symbol->tag() == Symbol::Tag::SYM_PARAM && state.shape.kind != Kind::STRING) {
+                if (auto iter = _specialization.find(symbol->identifier());
+                    iter != _specialization.end()) {
+                    auto expected = static_cast<size_t>(state.shape.width) *
+                                    std::max(symbol->array_length(), 1);
+                    if (symbol->is_unbounded() ?
+                            iter->second.empty() || iter->second.size() % state.shape.width != 0u :
+                            iter->second.size() != expected) {
+                        LUISA_WARNING_WITH_LOCATION(
+                            "Ignoring {} specialized values of parameter '{}' in shader '{}'.",
+                            iter->second.size(), symbol->identifier(), _shader.identifier());
+                    } else {
+                        for (auto v : iter->second) { specialized.emplace_back(round_to(state.shape.kind, v)); }
+                        values = &specialized;
+                    }
+                }
+            }
+            state.length = symbol->is_unbounded() ?
+                               static_cast<uint32_t>(std::max<size_t>(values->size() / state.shape.width, 1u)) :
+                               static_cast<uint32_t>(symbol->array_length());
+            auto element = type_of(state.shape);
+            state.type = state.length == 0u ? element : Type::array(element, state.length);
+            auto size = static_cast<size_t>(state.shape.width) * std::max(state.length, 1u);
+            // strings cannot be passed in, so they always take their default values
+            state.is_specialized = symbol->tag() == Symbol::Tag::SYM_PARAM &&
+                                   (values == &specialized || state.shape.kind == Kind::STRING);
+            state.is_known = symbol->tag() == Symbol::Tag::SYM_CONST || state.is_specialized;
+            if (state.is_known || !values->empty()) {
+                // missing initial values (e.g., computed by initialization code) are zeros
+                values->resize(size, 0.);
+                state.known = std::move(*values);
+            }
+            if (state.is_known && state.shape.kind == Kind::STRING && state.length == 0u &&
+                !symbol->initial_values().empty() && symbol->initial_values()[0].is_string()) {
+                state.string = symbol->initial_values()[0].as_string();
+            }
+            _states.emplace(symbol, std::move(state));
+        }
+        // count the writes to the symbols and find their reads, as annotated by oslc
+        _write_masks.resize(instructions.size(), 0u);
+        for (auto i = 0u; i < instructions.size(); i++) {
+            auto &&instruction = instructions[i];
+            auto args = instruction->args();
+            auto write_mask = 0u;
+            auto read_mask = 0u;
+            auto annotated = false;
+            for (auto &&hint : instruction->hints()) {
+                if (hint.identifier() == "argrw"sv && !hint.args().empty()) {
+                    // the annotation keeps its quotes
+                    auto rw = hint.args()[0];
+                    for (auto j = 1u; j < rw.size() && j <= 32u; j++) {
+                        auto c = rw[j];
+                        if (c == 'w' || c == 'W') { write_mask |= 1u << (j - 1u); }
+                        if (c == 'r' || c == 'W') { read_mask |= 1u << (j - 1u); }
+                    }
+                    annotated = true;
+                }
+            }
+            if (!annotated) {
+                write_mask = !args.empty() && instruction->jump_targets().empty() ? 1u : 0u;
+                read_mask = ~write_mask;
+            }
+            _write_masks[i] = write_mask;
+            for (auto j = 0u; j < args.size() && j < 32u; j++) {
+                auto &&state = _state(args[j]);
+                if (write_mask & (1u << j)) { state.writes++; }
+                if (read_mask & (1u << j)) {
+                    state.first_read = std::min(state.first_read, i);
+                    state.last_read = std::max(state.last_read, i);
+                }
+            }
+        }
+        for (auto &&[symbol, state] : _states) {
+            // specialized parameters that are written become locals with initial values
+            if (state.is_known && state.writes != 0u) { state.is_known = false; }
+            // unwritten locals with initial values are constants, too
+            if ((symbol->tag() == Symbol::Tag::SYM_LOCAL || symbol->tag() == Symbol::Tag::SYM_TEMP) &&
+                state.type != nullptr && state.writes == 0u && !symbol->initial_values().empty()) {
+                state.is_known = true;
+            }
+        }
+    }
+
+    void _declare_arguments() noexcept {
+        auto declare = [this](Symbol::Tag tag) noexcept {
+            for (auto &&s : _shader.symbols()) {
+                auto symbol = s.get();
+                auto &&state = _state(symbol);
+                // symbols of unsupported types are rejected where they are used
+                if (symbol->tag() != tag || state.type == nullptr ||
+                    state.is_known || state.is_specialized) { continue; }
+                state.storage = tag == Symbol::Tag::SYM_PARAM ?
+                                    _builder->argument(state.type) :
+                                    _builder->reference(state.type);
+                _arguments.emplace_back(Translator::Argument{tag, luisa::string{symbol->identifier()}});
+            }
+        };
+        declare(Symbol::Tag::SYM_GLOBAL);
+        declare(Symbol::Tag::SYM_PARAM);
+        declare(Symbol::Tag::SYM_OUTPUT_PARAM);
+    }
+
+    void _initialize() noexcept {
+        for (auto &&s : _shader.symbols()) {
+            auto symbol = s.get();
+            auto &&state = _state(symbol);
+            auto tag = symbol->tag();
+            if (state.type == nullptr || state.is_known || state.known.empty() ||
+                (tag != Symbol::Tag::SYM_OUTPUT_PARAM && tag != Symbol::Tag::SYM_LOCAL &&
+                 tag != Symbol::Tag::SYM_TEMP && !state.is_specialized)) { continue; }
+            _builder->assign(_storage(symbol), _constant(state));
+        }
+        // outputs may come with code that computes their defaults
+        for (auto &&s : _shader.symbols()) {
+            if (s->tag() == Symbol::Tag::SYM_OUTPUT_PARAM) {
+                auto [begin, end] = _section(s->identifier());
+                _translate(begin, end);
+            }
+        }
+    }
+
+public:
+    [[nodiscard]] luisa::shared_ptr<const FunctionBuilder> build() noexcept {
+        _prepare();
+        auto function = FunctionBuilder::define_callable([this] {
+            _builder = FunctionBuilder::current();
+            _declare_arguments();
+            _initialize();
+            auto [begin, end] = _section("___main___"sv);
+            _translate(begin, end);
+            _builder->return_(nullptr);
+        });
+        return _error.empty() ? std::move(function) : nullptr;
+    }
+
+private:
+    // expressions
+    [[nodiscard]] const Expression *_literal(ValueShape shape, luisa::span<const double> v) noexcept {
+        switch (shape.kind) {
+            case Kind::INT:
+                return shape.width == 1u ?
+                           _builder->literal(Type::of<int>(), static_cast<int>(v[0])) :
+                           _builder->literal(Type::of<int3>(), make_int3(static_cast<int>(v[0]),
+                                                                         static_cast<int>(v[1]),
+                                                                         static_cast<int>(v[2])));
+            case Kind::FLOAT:
+                return shape.width == 1u ?
+                           _builder->literal(Type::of<float>(), static_cast<float>(v[0])) :
+                           _builder->literal(Type::of<float3>(), make_float3(static_cast<float>(v[0]),
+                                                                             static_cast<float>(v[1]),
+                                                                             static_cast<float>(v[2])));
+            case Kind::STRING:
+                return _builder->literal(Type::of<uint>(), static_cast<uint>(v[0]));
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] const Expression *_splat(ValueShape shape, double x) noexcept {
+        std::array<double, 3u> v{x, x, x};
+        return _literal(shape, v);
+    }
+
+    [[nodiscard]] const Expression *_constant(const SymbolState &state) noexcept {
+        if (state.length == 0u) { return _literal(state.shape, state.known); }
+        auto create = [&]<typename T>(auto &&convert) noexcept {
+            luisa::vector<T> data;
+            data.reserve(state.length);
+            for (auto i = 0u; i < state.length; i++) {
+                data.emplace_back(convert(&state.known[i * state.shape.width]));
+            }
+            return _builder->constant(ConstantData::create(state.type, data.data(), data.size() * sizeof(T)));
+        };
+        switch (state.shape.kind) {
+            case Kind::INT: return create.template operator()<int>([](auto v) noexcept { return static_cast<int>(v[0]); });
+            case Kind::STRING: return create.template operator()<uint>([](auto v) noexcept { return static_cast<uint>(v[0]); });
+            case Kind::FLOAT:
+                if (state.shape.width == 1u) {
+                    return create.template operator()<float>([](auto v) noexcept { return static_cast<float>(v[0]); });
+                }
+                return create.template operator()<float3>([](auto v) noexcept {
+                    return make_float3(static_cast<float>(v[0]), static_cast<float>(v[1]), static_cast<float>(v[2]));
+                });
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] const Expression *_storage(const Symbol *symbol) noexcept {
+        auto &&state = _state(symbol);
+        if (state.storage == nullptr) { state.storage = _builder->local(state.type); }
+        return state.storage;
+    }
+
+    [[nodiscard]] const Expression *_read(const Symbol *symbol) noexcept {
+        auto &&state = _state(symbol);
+        return state.is_known ? _constant(state) : _storage(symbol);
+    }
+
+    // stores the expression in a local, so that it is evaluated once however many times it is used
+    [[nodiscard]] const Expression *_temporary(const Expression *expr) noexcept {
+        auto t = _builder->local(expr->type());
+        _builder->assign(t, expr);
+        return t;
+    }
+
+    [[nodiscard]] const Expression *_convert(const Expression *expr, ValueShape from, ValueShape to) noexcept {
+        if (from == to) { return expr; }
+        if ((from.kind == Kind::STRING) != (to.kind == Kind::STRING) || from.width > to.width) {
+            _fail("Unsupported conversion");
+            return _splat(to, 0.);
+        }
+        if (from.kind != to.kind) {
+            expr = _builder->cast(type_of({to.kind, from.width}), CastOp::STATIC, expr);
+        }
+        if (from.width != to.width) {
+            expr = _builder->call(type_of(to), to.kind == Kind::INT ? CallOp::MAKE_INT3 : CallOp::MAKE_FLOAT3, {expr});
+        }
+        return expr;
+    }
+
+    [[nodiscard]] Values _convert(const Values &values, ValueShape from, ValueShape to) noexcept {
+        if (from == to) { return values; }
+        Values converted(to.width);
+        for (auto i = 0u; i < to.width; i++) {
+            converted[i] = round_to(to.kind, values[from.width == 1u ? 0u : i]);
+        }
+        return converted;
+    }
+
+    [[nodiscard]] const Expression *_read(const Symbol *symbol, ValueShape shape) noexcept {
+        return _convert(_read(symbol), _state(symbol).shape, shape);
+    }
+
+    [[nodiscard]] const Expression *_truthy(const Symbol *symbol) noexcept {
+        auto &&state = _state(symbol);
+        auto nonzero = _builder->binary(bool_type_of(state.shape), BinaryOp::NOT_EQUAL,
+                                        _read(symbol), _splat(state.shape, 0.));
+        return state.shape.width == 1u ? nonzero : _builder->call(Type::of<bool>(), CallOp::ANY, {nonzero});
+    }
+
+    [[nodiscard]] const Expression *_bool_to_int(const Expression *expr) noexcept {
+        return _builder->cast(Type::of<int>(), CastOp::STATIC, expr);
+    }
+
+    // x if the condition does not hold, and otherwise y (componentwise)
+    [[nodiscard]] const Expression *_select(ValueShape shape, const Expression *x, const Expression *y,
+                                            const Expression *condition) noexcept {
+        return _builder->call(type_of(shape), CallOp::SELECT, {x, y, condition});
+    }
+
+    void _write(const Symbol *dest, const Expression *expr, ValueShape shape) noexcept {
+        auto &&state = _state(dest);
+        if (state.is_known) {
+            _fail(luisa::format("Cannot write to constant '{}'", dest->identifier()));
+            return;
+        }
+        _builder->assign(_storage(dest), _convert(expr, shape, state.shape));
+    }
+
+private:
+    // folding
+    // whether the instruction only writes its first argument, which is written nowhere else
+    // and, if the instruction is conditional, read only after it in the same region
+    [[nodiscard]] bool _foldable_into(const Symbol *dest) noexcept {
+        auto &&state = _state(dest);
+        if (_write_masks[_pc] != 1u || state.writes != 1u ||
+            state.length != 0u || state.is_known) { return false; }
+        return _conditional_depth == 0u ||
+               (state.first_read > _pc && state.last_read < _region_end);
+    }
+
+    // ... and reads only known scalars
+    [[nodiscard]] bool _foldable(luisa::span<const Symbol *const> args) noexcept {
+        return !args.empty() && _foldable_into(args[0]) &&
+               std::all_of(args.begin() + 1u, args.end(), [this](auto s) noexcept {
+                   auto &&state = _state(s);
+                   return state.is_known && state.length == 0u;
+               });
+    }
+
+    // records the value of the destination, which outputs and globals also store
+    void _fold(const Symbol *dest, const Values &values, ValueShape shape) noexcept {
+        auto &&state = _state(dest);
+        state.known = _convert(values, shape, state.shape);
+        if (dest->tag() == Symbol::Tag::SYM_OUTPUT_PARAM || dest->tag() == Symbol::Tag::SYM_GLOBAL) {
+            _builder->assign(_storage(dest), _literal(state.shape, state.known));
+        }
+        state.is_known = true;
+    }
+
+    [[nodiscard]] Values _known(const Symbol *symbol, ValueShape shape) noexcept {
+        auto &&state = _state(symbol);
+        return _convert(state.known, state.shape, shape);
+    }
+
+private:
+    // instructions
+    void _translate(uint32_t begin, uint32_t end) noexcept {
+        auto region_end = std::exchange(_region_end, end);
+        for (auto pc = begin; pc < end && _error.empty();) {
+            pc = _translate_instruction(pc);
+        }
+        _region_end = region_end;
+    }
+
+    [[nodiscard]] uint32_t _translate_instruction(uint32_t pc) noexcept {
+        _pc = pc;
+        auto &&instruction = _shader.instructions()[pc];
+        auto op = instruction->opcode();
+        auto args = instruction->args();
+        auto targets = instruction->jump_targets();
+        for (auto arg : args) {
+            if (_state(arg).type == nullptr) {
+                _fail(luisa::format("Unsupported type '{}' of symbol '{}'",
+                                    arg->type()->identifier(), arg->identifier()));
+                return pc + 1u;
+            }
+        }
+        // control flow
+        if (op == "nop"sv || op == "useparam"sv || op == "end"sv) { return pc + 1u; }
+        if (op == "if"sv) { return _translate_if(pc, args, targets); }
+        if (op == "for"sv || op == "while"sv || op == "dowhile"sv) {
+            return _translate_loop(pc, op == "dowhile"sv, args, targets);
+        }
+        if (op == "functioncall"sv || op == "functioncall_nr"sv) {
+            return _translate_function_call(pc, targets);
+        }
+        if (op == "break"sv || op == "continue"sv) {
+            _translate_break(op == "break"sv);
+            return pc + 1u;
+        }
+        if (op == "return"sv || op == "exit"sv) {
+            _translate_return(op == "exit"sv);
+            return pc + 1u;
+        }
+        if (args.empty()) {
+            _fail(luisa::format("Unsupported instruction '{}'", op));
+            return pc + 1u;
+        }
+        if (op == "assign"sv) {
+            _translate_assign(args);
+        } else if (op == "add"sv || op == "sub"sv || op == "mul"sv || op == "div"sv || op == "mod"sv ||
+                   op == "fmod"sv || op == "bitand"sv || op == "bitor"sv || op == "xor"sv ||
+                   op == "shl"sv || op == "shr"sv || op == "min"sv || op == "max"sv) {
+            _translate_arithmetic(op, args);
+        } else if (op == "eq"sv || op == "neq"sv || op == "lt"sv || op == "le"sv ||
+                   op == "gt"sv || op == "ge"sv || op == "and"sv || op == "or"sv) {
+            _translate_comparison(op, args);
+        } else if (op == "neg"sv || op == "compl"sv || op == "abs"sv || op == "fabs"sv || op == "sign"sv ||
+                   op == "sqrt"sv || op == "inversesqrt"sv || op == "radians"sv || op == "degrees"sv ||
+                   op == "isnan"sv || op == "isinf"sv || op == "isfinite"sv) {
+            _translate_unary(op, args);
+        } else if (auto u = std::find_if(std::begin(unary_math), std::end(unary_math),
+                                         [op](auto &&m) noexcept { return m.opcode == op; });
+                   u != std::end(unary_math)) {
+            _translate_unary_math(*u, args);
+        } else if (auto b = std::find_if(std::begin(binary_math), std::end(binary_math),
+                                         [op](auto &&m) noexcept { return m.opcode == op; });
+                   b != std::end(binary_math)) {
+            _translate_binary_math(*b, args);
+        } else if (op == "step"sv || op == "clamp"sv || op == "mix"sv || op == "smoothstep"sv) {
+            _translate_interpolation(op, args);
+        } else if (op == "dot"sv || op == "cross"sv || op == "length"sv || op == "distance"sv ||
+                   op == "normalize"sv || op == "luminance"sv) {
+            _translate_geometry(op, args);
+        } else if (op == "point"sv || op == "vector"sv || op == "normal"sv || op == "color"sv) {
+            _translate_construct(op, args);
+        } else if (op == "compref"sv || op == "aref"sv) {
+            _translate_element_read(op == "compref"sv, args);
+        } else if (op == "compassign"sv || op == "aassign"sv) {
+            _translate_element_write(op == "compassign"sv, args);
+        } else if (op == "arraylength"sv) {
+            auto length = static_cast<double>(_state(args[1]).length);
+            if (_foldable_into(args[0])) {
+                _fold(args[0], {length}, int_shape);
+            } else {
+                _write(args[0], _splat(int_shape, length), int_shape);
+            }
+        } else if (op == "spline"sv) {
+            _translate_spline(args);
+        } else {
+            _fail(luisa::format("Unsupported instruction '{}'", op));
+        }
+        return pc + 1u;
+    }
+
+    uint32_t _translate_if(uint32_t pc, luisa::span<const Symbol *const> args,
+                           luisa::span<const int> targets) noexcept {
+        // if cond else_begin end
+        if (args.size() != 1u || targets.size() != 2u) {
+            _fail("Malformed if");
+            return pc + 1u;
+        }
+        auto else_begin = static_cast<uint32_t>(targets[0]);
+        auto end = static_cast<uint32_t>(targets[1]);
+        auto &&cond = _state(args[0]);
+        if (cond.is_known && cond.length == 0u) {
+            // only the taken branch is translated
+            auto taken = std::any_of(cond.known.begin(), cond.known.end(), [](auto x) noexcept { return x != 0.; });
+            taken ? _translate(pc + 1u, else_begin) : _translate(else_begin, end);
+            return end;
+        }
+        auto stmt = _builder->if_(_truthy(args[0]));
+        _conditional_depth++;
+        _builder->with(stmt->true_branch(), [&] { _translate(pc + 1u, else_begin); });
+        _builder->with(stmt->false_branch(), [&] { _translate(else_begin, end); });
+        _conditional_depth--;
+        return end;
+    }
+
+    // whether a loop body continues, not counting the continues of the nested loops
+    [[nodiscard]] bool _continues(uint32_t begin, uint32_t end) const noexcept {
+        auto instructions = _shader.instructions();
+        for (auto pc = begin; pc < end; pc++) {
+            auto op = instructions[pc]->opcode();
+            if (op == "continue"sv) { return true; }
+            if ((op == "for"sv || op == "while"sv || op == "dowhile"sv) &&
+                instructions[pc]->jump_targets().size() == 4u) {
+                pc = static_cast<uint32_t>(instructions[pc]->jump_targets()[3]) - 1u;
+            }
+        }
+        return false;
+    }
+
+    uint32_t _translate_loop(uint32_t pc, bool is_do_while, luisa::span<const Symbol *const> args,
+                             luisa::span<const int> targets) noexcept {
+        // loop cond cond_begin body_begin step_begin end; the initialization precedes the condition
+        if (args.size() != 1u || targets.size() != 4u) {
+            _fail("Malformed loop");
+            return pc + 1u;
+        }
+        auto cond_begin = static_cast<uint32_t>(targets[0]);
+        auto body_begin = static_cast<uint32_t>(targets[1]);
+        auto step_begin = static_cast<uint32_t>(targets[2]);
+        auto end = static_cast<uint32_t>(targets[3]);
+        _translate(pc + 1u, cond_begin);
+        auto cond = args[0];
+        auto check = [&] {
+            _translate(cond_begin, body_begin);
+            auto stmt = _builder->if_(_builder->unary(Type::of<bool>(), UnaryOp::NOT, _truthy(cond)));
+            _builder->with(stmt->true_branch(), [&] { _builder->break_(); });
+        };
+        _conditional_depth++;
+        auto loop = _builder->loop_();
+        _builder->with(loop->body(), [&] {
+            if (!is_do_while) { check(); }
+            if (_continues(body_begin, step_begin)) {
+                // continues break out of an inner loop around the body, so that the step still runs
+                auto broken = _builder->local(Type::of<bool>());
+                _builder->assign(broken, _builder->literal(Type::of<bool>(), false));
+                _loops.emplace_back(LoopContext{false, broken});
+                auto inner = _builder->loop_();
+                _builder->with(inner->body(), [&] {
+                    _translate(body_begin, step_begin);
+                    _builder->break_();
+                });
+                _loops.pop_back();
+                auto stmt = _builder->if_(broken);
+                _builder->with(stmt->true_branch(), [&] { _builder->break_(); });
+            } else {
+                _loops.emplace_back(LoopContext{false, nullptr});
+                _translate(body_begin, step_begin);
+                _loops.pop_back();
+            }
+            _translate(step_begin, end);
+            if (is_do_while) { check(); }
+        });
+        _conditional_depth--;
+        return end;
+    }
+
+    void _translate_break(bool is_break) noexcept {
+        if (_loops.empty() || _loops.back().is_function) {
+            _fail("Break or continue outside loops");
+            return;
+        }
+        if (auto broken = _loops.back().broken) {
+            if (is_break) { _builder->assign(broken, _builder->literal(Type::of<bool>(), true)); }
+            _builder->break_();
+        } else if (is_break) {
+            _builder->break_();
+        } else {
+            _builder->continue_();
+        }
+    }
+
+    uint32_t _translate_function_call(uint32_t pc, luisa::span<const int> targets) noexcept {
+        // the body of the function is inlined after the call
+        if (targets.size() != 1u) {
+            _fail("Malformed function call");
+            return pc + 1u;
+        }
+        auto end = static_cast<uint32_t>(targets[0]);
+        auto instructions = _shader.instructions();
+        auto returns = false;
+        for (auto i = pc + 1u; i < end; i++) {
+            auto op = instructions[i]->opcode();
+            if (op == "functioncall"sv && instructions[i]->jump_targets().size() == 1u) {
+                // returns of nested functions stay in them
+                i = static_cast<uint32_t>(instructions[i]->jump_targets()[0]) - 1u;
+            } else if (op == "return"sv) {
+                returns = true;
+            }
+        }
+        if (!returns) {
+            _translate(pc + 1u, end);
+            return end;
+        }
+        // returns break out of a loop around the body
+        _conditional_depth++;
+        _loops.emplace_back(LoopContext{true, nullptr});
+        auto loop = _builder->loop_();
+        _builder->with(loop->body(), [&] {
+            _translate(pc + 1u, end);
+            _builder->break_();
+        });
+        _loops.pop_back();
+        _conditional_depth--;
+        return end;
+    }
+
+    void _translate_return(bool is_exit) noexcept {
+        if (!is_exit) {
+            for (auto iter = _loops.rbegin(); iter != _loops.rend(); iter++) {
+                if (iter->is_function) {
+                    if (iter != _loops.rbegin()) {
+                        _fail("Return from loops in functions");
+                    } else {
+                        _builder->break_();
+                    }
+                    return;
+                }
+            }
+        }
+        // outside functions, returns end the shader
+        _builder->return_(nullptr);
+    }
+
+    void _translate_assign(luisa::span<const Symbol *const> args) noexcept {
+        if (args.size() != 2u) {
+            _fail("Malformed assign");
+            return;
+        }
+        auto &&dest = _state(args[0]);
+        auto &&src = _state(args[1]);
+        if (dest.length != 0u || src.length != 0u) {
+            if (dest.length != src.length || dest.shape != src.shape) {
+                _fail("Mismatched array assignment");
+                return;
+            }
+            _write(args[0], _read(args[1]), dest.shape);
+            return;
+        }
+        if (_foldable(args)) {
+            _fold(args[0], src.known, src.shape);
+        } else {
+            _write(args[0], _read(args[1]), src.shape);
+        }
+    }
+
+    void _translate_arithmetic(luisa::string_view op, luisa::span<const Symbol *const> args) noexcept {
+        if (args.size() != 3u) {
+            _fail("Malformed arithmetic");
+            return;
+        }
+        auto shape = promote(_state(args[1]).shape, _state(args[2]).shape);
+        auto is_int = shape.kind == Kind::INT;
+        auto is_bitwise = op == "bitand"sv || op == "bitor"sv || op == "xor"sv || op == "shl"sv || op == "shr"sv;
+        if (shape.kind == Kind::STRING || (is_bitwise && !is_int)) {
+            _fail("Invalid operands");
+            return;
+        }
+        if (_foldable(args)) {
+            auto x = _known(args[1], shape);
+            auto y = _known(args[2], shape);
+            Values r(shape.width);
+            for (auto i = 0u; i < shape.width; i++) {
+                auto a = x[i], b = y[i];
+                auto fa = static_cast<float>(a), fb = static_cast<float>(b);
+                auto ia = static_cast<int>(a), ib = static_cast<int>(b);
+                auto v = 0.;
+                if (op == "add"sv) {
+                    v = is_int ? static_cast<double>(ia + ib) : fa + fb;
+                } else if (op == "sub"sv) {
+                    v = is_int ? static_cast<double>(ia - ib) : fa - fb;
+                } else if (op == "mul"sv) {
+                    v = is_int ? static_cast<double>(ia * ib) : fa * fb;
+                } else if (op == "div"sv) {
+                    v = b == 0. ? 0. : is_int ? static_cast<double>(ia / ib) : fa / fb;
+                } else if (op == "mod"sv) {
+                    v = b == 0. ? 0. : is_int ? static_cast<double>(ia % ib) : fa - fb * std::floor(fa / fb);
+                } else if (op == "fmod"sv) {
+                    v = b == 0. ? 0. : is_int ? static_cast<double>(ia % ib) : fa - fb * std::trunc(fa / fb);
+                } else if (op == "min"sv) {
+                    v = std::min(a, b);
+                } else if (op == "max"sv) {
+                    v = std::max(a, b);
+                } else if (op == "bitand"sv) {
+                    v = ia & ib;
+                } else if (op == "bitor"sv) {
+                    v = ia | ib;
+                } else if (op == "xor"sv) {
+                    v = ia ^ ib;
+                } else if (op == "shl"sv) {
+                    v = static_cast<int>(static_cast<uint>(ia) << (ib & 31));
+                } else if (op == "shr"sv) {
+                    v = ia >> (ib & 31);
+                }
+                r[i] = round_to(shape.kind, v);
+            }
+            _fold(args[0], r, shape);
+            return;
+        }
+        auto type = type_of(shape);
+        auto x = _read(args[1], shape);
+        auto y = _read(args[2], shape);
+        auto binary = [&](BinaryOp binary_op, const Expression *a, const Expression *b) noexcept {
+            return _builder->binary(type, binary_op, a, b);
+        };
+        const Expression *result = nullptr;
+        if (op == "add"sv) {
+            result = binary(BinaryOp::ADD, x, y);
+        } else if (op == "sub"sv) {
+            result = binary(BinaryOp::SUB, x, y);
+        } else if (op == "mul"sv) {
+            result = binary(BinaryOp::MUL, x, y);
+        } else if (op == "min"sv || op == "max"sv) {
+            result = _builder->call(type, op == "min"sv ? CallOp::MIN : CallOp::MAX, {x, y});
+        } else if (op == "bitand"sv) {
+            result = binary(BinaryOp::BIT_AND, x, y);
+        } else if (op == "bitor"sv) {
+            result = binary(BinaryOp::BIT_OR, x, y);
+        } else if (op == "xor"sv) {
+            result = binary(BinaryOp::BIT_XOR, x, y);
+        } else if (op == "shl"sv || op == "shr"sv) {
+            auto count = binary(BinaryOp::BIT_AND, y, _splat(shape, 31.));
+            result = binary(op == "shl"sv ? BinaryOp::SHL : BinaryOp::SHR, x, count);
+        } else {
+            // divisions by zero give zeros in OSL
+            auto zero = _splat(shape, 0.);
+            y = _temporary(y);
+            auto is_zero = _temporary(_builder->binary(bool_type_of(shape), BinaryOp::EQUAL, y, zero));
+            auto divisor = is_int ? _select(shape, y, _splat(shape, 1.), is_zero) : y;
+            if (op == "div"sv) {
+                result = binary(BinaryOp::DIV, x, divisor);
+            } else if (is_int) {
+                result = binary(BinaryOp::MOD, x, divisor);
+            } else {
+                x = _temporary(x);
+                auto q = _builder->call(type, op == "mod"sv ? CallOp::FLOOR : CallOp::TRUNC,
+                                        {binary(BinaryOp::DIV, x, divisor)});
+                result = binary(BinaryOp::SUB, x, binary(BinaryOp::MUL, divisor, q));
+            }
+            result = _select(shape, result, zero, is_zero);
+        }
+        _write(args[0], result, shape);
+    }
+
+    void _translate_comparison(luisa::string_view op, luisa::span<const Symbol *const> args) noexcept {
+        if (args.size() != 3u) {
+            _fail("Malformed comparison");
+            return;
+        }
+        auto shape = promote(_state(args[1]).shape, _state(args[2]).shape);
+        auto is_logical = op == "and"sv || op == "or"sv;
+        if ((shape.width != 1u || shape.kind == Kind::STRING) &&
+            !(op == "eq"sv || op == "neq"sv)) {
+            _fail("Invalid operands");
+            return;
+        }
+        if (_foldable(args)) {
+            auto x = _known(args[1], shape);
+            auto y = _known(args[2], shape);
+            auto equal = std::equal(x.begin(), x.end(), y.begin());
+            auto a = x[0], b = y[0];
+            auto v = false;
+            if (op == "eq"sv) {
+                v = equal;
+            } else if (op == "neq"sv) {
+                v = !equal;
+            } else if (op == "lt"sv) {
+                v = a < b;
+            } else if (op == "le"sv) {
+                v = a <= b;
+            } else if (op == "gt"sv) {
+                v = a > b;
+            } else if (op == "ge"sv) {
+                v = a >= b;
+            } else if (op == "and"sv) {
+                v = a != 0. && b != 0.;
+            } else if (op == "or"sv) {
+                v = a != 0. || b != 0.;
+            }
+            _fold(args[0], {v ? 1. : 0.}, int_shape);
+            return;
+        }
+        const Expression *result = nullptr;
+        if (is_logical) {
+            result = _builder->binary(Type::of<bool>(), op == "and"sv ? BinaryOp::AND : BinaryOp::OR,
+                                      _truthy(args[1]), _truthy(args[2]));
+        } else {
+            auto binary_op = op == "eq"sv  ? BinaryOp::EQUAL :
+                             op == "neq"sv ? BinaryOp::NOT_EQUAL :
+                             op == "lt"sv  ? BinaryOp::LESS :
+                             op == "le"sv  ? BinaryOp::LESS_EQUAL :
+                             op == "gt"sv  ? BinaryOp::GREATER :
+                                             BinaryOp::GREATER_EQUAL;
+            result = _builder->binary(bool_type_of(shape), binary_op,
+                                      _read(args[1], shape), _read(args[2], shape));
+            if (shape.width != 1u) {
+                // triples are equal if all their components are
+                result = _builder->call(Type::of<bool>(), op == "eq"sv ? CallOp::ALL : CallOp::ANY, {result});
+            }
+        }
+        _write(args[0], _bool_to_int(result), int_shape);
+    }
+
+    void _translate_unary(luisa::string_view op, luisa::span<const Symbol *const> args) noexcept {
+        if (args.size() != 2u) {
+            _fail("Malformed unary operation");
+            return;
+        }
+        auto src = _state(args[1]).shape;
+        auto is_test = op == "isnan"sv || op == "isinf"sv || op == "isfinite"sv;
+        auto is_int_op = op == "neg"sv || op == "compl"sv || op == "abs"sv || op == "sign"sv;
+        auto shape = is_int_op && src.kind == Kind::INT ? src : ValueShape{Kind::FLOAT, src.width};
+        if (src.kind == Kind::STRING || (op == "compl"sv && src.kind != Kind::INT) ||
+            (is_test && src.width != 1u)) {
+            _fail("Invalid operand");
+            return;
+        }
+        auto result_shape = is_test ? int_shape : shape;
+        constexpr auto pi = 3.14159265358979323846;
+        if (_foldable(args)) {
+            auto x = _known(args[1], shape);
+            Values r(result_shape.width);
+            for (auto i = 0u; i < result_shape.width; i++) {
+                auto a = x[i];
+                auto fa = static_cast<float>(a);
+                auto v = 0.;
+                if (op == "neg"sv) {
+                    v = -a;
+                } else if (op == "compl"sv) {
+                    v = ~static_cast<int>(a);
+                } else if (op == "abs"sv || op == "fabs"sv) {
+                    v = std::abs(a);
+                } else if (op == "sign"sv) {
+                    v = a > 0. ? 1. : (a < 0. ? -1. : 0.);
+                } else if (op == "sqrt"sv) {
+                    v = fa >= 0.f ? std::sqrt(fa) : 0.f;
+                } else if (op == "inversesqrt"sv) {
+                    v = fa > 0.f ? 1.f / std::sqrt(fa) : 0.f;
+                } else if (op == "radians"sv) {
+                    v = fa * static_cast<float>(pi / 180.);
+                } else if (op == "degrees"sv) {
+                    v = fa * static_cast<float>(180. / pi);
+                } else if (op == "isnan"sv) {
+                    v = std::isnan(fa);
+                } else if (op == "isinf"sv) {
+                    v = std::isinf(fa);
+                } else if (op == "isfinite"sv) {
+                    v = std::isfinite(fa);
+                }
+                r[i] = round_to(result_shape.kind, v);
+            }
+            _fold(args[0], r, result_shape);
+            return;
+        }
+        auto type = type_of(shape);
+        auto x = _read(args[1], shape);
+        auto zero = _splat(shape, 0.);
+        const Expression *result = nullptr;
+        if (op == "neg"sv) {
+            result = _builder->unary(type, UnaryOp::MINUS, x);
+        } else if (op == "compl"sv) {
+            result = _builder->unary(type, UnaryOp::BIT_NOT, x);
+        } else if (op == "abs"sv || op == "fabs"sv) {
+            result = _builder->call(type, CallOp::ABS, {x});
+        } else if (op == "sign"sv) {
+            x = _temporary(x);
+            auto bool_type = bool_type_of(shape);
+            auto positive = _select(shape, zero, _splat(shape, 1.), _builder->binary(bool_type, BinaryOp::GREATER, x, zero));
+            result = _select(shape, positive, _splat(shape, -1.), _builder->binary(bool_type, BinaryOp::LESS, x, zero));
+        } else if (op == "sqrt"sv || op == "inversesqrt"sv) {
+            // square roots of negative numbers give zeros in OSL
+            x = _temporary(x);
+            auto is_sqrt = op == "sqrt"sv;
+            auto valid = _builder->binary(bool_type_of(shape), is_sqrt ? BinaryOp::GREATER_EQUAL : BinaryOp::GREATER, x, zero);
+            result = _select(shape, zero, _builder->call(type, is_sqrt ? CallOp::SQRT : CallOp::RSQRT, {x}), valid);
+        } else if (op == "radians"sv || op == "degrees"sv) {
+            result = _builder->binary(type, BinaryOp::MUL, x, _splat(shape, op == "radians"sv ? pi / 180. : 180. / pi));
+        } else {
+            auto test = _builder->call(Type::of<bool>(), op == "isinf"sv ? CallOp::ISINF : CallOp::ISNAN, {x});
+            if (op == "isfinite"sv) {
+                x = _temporary(x);
+                auto inf = _builder->call(Type::of<bool>(), CallOp::ISINF, {x});
+                auto nan = _builder->call(Type::of<bool>(), CallOp::ISNAN, {x});
+                test = _builder->unary(Type::of<bool>(), UnaryOp::NOT,
+                                       _builder->binary(Type::of<bool>(), BinaryOp::OR, inf, nan));
+            }
+            result = _bool_to_int(test);
+        }
+        _write(args[0], result, result_shape);
+    }
+
+    void _translate_unary_math(const UnaryMath &math, luisa::span<const Symbol *const> args) noexcept {
+        if (args.size() != 2u || _state(args[1]).shape.kind == Kind::STRING) {
+            _fail("Malformed math function");
+            return;
+        }
+        ValueShape shape{Kind::FLOAT, _state(args[1]).shape.width};
+        if (_foldable(args)) {
+            auto x = _known(args[1], shape);
+            for (auto &&v : x) { v = math.fold(static_cast<float>(v)); }
+            _fold(args[0], x, shape);
+            return;
+        }
+        _write(args[0], _builder->call(type_of(shape), math.op, {_read(args[1], shape)}), shape);
+    }
+
+    void _translate_binary_math(const BinaryMath &math, luisa::span<const Symbol *const> args) noexcept {
+        if (args.size() != 3u) {
+            _fail("Malformed math function");
+            return;
+        }
+        auto shape = promote(promote(_state(args[1]).shape, _state(args[2]).shape), float_shape);
+        if (shape.kind == Kind::STRING) {
+            _fail("Invalid operands");
+            return;
+        }
+        if (_foldable(args)) {
+            auto x = _known(args[1], shape);
+            auto y = _known(args[2], shape);
+            for (auto i = 0u; i < shape.width; i++) {
+                x[i] = math.fold(static_cast<float>(x[i]), static_cast<float>(y[i]));
+            }
+            _fold(args[0], x, shape);
+            return;
+        }
+        _write(args[0], _builder->call(type_of(shape), math.op, {_read(args[1], shape), _read(args[2], shape)}), shape);
+    }
+
+    void _translate_interpolation(luisa::string_view op, luisa::span<const Symbol *const> args) noexcept {
+        auto is_step = op == "step"sv;
+        if (args.size() != (is_step ? 3u : 4u)) {
+            _fail("Malformed interpolation");
+            return;
+        }
+        auto shape = float_shape;
+        for (auto arg : args.subspan(1u)) { shape = promote(shape, _state(arg).shape); }
+        if (shape.kind == Kind::STRING) {
+            _fail("Invalid operands");
+            return;
+        }
+        if (_foldable(args)) {
+            luisa::vector<Values> x;
+            for (auto arg : args.subspan(1u)) { x.emplace_back(_known(arg, shape)); }
+            Values r(shape.width);
+            for (auto i = 0u; i < shape.width; i++) {
+                auto a = static_cast<float>(x[0][i]);
+                auto b = static_cast<float>(x[1][i]);
+                auto c = is_step ? 0.f : static_cast<float>(x[2][i]);
+                auto v = 0.f;
+                if (is_step) {
+                    v = b < a ? 0.f : 1.f;
+                } else if (op == "clamp"sv) {
+                    v = std::min(std::max(a, b), c);
+                } else if (op == "mix"sv) {
+                    v = a + c * (b - a);
+                } else {
+                    auto t = std::clamp((c - a) / (b - a), 0.f, 1.f);
+                    v = t * t * (3.f - 2.f * t);
+                }
+                r[i] = v;
+            }
+            _fold(args[0], r, shape);
+            return;
+        }
+        auto type = type_of(shape);
+        auto a = _read(args[1], shape);
+        auto b = _read(args[2], shape);
+        const Expression *result = nullptr;
+        if (is_step) {
+            // step(edge, x) is 0 for x < edge, and 1 otherwise
+            result = _select(shape, _splat(shape, 1.), _splat(shape, 0.),
+                             _builder->binary(bool_type_of(shape), BinaryOp::LESS, b, a));
+        } else {
+            auto c = _read(args[3], shape);
+            auto call_op = op == "clamp"sv ? CallOp::CLAMP :
+                           op == "mix"sv   ? CallOp::LERP :
+                                             CallOp::SMOOTHSTEP;
+            result = _builder->call(type, call_op, {a, b, c});
+        }
+        _write(args[0], result, shape);
+    }
+
+    void _translate_geometry(luisa::string_view op, luisa::span<const Symbol *const> args) noexcept {
+        auto is_binary = op == "dot"sv || op == "cross"sv || op == "distance"sv;
+        if (args.size() != (is_binary ? 3u : 2u) ||
+            std::any_of(args.begin() + 1u, args.end(), [this](auto s) noexcept {
+                return _state(s).shape != triple_shape;
+            })) {
+            _fail("Malformed geometric function");
+            return;
+        }
+        auto result_shape = op == "cross"sv || op == "normalize"sv ? triple_shape : float_shape;
+        if (_foldable(args)) {
+            auto x = _known(args[1], triple_shape);
+            auto y = is_binary ? _known(args[2], triple_shape) : x;
+            auto dot = [](const Values &a, const Values &b) noexcept {
+                return static_cast<float>(a[0]) * static_cast<float>(b[0]) +
+                       static_cast<float>(a[1]) * static_cast<float>(b[1]) +
+                       static_cast<float>(a[2]) * static_cast<float>(b[2]);
+            };
+            Values r;
+            if (op == "dot"sv) {
+                r = {dot(x, y)};
+            } else if (op == "cross"sv) {
+                r = {x[1] * y[2] - x[2] * y[1], x[2] * y[0] - x[0] * y[2], x[0] * y[1] - x[1] * y[0]};
+            } else if (op == "length"sv) {
+                r = {std::sqrt(dot(x, x))};
+            } else if (op == "distance"sv) {
+                Values d{x[0] - y[0], x[1] - y[1], x[2] - y[2]};
+                r = {std::sqrt(dot(d, d))};
+            } else if (op == "normalize"sv) {
+                auto l = std::sqrt(dot(x, x));
+                r = l == 0.f ? Values{0., 0., 0.} : Values{x[0] / l, x[1] / l, x[2] / l};
+            } else {
+                r = {dot(x, {.2126, .7152, .0722})};
+            }
+            for (auto &&v : r) { v = round_to(Kind::FLOAT, v); }
+            _fold(args[0], r, result_shape);
+            return;
+        }
+        auto x = _read(args[1]);
+        const Expression *result = nullptr;
+        if (op == "dot"sv) {
+            result = _builder->call(Type::of<float>(), CallOp::DOT, {x, _read(args[2])});
+        } else if (op == "cross"sv) {
+            result = _builder->call(Type::of<float3>(), CallOp::CROSS, {x, _read(args[2])});
+        } else if (op == "length"sv) {
+            result = _builder->call(Type::of<float>(), CallOp::LENGTH, {x});
+        } else if (op == "distance"sv) {
+            auto d = _builder->binary(Type::of<float3>(), BinaryOp::SUB, x, _read(args[2]));
+            result = _builder->call(Type::of<float>(), CallOp::LENGTH, {d});
+        } else if (op == "normalize"sv) {
+            // zero vectors stay zeros in OSL
+            x = _temporary(x);
+            auto l = _temporary(_builder->call(Type::of<float>(), CallOp::LENGTH, {x}));
+            auto zero = _splat(float_shape, 0.);
+            auto is_zero = _builder->binary(Type::of<bool>(), BinaryOp::EQUAL, l, zero);
+            auto scale = _select(float_shape, _builder->binary(Type::of<float>(), BinaryOp::DIV, _splat(float_shape, 1.), l), zero, is_zero);
+            result = _builder->binary(Type::of<float3>(), BinaryOp::MUL, x, _convert(scale, float_shape, triple_shape));
+        } else {
+            result = _builder->call(Type::of<float>(), CallOp::DOT,
+                                    {x, _builder->literal(Type::of<float3>(), make_float3(.2126f, .7152f, .0722f))});
+        }
+        _write(args[0], result, result_shape);
+    }
+
+    void _translate_construct(luisa::string_view op, luisa::span<const Symbol *const> args) noexcept {
+        // triple dest [space] x y z, where only the spaces that change nothing are supported
+        if (args.size() != 4u && args.size() != 5u) {
+            _fail("Malformed construction");
+            return;
+        }
+        if (args.size() == 5u) {
+            auto &&space = _state(args[1]);
+            auto s = space.string;
+            auto identity = space.is_known && (op == "color"sv ? s == "rgb"sv || s == "RGB"sv :
+                                                                 s == "common"sv || s == "world"sv);
+            if (!identity) {
+                _fail(luisa::format("Unsupported space '{}' of {}", s, op));
+                return;
+            }
+        }
+        auto dest = args[0];
+        auto components = args.subspan(args.size() - 3u);
+        if (std::any_of(components.begin(), components.end(), [this](auto s) noexcept {
+                return _state(s).shape.width != 1u || _state(s).shape.kind == Kind::STRING;
+            })) {
+            _fail("Invalid components");
+            return;
+        }
+        std::array operands{dest, components[0], components[1], components[2]};
+        if (_foldable(operands)) {
+            Values r;
+            for (auto c : components) { r.emplace_back(_known(c, float_shape)[0]); }
+            _fold(dest, r, triple_shape);
+            return;
+        }
+        auto result = _builder->call(Type::of<float3>(), CallOp::MAKE_FLOAT3,
+                                     {_read(components[0], float_shape),
+                                      _read(components[1], float_shape),
+                                      _read(components[2], float_shape)});
+        _write(dest, result, triple_shape);
+    }
+
+    void _translate_element_read(bool is_component, luisa::span<const Symbol *const> args) noexcept {
+        // compref dest triple index, aref dest array index
+        if (args.size() != 3u) {
+            _fail("Malformed element access");
+            return;
+        }
+        auto &&range = _state(args[1]);
+        auto &&index = _state(args[2]);
+        auto count = is_component ? static_cast<uint32_t>(range.shape.width) : range.length;
+        auto shape = is_component ? ValueShape{range.shape.kind, 1u} : range.shape;
+        if ((is_component ? range.length != 0u || range.shape.width != 3u : range.length == 0u) ||
+            index.shape != int_shape) {
+            _fail("Invalid element access");
+            return;
+        }
+        // out-of-range indices are clamped as in OSL
+        if (index.is_known && range.is_known && _foldable_into(args[0])) {
+            auto i = std::clamp(static_cast<int>(index.known[0]), 0, static_cast<int>(count) - 1);
+            auto offset = static_cast<size_t>(i) * (is_component ? 1u : shape.width);
+            Values r{range.known.begin() + offset, range.known.begin() + offset + shape.width};
+            _fold(args[0], r, shape);
+            return;
+        }
+        auto i = _builder->call(Type::of<int>(), CallOp::CLAMP,
+                                {_read(args[2]), _splat(int_shape, 0.), _splat(int_shape, count - 1.)});
+        _write(args[0], _builder->access(type_of(shape), _read(args[1]), i), shape);
+    }
+
+    void _translate_element_write(bool is_component, luisa::span<const Symbol *const> args) noexcept {
+        // compassign triple index value, aassign array index value
+        if (args.size() != 3u) {
+            _fail("Malformed element assignment");
+            return;
+        }
+        auto &&range = _state(args[0]);
+        auto &&index = _state(args[1]);
+        auto count = is_component ? static_cast<uint32_t>(range.shape.width) : range.length;
+        auto shape = is_component ? ValueShape{range.shape.kind, 1u} : range.shape;
+        if ((is_component ? range.length != 0u || range.shape.width != 3u : range.length == 0u) ||
+            index.shape != int_shape || range.is_known) {
+            _fail("Invalid element assignment");
+            return;
+        }
+        const Expression *i = nullptr;
+        if (index.is_known) {
+            auto clamped = std::clamp(static_cast<int>(index.known[0]), 0, static_cast<int>(count) - 1);
+            i = _splat(int_shape, clamped);
+        } else {
+            i = _builder->call(Type::of<int>(), CallOp::CLAMP,
+                               {_read(args[1]), _splat(int_shape, 0.), _splat(int_shape, count - 1.)});
+        }
+        _builder->assign(_builder->access(type_of(shape), _storage(args[0]), i), _read(args[2], shape));
+    }
+
+    void _translate_spline(luisa::span<const Symbol *const> args) noexcept {
+        // spline dest basis x [count] knots
+        if (args.size() != 4u && args.size() != 5u) {
+            _fail("Malformed spline");
+            return;
+        }
+        auto &&basis_state = _state(args[1]);
+        auto &&knots = _state(args[args.size() - 1u]);
+        auto &&x_state = _state(args[2]);
+        auto basis = std::find_if(std::begin(spline_bases), std::end(spline_bases), [&](auto &&b) noexcept {
+            return basis_state.is_known && b.name == basis_state.string;
+        });
+        if (basis == std::end(spline_bases)) {
+            _fail(luisa::format("Unsupported spline basis '{}'", basis_state.string));
+            return;
+        }
+        auto count = knots.length;
+        if (args.size() == 5u) {
+            auto &&c = _state(args[3]);
+            if (!c.is_known || c.shape != int_shape) {
+                _fail("Unsupported dynamic number of spline knots");
+                return;
+            }
+            count = std::min(count, static_cast<uint32_t>(std::max(static_cast<int>(c.known[0]), 0)));
+        }
+        if (knots.length == 0u || count < 4u || knots.shape.kind == Kind::STRING ||
+            (x_state.shape != float_shape && x_state.shape != int_shape)) {
+            _fail("Invalid spline");
+            return;
+        }
+        auto shape = knots.shape;
+        auto type = type_of(shape);
+        auto segments = (count - 4u) / basis->step + 1u;
+        // x = clamp(x, 0, 1) * segments, split into the segment and the position in it
+        auto x = _builder->call(Type::of<float>(), CallOp::CLAMP,
+                                {_read(args[2], float_shape), _splat(float_shape, 0.), _splat(float_shape, 1.)});
+        x = _temporary(_builder->binary(Type::of<float>(), BinaryOp::MUL, x, _splat(float_shape, segments)));
+        auto segment = _temporary(_builder->call(
+            Type::of<int>(), CallOp::MIN,
+            {_builder->cast(Type::of<int>(), CastOp::STATIC, x), _splat(int_shape, segments - 1.)}));
+        x = _temporary(_builder->binary(Type::of<float>(), BinaryOp::SUB, x,
+                                        _builder->cast(Type::of<float>(), CastOp::STATIC, segment)));
+        auto first = _temporary(_builder->binary(Type::of<int>(), BinaryOp::MUL, segment, _splat(int_shape, basis->step)));
+        auto points = knots.is_known ? _constant(knots) : _storage(args[args.size() - 1u]);
+        auto knot = [&](uint j) noexcept {
+            auto i = _builder->binary(Type::of<int>(), BinaryOp::ADD, first, _splat(int_shape, j));
+            return _builder->access(type, points, i);
+        };
+        const Expression *result = nullptr;
+        if (basis->name == "constant"sv) {
+            result = knot(1u);
+        } else {
+            std::array<const Expression *, 4u> p{};
+            for (auto j = 0u; j < 4u; j++) { p[j] = _temporary(knot(j)); }
+            // Horner's rule on the coefficients of the segment, skipping the zero terms
+            for (auto k = 0u; k < 4u; k++) {
+                const Expression *tk = nullptr;
+                for (auto j = 0u; j < 4u; j++) {
+                    if (auto m = basis->m[k][j]; m != 0.f) {
+                        auto term = _builder->binary(type, BinaryOp::MUL, p[j], _splat(shape, m));
+                        tk = tk == nullptr ? term : _builder->binary(type, BinaryOp::ADD, tk, term);
+                    }
+                }
+                if (tk == nullptr) {
+                    // the leading zero terms are dropped
+                    if (result == nullptr) { continue; }
+                    tk = _splat(shape, 0.);
+                }
+                result = result == nullptr ?
+                             tk :
+                             _builder->binary(type, BinaryOp::ADD,
+                                              _builder->binary(type, BinaryOp::MUL, result,
+                                                               _convert(x, float_shape, shape)),
+                                              tk);
+            }
+        }
+        _write(args[0], result, shape);
+    }
+};
+
+}// namespace detail
+
+Translator::Translator() noexcept = default;
+Translator::~Translator() noexcept = default;
+
+const Translator::Translation *Translator::translate(const Shader &shader,
+                                                     const Specialization &specialization) noexcept {
+    // the key is computed from the contents of the shader, so that the
+    // same shader loaded from different files is translated only once
+    auto data = ShaderLibrary::serialize(shader);
+    luisa::vector<uint64_t> hashes;
+    hashes.reserve(1u + specialization.size() * 2u);
+    hashes.emplace_back(luisa::hash64(data.data(), data.size(), luisa::hash64_default_seed));
+    // sorted so that the key does not depend on the order of the entries
+    luisa::vector<const Specialization::value_type *> entries;
+    entries.reserve(specialization.size());
+    for (auto &&entry : specialization) { entries.emplace_back(&entry); }
+    std::sort(entries.begin(), entries.end(), [](auto lhs, auto rhs) noexcept {
+        return lhs->first < rhs->first;
+    });
+    for (auto entry : entries) {
+        hashes.emplace_back(luisa::hash64(entry->first.data(), entry->first.size(), luisa::hash64_default_seed));
+        hashes.emplace_back(luisa::hash64(entry->second.data(), entry->second.size() * sizeof(double),
+                                          luisa::hash64_default_seed));
+    }
+    auto key = luisa::hash64(hashes.data(), hashes.size() * sizeof(uint64_t), luisa::hash64_default_seed);
+    {
+        std::scoped_lock lock{_mutex};
+        if (auto iter = _translations.find(key); iter != _translations.end()) {
+            return iter->second.get();
+        }
+    }
+    detail::ShaderTranslation translation{shader, specialization};
+    auto function = translation.build();
+    luisa::unique_ptr<Translation> result;
+    if (function == nullptr) {
+        LUISA_WARNING_WITH_LOCATION("Failed to translate shader '{}': {}.",
+                                    shader.identifier(), translation.error());
+    } else {
+        result = luisa::make_unique<Translation>(Translation{std::move(function), translation.arguments()});
+    }
+    std::scoped_lock lock{_mutex};
+    if (result != nullptr) {
+        // specializations that only differ in unused parameters give identical callables
+        auto [iter, first] = _functions.try_emplace(result->function->hash(), result->function);
+        if (!first) { result->function = iter->second; }
+    }
+    return _translations.try_emplace(key, std::move(result)).first->second.get();
+}
+
+size_t Translator::function_count() noexcept {
+    std::scoped_lock lock{_mutex};
+    return _functions.size();
+}
+
+Translator::Specialization Translator::default_specialization(const Shader &shader) noexcept {
+    Specialization specialization;
+    for (auto &&symbol : shader.symbols()) {
+        if (symbol->tag() != Symbol::Tag::SYM_PARAM ||
+            symbol->initial_values().empty()) { continue; }
+        auto shape = detail::shape_of(symbol->type());
+        if (!shape || shape->kind == detail::Kind::STRING) { continue; }
+        luisa::vector<double> values;
+        values.reserve(symbol->initial_values().size());
+        for (auto &&v : symbol->initial_values()) {
+            if (!v.is_number()) { break; }
+            values.emplace_back(v.as_double());
+        }
+        if (values.size() == symbol->initial_values().size()) {
+            specialization.emplace(luisa::string{symbol->identifier()}, std::move(values));
+        }
+    }
+    return specialization;
+}
+
+}// namespace luisa::compute::osl
@@ -0,0 +1,180 @@
+#include <cstring>
+#include <algorithm>
+
+#include <luisa/core/logging.h>
+#include <luisa/runtime/rhi/command.h>
+#include <luisa/runtime/rhi/device_interface.h>
+#include <luisa/runtime/command_graph.h>
+#include <luisa/backends/ext/command_graph_ext.h>
+
+namespace luisa::compute {
+
+struct CommandGraph::Recording {
+    DeviceInterface *device;
+    CommandGraphExt *ext;
+    uint64_t handle;
+    Recording(DeviceInterface *device, CommandGraphExt *ext, uint64_t handle) noexcept
+        : device{device}, ext{ext}, handle{handle} {}
+    Recording(const Recording &) = delete;
+    ~Recording() noexcept { ext->destroy_command_graph(handle); }
+};
+
+CommandGraph::CommandGraph() noexcept = default;
+CommandGraph::CommandGraph(CommandGraph &&) noexcept = default;
+CommandGraph &CommandGraph::operator=(CommandGraph &&) noexcept = default;
+
+CommandGraph::CommandGraph(CommandList &&list) noexcept {
+    LUISA_ASSERT(list.callbacks().empty(),
+                 "Callbacks cannot be recorded into command graphs.");
+    for (auto &&cmd : list.commands()) {
+        LUISA_ASSERT(cmd->tag() != Command::Tag::ECustomCommand,
+                     "Custom commands cannot be recorded into command graphs.");
+    }
+    _commands = list.steal_commands();
+}
+
+CommandGraph::~CommandGraph() noexcept = default;
+
+ShaderDispatchCommand *CommandGraph::_dispatch(size_t command_index) const noexcept {
+    LUISA_ASSERT(command_index < _commands.size(),
+                 "Command index {} out of range [0, {}).",
+                 command_index, _commands.size());
+    auto cmd = _commands[command_index].get();
+    LUISA_ASSERT(cmd->tag() == Command::Tag::EShaderDispatchCommand,
+                 "Command {} is not a shader dispatch.", command_index);
+    return static_cast<ShaderDispatchCommand *>(cmd);
+}
+
+Argument &CommandGraph::_argument(size_t command_index, size_t argument_index,
+                                  Argument::Tag tag) const noexcept {
+    auto cmd = _dispatch(command_index);
+    LUISA_ASSERT(argument_index < cmd->_argument_count,
+                 "Argument index {} out of range [0, {}) in command {}.",
+                 argument_index, cmd->_argument_count, command_index);
+    auto &&arg = reinterpret_cast<Argument *>(cmd->_argument_buffer.data())[argument_index];
+    LUISA_ASSERT(arg.tag == tag,
+                 "Argument {} of command {} has tag {} but {} is expected.",
+                 argument_index, command_index,
+                 luisa::to_underlying(arg.tag), luisa::to_underlying(tag));
+    return arg;
+}
+
+void CommandGraph::_set_uniform(size_t command_index, size_t argument_index,
+                                const void *data, size_t size) noexcept {
+    auto &&arg = _argument(command_index, argument_index, Argument::Tag::UNIFORM);
+    LUISA_ASSERT(arg.uniform.size == size,
+                 "Uniform {} of command {} has size {} but {} bytes are given.",
+                 argument_index, command_index, arg.uniform.size, size);
+    auto cmd = _dispatch(command_index);
+    std::memcpy(cmd->_argument_buffer.data() + arg.uniform.offset, data, size);
+    _mark_dirty(command_index);
+}
+
+void CommandGraph::_mark_dirty(size_t command_index) noexcept {
+    if (_recording != nullptr) { _dirty.emplace_back(command_index); }
+}
+
+void CommandGraph::set_dispatch_size(size_t command_index, uint3 dispatch_size) noexcept {
+    auto cmd = _dispatch(command_index);
+    LUISA_ASSERT(!cmd->is_indirect(),
+                 "Cannot set the dispatch size of indirect dispatch {}.", command_index);
+    LUISA_ASSERT(!cmd->is_multiple_dispatch(),
+                 "Cannot set the dispatch size of batched dispatch {}.", command_index);
+    cmd->_dispatch_size = dispatch_size;
+    _mark_dirty(command_index);
+}
+
+void CommandGraph::set_buffer(size_t command_index, size_t argument_index,
+                              uint64_t handle, size_t offset_bytes, size_t size_bytes) noexcept {
+    auto &&arg = _argument(command_index, argument_index, Argument::Tag::BUFFER);
+    arg.buffer = Argument::Buffer{handle, offset_bytes, size_bytes};
+    _mark_dirty(command_index);
+}
+
+void CommandGraph::set_texture(size_t command_index, size_t argument_index,
+                               uint64_t handle, uint32_t level) noexcept {
+    auto &&arg = _argument(command_index, argument_index, Argument::Tag::TEXTURE);
+    arg.texture = Argument::Texture{handle, level};
+    _mark_dirty(command_index);
+}
+
+void CommandGraph::set_bindless_array(size_t command_index, size_t argument_index, uint64_t handle) noexcept {
+    auto &&arg = _argument(command_index, argument_index, Argument::Tag::BINDLESS_ARRAY);
+    arg.bindless_array = Argument::BindlessArray{handle};
+    _mark_dirty(command_index);
+}
+
+void CommandGraph::set_accel(size_t command_index, size_t argument_index, uint64_t handle) noexcept {
+    auto &&arg = _argument(command_index, argument_index, Argument::Tag::ACCEL);
+    arg.accel = Argument::Accel{handle};
+    _mark_dirty(command_index);
+}
+
+CommandList CommandGraph::_copy() const noexcept {
+    auto list = CommandList::create(_commands.size());
+    for (auto &&cmd : _commands) {
+        switch (cmd->tag()) {
+            case Command::Tag::EShaderDispatchCommand: {
+                auto dispatch = static_cast<const ShaderDispatchCommand *>(cmd.get());
+                list << luisa::make_unique<ShaderDispatchCommand>(
+                    dispatch->handle(),
+                    luisa::vector<std::byte>(dispatch->_argument_buffer),
+                    dispatch->_argument_count,
+                    dispatch->_dispatch_size);
+                break;
+            }
+#define LUISA_COMMAND_GRAPH_CLONE(CMD)                                         \
+    case Command::Tag::E##CMD:                                                 \
+        list << luisa::make_unique<CMD>(*static_cast<const CMD *>(cmd.get())); \
+        break;
+                LUISA_COMMAND_GRAPH_CLONE(BufferUploadCommand)
+                LUISA_COMMAND_GRAPH_CLONE(BufferDownloadCommand)
+                LUISA_COMMAND_GRAPH_CLONE(BufferCopyCommand)
+                LUISA_COMMAND_GRAPH_CLONE(BufferToTextureCopyCommand)
+                LUISA_COMMAND_GRAPH_CLONE(TextureUploadCommand)
+                LUISA_COMMAND_GRAPH_CLONE(TextureDownloadCommand)
+                LUISA_COMMAND_GRAPH_CLONE(TextureCopyCommand)
+                LUISA_COMMAND_GRAPH_CLONE(TextureToBufferCopyCommand)
+                LUISA_COMMAND_GRAPH_CLONE(AccelBuildCommand)
+                LUISA_COMMAND_GRAPH_CLONE(MeshBuildCommand)
+                LUISA_COMMAND_GRAPH_CLONE(ProceduralPrimitiveBuildCommand)
+                LUISA_COMMAND_GRAPH_CLONE(BindlessArrayUpdateCommand)
+#undef LUISA_COMMAND_GRAPH_CLONE
+            default: LUISA_ERROR_WITH_LOCATION("Unsupported command in command graph.");
+        }
+    }
+    return list;
+}
+
+void CommandGraph::_submit(DeviceInterface *device, uint64_t stream_handle) noexcept {
+    if (_commands.empty()) { return; }
+    if (_recording == nullptr) {
+        if (auto ext = static_cast<CommandGraphExt *>(device->extension(CommandGraphExt::name))) {
+            auto handle = ext->create_command_graph(_commands);
+            _recording = luisa::make_unique<Recording>(device, ext, handle);
+            _dirty.clear();
+        }
+    }
+    if (_recording != nullptr && _recording->device == device) {
+        if (!_dirty.empty()) {
+            std::sort(_dirty.begin(), _dirty.end());
+            _dirty.erase(std::unique(_dirty.begin(), _dirty.end()), _dirty.end());
+            _recording->ext->update_command_graph(_recording->handle, _commands, _dirty);
+            _dirty.clear();
+        }
+        _recording->ext->dispatch_command_graph(stream_handle, _recording->handle);
+    } else {
+        // without a recording on this device, the backend executes a copy
+        device->dispatch(stream_handle, _copy());
+    }
+}
+
+CommandGraphCommit CommandGraph::commit() noexcept {
+    return {this};
+}
+
+void CommandGraphCommit::operator()(DeviceInterface *device, uint64_t stream_handle) noexcept {
+    graph->_submit(device, stream_handle);
+}
+
+}// namespace luisa::compute
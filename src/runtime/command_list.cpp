@@ -1,5 +1,6 @@
 #include <luisa/runtime/rhi/command.h>
 #include <luisa/runtime/command_list.h>
+#include <luisa/runtime/mipmap.h>
 #include <luisa/core/logging.h>
 
 namespace luisa::compute {
@@ -18,11 +19,15 @@ void CommandList::reserve(size_t command_size, size_t callback_size) noexcept {
 void CommandList::clear() noexcept {
     _commands.clear();
     _callbacks.clear();
+    _has_mipmap_commands = false;
     _committed = false;
 }
 
 CommandList &CommandList::append(luisa::unique_ptr<Command> &&cmd) noexcept {
-    if (cmd) { _commands.emplace_back(std::move(cmd)); }
+    if (cmd) {
+        _has_mipmap_commands |= detail::MipmapFallback::is_mipmap_command(cmd.get());
+        _commands.emplace_back(std::move(cmd));
+    }
     return *this;
 }
 
@@ -43,6 +48,7 @@ CommandList::CallbackContainer CommandList::steal_callbacks() noexcept {
 }
 
 CommandList::CommandContainer CommandList::steal_commands() noexcept {
+    _has_mipmap_commands = false;
     return std::move(_commands);
 }
 
@@ -60,7 +66,11 @@ CommandList::Commit CommandList::commit() noexcept {
 CommandList::CommandList(CommandList &&another) noexcept
     : _commands{std::move(another._commands)},
       _callbacks{std::move(another._callbacks)},
-      _committed{another._committed} { another._committed = false; }
+      _has_mipmap_commands{another._has_mipmap_commands},
+      _committed{another._committed} {
+    another._has_mipmap_commands = false;
+    another._committed = false;
+}
 
 }// namespace luisa::compute
 
@@ -0,0 +1,183 @@
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/hash.h>
+#include <luisa/ast/callable_library.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/kernel_fusion.h>
+
+namespace luisa::compute {
+
+KernelFusion Device::kernel_fusion(const ShaderOption &option) noexcept {
+    return KernelFusion{_impl.get(), option};
+}
+
+KernelFusion::KernelFusion(DeviceInterface *device, const ShaderOption &option) noexcept
+    : _device{device}, _option{option} {
+    // fused kernels are generated on demand and must not share a name
+    _option.name.clear();
+}
+
+KernelFusion::KernelFusion(KernelFusion &&another) noexcept
+    : _device{std::exchange(another._device, nullptr)},
+      _option{std::move(another._option)},
+      _stages{std::move(another._stages)},
+      _fused{std::move(another._fused)} { another._fused.clear(); }
+
+KernelFusion &KernelFusion::operator=(KernelFusion &&rhs) noexcept {
+    if (this != &rhs) [[likely]] {
+        _destroy();
+        _device = std::exchange(rhs._device, nullptr);
+        _option = std::move(rhs._option);
+        _stages = std::move(rhs._stages);
+        _fused = std::move(rhs._fused);
+        rhs._fused.clear();
+    }
+    return *this;
+}
+
+KernelFusion::~KernelFusion() noexcept { _destroy(); }
+
+void KernelFusion::_destroy() noexcept {
+    if (_device == nullptr) { return; }
+    for (auto &&[hash, shader] : _fused) {
+        _device->destroy_shader(shader.handle);
+    }
+    _fused.clear();
+}
+
+void KernelFusion::_register(uint64_t shader_handle,
+                             luisa::shared_ptr<const detail::FunctionBuilder> kernel) noexcept {
+    auto &&f = *kernel;
+    if (!f.shared_variables().empty() ||
+        f.propagated_builtin_callables().test(CallOp::SYNCHRONIZE_BLOCK) ||
+        !f.external_callables().empty() ||
+        !f.cpu_callbacks().empty()) {
+        LUISA_WARNING_WITH_LOCATION(
+            "Kernel {:016x} uses shared memory, block synchronization, "
+            "external functions or CPU callbacks and will not be fused.",
+            f.hash());
+        return;
+    }
+    _stages.insert_or_assign(shader_handle, Stage{std::move(kernel), nullptr});
+}
+
+KernelFusion::Stage *KernelFusion::_stage(const Command *command) noexcept {
+    if (command->tag() != Command::Tag::EShaderDispatchCommand) { return nullptr; }
+    auto dispatch = static_cast<const ShaderDispatchCommand *>(command);
+    if (dispatch->is_indirect() || dispatch->is_multiple_dispatch()) { return nullptr; }
+    auto iter = _stages.find(dispatch->handle());
+    return iter == _stages.end() ? nullptr : &iter->second;
+}
+
+const KernelFusion::FusedShader &KernelFusion::_fuse(luisa::span<Stage *const> stages) noexcept {
+    luisa::vector<uint64_t> hashes;
+    hashes.reserve(stages.size());
+    for (auto s : stages) { hashes.emplace_back(s->kernel->hash()); }
+    auto hash = luisa::hash_combine(hashes);
+    if (auto iter = _fused.find(hash); iter != _fused.end()) {
+        return iter->second;
+    }
+    auto fused = detail::FunctionBuilder::define_kernel([&] {
+        auto fb = detail::FunctionBuilder::current();
+        fb->set_block_size(stages.front()->kernel->block_size());
+        luisa::vector<const Expression *> args;
+        for (auto s : stages) {
+            if (s->callable == nullptr) {
+                s->callable = CallableLibrary::kernel_to_callable(s->kernel->function());
+            }
+            args.clear();
+            for (auto &&arg : s->kernel->unbound_arguments()) {
+                switch (arg.tag()) {
+                    case Variable::Tag::BUFFER: args.emplace_back(fb->buffer(arg.type())); break;
+                    case Variable::Tag::TEXTURE: args.emplace_back(fb->texture(arg.type())); break;
+                    case Variable::Tag::BINDLESS_ARRAY: args.emplace_back(fb->bindless_array()); break;
+                    case Variable::Tag::ACCEL: args.emplace_back(fb->accel()); break;
+                    default: args.emplace_back(fb->argument(arg.type())); break;
+                }
+            }
+            fb->call(s->callable->function(), args);
+        }
+    });
+    auto info = _device->create_shader(_option, fused->function());
+    FusedShader shader{
+        .handle = info.handle,
+        .uniform_size = ShaderDispatchCmdEncoder::compute_uniform_size(fused->unbound_arguments())};
+    LUISA_VERBOSE("Fused {} kernels into kernel {:016x}.", stages.size(), fused->hash());
+    return _fused.try_emplace(hash, shader).first->second;
+}
+
+luisa::unique_ptr<Command> KernelFusion::_encode(const FusedShader &shader,
+                                                 luisa::span<const luisa::unique_ptr<Command>> commands) noexcept {
+    auto arg_count = static_cast<size_t>(0u);
+    for (auto &&cmd : commands) {
+        arg_count += static_cast<const ShaderDispatchCommand *>(cmd.get())->arguments().size();
+    }
+    ComputeDispatchCmdEncoder encoder{shader.handle, arg_count, shader.uniform_size};
+    for (auto &&cmd : commands) {
+        auto dispatch = static_cast<const ShaderDispatchCommand *>(cmd.get());
+        for (auto &&arg : dispatch->arguments()) {
+            switch (arg.tag) {
+                case Argument::Tag::BUFFER:
+                    encoder.encode_buffer(arg.buffer.handle, arg.buffer.offset, arg.buffer.size);
+                    break;
+                case Argument::Tag::TEXTURE:
+                    encoder.encode_texture(arg.texture.handle, arg.texture.level);
+                    break;
+                case Argument::Tag::UNIFORM: {
+                    auto data = dispatch->uniform(arg.uniform);
+                    encoder.encode_uniform(data.data(), data.size());
+                    break;
+                }
+                case Argument::Tag::BINDLESS_ARRAY:
+                    encoder.encode_bindless_array(arg.bindless_array.handle);
+                    break;
+                case Argument::Tag::ACCEL:
+                    encoder.encode_accel(arg.accel.handle);
+                    break;
+            }
+        }
+    }
+    encoder.set_dispatch_size(static_cast<const ShaderDispatchCommand *>(
+                                  commands.front().get())
+                                  ->dispatch_size());
+    return std::move(encoder).build();
+}
+
+CommandList KernelFusion::fuse(CommandList &&list) noexcept {
+    auto callbacks = list.steal_callbacks();
+    auto commands = list.steal_commands();
+    auto fused = CommandList::create(commands.size(), callbacks.size());
+    luisa::vector<Stage *> stages;
+    for (auto i = 0u; i < commands.size();) {
+        // find the longest run of compatible dispatches starting at i
+        stages.clear();
+        auto first = _stage(commands[i].get());
+        auto n = 1u;
+        if (first != nullptr) {
+            auto dispatch_size = static_cast<const ShaderDispatchCommand *>(commands[i].get())->dispatch_size();
+            stages.emplace_back(first);
+            while (i + n < commands.size() && n < max_stages) {
+                auto next = _stage(commands[i + n].get());
+                if (next == nullptr ||
+                    any(next->kernel->block_size() != first->kernel->block_size()) ||
+                    any(static_cast<const ShaderDispatchCommand *>(commands[i + n].get())->dispatch_size() != dispatch_size)) {
+                    break;
+                }
+                stages.emplace_back(next);
+                n++;
+            }
+        }
+        if (n == 1u) {
+            fused << std::move(commands[i]);
+        } else {
+            auto &&shader = _fuse(stages);
+            fused << _encode(shader, luisa::span{commands}.subspan(i, n));
+        }
+        i += n;
+    }
+    for (auto &&callback : callbacks) {
+        fused.add_callback(std::move(callback));
+    }
+    return fused;
+}
+
+}// namespace luisa::compute
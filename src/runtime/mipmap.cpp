@@ -1,6 +1,16 @@
+#include <cmath>
+#include <numbers>
+#include <algorithm>
+
 #include <luisa/core/logging.h>
 #include <luisa/core/magic_enum.h>
+#include <luisa/ast/function_builder.h>
+#include <luisa/runtime/rhi/device_interface.h>
+#include <luisa/runtime/rhi/command_encoder.h>
+#include <luisa/runtime/command_list.h>
 #include <luisa/runtime/mipmap.h>
+#include <luisa/backends/ext/mipmap_cmd.h>
+#include <luisa/backends/ext/mipmap_ext.h>
 
 namespace luisa::compute::detail {
 
@@ -38,5 +48,205 @@ MipmapView::MipmapView(uint64_t handle, uint3 size, uint32_t level, PixelStorage
         _storage, src._handle, _handle, src._level, _level, _size);
 }
 
-}// namespace luisa::compute::detail
+luisa::unique_ptr<Command> generate_mipmaps(uint64_t handle, PixelStorage storage, uint2 size,
+                                            uint level_count, MipmapFilter filter, bool srgb) noexcept {
+    if (is_block_compressed(storage)) [[unlikely]] {
+        LUISA_ERROR_WITH_LOCATION(
+            "Cannot generate mipmaps for block-compressed storage {}.",
+            luisa::to_string(storage));
+    }
+    return luisa::make_unique<GenerateMipmapsCommand>(
+        handle, storage, size, level_count, filter, srgb);
+}
+
+static constexpr auto mipmap_kaiser_taps = 8u;
+
+// the weights of the CPU backend: taps at offsets -3.5, ..., 3.5 around the
+// center of a destination texel, a sinc with the cutoff at the destination
+// Nyquist frequency windowed by a Kaiser window (alpha = 4) of half-width 4
+[[nodiscard]] static std::array<float, mipmap_kaiser_taps> mipmap_kaiser_weights() noexcept {
+    constexpr auto alpha = 4.;
+    auto bessel_i0 = [](double x) noexcept {
+        auto sum = 1.;
+        auto term = 1.;
+        for (auto k = 1; k < 32; k++) {
+            term *= (x * .5 / k) * (x * .5 / k);
+            sum += term;
+        }
+        return sum;
+    };
+    std::array<double, mipmap_kaiser_taps> w{};
+    auto sum = 0.;
+    for (auto t = 0u; t < mipmap_kaiser_taps; t++) {
+        auto d = static_cast<double>(t) - (mipmap_kaiser_taps - 1u) * .5;
+        auto x = std::numbers::pi * d * .5;
+        auto r = d / 4.;
+        w[t] = std::sin(x) / x * bessel_i0(alpha * std::sqrt(1. - r * r)) / bessel_i0(alpha);
+        sum += w[t];
+    }
+    std::array<float, mipmap_kaiser_taps> weights{};
+    for (auto t = 0u; t < mipmap_kaiser_taps; t++) { weights[t] = static_cast<float>(w[t] / sum); }
+    return weights;
+}
+
+// kernel(src: level - 1, dst: level), dispatched over the destination level
+[[nodiscard]] static auto make_mipmap_kernel(MipmapFilter filter, bool srgb) noexcept {
+    return FunctionBuilder::define_kernel([filter, srgb] {
+        auto fb = FunctionBuilder::current();
+        fb->set_block_size(make_uint3(16u, 16u, 1u));
+        auto src = fb->texture(Type::of<Image<float>>());
+        auto dst = fb->texture(Type::of<Image<float>>());
+        auto f4 = [fb](float x) noexcept { return fb->literal(Type::of<float4>(), make_float4(x)); };
+        auto u2 = [fb](uint x) noexcept { return fb->literal(Type::of<uint2>(), make_uint2(x)); };
+        auto i2 = [fb](int x) noexcept { return fb->literal(Type::of<int2>(), make_int2(x)); };
+        auto add = [fb](const Type *t, const Expression *a, const Expression *b) noexcept { return fb->binary(t, BinaryOp::ADD, a, b); };
+        auto mul = [fb](const Type *t, const Expression *a, const Expression *b) noexcept { return fb->binary(t, BinaryOp::MUL, a, b); };
+        auto def = [fb](const Type *t, const Expression *value) noexcept {
+            auto v = fb->local(t);
+            fb->assign(v, value);
+            return v;
+        };
+        auto x = [fb](const Expression *v) noexcept { return fb->swizzle(Type::of<uint>(), v, 1u, 0x0u); };
+        auto y = [fb](const Expression *v) noexcept { return fb->swizzle(Type::of<uint>(), v, 1u, 0x1u); };
+        auto select_rgb = [&](const Expression *rgb, const Expression *v) noexcept {
+            auto alpha = fb->literal(Type::of<bool4>(), make_bool4(false, false, false, true));
+            return fb->call(Type::of<float4>(), CallOp::SELECT, {rgb, v, alpha});
+        };
+        // the color channels are filtered in linear space, the alpha channel is linear
+        auto load = [&](const Expression *coord) noexcept {
+            auto v = def(Type::of<float4>(), fb->call(Type::of<float4>(), CallOp::TEXTURE_READ, {src, coord}));
+            if (!srgb) { return v; }
+            auto lo = mul(Type::of<float4>(), v, f4(1.f / 12.92f));
+            auto hi = fb->call(Type::of<float4>(), CallOp::POW,
+                               {mul(Type::of<float4>(), add(Type::of<float4>(), v, f4(.055f)), f4(1.f / 1.055f)), f4(2.4f)});
+            auto is_lo = fb->binary(Type::of<bool4>(), BinaryOp::LESS_EQUAL, v, f4(.04045f));
+            return def(Type::of<float4>(), select_rgb(fb->call(Type::of<float4>(), CallOp::SELECT, {hi, lo, is_lo}), v));
+        };
+        auto p = def(Type::of<uint2>(), fb->swizzle(Type::of<uint2>(), fb->dispatch_id(), 2u, 0x10u));
+        auto last = def(Type::of<uint2>(), fb->binary(Type::of<uint2>(), BinaryOp::SUB,
+                                                      fb->call(Type::of<uint2>(), CallOp::TEXTURE_SIZE, {src}), u2(1u)));
+        const Expression *result = nullptr;
+        switch (filter) {
+            case MipmapFilter::BOX: {
+                // odd rows and columns at the end of the source are read twice
+                auto c0 = def(Type::of<uint2>(), mul(Type::of<uint2>(), p, u2(2u)));
+                auto c1 = def(Type::of<uint2>(), fb->call(Type::of<uint2>(), CallOp::MIN, {add(Type::of<uint2>(), c0, u2(1u)), last}));
+                auto texel = [&](const Expression *cx, const Expression *cy) noexcept {
+                    return load(fb->call(Type::of<uint2>(), CallOp::MAKE_UINT2, {x(cx), y(cy)}));
+                };
+                auto sum = add(Type::of<float4>(),
+                               add(Type::of<float4>(), texel(c0, c0), texel(c1, c0)),
+                               add(Type::of<float4>(), texel(c0, c1), texel(c1, c1)));
+                result = mul(Type::of<float4>(), sum, f4(.25f));
+                break;
+            }
+            case MipmapFilter::KAISER: {
+                static const auto weights = mipmap_kaiser_weights();
+                // destination texel p is centered between source texels 2p and 2p + 1
+                auto base = def(Type::of<int2>(), fb->binary(Type::of<int2>(), BinaryOp::SUB,
+                                                             fb->cast(Type::of<int2>(), CastOp::STATIC, mul(Type::of<uint2>(), p, u2(2u))),
+                                                             i2(static_cast<int>(mipmap_kaiser_taps / 2u - 1u))));
+                auto upper = def(Type::of<int2>(), fb->cast(Type::of<int2>(), CastOp::STATIC, last));
+                std::array<const Expression *, mipmap_kaiser_taps> taps{};
+                for (auto t = 0u; t < mipmap_kaiser_taps; t++) {
+                    auto c = fb->call(Type::of<int2>(), CallOp::CLAMP,
+                                      {add(Type::of<int2>(), base, i2(static_cast<int>(t))), i2(0), upper});
+                    taps[t] = def(Type::of<uint2>(), fb->cast(Type::of<uint2>(), CastOp::STATIC, c));
+                }
+                auto acc = def(Type::of<float4>(), f4(0.f));
+                for (auto ty = 0u; ty < mipmap_kaiser_taps; ty++) {
+                    auto row = def(Type::of<float4>(), f4(0.f));
+                    for (auto tx = 0u; tx < mipmap_kaiser_taps; tx++) {
+                        auto v = load(fb->call(Type::of<uint2>(), CallOp::MAKE_UINT2, {x(taps[tx]), y(taps[ty])}));
+                        fb->assign(row, add(Type::of<float4>(), row, mul(Type::of<float4>(), f4(weights[tx]), v)));
+                    }
+                    fb->assign(acc, add(Type::of<float4>(), acc, mul(Type::of<float4>(), f4(weights[ty]), row)));
+                }
+                result = acc;
+                break;
+            }
+        }
+        auto v = def(Type::of<float4>(), result);
+        if (srgb) {
+            auto lo = mul(Type::of<float4>(), v, f4(12.92f));
+            auto hi = fb->binary(Type::of<float4>(), BinaryOp::SUB,
+                                 mul(Type::of<float4>(), f4(1.055f),
+                                     fb->call(Type::of<float4>(), CallOp::POW, {v, f4(1.f / 2.4f)})),
+                                 f4(.055f));
+            auto is_lo = fb->binary(Type::of<bool4>(), BinaryOp::LESS_EQUAL, v, f4(.0031308f));
+            fb->assign(v, select_rgb(fb->call(Type::of<float4>(), CallOp::SELECT, {hi, lo, is_lo}), v));
+        }
+        fb->call(CallOp::TEXTURE_WRITE, {dst, p, v});
+    });
+}
 
+MipmapFallback::MipmapFallback(DeviceInterface *device) noexcept
+    : _device{device},
+      _ext{static_cast<const MipmapExt *>(device->extension(MipmapExt::name))} {
+    _shaders.fill(invalid_resource_handle);
+}
+
+MipmapFallback::~MipmapFallback() noexcept {
+    for (auto shader : _shaders) {
+        if (shader != invalid_resource_handle) { _device->destroy_shader(shader); }
+    }
+}
+
+bool MipmapFallback::is_mipmap_command(const Command *command) noexcept {
+    return command->tag() == Command::Tag::ECustomCommand &&
+           static_cast<const CustomCommand *>(command)->uuid() ==
+               to_underlying(CustomCommandUUID::MIPMAP_GENERATE);
+}
+
+uint64_t MipmapFallback::_shader(MipmapFilter filter, bool srgb) noexcept {
+    auto &&shader = _shaders[to_underlying(filter) * 2u + (srgb ? 1u : 0u)];
+    if (shader == invalid_resource_handle) {
+        auto kernel = make_mipmap_kernel(filter, srgb);
+        shader = _device->create_shader(ShaderOption{}, kernel->function()).handle;
+        LUISA_VERBOSE("Compiled the fallback kernel of {} mipmaps (srgb = {}).",
+                      luisa::to_string(filter), srgb);
+    }
+    return shader;
+}
+
+CommandList MipmapFallback::lower(CommandList &&list) noexcept {
+    // lists whose mipmap commands all run natively are passed through without being rebuilt
+    if (auto commands = list.commands();
+        _ext != nullptr && std::all_of(commands.begin(), commands.end(), [this](auto &&command) noexcept {
+            if (!is_mipmap_command(command.get())) { return true; }
+            auto mipmap = static_cast<const GenerateMipmapsCommand *>(command.get());
+            return _ext->is_mipmap_generation_supported(mipmap->storage(), mipmap->filter(), mipmap->srgb());
+        })) {
+        return std::move(list);
+    }
+    auto callbacks = list.steal_callbacks();
+    auto commands = list.steal_commands();
+    auto lowered = CommandList::create(commands.size(), callbacks.size());
+    for (auto &&command : commands) {
+        if (!is_mipmap_command(command.get())) {
+            lowered << std::move(command);
+            continue;
+        }
+        auto mipmap = static_cast<const GenerateMipmapsCommand *>(command.get());
+        if (_ext != nullptr &&
+            _ext->is_mipmap_generation_supported(mipmap->storage(), mipmap->filter(), mipmap->srgb())) {
+            lowered << std::move(command);
+            continue;
+        }
+        // levels are filtered in order, each from the previous one
+        for (auto level = 1u; level < mipmap->level_count(); level++) {
+            ComputeDispatchCmdEncoder encoder{_shader(mipmap->filter(), mipmap->srgb()), 2u, 0u};
+            encoder.encode_texture(mipmap->handle(), level - 1u);
+            encoder.encode_texture(mipmap->handle(), level);
+            auto size = mipmap->size();
+            encoder.set_dispatch_size(make_uint3(std::max(size.x >> level, 1u), std::max(size.y >> level, 1u), 1u));
+            lowered << std::move(encoder).build();
+        }
+    }
+    for (auto &&callback : callbacks) {
+        lowered.add_callback(std::move(callback));
+    }
+    return lowered;
+}
+
+}// namespace luisa::compute::detail
@@ -0,0 +1,99 @@
+#include <luisa/core/logging.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/shader_compile_batch.h>
+
+namespace luisa::compute {
+
+ShaderCompileBatch Device::compile_batch(size_t num_threads) noexcept {
+    return ShaderCompileBatch{_impl.get(), num_threads};
+}
+
+ShaderCompileBatch::ShaderCompileBatch(DeviceInterface *device, size_t num_threads) noexcept
+    : _state{luisa::make_shared<State>()},
+      _pool{luisa::make_unique<ThreadPool>(num_threads)} {
+    _state->device = device;
+}
+
+ShaderCompileBatch::~ShaderCompileBatch() noexcept {
+    if (_pool != nullptr) { _pool->synchronize(); }
+}
+
+size_t ShaderCompileBatch::_allocate_statistics(State &state) noexcept {
+    std::scoped_lock lock{state.mutex};
+    auto index = state.statistics.size();
+    state.statistics.emplace_back();
+    return index;
+}
+
+uint64_t ShaderCompileBatch::_compute_hash(Function kernel, const ShaderOption &option) noexcept {
+    // options that change the generated code must be part of the key; the name is
+    // only a label, except for compile-only requests, where it names the output
+    auto flags = (option.enable_cache ? 1u : 0u) |
+                 (option.enable_fast_math ? 2u : 0u) |
+                 (option.enable_debug_info ? 4u : 0u) |
+                 (option.compile_only ? 8u : 0u);
+    return luisa::hash_combine({kernel.hash(),
+                                static_cast<uint64_t>(flags),
+                                option.compile_only ? luisa::string_hash{}(option.name) : 0ull,
+                                luisa::string_hash{}(option.native_include)});
+}
+
+luisa::shared_ptr<ShaderCompileBatch::CompiledShader>
+ShaderCompileBatch::_find_or_create(State &state, uint64_t hash) noexcept {
+    std::scoped_lock lock{state.mutex};
+    auto iter = state.shaders.try_emplace(hash, nullptr).first;
+    if (iter->second == nullptr) {
+        iter->second = luisa::make_shared<CompiledShader>();
+    }
+    return iter->second;
+}
+
+void ShaderCompileBatch::_finish(State &state, size_t index, ShaderCompileStatistics stats) noexcept {
+    Callback callback;
+    {
+        std::scoped_lock lock{state.mutex};
+        state.statistics[index] = stats;
+        callback = state.callback;
+    }
+    if (callback) { callback(stats); }
+}
+
+void ShaderCompileBatch::set_callback(Callback callback) noexcept {
+    std::scoped_lock lock{_state->mutex};
+    _state->callback = std::move(callback);
+}
+
+void ShaderCompileBatch::wait() noexcept {
+    _pool->synchronize();
+}
+
+size_t ShaderCompileBatch::size() const noexcept {
+    std::scoped_lock lock{_state->mutex};
+    return _state->statistics.size();
+}
+
+luisa::vector<ShaderCompileStatistics> ShaderCompileBatch::statistics() const noexcept {
+    std::scoped_lock lock{_state->mutex};
+    return _state->statistics;
+}
+
+void ShaderCompileBatch::report() const noexcept {
+    auto stats = statistics();
+    auto trace_time = 0.;
+    auto compile_time = 0.;
+    auto deduplicated = 0u;
+    for (auto &&s : stats) {
+        LUISA_VERBOSE("Shader '{}': trace {} ms, compile {} ms{}.",
+                      s.name, s.trace_time, s.compile_time,
+                      s.deduplicated ? " (deduplicated)" : "");
+        trace_time += s.trace_time;
+        compile_time += s.compile_time;
+        deduplicated += s.deduplicated ? 1u : 0u;
+    }
+    LUISA_INFO("Compiled {} shader(s) on {} thread(s) ({} deduplicated): "
+               "total trace time {} ms, total compile time {} ms.",
+               stats.size(), _pool->size(), deduplicated,
+               trace_time, compile_time);
+}
+
+}// namespace luisa::compute
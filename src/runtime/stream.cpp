@@ -4,6 +4,7 @@
 #include <luisa/core/magic_enum.h>
 #include <luisa/runtime/device.h>
 #include <luisa/runtime/stream.h>
+#include <luisa/runtime/mipmap.h>
 
 namespace luisa::compute {
 
@@ -23,6 +24,14 @@ void Stream::_dispatch(CommandList &&list) noexcept {
                          to_string(i->stream_tag()), to_string(_stream_tag));
         }
 #endif
+        // mipmap generation is lowered to compute dispatches where the device cannot run it
+        if (list.has_mipmap_commands()) {
+            if (_mipmap_fallback == nullptr) {
+                _mipmap_fallback = luisa::make_shared<detail::MipmapFallback>(device());
+            }
+            device()->dispatch(handle(), _mipmap_fallback->lower(std::move(list)));
+            return;
+        }
         device()->dispatch(handle(), std::move(list));
     }
 }
@@ -106,7 +115,11 @@ Stream &Stream::operator<<(Stream::Synchronize &&) noexcept {
 }
 
 Stream::~Stream() noexcept {
-    if (*this) { device()->destroy_stream(handle()); }
+    if (*this) {
+        device()->destroy_stream(handle());
+        // the fallback shaders may be in use until the stream is destroyed
+        _mipmap_fallback = nullptr;
+    }
 }
 
 }// namespace luisa::compute
@@ -214,9 +214,21 @@ pub enum PixelStorage {
     Float1,
     Float2,
     Float4,
+    // block-compressed storages share the discriminants of the C++ PixelStorage
+    Bc1 = 17,
+    Bc2 = 18,
+    Bc3 = 19,
+    Bc4 = 20,
+    Bc5 = 21,
+    Bc6 = 22,
+    Bc7 = 23,
 }
 
 impl PixelStorage {
+    pub fn is_block_compressed(&self) -> bool {
+        *self as u32 >= PixelStorage::Bc1 as u32
+    }
+    // Size of a pixel in bytes, or of a 4x4 block for block-compressed storages.
     pub fn size(&self) -> usize {
         match self {
             PixelStorage::Byte1 => 1,
@@ -234,6 +246,12 @@ impl PixelStorage {
             PixelStorage::Float1 => 4,
             PixelStorage::Float2 => 8,
             PixelStorage::Float4 => 16,
+            PixelStorage::Bc1 | PixelStorage::Bc4 => 8,
+            PixelStorage::Bc2
+            | PixelStorage::Bc3
+            | PixelStorage::Bc5
+            | PixelStorage::Bc6
+            | PixelStorage::Bc7 => 16,
         }
     }
 }
@@ -281,6 +299,14 @@ pub enum PixelFormat {
     R32f,
     Rg32f,
     Rgba32f,
+
+    Bc1Unorm = 33,
+    Bc2Unorm = 34,
+    Bc3Unorm = 35,
+    Bc4Unorm = 36,
+    Bc5Unorm = 37,
+    Bc6hUf16 = 38,
+    Bc7Unorm = 39,
 }
 impl PixelFormat {
     pub fn storage(&self) -> PixelStorage {
@@ -310,6 +336,13 @@ impl PixelFormat {
             PixelFormat::Rg32f => PixelStorage::Float2,
             PixelFormat::Rgba32Sint | PixelFormat::Rgba32Uint => PixelStorage::Int4,
             PixelFormat::Rgba32f => PixelStorage::Float4,
+            PixelFormat::Bc1Unorm => PixelStorage::Bc1,
+            PixelFormat::Bc2Unorm => PixelStorage::Bc2,
+            PixelFormat::Bc3Unorm => PixelStorage::Bc3,
+            PixelFormat::Bc4Unorm => PixelStorage::Bc4,
+            PixelFormat::Bc5Unorm => PixelStorage::Bc5,
+            PixelFormat::Bc6hUf16 => PixelStorage::Bc6,
+            PixelFormat::Bc7Unorm => PixelStorage::Bc7,
         }
     }
 }
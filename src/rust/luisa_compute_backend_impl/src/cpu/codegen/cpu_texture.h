@@ -26,6 +26,13 @@ typedef enum LCPixelStorage {
     LC_PIXEL_STORAGE_FLOAT1,
     LC_PIXEL_STORAGE_FLOAT2,
     LC_PIXEL_STORAGE_FLOAT4,
+    LC_PIXEL_STORAGE_BC1 = 17,
+    LC_PIXEL_STORAGE_BC2 = 18,
+    LC_PIXEL_STORAGE_BC3 = 19,
+    LC_PIXEL_STORAGE_BC4 = 20,
+    LC_PIXEL_STORAGE_BC5 = 21,
+    LC_PIXEL_STORAGE_BC6 = 22,
+    LC_PIXEL_STORAGE_BC7 = 23,
 } LCPixelStorage;
 
 typedef enum LCSamplerAddress {
@@ -289,6 +296,430 @@ inline void write_pixel(LCPixelStorage storage, uint8_t *p, V v) noexcept {
     }
 }
 
+// Block-compressed storages: a texel is decoded from the 4x4 block holding it.
+// The block layouts follow the D3D11 functional specification.
+struct BCBlock {
+    uint64_t lo;
+    uint64_t hi;
+    [[nodiscard]] inline lc_uint bits(lc_uint offset, lc_uint count) const noexcept {
+        auto v = offset == 0u ? lo :
+                 offset < 64u ? (lo >> offset) | (hi << (64u - offset)) :
+                                hi >> (offset - 64u);
+        return static_cast<lc_uint>(v & ((1ull << count) - 1ull));
+    }
+};
+
+[[nodiscard]] inline BCBlock bc_load(const uint8_t *p, bool half_block) noexcept {
+    auto b = reinterpret_cast<const uint64_t *>(p);
+    return {b[0], half_block ? 0ull : b[1]};
+}
+
+static constexpr const lc_uint bc_weights2[4] = {0u, 21u, 43u, 64u};
+static constexpr const lc_uint bc_weights3[8] = {0u, 9u, 18u, 27u, 37u, 46u, 55u, 64u};
+static constexpr const lc_uint bc_weights4[16] = {0u, 4u, 9u, 13u, 17u, 21u, 26u, 30u,
+                                                  34u, 38u, 43u, 47u, 51u, 55u, 60u, 64u};
+
+[[nodiscard]] inline lc_uint bc_interpolate(lc_uint e0, lc_uint e1, lc_uint index, lc_uint index_bits) noexcept {
+    auto w = index_bits == 2u ? bc_weights2[index] :
+             index_bits == 3u ? bc_weights3[index] :
+                                bc_weights4[index];
+    return ((64u - w) * e0 + w * e1 + 32u) >> 6u;
+}
+
+// subset masks of the two-subset partitions, one bit per texel
+static constexpr const lc_ushort bc_partitions2[64] = {
+    0xccccu, 0x8888u, 0xeeeeu, 0xecc8u, 0xc880u, 0xfeecu, 0xfec8u, 0xec80u,
+    0xc800u, 0xffecu, 0xfe80u, 0xe800u, 0xffe8u, 0xff00u, 0xfff0u, 0xf000u,
+    0xf710u, 0x008eu, 0x7100u, 0x08ceu, 0x008cu, 0x7310u, 0x3100u, 0x8cceu,
+    0x088cu, 0x3110u, 0x6666u, 0x366cu, 0x17e8u, 0x0ff0u, 0x718eu, 0x399cu,
+    0xaaaau, 0xf0f0u, 0x5a5au, 0x33ccu, 0x3c3cu, 0x55aau, 0x9696u, 0xa55au,
+    0x73ceu, 0x13c8u, 0x324cu, 0x3bdcu, 0x6996u, 0xc33cu, 0x9966u, 0x0660u,
+    0x0272u, 0x04e4u, 0x4e40u, 0x2720u, 0xc936u, 0x936cu, 0x39c6u, 0x639cu,
+    0x9336u, 0x9cc6u, 0x817eu, 0xe718u, 0xccf0u, 0x0fccu, 0x7744u, 0xee22u,
+};
+// subsets of the three-subset partitions, two bits per texel
+static constexpr const lc_uint bc_partitions3[64] = {
+    0xaa685050u, 0x6a5a5040u, 0x5a5a4200u, 0x5450a0a8u,
+    0xa5a50000u, 0xa0a05050u, 0x5555a0a0u, 0x5a5a5050u,
+    0xaa550000u, 0xaa555500u, 0xaaaa5500u, 0x90909090u,
+    0x94949494u, 0xa4a4a4a4u, 0xa9a59450u, 0x2a0a4250u,
+    0xa5945040u, 0x0a425054u, 0xa5a5a500u, 0x55a0a0a0u,
+    0xa8a85454u, 0x6a6a4040u, 0xa4a45000u, 0x1a1a0500u,
+    0x0050a4a4u, 0xaaa59090u, 0x14696914u, 0x69691400u,
+    0xa08585a0u, 0xaa821414u, 0x50a4a450u, 0x6a5a0200u,
+    0xa9a58000u, 0x5090a0a8u, 0xa8a09050u, 0x24242424u,
+    0x00aa5500u, 0x24924924u, 0x24499224u, 0x50a50a50u,
+    0x500aa550u, 0xaaaa4444u, 0x66660000u, 0xa5a0a5a0u,
+    0x50a050a0u, 0x69286928u, 0x44aaaa44u, 0x66666600u,
+    0xaa444444u, 0x54a854a8u, 0x95809580u, 0x96969600u,
+    0xa85454a8u, 0x80959580u, 0xaa141414u, 0x96960000u,
+    0xaaaa1414u, 0xa05050a0u, 0xa0a5a5a0u, 0x96000000u,
+    0x40804080u, 0xa9a8a9a8u, 0xaaaaaa44u, 0x2a4a5254u,
+};
+// texel holding the (implicitly zero) high index bit of the second subset
+static constexpr const uint8_t bc_anchors2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+    15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+    6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15,
+};
+// same for the second and third subsets of the three-subset partitions
+static constexpr const uint8_t bc_anchors3[64][2] = {
+    {3, 15}, {3, 8}, {15, 8}, {15, 3}, {8, 15}, {3, 15}, {15, 3}, {15, 8},
+    {8, 15}, {8, 15}, {6, 15}, {6, 15}, {6, 15}, {5, 15}, {3, 15}, {3, 8},
+    {3, 15}, {3, 8}, {8, 15}, {15, 3}, {3, 15}, {3, 8}, {6, 15}, {10, 8},
+    {5, 3}, {8, 15}, {8, 6}, {6, 10}, {8, 15}, {5, 15}, {15, 10}, {15, 8},
+    {8, 15}, {15, 3}, {3, 15}, {5, 10}, {6, 10}, {10, 8}, {8, 9}, {15, 10},
+    {15, 6}, {3, 15}, {15, 8}, {5, 15}, {15, 3}, {15, 6}, {15, 6}, {15, 8},
+    {3, 15}, {15, 3}, {5, 15}, {5, 15}, {5, 15}, {8, 15}, {5, 15}, {10, 15},
+    {5, 15}, {10, 15}, {8, 15}, {13, 15}, {15, 3}, {12, 15}, {3, 15}, {3, 8},
+};
+
+// BC1 color block, also the color part of BC2 and BC3 which are always in four-color mode
+[[nodiscard]] inline lc_uint4 bc1_decode(const uint8_t *block, lc_uint texel, bool allow_three_color) noexcept {
+    auto c0 = static_cast<lc_uint>(block[0]) | (static_cast<lc_uint>(block[1]) << 8u);
+    auto c1 = static_cast<lc_uint>(block[2]) | (static_cast<lc_uint>(block[3]) << 8u);
+    auto index = (static_cast<lc_uint>(block[4u + texel / 4u]) >> (texel % 4u * 2u)) & 3u;
+    auto expand = [](lc_uint c) noexcept {
+        auto r = (c >> 11u) & 31u;
+        auto g = (c >> 5u) & 63u;
+        auto b = c & 31u;
+        return lc_make_uint4((r << 3u) | (r >> 2u), (g << 2u) | (g >> 4u), (b << 3u) | (b >> 2u), 255u);
+    };
+    auto e0 = expand(c0);
+    auto e1 = expand(c1);
+    if (index == 0u) { return e0; }
+    if (index == 1u) { return e1; }
+    if (allow_three_color && c0 <= c1) {
+        return index == 2u ? (e0 + e1) / 2u : lc_make_uint4(0u);
+    }
+    return index == 2u ? (2u * e0 + e1) / 3u : (e0 + 2u * e1) / 3u;
+}
+
+// BC4 channel block, also the alpha of BC3 and each channel of BC5
+[[nodiscard]] inline lc_uint bc4_decode(const uint8_t *block, lc_uint texel) noexcept {
+    auto bits = bc_load(block, true).lo;
+    auto a0 = static_cast<lc_uint>(bits & 0xffu);
+    auto a1 = static_cast<lc_uint>((bits >> 8u) & 0xffu);
+    auto index = static_cast<lc_uint>(bits >> (16u + 3u * texel)) & 7u;
+    if (index == 0u) { return a0; }
+    if (index == 1u) { return a1; }
+    if (a0 > a1) { return ((8u - index) * a0 + (index - 1u) * a1 + 3u) / 7u; }
+    if (index == 6u) { return 0u; }
+    if (index == 7u) { return 255u; }
+    return ((6u - index) * a0 + (index - 1u) * a1 + 2u) / 5u;
+}
+
+[[nodiscard]] inline lc_uint4 bc7_decode(const uint8_t *block, lc_uint texel) noexcept {
+    struct Mode {
+        uint8_t subsets;
+        uint8_t partition_bits;
+        uint8_t rotation_bits;
+        uint8_t index_selection_bits;
+        uint8_t color_bits;
+        uint8_t alpha_bits;
+        uint8_t endpoint_pbits;
+        uint8_t shared_pbits;
+        uint8_t index_bits;
+        uint8_t secondary_index_bits;
+    };
+    static constexpr const Mode modes[8] = {
+        {3u, 4u, 0u, 0u, 4u, 0u, 1u, 0u, 3u, 0u},
+        {2u, 6u, 0u, 0u, 6u, 0u, 0u, 1u, 3u, 0u},
+        {3u, 6u, 0u, 0u, 5u, 0u, 0u, 0u, 2u, 0u},
+        {2u, 6u, 0u, 0u, 7u, 0u, 1u, 0u, 2u, 0u},
+        {1u, 0u, 2u, 1u, 5u, 6u, 0u, 0u, 2u, 3u},
+        {1u, 0u, 2u, 0u, 7u, 8u, 0u, 0u, 2u, 2u},
+        {1u, 0u, 0u, 0u, 7u, 7u, 1u, 0u, 4u, 0u},
+        {2u, 6u, 0u, 0u, 5u, 5u, 1u, 0u, 2u, 0u}};
+    auto b = bc_load(block, false);
+    if (block[0] == 0u) [[unlikely]] { return lc_make_uint4(0u); }
+    auto mode_index = lc_ctz(static_cast<lc_uint>(block[0]));
+    auto mode = modes[mode_index];
+    auto offset = mode_index + 1u;
+    auto read = [&b, &offset](lc_uint count) noexcept {
+        auto v = b.bits(offset, count);
+        offset += count;
+        return v;
+    };
+    auto partition = read(mode.partition_bits);
+    auto rotation = read(mode.rotation_bits);
+    auto index_selection = read(mode.index_selection_bits);
+    // endpoints[subset * 2 + end]
+    lc_uint4 endpoints[6] = {};
+    auto endpoint_count = mode.subsets * 2u;
+    for (auto c = 0u; c < 3u; c++) {
+        for (auto e = 0u; e < endpoint_count; e++) { endpoints[e][c] = read(mode.color_bits); }
+    }
+    for (auto e = 0u; e < endpoint_count; e++) {
+        endpoints[e][3] = mode.alpha_bits == 0u ? 255u : read(mode.alpha_bits);
+    }
+    auto color_bits = static_cast<lc_uint>(mode.color_bits);
+    auto alpha_bits = static_cast<lc_uint>(mode.alpha_bits);
+    if (mode.endpoint_pbits != 0u || mode.shared_pbits != 0u) {
+        lc_uint pbits[6] = {};
+        if (mode.endpoint_pbits != 0u) {
+            for (auto e = 0u; e < endpoint_count; e++) { pbits[e] = read(1u); }
+        } else {
+            for (auto s = 0u; s < mode.subsets; s++) { pbits[s * 2u] = pbits[s * 2u + 1u] = read(1u); }
+        }
+        for (auto e = 0u; e < endpoint_count; e++) {
+            for (auto c = 0u; c < 3u; c++) { endpoints[e][c] = (endpoints[e][c] << 1u) | pbits[e]; }
+            if (alpha_bits != 0u) { endpoints[e][3] = (endpoints[e][3] << 1u) | pbits[e]; }
+        }
+        color_bits++;
+        if (alpha_bits != 0u) { alpha_bits++; }
+    }
+    for (auto e = 0u; e < endpoint_count; e++) {
+        for (auto c = 0u; c < 3u; c++) {
+            auto v = endpoints[e][c];
+            endpoints[e][c] = (v << (8u - color_bits)) | (v >> (2u * color_bits - 8u));
+        }
+        if (alpha_bits != 0u) {
+            auto v = endpoints[e][3];
+            endpoints[e][3] = (v << (8u - alpha_bits)) | (v >> (2u * alpha_bits - 8u));
+        }
+    }
+    auto subset = 0u;
+    auto anchor1 = 16u;
+    auto anchor2 = 16u;
+    if (mode.subsets == 2u) {
+        subset = (bc_partitions2[partition] >> texel) & 1u;
+        anchor1 = bc_anchors2[partition];
+    } else if (mode.subsets == 3u) {
+        subset = (bc_partitions3[partition] >> (texel * 2u)) & 3u;
+        anchor1 = bc_anchors3[partition][0];
+        anchor2 = bc_anchors3[partition][1];
+    }
+    // anchor texels store their index without its (zero) high bit
+    auto index_at = [&](lc_uint start, lc_uint bits, bool partitioned) noexcept {
+        auto is_anchor = [&](lc_uint t) noexcept {
+            return t == 0u || (partitioned && (t == anchor1 || t == anchor2));
+        };
+        auto p = start;
+        for (auto t = 0u; t < texel; t++) { p += is_anchor(t) ? bits - 1u : bits; }
+        return b.bits(p, is_anchor(texel) ? bits - 1u : bits);
+    };
+    auto index_bits = static_cast<lc_uint>(mode.index_bits);
+    auto color_index = index_at(offset, index_bits, true);
+    auto color_index_bits = index_bits;
+    auto alpha_index = color_index;
+    auto alpha_index_bits = index_bits;
+    if (mode.secondary_index_bits != 0u) {
+        auto secondary_bits = static_cast<lc_uint>(mode.secondary_index_bits);
+        auto secondary = index_at(offset + 16u * index_bits - 1u, secondary_bits, false);
+        if (index_selection == 0u) {
+            alpha_index = secondary;
+            alpha_index_bits = secondary_bits;
+        } else {
+            alpha_index = color_index;
+            alpha_index_bits = index_bits;
+            color_index = secondary;
+            color_index_bits = secondary_bits;
+        }
+    }
+    auto e0 = endpoints[subset * 2u];
+    auto e1 = endpoints[subset * 2u + 1u];
+    auto c = lc_make_uint4(bc_interpolate(e0.x, e1.x, color_index, color_index_bits),
+                           bc_interpolate(e0.y, e1.y, color_index, color_index_bits),
+                           bc_interpolate(e0.z, e1.z, color_index, color_index_bits),
+                           bc_interpolate(e0.w, e1.w, alpha_index, alpha_index_bits));
+    if (rotation != 0u) {
+        auto t = c[rotation - 1u];
+        c[rotation - 1u] = c.w;
+        c.w = t;
+    }
+    return c;
+}
+
+// BC6H header bits: ((endpoint * 3 + channel) << 4 | bit) of each position, 0xff
+// for the mode and partition bits. Rows follow the order of the spec (modes 1-14).
+static constexpr const uint8_t bc6h_header_layout[14][82] = {
+    {0xff, 0xff, 0x74, 0x84, 0xb4, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+     0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31, 0x32, 0x33, 0x34, 0xa4, 0x70,
+     0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0xb0, 0xa0, 0xa1, 0xa2, 0xa3, 0x50,
+     0x51, 0x52, 0x53, 0x54, 0xb1, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63, 0x64,
+     0xb2, 0x90, 0x91, 0x92, 0x93, 0x94, 0xb3, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0x75, 0xa4, 0xa5, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0xb0, 0xb1,
+     0x84, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x85, 0xb2, 0x74, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0xb3, 0xb5, 0xb4, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x70,
+     0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0xa0, 0xa1, 0xa2, 0xa3, 0x50,
+     0x51, 0x52, 0x53, 0x54, 0x55, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63, 0x64,
+     0x65, 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+     0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31, 0x32, 0x33, 0x34, 0x0a, 0x70,
+     0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x1a, 0xb0, 0xa0, 0xa1, 0xa2, 0xa3, 0x50,
+     0x51, 0x52, 0x53, 0x2a, 0xb1, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63, 0x64,
+     0xb2, 0x90, 0x91, 0x92, 0x93, 0x94, 0xb3, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+     0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31, 0x32, 0x33, 0x0a, 0xa4, 0x70,
+     0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0x1a, 0xa0, 0xa1, 0xa2, 0xa3, 0x50,
+     0x51, 0x52, 0x53, 0x2a, 0xb1, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63, 0xb0,
+     0xb2, 0x90, 0x91, 0x92, 0x93, 0x74, 0xb3, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+     0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31, 0x32, 0x33, 0x0a, 0x84, 0x70,
+     0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x1a, 0xb0, 0xa0, 0xa1, 0xa2, 0xa3, 0x50,
+     0x51, 0x52, 0x53, 0x54, 0x2a, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63, 0xb1,
+     0xb2, 0x90, 0x91, 0x92, 0x93, 0xb4, 0xb3, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+     0x84, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x74, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0xb4, 0x30, 0x31, 0x32, 0x33, 0x34, 0xa4, 0x70,
+     0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0xb0, 0xa0, 0xa1, 0xa2, 0xa3, 0x50,
+     0x51, 0x52, 0x53, 0x54, 0xb1, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63, 0x64,
+     0xb2, 0x90, 0x91, 0x92, 0x93, 0x94, 0xb3, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xa4,
+     0x84, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0xb2, 0x74, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0xb3, 0xb4, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x70,
+     0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0xb0, 0xa0, 0xa1, 0xa2, 0xa3, 0x50,
+     0x51, 0x52, 0x53, 0x54, 0xb1, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63, 0x64,
+     0x65, 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xb0,
+     0x84, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x75, 0x74, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0xa5, 0xb4, 0x30, 0x31, 0x32, 0x33, 0x34, 0xa4, 0x70,
+     0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0xa0, 0xa1, 0xa2, 0xa3, 0x50,
+     0x51, 0x52, 0x53, 0x54, 0xb1, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63, 0x64,
+     0xb2, 0x90, 0x91, 0x92, 0x93, 0x94, 0xb3, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xb1,
+     0x84, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x85, 0x74, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0xb5, 0xb4, 0x30, 0x31, 0x32, 0x33, 0x34, 0xa4, 0x70,
+     0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0xb0, 0xa0, 0xa1, 0xa2, 0xa3, 0x50,
+     0x51, 0x52, 0x53, 0x54, 0x55, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63, 0x64,
+     0xb2, 0x90, 0x91, 0x92, 0x93, 0x94, 0xb3, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0xa4, 0xb0, 0xb1,
+     0x84, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x75, 0x85, 0xb2, 0x74, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0xa5, 0xb3, 0xb5, 0xb4, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x70,
+     0x71, 0x72, 0x73, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0xa0, 0xa1, 0xa2, 0xa3, 0x50,
+     0x51, 0x52, 0x53, 0x54, 0x55, 0x80, 0x81, 0x82, 0x83, 0x60, 0x61, 0x62, 0x63, 0x64,
+     0x65, 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+     0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36,
+     0x37, 0x38, 0x39, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x50,
+     0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+     0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36,
+     0x37, 0x38, 0x0a, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x1a, 0x50,
+     0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x2a, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+     0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36,
+     0x37, 0x0b, 0x0a, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x1b, 0x1a, 0x50,
+     0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x2b, 0x2a, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+     0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x20, 0x21, 0x22,
+     0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30, 0x31, 0x32, 0x33, 0x0f, 0x0e, 0x0d,
+     0x0c, 0x0b, 0x0a, 0x40, 0x41, 0x42, 0x43, 0x1f, 0x1e, 0x1d, 0x1c, 0x1b, 0x1a, 0x50,
+     0x51, 0x52, 0x53, 0x2f, 0x2e, 0x2d, 0x2c, 0x2b, 0x2a, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+};
+
+[[nodiscard]] inline lc_float4 bc6h_decode(const uint8_t *block, lc_uint texel) noexcept {
+    static constexpr const uint8_t precisions[14] = {10u, 7u, 11u, 11u, 11u, 9u, 8u, 8u, 8u, 6u, 10u, 11u, 12u, 16u};
+    static constexpr const uint8_t delta_bits[14][3] = {
+        {5u, 5u, 5u}, {6u, 6u, 6u}, {5u, 4u, 4u}, {4u, 5u, 4u}, {4u, 4u, 5u}, {5u, 5u, 5u}, {6u, 5u, 5u},
+        {5u, 6u, 5u}, {5u, 5u, 6u}, {6u, 6u, 6u}, {10u, 10u, 10u}, {9u, 9u, 9u}, {8u, 8u, 8u}, {4u, 4u, 4u}};
+    auto b = bc_load(block, false);
+    auto mode_bits = b.bits(0u, 2u);
+    auto mode = mode_bits;
+    if (mode_bits >= 2u) {
+        mode_bits = b.bits(0u, 5u);
+        auto row = mode_bits >> 2u;
+        if ((mode_bits & 3u) == 2u) {
+            mode = row + 2u;
+        } else if (row < 4u) {
+            mode = row + 10u;
+        } else [[unlikely]] {
+            // reserved modes decode to black
+            return lc_make_float4(0.f, 0.f, 0.f, 1.f);
+        }
+    }
+    auto two_regions = mode < 10u;
+    auto header_bits = two_regions ? 82u : 65u;
+    auto precision = static_cast<lc_uint>(precisions[mode]);
+    lc_uint endpoints[12] = {};
+    for (auto p = 0u; p < header_bits; p++) {
+        auto entry = static_cast<lc_uint>(bc6h_header_layout[mode][p]);
+        if (entry != 0xffu) { endpoints[entry >> 4u] |= b.bits(p, 1u) << (entry & 15u); }
+    }
+    auto endpoint_count = two_regions ? 4u : 2u;
+    auto mask = (1u << precision) - 1u;
+    if (mode != 9u && mode != 10u) {
+        // transformed modes store the other endpoints as signed deltas from the first
+        for (auto e = 1u; e < endpoint_count; e++) {
+            for (auto c = 0u; c < 3u; c++) {
+                auto n = static_cast<lc_uint>(delta_bits[mode][c]);
+                auto delta = static_cast<int>(endpoints[e * 3u + c] << (32u - n)) >> (32u - n);
+                endpoints[e * 3u + c] = static_cast<lc_uint>(static_cast<int>(endpoints[c]) + delta) & mask;
+            }
+        }
+    }
+    for (auto i = 0u; i < endpoint_count * 3u; i++) {
+        auto x = endpoints[i];
+        endpoints[i] = precision >= 15u ? x :
+                       x == 0u          ? 0u :
+                       x == mask        ? 0xffffu :
+                                          ((x << 16u) + 0x8000u) >> precision;
+    }
+    auto region = 0u;
+    auto anchor = 16u;
+    auto index_bits = 4u;
+    if (two_regions) {
+        auto partition = b.bits(77u, 5u);
+        region = (bc_partitions2[partition] >> texel) & 1u;
+        anchor = bc_anchors2[partition];
+        index_bits = 3u;
+    }
+    auto p = header_bits;
+    for (auto t = 0u; t < texel; t++) { p += t == 0u || t == anchor ? index_bits - 1u : index_bits; }
+    auto index = b.bits(p, texel == 0u || texel == anchor ? index_bits - 1u : index_bits);
+    lc_float rgb[3];
+    for (auto c = 0u; c < 3u; c++) {
+        auto e0 = endpoints[region * 6u + c];
+        auto e1 = endpoints[region * 6u + 3u + c];
+        auto h = (bc_interpolate(e0, e1, index, index_bits) * 31u) >> 6u;
+        rgb[c] = static_cast<lc_float>(lc_half::from_bits(static_cast<lc_ushort>(h)));
+    }
+    return lc_make_float4(rgb[0], rgb[1], rgb[2], 1.f);
+}
+
+[[nodiscard]] inline lc_float4 read_block_compressed(LCPixelStorage storage, const uint8_t *block, lc_uint texel) noexcept {
+    auto unorm = [](lc_uint4 v) noexcept { return lc_make_float4(v) * (1.f / 255.f); };
+    switch (storage) {
+        case LC_PIXEL_STORAGE_BC1:
+            return unorm(bc1_decode(block, texel, true));
+        case LC_PIXEL_STORAGE_BC2: {
+            auto c = bc1_decode(block + 8u, texel, false);
+            c.w = ((static_cast<lc_uint>(block[texel / 2u]) >> (texel % 2u * 4u)) & 15u) * 17u;
+            return unorm(c);
+        }
+        case LC_PIXEL_STORAGE_BC3: {
+            auto c = bc1_decode(block + 8u, texel, false);
+            c.w = bc4_decode(block, texel);
+            return unorm(c);
+        }
+        case LC_PIXEL_STORAGE_BC4:
+            return lc_make_float4(bc4_decode(block, texel) * (1.f / 255.f), 0.f, 0.f, 1.f);
+        case LC_PIXEL_STORAGE_BC5:
+            return lc_make_float4(bc4_decode(block, texel) * (1.f / 255.f),
+                                  bc4_decode(block + 8u, texel) * (1.f / 255.f), 0.f, 1.f);
+        case LC_PIXEL_STORAGE_BC6:
+            return bc6h_decode(block, texel);
+        case LC_PIXEL_STORAGE_BC7:
+            return unorm(bc7_decode(block, texel));
+        default:
+            break;
+    }
+    return {};
+}
+
 // MIP-Map EWA filtering LUT from PBRT-v4
 static constexpr const float ewa_filter_weight_lut[] = {
     0.8646647330f, 0.8490400310f, 0.8336595300f, 0.8185192940f, 0.8036156300f, 0.78894478100f, 0.7745032310f,
@@ -358,6 +789,18 @@ struct TextureView {
         return data + (static_cast<size_t>(pixel_index) << pixel_stride_shift);
     }
 
+    // block-compressed textures hold one compressed block per 4x4 block of texels
+    [[nodiscard]] inline auto _block_compressed() const noexcept {
+        return storage >= LC_PIXEL_STORAGE_BC1;
+    }
+
+    [[nodiscard]] inline uint8_t *_block2d(lc_uint2 xy) const noexcept {
+        auto block = xy / block_size;
+        auto grid_width = (width + block_size - 1u) / block_size;
+        auto block_index = grid_width * block.y + block.x;
+        return data + (static_cast<size_t>(block_index) << pixel_stride_shift);
+    }
+
     [[nodiscard]] inline auto _out_of_bounds(lc_uint2 xy) const noexcept {
         return !(xy[0] < width & xy[1] < height);
     }
@@ -369,6 +812,15 @@ struct TextureView {
     template<typename V, typename T>
     [[nodiscard]] inline V read2d(lc_uint2 xy) const noexcept {
         if (_out_of_bounds(xy)) [[unlikely]] { return {}; }
+        if (_block_compressed()) [[unlikely]] {
+            if constexpr (lc_is_same_v<T, float>) {
+                auto pixel = xy % block_size;
+                return detail::read_block_compressed(LCPixelStorage(storage), _block2d(xy),
+                                                     pixel.y * block_size + pixel.x);
+            } else {
+                return {};
+            }
+        }
         return detail::read_pixel<V, T>(LCPixelStorage(storage), _pixel2d(xy));
     }
 
@@ -380,7 +832,8 @@ struct TextureView {
 
     template<typename V, typename T>
     inline void write2d(lc_uint2 xy, V value) const noexcept {
-        if (_out_of_bounds(xy)) [[unlikely]] { return; }
+        // block-compressed textures are read-only in kernels
+        if (_out_of_bounds(xy) || _block_compressed()) [[unlikely]] { return; }
         detail::write_pixel<V, T>(LCPixelStorage(storage), _pixel2d(xy), value);
     }
 
@@ -559,7 +1012,7 @@ texture_sample_point(TextureView view, LCSamplerAddress address, lc_float3 uvw)
 
 [[nodiscard]] inline TextureView lc_texture_view(const Texture *tex, lc_uint level) noexcept {
     auto size = lc_max(lc_make_uint3(tex->width, tex->height, tex->depth) >> level, lc_make_uint3(1u));
-    return TextureView{tex->data + (static_cast<size_t>(tex->mip_offsets[level]) << tex->pixel_stride_shift),
+    return TextureView{tex->data + tex->mip_offsets[level],
                        tex->dimension, size.x, size.y, size.z, tex->storage, tex->pixel_stride_shift};
 }
 
@@ -0,0 +1,77 @@
+// Minimal address-based wait/wake on a 32-bit atomic.
+// Linux uses futex(2) directly; other platforms fall back to a global
+// mutex + condvar, which is correct but wakes every waiter of every word.
+use std::sync::atomic::AtomicU32;
+#[cfg(not(target_os = "linux"))]
+use std::sync::atomic::Ordering;
+
+#[cfg(not(target_os = "linux"))]
+use parking_lot::{const_mutex, Condvar, Mutex};
+
+// Blocks while `word` holds `expected`. May return spuriously.
+pub(super) fn wait(word: &AtomicU32, expected: u32) {
+    #[cfg(target_os = "linux")]
+    unsafe {
+        libc::syscall(
+            libc::SYS_futex,
+            word as *const AtomicU32,
+            libc::FUTEX_WAIT | libc::FUTEX_PRIVATE_FLAG,
+            expected,
+            std::ptr::null::<libc::timespec>(),
+        );
+    }
+    #[cfg(not(target_os = "linux"))]
+    {
+        let mut guard = FALLBACK.0.lock();
+        if word.load(Ordering::Acquire) == expected {
+            FALLBACK.1.wait(&mut guard);
+        }
+    }
+}
+
+pub(super) fn wake_all(word: &AtomicU32) {
+    #[cfg(target_os = "linux")]
+    unsafe {
+        libc::syscall(
+            libc::SYS_futex,
+            word as *const AtomicU32,
+            libc::FUTEX_WAKE | libc::FUTEX_PRIVATE_FLAG,
+            i32::MAX,
+        );
+    }
+    #[cfg(not(target_os = "linux"))]
+    {
+        let _ = word;
+        let _guard = FALLBACK.0.lock();
+        FALLBACK.1.notify_all();
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+static FALLBACK: (Mutex<()>, Condvar) = (const_mutex(()), Condvar::new());
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use std::sync::atomic::Ordering;
+    use std::sync::Arc;
+
+    #[test]
+    fn test_wait_wake() {
+        let word = Arc::new(AtomicU32::new(0));
+        let waiter = {
+            let word = word.clone();
+            std::thread::spawn(move || {
+                while word.load(Ordering::Acquire) == 0 {
+                    wait(&word, 0);
+                }
+            })
+        };
+        std::thread::sleep(std::time::Duration::from_millis(10));
+        word.store(1, Ordering::Release);
+        wake_all(&word);
+        waiter.join().unwrap();
+        // returns immediately if the value already differs
+        wait(&word, 0);
+    }
+}
@@ -0,0 +1,257 @@
+// Allocation of buffer and texture memory on the CPU backend.
+//
+// Large allocations can be backed by huge pages to reduce TLB misses:
+//   - transparent: a 2 MiB aligned anonymous mapping advised with MADV_HUGEPAGE;
+//   - explicit: a MAP_HUGETLB mapping from the preallocated huge page pool,
+//     falling back to transparent huge pages when the pool is exhausted.
+// With first-touch enabled, the pages of a new allocation are touched by the
+// worker threads that will later process the corresponding part of a dispatch,
+// so that the OS places them on the NUMA node of those workers.
+use std::alloc::Layout;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Arc;
+
+use serde::Deserialize;
+
+use super::topology::WorkerGroups;
+
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum HugePages {
+    #[default]
+    None,
+    Transparent,
+    Explicit,
+}
+
+// Configuration of the CPU device, passed as JSON by the frontend (see
+// CpuDeviceConfigExt in luisa/backends/ext/cpu_config_ext.h).
+#[derive(Clone, Debug, Default, Deserialize)]
+#[serde(default)]
+pub struct CpuDeviceConfig {
+    pub huge_pages: HugePages,
+    pub first_touch: bool,
+    pub numa_pinned_workers: bool,
+    pub shader_profile: bool,
+}
+
+const HUGE_PAGE_SIZE: usize = 2 * 1024 * 1024;
+// smaller allocations are neither backed by huge pages nor first-touched
+const LARGE_ALLOCATION_SIZE: usize = HUGE_PAGE_SIZE;
+const PAGE_SIZE: usize = 4096;
+
+enum AllocationKind {
+    Heap(Layout),
+    #[cfg(target_os = "linux")]
+    Mapped,
+}
+
+pub(super) struct HostAllocation {
+    pub(super) ptr: *mut u8,
+    pub(super) size: usize,
+    kind: AllocationKind,
+}
+
+unsafe impl Send for HostAllocation {}
+unsafe impl Sync for HostAllocation {}
+
+impl Drop for HostAllocation {
+    fn drop(&mut self) {
+        unsafe {
+            match self.kind {
+                AllocationKind::Heap(layout) => std::alloc::dealloc(self.ptr, layout),
+                #[cfg(target_os = "linux")]
+                AllocationKind::Mapped => {
+                    libc::munmap(self.ptr as *mut libc::c_void, self.size);
+                }
+            }
+        }
+    }
+}
+
+impl HostAllocation {
+    // zero-initialized heap memory
+    fn heap(size: usize, align: usize) -> Self {
+        let layout = Layout::from_size_align(size.max(1), align).unwrap();
+        let ptr = unsafe { std::alloc::alloc_zeroed(layout) };
+        if ptr.is_null() {
+            std::alloc::handle_alloc_error(layout);
+        }
+        Self {
+            ptr,
+            size: layout.size(),
+            kind: AllocationKind::Heap(layout),
+        }
+    }
+
+    #[cfg(target_os = "linux")]
+    fn huge_pages(size: usize, explicit: bool) -> Option<Self> {
+        let size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        unsafe {
+            let prot = libc::PROT_READ | libc::PROT_WRITE;
+            let flags = libc::MAP_PRIVATE | libc::MAP_ANONYMOUS;
+            if explicit {
+                let ptr = libc::mmap(
+                    std::ptr::null_mut(),
+                    size,
+                    prot,
+                    flags | libc::MAP_HUGETLB,
+                    -1,
+                    0,
+                );
+                if ptr != libc::MAP_FAILED {
+                    return Some(Self {
+                        ptr: ptr as *mut u8,
+                        size,
+                        kind: AllocationKind::Mapped,
+                    });
+                }
+                static WARNED: AtomicBool = AtomicBool::new(false);
+                if !WARNED.swap(true, Ordering::Relaxed) {
+                    log::warn!(
+                        "failed to allocate explicit huge pages ({}), falling back to transparent huge pages",
+                        std::io::Error::last_os_error()
+                    );
+                }
+            }
+            // over-allocate to align the mapping to the huge page size
+            let len = size + HUGE_PAGE_SIZE;
+            let ptr = libc::mmap(std::ptr::null_mut(), len, prot, flags, -1, 0);
+            if ptr == libc::MAP_FAILED {
+                return None;
+            }
+            let base = ptr as usize;
+            let aligned = (base + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            if aligned > base {
+                libc::munmap(ptr, aligned - base);
+            }
+            let tail = base + len - (aligned + size);
+            if tail > 0 {
+                libc::munmap((aligned + size) as *mut libc::c_void, tail);
+            }
+            libc::madvise(aligned as *mut libc::c_void, size, libc::MADV_HUGEPAGE);
+            Some(Self {
+                ptr: aligned as *mut u8,
+                size,
+                kind: AllocationKind::Mapped,
+            })
+        }
+    }
+}
+
+pub(super) struct MemoryPolicy {
+    huge_pages: HugePages,
+    first_touch: bool,
+    pool: Arc<rayon::ThreadPool>,
+    groups: Option<Arc<WorkerGroups>>,
+}
+
+impl MemoryPolicy {
+    pub(super) fn new(
+        config: &CpuDeviceConfig,
+        pool: Arc<rayon::ThreadPool>,
+        groups: Option<Arc<WorkerGroups>>,
+    ) -> Self {
+        if config.huge_pages != HugePages::None && !cfg!(target_os = "linux") {
+            log::warn!("huge pages are only supported on Linux, ignored");
+        }
+        Self {
+            huge_pages: config.huge_pages,
+            first_touch: config.first_touch,
+            pool,
+            groups,
+        }
+    }
+
+    // Allocates zero-initialized memory of at least `size` bytes.
+    pub(super) fn allocate(&self, size: usize, align: usize) -> HostAllocation {
+        if size < LARGE_ALLOCATION_SIZE {
+            return HostAllocation::heap(size, align);
+        }
+        #[cfg(target_os = "linux")]
+        let allocation = match self.huge_pages {
+            HugePages::None => None,
+            HugePages::Transparent => HostAllocation::huge_pages(size, false),
+            HugePages::Explicit => HostAllocation::huge_pages(size, true),
+        };
+        #[cfg(not(target_os = "linux"))]
+        let allocation = None;
+        let allocation = allocation.unwrap_or_else(|| HostAllocation::heap(size, align));
+        if self.first_touch {
+            self.touch(&allocation);
+        }
+        allocation
+    }
+
+    // Writes to every page so that it is placed on the node of the touching thread.
+    // The allocation is zeroed, so writing zeros leaves its content unchanged.
+    fn touch(&self, allocation: &HostAllocation) {
+        let page = match allocation.kind {
+            AllocationKind::Heap(_) => PAGE_SIZE,
+            #[cfg(target_os = "linux")]
+            AllocationKind::Mapped => HUGE_PAGE_SIZE.min(allocation.size),
+        };
+        let ptr = allocation.ptr as usize;
+        let pages = (allocation.size + page - 1) / page;
+        let touch = |i: usize| unsafe {
+            std::ptr::write_volatile((ptr + i * page) as *mut u8, 0);
+        };
+        match &self.groups {
+            // same partition as the blocks of a dispatch
+            Some(groups) => {
+                let block = (64 * 1024 / page).max(1);
+                groups.for_each(&self.pool, pages, block, false, &touch)
+            }
+            // without pinning, give each worker a contiguous slice
+            None => {
+                let threads = self.pool.current_num_threads();
+                self.pool.broadcast(|ctx| {
+                    let begin = pages * ctx.index() / threads;
+                    let end = pages * (ctx.index() + 1) / threads;
+                    (begin..end).for_each(&touch);
+                });
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn test_config_from_json() {
+        let config: CpuDeviceConfig =
+            serde_json::from_str(r#"{"huge_pages":"transparent","first_touch":true}"#).unwrap();
+        assert_eq!(config.huge_pages, HugePages::Transparent);
+        assert!(config.first_touch);
+        assert!(!config.numa_pinned_workers);
+        let config: CpuDeviceConfig = serde_json::from_str("{}").unwrap();
+        assert_eq!(config.huge_pages, HugePages::None);
+    }
+
+    #[test]
+    fn test_allocate() {
+        let pool = Arc::new(
+            rayon::ThreadPoolBuilder::new()
+                .num_threads(4)
+                .build()
+                .unwrap(),
+        );
+        for huge_pages in [HugePages::None, HugePages::Transparent] {
+            let config = CpuDeviceConfig {
+                huge_pages,
+                first_touch: true,
+                numa_pinned_workers: false,
+            };
+            let policy = MemoryPolicy::new(&config, pool.clone(), None);
+            for size in [16, 3 * HUGE_PAGE_SIZE + 5] {
+                let allocation = policy.allocate(size, 16);
+                assert!(allocation.size >= size);
+                assert_eq!(allocation.ptr as usize % 16, 0);
+                let data = unsafe { std::slice::from_raw_parts(allocation.ptr, size) };
+                assert!(data.iter().all(|x| *x == 0));
+            }
+        }
+    }
+}
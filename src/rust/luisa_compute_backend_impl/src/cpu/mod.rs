@@ -4,9 +4,11 @@ use std::sync::{atomic::AtomicBool, Arc};
 
 use self::{
     accel::{AccelImpl, GeometryImpl},
-    resource::{BindlessArrayImpl, BufferImpl, EventImpl},
-    stream::{convert_capture, StreamImpl},
+    resource::{BindlessArrayImpl, BufferImpl, EventImpl, EventStats},
+    stream::{convert_capture, StreamImpl, StreamScheduler},
+    memory::MemoryPolicy,
     texture::TextureImpl,
+    topology::WorkerGroups,
 };
 use super::Backend;
 use crate::{cpu::llvm::LLVM_PATH, SwapChainForCpuContext};
@@ -16,19 +18,77 @@ use libc::c_void;
 use log::debug;
 use luisa_compute_api_types as api;
 use luisa_compute_cpu_kernel_defs as defs;
+use luisa_compute_ir::transform::pass_manager::{clone_module, module_node_count};
+use luisa_compute_ir::transform::{optimization_passes, Transform, TransformPipeline};
 use luisa_compute_ir::{context::type_hash, ir, CArc, transform::luisa_compute_ir_transform_auto};
 use parking_lot::{Condvar, Mutex, RwLock};
 mod codegen;
+mod futex;
 use codegen::sha256_short;
+use profile::{ShaderProfile, ShaderProfiler};
 mod accel;
 mod llvm;
+mod memory;
+mod profile;
 mod resource;
 mod shader;
+#[cfg(unix)]
+mod sparse;
 mod stream;
 mod texture;
+mod topology;
+pub use memory::{CpuDeviceConfig, HugePages};
+// IR optimizations are opt-in for now: LUISA_IR_OPT=1
+fn ir_optimization_enabled() -> bool {
+    match std::env::var("LUISA_IR_OPT") {
+        Ok(s) => s == "1",
+        Err(_) => false,
+    }
+}
+
+// shader creation profiles are recorded only when requested: LUISA_SHADER_PROFILE=1
+fn shader_profile_enabled(config: &CpuDeviceConfig) -> bool {
+    config.shader_profile
+        || match std::env::var("LUISA_SHADER_PROFILE") {
+            Ok(s) => s == "1",
+            Err(_) => false,
+        }
+}
+
+fn optimization_pipeline() -> TransformPipeline {
+    let mut pipeline = TransformPipeline::new();
+    for transform in optimization_passes() {
+        pipeline.add_transform(transform);
+    }
+    pipeline
+}
+
+// note that the passes rewrite the nodes in place, the kernel module is
+// converted from the AST for each shader so nobody else observes the change
+fn optimize_kernel(pipeline: &TransformPipeline, kernel: &ir::KernelModule) -> ir::KernelModule {
+    ir::KernelModule {
+        module: pipeline.transform(clone_module(&kernel.module)),
+        captures: kernel.captures.clone(),
+        args: kernel.args.clone(),
+        shared: kernel.shared.clone(),
+        cpu_custom_ops: kernel.cpu_custom_ops.clone(),
+        block_size: kernel.block_size,
+        pools: kernel.pools.clone(),
+    }
+}
+
 pub struct RustBackend {
     shared_pool: Arc<rayon::ThreadPool>,
+    groups: Option<Arc<WorkerGroups>>,
+    memory: MemoryPolicy,
+    event_stats: Arc<EventStats>,
+    stream_scheduler: Arc<StreamScheduler>,
     swapchain_context: RwLock<Option<Arc<SwapChainForCpuContext>>>,
+    profiler: ShaderProfiler,
+    // shared by all shaders of the device, so that common callables hit its cache
+    optimizer: Mutex<TransformPipeline>,
+    #[cfg(unix)]
+    sparse: Arc<sparse::SparseResources>,
 }
 impl RustBackend {
     pub(crate) unsafe fn set_swapchain_contex(&self, ctx: Arc<SwapChainForCpuContext>) {
@@ -61,7 +121,8 @@ impl Backend for RustBackend {
         } else {
             ty.alignment()
         };
-        let buffer = Box::new(BufferImpl::new(size_bytes, alignment, type_hash(&ty)));
+        let allocation = self.memory.allocate(size_bytes, alignment);
+        let buffer = Box::new(BufferImpl::new(allocation, size_bytes, alignment, type_hash(&ty)));
         let data = buffer.data;
         let ptr = Box::into_raw(buffer);
         CreatedBufferInfo {
@@ -93,6 +154,7 @@ impl Backend for RustBackend {
         let storage = format.storage();
 
         let texture = TextureImpl::new(
+            &self.memory,
             dimension as u8,
             [width, height, depth],
             storage,
@@ -134,7 +196,11 @@ impl Backend for RustBackend {
     }
 
     fn create_stream(&self, _tag: api::StreamTag) -> luisa_compute_api_types::CreatedResourceInfo {
-        let stream = Box::into_raw(Box::new(StreamImpl::new(self.shared_pool.clone())));
+        let stream = Box::into_raw(Box::new(StreamImpl::new(
+            self.shared_pool.clone(),
+            self.groups.clone(),
+            self.stream_scheduler.clone(),
+        )));
         CreatedResourceInfo {
             handle: stream as u64,
             native_handle: stream as *mut std::ffi::c_void,
@@ -266,12 +332,18 @@ impl Backend for RustBackend {
         //     let debug = luisa_compute_ir::serialize::serialize_kernel_module_to_json_str(&kernel);
         //     println!("{}", debug);
         // }
-        let tic = std::time::Instant::now();
-        let mut gened = codegen::cpp::CpuCodeGen::run(&kernel);
-        debug!(
-            "Source generated in {:.3}ms",
-            (std::time::Instant::now() - tic).as_secs_f64() * 1e3
-        );
+        let mut profile = ShaderProfile::new();
+        let optimized;
+        let kernel = if ir_optimization_enabled() {
+            optimized = profile.stage("ir_optimize", || {
+                optimize_kernel(&self.optimizer.lock(), kernel)
+            });
+            &optimized
+        } else {
+            kernel
+        };
+        profile.ir_nodes = module_node_count(&kernel.module);
+        let mut gened = profile.stage("codegen", || codegen::cpp::CpuCodeGen::run(&kernel));
         let args = clang_args();
         let args = args.join(",");
         gened.source.push_str(&format!(
@@ -280,9 +352,14 @@ impl Backend for RustBackend {
         ));
         let hash = sha256_short(&gened.source);
         let gened_src = gened.source.replace("##kernel_fn##", &hash);
+        profile.name = hash.clone();
+        profile.source_bytes = gened_src.len();
         let mut shader = None;
         for tries in 0..2 {
-            let lib_path = shader::compile(&hash, &gened_src, tries == 1).unwrap();
+            let (lib_path, cache_hit) = profile
+                .stage("clang", || shader::compile(&hash, &gened_src, tries == 1))
+                .unwrap();
+            profile.cache_hit = cache_hit;
             let mut captures = vec![];
             let mut custom_ops = vec![];
             unsafe {
@@ -296,14 +373,16 @@ impl Backend for RustBackend {
                     });
                 }
             }
-            shader = shader::ShaderImpl::new(
-                hash.clone(),
-                lib_path,
-                captures,
-                custom_ops,
-                kernel.block_size,
-                &gened.messages,
-            );
+            shader = profile.stage("llvm_jit", || {
+                shader::ShaderImpl::new(
+                    hash.clone(),
+                    lib_path,
+                    captures,
+                    custom_ops,
+                    kernel.block_size,
+                    &gened.messages,
+                )
+            });
             if shader.is_some() {
                 break;
             }
@@ -313,6 +392,10 @@ impl Backend for RustBackend {
                 panic_abort!("Failed to compile kernel. Aborting");
             }
         }
+        for stage in &profile.stages {
+            debug!("Shader {} {}: {:.3}ms", hash, stage.name, stage.duration_us * 1e-3);
+        }
+        self.profiler.record(profile);
         let shader = Box::new(shader.unwrap());
         let shader = Box::into_raw(shader);
         luisa_compute_api_types::CreatedShaderInfo {
@@ -342,7 +425,7 @@ impl Backend for RustBackend {
     }
 
     fn create_event(&self) -> luisa_compute_api_types::CreatedResourceInfo {
-        let event = Box::new(EventImpl::new());
+        let event = Box::new(EventImpl::new(self.event_stats.clone()));
         let event = Box::into_raw(event);
         luisa_compute_api_types::CreatedResourceInfo {
             handle: event as u64,
@@ -373,12 +456,7 @@ impl Backend for RustBackend {
         unsafe {
             let event = &*(event.0 as *mut EventImpl);
             let stream = &*(stream.0 as *mut StreamImpl);
-            stream.enqueue(
-                move || {
-                    event.wait(value);
-                },
-                (empty_callback, std::ptr::null_mut()),
-            );
+            stream.enqueue_wait(event, value);
         }
     }
     fn synchronize_event(&self, event: luisa_compute_api_types::Event, value: u64) {
@@ -452,41 +530,131 @@ impl Backend for RustBackend {
     fn query(&self, property: &str) -> Option<String> {
         match property {
             "device_name" => Some("cpu".to_string()),
+            "shader_profile" => Some(self.profiler.summary_json()),
+            "shader_profile_events" => Some(self.profiler.trace_events_json()),
+            "shader_profile_reset" => {
+                self.profiler.reset();
+                Some(String::new())
+            }
+            "event_latency" => Some(
+                self.event_stats
+                    .json(self.stream_scheduler.driver_threads()),
+            ),
+            "event_latency_reset" => {
+                self.event_stats.reset();
+                Some(String::new())
+            }
+            #[cfg(unix)]
+            "sparse_memory" => Some(self.sparse.stats_json()),
             _ => None,
         }
     }
 }
 impl RustBackend {
-    pub fn new() -> Self {
+    // Creates a buffer that aliases `host_ptr` instead of allocating, so no
+    // upload/download copies are needed on the CPU backend. The caller keeps
+    // ownership of the memory, which must stay valid until the buffer is destroyed.
+    pub(crate) fn import_host_buffer(
+        &self,
+        ty: &CArc<ir::Type>,
+        count: usize,
+        host_ptr: *mut c_void,
+    ) -> CreatedBufferInfo {
+        let (size_bytes, alignment) = if ty == &ir::Type::void() {
+            (count, 1)
+        } else {
+            (ty.size() * count, ty.alignment())
+        };
+        if host_ptr.is_null() {
+            panic_abort!("cannot import null host memory as a buffer");
+        }
+        if (host_ptr as usize) % alignment != 0 {
+            panic_abort!(
+                "host memory {:p} is not aligned to {} bytes as required by {}",
+                host_ptr,
+                alignment,
+                ty.as_ref()
+            );
+        }
+        let buffer = Box::new(unsafe {
+            BufferImpl::from_host(host_ptr as *mut u8, size_bytes, alignment, type_hash(&ty))
+        });
+        let ptr = Box::into_raw(buffer);
+        CreatedBufferInfo {
+            resource: CreatedResourceInfo {
+                handle: ptr as u64,
+                native_handle: host_ptr,
+            },
+            element_stride: ty.size(),
+            total_size_bytes: size_bytes,
+        }
+    }
+    pub fn new(config: &CpuDeviceConfig) -> Self {
         let num_threads = match std::env::var("LUISA_NUM_THREADS") {
             Ok(s) => s.parse::<usize>().unwrap(),
             Err(_) => std::thread::available_parallelism().unwrap().get(),
         };
-
-        RustBackend {
-            shared_pool: Arc::new(
-                rayon::ThreadPoolBuilder::new()
-                    .num_threads(num_threads)
-                    .start_handler(|_| {
-                        #[cfg(target_arch = "x86_64")]
-                        {
-                            unsafe {
-                                use core::arch::x86_64::*;
-                                _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
-                                const _MM_DENORMALS_ZERO_MASK: u32 = 0x0040;
-                                const _MM_DENORMALS_ZERO_ON: u32 = 0x0040;
-                                _mm_setcsr(
-                                    (_mm_getcsr() & !_MM_DENORMALS_ZERO_MASK)
-                                        | (_MM_DENORMALS_ZERO_ON),
-                                );
-                            }
+        let groups = config
+            .numa_pinned_workers
+            .then(|| Arc::new(WorkerGroups::new(&topology::numa_nodes(), num_threads)));
+        if let Some(groups) = &groups {
+            debug!(
+                "pinning {} worker threads to {} NUMA node(s)",
+                num_threads,
+                groups.group_count()
+            );
+        }
+        let shared_pool = Arc::new({
+            let groups = groups.clone();
+            rayon::ThreadPoolBuilder::new()
+                .num_threads(num_threads)
+                .start_handler(move |index| {
+                    if let Some(groups) = &groups {
+                        topology::pin_current_thread(groups.cpu_of(index));
+                    }
+                    #[cfg(target_arch = "x86_64")]
+                    {
+                        unsafe {
+                            use core::arch::x86_64::*;
+                            _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+                            const _MM_DENORMALS_ZERO_MASK: u32 = 0x0040;
+                            const _MM_DENORMALS_ZERO_ON: u32 = 0x0040;
+                            _mm_setcsr(
+                                (_mm_getcsr() & !_MM_DENORMALS_ZERO_MASK)
+                                    | (_MM_DENORMALS_ZERO_ON),
+                            );
                         }
-                    })
-                    .build()
-                    .unwrap(),
-            ),
+                    }
+                })
+                .build()
+                .unwrap()
+        });
+        let event_stats = Arc::new(EventStats::new());
+        RustBackend {
+            memory: MemoryPolicy::new(config, shared_pool.clone(), groups.clone()),
+            stream_scheduler: StreamScheduler::new(event_stats.clone()),
+            event_stats,
+            shared_pool,
+            groups,
             swapchain_context: RwLock::new(None),
+            profiler: ShaderProfiler::new(shader_profile_enabled(config)),
+            optimizer: Mutex::new(optimization_pipeline()),
+            #[cfg(unix)]
+            sparse: Arc::new(sparse::SparseResources::new()),
         }
     }
 }
 extern "C" fn empty_callback(_: *mut u8) {}
+
+// PinnedMemoryExt support, loaded by the C++ frontend of the CPU device
+#[no_mangle]
+pub unsafe extern "C" fn luisa_compute_cpu_import_host_buffer(
+    device: api::Device,
+    ty: *const c_void,
+    count: usize,
+    host_ptr: *mut c_void,
+) -> CreatedBufferInfo {
+    let backend = &*(device.0 as *const RustBackend);
+    let ty = &*(ty as *const CArc<ir::Type>);
+    backend.import_host_buffer(ty, count, host_ptr)
+}
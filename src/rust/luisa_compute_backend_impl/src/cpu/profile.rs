@@ -0,0 +1,220 @@
+// Per-shader compile-time profiling, exposed through `query`:
+//   "shader_profile"        -> JSON array with one summary object per shader
+//   "shader_profile_events" -> JSON array of Chrome trace events ("ph": "X")
+//   "shader_profile_reset"  -> clears the recorded profiles
+// Profiling is opt-in (CpuDeviceConfig::shader_profile or LUISA_SHADER_PROFILE=1).
+// Summaries are aggregated per shader, and only the most recent compilations are
+// kept for the trace, so long-running applications do not accumulate records.
+// Timestamps are microseconds since the UNIX epoch so that events recorded by
+// the frontend can be merged into the same trace.
+use std::collections::hash_map::DefaultHasher;
+use std::collections::VecDeque;
+use std::fmt::Write;
+use std::hash::{Hash, Hasher};
+use std::time::{Instant, SystemTime, UNIX_EPOCH};
+
+use indexmap::IndexMap;
+use parking_lot::Mutex;
+
+// number of shader compilations kept for "shader_profile_events"
+const MAX_TRACED_PROFILES: usize = 256;
+
+pub(crate) struct StageRecord {
+    pub(crate) name: &'static str,
+    pub(crate) start_us: f64,
+    pub(crate) duration_us: f64,
+}
+
+pub(crate) struct ShaderProfile {
+    pub(crate) name: String,
+    pub(crate) thread: u64,
+    pub(crate) stages: Vec<StageRecord>,
+    pub(crate) ir_nodes: usize,
+    pub(crate) source_bytes: usize,
+    pub(crate) cache_hit: bool,
+}
+
+fn now_us() -> f64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .unwrap_or_default()
+        .as_secs_f64()
+        * 1e6
+}
+
+fn current_thread() -> u64 {
+    let mut hasher = DefaultHasher::new();
+    std::thread::current().id().hash(&mut hasher);
+    hasher.finish() & 0xffff_ffff
+}
+
+impl ShaderProfile {
+    pub(crate) fn new() -> Self {
+        Self {
+            name: String::new(),
+            thread: current_thread(),
+            stages: Vec::new(),
+            ir_nodes: 0,
+            source_bytes: 0,
+            cache_hit: false,
+        }
+    }
+    pub(crate) fn stage<T>(&mut self, name: &'static str, f: impl FnOnce() -> T) -> T {
+        let start_us = now_us();
+        let tic = Instant::now();
+        let ret = f();
+        self.stages.push(StageRecord {
+            name,
+            start_us,
+            duration_us: tic.elapsed().as_secs_f64() * 1e6,
+        });
+        ret
+    }
+}
+
+// accumulated over all compilations of a shader
+#[derive(Default)]
+struct ShaderStats {
+    compilations: usize,
+    cache_hits: usize,
+    stages_us: IndexMap<&'static str, f64>,
+    ir_nodes: usize,
+    source_bytes: usize,
+}
+
+#[derive(Default)]
+struct Profiles {
+    stats: IndexMap<String, ShaderStats>,
+    recent: VecDeque<ShaderProfile>,
+}
+
+pub(crate) struct ShaderProfiler {
+    enabled: bool,
+    profiles: Mutex<Profiles>,
+}
+
+impl ShaderProfiler {
+    pub(crate) fn new(enabled: bool) -> Self {
+        Self {
+            enabled,
+            profiles: Mutex::new(Profiles::default()),
+        }
+    }
+    pub(crate) fn record(&self, profile: ShaderProfile) {
+        if !self.enabled {
+            return;
+        }
+        let mut profiles = self.profiles.lock();
+        let stats = profiles.stats.entry(profile.name.clone()).or_default();
+        stats.compilations += 1;
+        stats.cache_hits += profile.cache_hit as usize;
+        for stage in &profile.stages {
+            *stats.stages_us.entry(stage.name).or_default() += stage.duration_us;
+        }
+        stats.ir_nodes = profile.ir_nodes;
+        stats.source_bytes = profile.source_bytes;
+        if profiles.recent.len() == MAX_TRACED_PROFILES {
+            profiles.recent.pop_front();
+        }
+        profiles.recent.push_back(profile);
+    }
+    pub(crate) fn reset(&self) {
+        let mut profiles = self.profiles.lock();
+        profiles.stats.clear();
+        profiles.recent.clear();
+    }
+    pub(crate) fn summary_json(&self) -> String {
+        let profiles = self.profiles.lock();
+        let summary: Vec<_> = profiles
+            .stats
+            .iter()
+            .map(|(name, s)| {
+                let stages: serde_json::Map<_, _> = s
+                    .stages_us
+                    .iter()
+                    .map(|(stage, us)| (stage.to_string(), serde_json::json!(us * 1e-3)))
+                    .collect();
+                serde_json::json!({
+                    "name": name,
+                    "compilations": s.compilations,
+                    "total_ms": s.stages_us.values().sum::<f64>() * 1e-3,
+                    "stages_ms": stages,
+                    "ir_nodes": s.ir_nodes,
+                    "source_bytes": s.source_bytes,
+                    "cache_hits": s.cache_hits,
+                })
+            })
+            .collect();
+        serde_json::to_string(&summary).unwrap()
+    }
+    pub(crate) fn trace_events_json(&self) -> String {
+        let profiles = self.profiles.lock();
+        let mut s = String::from("[");
+        let mut first = true;
+        for p in profiles.recent.iter() {
+            for stage in &p.stages {
+                if !first {
+                    s.push(',');
+                }
+                first = false;
+                write!(
+                    s,
+                    r#"{{"name":"{}","cat":"shader","ph":"X","ts":{:.3},"dur":{:.3},"pid":0,"tid":{},"args":{{"shader":"{}","ir_nodes":{},"source_bytes":{},"cache_hit":{}}}}}"#,
+                    stage.name,
+                    stage.start_us,
+                    stage.duration_us,
+                    p.thread,
+                    p.name,
+                    p.ir_nodes,
+                    p.source_bytes,
+                    p.cache_hit
+                )
+                .unwrap();
+            }
+        }
+        s.push(']');
+        s
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn profile(name: &str, cache_hit: bool) -> ShaderProfile {
+        let mut p = ShaderProfile::new();
+        p.name = name.to_string();
+        p.cache_hit = cache_hit;
+        p.stage("codegen", || ());
+        p.stage("clang", || ());
+        p
+    }
+
+    #[test]
+    fn test_disabled_profiler_records_nothing() {
+        let profiler = ShaderProfiler::new(false);
+        profiler.record(profile("a", false));
+        assert_eq!(profiler.summary_json(), "[]");
+        assert_eq!(profiler.trace_events_json(), "[]");
+    }
+
+    #[test]
+    fn test_profiles_are_aggregated_and_bounded() {
+        let profiler = ShaderProfiler::new(true);
+        for i in 0..MAX_TRACED_PROFILES * 2 {
+            profiler.record(profile(if i % 2 == 0 { "a" } else { "b" }, i >= 2));
+        }
+        let summary: serde_json::Value = serde_json::from_str(&profiler.summary_json()).unwrap();
+        let summary = summary.as_array().unwrap();
+        assert_eq!(summary.len(), 2);
+        assert_eq!(summary[0]["name"], "a");
+        assert_eq!(summary[0]["compilations"], MAX_TRACED_PROFILES);
+        assert_eq!(summary[0]["cache_hits"], MAX_TRACED_PROFILES - 1);
+        assert_eq!(summary[0]["stages_ms"].as_object().unwrap().len(), 2);
+        let events: serde_json::Value =
+            serde_json::from_str(&profiler.trace_events_json()).unwrap();
+        assert_eq!(events.as_array().unwrap().len(), MAX_TRACED_PROFILES * 2);
+        profiler.reset();
+        assert_eq!(profiler.summary_json(), "[]");
+    }
+}
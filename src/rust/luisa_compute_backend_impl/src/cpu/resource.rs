@@ -1,46 +1,153 @@
-use std::{
-    alloc::Layout,
-    sync::atomic::{AtomicU64},
-};
+use std::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+use std::sync::{Arc, OnceLock};
+use std::time::Instant;
 
 use luisa_compute_api_types::{BindlessArrayUpdateModification, BindlessArrayUpdateOperation};
 use luisa_compute_cpu_kernel_defs as defs;
-use parking_lot::{Condvar, Mutex};
+use parking_lot::Mutex;
 
+use super::futex;
+use super::memory::HostAllocation;
 use super::texture::TextureImpl;
 
+// Time since the first call, used to timestamp signals.
+fn now_ns() -> u64 {
+    static START: OnceLock<Instant> = OnceLock::new();
+    START.get_or_init(Instant::now).elapsed().as_nanos() as u64
+}
+
+// Latency between a signal and the wake-up of the waiters it released, for
+// both host threads (synchronize) and parked streams (wait on a stream).
+pub struct EventStats {
+    pub(super) wakes: AtomicU64,
+    pub(super) total_ns: AtomicU64,
+    pub(super) max_ns: AtomicU64,
+    pub(super) parked_waits: AtomicU64,
+}
+
+impl EventStats {
+    pub fn new() -> Self {
+        Self {
+            wakes: AtomicU64::new(0),
+            total_ns: AtomicU64::new(0),
+            max_ns: AtomicU64::new(0),
+            parked_waits: AtomicU64::new(0),
+        }
+    }
+    pub(super) fn record_wake(&self, signaled_at: u64) {
+        let latency = now_ns().saturating_sub(signaled_at);
+        self.wakes.fetch_add(1, Ordering::Relaxed);
+        self.total_ns.fetch_add(latency, Ordering::Relaxed);
+        self.max_ns.fetch_max(latency, Ordering::Relaxed);
+    }
+    pub(super) fn record_park(&self) {
+        self.parked_waits.fetch_add(1, Ordering::Relaxed);
+    }
+    pub fn reset(&self) {
+        self.wakes.store(0, Ordering::Relaxed);
+        self.total_ns.store(0, Ordering::Relaxed);
+        self.max_ns.store(0, Ordering::Relaxed);
+        self.parked_waits.store(0, Ordering::Relaxed);
+    }
+    pub fn json(&self, driver_threads: usize) -> String {
+        let wakes = self.wakes.load(Ordering::Relaxed);
+        let total_ns = self.total_ns.load(Ordering::Relaxed);
+        serde_json::json!({
+            "wakes": wakes,
+            "mean_us": if wakes == 0 { 0.0 } else { total_ns as f64 / wakes as f64 * 1e-3 },
+            "max_us": self.max_ns.load(Ordering::Relaxed) as f64 * 1e-3,
+            "parked_waits": self.parked_waits.load(Ordering::Relaxed),
+            "stream_driver_threads": driver_threads,
+        })
+        .to_string()
+    }
+}
+
+// Called with the timestamp of the releasing signal once the value is reached.
+pub(super) type EventContinuation = Box<dyn FnOnce(u64) + Send>;
+
+// Timeline event. Host threads block on a futex instead of a condvar, and
+// streams do not block at all: they register a continuation and give their
+// driver thread back to the scheduler until the value is reached.
 pub struct EventImpl {
-    pub mutex: Mutex<u64>,
-    pub device: AtomicU64,
-    pub on_signal: Condvar,
+    value: AtomicU64,
+    // bumped by every signal, the word blocked host threads sleep on
+    epoch: AtomicU32,
+    sleepers: AtomicU32,
+    signaled_at: AtomicU64,
+    parked: Mutex<Vec<(u64, EventContinuation)>>,
+    stats: Arc<EventStats>,
 }
 impl EventImpl {
-    pub fn new() -> Self {
+    pub fn new(stats: Arc<EventStats>) -> Self {
         Self {
-            mutex: Mutex::new(0),
-            device: AtomicU64::new(0),
-            on_signal: Condvar::new(),
+            value: AtomicU64::new(0),
+            epoch: AtomicU32::new(0),
+            sleepers: AtomicU32::new(0),
+            signaled_at: AtomicU64::new(0),
+            parked: Mutex::new(Vec::new()),
+            stats,
         }
     }
     pub fn signal(&self, ticket: u64) {
-        let _lk = self.mutex.lock();
-        self.device.fetch_max(ticket, std::sync::atomic::Ordering::SeqCst);
-        self.on_signal.notify_all();
+        self.signaled_at.store(now_ns(), Ordering::SeqCst);
+        let value = self.value.fetch_max(ticket, Ordering::SeqCst).max(ticket);
+        self.epoch.fetch_add(1, Ordering::SeqCst);
+        if self.sleepers.load(Ordering::SeqCst) != 0 {
+            futex::wake_all(&self.epoch);
+        }
+        let released: Vec<_> = {
+            let mut parked = self.parked.lock();
+            if parked.is_empty() {
+                return;
+            }
+            let (released, remaining): (Vec<_>, Vec<_>) = std::mem::take(&mut *parked)
+                .into_iter()
+                .partition(|(t, _)| *t <= value);
+            *parked = remaining;
+            released
+        };
+        let signaled_at = self.signaled_at.load(Ordering::Relaxed);
+        for (_, resume) in released {
+            resume(signaled_at);
+        }
     }
+    // Blocks the calling thread until the value reaches `ticket`.
     pub fn wait(&self, ticket: u64) {
-        let mut lk = self.mutex.lock();
+        if self.is_completed(ticket) {
+            return;
+        }
+        self.sleepers.fetch_add(1, Ordering::SeqCst);
         loop {
-            if self.device.load(std::sync::atomic::Ordering::SeqCst) >= ticket {
+            let epoch = self.epoch.load(Ordering::SeqCst);
+            if self.is_completed(ticket) {
                 break;
             }
-            self.on_signal.wait(&mut lk);
+            futex::wait(&self.epoch, epoch);
         }
+        self.sleepers.fetch_sub(1, Ordering::SeqCst);
+        self.stats.record_wake(self.signaled_at.load(Ordering::Relaxed));
+    }
+    // Registers `resume` to run on the signaling thread once the value reaches
+    // `ticket`. Gives `resume` back if the value has already been reached.
+    pub(super) fn park(
+        &self,
+        ticket: u64,
+        resume: EventContinuation,
+    ) -> Result<(), EventContinuation> {
+        let mut parked = self.parked.lock();
+        if self.is_completed(ticket) {
+            return Err(resume);
+        }
+        parked.push((ticket, resume));
+        self.stats.record_park();
+        Ok(())
     }
     pub fn synchronize(&self, ticket: u64) {
         self.wait(ticket);
     }
     pub fn is_completed(&self, ticket: u64) -> bool {
-        return self.device.load(std::sync::atomic::Ordering::SeqCst) >= ticket;
+        return self.value.load(Ordering::SeqCst) >= ticket;
     }
 }
 #[repr(C)]
@@ -49,6 +156,8 @@ pub struct BufferImpl {
     pub size: usize,
     pub align: usize,
     pub ty: u64,
+    // None if `data` aliases host memory owned by the user
+    allocation: Option<HostAllocation>,
 }
 #[repr(C)]
 pub struct BindlessArrayImpl {
@@ -123,21 +232,23 @@ impl BindlessArrayImpl {
     }
 }
 impl BufferImpl {
-    pub(super) fn new(size: usize, align: usize, ty: u64) -> Self {
-        let layout = Layout::from_size_align(size, align).unwrap();
-        let data = unsafe { std::alloc::alloc_zeroed(layout) };
+    pub(super) fn new(allocation: HostAllocation, size: usize, align: usize, ty: u64) -> Self {
         Self {
-            data,
+            data: allocation.ptr,
             size,
             align,
             ty,
+            allocation: Some(allocation),
         }
     }
-}
-
-impl Drop for BufferImpl {
-    fn drop(&mut self) {
-        let layout = Layout::from_size_align(self.size, self.align).unwrap();
-        unsafe { std::alloc::dealloc(self.data, layout) };
+    // wraps user memory without copying; the memory must outlive the buffer
+    pub(super) unsafe fn from_host(data: *mut u8, size: usize, align: usize, ty: u64) -> Self {
+        Self {
+            data,
+            size,
+            align,
+            ty,
+            allocation: None,
+        }
     }
 }
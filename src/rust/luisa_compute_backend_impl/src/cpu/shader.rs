@@ -72,7 +72,7 @@ pub(super) fn compile(
     target: &String,
     source: &String,
     force_recompile: bool,
-) -> std::io::Result<PathBuf> {
+) -> std::io::Result<(PathBuf, bool)> {
     let self_path = current_exe().map_err(|e| {
         eprintln!("current_exe() failed");
         e
@@ -110,7 +110,7 @@ pub(super) fn compile(
     let lib_path = PathBuf::from(format!("{}/{}", build_dir.display(), target_lib));
     if lib_path.exists() && !force_recompile {
         log::debug!("Loading cached LLVM IR {}", &target_lib);
-        return Ok(lib_path);
+        return Ok((lib_path, true));
     }
     // log::info!("compiling kernel {}", source_file);
     {
@@ -161,7 +161,7 @@ pub(super) fn compile(
             },
         }
 
-        Ok(lib_path)
+        Ok((lib_path, false))
     }
 }
 
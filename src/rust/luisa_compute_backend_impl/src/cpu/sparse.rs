@@ -0,0 +1,955 @@
+// Sparse buffers and textures on the CPU backend.
+//
+// A sparse resource reserves its whole (possibly huge) address range up front
+// without committing memory. Unmapped ranges are mapped to a small scratch memory
+// object shared by all sparse resources, repeated as often as needed, so kernels
+// may access unmapped tiles without faulting: writes land in the scratch memory
+// and are lost, reads return whatever was written there (zeros until then). The
+// scratch memory is mapped in chunks of SCRATCH_SIZE_BYTES, so each reserved
+// chunk costs one memory mapping.
+//
+// Heaps are anonymous shared memory objects whose pages are only committed on
+// first touch. Mapping buffer tiles maps the heap's pages directly into the
+// buffer's address range, so the same heap can back several tiles or resources.
+// Texture tiles are not contiguous in the 4x4(x4) block layout the kernels use,
+// so each page covering mapped tiles is backed by a page handed out from the heap
+// (reference counted, as neighbouring tiles may share pages) and given back when
+// its tiles are unmapped. Since tiles may straddle more pages than their size,
+// texture heaps grow when they run out of pages. Pixels of unmapped tiles that share a page with mapped
+// ones are backed by that page.
+//
+// Tile updates are executed in order on the stream they are submitted to.
+use std::collections::{HashMap, HashSet};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+
+use libc::c_void;
+use luisa_compute_api_types as api;
+use luisa_compute_api_types::{CreatedResourceInfo, PixelStorage};
+use luisa_compute_ir::{context::type_hash, ir, CArc};
+use parking_lot::Mutex;
+
+use super::resource::BufferImpl;
+use super::stream::StreamImpl;
+use super::texture::{TextureImpl, BLOCK_SIZE};
+use super::{empty_callback, RustBackend};
+use crate::panic_abort;
+
+// same as the standard tile size of D3D12/Vulkan sparse resources
+const TILE_SIZE_BYTES: usize = 64 * 1024;
+// size of the scratch memory backing the unmapped ranges
+const SCRATCH_SIZE_BYTES: usize = 32 * 1024 * 1024;
+
+fn page_size() -> usize {
+    unsafe { libc::sysconf(libc::_SC_PAGESIZE) as usize }
+}
+
+fn tile_size_bytes() -> usize {
+    TILE_SIZE_BYTES.max(page_size())
+}
+
+fn align_up(x: usize, alignment: usize) -> usize {
+    (x + alignment - 1) / alignment * alignment
+}
+
+unsafe fn check_mmap(ptr: *mut c_void, what: &str, size: usize) -> *mut u8 {
+    if ptr == libc::MAP_FAILED {
+        panic_abort!(
+            "failed to {} {} bytes of sparse memory: {}",
+            what,
+            size,
+            std::io::Error::last_os_error()
+        );
+    }
+    ptr as *mut u8
+}
+
+unsafe fn reserve(scratch: &SparseHeap, size: usize) -> *mut u8 {
+    let ptr = libc::mmap(
+        std::ptr::null_mut(),
+        size,
+        libc::PROT_NONE,
+        libc::MAP_PRIVATE | libc::MAP_ANONYMOUS | libc::MAP_NORESERVE,
+        -1,
+        0,
+    );
+    let ptr = check_mmap(ptr, "reserve", size);
+    decommit(scratch, ptr, size);
+    ptr
+}
+
+// maps [ptr, ptr + size) to the scratch memory, dropping the pages mapped there
+unsafe fn decommit(scratch: &SparseHeap, ptr: *mut u8, size: usize) {
+    let mut offset = 0;
+    while offset < size {
+        let chunk = (size - offset).min(scratch.size);
+        map_shared(ptr.add(offset), chunk, scratch.fd, 0, "decommit");
+        offset += chunk;
+    }
+}
+
+unsafe fn map_shared(ptr: *mut u8, size: usize, fd: libc::c_int, offset: usize, what: &str) {
+    let ret = libc::mmap(
+        ptr as *mut c_void,
+        size,
+        libc::PROT_READ | libc::PROT_WRITE,
+        libc::MAP_SHARED | libc::MAP_FIXED,
+        fd,
+        offset as libc::off_t,
+    );
+    check_mmap(ret, what, size);
+}
+
+#[cfg(target_os = "linux")]
+unsafe fn create_shared_memory() -> libc::c_int {
+    libc::memfd_create(
+        b"luisa_sparse_heap\0".as_ptr() as *const libc::c_char,
+        libc::MFD_CLOEXEC,
+    )
+}
+
+#[cfg(not(target_os = "linux"))]
+unsafe fn create_shared_memory() -> libc::c_int {
+    static COUNTER: AtomicUsize = AtomicUsize::new(0);
+    let name = format!(
+        "/luisa_sparse_heap_{}_{}\0",
+        std::process::id(),
+        COUNTER.fetch_add(1, Ordering::Relaxed)
+    );
+    let name = name.as_ptr() as *const libc::c_char;
+    let fd = libc::shm_open(name, libc::O_RDWR | libc::O_CREAT | libc::O_EXCL, 0o600);
+    if fd >= 0 {
+        libc::shm_unlink(name);
+    }
+    fd
+}
+
+pub(super) struct SparseHeap {
+    fd: libc::c_int,
+    size: usize,
+    pages: Mutex<HeapPages>,
+}
+
+// pages of a heap handed out to back texture pages
+struct HeapPages {
+    // end of the pages handed out so far
+    used: usize,
+    // size of the memory object
+    capacity: usize,
+    // offsets of the pages given back
+    free: Vec<usize>,
+}
+
+impl SparseHeap {
+    fn new(size: usize) -> Self {
+        let fd = unsafe { create_shared_memory() };
+        if fd < 0 || unsafe { libc::ftruncate(fd, size as libc::off_t) } != 0 {
+            panic_abort!(
+                "failed to allocate sparse heap of {} bytes: {}",
+                size,
+                std::io::Error::last_os_error()
+            );
+        }
+        Self {
+            fd,
+            size,
+            pages: Mutex::new(HeapPages {
+                used: 0,
+                capacity: size,
+                free: Vec::new(),
+            }),
+        }
+    }
+
+    // size of the memory object, including the growth for texture pages
+    fn capacity(&self) -> usize {
+        self.pages.lock().capacity
+    }
+
+    // hands out a page, returns its offset in the heap and the number of bytes the
+    // heap had to grow by
+    fn allocate_page(&self, page_size: usize) -> (usize, usize) {
+        let mut pages = self.pages.lock();
+        if let Some(offset) = pages.free.pop() {
+            return (offset, 0);
+        }
+        let offset = pages.used;
+        pages.used += page_size;
+        if pages.used <= pages.capacity {
+            return (offset, 0);
+        }
+        let capacity = align_up(pages.used, tile_size_bytes());
+        if unsafe { libc::ftruncate(self.fd, capacity as libc::off_t) } != 0 {
+            panic_abort!(
+                "failed to grow sparse heap to {} bytes: {}",
+                capacity,
+                std::io::Error::last_os_error()
+            );
+        }
+        let grown = capacity - pages.capacity;
+        pages.capacity = capacity;
+        (offset, grown)
+    }
+
+    fn free_page(&self, offset: usize) {
+        self.pages.lock().free.push(offset);
+    }
+}
+
+impl Drop for SparseHeap {
+    fn drop(&mut self) {
+        // pages still mapped into resources stay alive until they are unmapped
+        unsafe { libc::close(self.fd) };
+    }
+}
+
+struct SparseBuffer {
+    data: *mut u8,
+    reserved: usize,
+    tile_size: usize,
+    mapped: Vec<bool>,
+}
+
+struct SparseTexture {
+    texture: *const TextureImpl,
+    reserved: usize,
+    tile_size: [u32; 3],
+    tile_size_bytes: usize,
+    mapped: HashSet<(u32, [u32; 3])>,
+    pages: HashMap<usize, TexturePage>,
+}
+
+// a heap page backing a page of a sparse texture
+struct TexturePage {
+    refs: u32,
+    heap: Arc<SparseHeap>,
+    offset: usize,
+}
+
+unsafe impl Send for SparseBuffer {}
+unsafe impl Sync for SparseBuffer {}
+unsafe impl Send for SparseTexture {}
+unsafe impl Sync for SparseTexture {}
+
+// mirrored in rust_device_common.cpp
+#[repr(u32)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum SparseUpdateKind {
+    BufferMap,
+    BufferUnmap,
+    TextureMap,
+    TextureUnmap,
+}
+
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct SparseUpdate {
+    pub resource: u64,
+    pub heap: u64,
+    pub kind: SparseUpdateKind,
+    pub mip_level: u32,
+    pub start_tile: [u32; 3],
+    pub tile_count: [u32; 3],
+}
+
+#[repr(C)]
+pub struct CreatedSparseResourceInfo {
+    pub resource: CreatedResourceInfo,
+    pub element_stride: usize,
+    pub total_size_bytes: usize,
+    pub tile_size_bytes: usize,
+    pub tile_size: [u32; 3],
+}
+
+#[repr(C)]
+pub struct SparseResourceInterface {
+    pub create_buffer:
+        unsafe extern "C" fn(api::Device, *const c_void, usize) -> CreatedSparseResourceInfo,
+    pub destroy_buffer: unsafe extern "C" fn(api::Device, u64),
+    pub create_texture: unsafe extern "C" fn(
+        api::Device,
+        api::PixelFormat,
+        u32,
+        u32,
+        u32,
+        u32,
+        u32,
+    ) -> CreatedSparseResourceInfo,
+    pub destroy_texture: unsafe extern "C" fn(api::Device, u64),
+    pub allocate_heap: unsafe extern "C" fn(api::Device, usize) -> CreatedResourceInfo,
+    pub deallocate_heap: unsafe extern "C" fn(api::Device, u64),
+    pub update: unsafe extern "C" fn(api::Device, api::Stream, *const SparseUpdate, usize),
+}
+
+pub(super) struct SparseResources {
+    scratch: SparseHeap,
+    buffers: Mutex<HashMap<u64, SparseBuffer>>,
+    textures: Mutex<HashMap<u64, SparseTexture>>,
+    heaps: Mutex<HashMap<u64, Arc<SparseHeap>>>,
+    next_heap: AtomicUsize,
+    // address space reserved by sparse resources
+    reserved_bytes: AtomicUsize,
+    // memory allocated for heaps
+    heap_bytes: AtomicUsize,
+    // address space currently backed by memory
+    mapped_bytes: AtomicUsize,
+}
+
+fn texture_tile_size(dimension: u32, storage: PixelStorage) -> [u32; 3] {
+    let pixels = TILE_SIZE_BYTES / storage.size();
+    let k = pixels.trailing_zeros();
+    if dimension == 2 {
+        [1 << ((k + 1) / 2), 1 << (k / 2), 1]
+    } else {
+        [1 << ((k + 2) / 3), 1 << ((k + 1) / 3), 1 << (k / 3)]
+    }
+}
+
+// Appends the indices of the pages holding the pixels of a texture tile.
+fn texture_tile_pages(
+    texture: &TextureImpl,
+    tile_size: [u32; 3],
+    level: u32,
+    tile: [u32; 3],
+    page_size: usize,
+    pages: &mut Vec<usize>,
+) {
+    let b = BLOCK_SIZE as u32;
+    let size = [
+        (texture.size[0] >> level).max(1),
+        (texture.size[1] >> level).max(1),
+        (texture.size[2] >> level).max(1),
+    ];
+    let mut lo = [0u32; 3];
+    let mut hi = [0u32; 3];
+    for i in 0..3 {
+        let begin = tile[i] * tile_size[i];
+        if begin >= size[i] {
+            return;
+        }
+        let end = (begin + tile_size[i]).min(size[i]);
+        lo[i] = begin / b;
+        hi[i] = (end + b - 1) / b;
+    }
+    let grid_width = ((size[0] + b - 1) / b) as usize;
+    let grid_height = ((size[1] + b - 1) / b) as usize;
+    let pixels_per_block = if texture.dimension == 2 {
+        BLOCK_SIZE * BLOCK_SIZE
+    } else {
+        BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE
+    };
+    let block_bytes = pixels_per_block << texture.pixel_stride_shift;
+    let offset = texture.mip_offsets[level as usize];
+    // blocks of a tile in the same block row are contiguous
+    for bz in lo[2]..hi[2] {
+        for by in lo[1]..hi[1] {
+            let row = bz as usize * grid_width * grid_height + by as usize * grid_width;
+            let begin = offset + (row + lo[0] as usize) * block_bytes;
+            let end = offset + (row + hi[0] as usize) * block_bytes;
+            pages.extend(begin / page_size..(end + page_size - 1) / page_size);
+        }
+    }
+}
+
+// calls `f(first_page, page_count)` for each run of consecutive pages
+fn for_each_page_run(pages: &mut Vec<usize>, mut f: impl FnMut(usize, usize)) {
+    pages.sort_unstable();
+    pages.dedup();
+    let mut i = 0;
+    while i < pages.len() {
+        let mut j = i + 1;
+        while j < pages.len() && pages[j] == pages[j - 1] + 1 {
+            j += 1;
+        }
+        f(pages[i], j - i);
+        i = j;
+    }
+}
+
+impl SparseResources {
+    pub(super) fn new() -> Self {
+        Self {
+            scratch: SparseHeap::new(align_up(SCRATCH_SIZE_BYTES, tile_size_bytes())),
+            buffers: Mutex::new(HashMap::new()),
+            textures: Mutex::new(HashMap::new()),
+            heaps: Mutex::new(HashMap::new()),
+            next_heap: AtomicUsize::new(1),
+            reserved_bytes: AtomicUsize::new(0),
+            heap_bytes: AtomicUsize::new(0),
+            mapped_bytes: AtomicUsize::new(0),
+        }
+    }
+
+    pub(super) fn stats_json(&self) -> String {
+        serde_json::json!({
+            "reserved_bytes": self.reserved_bytes.load(Ordering::Relaxed),
+            "scratch_bytes": self.scratch.size,
+            "heap_bytes": self.heap_bytes.load(Ordering::Relaxed),
+            "mapped_bytes": self.mapped_bytes.load(Ordering::Relaxed),
+        })
+        .to_string()
+    }
+
+    pub(super) fn create_buffer(&self, ty: &CArc<ir::Type>, count: usize) -> CreatedSparseResourceInfo {
+        let (size_bytes, alignment) = if ty == &ir::Type::void() {
+            (count, 16)
+        } else {
+            (ty.size() * count, ty.alignment())
+        };
+        let tile_size = tile_size_bytes();
+        let reserved = align_up(size_bytes.max(1), tile_size);
+        let data = unsafe { reserve(&self.scratch, reserved) };
+        let buffer = Box::new(unsafe {
+            BufferImpl::from_host(data, size_bytes, alignment, type_hash(ty))
+        });
+        let handle = Box::into_raw(buffer) as u64;
+        self.buffers.lock().insert(
+            handle,
+            SparseBuffer {
+                data,
+                reserved,
+                tile_size,
+                mapped: vec![false; reserved / tile_size],
+            },
+        );
+        self.reserved_bytes.fetch_add(reserved, Ordering::Relaxed);
+        CreatedSparseResourceInfo {
+            resource: CreatedResourceInfo {
+                handle,
+                native_handle: data as *mut c_void,
+            },
+            element_stride: ty.size(),
+            total_size_bytes: size_bytes,
+            tile_size_bytes: tile_size,
+            tile_size: [0; 3],
+        }
+    }
+
+    pub(super) fn destroy_buffer(&self, handle: u64) {
+        let Some(buffer) = self.buffers.lock().remove(&handle) else {
+            panic_abort!("invalid sparse buffer handle {:#x}", handle);
+        };
+        let mapped = buffer.mapped.iter().filter(|m| **m).count() * buffer.tile_size;
+        unsafe {
+            libc::munmap(buffer.data as *mut c_void, buffer.reserved);
+            drop(Box::from_raw(handle as *mut BufferImpl));
+        }
+        self.mapped_bytes.fetch_sub(mapped, Ordering::Relaxed);
+        self.reserved_bytes.fetch_sub(buffer.reserved, Ordering::Relaxed);
+    }
+
+    pub(super) fn create_texture(
+        &self,
+        format: api::PixelFormat,
+        dimension: u32,
+        width: u32,
+        height: u32,
+        depth: u32,
+        mipmap_levels: u32,
+    ) -> CreatedSparseResourceInfo {
+        let storage = format.storage();
+        assert!(
+            !storage.is_block_compressed(),
+            "Sparse block-compressed textures are not supported."
+        );
+        let page_size = page_size();
+        let size = [width, height, depth];
+        let levels = mipmap_levels as u8;
+        let (mip_offsets, data_size) =
+            TextureImpl::mip_layout(dimension as u8, size, storage, levels, page_size);
+        let reserved = align_up(data_size.max(1), page_size);
+        let data = unsafe { reserve(&self.scratch, reserved) };
+        let texture = Box::new(unsafe {
+            TextureImpl::from_raw(
+                data,
+                dimension as u8,
+                size,
+                storage,
+                levels,
+                mip_offsets,
+                data_size,
+                None,
+            )
+        });
+        let tile_size = texture_tile_size(dimension, storage);
+        let tile_size_bytes = tile_size.iter().map(|s| *s as usize).product::<usize>() * storage.size();
+        let texture = Box::into_raw(texture);
+        let handle = texture as u64;
+        self.textures.lock().insert(
+            handle,
+            SparseTexture {
+                texture,
+                reserved,
+                tile_size,
+                tile_size_bytes,
+                mapped: HashSet::new(),
+                pages: HashMap::new(),
+            },
+        );
+        self.reserved_bytes.fetch_add(reserved, Ordering::Relaxed);
+        CreatedSparseResourceInfo {
+            resource: CreatedResourceInfo {
+                handle,
+                native_handle: data as *mut c_void,
+            },
+            element_stride: storage.size(),
+            total_size_bytes: data_size,
+            tile_size_bytes,
+            tile_size,
+        }
+    }
+
+    pub(super) fn destroy_texture(&self, handle: u64) {
+        let Some(sparse) = self.textures.lock().remove(&handle) else {
+            panic_abort!("invalid sparse texture handle {:#x}", handle);
+        };
+        let mapped = sparse.pages.len() * page_size();
+        unsafe {
+            let texture = Box::from_raw(sparse.texture as *mut TextureImpl);
+            libc::munmap(texture.data as *mut c_void, sparse.reserved);
+        }
+        for page in sparse.pages.values() {
+            page.heap.free_page(page.offset);
+        }
+        self.mapped_bytes.fetch_sub(mapped, Ordering::Relaxed);
+        self.reserved_bytes.fetch_sub(sparse.reserved, Ordering::Relaxed);
+    }
+
+    pub(super) fn allocate_heap(&self, size: usize) -> CreatedResourceInfo {
+        let size = align_up(size.max(1), page_size());
+        let handle = self.next_heap.fetch_add(1, Ordering::Relaxed) as u64;
+        self.heaps.lock().insert(handle, Arc::new(SparseHeap::new(size)));
+        self.heap_bytes.fetch_add(size, Ordering::Relaxed);
+        CreatedResourceInfo {
+            handle,
+            native_handle: std::ptr::null_mut(),
+        }
+    }
+
+    pub(super) fn deallocate_heap(&self, handle: u64) {
+        let Some(heap) = self.heaps.lock().remove(&handle) else {
+            panic_abort!("invalid sparse heap handle {}", handle);
+        };
+        self.heap_bytes.fetch_sub(heap.capacity(), Ordering::Relaxed);
+    }
+
+    fn heap(&self, handle: u64) -> Arc<SparseHeap> {
+        match self.heaps.lock().get(&handle) {
+            Some(heap) => heap.clone(),
+            None => panic_abort!("invalid sparse heap handle {}", handle),
+        }
+    }
+
+    fn map_buffer_tiles(&self, update: &SparseUpdate, heap: &SparseHeap) {
+        let mut buffers = self.buffers.lock();
+        let Some(buffer) = buffers.get_mut(&update.resource) else {
+            panic_abort!("invalid sparse buffer handle {:#x}", update.resource);
+        };
+        let start = update.start_tile[0] as usize;
+        let count = update.tile_count[0] as usize;
+        let size = count * buffer.tile_size;
+        if start + count > buffer.mapped.len() || size > heap.size {
+            panic_abort!(
+                "cannot map tiles [{}, {}) of a sparse buffer with {} tiles from a heap of {} bytes",
+                start,
+                start + count,
+                buffer.mapped.len(),
+                heap.size
+            );
+        }
+        unsafe {
+            map_shared(buffer.data.add(start * buffer.tile_size), size, heap.fd, 0, "map");
+        }
+        let newly_mapped = buffer.mapped[start..start + count]
+            .iter_mut()
+            .map(|m| !std::mem::replace(m, true) as usize)
+            .sum::<usize>();
+        self.mapped_bytes
+            .fetch_add(newly_mapped * buffer.tile_size, Ordering::Relaxed);
+    }
+
+    fn unmap_buffer_tiles(&self, update: &SparseUpdate) {
+        let mut buffers = self.buffers.lock();
+        let Some(buffer) = buffers.get_mut(&update.resource) else {
+            panic_abort!("invalid sparse buffer handle {:#x}", update.resource);
+        };
+        let start = update.start_tile[0] as usize;
+        let end = (start + update.tile_count[0] as usize).min(buffer.mapped.len());
+        if start >= end {
+            return;
+        }
+        unsafe {
+            decommit(
+                &self.scratch,
+                buffer.data.add(start * buffer.tile_size),
+                (end - start) * buffer.tile_size,
+            );
+        }
+        let unmapped = buffer.mapped[start..end]
+            .iter_mut()
+            .map(|m| std::mem::replace(m, false) as usize)
+            .sum::<usize>();
+        self.mapped_bytes
+            .fetch_sub(unmapped * buffer.tile_size, Ordering::Relaxed);
+    }
+
+    fn for_each_texture_tile(texture: &TextureImpl, update: &SparseUpdate, mut f: impl FnMut([u32; 3])) {
+        let mut count = update.tile_count;
+        if texture.dimension == 2 {
+            count[2] = 1;
+        }
+        for z in 0..count[2] {
+            for y in 0..count[1] {
+                for x in 0..count[0] {
+                    f([
+                        update.start_tile[0] + x,
+                        update.start_tile[1] + y,
+                        update.start_tile[2] + z,
+                    ]);
+                }
+            }
+        }
+    }
+
+    fn map_texture_tiles(&self, update: &SparseUpdate, heap: &Arc<SparseHeap>) {
+        let mut textures = self.textures.lock();
+        let Some(sparse) = textures.get_mut(&update.resource) else {
+            panic_abort!("invalid sparse texture handle {:#x}", update.resource);
+        };
+        let texture = unsafe { &*sparse.texture };
+        if update.mip_level >= texture.mip_levels as u32 {
+            panic_abort!(
+                "cannot map tiles of mip level {} of a sparse texture with {} levels",
+                update.mip_level,
+                texture.mip_levels
+            );
+        }
+        let page_size = page_size();
+        let mut tiles = 0;
+        let mut pages = Vec::new();
+        Self::for_each_texture_tile(texture, update, |tile| {
+            tiles += 1;
+            if sparse.mapped.insert((update.mip_level, tile)) {
+                texture_tile_pages(texture, sparse.tile_size, update.mip_level, tile, page_size, &mut pages);
+            }
+        });
+        if tiles * sparse.tile_size_bytes > heap.size {
+            panic_abort!(
+                "cannot map {} tiles of {} bytes from a sparse heap of {} bytes",
+                tiles,
+                sparse.tile_size_bytes,
+                heap.size
+            );
+        }
+        // a page may be listed once per tile touching it
+        pages.sort_unstable();
+        let mut committed = Vec::new();
+        for page in pages {
+            if let Some(p) = sparse.pages.get_mut(&page) {
+                p.refs += 1;
+                continue;
+            }
+            let (offset, grown) = heap.allocate_page(page_size);
+            self.heap_bytes.fetch_add(grown, Ordering::Relaxed);
+            sparse.pages.insert(
+                page,
+                TexturePage {
+                    refs: 1,
+                    heap: heap.clone(),
+                    offset,
+                },
+            );
+            committed.push((page, offset));
+        }
+        self.mapped_bytes
+            .fetch_add(committed.len() * page_size, Ordering::Relaxed);
+        // map runs of pages that are consecutive in both the texture and the heap at once
+        let mut i = 0;
+        while i < committed.len() {
+            let (first, offset) = committed[i];
+            let mut j = i + 1;
+            while j < committed.len() && committed[j] == (first + (j - i), offset + (j - i) * page_size) {
+                j += 1;
+            }
+            unsafe {
+                map_shared(texture.data.add(first * page_size), (j - i) * page_size, heap.fd, offset, "map");
+            }
+            i = j;
+        }
+    }
+
+    fn unmap_texture_tiles(&self, update: &SparseUpdate) {
+        let mut textures = self.textures.lock();
+        let Some(sparse) = textures.get_mut(&update.resource) else {
+            panic_abort!("invalid sparse texture handle {:#x}", update.resource);
+        };
+        let texture = unsafe { &*sparse.texture };
+        let page_size = page_size();
+        let mut pages = Vec::new();
+        Self::for_each_texture_tile(texture, update, |tile| {
+            if sparse.mapped.remove(&(update.mip_level, tile)) {
+                texture_tile_pages(texture, sparse.tile_size, update.mip_level, tile, page_size, &mut pages);
+            }
+        });
+        let mut released = Vec::new();
+        for page in pages {
+            let p = sparse.pages.get_mut(&page).unwrap();
+            p.refs -= 1;
+            if p.refs == 0 {
+                let p = sparse.pages.remove(&page).unwrap();
+                p.heap.free_page(p.offset);
+                released.push(page);
+            }
+        }
+        self.mapped_bytes
+            .fetch_sub(released.len() * page_size, Ordering::Relaxed);
+        for_each_page_run(&mut released, |first, count| unsafe {
+            decommit(&self.scratch, texture.data.add(first * page_size), count * page_size);
+        });
+    }
+
+    fn apply(&self, update: &SparseUpdate, heap: Option<&Arc<SparseHeap>>) {
+        match update.kind {
+            SparseUpdateKind::BufferMap => self.map_buffer_tiles(update, heap.unwrap()),
+            SparseUpdateKind::BufferUnmap => self.unmap_buffer_tiles(update),
+            SparseUpdateKind::TextureMap => self.map_texture_tiles(update, heap.unwrap()),
+            SparseUpdateKind::TextureUnmap => self.unmap_texture_tiles(update),
+        }
+    }
+
+    pub(super) fn update(self: &Arc<Self>, stream: &'static StreamImpl, updates: &[SparseUpdate]) {
+        // resolve the heaps now, so that they may be deallocated right after submission
+        let updates: Vec<_> = updates
+            .iter()
+            .map(|u| {
+                let heap = match u.kind {
+                    SparseUpdateKind::BufferMap | SparseUpdateKind::TextureMap => Some(self.heap(u.heap)),
+                    _ => None,
+                };
+                (*u, heap)
+            })
+            .collect();
+        let resources = self.clone();
+        stream.enqueue(
+            move || {
+                for (update, heap) in &updates {
+                    resources.apply(update, heap.as_ref());
+                }
+            },
+            (empty_callback, std::ptr::null_mut()),
+        );
+    }
+}
+
+unsafe fn backend(device: api::Device) -> &'static RustBackend {
+    &*(device.0 as *const RustBackend)
+}
+
+unsafe extern "C" fn create_buffer(
+    device: api::Device,
+    ty: *const c_void,
+    count: usize,
+) -> CreatedSparseResourceInfo {
+    let ty = &*(ty as *const CArc<ir::Type>);
+    backend(device).sparse.create_buffer(ty, count)
+}
+
+unsafe extern "C" fn destroy_buffer(device: api::Device, handle: u64) {
+    backend(device).sparse.destroy_buffer(handle)
+}
+
+unsafe extern "C" fn create_texture(
+    device: api::Device,
+    format: api::PixelFormat,
+    dimension: u32,
+    width: u32,
+    height: u32,
+    depth: u32,
+    mipmap_levels: u32,
+) -> CreatedSparseResourceInfo {
+    backend(device)
+        .sparse
+        .create_texture(format, dimension, width, height, depth, mipmap_levels)
+}
+
+unsafe extern "C" fn destroy_texture(device: api::Device, handle: u64) {
+    backend(device).sparse.destroy_texture(handle)
+}
+
+unsafe extern "C" fn allocate_heap(device: api::Device, size: usize) -> CreatedResourceInfo {
+    backend(device).sparse.allocate_heap(size)
+}
+
+unsafe extern "C" fn deallocate_heap(device: api::Device, handle: u64) {
+    backend(device).sparse.deallocate_heap(handle)
+}
+
+unsafe extern "C" fn update(
+    device: api::Device,
+    stream: api::Stream,
+    updates: *const SparseUpdate,
+    count: usize,
+) {
+    let stream = &*(stream.0 as *const StreamImpl);
+    let updates = std::slice::from_raw_parts(updates, count);
+    backend(device).sparse.update(stream, updates)
+}
+
+// Sparse resource support, loaded by the C++ frontend of the CPU device
+#[no_mangle]
+pub extern "C" fn luisa_compute_cpu_sparse_resource_interface() -> SparseResourceInterface {
+    SparseResourceInterface {
+        create_buffer,
+        destroy_buffer,
+        create_texture,
+        destroy_texture,
+        allocate_heap,
+        deallocate_heap,
+        update,
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn test_texture_tile_pages() {
+        let page_size = 4096;
+        let storage = PixelStorage::Byte4;
+        let size = [1024, 1024, 1];
+        let (mip_offsets, data_size) = TextureImpl::mip_layout(2, size, storage, 2, page_size);
+        assert_eq!(mip_offsets[1] % page_size, 0);
+        let texture = unsafe {
+            TextureImpl::from_raw(
+                std::ptr::null_mut(),
+                2,
+                size,
+                storage,
+                2,
+                mip_offsets,
+                data_size,
+                None,
+            )
+        };
+        let tile_size = texture_tile_size(2, storage);
+        assert_eq!(tile_size, [128, 128, 1]);
+        // 32 block rows of 32 blocks, each row spanning half a page
+        let mut pages = Vec::new();
+        texture_tile_pages(&texture, tile_size, 0, [0, 0, 0], page_size, &mut pages);
+        assert_eq!(pages.len(), 32);
+        // tiles (0, 0) and (1, 0) share their pages
+        let mut neighbour = Vec::new();
+        texture_tile_pages(&texture, tile_size, 0, [1, 0, 0], page_size, &mut neighbour);
+        assert_eq!(pages, neighbour);
+        // a tile of the second level starts past the first level
+        let mut level1 = Vec::new();
+        texture_tile_pages(&texture, tile_size, 1, [0, 0, 0], page_size, &mut level1);
+        assert!(level1.iter().all(|p| p * page_size >= mip_offsets[1]));
+        // tiles past the end of a level cover nothing
+        let mut outside = Vec::new();
+        texture_tile_pages(&texture, tile_size, 1, [4, 0, 0], page_size, &mut outside);
+        assert!(outside.is_empty());
+    }
+
+    fn tile_update(resource: u64, kind: SparseUpdateKind, start_tile: [u32; 3]) -> SparseUpdate {
+        SparseUpdate {
+            resource,
+            heap: 0,
+            kind,
+            mip_level: 0,
+            start_tile,
+            tile_count: [1, 1, 1],
+        }
+    }
+
+    #[test]
+    fn test_unmapped_buffer_tiles_discard_writes() {
+        let resources = SparseResources::new();
+        let tile_size = tile_size_bytes();
+        let size = 16 * tile_size;
+        let buffer = resources.create_buffer(&ir::Type::void(), size);
+        let handle = buffer.resource.handle;
+        let data = buffer.resource.native_handle as *mut u8;
+        let heap_handle = resources.allocate_heap(tile_size).handle;
+        let heap = resources.heap(heap_handle);
+        resources.map_buffer_tiles(&tile_update(handle, SparseUpdateKind::BufferMap, [3, 0, 0]), &heap);
+        unsafe {
+            let tile = std::slice::from_raw_parts_mut(data.add(3 * tile_size), tile_size);
+            tile.fill(0x5a);
+            // writes to the unmapped tiles must neither fault nor reach the mapped one
+            std::ptr::write_bytes(data, 0xab, 3 * tile_size);
+            std::ptr::write_bytes(data.add(4 * tile_size), 0xab, size - 4 * tile_size);
+            assert!(tile.iter().all(|b| *b == 0x5a));
+        }
+        // the heap keeps the data, so mapping it to another tile shows it
+        resources.map_buffer_tiles(&tile_update(handle, SparseUpdateKind::BufferMap, [7, 0, 0]), &heap);
+        resources.unmap_buffer_tiles(&tile_update(handle, SparseUpdateKind::BufferUnmap, [3, 0, 0]));
+        unsafe {
+            let tile = std::slice::from_raw_parts(data.add(7 * tile_size), tile_size);
+            assert!(tile.iter().all(|b| *b == 0x5a));
+            std::ptr::write_bytes(data, 0xcd, 7 * tile_size);
+            assert!(tile.iter().all(|b| *b == 0x5a));
+        }
+        resources.destroy_buffer(handle);
+        resources.deallocate_heap(heap_handle);
+    }
+
+    #[test]
+    fn test_unmapped_texture_tiles_discard_writes() {
+        let resources = SparseResources::new();
+        let page_size = page_size();
+        let texture = resources.create_texture(api::PixelFormat::Rgba8Unorm, 2, 1024, 1024, 1, 1);
+        let handle = texture.resource.handle;
+        let data = texture.resource.native_handle as *mut u8;
+        let size = texture.total_size_bytes;
+        let heap_handle = resources.allocate_heap(texture.tile_size_bytes).handle;
+        let heap = resources.heap(heap_handle);
+        let heap_bytes = resources.heap_bytes.load(Ordering::Relaxed);
+        resources.map_texture_tiles(&tile_update(handle, SparseUpdateKind::TextureMap, [2, 2, 0]), &heap);
+        let mut pages = Vec::new();
+        {
+            let textures = resources.textures.lock();
+            let sparse = &textures[&handle];
+            let texture = unsafe { &*sparse.texture };
+            texture_tile_pages(texture, sparse.tile_size, 0, [2, 2, 0], page_size, &mut pages);
+        }
+        // the tile straddles more pages than the heap holds, so the heap grows
+        assert!(pages.len() * page_size > texture.tile_size_bytes);
+        assert_eq!(
+            resources.heap_bytes.load(Ordering::Relaxed),
+            heap_bytes + align_up(pages.len() * page_size, tile_size_bytes()) - heap.size
+        );
+        unsafe {
+            for page in &pages {
+                std::ptr::write_bytes(data.add(page * page_size), 0x5a, page_size);
+            }
+            // write to every page not backing the mapped tile
+            for page in 0..size / page_size {
+                if !pages.contains(&page) {
+                    std::ptr::write_bytes(data.add(page * page_size), 0xab, page_size);
+                }
+            }
+            for page in &pages {
+                let bytes = std::slice::from_raw_parts(data.add(page * page_size), page_size);
+                assert!(bytes.iter().all(|b| *b == 0x5a));
+            }
+        }
+        resources.unmap_texture_tiles(&tile_update(handle, SparseUpdateKind::TextureUnmap, [2, 2, 0]));
+        assert_eq!(resources.mapped_bytes.load(Ordering::Relaxed), 0);
+        unsafe { std::ptr::write_bytes(data, 0xcd, size) };
+        // the released pages are handed out again
+        resources.map_texture_tiles(&tile_update(handle, SparseUpdateKind::TextureMap, [5, 1, 0]), &heap);
+        assert_eq!(heap.pages.lock().used, pages.len() * page_size);
+        resources.destroy_texture(handle);
+        resources.deallocate_heap(heap_handle);
+    }
+
+    #[test]
+    fn test_page_runs() {
+        let mut pages = vec![7, 3, 1, 2, 2, 8, 5];
+        let mut runs = Vec::new();
+        for_each_page_run(&mut pages, |first, count| runs.push((first, count)));
+        assert_eq!(runs, vec![(1, 3), (5, 1), (7, 2)]);
+    }
+}
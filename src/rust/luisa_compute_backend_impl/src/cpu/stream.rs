@@ -6,24 +6,32 @@ use rayon;
 use std::{
     collections::VecDeque,
     sync::{atomic::AtomicUsize, Arc},
-    thread::{self, JoinHandle},
+    thread,
 };
 
 use std::{panic::RefUnwindSafe, sync::atomic::AtomicBool};
 
 use super::{
     accel::{AccelImpl, GeometryImpl},
-    resource::{BindlessArrayImpl, BufferImpl},
+    resource::{BindlessArrayImpl, BufferImpl, EventImpl, EventStats},
     shader::ShaderImpl,
     texture::TextureImpl,
+    topology::WorkerGroups,
 };
 
 use bumpalo::Bump;
 use luisa_compute_cpu_kernel_defs as defs;
 
-struct Work {
-    f: Box<dyn FnOnce() + Send + Sync>,
-    callback: (extern "C" fn(*mut u8), *mut u8),
+enum Work {
+    Run {
+        f: Box<dyn FnOnce() + Send + Sync>,
+        callback: (extern "C" fn(*mut u8), *mut u8),
+    },
+    // parks the stream until `event` reaches `value`
+    Wait {
+        event: &'static EventImpl,
+        value: u64,
+    },
 }
 
 unsafe impl Send for Work {}
@@ -92,63 +100,182 @@ impl StagingBufferPool {
         buffers
     }
 }
+// Streams do not own a thread. A stream with pending work is handed to one of
+// the scheduler's driver threads, which runs its commands in order until the
+// queue is empty or the stream has to wait for an event. A waiting stream is
+// parked on the event and rescheduled by the signal that releases it, so a
+// stream waiting on another stream does not occupy an OS thread.
+pub(super) struct StreamScheduler {
+    ready: Mutex<ReadyQueue>,
+    new_ready: Condvar,
+    stats: Arc<EventStats>,
+}
+
+struct ReadyQueue {
+    streams: VecDeque<Arc<StreamContext>>,
+    idle: usize,
+    threads: usize,
+}
+
+impl StreamScheduler {
+    pub(super) fn new(stats: Arc<EventStats>) -> Arc<Self> {
+        Arc::new(Self {
+            ready: Mutex::new(ReadyQueue {
+                streams: VecDeque::new(),
+                idle: 0,
+                threads: 0,
+            }),
+            new_ready: Condvar::new(),
+            stats,
+        })
+    }
+    pub(super) fn driver_threads(&self) -> usize {
+        self.ready.lock().threads
+    }
+    fn schedule(self: &Arc<Self>, stream: Arc<StreamContext>) {
+        let mut ready = self.ready.lock();
+        ready.streams.push_back(stream);
+        // every ready stream gets its own driver, spawn one if all are busy
+        if ready.streams.len() > ready.idle {
+            ready.threads += 1;
+            let scheduler = self.clone();
+            thread::Builder::new()
+                .name("luisa-cpu-stream".to_string())
+                .spawn(move || scheduler.drive())
+                .unwrap();
+        } else {
+            self.new_ready.notify_one();
+        }
+    }
+    fn drive(&self) {
+        let mut ready = self.ready.lock();
+        loop {
+            if let Some(stream) = ready.streams.pop_front() {
+                drop(ready);
+                stream.drain();
+                ready = self.ready.lock();
+                continue;
+            }
+            ready.idle += 1;
+            self.new_ready.wait(&mut ready);
+            ready.idle -= 1;
+        }
+    }
+}
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum StreamState {
+    // no pending work
+    Idle,
+    // queued on or running on a driver thread
+    Scheduled,
+    // waiting for an event, rescheduled by its signal
+    Parked,
+}
+
+struct StreamQueue {
+    works: VecDeque<Work>,
+    state: StreamState,
+    // timestamp of the signal that released the stream, for the latency counters
+    released_at: Option<u64>,
+}
+
 struct StreamContext {
-    queue: Mutex<VecDeque<Work>>,
-    new_work: Condvar,
+    queue: Mutex<StreamQueue>,
     sync: Condvar,
     work_count: AtomicUsize,
     finished_count: AtomicUsize,
     staging_buffer_pool: StagingBufferPool,
+    scheduler: Arc<StreamScheduler>,
+}
+
+impl StreamContext {
+    fn push(self: &Arc<Self>, work: Work) {
+        let mut queue = self.queue.lock();
+        queue.works.push_back(work);
+        self.work_count
+            .fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+        if queue.state == StreamState::Idle {
+            queue.state = StreamState::Scheduled;
+            drop(queue);
+            self.scheduler.schedule(self.clone());
+        }
+    }
+    // must be called with the queue locked so that synchronize() cannot miss it
+    fn finish_one(&self) {
+        self.finished_count
+            .fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+        self.sync.notify_all();
+    }
+    fn drain(self: &Arc<Self>) {
+        let mut queue = self.queue.lock();
+        if let Some(signaled_at) = queue.released_at.take() {
+            // the wait the stream was parked on
+            self.scheduler.stats.record_wake(signaled_at);
+            self.finish_one();
+        }
+        loop {
+            let Some(work) = queue.works.pop_front() else {
+                queue.state = StreamState::Idle;
+                return;
+            };
+            match work {
+                Work::Run { f, callback } => {
+                    drop(queue);
+                    f();
+                    (callback.0)(callback.1);
+                    queue = self.queue.lock();
+                    self.finish_one();
+                }
+                Work::Wait { event, value } => {
+                    let stream = self.clone();
+                    let resume = Box::new(move |signaled_at: u64| {
+                        let mut queue = stream.queue.lock();
+                        queue.state = StreamState::Scheduled;
+                        queue.released_at = Some(signaled_at);
+                        drop(queue);
+                        stream.scheduler.schedule(stream.clone());
+                    });
+                    // the queue stays locked, so `resume` cannot run before the stream is parked
+                    if event.park(value, resume).is_ok() {
+                        queue.state = StreamState::Parked;
+                        return;
+                    }
+                    self.finish_one();
+                }
+            }
+        }
+    }
 }
 
 pub(super) struct StreamImpl {
     shared_pool: Arc<rayon::ThreadPool>,
-    #[allow(dead_code)]
-    private_thread: Arc<JoinHandle<()>>,
+    // set if the workers are pinned to NUMA nodes
+    groups: Option<Arc<WorkerGroups>>,
     ctx: Arc<StreamContext>,
 }
 
 impl StreamImpl {
-    pub(super) fn new(shared_pool: Arc<rayon::ThreadPool>) -> Self {
+    pub(super) fn new(
+        shared_pool: Arc<rayon::ThreadPool>,
+        groups: Option<Arc<WorkerGroups>>,
+        scheduler: Arc<StreamScheduler>,
+    ) -> Self {
         let ctx = Arc::new(StreamContext {
-            queue: Mutex::new(VecDeque::new()),
-            new_work: Condvar::new(),
+            queue: Mutex::new(StreamQueue {
+                works: VecDeque::new(),
+                state: StreamState::Idle,
+                released_at: None,
+            }),
             sync: Condvar::new(),
             work_count: AtomicUsize::new(0),
             finished_count: AtomicUsize::new(0),
             staging_buffer_pool: StagingBufferPool::new(),
+            scheduler,
         });
-        let private_thread = {
-            let ctx = ctx.clone();
-            Arc::new(thread::spawn(move || {
-                let mut guard = ctx.queue.lock();
-                loop {
-                    while guard.is_empty() {
-                        ctx.new_work.wait(&mut guard);
-                    }
-                    loop {
-                        if guard.is_empty() {
-                            break;
-                        }
-                        let work = guard.pop_front().unwrap();
-                        let Work { f, callback } = work;
-                        drop(guard);
-                        f();
-                        (callback.0)(callback.1);
-                        ctx.finished_count
-                            .fetch_add(1, std::sync::atomic::Ordering::Relaxed);
-                        guard = ctx.queue.lock();
-                        ctx.sync.notify_all();
-                        if guard.is_empty() {
-                            break;
-                        }
-                    }
-                }
-            }))
-        };
         Self {
             shared_pool,
-            private_thread,
+            groups,
             ctx,
         }
     }
@@ -172,15 +299,15 @@ impl StreamImpl {
         work: impl FnOnce() + Send + Sync + 'static,
         callback: (extern "C" fn(*mut u8), *mut u8),
     ) {
-        let mut guard = self.ctx.queue.lock();
-        guard.push_back(Work {
+        self.ctx.push(Work::Run {
             f: Box::new(work),
             callback,
         });
-        self.ctx
-            .work_count
-            .fetch_add(1, std::sync::atomic::Ordering::Relaxed);
-        self.ctx.new_work.notify_all();
+    }
+    // Makes the following work wait for `event` to reach `value` without
+    // blocking a thread.
+    pub(super) fn enqueue_wait(&self, event: &'static EventImpl, value: u64) {
+        self.ctx.push(Work::Wait { event, value });
     }
     pub(super) fn parallel_for(
         &self,
@@ -188,9 +315,14 @@ impl StreamImpl {
         block: usize,
         count: usize,
     ) {
+        let pool = self.shared_pool.clone();
+        if let Some(groups) = &self.groups {
+            // blocks are handed out per node, matching the first-touch placement
+            groups.for_each(&pool, count, block, true, &kernel);
+            return;
+        }
         let kernel = Arc::new(kernel);
         let counter = Arc::new(AtomicUsize::new(0));
-        let pool = self.shared_pool.clone();
         let nthreads = pool.current_num_threads();
         pool.scope(|s| {
             for _ in 0..nthreads {
@@ -660,3 +792,75 @@ pub(crate) struct ShaderDispatchContext {
     pub(crate) shader: *const ShaderImpl,
     pub(crate) terminated: AtomicBool,
 }
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use std::sync::atomic::Ordering;
+
+    extern "C" fn no_callback(_: *mut u8) {}
+
+    fn make_stream(pool: &Arc<rayon::ThreadPool>, scheduler: &Arc<StreamScheduler>) -> StreamImpl {
+        StreamImpl::new(pool.clone(), None, scheduler.clone())
+    }
+
+    #[test]
+    fn test_ping_pong() {
+        let stats = Arc::new(EventStats::new());
+        let scheduler = StreamScheduler::new(stats.clone());
+        let pool = Arc::new(rayon::ThreadPoolBuilder::new().num_threads(2).build().unwrap());
+        let event: &'static EventImpl = Box::leak(Box::new(EventImpl::new(stats.clone())));
+        let ping = make_stream(&pool, &scheduler);
+        let pong = make_stream(&pool, &scheduler);
+        let counter = Arc::new(AtomicUsize::new(0));
+        let rounds = 1000u64;
+        for i in 0..rounds {
+            for (stream, ticket) in [(&ping, 2 * i), (&pong, 2 * i + 1)] {
+                stream.enqueue_wait(event, ticket);
+                let counter = counter.clone();
+                stream.enqueue(
+                    move || {
+                        // the streams strictly alternate
+                        assert_eq!(counter.fetch_add(1, Ordering::SeqCst) as u64, ticket);
+                    },
+                    (no_callback, std::ptr::null_mut()),
+                );
+                stream.enqueue(move || event.signal(ticket + 1), (no_callback, std::ptr::null_mut()));
+            }
+        }
+        ping.synchronize();
+        pong.synchronize();
+        event.synchronize(2 * rounds);
+        assert_eq!(counter.load(Ordering::SeqCst) as u64, 2 * rounds);
+    }
+
+    #[test]
+    fn test_parked_streams_share_drivers() {
+        let stats = Arc::new(EventStats::new());
+        let scheduler = StreamScheduler::new(stats.clone());
+        let pool = Arc::new(rayon::ThreadPoolBuilder::new().num_threads(2).build().unwrap());
+        let event: &'static EventImpl = Box::leak(Box::new(EventImpl::new(stats.clone())));
+        let streams: Vec<_> = (0..64).map(|_| make_stream(&pool, &scheduler)).collect();
+        for (i, stream) in streams.iter().enumerate() {
+            stream.enqueue_wait(event, 1);
+            // wait until the stream is parked and its driver is idle again
+            loop {
+                let ready = scheduler.ready.lock();
+                if stats.parked_waits.load(Ordering::SeqCst) == i as u64 + 1
+                    && ready.idle == ready.threads
+                {
+                    break;
+                }
+                drop(ready);
+                thread::yield_now();
+            }
+        }
+        // a single driver thread served all the parked streams
+        assert_eq!(scheduler.driver_threads(), 1);
+        event.signal(1);
+        for stream in &streams {
+            stream.synchronize();
+        }
+        assert_eq!(stats.wakes.load(Ordering::SeqCst), streams.len() as u64);
+    }
+}
@@ -1,9 +1,13 @@
 use luisa_compute_api_types::PixelStorage;
 
+use super::memory::{HostAllocation, MemoryPolicy};
+
 use rayon::prelude::{IntoParallelIterator, ParallelIterator};
 
-const BLOCK_SIZE: usize = 4;
+pub(super) const BLOCK_SIZE: usize = 4;
 
+// The leading fields are read by the C++ side of the backend (RustTextureLayout).
+#[repr(C)]
 pub struct TextureImpl {
     pub(crate) data: *mut u8,
     pub(crate) data_size: usize,
@@ -13,51 +17,39 @@ pub struct TextureImpl {
     pub(crate) mip_levels: u8,
     pub(crate) mip_offsets: [usize; 16],
     pub(crate) storage: PixelStorage,
-    layout: std::alloc::Layout,
+    // None if `data` is not allocated by the texture itself (e.g. sparse textures)
+    allocation: Option<HostAllocation>,
 }
 
 unsafe impl Send for TextureImpl {}
 
 unsafe impl Sync for TextureImpl {}
 
-impl Drop for TextureImpl {
-    fn drop(&mut self) {
-        unsafe {
-            std::alloc::dealloc(self.data, self.layout);
-        }
-    }
-}
-
 impl TextureImpl {
-    pub(super) fn new(
+    // Returns the byte offset of each mip level and the total size in bytes.
+    // Every level starts at a multiple of `level_alignment`.
+    pub(super) fn mip_layout(
         dimension: u8,
         size: [u32; 3],
         storage: PixelStorage,
         levels: u8,
-        _allow_simultaneous_access: bool,
-    ) -> Self {
+        level_alignment: usize,
+    ) -> ([usize; 16], usize) {
         let pixel_size = storage.size();
-        let pixel_stride_shift = match pixel_size {
-            1 => 0,
-            2 => 1,
-            4 => 2,
-            8 => 3,
-            16 => 4,
-            _ => unreachable!(),
-        };
-        if dimension == 2 {
-            assert_eq!(size[2], 1);
-        }
         let mut data_size = 0;
         let mut mip_offsets = [0; 16];
         for level in 0..levels {
+            data_size = (data_size + level_alignment - 1) / level_alignment * level_alignment;
             mip_offsets[level as usize] = data_size;
             let blocks = [
                 (((size[0] as usize >> level).max(1)) + BLOCK_SIZE - 1) / BLOCK_SIZE,
                 (((size[1] as usize >> level).max(1)) + BLOCK_SIZE - 1) / BLOCK_SIZE,
                 (((size[2] as usize >> level).max(1)) + BLOCK_SIZE - 1) / BLOCK_SIZE,
             ];
-            data_size += if dimension == 2 {
+            data_size += if storage.is_block_compressed() {
+                // a 4x4 block of the layout holds exactly one compressed block
+                blocks[0] * blocks[1] * blocks[2] * pixel_size
+            } else if dimension == 2 {
                 blocks[0] * blocks[1] * blocks[2] * BLOCK_SIZE * BLOCK_SIZE * pixel_size
             } else {
                 blocks[0]
@@ -72,8 +64,58 @@ impl TextureImpl {
         for level in levels..16 {
             mip_offsets[level as usize] = data_size;
         }
-        let layout = std::alloc::Layout::from_size_align(data_size, 16).unwrap();
-        let data = unsafe { std::alloc::alloc(layout) };
+        (mip_offsets, data_size)
+    }
+    pub(super) fn new(
+        memory: &MemoryPolicy,
+        dimension: u8,
+        size: [u32; 3],
+        storage: PixelStorage,
+        levels: u8,
+        _allow_simultaneous_access: bool,
+    ) -> Self {
+        let (mip_offsets, data_size) = Self::mip_layout(dimension, size, storage, levels, 1);
+        let allocation = memory.allocate(data_size, 16);
+        unsafe {
+            Self::from_raw(
+                allocation.ptr,
+                dimension,
+                size,
+                storage,
+                levels,
+                mip_offsets,
+                data_size,
+                Some(allocation),
+            )
+        }
+    }
+    // Wraps memory laid out as described by `mip_offsets`. The memory is only
+    // freed on drop if `allocation` is given.
+    pub(super) unsafe fn from_raw(
+        data: *mut u8,
+        dimension: u8,
+        size: [u32; 3],
+        storage: PixelStorage,
+        levels: u8,
+        mip_offsets: [usize; 16],
+        data_size: usize,
+        allocation: Option<HostAllocation>,
+    ) -> Self {
+        let pixel_stride_shift = match storage.size() {
+            1 => 0,
+            2 => 1,
+            4 => 2,
+            8 => 3,
+            16 => 4,
+            _ => unreachable!(),
+        };
+        if dimension == 2 {
+            assert_eq!(size[2], 1);
+        }
+        assert!(
+            dimension == 2 || !storage.is_block_compressed(),
+            "Block-compressed volumes are not supported."
+        );
         Self {
             data,
             data_size,
@@ -83,7 +125,7 @@ impl TextureImpl {
             mip_levels: levels,
             mip_offsets,
             storage,
-            layout,
+            allocation,
         }
     }
     pub(crate) fn view(&self, level: u8) -> TextureView {
@@ -99,6 +141,7 @@ impl TextureImpl {
                 data: self.data.add(offset) as *mut u8,
                 size,
                 pixel_stride_shift: self.pixel_stride_shift,
+                block_compressed: self.storage.is_block_compressed(),
                 data_size: if level == 15 {
                     self.data_size - offset
                 } else {
@@ -130,7 +173,9 @@ impl TextureImpl {
 pub(crate) struct TextureView {
     pub(crate) data: *mut u8,
     pub(crate) size: [u32; 3],
+    // for block-compressed storages the stride is that of a 4x4 block
     pub(crate) pixel_stride_shift: usize,
+    pub(crate) block_compressed: bool,
     pub(crate) data_size: usize,
 }
 
@@ -140,13 +185,25 @@ unsafe impl Sync for TextureView {}
 
 impl TextureView {
     pub(crate) fn unpadded_data_size(&self) -> usize {
+        if self.block_compressed {
+            let b = BLOCK_SIZE as u32;
+            let blocks = ((self.size[0] + b - 1) / b) as usize * ((self.size[1] + b - 1) / b) as usize;
+            return blocks << self.pixel_stride_shift;
+        }
         self.size[0] as usize
             * self.size[1] as usize
             * self.size[2] as usize
             * (1 << self.pixel_stride_shift)
     }
+    // Blocks of compressed storages are stored in row-major order, which is also
+    // the linear layout of the host data, so they are copied as a whole.
+    #[inline]
+    fn copy_blocks(&self, src: *const u8, dst: *mut u8) {
+        unsafe { std::ptr::copy_nonoverlapping(src, dst, self.unpadded_data_size()) }
+    }
     #[inline]
     pub(crate) fn get_pixel_2d(&self, x: u32, y: u32) -> *mut u8 {
+        debug_assert!(!self.block_compressed);
         let block_x = x / BLOCK_SIZE as u32;
         let block_y = y / BLOCK_SIZE as u32;
         let grid_width = (self.size[0] + BLOCK_SIZE as u32 - 1) / BLOCK_SIZE as u32;
@@ -161,6 +218,7 @@ impl TextureView {
     }
     #[inline]
     pub(crate) fn get_pixel_3d(&self, x: u32, y: u32, z: u32) -> *mut u8 {
+        debug_assert!(!self.block_compressed);
         let block_x = x / BLOCK_SIZE as u32;
         let block_y = y / BLOCK_SIZE as u32;
         let block_z = z / BLOCK_SIZE as u32;
@@ -183,6 +241,11 @@ impl TextureView {
         // dbg!(self);
         unsafe {
             let mut data: Vec<u8> = Vec::with_capacity(self.unpadded_data_size());
+            if self.block_compressed {
+                self.copy_blocks(self.data, data.as_mut_ptr());
+                data.set_len(self.unpadded_data_size());
+                return data;
+            }
             let data_ptr = data.as_mut_ptr() as u64;
             (0..(self.size[0] * self.size[1]))
                 .into_par_iter()
@@ -202,6 +265,9 @@ impl TextureView {
     }
     #[inline]
     pub(crate) fn copy_from_2d(&self, mut data: *const u8) {
+        if self.block_compressed {
+            return self.copy_blocks(data, self.data);
+        }
         for y in 0..self.size[1] {
             for x in 0..self.size[0] {
                 let dst = self.get_pixel_2d(x, y);
@@ -228,6 +294,9 @@ impl TextureView {
     }
     #[inline]
     pub(crate) fn copy_to_2d(&self, mut data: *mut u8) {
+        if self.block_compressed {
+            return self.copy_blocks(self.data, data);
+        }
         for y in 0..self.size[1] {
             for x in 0..self.size[0] {
                 let src = self.get_pixel_2d(x, y);
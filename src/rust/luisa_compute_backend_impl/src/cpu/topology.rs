@@ -0,0 +1,176 @@
+// NUMA topology and pinning of the worker threads.
+//
+// With node-pinned workers, worker thread `i` is pinned to the i-th CPU in node
+// order, so that the threads of each node form a group. Kernel dispatches hand a
+// contiguous slice of the blocks to every group (stealing from the other groups
+// once their own slice is done), and first-touch initialization of new buffers
+// uses the same partition, so that a block mostly accesses memory on its own node.
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+// CPUs of each NUMA node. Falls back to a single node with all CPUs when the
+// topology is not available.
+pub(super) fn numa_nodes() -> Vec<Vec<usize>> {
+    #[cfg(target_os = "linux")]
+    {
+        let mut nodes = Vec::new();
+        for node in 0.. {
+            let path = format!("/sys/devices/system/node/node{}/cpulist", node);
+            let Ok(list) = std::fs::read_to_string(path) else {
+                break;
+            };
+            let cpus = parse_cpu_list(&list);
+            if !cpus.is_empty() {
+                nodes.push(cpus);
+            }
+        }
+        if !nodes.is_empty() {
+            return nodes;
+        }
+    }
+    let n = std::thread::available_parallelism().map_or(1, |n| n.get());
+    vec![(0..n).collect()]
+}
+
+// parses lists such as "0-3,8-11,16"
+pub(super) fn parse_cpu_list(list: &str) -> Vec<usize> {
+    let mut cpus = Vec::new();
+    for range in list.trim().split(',').filter(|s| !s.is_empty()) {
+        match range.split_once('-') {
+            Some((lo, hi)) => {
+                if let (Ok(lo), Ok(hi)) = (lo.parse::<usize>(), hi.parse::<usize>()) {
+                    cpus.extend(lo..=hi);
+                }
+            }
+            None => {
+                if let Ok(cpu) = range.parse::<usize>() {
+                    cpus.push(cpu);
+                }
+            }
+        }
+    }
+    cpus
+}
+
+pub(super) fn pin_current_thread(cpu: usize) {
+    #[cfg(target_os = "linux")]
+    unsafe {
+        let mut set: libc::cpu_set_t = std::mem::zeroed();
+        libc::CPU_SET(cpu, &mut set);
+        if libc::sched_setaffinity(0, std::mem::size_of::<libc::cpu_set_t>(), &set) != 0 {
+            log::warn!(
+                "failed to pin worker thread to cpu {}: {}",
+                cpu,
+                std::io::Error::last_os_error()
+            );
+        }
+    }
+    #[cfg(not(target_os = "linux"))]
+    {
+        let _ = cpu;
+    }
+}
+
+pub(super) struct WorkerGroups {
+    // CPU each worker thread is pinned to, indexed by the rayon thread index
+    thread_cpu: Vec<usize>,
+    // group (NUMA node) of each worker thread
+    thread_group: Vec<usize>,
+    group_count: usize,
+}
+
+impl WorkerGroups {
+    pub(super) fn new(nodes: &[Vec<usize>], num_threads: usize) -> Self {
+        let cpus: Vec<_> = nodes
+            .iter()
+            .enumerate()
+            .flat_map(|(node, cpus)| cpus.iter().map(move |cpu| (node, *cpu)))
+            .collect();
+        // when oversubscribed, wrap around; extra threads share the CPUs of the first nodes
+        let (thread_group, thread_cpu): (Vec<_>, Vec<_>) =
+            (0..num_threads).map(|i| cpus[i % cpus.len()]).unzip();
+        Self {
+            thread_cpu,
+            thread_group,
+            group_count: nodes.len(),
+        }
+    }
+    pub(super) fn cpu_of(&self, thread: usize) -> usize {
+        self.thread_cpu[thread]
+    }
+    pub(super) fn group_of(&self, thread: usize) -> usize {
+        self.thread_group[thread]
+    }
+    pub(super) fn group_count(&self) -> usize {
+        self.group_count
+    }
+    // the part of [0, count) that belongs to `group`
+    pub(super) fn group_range(&self, group: usize, count: usize) -> std::ops::Range<usize> {
+        let n = self.group_count;
+        count * group / n..count * (group + 1) / n
+    }
+    // Runs `f` on every index in [0, count) in chunks of `block` indices. Worker
+    // threads first process the slice of their own group, then help the others.
+    pub(super) fn for_each(
+        &self,
+        pool: &rayon::ThreadPool,
+        count: usize,
+        block: usize,
+        steal: bool,
+        f: &(dyn Fn(usize) + Sync),
+    ) {
+        let n = self.group_count;
+        let ranges: Vec<_> = (0..n).map(|g| self.group_range(g, count)).collect();
+        let counters: Vec<_> = ranges.iter().map(|r| AtomicUsize::new(r.start)).collect();
+        pool.broadcast(|ctx| {
+            let group = self.group_of(ctx.index());
+            let groups = if steal { n } else { 1 };
+            for k in 0..groups {
+                let g = (group + k) % n;
+                let end = ranges[g].end;
+                loop {
+                    let index = counters[g].fetch_add(block, Ordering::Relaxed);
+                    if index >= end {
+                        break;
+                    }
+                    for i in index..(index + block).min(end) {
+                        f(i);
+                    }
+                }
+            }
+        });
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn test_parse_cpu_list() {
+        assert_eq!(parse_cpu_list("0-3,8-9,16\n"), vec![0, 1, 2, 3, 8, 9, 16]);
+        assert_eq!(parse_cpu_list("\n"), Vec::<usize>::new());
+    }
+
+    #[test]
+    fn test_worker_groups() {
+        let nodes = vec![vec![0, 1], vec![2, 3]];
+        let groups = WorkerGroups::new(&nodes, 6);
+        assert_eq!(groups.group_count(), 2);
+        assert_eq!(groups.cpu_of(3), 3);
+        assert_eq!(groups.group_of(1), 0);
+        assert_eq!(groups.group_of(2), 1);
+        assert_eq!(groups.group_of(5), 0);
+        assert_eq!(groups.group_range(0, 10), 0..5);
+        assert_eq!(groups.group_range(1, 10), 5..10);
+
+        let pool = rayon::ThreadPoolBuilder::new()
+            .num_threads(6)
+            .build()
+            .unwrap();
+        let visited: Vec<_> = (0..1000).map(|_| AtomicUsize::new(0)).collect();
+        groups.for_each(&pool, visited.len(), 7, true, &|i| {
+            visited[i].fetch_add(1, Ordering::Relaxed);
+        });
+        assert!(visited.iter().all(|v| v.load(Ordering::Relaxed) == 1));
+    }
+}
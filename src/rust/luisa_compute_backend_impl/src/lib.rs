@@ -167,10 +167,15 @@ extern "C" fn destroy_context(ctx: api::Context) {
 unsafe extern "C" fn create_device(
     ctx: api::Context,
     device: *const c_char,
-    _config: *const c_char,// TODO: respect config
+    config: *const c_char,
 ) -> DeviceInterface {
     let device = CStr::from_ptr(device).to_str().unwrap();
-    // let config = CStr::from_ptr(config).to_str().unwrap();
+    // backend specific configuration as a JSON object, may be null or empty
+    let config = if config.is_null() {
+        ""
+    } else {
+        CStr::from_ptr(config).to_str().unwrap()
+    };
     let ctx = &*(ctx.0 as *const Context);
     match device {
         "cpu" => {
@@ -194,7 +199,14 @@ unsafe extern "C" fn create_device(
                     })
                     .ok()
                     .map(|x| Arc::new(x));
-                let device = cpu::RustBackend::new();
+                let config = if config.is_empty() {
+                    cpu::CpuDeviceConfig::default()
+                } else {
+                    serde_json::from_str(config).unwrap_or_else(|e| {
+                        panic_abort!("invalid cpu device config {}: {}", config, e)
+                    })
+                };
+                let device = cpu::RustBackend::new(&config);
                 if let Some(swapchain) = swapchain {
                     device.set_swapchain_contex(swapchain);
                 }
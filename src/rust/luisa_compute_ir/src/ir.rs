@@ -1866,7 +1866,14 @@ impl ModuleDuplicator {
         if let Some(copy) = self.callables.get(&callable.as_ptr()) {
             return copy.clone();
         }
-        let dup_callable = self.with_context(|this| {
+        let dup_callable = CArc::new(self.duplicate_callable_module(callable));
+        self.callables
+            .insert(callable.as_ptr(), dup_callable.clone());
+        dup_callable
+    }
+
+    fn duplicate_callable_module(&mut self, callable: &CallableModule) -> CallableModule {
+        self.with_context(|this| {
             let dup_args = this.duplicate_args(&callable.pools, &callable.args);
             let dup_captures = this.duplicate_captures(&callable.pools, &callable.captures);
             let dup_module = this.duplicate_module(&callable.module);
@@ -1878,11 +1885,7 @@ impl ModuleDuplicator {
                 cpu_custom_ops: callable.cpu_custom_ops.clone(),
                 pools: callable.pools.clone(),
             }
-        });
-        let dup_callable = CArc::new(dup_callable);
-        self.callables
-            .insert(callable.as_ptr(), dup_callable.clone());
-        dup_callable
+        })
     }
 
     fn duplicate_arg(&mut self, pools: &CArc<ModulePools>, node_ref: NodeRef) -> NodeRef {
@@ -2194,6 +2197,12 @@ pub fn duplicate_callable(callable: &CArc<CallableModule>) -> CArc<CallableModul
     dup.duplicate_callable(callable)
 }
 
+// deep copy of a callable module that is not (yet) shared through a CArc
+pub fn duplicate_callable_module(callable: &CallableModule) -> CallableModule {
+    let mut dup = ModuleDuplicator::new();
+    dup.duplicate_callable_module(callable)
+}
+
 #[repr(C)]
 pub struct IrBuilder {
     bb: Pooled<BasicBlock>,
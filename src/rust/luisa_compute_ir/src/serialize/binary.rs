@@ -0,0 +1,216 @@
+/*
+Compact binary encoding of SerializedKernelModule, used to ship IR between
+processes and to persist it in caches where JSON is too large and too slow.
+
+Layout (little endian):
+  [0..4)  magic "LCIR"
+  [4..6)  format version
+  [6..8)  reserved flags, must be zero
+  [8..)   the module encoded with bincode using variable-length integers, so
+          node/block/type references (indices into the interned tables of
+          SerializedKernelModule) and enum tags mostly take a single byte
+
+Decoding reads directly from the borrowed byte slice, there is no intermediate
+document tree as in the JSON path. Bump BINARY_VERSION whenever any of the
+Serialized* types change.
+*/
+use std::fmt::{Display, Formatter};
+
+use bincode::Options;
+
+use super::SerializedKernelModule;
+
+pub const BINARY_MAGIC: [u8; 4] = *b"LCIR";
+pub const BINARY_VERSION: u16 = 1;
+const HEADER_SIZE: usize = 8;
+
+#[derive(Debug)]
+pub enum BinaryFormatError {
+    TooShort,
+    BadMagic,
+    UnsupportedVersion(u16),
+    UnsupportedFlags(u16),
+    Malformed(String),
+}
+
+impl Display for BinaryFormatError {
+    fn fmt(&self, f: &mut Formatter<'_>) -> std::fmt::Result {
+        match self {
+            BinaryFormatError::TooShort => write!(f, "binary IR is shorter than its header"),
+            BinaryFormatError::BadMagic => write!(f, "not a binary IR blob (bad magic)"),
+            BinaryFormatError::UnsupportedVersion(v) => write!(
+                f,
+                "unsupported binary IR version {} (expected {})",
+                v, BINARY_VERSION
+            ),
+            BinaryFormatError::UnsupportedFlags(flags) => {
+                write!(f, "unsupported binary IR flags {:#06x}", flags)
+            }
+            BinaryFormatError::Malformed(msg) => write!(f, "malformed binary IR: {}", msg),
+        }
+    }
+}
+
+impl std::error::Error for BinaryFormatError {}
+
+fn options() -> impl Options {
+    bincode::DefaultOptions::new()
+        .with_little_endian()
+        .with_varint_encoding()
+        .reject_trailing_bytes()
+}
+
+pub fn encode_kernel_module(m: &SerializedKernelModule) -> Vec<u8> {
+    let options = options();
+    let size = options.serialized_size(m).unwrap() as usize;
+    let mut bytes = Vec::with_capacity(HEADER_SIZE + size);
+    bytes.extend_from_slice(&BINARY_MAGIC);
+    bytes.extend_from_slice(&BINARY_VERSION.to_le_bytes());
+    bytes.extend_from_slice(&0u16.to_le_bytes());
+    options.serialize_into(&mut bytes, m).unwrap();
+    bytes
+}
+
+/// Returns the format version of an encoded module without decoding it.
+pub fn binary_version(bytes: &[u8]) -> Result<u16, BinaryFormatError> {
+    if bytes.len() < HEADER_SIZE {
+        return Err(BinaryFormatError::TooShort);
+    }
+    if bytes[0..4] != BINARY_MAGIC {
+        return Err(BinaryFormatError::BadMagic);
+    }
+    Ok(u16::from_le_bytes([bytes[4], bytes[5]]))
+}
+
+pub fn decode_kernel_module(bytes: &[u8]) -> Result<SerializedKernelModule, BinaryFormatError> {
+    let version = binary_version(bytes)?;
+    if version != BINARY_VERSION {
+        return Err(BinaryFormatError::UnsupportedVersion(version));
+    }
+    let flags = u16::from_le_bytes([bytes[6], bytes[7]]);
+    if flags != 0 {
+        return Err(BinaryFormatError::UnsupportedFlags(flags));
+    }
+    options()
+        .deserialize(&bytes[HEADER_SIZE..])
+        .map_err(|e| BinaryFormatError::Malformed(e.to_string()))
+}
+
+#[cfg(test)]
+mod test {
+    use std::time::Instant;
+
+    use super::*;
+    use crate::ir::{
+        Const, Func, IrBuilder, KernelModule, Module, ModuleFlags, ModuleKind, ModulePools,
+    };
+    use crate::serialize::convert::serialize_kernel_module;
+    use crate::{CArc, CBoxedSlice, TypeOf};
+
+    fn make_kernel(n: usize) -> KernelModule {
+        let pools = CArc::new(ModulePools::new());
+        let mut builder = IrBuilder::new(pools.clone());
+        let mut acc = builder.const_(Const::Float32(0.0));
+        let v = builder.local(acc);
+        for i in 0..n {
+            let c = builder.const_(Const::Float32(i as f32));
+            acc = builder.call(Func::Add, &[acc, c], f32::type_());
+            let cond = builder.call(Func::Lt, &[acc, c], bool::type_());
+            let mut t = IrBuilder::new(pools.clone());
+            t.update(v, acc);
+            let t = t.finish();
+            let f = IrBuilder::new(pools.clone()).finish();
+            builder.if_(cond, t, f);
+        }
+        let entry = builder.finish();
+        KernelModule {
+            module: Module {
+                kind: ModuleKind::Kernel,
+                entry,
+                flags: ModuleFlags::NONE,
+                pools: pools.clone(),
+            },
+            captures: CBoxedSlice::new(vec![]),
+            args: CBoxedSlice::new(vec![]),
+            shared: CBoxedSlice::new(vec![]),
+            cpu_custom_ops: CBoxedSlice::new(vec![]),
+            block_size: [64, 1, 1],
+            pools,
+        }
+    }
+
+    #[test]
+    fn test_binary_round_trip() {
+        let kernel = make_kernel(16);
+        let serialized = serialize_kernel_module(&kernel);
+        let bytes = encode_kernel_module(&serialized);
+        assert_eq!(binary_version(&bytes).unwrap(), BINARY_VERSION);
+        let decoded = decode_kernel_module(&bytes).unwrap();
+        assert_eq!(encode_kernel_module(&decoded), bytes);
+        assert_eq!(
+            serde_json::to_string(&decoded).unwrap(),
+            serde_json::to_string(&serialized).unwrap()
+        );
+        assert_eq!(decoded.block_size, [64, 1, 1]);
+    }
+
+    #[test]
+    fn test_binary_rejects_invalid_input() {
+        let bytes = encode_kernel_module(&serialize_kernel_module(&make_kernel(1)));
+        assert!(matches!(
+            decode_kernel_module(&bytes[..4]),
+            Err(BinaryFormatError::TooShort)
+        ));
+        let mut bad = bytes.clone();
+        bad[0] = b'X';
+        assert!(matches!(
+            decode_kernel_module(&bad),
+            Err(BinaryFormatError::BadMagic)
+        ));
+        let mut bad = bytes.clone();
+        bad[4..6].copy_from_slice(&(BINARY_VERSION + 1).to_le_bytes());
+        assert!(matches!(
+            decode_kernel_module(&bad),
+            Err(BinaryFormatError::UnsupportedVersion(_))
+        ));
+        assert!(matches!(
+            decode_kernel_module(&bytes[..bytes.len() - 1]),
+            Err(BinaryFormatError::Malformed(_))
+        ));
+    }
+
+    #[test]
+    fn test_binary_vs_json() {
+        let kernel = make_kernel(2048);
+        let serialized = serialize_kernel_module(&kernel);
+
+        let tic = Instant::now();
+        let json = serde_json::to_string(&serialized).unwrap();
+        let json_encode = tic.elapsed();
+        let tic = Instant::now();
+        let from_json: SerializedKernelModule = serde_json::from_str(&json).unwrap();
+        let json_decode = tic.elapsed();
+
+        let tic = Instant::now();
+        let bytes = encode_kernel_module(&serialized);
+        let binary_encode = tic.elapsed();
+        let tic = Instant::now();
+        let from_binary = decode_kernel_module(&bytes).unwrap();
+        let binary_decode = tic.elapsed();
+
+        println!(
+            "json: {} bytes, encode {:.3}ms, decode {:.3}ms",
+            json.len(),
+            json_encode.as_secs_f64() * 1e3,
+            json_decode.as_secs_f64() * 1e3
+        );
+        println!(
+            "binary: {} bytes, encode {:.3}ms, decode {:.3}ms",
+            bytes.len(),
+            binary_encode.as_secs_f64() * 1e3,
+            binary_decode.as_secs_f64() * 1e3
+        );
+        assert_eq!(from_json.nodes.len(), from_binary.nodes.len());
+        assert!(bytes.len() * 4 < json.len());
+    }
+}
@@ -1,3 +1,4 @@
+pub mod binary;
 pub mod convert;
 use crate::ir::{Binding, KernelModule, Primitive};
 
@@ -474,3 +475,12 @@ pub fn serialize_kernel_module_to_json_str(m: &KernelModule) -> String {
     let json = serialize_kernel_module_to_json(m);
     serde_json::to_string(&json).unwrap()
 }
+pub fn serialize_kernel_module_to_binary(m: &KernelModule) -> Vec<u8> {
+    let v = convert::serialize_kernel_module(m);
+    binary::encode_kernel_module(&v)
+}
+pub fn deserialize_kernel_module_from_binary(
+    bytes: &[u8],
+) -> Result<SerializedKernelModule, binary::BinaryFormatError> {
+    binary::decode_kernel_module(bytes)
+}
@@ -2009,6 +2009,12 @@ fn ad_transform_recursive(block: Pooled<BasicBlock>, pools: &CArc<ModulePools>)
     }
 }
 impl Transform for Autodiff {
+    fn name(&self) -> &'static str {
+        "autodiff"
+    }
+    fn is_required(&self, module: &crate::ir::Module) -> bool {
+        module.flags.contains(ModuleFlags::REQUIRES_REV_AD_TRANSFORM)
+    }
     fn transform(&self, mut module: crate::ir::Module) -> crate::ir::Module {
         log::debug!("Autodiff transform");
         // {
@@ -1,16 +1,817 @@
 /*
  * This file implements the control flow canonicalization transform.
- * This transform removes all break/continue/early-return statements, in the following steps:
- *
+ * Break, continue and early return statements are lowered to flag variables:
+ *   - a jump sets its flag (and the return value) and the remaining nodes of
+ *     its block are removed;
+ *   - the nodes following a statement that may set a flag are guarded by
+ *     `if (!flag) { ... }`;
+ *   - loops are left through their condition, which also checks the flags.
+ *     The break and continue flags are declared right before the loop and the
+ *     continue flag is cleared at the start of each iteration. For generic loops
+ *     the prepare and update blocks are skipped once the loop is left;
+ *   - a break in a switch case leaves the switch, a continue in a switch case
+ *     continues the enclosing loop;
+ *   - returns set a flag and a return value declared at the start of the module,
+ *     which is returned at its end.
+ * Afterwards the only jump left is the return at the end of the module. Jumps in
+ * ray query callbacks are left untouched. Nodes following an unreachable call are
+ * removed, except for values that are still referenced, and `if` statements with
+ * two empty branches are removed.
+ * Modules in SSA form are left untouched since phi nodes refer to blocks that
+ * may be moved.
  */
 
-use crate::ir::Module;
+use std::cell::Cell;
+use std::collections::HashSet;
+
+use crate::ir::{
+    BasicBlock, Const, Func, Instruction, IrBuilder, Module, ModulePools, NodeRef, SwitchCase,
+    INVALID_REF,
+};
+use crate::transform::utils::{
+    block_has_phi, collect_nodes_recursive, for_each_block, for_each_operand,
+};
 use crate::transform::Transform;
+use crate::{CArc, Pooled, TypeOf};
 
 pub struct CanonicalizeControlFlow;
 
+// a bool variable declared (initialized to false) right before `anchor` when first needed
+struct Flag {
+    var: Cell<NodeRef>,
+    anchor: NodeRef,
+}
+
+impl Flag {
+    fn new(anchor: NodeRef) -> Self {
+        Self {
+            var: Cell::new(INVALID_REF),
+            anchor,
+        }
+    }
+    fn created(&self) -> Option<NodeRef> {
+        let var = self.var.get();
+        var.valid().then_some(var)
+    }
+}
+
+// where break and continue statements jump to in the current block
+#[derive(Clone, Copy)]
+struct Targets<'a> {
+    break_: Option<&'a Flag>,
+    continue_: Option<&'a Flag>,
+}
+
+struct Return {
+    flag: NodeRef,
+    // the return value, if any
+    value: Option<NodeRef>,
+}
+
+struct Lowering {
+    pools: CArc<ModulePools>,
+    ret: Option<Return>,
+    // values referenced before the transform, kept after unreachable calls
+    used: HashSet<NodeRef>,
+    lowered: Cell<usize>,
+    removed: Cell<usize>,
+}
+
+fn builder_after(node: NodeRef, pools: &CArc<ModulePools>) -> IrBuilder {
+    let mut builder = IrBuilder::new_without_bb(pools.clone());
+    builder.set_insert_point(node);
+    builder
+}
+
+fn builder_at_end(block: Pooled<BasicBlock>, pools: &CArc<ModulePools>) -> IrBuilder {
+    builder_after(block.last().get().prev, pools)
+}
+
+fn merge(escapes: &mut Vec<NodeRef>, other: Vec<NodeRef>) {
+    for var in other {
+        if !escapes.contains(&var) {
+            escapes.push(var);
+        }
+    }
+}
+
+impl Lowering {
+    fn declare_flag(&self, builder: &mut IrBuilder) -> NodeRef {
+        let false_ = builder.const_(Const::Bool(false));
+        builder.local(false_)
+    }
+    fn flag(&self, flag: &Flag) -> NodeRef {
+        if let Some(var) = flag.created() {
+            return var;
+        }
+        let var = self.declare_flag(&mut builder_after(flag.anchor.get().prev, &self.pools));
+        flag.var.set(var);
+        var
+    }
+    fn empty_block(&self) -> Pooled<BasicBlock> {
+        IrBuilder::new(self.pools.clone()).finish()
+    }
+    // moves the nodes of `block` into a new block
+    fn take_nodes(&self, block: Pooled<BasicBlock>) -> Pooled<BasicBlock> {
+        let taken = self.empty_block();
+        for node in block.nodes() {
+            node.remove();
+            taken.push(node);
+        }
+        taken
+    }
+    // !(flag_0 || flag_1 || ...)
+    fn none_set(&self, builder: &mut IrBuilder, flags: &[NodeRef]) -> NodeRef {
+        let mut any = builder.load(flags[0]);
+        for flag in &flags[1..] {
+            let set = builder.load(*flag);
+            any = builder.call(Func::BitOr, &[any, set], bool::type_());
+        }
+        builder.call(Func::Not, &[any], bool::type_())
+    }
+    fn returns(&self, block: Pooled<BasicBlock>) -> bool {
+        self.ret.is_some() && collect_nodes_recursive(block).iter().any(is_return)
+    }
+    // true if a jump in `block` (a continue, if `continues`) leaves the enclosing loop
+    fn leaves_loop(&self, block: Pooled<BasicBlock>, in_switch: bool, continues: bool) -> bool {
+        block
+            .iter()
+            .any(|node| match node.get().instruction.as_ref() {
+                Instruction::Break => !in_switch,
+                Instruction::Continue => continues,
+                Instruction::Return(_) => self.ret.is_some(),
+                Instruction::Loop { body, .. } => self.returns(*body),
+                Instruction::GenericLoop {
+                    prepare,
+                    body,
+                    update,
+                    ..
+                } => self.returns(*prepare) || self.returns(*body) || self.returns(*update),
+                Instruction::RayQuery { .. } => false,
+                inst => {
+                    let in_switch = in_switch || matches!(inst, Instruction::Switch { .. });
+                    let mut leaves = false;
+                    for_each_block(inst, |b| {
+                        leaves = leaves || self.leaves_loop(b, in_switch, continues)
+                    });
+                    leaves
+                }
+            })
+    }
+    // keeps the value of `cond` in a new variable, since it may end up in a guarded block
+    fn keep_cond(&self, node: NodeRef, block: Pooled<BasicBlock>, cond: NodeRef) -> NodeRef {
+        let var = self.declare_flag(&mut builder_after(node.get().prev, &self.pools));
+        if block.nodes().contains(&cond) {
+            builder_after(cond, &self.pools).update(var, cond);
+        } else {
+            builder_at_end(block, &self.pools).update(var, cond);
+        }
+        var
+    }
+    fn remove_after(&self, node: NodeRef, keep_used: bool) {
+        let mut next = node.get().next;
+        while next.get().next.valid() {
+            let following = next.get().next;
+            if !keep_used || !self.used.contains(&next) {
+                next.remove();
+                self.removed.set(self.removed.get() + 1);
+            }
+            next = following;
+        }
+    }
+    // replaces the jump by `flag = true` and removes the nodes following it
+    fn lower_jump(&self, node: NodeRef, flag: NodeRef) {
+        let true_ = builder_after(node.get().prev, &self.pools).const_(Const::Bool(true));
+        node.get_mut().instruction = CArc::new(Instruction::Update {
+            var: flag,
+            value: true_,
+        });
+        self.remove_after(node, false);
+        self.lowered.set(self.lowered.get() + 1);
+    }
+    // lowers the jumps in `block` and returns the flags that may be set after it
+    fn lower_block(&self, block: Pooled<BasicBlock>, targets: Targets) -> Vec<NodeRef> {
+        let mut escapes = Vec::new();
+        for node in block.nodes() {
+            let inst = node.get().instruction.clone();
+            let nested = match inst.as_ref() {
+                Instruction::Break | Instruction::Continue => {
+                    let target = match inst.as_ref() {
+                        Instruction::Break => targets.break_,
+                        _ => targets.continue_,
+                    };
+                    match target {
+                        Some(target) => {
+                            let flag = self.flag(target);
+                            self.lower_jump(node, flag);
+                            merge(&mut escapes, vec![flag]);
+                        }
+                        None => self.remove_after(node, true),
+                    }
+                    return escapes;
+                }
+                Instruction::Return(value) => {
+                    match &self.ret {
+                        Some(ret) => {
+                            if let Some(var) = ret.value {
+                                builder_after(node.get().prev, &self.pools).update(var, *value);
+                            }
+                            self.lower_jump(node, ret.flag);
+                            merge(&mut escapes, vec![ret.flag]);
+                        }
+                        None => self.remove_after(node, true),
+                    }
+                    return escapes;
+                }
+                Instruction::Call(Func::Unreachable(_), _) => {
+                    self.remove_after(node, true);
+                    return escapes;
+                }
+                Instruction::If {
+                    true_branch,
+                    false_branch,
+                    ..
+                } => {
+                    let mut nested = self.lower_block(*true_branch, targets);
+                    merge(&mut nested, self.lower_block(*false_branch, targets));
+                    if true_branch.len() == 0 && false_branch.len() == 0 {
+                        node.remove();
+                        self.removed.set(self.removed.get() + 1);
+                        continue;
+                    }
+                    nested
+                }
+                Instruction::Switch { default, cases, .. } => {
+                    self.lower_switch(node, *default, cases.as_ref(), targets)
+                }
+                Instruction::Loop { body, cond } => self.lower_loop(node, *body, *cond),
+                Instruction::GenericLoop {
+                    prepare,
+                    cond,
+                    body,
+                    update,
+                } => self.lower_generic_loop(node, *prepare, *cond, *body, *update),
+                Instruction::AdScope { body, .. } | Instruction::AdDetach(body) => {
+                    self.lower_block(*body, targets)
+                }
+                _ => Vec::new(),
+            };
+            if nested.is_empty() {
+                continue;
+            }
+            merge(&mut escapes, nested.clone());
+            // guard the rest of the block
+            if node.get().next != block.last() {
+                let rest = block.split(node, &self.pools);
+                let mut builder = builder_after(node, &self.pools);
+                let go_on = self.none_set(&mut builder, &nested);
+                builder.if_(go_on, rest, self.empty_block());
+                merge(&mut escapes, self.lower_block(rest, targets));
+            }
+            return escapes;
+        }
+        escapes
+    }
+    fn lower_switch(
+        &self,
+        node: NodeRef,
+        default: Pooled<BasicBlock>,
+        cases: &[SwitchCase],
+        targets: Targets,
+    ) -> Vec<NodeRef> {
+        let break_ = Flag::new(node);
+        let targets = Targets {
+            break_: Some(&break_),
+            continue_: targets.continue_,
+        };
+        let mut escapes = self.lower_block(default, targets);
+        for case in cases {
+            merge(&mut escapes, self.lower_block(case.block, targets));
+        }
+        escapes.retain(|flag| Some(*flag) != break_.created());
+        escapes
+    }
+    fn lower_loop(&self, node: NodeRef, body: Pooled<BasicBlock>, cond: NodeRef) -> Vec<NodeRef> {
+        let leaves = self.leaves_loop(body, false, true);
+        let cond_var =
+            (leaves && body.nodes().contains(&cond)).then(|| self.keep_cond(node, body, cond));
+        let break_ = Flag::new(node);
+        let continue_ = Flag::new(node);
+        let targets = Targets {
+            break_: Some(&break_),
+            continue_: Some(&continue_),
+        };
+        let mut escapes = self.lower_block(body, targets);
+        escapes.retain(|flag| Some(*flag) != continue_.created());
+        let stop = escapes.clone();
+        escapes.retain(|flag| Some(*flag) != break_.created());
+        if !leaves {
+            return escapes;
+        }
+        let mut builder = builder_at_end(body, &self.pools);
+        let mut cond = match cond_var {
+            Some(var) => builder.load(var),
+            None => cond,
+        };
+        // a continue skips the condition
+        if let Some(flag) = continue_.created() {
+            let continued = builder.load(flag);
+            cond = builder.call(Func::BitOr, &[cond, continued], bool::type_());
+            let mut reset = builder_after(body.first(), &self.pools);
+            let false_ = reset.const_(Const::Bool(false));
+            reset.update(flag, false_);
+        }
+        if !stop.is_empty() {
+            let go_on = self.none_set(&mut builder, &stop);
+            cond = builder.call(Func::BitAnd, &[cond, go_on], bool::type_());
+        }
+        node.get_mut().instruction = CArc::new(Instruction::Loop { body, cond });
+        escapes
+    }
+    fn lower_generic_loop(
+        &self,
+        node: NodeRef,
+        prepare: Pooled<BasicBlock>,
+        cond: NodeRef,
+        body: Pooled<BasicBlock>,
+        update: Pooled<BasicBlock>,
+    ) -> Vec<NodeRef> {
+        let leaves =
+            self.leaves_loop(body, false, false) || self.returns(prepare) || self.returns(update);
+        let cond_var = leaves.then(|| self.keep_cond(node, prepare, cond));
+        let break_ = Flag::new(node);
+        let continue_ = Flag::new(node);
+        // only the body may break or continue the loop
+        let outside = Targets {
+            break_: None,
+            continue_: None,
+        };
+        let mut escapes = self.lower_block(prepare, outside);
+        merge(
+            &mut escapes,
+            self.lower_block(
+                body,
+                Targets {
+                    break_: Some(&break_),
+                    continue_: Some(&continue_),
+                },
+            ),
+        );
+        merge(&mut escapes, self.lower_block(update, outside));
+        escapes.retain(|flag| Some(*flag) != continue_.created());
+        // a continue goes to the update block, which runs unless the loop is left
+        if let Some(flag) = continue_.created() {
+            let mut reset = builder_after(body.first(), &self.pools);
+            let false_ = reset.const_(Const::Bool(false));
+            reset.update(flag, false_);
+        }
+        let stop = escapes.clone();
+        escapes.retain(|flag| Some(*flag) != break_.created());
+        let Some(cond_var) = cond_var else {
+            return escapes;
+        };
+        // prepare; cond => if (!stop) { prepare; cond_var = cond; } !stop && cond_var
+        let guarded = self.take_nodes(prepare);
+        let mut builder = builder_at_end(prepare, &self.pools);
+        let go_on = self.none_set(&mut builder, &stop);
+        builder.if_(go_on, guarded, self.empty_block());
+        let cond = builder.load(cond_var);
+        let cond = builder.call(Func::BitAnd, &[go_on, cond], bool::type_());
+        // update => if (!stop) { update }
+        if update.len() != 0 {
+            let guarded = self.take_nodes(update);
+            let mut builder = builder_at_end(update, &self.pools);
+            let go_on = self.none_set(&mut builder, &stop);
+            builder.if_(go_on, guarded, self.empty_block());
+        }
+        node.get_mut().instruction = CArc::new(Instruction::GenericLoop {
+            prepare,
+            cond,
+            body,
+            update,
+        });
+        escapes
+    }
+}
+
+fn is_return(node: &NodeRef) -> bool {
+    matches!(node.get().instruction.as_ref(), Instruction::Return(_))
+}
+
 impl Transform for CanonicalizeControlFlow {
-    fn transform(&self, _module: Module) -> Module {
-        todo!()
+    fn name(&self) -> &'static str {
+        "canonicalize_control_flow"
+    }
+    fn transform(&self, module: Module) -> Module {
+        if block_has_phi(module.entry) {
+            return module;
+        }
+        let nodes = collect_nodes_recursive(module.entry);
+        let mut used = HashSet::new();
+        for node in &nodes {
+            for_each_operand(node.get().instruction.as_ref(), |op| {
+                used.insert(op);
+            });
+        }
+        // returns other than the one ending the module are lowered
+        let last = module.entry.last().get().prev;
+        let returns = nodes.iter().filter(|n| is_return(n)).collect::<Vec<_>>();
+        let ret = returns.iter().any(|n| **n != last).then(|| {
+            let mut builder = builder_after(module.entry.first(), &module.pools);
+            let value = returns
+                .iter()
+                .find_map(|n| match n.get().instruction.as_ref() {
+                    Instruction::Return(v) if v.valid() => Some(v.type_().clone()),
+                    _ => None,
+                });
+            let value = value.map(|t| builder.local_zero_init(t));
+            let false_ = builder.const_(Const::Bool(false));
+            Return {
+                flag: builder.local(false_),
+                value,
+            }
+        });
+        let lowering = Lowering {
+            pools: module.pools.clone(),
+            ret,
+            used,
+            lowered: Cell::new(0),
+            removed: Cell::new(0),
+        };
+        let targets = Targets {
+            break_: None,
+            continue_: None,
+        };
+        lowering.lower_block(module.entry, targets);
+        if let Some(ret) = &lowering.ret {
+            let mut builder = builder_at_end(module.entry, &module.pools);
+            if let Some(var) = ret.value {
+                let value = builder.load(var);
+                builder.return_(value);
+            }
+        }
+        log::debug!(
+            "Control flow canonicalization: lowered {} jump(s), removed {} node(s)",
+            lowering.lowered.get(),
+            lowering.removed.get()
+        );
+        module
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use std::collections::HashMap;
+
+    use super::*;
+    use crate::ir::{new_node, ModuleFlags, ModuleKind, Node};
+
+    #[derive(Clone, Copy, Debug, PartialEq)]
+    enum Value {
+        Int(i32),
+        Bool(bool),
+    }
+
+    enum Flow {
+        Next,
+        Break,
+        Continue,
+        Return(Option<Value>),
+    }
+
+    // evaluates the small subset of the IR used by the tests below
+    #[derive(Default)]
+    struct Interpreter {
+        values: HashMap<NodeRef, Value>,
+        steps: usize,
+    }
+
+    impl Interpreter {
+        fn int(&self, node: NodeRef) -> i32 {
+            match self.values[&node] {
+                Value::Int(v) => v,
+                v => panic!("expected an int, got {:?}", v),
+            }
+        }
+        fn bool(&self, node: NodeRef) -> bool {
+            match self.values[&node] {
+                Value::Bool(v) => v,
+                v => panic!("expected a bool, got {:?}", v),
+            }
+        }
+        fn call(&self, func: &Func, args: &[NodeRef]) -> Value {
+            match func {
+                Func::Load => self.values[&args[0]],
+                Func::ZeroInitializer => Value::Int(0),
+                Func::Not => Value::Bool(!self.bool(args[0])),
+                Func::BitAnd => Value::Bool(self.bool(args[0]) && self.bool(args[1])),
+                Func::BitOr => Value::Bool(self.bool(args[0]) || self.bool(args[1])),
+                Func::Add => Value::Int(self.int(args[0]) + self.int(args[1])),
+                Func::Mul => Value::Int(self.int(args[0]) * self.int(args[1])),
+                Func::Rem => Value::Int(self.int(args[0]) % self.int(args[1])),
+                Func::Eq => Value::Bool(self.int(args[0]) == self.int(args[1])),
+                Func::Lt => Value::Bool(self.int(args[0]) < self.int(args[1])),
+                Func::Gt => Value::Bool(self.int(args[0]) > self.int(args[1])),
+                f => panic!("unexpected function {:?}", f),
+            }
+        }
+        fn block(&mut self, block: Pooled<BasicBlock>) -> Flow {
+            for node in block.iter() {
+                match self.node(node) {
+                    Flow::Next => {}
+                    flow => return flow,
+                }
+            }
+            Flow::Next
+        }
+        fn node(&mut self, node: NodeRef) -> Flow {
+            self.steps += 1;
+            assert!(self.steps < 100000, "the program does not terminate");
+            let value = match node.get().instruction.as_ref() {
+                Instruction::Const(Const::Int32(v)) => Value::Int(*v),
+                Instruction::Const(Const::Bool(v)) => Value::Bool(*v),
+                Instruction::Local { init } => self.values[init],
+                Instruction::Update { var, value } => {
+                    self.values.insert(*var, self.values[value]);
+                    return Flow::Next;
+                }
+                Instruction::Call(func, args) => self.call(func, args.as_ref()),
+                Instruction::If {
+                    cond,
+                    true_branch,
+                    false_branch,
+                } => {
+                    return match self.bool(*cond) {
+                        true => self.block(*true_branch),
+                        false => self.block(*false_branch),
+                    }
+                }
+                Instruction::Switch {
+                    value,
+                    default,
+                    cases,
+                } => {
+                    let value = self.int(*value);
+                    let block = cases
+                        .as_ref()
+                        .iter()
+                        .find(|c| c.value == value)
+                        .map_or(*default, |c| c.block);
+                    return match self.block(block) {
+                        Flow::Break => Flow::Next,
+                        flow => flow,
+                    };
+                }
+                // loop { body; if (!cond) break; }
+                Instruction::Loop { body, cond } => loop {
+                    match self.block(*body) {
+                        Flow::Break => return Flow::Next,
+                        Flow::Return(v) => return Flow::Return(v),
+                        Flow::Continue => {}
+                        Flow::Next => {
+                            if !self.bool(*cond) {
+                                return Flow::Next;
+                            }
+                        }
+                    }
+                },
+                Instruction::GenericLoop {
+                    prepare,
+                    cond,
+                    body,
+                    update,
+                } => loop {
+                    if let Flow::Return(v) = self.block(*prepare) {
+                        return Flow::Return(v);
+                    }
+                    if !self.bool(*cond) {
+                        return Flow::Next;
+                    }
+                    match self.block(*body) {
+                        Flow::Break => return Flow::Next,
+                        Flow::Return(v) => return Flow::Return(v),
+                        _ => {}
+                    }
+                    if let Flow::Return(v) = self.block(*update) {
+                        return Flow::Return(v);
+                    }
+                },
+                Instruction::Break => return Flow::Break,
+                Instruction::Continue => return Flow::Continue,
+                Instruction::Return(v) => {
+                    return Flow::Return(v.valid().then(|| self.values[v]));
+                }
+                inst => panic!("unexpected instruction {:?}", inst),
+            };
+            self.values.insert(node, value);
+            Flow::Next
+        }
+    }
+
+    fn run(module: &Module, n: NodeRef, value: i32) -> Option<Value> {
+        let mut interpreter = Interpreter::default();
+        interpreter.values.insert(n, Value::Int(value));
+        match interpreter.block(module.entry) {
+            Flow::Return(v) => v,
+            Flow::Next => None,
+            _ => panic!("jump out of the module"),
+        }
+    }
+
+    fn int(b: &mut IrBuilder, v: i32) -> NodeRef {
+        b.const_(Const::Int32(v))
+    }
+
+    fn binary(b: &mut IrBuilder, f: Func, lhs: NodeRef, rhs: i32) -> NodeRef {
+        let rhs = int(b, rhs);
+        let t = match f {
+            Func::Eq | Func::Lt | Func::Gt => bool::type_(),
+            _ => i32::type_(),
+        };
+        b.call(f, &[lhs, rhs], t)
+    }
+
+    // var += value
+    fn add(b: &mut IrBuilder, var: NodeRef, value: NodeRef) {
+        let v = b.load(var);
+        let sum = b.call(Func::Add, &[v, value], i32::type_());
+        b.update(var, sum);
+    }
+
+    fn add_const(b: &mut IrBuilder, var: NodeRef, value: i32) {
+        let value = int(b, value);
+        add(b, var, value);
+    }
+
+    fn block(b: &IrBuilder, f: impl FnOnce(&mut IrBuilder)) -> Pooled<BasicBlock> {
+        let mut builder = IrBuilder::new(b.pools().clone());
+        f(&mut builder);
+        builder.finish()
+    }
+
+    fn if_then(b: &mut IrBuilder, cond: NodeRef, f: impl FnOnce(&mut IrBuilder)) {
+        let true_branch = block(b, f);
+        let false_branch = block(b, |_| {});
+        b.if_(cond, true_branch, false_branch);
+    }
+
+    // a callable of n that returns an int
+    fn new_module(f: impl FnOnce(&mut IrBuilder, NodeRef)) -> (Module, NodeRef) {
+        let pools = CArc::new(ModulePools::new());
+        let n = new_node(
+            &pools,
+            Node::new(CArc::new(Instruction::Uniform), i32::type_()),
+        );
+        let mut builder = IrBuilder::new(pools.clone());
+        f(&mut builder, n);
+        let module = Module {
+            kind: ModuleKind::Function,
+            entry: builder.finish(),
+            flags: ModuleFlags::NONE,
+            pools,
+        };
+        (module, n)
+    }
+
+    fn assert_canonical(module: &Module) {
+        let last = module.entry.last().get().prev;
+        for node in collect_nodes_recursive(module.entry) {
+            match node.get().instruction.as_ref() {
+                Instruction::Break | Instruction::Continue => panic!("jump left in the module"),
+                Instruction::Return(_) => assert_eq!(node, last),
+                _ => {}
+            }
+        }
+    }
+
+    fn assert_same_results(build: impl Fn() -> (Module, NodeRef), inputs: &[i32]) {
+        let (original, n) = build();
+        let (lowered, m) = build();
+        let lowered = CanonicalizeControlFlow.transform(lowered);
+        assert_canonical(&lowered);
+        let mut results = HashSet::new();
+        for &input in inputs {
+            let expected = run(&original, n, input);
+            assert_eq!(run(&lowered, m, input), expected, "n = {}", input);
+            results.insert(format!("{:?}", expected));
+        }
+        // the inputs take different paths through the module
+        assert!(results.len() > 1);
+    }
+
+    #[test]
+    fn test_lower_jumps_in_nested_loops() {
+        let build = || {
+            new_module(|b, n| {
+                let zero = int(b, 0);
+                let acc = b.local(zero);
+                let i = b.local(zero);
+                let body = block(b, |b| {
+                    add_const(b, i, 1);
+                    let iv = b.load(i);
+                    let r = binary(b, Func::Rem, iv, 3);
+                    let c = binary(b, Func::Eq, r, 0);
+                    if_then(b, c, |b| {
+                        b.continue_();
+                    });
+                    let zero = int(b, 0);
+                    let j = b.local(zero);
+                    let mut cond = INVALID_REF;
+                    let prepare = block(b, |b| {
+                        let jv = b.load(j);
+                        cond = binary(b, Func::Lt, jv, 6);
+                    });
+                    let inner = block(b, |b| {
+                        add_const(b, j, 1);
+                        let jv = b.load(j);
+                        let iv = b.load(i);
+                        let c = b.call(Func::Eq, &[jv, iv], bool::type_());
+                        if_then(b, c, |b| {
+                            b.break_();
+                        });
+                        let s = b.call(Func::Add, &[iv, jv], i32::type_());
+                        let r = binary(b, Func::Rem, s, 2);
+                        let c = binary(b, Func::Eq, r, 0);
+                        if_then(b, c, |b| {
+                            b.continue_();
+                        });
+                        add(b, acc, jv);
+                        let av = b.load(acc);
+                        let c = b.call(Func::Gt, &[av, n], bool::type_());
+                        if_then(b, c, |b| {
+                            let r = binary(b, Func::Mul, av, 100);
+                            b.return_(r);
+                        });
+                    });
+                    let update = block(b, |b| add_const(b, acc, 1));
+                    b.generic_loop(prepare, cond, inner, update);
+                    add_const(b, acc, 10);
+                    let iv = b.load(i);
+                    binary(b, Func::Lt, iv, 8);
+                });
+                let cond = body.last().get().prev;
+                b.loop_(body, cond);
+                let av = b.load(acc);
+                b.return_(av);
+            })
+        };
+        assert_same_results(build, &[0, 7, 30, 100, 10000]);
+    }
+
+    #[test]
+    fn test_lower_jumps_in_switch() {
+        let build = || {
+            new_module(|b, n| {
+                let zero = int(b, 0);
+                let acc = b.local(zero);
+                let i = b.local(zero);
+                let body = block(b, |b| {
+                    add_const(b, i, 1);
+                    let iv = b.load(i);
+                    // break leaves the switch
+                    let case0 = block(b, |b| {
+                        let c = binary(b, Func::Eq, iv, 4);
+                        if_then(b, c, |b| {
+                            b.break_();
+                        });
+                        add_const(b, acc, 1);
+                    });
+                    // continue skips the rest of the loop body
+                    let case1 = block(b, |b| {
+                        let c = binary(b, Func::Eq, iv, 5);
+                        if_then(b, c, |b| {
+                            b.continue_();
+                        });
+                        add_const(b, acc, 2);
+                    });
+                    let case2 = block(b, |b| {
+                        let av = b.load(acc);
+                        let c = b.call(Func::Gt, &[av, n], bool::type_());
+                        if_then(b, c, |b| {
+                            let r = binary(b, Func::Add, av, 1000);
+                            b.return_(r);
+                        });
+                        add_const(b, acc, 4);
+                    });
+                    let default = block(b, |b| {
+                        add_const(b, acc, 8);
+                        b.break_();
+                        add_const(b, acc, 1000);
+                    });
+                    let cases = [(0, case0), (1, case1), (2, case2)]
+                        .map(|(value, block)| SwitchCase { value, block });
+                    let r = binary(b, Func::Rem, iv, 4);
+                    b.switch(r, &cases, default);
+                    add_const(b, acc, 16);
+                    let iv = b.load(i);
+                    binary(b, Func::Lt, iv, 10);
+                });
+                let cond = body.last().get().prev;
+                b.loop_(body, cond);
+                let av = b.load(acc);
+                b.return_(av);
+            })
+        };
+        assert_same_results(build, &[0, 5, 20, 60, 10000]);
     }
 }
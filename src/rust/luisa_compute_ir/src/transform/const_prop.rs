@@ -0,0 +1,320 @@
+/*
+Constant propagation.
+  - Scalar arithmetic, bitwise, comparison and cast operations on constants are
+    folded into constants in place.
+  - Locals that are never written after initialization and whose uses are all
+    loads or pure calls are forwarded to their initial value.
+  - `if` statements with a constant condition are replaced by the taken branch.
+    This step is skipped for modules in SSA form, since phi nodes refer to the
+    branches as incoming blocks.
+Folding never introduces undefined behavior: integer arithmetic wraps, and
+division/remainder by zero and over-wide shifts are left untouched.
+*/
+use std::collections::HashMap;
+
+use crate::ir::{Const, Func, Instruction, Module, NodeRef, Primitive, Type};
+use crate::transform::utils::{
+    block_has_phi, collect_nodes_recursive, for_each_operand, is_pure_func, is_value, replace_uses,
+};
+use crate::transform::Transform;
+use crate::CArc;
+
+pub struct ConstantPropagation;
+
+#[derive(Clone, Copy, Debug, PartialEq)]
+enum Scalar {
+    Bool(bool),
+    I32(i32),
+    U32(u32),
+    I64(i64),
+    U64(u64),
+    F32(f32),
+    F64(f64),
+}
+
+impl Scalar {
+    fn from_const(c: &Const) -> Option<Self> {
+        match c {
+            Const::Bool(v) => Some(Scalar::Bool(*v)),
+            Const::Int32(v) => Some(Scalar::I32(*v)),
+            Const::Uint32(v) => Some(Scalar::U32(*v)),
+            Const::Int64(v) => Some(Scalar::I64(*v)),
+            Const::Uint64(v) => Some(Scalar::U64(*v)),
+            Const::Float32(v) => Some(Scalar::F32(*v)),
+            Const::Float64(v) => Some(Scalar::F64(*v)),
+            Const::Zero(t) | Const::One(t) => {
+                let one = matches!(c, Const::One(_));
+                match t.as_ref() {
+                    Type::Primitive(p) => Scalar::from_f64(*p, if one { 1.0 } else { 0.0 }),
+                    _ => None,
+                }
+            }
+            _ => None,
+        }
+    }
+    fn from_f64(p: Primitive, v: f64) -> Option<Self> {
+        match p {
+            Primitive::Bool => Some(Scalar::Bool(v != 0.0)),
+            Primitive::Int32 => Some(Scalar::I32(v as i32)),
+            Primitive::Uint32 => Some(Scalar::U32(v as u32)),
+            Primitive::Int64 => Some(Scalar::I64(v as i64)),
+            Primitive::Uint64 => Some(Scalar::U64(v as u64)),
+            Primitive::Float32 => Some(Scalar::F32(v as f32)),
+            Primitive::Float64 => Some(Scalar::F64(v)),
+            _ => None,
+        }
+    }
+    fn to_const(self) -> Const {
+        match self {
+            Scalar::Bool(v) => Const::Bool(v),
+            Scalar::I32(v) => Const::Int32(v),
+            Scalar::U32(v) => Const::Uint32(v),
+            Scalar::I64(v) => Const::Int64(v),
+            Scalar::U64(v) => Const::Uint64(v),
+            Scalar::F32(v) => Const::Float32(v),
+            Scalar::F64(v) => Const::Float64(v),
+        }
+    }
+    fn cast(self, p: Primitive) -> Option<Self> {
+        macro_rules! cast_to {
+            ($v:expr) => {
+                match p {
+                    Primitive::Bool => Some(Scalar::Bool(($v as f64) != 0.0)),
+                    Primitive::Int32 => Some(Scalar::I32($v as i32)),
+                    Primitive::Uint32 => Some(Scalar::U32($v as u32)),
+                    Primitive::Int64 => Some(Scalar::I64($v as i64)),
+                    Primitive::Uint64 => Some(Scalar::U64($v as u64)),
+                    Primitive::Float32 => Some(Scalar::F32($v as f32)),
+                    Primitive::Float64 => Some(Scalar::F64($v as f64)),
+                    _ => None,
+                }
+            };
+        }
+        match self {
+            Scalar::Bool(v) => cast_to!(v as u8),
+            Scalar::I32(v) => cast_to!(v),
+            Scalar::U32(v) => cast_to!(v),
+            Scalar::I64(v) => cast_to!(v),
+            Scalar::U64(v) => cast_to!(v),
+            // float to integer conversion of out-of-range values differs between backends
+            Scalar::F32(v) if matches!(p, Primitive::Float32 | Primitive::Float64) => cast_to!(v),
+            Scalar::F64(v) if matches!(p, Primitive::Float32 | Primitive::Float64) => cast_to!(v),
+            Scalar::F32(_) | Scalar::F64(_) => None,
+        }
+    }
+}
+
+fn fold_unary(f: &Func, a: Scalar) -> Option<Scalar> {
+    use Scalar::*;
+    match (f, a) {
+        (Func::Neg, I32(a)) => Some(I32(a.wrapping_neg())),
+        (Func::Neg, I64(a)) => Some(I64(a.wrapping_neg())),
+        (Func::Neg, F32(a)) => Some(F32(-a)),
+        (Func::Neg, F64(a)) => Some(F64(-a)),
+        (Func::Not, Bool(a)) => Some(Bool(!a)),
+        (Func::BitNot, I32(a)) => Some(I32(!a)),
+        (Func::BitNot, U32(a)) => Some(U32(!a)),
+        (Func::BitNot, I64(a)) => Some(I64(!a)),
+        (Func::BitNot, U64(a)) => Some(U64(!a)),
+        _ => None,
+    }
+}
+
+macro_rules! fold_int {
+    ($f:expr, $a:expr, $b:expr, $ctor:path, $bits:expr) => {
+        match $f {
+            Func::Add => Some($ctor($a.wrapping_add($b))),
+            Func::Sub => Some($ctor($a.wrapping_sub($b))),
+            Func::Mul => Some($ctor($a.wrapping_mul($b))),
+            Func::Div if $b != 0 => Some($ctor($a.wrapping_div($b))),
+            Func::Rem if $b != 0 => Some($ctor($a.wrapping_rem($b))),
+            Func::BitAnd => Some($ctor($a & $b)),
+            Func::BitOr => Some($ctor($a | $b)),
+            Func::BitXor => Some($ctor($a ^ $b)),
+            Func::Shl if ($b as u64) < $bits => Some($ctor($a << $b)),
+            Func::Shr if ($b as u64) < $bits => Some($ctor($a >> $b)),
+            Func::Min => Some($ctor($a.min($b))),
+            Func::Max => Some($ctor($a.max($b))),
+            Func::Eq => Some(Scalar::Bool($a == $b)),
+            Func::Ne => Some(Scalar::Bool($a != $b)),
+            Func::Lt => Some(Scalar::Bool($a < $b)),
+            Func::Le => Some(Scalar::Bool($a <= $b)),
+            Func::Gt => Some(Scalar::Bool($a > $b)),
+            Func::Ge => Some(Scalar::Bool($a >= $b)),
+            _ => None,
+        }
+    };
+}
+
+macro_rules! fold_float {
+    ($f:expr, $a:expr, $b:expr, $ctor:path) => {
+        match $f {
+            Func::Add => Some($ctor($a + $b)),
+            Func::Sub => Some($ctor($a - $b)),
+            Func::Mul => Some($ctor($a * $b)),
+            Func::Div => Some($ctor($a / $b)),
+            Func::Min => Some($ctor($a.min($b))),
+            Func::Max => Some($ctor($a.max($b))),
+            Func::Eq => Some(Scalar::Bool($a == $b)),
+            Func::Ne => Some(Scalar::Bool($a != $b)),
+            Func::Lt => Some(Scalar::Bool($a < $b)),
+            Func::Le => Some(Scalar::Bool($a <= $b)),
+            Func::Gt => Some(Scalar::Bool($a > $b)),
+            Func::Ge => Some(Scalar::Bool($a >= $b)),
+            _ => None,
+        }
+    };
+}
+
+fn fold_binary(f: &Func, a: Scalar, b: Scalar) -> Option<Scalar> {
+    use Scalar::*;
+    match (a, b) {
+        (I32(a), I32(b)) => fold_int!(f, a, b, I32, 32),
+        (U32(a), U32(b)) => fold_int!(f, a, b, U32, 32),
+        (I64(a), I64(b)) => fold_int!(f, a, b, I64, 64),
+        (U64(a), U64(b)) => fold_int!(f, a, b, U64, 64),
+        (F32(a), F32(b)) => fold_float!(f, a, b, F32),
+        (F64(a), F64(b)) => fold_float!(f, a, b, F64),
+        (Bool(a), Bool(b)) => match f {
+            Func::BitAnd => Some(Bool(a & b)),
+            Func::BitOr => Some(Bool(a | b)),
+            Func::BitXor | Func::Ne => Some(Bool(a ^ b)),
+            Func::Eq => Some(Bool(a == b)),
+            _ => None,
+        },
+        _ => None,
+    }
+}
+
+fn const_of(node: NodeRef) -> Option<Scalar> {
+    match node.get().instruction.as_ref() {
+        Instruction::Const(c) => Scalar::from_const(c),
+        _ => None,
+    }
+}
+
+fn try_fold(node: NodeRef) -> Option<Const> {
+    let (f, args) = match node.get().instruction.as_ref() {
+        Instruction::Call(f, args) => (f.clone(), args.as_ref().to_vec()),
+        _ => return None,
+    };
+    let folded = match (&f, args.as_slice()) {
+        (Func::Cast, [a]) => match node.type_().as_ref() {
+            Type::Primitive(p) => const_of(*a)?.cast(*p),
+            _ => None,
+        },
+        (_, [a]) => fold_unary(&f, const_of(*a)?),
+        (_, [a, b]) => fold_binary(&f, const_of(*a)?, const_of(*b)?),
+        _ => None,
+    }?
+    .to_const();
+    // the folded constant must have exactly the node's type
+    (folded.type_() == *node.type_()).then_some(folded)
+}
+
+fn fold_constants(module: &Module) -> usize {
+    let mut folded = 0;
+    // pre-order visits operands before their users, so chains fold in one sweep
+    for node in collect_nodes_recursive(module.entry) {
+        if let Some(c) = try_fold(node) {
+            node.get_mut().instruction = CArc::new(Instruction::Const(c));
+            folded += 1;
+        }
+    }
+    folded
+}
+
+fn forward_locals(module: &Module) -> usize {
+    let nodes = collect_nodes_recursive(module.entry);
+    // local -> (forwardable, loads)
+    let mut locals: HashMap<NodeRef, (bool, Vec<NodeRef>)> = HashMap::new();
+    for node in &nodes {
+        if let Instruction::Local { init } = node.get().instruction.as_ref() {
+            locals.insert(*node, (is_value(*init), Vec::new()));
+        }
+    }
+    if locals.is_empty() {
+        return 0;
+    }
+    for node in &nodes {
+        let inst = node.get().instruction.as_ref();
+        let pure_call = match inst {
+            Instruction::Call(f, _) => *f == Func::Load || is_pure_func(f),
+            _ => false,
+        };
+        for_each_operand(inst, |op| {
+            if let Some((forwardable, loads)) = locals.get_mut(&op) {
+                if !pure_call {
+                    *forwardable = false;
+                } else if let Instruction::Call(Func::Load, _) = inst {
+                    loads.push(*node);
+                }
+            }
+        });
+    }
+    let mut replacements = HashMap::new();
+    for (local, (forwardable, loads)) in &locals {
+        if !*forwardable {
+            continue;
+        }
+        let init = match local.get().instruction.as_ref() {
+            Instruction::Local { init } => *init,
+            _ => unreachable!(),
+        };
+        replacements.insert(*local, init);
+        for load in loads {
+            replacements.insert(*load, init);
+        }
+    }
+    replace_uses(module.entry, &replacements);
+    replacements.len()
+}
+
+fn fold_branches(module: &Module) -> usize {
+    if block_has_phi(module.entry) {
+        return 0;
+    }
+    let mut folded = 0;
+    for node in collect_nodes_recursive(module.entry) {
+        if !node.is_linked() {
+            continue;
+        }
+        let taken = match node.get().instruction.as_ref() {
+            Instruction::If {
+                cond,
+                true_branch,
+                false_branch,
+            } => match const_of(*cond) {
+                Some(Scalar::Bool(c)) => Some(if c { *true_branch } else { *false_branch }),
+                _ => None,
+            },
+            _ => None,
+        };
+        if let Some(taken) = taken {
+            for n in taken.into_vec() {
+                node.insert_before_self(n);
+            }
+            node.remove();
+            folded += 1;
+        }
+    }
+    folded
+}
+
+impl Transform for ConstantPropagation {
+    fn name(&self) -> &'static str {
+        "const_prop"
+    }
+    fn transform(&self, module: Module) -> Module {
+        let forwarded = forward_locals(&module);
+        let folded = fold_constants(&module);
+        let branches = fold_branches(&module);
+        log::debug!(
+            "Constant propagation: forwarded {} local(s)/load(s), folded {} node(s) and {} branch(es)",
+            forwarded,
+            folded,
+            branches
+        );
+        module
+    }
+}
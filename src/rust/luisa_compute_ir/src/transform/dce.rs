@@ -0,0 +1,56 @@
+/*
+Dead code elimination.
+Removes constants, pure calls, loads, phis and locals whose results are never used.
+Nodes are visited in reverse pre-order so that chains of dead nodes are removed
+in a single pass.
+*/
+use std::collections::HashMap;
+
+use crate::ir::{Func, Instruction, Module, NodeRef};
+use crate::transform::utils::{collect_nodes_recursive, for_each_operand, is_pure_func};
+use crate::transform::Transform;
+
+pub struct DeadCodeElimination;
+
+fn is_removable(node: NodeRef) -> bool {
+    match node.get().instruction.as_ref() {
+        Instruction::Const(_) | Instruction::Phi(_) | Instruction::Local { .. } => true,
+        Instruction::Call(f, _) => *f == Func::Load || is_pure_func(f),
+        _ => false,
+    }
+}
+
+pub(crate) fn eliminate_dead_code(module: &Module) -> usize {
+    let nodes = collect_nodes_recursive(module.entry);
+    let mut uses: HashMap<NodeRef, usize> = HashMap::new();
+    for node in &nodes {
+        for_each_operand(node.get().instruction.as_ref(), |op| {
+            *uses.entry(op).or_insert(0) += 1;
+        });
+    }
+    let mut removed = 0;
+    for node in nodes.iter().rev() {
+        if uses.get(node).copied().unwrap_or(0) != 0 || !is_removable(*node) {
+            continue;
+        }
+        for_each_operand(node.get().instruction.as_ref(), |op| {
+            if let Some(count) = uses.get_mut(&op) {
+                *count -= 1;
+            }
+        });
+        node.remove();
+        removed += 1;
+    }
+    removed
+}
+
+impl Transform for DeadCodeElimination {
+    fn name(&self) -> &'static str {
+        "dce"
+    }
+    fn transform(&self, module: Module) -> Module {
+        let removed = eliminate_dead_code(&module);
+        log::debug!("DCE: removed {} node(s)", removed);
+        module
+    }
+}
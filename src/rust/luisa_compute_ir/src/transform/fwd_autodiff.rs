@@ -707,6 +707,12 @@ fn ad_transform_recursive(block: Pooled<BasicBlock>, pools: &CArc<ModulePools>)
 }
 
 impl Transform for FwdAutodiff {
+    fn name(&self) -> &'static str {
+        "fwd_autodiff"
+    }
+    fn is_required(&self, module: &crate::ir::Module) -> bool {
+        module.flags.contains(ModuleFlags::REQUIRES_FWD_AD_TRANSFORM)
+    }
     fn transform(&self, mut module: crate::ir::Module) -> crate::ir::Module {
         // log::debug!("FwdAutodiff transform");
         // {
@@ -0,0 +1,97 @@
+/*
+Global value numbering.
+Pure calls and constants that compute the same value as a dominating node are
+replaced by that node. Dominance follows the structured control flow: a node
+dominates the rest of its block and all blocks nested therein. Calls are only
+numbered when all of their arguments are values (not memory locations), since
+implicit loads from locals may observe different contents.
+Break and continue only leave the rest of the current iteration, so a node that
+is reached still has all its structural dominators executed before it. The
+blocks of a loop get separate scopes, since continue may skip from the middle of
+the body to the update block.
+The replaced nodes are left dead and are removed by DCE.
+*/
+use std::collections::HashMap;
+
+use crate::context::type_hash;
+use crate::ir::{BasicBlock, Func, Instruction, Module, NodeRef};
+use crate::transform::utils::{for_each_block, is_pure_func, is_value, replace_uses};
+use crate::transform::Transform;
+use crate::Pooled;
+
+pub struct GlobalValueNumbering;
+
+#[derive(Clone, PartialEq, Eq, Hash)]
+enum ValueKey {
+    Const(u64, String),
+    Call(u64, Func, Vec<NodeRef>),
+}
+
+struct Gvn {
+    scopes: Vec<HashMap<ValueKey, NodeRef>>,
+    replacements: HashMap<NodeRef, NodeRef>,
+}
+
+impl Gvn {
+    fn resolve(&self, node: NodeRef) -> NodeRef {
+        let mut node = node;
+        while let Some(r) = self.replacements.get(&node) {
+            node = *r;
+        }
+        node
+    }
+    fn key(&self, node: NodeRef) -> Option<ValueKey> {
+        let ty = type_hash(node.type_());
+        match node.get().instruction.as_ref() {
+            Instruction::Const(c) => Some(ValueKey::Const(ty, format!("{:?}", c))),
+            Instruction::Call(f, args) => {
+                if !is_pure_func(f) || !args.as_ref().iter().all(|a| is_value(*a)) {
+                    return None;
+                }
+                let args = args.as_ref().iter().map(|a| self.resolve(*a)).collect();
+                Some(ValueKey::Call(ty, f.clone(), args))
+            }
+            _ => None,
+        }
+    }
+    fn lookup(&self, key: &ValueKey) -> Option<NodeRef> {
+        self.scopes.iter().rev().find_map(|s| s.get(key).copied())
+    }
+    fn visit_block(&mut self, block: Pooled<BasicBlock>) {
+        self.scopes.push(HashMap::new());
+        for node in block.iter() {
+            if let Some(key) = self.key(node) {
+                match self.lookup(&key) {
+                    Some(existing) => {
+                        self.replacements.insert(node, existing);
+                    }
+                    None => {
+                        self.scopes.last_mut().unwrap().insert(key, node);
+                    }
+                }
+            }
+            let mut nested = Vec::new();
+            for_each_block(node.get().instruction.as_ref(), |b| nested.push(b));
+            for b in nested {
+                self.visit_block(b);
+            }
+        }
+        self.scopes.pop();
+    }
+}
+
+impl Transform for GlobalValueNumbering {
+    fn name(&self) -> &'static str {
+        "gvn"
+    }
+    fn transform(&self, module: Module) -> Module {
+        let mut gvn = Gvn {
+            scopes: Vec::new(),
+            replacements: HashMap::new(),
+        };
+        gvn.visit_block(module.entry);
+        log::debug!("GVN: replaced {} redundant node(s)", gvn.replacements.len());
+        replace_uses(module.entry, &gvn.replacements);
+        module
+    }
+}
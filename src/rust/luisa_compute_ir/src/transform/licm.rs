@@ -0,0 +1,84 @@
+/*
+Loop invariant code motion.
+Constants and speculatable pure calls at the top level of a loop body (and of
+the prepare block of a generic loop) are moved in front of the loop when all
+of their arguments are values defined outside the loop. Inner loops are
+processed first so that invariants can bubble up through several loop levels.
+Speculatable calls may run even if a break or continue would have skipped them,
+and nodes in nested blocks (e.g. in front of a break) are never hoisted.
+*/
+use std::collections::HashSet;
+
+use crate::ir::{BasicBlock, Instruction, Module, NodeRef};
+use crate::transform::utils::{
+    collect_nodes_recursive, for_each_block, is_speculatable_func, is_value,
+};
+use crate::transform::Transform;
+use crate::Pooled;
+
+pub struct LoopInvariantCodeMotion;
+
+fn is_hoistable(node: NodeRef, defined_in_loop: &HashSet<NodeRef>) -> bool {
+    match node.get().instruction.as_ref() {
+        Instruction::Const(_) => true,
+        Instruction::Call(f, args) => {
+            is_speculatable_func(f)
+                && args
+                    .as_ref()
+                    .iter()
+                    .all(|a| is_value(*a) && !defined_in_loop.contains(a))
+        }
+        _ => false,
+    }
+}
+
+fn hoist(loop_node: NodeRef, blocks: &[Pooled<BasicBlock>], all_blocks: &[Pooled<BasicBlock>]) -> usize {
+    let mut defined_in_loop: HashSet<NodeRef> = all_blocks
+        .iter()
+        .flat_map(|b| collect_nodes_recursive(*b))
+        .collect();
+    let mut hoisted = 0;
+    for block in blocks {
+        for node in block.nodes() {
+            if is_hoistable(node, &defined_in_loop) {
+                node.remove();
+                loop_node.insert_before_self(node);
+                defined_in_loop.remove(&node);
+                hoisted += 1;
+            }
+        }
+    }
+    hoisted
+}
+
+fn visit_block(block: Pooled<BasicBlock>) -> usize {
+    let mut hoisted = 0;
+    for node in block.nodes() {
+        let mut nested = Vec::new();
+        for_each_block(node.get().instruction.as_ref(), |b| nested.push(b));
+        for b in &nested {
+            hoisted += visit_block(*b);
+        }
+        match node.get().instruction.as_ref() {
+            Instruction::Loop { body, .. } => {
+                hoisted += hoist(node, &[*body], &nested);
+            }
+            Instruction::GenericLoop { prepare, body, .. } => {
+                hoisted += hoist(node, &[*prepare, *body], &nested);
+            }
+            _ => {}
+        }
+    }
+    hoisted
+}
+
+impl Transform for LoopInvariantCodeMotion {
+    fn name(&self) -> &'static str {
+        "licm"
+    }
+    fn transform(&self, module: Module) -> Module {
+        let hoisted = visit_block(module.entry);
+        log::debug!("LICM: hoisted {} node(s)", hoisted);
+        module
+    }
+}
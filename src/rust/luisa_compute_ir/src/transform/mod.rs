@@ -7,35 +7,130 @@ pub mod vectorize;
 pub mod fwd_autodiff;
 pub mod ref2ret;
 pub mod reg2mem;
+pub mod pass_manager;
+pub mod const_prop;
+pub mod dce;
+pub mod gvn;
+pub mod licm;
+mod utils;
 
-use crate::ir::{self, ModuleFlags};
+use std::time::Instant;
+
+use crate::ir;
+use crate::{CArc, CBoxedSlice};
 use bitflags::Flags;
 
 pub trait Transform {
     fn transform(&self, module: ir::Module) -> ir::Module;
+    // name used in timing statistics and as part of the callable cache key
+    fn name(&self) -> &'static str {
+        std::any::type_name::<Self>()
+    }
+    // returns false if the effect of this transform is already present in the module
+    fn is_required(&self, _module: &ir::Module) -> bool {
+        true
+    }
 }
 
 pub struct TransformPipeline {
     transforms: Vec<Box<dyn Transform>>,
+    // transformed callables, only valid for the current sequence of passes
+    callables: pass_manager::CallableCache,
 }
+// devices keep one pipeline for all their kernels and only use it under a lock,
+// so the cached modules are never accessed from two threads at once
+unsafe impl Send for TransformPipeline {}
 impl TransformPipeline {
     pub fn new() -> Self {
         Self {
             transforms: Vec::new(),
+            callables: pass_manager::CallableCache::default(),
         }
     }
     pub fn add_transform(&mut self, transform: Box<dyn Transform>) {
         self.transforms.push(transform);
+        self.callables.clear();
+    }
+    pub fn callable_cache(&self) -> &pass_manager::CallableCache {
+        &self.callables
+    }
+    // the passes rewrite the nodes in place, so they run on a deep copy of the callable
+    // (and its callees) and the module passed in is left untouched
+    pub fn transform_callable(&self, module: &ir::CallableModule) -> CArc<ir::CallableModule> {
+        let start = Instant::now();
+        let content_hash = pass_manager::callable_module_hash(module);
+        if let Some(cached) = self.callables.lookup(content_hash, start.elapsed()) {
+            log::debug!(
+                "Callable module {:016x} found in transform cache",
+                content_hash
+            );
+            return cached;
+        }
+        let copy = ir::duplicate_callable_module(module);
+        let transformed = CArc::new(ir::CallableModule {
+            module: self.transform(copy.module),
+            ..copy
+        });
+        self.callables.insert(content_hash, transformed.clone());
+        transformed
+    }
+    // replaces the callees of the module by their transformed versions, so that
+    // the callables shared by the kernels of a pipeline are transformed only once
+    fn transform_callees(&self, module: &ir::Module) {
+        for node in utils::collect_nodes_recursive(module.entry) {
+            let transformed = match node.get().instruction.as_ref() {
+                ir::Instruction::Call(ir::Func::Callable(callee), args) => ir::Instruction::Call(
+                    ir::Func::Callable(ir::CallableModuleRef(
+                        self.transform_callable(callee.0.as_ref()),
+                    )),
+                    args.clone(),
+                ),
+                _ => continue,
+            };
+            node.get_mut().instruction = CArc::new(transformed);
+        }
     }
 }
 impl Transform for TransformPipeline {
     fn transform(&self, module: ir::Module) -> ir::Module {
+        if self.transforms.is_empty() {
+            return module;
+        }
+        self.transform_callees(&module);
         let mut module = module;
         for transform in &self.transforms {
+            let name = transform.name();
+            if !transform.is_required(&module) {
+                log::debug!("Transform {} skipped", name);
+                pass_manager::record_pass(name, None);
+                continue;
+            }
+            let start = Instant::now();
             module = transform.transform(module);
+            let elapsed = start.elapsed();
+            log::debug!(
+                "Transform {} done in {:.3}ms",
+                name,
+                elapsed.as_secs_f64() * 1e3
+            );
+            pass_manager::record_pass(name, Some(elapsed));
         }
         module
     }
+    fn name(&self) -> &'static str {
+        "pipeline"
+    }
+}
+
+// the default optimization sequence, also available as "optimize" in the C API
+pub fn optimization_passes() -> Vec<Box<dyn Transform>> {
+    vec![
+        Box::new(const_prop::ConstantPropagation),
+        Box::new(canonicalize_control_flow::CanonicalizeControlFlow),
+        Box::new(gvn::GlobalValueNumbering),
+        Box::new(licm::LoopInvariantCodeMotion),
+        Box::new(dce::DeadCodeElimination),
+    ]
 }
 
 #[no_mangle]
@@ -69,6 +164,10 @@ pub extern "C" fn luisa_compute_ir_transform_pipeline_add_transform(
             let transform = autodiff::Autodiff;
             unsafe { (*pipeline).add_transform(Box::new(transform)) };
         }
+        "fwd_autodiff" => {
+            let transform = fwd_autodiff::FwdAutodiff;
+            unsafe { (*pipeline).add_transform(Box::new(transform)) };
+        }
         "ref2ret" => {
             let transform = ref2ret::Ref2Ret;
             unsafe { (*pipeline).add_transform(Box::new(transform)) };
@@ -77,6 +176,27 @@ pub extern "C" fn luisa_compute_ir_transform_pipeline_add_transform(
             let transform = reg2mem::Reg2Mem;
             unsafe { (*pipeline).add_transform(Box::new(transform)) };
         }
+        "const_prop" => {
+            let transform = const_prop::ConstantPropagation;
+            unsafe { (*pipeline).add_transform(Box::new(transform)) };
+        }
+        "gvn" => {
+            let transform = gvn::GlobalValueNumbering;
+            unsafe { (*pipeline).add_transform(Box::new(transform)) };
+        }
+        "licm" => {
+            let transform = licm::LoopInvariantCodeMotion;
+            unsafe { (*pipeline).add_transform(Box::new(transform)) };
+        }
+        "dce" => {
+            let transform = dce::DeadCodeElimination;
+            unsafe { (*pipeline).add_transform(Box::new(transform)) };
+        }
+        "optimize" => {
+            for transform in optimization_passes() {
+                unsafe { (*pipeline).add_transform(transform) };
+            }
+        }
         _ => panic!("unknown transform {}", name),
     }
 }
@@ -88,6 +208,58 @@ pub extern "C" fn luisa_compute_ir_transform_pipeline_transform(
 ) -> ir::Module {
     unsafe { (*pipeline).transform(module) }
 }
+
+/// Replaces the callable module by its transformed version. Structurally identical
+/// callables that went through the same pipeline before are looked up in the cache of
+/// the pipeline. The caller gets its own copy, so the cached module is never modified.
+#[no_mangle]
+pub extern "C" fn luisa_compute_ir_transform_pipeline_transform_callable(
+    pipeline: *mut TransformPipeline,
+    module: *mut ir::CallableModule,
+) {
+    unsafe {
+        let transformed = (*pipeline).transform_callable(&*module);
+        *module = ir::duplicate_callable_module(&transformed);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn luisa_compute_ir_transform_pipeline_clear_cache(
+    pipeline: *mut TransformPipeline,
+) {
+    unsafe { (*pipeline).callables.clear() }
+}
+
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct TransformCacheStatistics {
+    pub hits: usize,
+    pub misses: usize,
+}
+
+/// Lookups in the callable cache of the pipeline since it was created.
+#[no_mangle]
+pub extern "C" fn luisa_compute_ir_transform_pipeline_cache_statistics(
+    pipeline: *const TransformPipeline,
+) -> TransformCacheStatistics {
+    let stats = unsafe { (*pipeline).callables.statistics() };
+    TransformCacheStatistics {
+        hits: stats.hits,
+        misses: stats.misses,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn luisa_compute_ir_transform_statistics_report() -> CBoxedSlice<u8> {
+    let report = std::ffi::CString::new(pass_manager::report()).unwrap();
+    CBoxedSlice::new(report.as_bytes().to_vec())
+}
+
+#[no_mangle]
+pub extern "C" fn luisa_compute_ir_transform_statistics_reset() {
+    pass_manager::reset_statistics();
+}
+
 #[no_mangle]
 pub extern "C" fn luisa_compute_ir_transform_pipeline_destroy(pipeline: *mut TransformPipeline) {
     unsafe {
@@ -97,14 +269,347 @@ pub extern "C" fn luisa_compute_ir_transform_pipeline_destroy(pipeline: *mut Tra
 
 #[no_mangle]
 pub extern "C" fn luisa_compute_ir_transform_auto(module: ir::Module) -> ir::Module {
-    let flags = module.flags;
-    // dbg!(flags);
+    // the passes check the module flags themselves and are skipped when not needed
     let mut pipeline = TransformPipeline::new();
-    if flags.contains(ModuleFlags::REQUIRES_REV_AD_TRANSFORM) {
-        pipeline.add_transform(Box::new(autodiff::Autodiff));
+    pipeline.add_transform(Box::new(autodiff::Autodiff));
+    pipeline.add_transform(Box::new(fwd_autodiff::FwdAutodiff));
+    pipeline.transform(module)
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::ir::{
+        Const, Func, Instruction, IrBuilder, ModuleFlags, ModuleKind, ModulePools, NodeRef,
+    };
+    use crate::TypeOf;
+    use std::cell::Cell;
+    use std::rc::Rc;
+
+    fn new_module(entry: crate::Pooled<ir::BasicBlock>, pools: CArc<ModulePools>) -> ir::Module {
+        ir::Module {
+            kind: ModuleKind::Function,
+            entry,
+            flags: ModuleFlags::NONE,
+            pools,
+        }
     }
-    if flags.contains(ModuleFlags::REQUIRES_FWD_AD_TRANSFORM) {
-        pipeline.add_transform(Box::new(fwd_autodiff::FwdAutodiff));
+
+    // x -> f(x) with some dead code, where f is the callee or x + 1 without one
+    fn new_callable(op: Func, callee: Option<CArc<ir::CallableModule>>) -> ir::CallableModule {
+        let pools = CArc::new(ModulePools::new());
+        let x = ir::new_node(
+            &pools,
+            ir::Node::new(
+                CArc::new(Instruction::Argument { by_value: true }),
+                i32::type_(),
+            ),
+        );
+        let mut builder = IrBuilder::new(pools.clone());
+        let one = builder.const_(Const::Int32(1));
+        let two = builder.const_(Const::Int32(2));
+        let _dead = builder.call(op.clone(), &[one, two], i32::type_());
+        let y = match callee {
+            Some(callee) => builder.call(
+                Func::Callable(ir::CallableModuleRef(callee)),
+                &[x],
+                i32::type_(),
+            ),
+            None => builder.call(op, &[x, one], i32::type_()),
+        };
+        builder.return_(y);
+        ir::CallableModule {
+            module: new_module(builder.finish(), pools.clone()),
+            ret_type: i32::type_(),
+            args: CBoxedSlice::new(vec![x]),
+            captures: CBoxedSlice::new(vec![]),
+            cpu_custom_ops: CBoxedSlice::new(vec![]),
+            pools,
+        }
+    }
+
+    struct CountingTransform {
+        runs: Rc<Cell<usize>>,
+        required: bool,
+    }
+
+    impl Transform for CountingTransform {
+        fn transform(&self, module: ir::Module) -> ir::Module {
+            self.runs.set(self.runs.get() + 1);
+            module
+        }
+        fn name(&self) -> &'static str {
+            "counting"
+        }
+        fn is_required(&self, _module: &ir::Module) -> bool {
+            self.required
+        }
+    }
+
+    #[test]
+    fn test_callable_cache_hits_structurally_equal_callables() {
+        let runs = Rc::new(Cell::new(0));
+        let mut pipeline = TransformPipeline::new();
+        pipeline.add_transform(Box::new(CountingTransform {
+            runs: runs.clone(),
+            required: true,
+        }));
+        // built independently, down to the callees
+        let a = new_callable(Func::Add, Some(CArc::new(new_callable(Func::Add, None))));
+        let b = new_callable(Func::Add, Some(CArc::new(new_callable(Func::Add, None))));
+        let c = new_callable(Func::Add, Some(CArc::new(new_callable(Func::Sub, None))));
+        // the callee goes through the pipeline (and the cache) as well
+        let ta = pipeline.transform_callable(&a);
+        let tb = pipeline.transform_callable(&b);
+        assert_eq!(runs.get(), 2);
+        assert_eq!(ta.as_ptr(), tb.as_ptr());
+        // differs only in the callee
+        let tc = pipeline.transform_callable(&c);
+        assert_eq!(runs.get(), 4);
+        assert_ne!(ta.as_ptr(), tc.as_ptr());
+        let stats = pipeline.callable_cache().statistics();
+        assert_eq!((stats.hits, stats.misses), (1, 4));
+        assert_eq!(pipeline.callable_cache().len(), 4);
+    }
+
+    #[test]
+    fn test_pipeline_skips_transforms_not_required() {
+        let skipped = Rc::new(Cell::new(0));
+        let run = Rc::new(Cell::new(0));
+        let mut pipeline = TransformPipeline::new();
+        pipeline.add_transform(Box::new(CountingTransform {
+            runs: skipped.clone(),
+            required: false,
+        }));
+        pipeline.add_transform(Box::new(CountingTransform {
+            runs: run.clone(),
+            required: true,
+        }));
+        let callable = new_callable(Func::Add, None);
+        pipeline.transform_callable(&callable);
+        assert_eq!(skipped.get(), 0);
+        assert_eq!(run.get(), 1);
+    }
+
+    #[test]
+    fn test_transform_callable_leaves_original_untouched() {
+        let callee = CArc::new(new_callable(Func::Add, None));
+        let callable = new_callable(Func::Add, Some(callee.clone()));
+        let snapshot = |block: crate::Pooled<ir::BasicBlock>| {
+            block
+                .nodes()
+                .iter()
+                .map(|n| match n.get().instruction.as_ref() {
+                    // the debug output of a callee includes the usage of its pools
+                    Instruction::Call(Func::Callable(callee), args) => {
+                        (*n, format!("{:?} {:?}", callee.0.as_ptr(), args))
+                    }
+                    inst => (*n, format!("{:?}", inst)),
+                })
+                .collect::<Vec<_>>()
+        };
+        let before = snapshot(callable.module.entry);
+        let callee_before = snapshot(callee.module.entry);
+        let mut pipeline = TransformPipeline::new();
+        for transform in optimization_passes() {
+            pipeline.add_transform(transform);
+        }
+        let transformed = pipeline.transform_callable(&callable);
+        // the dead code is removed from the copy only
+        assert!(transformed.module.entry.nodes().len() < before.len());
+        assert_eq!(snapshot(callable.module.entry), before);
+        assert_eq!(snapshot(callee.module.entry), callee_before);
+    }
+
+    #[test]
+    fn test_optimize_folds_and_removes_dead_code() {
+        let pools = CArc::new(ModulePools::new());
+        let mut builder = IrBuilder::new(pools.clone());
+        let a = builder.const_(Const::Int32(1));
+        let b = builder.const_(Const::Int32(2));
+        let c = builder.call(Func::Add, &[a, b], i32::type_());
+        let d = builder.call(Func::Add, &[a, b], i32::type_());
+        let e = builder.call(Func::Mul, &[c, d], i32::type_());
+        builder.return_(e);
+        let module = new_module(builder.finish(), pools);
+        let mut pipeline = TransformPipeline::new();
+        for transform in optimization_passes() {
+            pipeline.add_transform(transform);
+        }
+        let module = pipeline.transform(module);
+        let nodes = module.entry.nodes();
+        assert_eq!(nodes.len(), 2);
+        match nodes[0].get().instruction.as_ref() {
+            Instruction::Const(Const::Int32(9)) => {}
+            inst => panic!("unexpected instruction {:?}", inst),
+        }
+        match nodes[1].get().instruction.as_ref() {
+            Instruction::Return(v) => assert_eq!(*v, nodes[0]),
+            inst => panic!("unexpected instruction {:?}", inst),
+        }
+    }
+
+    #[test]
+    fn test_kernels_share_transformed_callables() {
+        let callable = CArc::new(new_callable(Func::Add, None));
+        // y = f(x) for a uniform x, the kernels differ only in what they do with y
+        let new_kernel = |op: Func| {
+            let pools = CArc::new(ModulePools::new());
+            let x = new_uniform(&pools, i32::type_());
+            let mut builder = IrBuilder::new(pools.clone());
+            let y = builder.call(
+                Func::Callable(ir::CallableModuleRef(callable.clone())),
+                &[x],
+                i32::type_(),
+            );
+            builder.call(op, &[y, y], i32::type_());
+            ir::Module {
+                kind: ModuleKind::Kernel,
+                ..new_module(builder.finish(), pools)
+            }
+        };
+        let pipeline = luisa_compute_ir_transform_pipeline_new();
+        let name = std::ffi::CString::new("optimize").unwrap();
+        luisa_compute_ir_transform_pipeline_add_transform(pipeline, name.as_ptr());
+        let callees = |module: &ir::Module| {
+            utils::collect_nodes_recursive(module.entry)
+                .into_iter()
+                .filter_map(|node| match node.get().instruction.as_ref() {
+                    Instruction::Call(Func::Callable(callee), _) => Some(callee.0.as_ptr()),
+                    _ => None,
+                })
+                .collect::<Vec<_>>()
+        };
+        let a = luisa_compute_ir_transform_pipeline_transform(pipeline, new_kernel(Func::Add));
+        let b = luisa_compute_ir_transform_pipeline_transform(pipeline, new_kernel(Func::Mul));
+        let stats = luisa_compute_ir_transform_pipeline_cache_statistics(pipeline);
+        assert!(stats.hits > 0);
+        assert_eq!(stats.misses, 1);
+        // both kernels call the same transformed copy, the original is left alone
+        assert_eq!(callees(&a), callees(&b));
+        assert_eq!(callees(&a).len(), 1);
+        assert_ne!(callees(&a)[0], callable.as_ptr());
+        luisa_compute_ir_transform_pipeline_destroy(pipeline);
+    }
+
+    #[test]
+    fn test_licm_hoists_invariants() {
+        let pools = CArc::new(ModulePools::new());
+        let mut builder = IrBuilder::new(pools.clone());
+        let a = builder.const_(Const::Int32(1));
+        let b = builder.const_(Const::Int32(2));
+        let mut body = IrBuilder::new(pools.clone());
+        let s = body.call(Func::Add, &[a, b], i32::type_());
+        let q = body.call(Func::Div, &[s, a], i32::type_());
+        let cond = body.const_(Const::Bool(false));
+        let body = body.finish();
+        let loop_ = builder.loop_(body, cond);
+        builder.return_(q);
+        let module = new_module(builder.finish(), pools);
+        let module = licm::LoopInvariantCodeMotion.transform(module);
+        // the division may trap and must stay in the loop
+        assert_eq!(body.nodes(), vec![q]);
+        let nodes = module.entry.nodes();
+        assert!(nodes.contains(&s) && nodes.contains(&cond));
+        assert!(nodes.iter().position(|n| *n == s) < nodes.iter().position(|n| *n == loop_));
+    }
+
+    fn new_uniform(pools: &CArc<ModulePools>, ty: CArc<ir::Type>) -> NodeRef {
+        ir::new_node(pools, ir::Node::new(CArc::new(Instruction::Uniform), ty))
+    }
+
+    fn call_args(node: NodeRef) -> Vec<NodeRef> {
+        match node.get().instruction.as_ref() {
+            Instruction::Call(_, args) => args.as_ref().to_vec(),
+            inst => panic!("unexpected instruction {:?}", inst),
+        }
+    }
+
+    // a value computed before a break or continue may only replace the values that
+    // are dominated by it in the structured control flow
+    #[test]
+    fn test_gvn_respects_break_and_continue() {
+        let pools = CArc::new(ModulePools::new());
+        let a = new_uniform(&pools, i32::type_());
+        let b = new_uniform(&pools, i32::type_());
+        let c = new_uniform(&pools, bool::type_());
+        let mut builder = IrBuilder::new(pools.clone());
+
+        // loop { if c { s1 = a + b; break; } s2 = a + b; s3 = a + b; u = s2 + s3; }
+        let mut then = IrBuilder::new(pools.clone());
+        let s1 = then.call(Func::Add, &[a, b], i32::type_());
+        then.break_();
+        let then = then.finish();
+        let mut body = IrBuilder::new(pools.clone());
+        body.if_(c, then, IrBuilder::new(pools.clone()).finish());
+        let s2 = body.call(Func::Add, &[a, b], i32::type_());
+        let s3 = body.call(Func::Add, &[a, b], i32::type_());
+        let u = body.call(Func::Add, &[s2, s3], i32::type_());
+        let cond = body.const_(Const::Bool(false));
+        builder.loop_(body.finish(), cond);
+
+        // for (;; update) { if c { continue; } t1 = a * b; } with update { t2 = a * b; v = t2 + a; }
+        let mut then = IrBuilder::new(pools.clone());
+        then.continue_();
+        let then = then.finish();
+        let mut body = IrBuilder::new(pools.clone());
+        body.if_(c, then, IrBuilder::new(pools.clone()).finish());
+        let t1 = body.call(Func::Mul, &[a, b], i32::type_());
+        let mut update = IrBuilder::new(pools.clone());
+        let t2 = update.call(Func::Mul, &[a, b], i32::type_());
+        let v = update.call(Func::Add, &[t2, a], i32::type_());
+        let prepare = IrBuilder::new(pools.clone()).finish();
+        builder.generic_loop(prepare, c, body.finish(), update.finish());
+        builder.return_(u);
+
+        let module = new_module(builder.finish(), pools);
+        let _module = gvn::GlobalValueNumbering.transform(module);
+        assert_ne!(s1, s2);
+        assert_eq!(call_args(u), vec![s2, s2]);
+        assert_ne!(t1, t2);
+        assert_eq!(call_args(v), vec![t2, a]);
+    }
+
+    // only speculatable invariants at the top level of the loop body are hoisted,
+    // regardless of the breaks and continues around them
+    #[test]
+    fn test_licm_respects_break_and_continue() {
+        let pools = CArc::new(ModulePools::new());
+        let a = new_uniform(&pools, i32::type_());
+        let b = new_uniform(&pools, i32::type_());
+        let c = new_uniform(&pools, bool::type_());
+        let mut builder = IrBuilder::new(pools.clone());
+
+        // loop { if c { z = a - b; break; } s = a + b; q = s / a; if c { continue; } r = q + s; }
+        let mut then = IrBuilder::new(pools.clone());
+        let z = then.call(Func::Sub, &[a, b], i32::type_());
+        then.break_();
+        let break_branch = then.finish();
+        let mut then = IrBuilder::new(pools.clone());
+        then.continue_();
+        let continue_branch = then.finish();
+        let mut body = IrBuilder::new(pools.clone());
+        body.if_(c, break_branch, IrBuilder::new(pools.clone()).finish());
+        let s = body.call(Func::Add, &[a, b], i32::type_());
+        let q = body.call(Func::Div, &[s, a], i32::type_());
+        body.if_(c, continue_branch, IrBuilder::new(pools.clone()).finish());
+        let r = body.call(Func::Add, &[q, s], i32::type_());
+        let cond = body.const_(Const::Bool(false));
+        let body = body.finish();
+        let loop_ = builder.loop_(body, cond);
+        builder.return_(r);
+
+        let module = new_module(builder.finish(), pools);
+        let module = licm::LoopInvariantCodeMotion.transform(module);
+        let nodes = module.entry.nodes();
+        let position = |n: NodeRef| nodes.iter().position(|m| *m == n);
+        assert!(position(s).unwrap() < position(loop_).unwrap());
+        // the division may trap, the subtraction only runs before a break,
+        // and the addition depends on the division
+        assert_eq!(position(q), None);
+        assert_eq!(position(z), None);
+        assert_eq!(position(r), None);
+        assert!(body.nodes().contains(&q) && body.nodes().contains(&r));
+        assert_eq!(break_branch.nodes()[0], z);
     }
-    pipeline.transform(module)
 }
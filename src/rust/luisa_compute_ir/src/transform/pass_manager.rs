@@ -0,0 +1,368 @@
+/*
+Bookkeeping of the transform pipelines:
+  - per-pass timing and callable cache statistics (accumulated over the whole process)
+  - a content-addressed cache of transformed callable modules, owned by each pipeline,
+    so that callables shared by many kernels are transformed only once per pipeline
+*/
+use std::cell::{Cell, RefCell};
+use std::collections::hash_map::DefaultHasher;
+use std::collections::HashMap;
+use std::fmt::Write;
+use std::hash::{Hash, Hasher};
+use std::time::Duration;
+
+use lazy_static::lazy_static;
+use parking_lot::Mutex;
+
+use crate::context::type_hash;
+use crate::ir::{BasicBlock, CallableModule, Func, Instruction, Module, NodeRef};
+use crate::{CArc, Pooled};
+
+#[derive(Clone, Copy, Debug, Default)]
+pub struct PassStatistics {
+    pub runs: usize,
+    pub skipped: usize,
+    pub total_time: Duration,
+    pub max_time: Duration,
+}
+
+#[derive(Clone, Copy, Debug, Default)]
+pub struct CacheStatistics {
+    pub hits: usize,
+    pub misses: usize,
+    pub hash_time: Duration,
+}
+
+struct PassManagerState {
+    passes: Vec<(&'static str, PassStatistics)>,
+    cache_stats: CacheStatistics,
+}
+
+lazy_static! {
+    static ref STATE: Mutex<PassManagerState> = Mutex::new(PassManagerState {
+        passes: Vec::new(),
+        cache_stats: CacheStatistics::default(),
+    });
+}
+
+pub fn record_pass(name: &'static str, elapsed: Option<Duration>) {
+    let mut state = STATE.lock();
+    let index = match state.passes.iter().position(|(n, _)| *n == name) {
+        Some(i) => i,
+        None => {
+            state.passes.push((name, PassStatistics::default()));
+            state.passes.len() - 1
+        }
+    };
+    let stats = &mut state.passes[index].1;
+    match elapsed {
+        Some(elapsed) => {
+            stats.runs += 1;
+            stats.total_time += elapsed;
+            stats.max_time = stats.max_time.max(elapsed);
+        }
+        None => stats.skipped += 1,
+    }
+}
+
+pub fn pass_statistics() -> Vec<(&'static str, PassStatistics)> {
+    STATE.lock().passes.clone()
+}
+
+pub fn cache_statistics() -> CacheStatistics {
+    STATE.lock().cache_stats
+}
+
+pub fn reset_statistics() {
+    let mut state = STATE.lock();
+    state.passes.clear();
+    state.cache_stats = CacheStatistics::default();
+}
+
+pub fn report() -> String {
+    let state = STATE.lock();
+    let mut s = String::new();
+    writeln!(s, "IR transform statistics:").unwrap();
+    for (name, stats) in &state.passes {
+        writeln!(
+            s,
+            "  {:<28} runs: {:>6}  skipped: {:>6}  total: {:>10.3}ms  max: {:>10.3}ms",
+            name,
+            stats.runs,
+            stats.skipped,
+            stats.total_time.as_secs_f64() * 1e3,
+            stats.max_time.as_secs_f64() * 1e3
+        )
+        .unwrap();
+    }
+    let cache = &state.cache_stats;
+    writeln!(
+        s,
+        "  callable cache: {} hit(s), {} miss(es), hashing {:.3}ms",
+        cache.hits,
+        cache.misses,
+        cache.hash_time.as_secs_f64() * 1e3
+    )
+    .unwrap();
+    s
+}
+
+fn record_cache_lookup(hit: bool, hash_time: Duration) {
+    let stats = &mut STATE.lock().cache_stats;
+    if hit {
+        stats.hits += 1;
+    } else {
+        stats.misses += 1;
+    }
+    stats.hash_time += hash_time;
+}
+
+/*
+Transformed callable modules of a pipeline, keyed by the structural hash of the
+original callable. The cache belongs to a single pipeline and is not shared across
+threads. The cached modules must be treated as immutable; callers that need to
+modify the result have to duplicate it first.
+*/
+#[derive(Default)]
+pub struct CallableCache {
+    entries: RefCell<HashMap<u64, CArc<CallableModule>>>,
+    stats: Cell<CacheStatistics>,
+}
+
+impl CallableCache {
+    pub fn lookup(&self, content_hash: u64, hash_time: Duration) -> Option<CArc<CallableModule>> {
+        let found = self.entries.borrow().get(&content_hash).cloned();
+        let mut stats = self.stats.get();
+        if found.is_some() {
+            stats.hits += 1;
+        } else {
+            stats.misses += 1;
+        }
+        stats.hash_time += hash_time;
+        self.stats.set(stats);
+        record_cache_lookup(found.is_some(), hash_time);
+        found
+    }
+    pub fn insert(&self, content_hash: u64, module: CArc<CallableModule>) {
+        self.entries.borrow_mut().insert(content_hash, module);
+    }
+    pub fn clear(&self) {
+        self.entries.borrow_mut().clear();
+    }
+    pub fn len(&self) -> usize {
+        self.entries.borrow().len()
+    }
+    pub fn statistics(&self) -> CacheStatistics {
+        self.stats.get()
+    }
+}
+
+// shallow copy that shares the nodes with the original module
+pub fn clone_module(m: &Module) -> Module {
+    Module {
+        kind: m.kind,
+        entry: m.entry,
+        flags: m.flags,
+        pools: m.pools.clone(),
+    }
+}
+
+/*
+Structural hash of a module. Nodes are numbered in visiting order so that two
+modules built independently from the same source hash to the same value.
+Callees are hashed by their content as well, memoized per callee so that a
+callable called from many places is only visited once.
+*/
+struct ModuleHasher {
+    hasher: DefaultHasher,
+    ids: HashMap<NodeRef, u64>,
+    blocks: HashMap<*const BasicBlock, u64>,
+    callees: HashMap<*const CallableModule, u64>,
+}
+
+impl ModuleHasher {
+    fn new() -> Self {
+        Self {
+            hasher: DefaultHasher::new(),
+            ids: HashMap::new(),
+            blocks: HashMap::new(),
+            callees: HashMap::new(),
+        }
+    }
+    fn callee(&mut self, callable: &CArc<CallableModule>) -> u64 {
+        if let Some(hash) = self.callees.get(&callable.as_ptr()) {
+            return *hash;
+        }
+        // the callee gets its own node numbering but shares the memo
+        let mut inner = ModuleHasher::new();
+        inner.callees = std::mem::take(&mut self.callees);
+        inner.callable(callable.as_ref());
+        let hash = inner.hasher.finish();
+        self.callees = inner.callees;
+        self.callees.insert(callable.as_ptr(), hash);
+        hash
+    }
+    fn callable(&mut self, module: &CallableModule) {
+        // arguments first so that they get the smallest ids
+        for arg in module.args.as_ref() {
+            self.node(*arg);
+        }
+        for capture in module.captures.as_ref() {
+            self.node_ref(capture.node);
+            capture.binding.hash(&mut self.hasher);
+        }
+        type_hash(&module.ret_type).hash(&mut self.hasher);
+        module.module.kind.hash(&mut self.hasher);
+        module.module.flags.bits().hash(&mut self.hasher);
+        self.block(module.module.entry);
+    }
+    fn node_ref(&mut self, node: NodeRef) {
+        let next = self.ids.len() as u64;
+        let id = *self.ids.entry(node).or_insert(next);
+        id.hash(&mut self.hasher);
+    }
+    fn node_refs(&mut self, nodes: &[NodeRef]) {
+        nodes.len().hash(&mut self.hasher);
+        for n in nodes {
+            self.node_ref(*n);
+        }
+    }
+    fn block_ref(&mut self, block: Pooled<BasicBlock>) {
+        let next = self.blocks.len() as u64;
+        let id = *self.blocks.entry(block.as_ptr()).or_insert(next);
+        id.hash(&mut self.hasher);
+    }
+    fn block(&mut self, block: Pooled<BasicBlock>) {
+        self.block_ref(block);
+        for node in block.iter() {
+            self.node(node);
+        }
+        // block terminator, so that nesting is part of the hash
+        u64::MAX.hash(&mut self.hasher);
+    }
+    fn node(&mut self, node: NodeRef) {
+        self.node_ref(node);
+        type_hash(node.type_()).hash(&mut self.hasher);
+        let inst = node.get().instruction.as_ref();
+        std::mem::discriminant(inst).hash(&mut self.hasher);
+        match inst {
+            Instruction::Local { init } => self.node_ref(*init),
+            Instruction::Argument { by_value } => by_value.hash(&mut self.hasher),
+            Instruction::UserData(data) => CArc::as_ptr(data).hash(&mut self.hasher),
+            Instruction::Const(c) => format!("{:?}", c).hash(&mut self.hasher),
+            Instruction::Update { var, value } => {
+                self.node_ref(*var);
+                self.node_ref(*value);
+            }
+            Instruction::Call(func, args) => {
+                match func {
+                    Func::Callable(callable) => {
+                        let hash = self.callee(&callable.0);
+                        hash.hash(&mut self.hasher);
+                    }
+                    _ => func.hash(&mut self.hasher),
+                }
+                self.node_refs(args.as_ref());
+            }
+            Instruction::Phi(incomings) => {
+                for incoming in incomings.as_ref() {
+                    self.node_ref(incoming.value);
+                    self.block_ref(incoming.block);
+                }
+            }
+            Instruction::Return(value) => self.node_ref(*value),
+            Instruction::Loop { body, cond } => {
+                self.block(*body);
+                self.node_ref(*cond);
+            }
+            Instruction::GenericLoop {
+                prepare,
+                cond,
+                body,
+                update,
+            } => {
+                self.block(*prepare);
+                self.node_ref(*cond);
+                self.block(*body);
+                self.block(*update);
+            }
+            Instruction::If {
+                cond,
+                true_branch,
+                false_branch,
+            } => {
+                self.node_ref(*cond);
+                self.block(*true_branch);
+                self.block(*false_branch);
+            }
+            Instruction::Switch {
+                value,
+                default,
+                cases,
+            } => {
+                self.node_ref(*value);
+                self.block(*default);
+                for case in cases.as_ref() {
+                    case.value.hash(&mut self.hasher);
+                    self.block(case.block);
+                }
+            }
+            Instruction::AdScope {
+                body,
+                forward,
+                n_forward_grads,
+            } => {
+                self.block(*body);
+                forward.hash(&mut self.hasher);
+                n_forward_grads.hash(&mut self.hasher);
+            }
+            Instruction::RayQuery {
+                ray_query,
+                on_triangle_hit,
+                on_procedural_hit,
+            } => {
+                self.node_ref(*ray_query);
+                self.block(*on_triangle_hit);
+                self.block(*on_procedural_hit);
+            }
+            Instruction::Print { fmt, args } => {
+                fmt.hash(&mut self.hasher);
+                self.node_refs(args.as_ref());
+            }
+            Instruction::AdDetach(body) => self.block(*body),
+            Instruction::Comment(msg) => msg.hash(&mut self.hasher),
+            Instruction::Buffer
+            | Instruction::Bindless
+            | Instruction::Texture2D
+            | Instruction::Texture3D
+            | Instruction::Accel
+            | Instruction::Shared
+            | Instruction::Uniform
+            | Instruction::Invalid
+            | Instruction::Break
+            | Instruction::Continue => {}
+        }
+    }
+    fn finish(self) -> u64 {
+        self.hasher.finish()
+    }
+}
+
+pub fn module_hash(module: &Module) -> u64 {
+    let mut h = ModuleHasher::new();
+    module.kind.hash(&mut h.hasher);
+    module.flags.bits().hash(&mut h.hasher);
+    h.block(module.entry);
+    h.finish()
+}
+
+pub fn callable_module_hash(module: &CallableModule) -> u64 {
+    let mut h = ModuleHasher::new();
+    h.callable(module);
+    h.finish()
+}
+
+// number of nodes in the module, including the ones in nested blocks
+pub fn module_node_count(module: &Module) -> usize {
+    super::utils::collect_nodes_recursive(module.entry).len()
+}
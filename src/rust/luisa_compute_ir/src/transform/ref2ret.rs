@@ -329,6 +329,9 @@ impl Ref2RetImpl {
 }
 
 impl Transform for Ref2Ret {
+    fn name(&self) -> &'static str {
+        "ref2ret"
+    }
     fn transform(&self, module: Module) -> Module {
         let mut transform = Ref2RetImpl::new();
         transform.transform_block(&module.entry);
@@ -285,6 +285,9 @@ impl Reg2MemImpl {
 pub struct Reg2Mem;
 
 impl Transform for Reg2Mem {
+    fn name(&self) -> &'static str {
+        "reg2mem"
+    }
     fn transform(&self, module: Module) -> Module {
         let mut reg2mem = Reg2MemImpl::new();
         reg2mem.transform_module(&module);
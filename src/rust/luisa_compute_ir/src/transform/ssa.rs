@@ -430,6 +430,9 @@ impl ToSSAImpl {
 }
 
 impl Transform for ToSSA {
+    fn name(&self) -> &'static str {
+        "ssa"
+    }
     fn transform(&self, module: Module) -> Module {
         let mut imp = ToSSAImpl::new(&module);
         let new_bb = imp.promote_bb(
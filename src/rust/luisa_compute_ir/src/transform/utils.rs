@@ -0,0 +1,340 @@
+/*
+Helpers shared by the optimization passes (dce, gvn, licm, const_prop and
+canonicalize_control_flow).
+*/
+use std::collections::HashMap;
+
+use crate::ir::{BasicBlock, Func, Instruction, NodeRef, PhiIncoming, SwitchCase};
+use crate::{CArc, CBoxedSlice, Pooled};
+
+// Calls `f` on every value operand of `inst`. Nested blocks are not visited.
+pub(crate) fn for_each_operand(inst: &Instruction, mut f: impl FnMut(NodeRef)) {
+    match inst {
+        Instruction::Local { init } => f(*init),
+        Instruction::Update { var, value } => {
+            f(*var);
+            f(*value);
+        }
+        Instruction::Call(_, args) => args.as_ref().iter().for_each(|a| f(*a)),
+        Instruction::Phi(incomings) => incomings.as_ref().iter().for_each(|i| f(i.value)),
+        Instruction::Return(value) => {
+            if value.valid() {
+                f(*value)
+            }
+        }
+        Instruction::Loop { cond, .. } => f(*cond),
+        Instruction::GenericLoop { cond, .. } => f(*cond),
+        Instruction::If { cond, .. } => f(*cond),
+        Instruction::Switch { value, .. } => f(*value),
+        Instruction::RayQuery { ray_query, .. } => f(*ray_query),
+        Instruction::Print { args, .. } => args.as_ref().iter().for_each(|a| f(*a)),
+        _ => {}
+    }
+}
+
+// Calls `f` on every block directly nested in `inst`.
+pub(crate) fn for_each_block(inst: &Instruction, mut f: impl FnMut(Pooled<BasicBlock>)) {
+    match inst {
+        Instruction::Loop { body, .. } => f(*body),
+        Instruction::GenericLoop {
+            prepare,
+            body,
+            update,
+            ..
+        } => {
+            f(*prepare);
+            f(*body);
+            f(*update);
+        }
+        Instruction::If {
+            true_branch,
+            false_branch,
+            ..
+        } => {
+            f(*true_branch);
+            f(*false_branch);
+        }
+        Instruction::Switch { default, cases, .. } => {
+            f(*default);
+            for SwitchCase { block, .. } in cases.as_ref() {
+                f(*block);
+            }
+        }
+        Instruction::AdScope { body, .. } => f(*body),
+        Instruction::AdDetach(body) => f(*body),
+        Instruction::RayQuery {
+            on_triangle_hit,
+            on_procedural_hit,
+            ..
+        } => {
+            f(*on_triangle_hit);
+            f(*on_procedural_hit);
+        }
+        _ => {}
+    }
+}
+
+// Pre-order list of all nodes in `block`, including the ones in nested blocks.
+// Passes that mutate the IR iterate over this list instead of the linked blocks.
+pub(crate) fn collect_nodes_recursive(block: Pooled<BasicBlock>) -> Vec<NodeRef> {
+    fn visit(block: Pooled<BasicBlock>, nodes: &mut Vec<NodeRef>) {
+        for node in block.iter() {
+            nodes.push(node);
+            for_each_block(node.get().instruction.as_ref(), |b| visit(b, nodes));
+        }
+    }
+    let mut nodes = Vec::new();
+    visit(block, &mut nodes);
+    nodes
+}
+
+// Returns a copy of `inst` with its operands remapped, or None if nothing changed.
+pub(crate) fn map_operands(
+    inst: &Instruction,
+    map: impl Fn(NodeRef) -> NodeRef,
+) -> Option<Instruction> {
+    let mut changed = false;
+    let mut m = |n: NodeRef| {
+        let r = map(n);
+        changed |= r != n;
+        r
+    };
+    let new_inst = match inst {
+        Instruction::Local { init } => Instruction::Local { init: m(*init) },
+        Instruction::Update { var, value } => Instruction::Update {
+            var: m(*var),
+            value: m(*value),
+        },
+        Instruction::Call(f, args) => Instruction::Call(
+            f.clone(),
+            CBoxedSlice::new(args.as_ref().iter().map(|a| m(*a)).collect()),
+        ),
+        Instruction::Phi(incomings) => Instruction::Phi(CBoxedSlice::new(
+            incomings
+                .as_ref()
+                .iter()
+                .map(|i| PhiIncoming {
+                    value: m(i.value),
+                    block: i.block,
+                })
+                .collect(),
+        )),
+        Instruction::Return(value) => {
+            if value.valid() {
+                Instruction::Return(m(*value))
+            } else {
+                return None;
+            }
+        }
+        Instruction::Loop { body, cond } => Instruction::Loop {
+            body: *body,
+            cond: m(*cond),
+        },
+        Instruction::GenericLoop {
+            prepare,
+            cond,
+            body,
+            update,
+        } => Instruction::GenericLoop {
+            prepare: *prepare,
+            cond: m(*cond),
+            body: *body,
+            update: *update,
+        },
+        Instruction::If {
+            cond,
+            true_branch,
+            false_branch,
+        } => Instruction::If {
+            cond: m(*cond),
+            true_branch: *true_branch,
+            false_branch: *false_branch,
+        },
+        Instruction::Switch {
+            value,
+            default,
+            cases,
+        } => Instruction::Switch {
+            value: m(*value),
+            default: *default,
+            cases: cases.clone(),
+        },
+        Instruction::RayQuery {
+            ray_query,
+            on_triangle_hit,
+            on_procedural_hit,
+        } => Instruction::RayQuery {
+            ray_query: m(*ray_query),
+            on_triangle_hit: *on_triangle_hit,
+            on_procedural_hit: *on_procedural_hit,
+        },
+        Instruction::Print { fmt, args } => Instruction::Print {
+            fmt: fmt.clone(),
+            args: CBoxedSlice::new(args.as_ref().iter().map(|a| m(*a)).collect()),
+        },
+        _ => return None,
+    };
+    if changed {
+        Some(new_inst)
+    } else {
+        None
+    }
+}
+
+// Rewrites every use of a key of `replacements` in `block` (recursively) to its value.
+pub(crate) fn replace_uses(block: Pooled<BasicBlock>, replacements: &HashMap<NodeRef, NodeRef>) {
+    if replacements.is_empty() {
+        return;
+    }
+    let lookup = |n: NodeRef| {
+        let mut n = n;
+        // follow chains, e.g. a -> b when b itself was replaced by c
+        while let Some(r) = replacements.get(&n) {
+            n = *r;
+        }
+        n
+    };
+    for node in collect_nodes_recursive(block) {
+        if let Some(inst) = map_operands(node.get().instruction.as_ref(), lookup) {
+            node.get_mut().instruction = CArc::new(inst);
+        }
+    }
+}
+
+// Whether a node is an immutable value, i.e., referencing it does not read memory.
+// Locals, reference arguments, shared memory and GEPs are interpreted as loads
+// when used as call arguments, so calls on them cannot be moved or merged.
+pub(crate) fn is_value(node: NodeRef) -> bool {
+    match node.get().instruction.as_ref() {
+        Instruction::Const(_) | Instruction::Uniform | Instruction::Phi(_) => true,
+        Instruction::Argument { by_value } => *by_value,
+        Instruction::Call(f, _) => *f != Func::GetElementPtr,
+        _ => false,
+    }
+}
+
+// Functions without side effects whose result only depends on their arguments
+// (and on the invocation's thread/dispatch indices).
+pub(crate) fn is_pure_func(f: &Func) -> bool {
+    match f {
+        Func::ZeroInitializer
+        | Func::ThreadId
+        | Func::BlockId
+        | Func::DispatchId
+        | Func::DispatchSize
+        | Func::Cast
+        | Func::Bitcast
+        | Func::Add
+        | Func::Sub
+        | Func::Mul
+        | Func::Div
+        | Func::Rem
+        | Func::BitAnd
+        | Func::BitOr
+        | Func::BitXor
+        | Func::Shl
+        | Func::Shr
+        | Func::RotRight
+        | Func::RotLeft
+        | Func::Eq
+        | Func::Ne
+        | Func::Lt
+        | Func::Le
+        | Func::Gt
+        | Func::Ge
+        | Func::MatCompMul
+        | Func::Neg
+        | Func::Not
+        | Func::BitNot
+        | Func::All
+        | Func::Any
+        | Func::Select
+        | Func::Clamp
+        | Func::Lerp
+        | Func::Step
+        | Func::SmoothStep
+        | Func::Saturate
+        | Func::Abs
+        | Func::Min
+        | Func::Max
+        | Func::ReduceSum
+        | Func::ReduceProd
+        | Func::ReduceMin
+        | Func::ReduceMax
+        | Func::Clz
+        | Func::Ctz
+        | Func::PopCount
+        | Func::Reverse
+        | Func::IsInf
+        | Func::IsNan
+        | Func::Acos
+        | Func::Acosh
+        | Func::Asin
+        | Func::Asinh
+        | Func::Atan
+        | Func::Atan2
+        | Func::Atanh
+        | Func::Cos
+        | Func::Cosh
+        | Func::Sin
+        | Func::Sinh
+        | Func::Tan
+        | Func::Tanh
+        | Func::Exp
+        | Func::Exp2
+        | Func::Exp10
+        | Func::Log
+        | Func::Log2
+        | Func::Log10
+        | Func::Powi
+        | Func::Powf
+        | Func::Sqrt
+        | Func::Rsqrt
+        | Func::Ceil
+        | Func::Floor
+        | Func::Fract
+        | Func::Trunc
+        | Func::Round
+        | Func::Fma
+        | Func::Copysign
+        | Func::Cross
+        | Func::Dot
+        | Func::OuterProduct
+        | Func::Length
+        | Func::LengthSquared
+        | Func::Normalize
+        | Func::Faceforward
+        | Func::Distance
+        | Func::Reflect
+        | Func::Determinant
+        | Func::Transpose
+        | Func::Inverse
+        | Func::Vec
+        | Func::Vec2
+        | Func::Vec3
+        | Func::Vec4
+        | Func::Permute
+        | Func::InsertElement
+        | Func::ExtractElement
+        | Func::Struct
+        | Func::Array
+        | Func::Mat
+        | Func::Mat2
+        | Func::Mat3
+        | Func::Mat4 => true,
+        _ => false,
+    }
+}
+
+// Pure functions that can also be executed speculatively, e.g., hoisted out of
+// a loop body that may not run. Integer division and remainder may trap.
+pub(crate) fn is_speculatable_func(f: &Func) -> bool {
+    match f {
+        Func::Div | Func::Rem => false,
+        _ => is_pure_func(f),
+    }
+}
+
+pub(crate) fn block_has_phi(block: Pooled<BasicBlock>) -> bool {
+    collect_nodes_recursive(block).iter().any(|n| n.is_phi())
+}
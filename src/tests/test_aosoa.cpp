@@ -0,0 +1,225 @@
+#include <cmath>
+#include <random>
+#include <type_traits>
+#include <limits>
+#include <algorithm>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/buffer.h>
+#include <luisa/runtime/command_list.h>
+#include <luisa/dsl/syntax.h>
+#include <luisa/dsl/soa.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+struct Particle {
+    float3 position;
+    float3 velocity;
+    float4 color;
+    float mass;
+    float radius;
+    uint id;
+};
+
+LUISA_STRUCT(Particle, position, velocity, color, mass, radius, id) {};
+
+[[nodiscard]] static auto max_difference(const Particle &lhs, const Particle &rhs) noexcept {
+    if (lhs.id != rhs.id) { return std::numeric_limits<float>::infinity(); }
+    auto d = std::max(std::abs(lhs.mass - rhs.mass), std::abs(lhs.radius - rhs.radius));
+    for (auto i = 0u; i < 3u; i++) {
+        d = std::max({d, std::abs(lhs.position[i] - rhs.position[i]),
+                      std::abs(lhs.velocity[i] - rhs.velocity[i])});
+    }
+    for (auto i = 0u; i < 4u; i++) {
+        d = std::max(d, std::abs(lhs.color[i] - rhs.color[i]));
+    }
+    return d;
+}
+
+// Compares the AoS, SOA and AOSOA layouts of a particle array on whole-element updates,
+// whole-element random gathers and single-field reads, and checks that the layouts
+// agree with each other and with the host-side AOSOA conversion.
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend>. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    constexpr auto rounds = 5u;
+    // not a multiple of the tile widths, to cover the partial last tile
+    constexpr auto n = (1u << 22u) + 5u;
+
+    Device device = context.create_device(argv[1]);
+    Stream stream = device.create_stream();
+
+    luisa::vector<Particle> particles(n);
+    luisa::vector<uint> indices(n);
+    std::mt19937 random{19937u};
+    std::uniform_real_distribution<float> uniform{-1.f, 1.f};
+    std::uniform_int_distribution<uint> pick{0u, n - 1u};
+    for (auto i = 0u; i < n; i++) {
+        particles[i] = Particle{
+            .position = make_float3(uniform(random), uniform(random), uniform(random)),
+            .velocity = make_float3(uniform(random), uniform(random), uniform(random)),
+            .color = make_float4(std::abs(uniform(random)), std::abs(uniform(random)), std::abs(uniform(random)), 1.f),
+            .mass = 1.f + std::abs(uniform(random)),
+            .radius = .01f * (1.f + std::abs(uniform(random))),
+            .id = i};
+        indices[i] = pick(random);
+    }
+
+    auto aos_particles = device.create_buffer<Particle>(n);
+    auto index_buffer = device.create_buffer<uint>(n);
+    auto result_buffer = device.create_buffer<float>(n);
+    stream << index_buffer.copy_from(indices.data());
+
+    // explicit Euler step with gravity and a drag proportional to the radius
+    auto step = [](Var<Particle> &p) noexcept {
+        constexpr auto dt = 1e-3f;
+        auto acceleration = make_float3(0.f, -9.8f, 0.f) - p.radius * p.velocity / p.mass;
+        p.velocity += acceleration * dt;
+        p.position += p.velocity * dt;
+    };
+
+    // runs the update, gather and field kernels on a layout, and downloads the updated
+    // particles through the AoS buffer to compare the layouts with each other
+    luisa::vector<Particle> reference(n);
+    luisa::vector<Particle> updated(n);
+    auto benchmark = [&](luisa::string_view name, auto &&storage, auto &&position, auto &&load, auto &&store) noexcept {
+        auto update = device.compile<1>([&] {
+            auto i = dispatch_x();
+            auto p = def(storage->read(i));
+            step(p);
+            storage->write(i, p);
+        });
+        auto gather = device.compile<1>([&](BufferUInt index, BufferFloat result) noexcept {
+            auto i = dispatch_x();
+            auto p = storage->read(index.read(i));
+            result.write(i, p.mass * dot(p.velocity, p.velocity) + p.radius * length(p.position));
+        });
+        auto field = device.compile<1>([&](BufferFloat result) noexcept {
+            auto i = dispatch_x();
+            result.write(i, length(position(i)));
+        });
+        auto measure = [&](luisa::string_view kernel, auto &&command) noexcept {
+            auto best = std::numeric_limits<double>::max();
+            for (auto r = 0u; r <= rounds; r++) {
+                Clock clock;
+                stream << command() << synchronize();
+                // the first round includes the warm-up
+                if (r != 0u) { best = std::min(best, clock.toc()); }
+            }
+            LUISA_INFO("{:>10} {:>7}: {:8.3f} ms, {:8.2f} M elements/s",
+                       name, kernel, best, n / best * 1e-3);
+        };
+        stream << load();
+        measure("update", [&] { return update().dispatch(n); });
+        measure("gather", [&] { return gather(index_buffer, result_buffer).dispatch(n); });
+        measure("field", [&] { return field(result_buffer).dispatch(n); });
+        stream << store() << synchronize();
+        // the particles have been updated by rounds + 1 steps
+        stream << aos_particles.copy_to(updated.data()) << synchronize();
+    };
+
+    // AoS: the reference layout
+    benchmark(
+        "aos", aos_particles,
+        [&](Expr<uint> i) noexcept { return aos_particles->read(i).position; },
+        [&] { return aos_particles.copy_from(particles.data()); },
+        [&] { return aos_particles.copy_to(reference.data()); });
+
+    // SOA: converted to and from the AoS buffer on the device
+    auto soa = device.create_soa<Particle>(n);
+    auto soa_from_aos = device.compile<1>([&](SOAVar<Particle> s) noexcept {
+        auto i = dispatch_x();
+        s.write(i, aos_particles->read(i));
+    });
+    auto soa_to_aos = device.compile<1>([&](SOAVar<Particle> s) noexcept {
+        auto i = dispatch_x();
+        aos_particles->write(i, s.read(i));
+    });
+    benchmark(
+        "soa", soa,
+        [&](Expr<uint> i) noexcept { return soa->position.read(i); },
+        [&] {
+            CommandList list;
+            list << aos_particles.copy_from(particles.data())
+                 << soa_from_aos(soa).dispatch(n);
+            return list.commit();
+        },
+        [&] { return soa_to_aos(soa).dispatch(n); });
+
+    auto any_wrong = false;
+    auto compare = [&](luisa::string_view name) noexcept {
+        auto error = 0.f;
+        for (auto i = 0u; i < n; i++) {
+            error = std::max(error, max_difference(reference[i], updated[i]));
+        }
+        LUISA_INFO("{:>10}: max difference to AoS = {}", name, error);
+        if (!(error <= 1e-5f)) {
+            LUISA_WARNING("{} does not match AoS.", name);
+            any_wrong = true;
+        }
+    };
+    compare("soa");
+
+    // AOSOA: encoded on the host, decoded on the device and checked against the host
+    // data, then updated and downloaded through the AoS buffer
+    auto run_aosoa = [&]<uint W>(std::integral_constant<uint, W>) noexcept {
+        auto name = luisa::format("aosoa<{}>", W);
+        auto aosoa = device.create_aosoa<Particle, W>(n);
+        luisa::vector<uint> encoded(AOSOAView<Particle, W>::compute_aosoa_size(n));
+        AOSOAView<Particle, W>::encode(particles, encoded);
+        auto aosoa_to_aos = device.compile<1>([&](AOSOAVar<Particle, W> a) noexcept {
+            auto i = dispatch_x();
+            aos_particles->write(i, a.read(i));
+        });
+        stream << aosoa.buffer().copy_from(encoded.data())
+               << aosoa_to_aos(aosoa).dispatch(n)
+               << aos_particles.copy_to(updated.data())
+               << synchronize();
+        auto decode_ok = true;
+        for (auto i = 0u; i < n; i++) {
+            if (max_difference(particles[i], updated[i]) != 0.f) {
+                LUISA_WARNING("{} device decoding mismatch at index {}.", name, i);
+                decode_ok = false;
+                break;
+            }
+        }
+        benchmark(
+            name, aosoa,
+            [&](Expr<uint> i) noexcept { return aosoa->tile(i).position.read(aosoa->lane(i)); },
+            [&] { return aosoa.buffer().copy_from(encoded.data()); },
+            [&] { return aosoa_to_aos(aosoa).dispatch(n); });
+        compare(name);
+        // the host decoding must agree with the device decoding
+        luisa::vector<Particle> decoded(n);
+        stream << aosoa.buffer().copy_to(encoded.data()) << synchronize();
+        AOSOAView<Particle, W>::decode(encoded, decoded);
+        for (auto i = 0u; i < n; i++) {
+            if (max_difference(decoded[i], updated[i]) != 0.f) {
+                LUISA_WARNING("{} host decoding mismatch at index {}.", name, i);
+                decode_ok = false;
+                break;
+            }
+        }
+        any_wrong |= !decode_ok;
+    };
+    run_aosoa(std::integral_constant<uint, 8u>{});
+    run_aosoa(std::integral_constant<uint, 16u>{});
+    run_aosoa(std::integral_constant<uint, 32u>{});
+
+    if (any_wrong) {
+        LUISA_ERROR("AOSOA test failed.");
+    } else {
+        LUISA_INFO("AOSOA test passed.");
+    }
+}
@@ -0,0 +1,80 @@
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/backends/ext/command_graph_ext.h>
+#include <luisa/dsl/syntax.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// Measures the host-side cost of submitting command lists made of many small dispatches,
+// which is dominated by command encoding and conversion on backends bridged from Rust,
+// and of replaying a list converted once where the backend supports CommandGraphExt.
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend> [frames]. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    auto frames = argc > 2 ? std::stoull(argv[2]) : 200ull;
+    constexpr auto dispatches_per_frame = 256u;
+    constexpr auto n = 64u;
+
+    Device device = context.create_device(argv[1]);
+    Kernel1D add_kernel = [](BufferUInt buffer, UInt value) noexcept {
+        auto i = dispatch_id().x;
+        buffer.write(i, buffer.read(i) + value);
+    };
+    auto add = device.compile(add_kernel);
+    auto buffer = device.create_buffer<uint>(n);
+    auto stream = device.create_stream();
+    luisa::vector<uint> host(n, 0u);
+    stream << buffer.copy_from(host.data()) << synchronize();
+
+    auto submit_time = 0.;
+    Clock total_clock;
+    for (auto f = 0ull; f < frames; f++) {
+        CommandList list;
+        for (auto i = 0u; i < dispatches_per_frame; i++) {
+            list << add(buffer, 1u).dispatch(n);
+        }
+        Clock clock;
+        stream << list.commit();
+        submit_time += clock.toc();
+    }
+    stream << synchronize();
+    auto total_time = total_clock.toc();
+    auto commands = static_cast<double>(frames * dispatches_per_frame);
+    LUISA_INFO("{:.3f} us per command submission, {:.2f} ms in total.",
+               submit_time * 1e3 / commands, total_time);
+    auto expected = frames * dispatches_per_frame;
+
+    if (auto ext = device.extension<CommandGraphExt>()) {
+        CommandList list;
+        for (auto i = 0u; i < dispatches_per_frame; i++) {
+            list << add(buffer, 1u).dispatch(n);
+        }
+        auto recorded = list.steal_commands();
+        auto graph = ext->create_command_graph(recorded);
+        Clock replay_clock;
+        for (auto f = 0ull; f < frames; f++) {
+            ext->dispatch_command_graph(stream.handle(), graph);
+        }
+        auto replay_time = replay_clock.toc();
+        // the replays in flight keep the converted commands alive
+        ext->destroy_command_graph(graph);
+        stream << synchronize();
+        LUISA_INFO("{:.3f} us per replayed command submission.", replay_time * 1e3 / commands);
+        expected += frames * dispatches_per_frame;
+    }
+
+    stream << buffer.copy_to(host.data()) << synchronize();
+    for (auto i = 0u; i < n; i++) {
+        LUISA_ASSERT(host[i] == expected,
+                     "Element {} is {}, expected {}.", i, host[i], expected);
+    }
+}
@@ -0,0 +1,93 @@
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/command_graph.h>
+#include <luisa/dsl/syntax.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// Records a frame of small dispatches once, patches the uniform, dispatch size and
+// buffer binding of recorded dispatches between submissions (also while a submission
+// is in flight), and compares the submission cost with re-encoding the same list
+// every frame.
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend> [frames]. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    auto frames = argc > 2 ? std::stoull(argv[2]) : 200ull;
+    constexpr auto dispatches_per_frame = 256u;
+    constexpr auto n = 64u;
+
+    Device device = context.create_device(argv[1]);
+    Kernel1D add_kernel = [](BufferUInt buffer, UInt value) noexcept {
+        auto i = dispatch_id().x;
+        buffer.write(i, buffer.read(i) + value);
+    };
+    auto add = device.compile(add_kernel);
+    auto a = device.create_buffer<uint>(n);
+    auto b = device.create_buffer<uint>(n);
+    auto stream = device.create_stream();
+    luisa::vector<uint> host(n, 0u);
+    stream << a.copy_from(host.data())
+           << b.copy_from(host.data())
+           << synchronize();
+
+    // re-encoded every frame
+    Clock clock;
+    for (auto f = 0ull; f < frames; f++) {
+        CommandList list;
+        for (auto i = 0u; i < dispatches_per_frame; i++) {
+            list << add(a, 1u).dispatch(n);
+        }
+        stream << list.commit();
+    }
+    auto encode_time = clock.toc();
+    stream << synchronize();
+
+    // recorded once and replayed
+    CommandList list;
+    for (auto i = 0u; i < dispatches_per_frame; i++) {
+        list << add(a, 1u).dispatch(n);
+    }
+    CommandGraph graph{std::move(list)};
+    clock.tic();
+    for (auto f = 0ull; f < frames; f++) {
+        stream << graph.commit();
+    }
+    auto replay_time = clock.toc();
+    stream << synchronize();
+
+    // patch the last dispatch to add 2 to the first half of the other buffer
+    graph.set_buffer(dispatches_per_frame - 1u, 0u, b.view());
+    graph.set_uniform(dispatches_per_frame - 1u, 1u, 2u);
+    graph.set_dispatch_size(dispatches_per_frame - 1u, make_uint3(n / 2u, 1u, 1u));
+    stream << graph.commit() << synchronize();
+
+    // patch while the previous submission may still be in flight
+    stream << graph.commit();
+    graph.set_uniform(dispatches_per_frame - 1u, 1u, 3u);
+    stream << graph.commit() << synchronize();
+
+    luisa::vector<uint> host_a(n), host_b(n);
+    stream << a.copy_to(host_a.data())
+           << b.copy_to(host_b.data())
+           << synchronize();
+    auto expected_a = 2u * frames * dispatches_per_frame + 3u * (dispatches_per_frame - 1u);
+    for (auto i = 0u; i < n; i++) {
+        LUISA_ASSERT(host_a[i] == expected_a,
+                     "a[{}] is {}, expected {}.", i, host_a[i], expected_a);
+        auto expected_b = i < n / 2u ? 7u : 0u;
+        LUISA_ASSERT(host_b[i] == expected_b,
+                     "b[{}] is {}, expected {}.", i, host_b[i], expected_b);
+    }
+    auto commands = static_cast<double>(frames * dispatches_per_frame);
+    LUISA_INFO("Re-encoded: {:.3f} us per command submission.", encode_time * 1e3 / commands);
+    LUISA_INFO("Replayed:   {:.3f} us per command submission.", replay_time * 1e3 / commands);
+}
@@ -0,0 +1,78 @@
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/unordered_map.h>
+#include <luisa/runtime/rhi/command_encoder.h>
+#include "../backends/common/command_reorder_visitor.h"
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// shaders read argument 0, write argument 1 and read the bindless array in argument 2
+struct SyntheticFuncTable {
+    luisa::unordered_map<uint64_t, luisa::vector<uint64_t>> *bindless;
+    template<typename F>
+    void traverse_bindless(uint64_t bindless_handle, F &&f) const noexcept {
+        for (auto res : bindless->at(bindless_handle)) { f(res); }
+    }
+    Usage get_usage(uint64_t shader_handle, size_t argument_index) const noexcept {
+        return argument_index == 1u ? Usage::WRITE : Usage::READ;
+    }
+    void update_bindless(uint64_t handle, luisa::span<const BindlessArrayUpdateCommand::Modification> modifications) const noexcept {}
+    luisa::span<const Argument> shader_bindings(uint64_t handle) const noexcept { return {}; }
+    void lock_bindless(uint64_t bindless_handle) const noexcept {}
+    void unlock_bindless(uint64_t bindless_handle) const noexcept {}
+};
+
+// Feeds synthetic command lists of increasing size to the reorder visitor. Every list
+// uploads a buffer referenced by a bindless array, then runs two passes of dispatches,
+// each on its own slice of two large buffers, so the commands must form exactly 3 layers.
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    constexpr auto shader = 1ull;
+    constexpr auto buffer_a = 2ull;
+    constexpr auto buffer_b = 3ull;
+    constexpr auto buffer_c = 4ull;
+    constexpr auto bindless_array = 5ull;
+    constexpr auto slice_size = 256ull;
+    auto bindless_size = argc > 1 ? std::stoull(argv[1]) : 1024ull;
+
+    luisa::unordered_map<uint64_t, luisa::vector<uint64_t>> bindless;
+    auto &&bindless_res = bindless[bindless_array];
+    for (auto i = 0ull; i < bindless_size; i++) {
+        bindless_res.emplace_back(1000ull + i);
+    }
+    bindless_res.emplace_back(buffer_c);
+    CommandReorderVisitor<SyntheticFuncTable, true> reorder{SyntheticFuncTable{&bindless}};
+
+    for (auto n : {256u, 1024u, 4096u, 16384u}) {
+        luisa::vector<luisa::unique_ptr<Command>> commands;
+        auto data = 0u;
+        commands.emplace_back(luisa::make_unique<BufferUploadCommand>(buffer_c, 0u, sizeof(data), &data));
+        auto dispatch = [&](uint64_t src, uint64_t dst, size_t slice) noexcept {
+            ComputeDispatchCmdEncoder encoder{shader, 3u, 0u};
+            encoder.encode_buffer(src, slice * slice_size, slice_size);
+            encoder.encode_buffer(dst, slice * slice_size, slice_size);
+            encoder.encode_bindless_array(bindless_array);
+            encoder.set_dispatch_size(make_uint3(1u));
+            commands.emplace_back(std::move(encoder).build());
+        };
+        for (auto i = 0u; i < n; i++) { dispatch(buffer_a, buffer_b, i); }
+        for (auto i = 0u; i < n; i++) { dispatch(buffer_b, buffer_a, i); }
+
+        Clock clock;
+        for (auto &&cmd : commands) { cmd->accept(reorder); }
+        auto time = clock.toc();
+        auto layers = reorder.command_lists();
+        LUISA_ASSERT(layers.size() == 3u, "Expected 3 layers, got {}.", layers.size());
+        for (auto i = 0u; i < layers.size(); i++) {
+            auto count = 0u;
+            for (auto cmd = layers[i]; cmd != nullptr; cmd = cmd->p_next) { count++; }
+            LUISA_ASSERT(count == (i == 0u ? 1u : n), "Layer {} has {} commands.", i, count);
+        }
+        reorder.clear();
+        LUISA_INFO("{:>6} commands: {:8.3f} ms ({:.3f} us per command)",
+                   commands.size(), time, time * 1e3 / static_cast<double>(commands.size()));
+    }
+}
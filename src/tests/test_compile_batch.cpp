@@ -0,0 +1,68 @@
+#include <algorithm>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/shader_compile_batch.h>
+#include <luisa/dsl/syntax.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+int main(int argc, char *argv[]) {
+
+    log_level_verbose();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend>. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    Device device = context.create_device(argv[1]);
+    Stream stream = device.create_stream();
+
+    static constexpr auto kernel_count = 64u;
+    static constexpr auto n = 1024u;
+
+    // sequential baseline
+    Clock clock;
+    for (auto i = 0u; i < kernel_count; i++) {
+        auto scale = static_cast<float>(i % (kernel_count / 2u));
+        Kernel1D kernel = [scale](BufferFloat buffer) noexcept {
+            auto x = dispatch_id().x;
+            buffer.write(x, buffer.read(x) * scale + 1.f);
+        };
+        auto shader = device.compile(kernel, {.enable_cache = false});
+    }
+    LUISA_INFO("Sequential compilation of {} kernels: {} ms.", kernel_count, clock.toc());
+
+    // batched compilation; every kernel appears twice under different names,
+    // so half of them are deduplicated
+    clock.tic();
+    auto batch = device.compile_batch();
+    luisa::vector<std::shared_future<luisa::shared_ptr<Shader1D<Buffer<float>>>>> shaders;
+    for (auto i = 0u; i < kernel_count; i++) {
+        auto scale = static_cast<float>(i % (kernel_count / 2u));
+        shaders.emplace_back(batch.compile_async<1>([scale](BufferFloat buffer) noexcept {
+            auto x = dispatch_id().x;
+            buffer.write(x, buffer.read(x) * scale + 1.f);
+        }, {.enable_cache = false, .name = luisa::format("scale_{}", i)}));
+    }
+    batch.wait();
+    LUISA_INFO("Batched compilation of {} kernels: {} ms.", kernel_count, clock.toc());
+    batch.report();
+
+    auto stats = batch.statistics();
+    auto deduplicated = std::count_if(stats.cbegin(), stats.cend(), [](auto &&s) noexcept { return s.deduplicated; });
+    LUISA_ASSERT(deduplicated == kernel_count / 2u, "Expected {} deduplicated shaders, got {}.", kernel_count / 2u, deduplicated);
+
+    auto buffer = device.create_buffer<float>(n);
+    luisa::vector<float> host(n, 1.f);
+    stream << buffer.copy_from(host.data())
+           << (*shaders[3].get())(buffer).dispatch(n)
+           << buffer.copy_to(host.data())
+           << synchronize();
+    LUISA_ASSERT(host[0] == 4.f, "Unexpected result: {}.", host[0]);
+    LUISA_INFO("OK");
+}
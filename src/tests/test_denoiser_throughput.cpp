@@ -0,0 +1,112 @@
+#include <cmath>
+#include <random>
+#include <limits>
+#include <algorithm>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/buffer.h>
+#include <luisa/backends/ext/denoiser_ext.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// Measures DenoiserExt::denoise on a 4K frame, with and without the albedo and normal
+// guides, and checks the PSNR of the result against the noise-free frame.
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend>. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    constexpr auto rounds = 5u;
+    constexpr auto width = 3840u;
+    constexpr auto height = 2160u;
+    constexpr auto pixel_count = static_cast<size_t>(width) * height;
+
+    Device device = context.create_device(argv[1]);
+    Stream stream = device.create_stream();
+    auto denoiser_ext = device.extension<DenoiserExt>();
+    if (denoiser_ext == nullptr) {
+        LUISA_WARNING("DenoiserExt is not supported by backend {}.", argv[1]);
+        return 0;
+    }
+
+    // two planes under smooth lighting, with a checkerboard albedo; the noise has the
+    // distribution of the mean of 4 exponentially distributed samples
+    luisa::vector<float4> reference(pixel_count);
+    luisa::vector<float4> noisy(pixel_count);
+    luisa::vector<float4> albedos(pixel_count);
+    luisa::vector<float4> normals(pixel_count);
+    std::mt19937 random{19937u};
+    std::gamma_distribution<float> noise{4.f, .25f};
+    for (auto i = 0u; i < pixel_count; i++) {
+        auto x = static_cast<float>(i % width) / width;
+        auto y = static_cast<float>(i / width) / height;
+        auto left = x + .3f * y < .6f;
+        auto checker = (i % width / 120u + i / width / 120u) % 2u == 0u;
+        auto albedo = checker ? make_float3(.8f, .3f, .2f) : make_float3(.2f, .5f, .8f);
+        auto normal = left ? make_float3(0.f, 0.f, 1.f) : normalize(make_float3(1.f, 0.f, 1.f));
+        auto irradiance = (.5f + 2.f * x * y) * (left ? 1.f : .4f);
+        reference[i] = make_float4(albedo * irradiance, 1.f);
+        noisy[i] = make_float4(reference[i].xyz() * make_float3(noise(random), noise(random), noise(random)), 1.f);
+        albedos[i] = make_float4(albedo, 1.f);
+        normals[i] = make_float4(normal, 0.f);
+    }
+    auto beauty = device.create_buffer<float>(pixel_count * 4u);
+    auto albedo = device.create_buffer<float>(pixel_count * 4u);
+    auto normal = device.create_buffer<float>(pixel_count * 4u);
+    auto output = device.create_buffer<float>(pixel_count * 4u);
+    stream << beauty.copy_from(noisy.data())
+           << albedo.copy_from(albedos.data())
+           << normal.copy_from(normals.data())
+           << synchronize();
+
+    // on [0, 1], where the display would clamp
+    auto psnr = [&](const luisa::vector<float4> &image) noexcept {
+        auto squared_error = 0.;
+        for (auto i = 0u; i < pixel_count; i++) {
+            for (auto k = 0u; k < 3u; k++) {
+                auto error = std::min(image[i][k], 1.f) - std::min(reference[i][k], 1.f);
+                squared_error += static_cast<double>(error) * error;
+            }
+        }
+        return -10. * std::log10(std::max(squared_error / (pixel_count * 3.), 1e-12));
+    };
+    auto noisy_psnr = psnr(noisy);
+    LUISA_INFO("{} x {} noisy: PSNR {:6.2f} dB", width, height, noisy_psnr);
+
+    struct Case {
+        const char *name;
+        bool guided;
+        double min_psnr;
+    };
+    Case cases[] = {{"unguided", false, 24.},
+                    {"albedo + normal", true, 38.}};
+    Buffer<float> no_guide;
+    luisa::vector<float4> denoised(pixel_count);
+    for (auto &&c : cases) {
+        auto best = std::numeric_limits<double>::max();
+        for (auto r = 0u; r < rounds; r++) {
+            stream << synchronize();
+            Clock clock;
+            denoiser_ext->denoise(stream, make_uint2(width, height), beauty, output,
+                                  c.guided ? normal : no_guide, c.guided ? albedo : no_guide, nullptr, 0u);
+            stream << synchronize();
+            best = std::min(best, clock.toc());
+        }
+        stream << output.copy_to(denoised.data()) << synchronize();
+        auto denoised_psnr = psnr(denoised);
+        LUISA_INFO("{} x {} {:>15}: {:8.3f} ms, {:8.2f} M pixels/s, PSNR {:6.2f} dB",
+                   width, height, c.name, best,
+                   static_cast<double>(pixel_count) / (best * 1e-3) * 1e-6, denoised_psnr);
+        LUISA_ASSERT(denoised_psnr >= c.min_psnr, "PSNR of the {} denoiser is {:.2f} dB, below {:.2f} dB.",
+                     c.name, denoised_psnr, c.min_psnr);
+    }
+}
@@ -0,0 +1,117 @@
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <tuple>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/binary_file_stream.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/buffer.h>
+#include <luisa/backends/ext/dstorage_ext.hpp>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// Compares streaming a file into a buffer through DStorage (uncompressed, LZ4 and
+// GDeflate) with the synchronous path, i.e. BinaryFileStream and a buffer upload on
+// the caller thread. The files are freshly written, so they are likely read from the
+// page cache; drop the caches between runs to measure the storage device instead.
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend> [size in MiB]. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    auto size_mb = argc > 2 ? std::stoull(argv[2]) : 256ull;
+    auto size_bytes = size_mb * 1024ull * 1024ull;
+    constexpr auto request_size = 16ull * 1024ull * 1024ull;
+    constexpr auto rounds = 5u;
+
+    Device device = context.create_device(argv[1]);
+    auto dstorage_ext = device.extension<DStorageExt>();
+
+    // moderately compressible data: runs of random bytes from a small alphabet
+    luisa::vector<uint> data(size_bytes / sizeof(uint));
+    std::mt19937 rng{42u};
+    for (auto i = 0u; i < data.size(); i++) {
+        data[i] = (i % 64u < 48u) ? rng() % 16u : i;
+    }
+    auto write_file = [](const char *path, const void *data, size_t size) noexcept {
+        std::ofstream file{path, std::ios::binary};
+        file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    };
+    write_file("test_dstorage_throughput.bin", data.data(), luisa::span{data}.size_bytes());
+
+    auto buffer = device.create_buffer<uint>(data.size());
+    auto stream = device.create_stream(StreamTag::COPY);
+    auto dstorage_stream = dstorage_ext->create_stream();
+    luisa::vector<uint> result(data.size());
+    auto check = [&](luisa::string_view name) noexcept {
+        stream << buffer.copy_to(result.data()) << synchronize();
+        LUISA_ASSERT(std::memcmp(result.data(), data.data(), luisa::span{data}.size_bytes()) == 0,
+                     "Mismatched data read with {}.", name);
+        std::fill(result.begin(), result.end(), 0u);
+        stream << buffer.copy_from(result.data()) << synchronize();
+    };
+    auto report = [&](luisa::string_view name, double time, size_t file_size) noexcept {
+        LUISA_INFO("{:>16}: {:8.3f} ms, {:6.2f} GiB/s (file: {} MiB)",
+                   name, time, static_cast<double>(size_bytes) / (time * 1e-3) / (1024. * 1024. * 1024.),
+                   file_size / 1024u / 1024u);
+    };
+
+    // synchronous path
+    {
+        luisa::vector<std::byte> host(size_bytes);
+        auto best = std::numeric_limits<double>::max();
+        for (auto r = 0u; r < rounds; r++) {
+            Clock clock;
+            BinaryFileStream file{"test_dstorage_throughput.bin"};
+            file.read(host);
+            stream << buffer.copy_from(host.data()) << synchronize();
+            best = std::min(best, clock.toc());
+        }
+        check("BinaryFileStream");
+        report("BinaryFileStream", best, size_bytes);
+    }
+
+    // DStorage, with the file split into a batch of requests
+    auto read = [&](luisa::string_view name, const char *path, DStorageCompression compression) noexcept {
+        auto file = dstorage_ext->open_file(path);
+        auto best = std::numeric_limits<double>::max();
+        for (auto r = 0u; r < rounds; r++) {
+            Clock clock;
+            CommandList list;
+            if (compression == DStorageCompression::None) {
+                for (auto offset = 0ull; offset < size_bytes; offset += request_size) {
+                    auto size = std::min(request_size, size_bytes - offset);
+                    list << file.view(offset, size).copy_to(
+                        buffer.view(offset / sizeof(uint), size / sizeof(uint)));
+                }
+            } else {
+                list << file.copy_to(buffer, compression);
+            }
+            dstorage_stream << list.commit() << synchronize();
+            best = std::min(best, clock.toc());
+        }
+        check(name);
+        report(name, best, file.size_bytes());
+    };
+    read("DStorage", "test_dstorage_throughput.bin", DStorageCompression::None);
+    for (auto [name, compression, path] : {
+             std::make_tuple("DStorage LZ4", DStorageCompression::LZ4, "test_dstorage_throughput.lz4"),
+             std::make_tuple("DStorage GDeflate", DStorageCompression::GDeflate, "test_dstorage_throughput.gdeflate")}) {
+        luisa::vector<std::byte> compressed;
+        Clock clock;
+        dstorage_ext->compress(data.data(), luisa::span{data}.size_bytes(), compression,
+                               DStorageCompressionQuality::Default, compressed);
+        LUISA_INFO("Compressed with {} in {} ms.", name, clock.toc());
+        write_file(path, compressed.data(), compressed.size());
+        read(name, path, compression);
+    }
+}
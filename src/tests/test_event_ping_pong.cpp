@@ -0,0 +1,65 @@
+#include <array>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/event.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/dsl/syntax.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// Two streams take turns incrementing a counter, synchronized only by a
+// timeline event: stream 0 waits for 2i, stream 1 waits for 2i + 1.
+int main(int argc, char *argv[]) {
+
+    log_level_verbose();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend> [rounds]. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    Device device = context.create_device(argv[1]);
+    auto rounds = argc > 2 ? std::stoull(argv[2]) : 10000ull;
+
+    Kernel1D increment_kernel = [](BufferUInt counter, BufferUInt turns, UInt round) noexcept {
+        // log the value seen by each turn, the streams must strictly alternate
+        turns.write(round, counter.read(0u));
+        counter.write(0u, counter.read(0u) + 1u);
+    };
+    auto increment = device.compile(increment_kernel);
+    auto counter = device.create_buffer<uint>(1u);
+    auto turns = device.create_buffer<uint>(2u * rounds);
+    std::array streams{device.create_stream(), device.create_stream()};
+    auto event = device.create_timeline_event();
+
+    auto zero = 0u;
+    streams[0] << counter.copy_from(&zero) << synchronize();
+    static_cast<void>(device.impl()->query("event_latency_reset"));
+
+    Clock clock;
+    for (auto i = 0ull; i < rounds; i++) {
+        for (auto s = 0u; s < 2u; s++) {
+            auto ticket = 2u * i + s;
+            streams[s] << event.wait(ticket)
+                       << increment(counter, turns, static_cast<uint>(ticket)).dispatch(1u)
+                       << event.signal(ticket + 1u);
+        }
+    }
+    event.synchronize(2u * rounds);
+    auto time = clock.toc();
+    for (auto &&s : streams) { s << synchronize(); }
+
+    luisa::vector<uint> host_log(2u * rounds);
+    streams[0] << turns.copy_to(host_log.data()) << synchronize();
+    for (auto i = 0u; i < host_log.size(); i++) {
+        LUISA_ASSERT(host_log[i] == i, "Turn {} observed counter {}.", i, host_log[i]);
+    }
+    LUISA_INFO("{} round trips in {} ms ({:.2f} us per hand-off).",
+               rounds, time, time * 1e3 / static_cast<double>(2u * rounds));
+    if (auto latency = device.impl()->query("event_latency"); !latency.empty()) {
+        LUISA_INFO("Event latency: {}", latency);
+    }
+}
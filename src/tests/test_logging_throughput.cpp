@@ -0,0 +1,122 @@
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/vector.h>
+
+using namespace luisa;
+
+// formats messages like a real sink but discards them
+class CountingSink final : public spdlog::sinks::base_sink<std::mutex> {
+
+public:
+    std::atomic<size_t> count{0u};
+
+protected:
+    void sink_it_(const spdlog::details::log_msg &msg) override {
+        spdlog::memory_buf_t formatted;
+        formatter_->format(msg, formatted);
+        count.fetch_add(1u, std::memory_order_relaxed);
+    }
+    void flush_() override {}
+};
+
+// keeps the message texts
+class RecordingSink final : public spdlog::sinks::base_sink<std::mutex> {
+
+public:
+    luisa::vector<luisa::string> messages;
+
+protected:
+    void sink_it_(const spdlog::details::log_msg &msg) override {
+        messages.emplace_back(msg.payload.data(), msg.payload.size());
+    }
+    void flush_() override {}
+};
+
+// Logs from many threads at once, synchronously and through the asynchronous
+// queue with each overflow policy, and reports the throughput seen by callers.
+int main(int argc, char *argv[]) {
+
+    auto threads = argc > 1 ? std::stoull(argv[1]) : static_cast<size_t>(std::thread::hardware_concurrency());
+    auto messages = argc > 2 ? std::stoull(argv[2]) : 100000ull;
+    auto total = threads * messages;
+
+    log_level_info();
+
+    // the asynchronous queue must write the same texts as synchronous logging
+    auto record = [] {
+        auto sink = std::make_shared<RecordingSink>();
+        detail::set_sink(sink);
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "Local buffer {{%d}}", 42);
+        log_info(buffer);
+        // the message must have been copied
+        std::snprintf(buffer, sizeof(buffer), "Overwritten");
+        LUISA_INFO("Escaped {{braces}}.");
+        LUISA_INFO("Formatted {} with {{braces}}.", 42);
+        log_info(luisa::string{"Plain {{text}}"});
+        log_flush();
+        return sink->messages;
+    };
+    auto sync_messages = record();
+    log_async_enable();
+    auto async_messages = record();
+    log_async_disable();
+    detail::set_sink(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+    LUISA_ASSERT(sync_messages.size() == 4u && sync_messages == async_messages,
+                 "Asynchronous logging wrote different messages.");
+    LUISA_ASSERT(sync_messages[1] == "Escaped {braces}." && sync_messages[3] == "Plain {{text}}",
+                 "Unexpected messages: '{}', '{}'.", sync_messages[1], sync_messages[3]);
+
+    auto run = [&](const char *mode) noexcept {
+        auto sink = std::make_shared<CountingSink>();
+        detail::set_sink(sink);
+        luisa::vector<std::thread> workers;
+        workers.reserve(threads);
+        Clock clock;
+        for (auto t = 0u; t < threads; t++) {
+            workers.emplace_back([t, messages] {
+                for (auto i = 0u; i < messages; i++) {
+                    LUISA_INFO("Thread {} dispatched shader {} with block size ({}, {}, {}).",
+                               t, "test_kernel", i, 256u, 1u, 1u);
+                }
+            });
+        }
+        for (auto &&w : workers) { w.join(); }
+        auto produce_time = clock.toc();
+        log_flush();
+        auto total_time = clock.toc();
+        return std::make_tuple(mode, produce_time, total_time, sink->count.load());
+    };
+    luisa::vector<std::tuple<const char *, double, double, size_t, size_t>> results;
+    auto [mode, produce_time, total_time, count] = run("sync");
+    LUISA_ASSERT(count == total, "Synchronous logging lost messages: {} of {}.", count, total);
+    results.emplace_back(mode, produce_time, total_time, count, 0u);
+    for (auto [name, policy] : {std::make_pair("async (drop)", LogOverflowPolicy::DROP),
+                                std::make_pair("async (block)", LogOverflowPolicy::BLOCK)}) {
+        log_async_enable(8192u, policy);
+        auto [mode, produce_time, total_time, count] = run(name);
+        auto dropped = log_async_dropped_count();
+        log_async_disable();
+        LUISA_ASSERT(count + dropped == total,
+                     "Asynchronous logging lost messages: {} written, {} dropped, {} logged.",
+                     count, dropped, total);
+        LUISA_ASSERT(policy != LogOverflowPolicy::BLOCK || dropped == 0u,
+                     "Blocking policy dropped {} messages.", dropped);
+        results.emplace_back(mode, produce_time, total_time, count, dropped);
+    }
+
+    detail::set_sink(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+    LUISA_INFO("{} threads x {} messages:", threads, messages);
+    for (auto &&[mode, produce_time, total_time, count, dropped] : results) {
+        LUISA_INFO("{:>14}: {:10.0f} msg/s in callers, {:10.0f} msg/s written, {} dropped",
+                   mode, static_cast<double>(total) / (produce_time * 1e-3),
+                   static_cast<double>(count) / (total_time * 1e-3), dropped);
+    }
+}
@@ -0,0 +1,110 @@
+#include <cmath>
+#include <array>
+#include <limits>
+#include <algorithm>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/image.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// Measures generate_mipmaps on 4K and 8K images with each filter, and checks the
+// first box-filtered level against averages computed on the host. Every filter
+// must also keep a constant image constant down to the last level, on backends
+// without native support through the compute fallback of the stream.
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend>. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    constexpr auto rounds = 5u;
+
+    Device device = context.create_device(argv[1]);
+    Stream stream = device.create_stream();
+
+    struct Case {
+        const char *name;
+        MipmapFilter filter;
+        bool srgb;
+    };
+    Case cases[] = {{"box", MipmapFilter::BOX, false},
+                    {"box (sRGB)", MipmapFilter::BOX, true},
+                    {"kaiser", MipmapFilter::KAISER, false},
+                    {"kaiser (sRGB)", MipmapFilter::KAISER, true}};
+
+    for (auto resolution : {4096u, 8192u}) {
+        auto image = device.create_image<float>(PixelStorage::BYTE4, resolution, resolution, 0u);
+        luisa::vector<std::array<uint8_t, 4u>> pixels(resolution * resolution);
+        for (auto i = 0u; i < pixels.size(); i++) {
+            auto x = i % resolution;
+            auto y = i / resolution;
+            pixels[i] = {static_cast<uint8_t>(x ^ y), static_cast<uint8_t>(x * 7u + y),
+                         static_cast<uint8_t>((x * y) >> 3u), static_cast<uint8_t>(255u - (y & 0xffu))};
+        }
+        for (auto &&c : cases) {
+            auto best = std::numeric_limits<double>::max();
+            for (auto r = 0u; r < rounds; r++) {
+                stream << image.copy_from(pixels.data()) << synchronize();
+                Clock clock;
+                stream << image.generate_mipmaps(c.filter, c.srgb) << synchronize();
+                best = std::min(best, clock.toc());
+            }
+            LUISA_INFO("{:>5} x {:<5} {:>14}: {:8.3f} ms, {:8.2f} M texels/s ({} levels)",
+                       resolution, resolution, c.name, best,
+                       static_cast<double>(pixels.size()) / (best * 1e-3) * 1e-6, image.mip_levels());
+        }
+        stream << image.copy_from(pixels.data())
+               << image.generate_mipmaps()
+               << synchronize();
+        auto half_resolution = resolution / 2u;
+        luisa::vector<std::array<uint8_t, 4u>> level(half_resolution * half_resolution);
+        stream << image.view(1u).copy_to(level.data()) << synchronize();
+        auto max_error = 0;
+        for (auto y = 0u; y < half_resolution; y++) {
+            for (auto x = 0u; x < half_resolution; x++) {
+                for (auto k = 0u; k < 4u; k++) {
+                    auto sum = pixels[2u * y * resolution + 2u * x][k] +
+                               pixels[2u * y * resolution + 2u * x + 1u][k] +
+                               pixels[(2u * y + 1u) * resolution + 2u * x][k] +
+                               pixels[(2u * y + 1u) * resolution + 2u * x + 1u][k];
+                    auto expected = static_cast<int>(std::lround(sum / 4.));
+                    max_error = std::max(max_error, std::abs(expected - static_cast<int>(level[y * half_resolution + x][k])));
+                }
+            }
+        }
+        LUISA_ASSERT(max_error <= 1, "Box-filtered level 1 is off by {}.", max_error);
+    }
+    // odd sizes, so that the last rows and columns are clamped on every level
+    constexpr auto width = 1000u;
+    constexpr auto height = 601u;
+    constexpr std::array<uint8_t, 4u> constant{200u, 64u, 17u, 128u};
+    luisa::vector<std::array<uint8_t, 4u>> pixels(width * height, constant);
+    auto image = device.create_image<float>(PixelStorage::BYTE4, width, height, 0u);
+    for (auto &&c : cases) {
+        stream << image.copy_from(pixels.data())
+               << image.generate_mipmaps(c.filter, c.srgb)
+               << synchronize();
+        for (auto level = 1u; level < image.mip_levels(); level++) {
+            auto view = image.view(level);
+            luisa::vector<std::array<uint8_t, 4u>> texels(view.size().x * view.size().y);
+            stream << view.copy_to(texels.data()) << synchronize();
+            auto max_error = 0;
+            for (auto &&t : texels) {
+                for (auto k = 0u; k < 4u; k++) {
+                    max_error = std::max(max_error, std::abs(static_cast<int>(t[k]) - static_cast<int>(constant[k])));
+                }
+            }
+            LUISA_ASSERT(max_error <= 1, "Level {} of a constant image is off by {} with the {} filter.",
+                         level, max_error, c.name);
+        }
+    }
+}
@@ -0,0 +1,483 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/buffer.h>
+#include <luisa/dsl/sugar.h>
+#include <luisa/osl/symbol.h>
+#include <luisa/osl/instruction.h>
+#include <luisa/osl/shader.h>
+#include <luisa/osl/oso_parser.h>
+#include <luisa/osl/translator.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// mandelbrot.osl from the OSL test suite, as compiled by oslc
+static constexpr auto mandelbrot_oso = R"(OpenShadingLanguage 1.00
+# Compiled by oslc 1.13.4.0dev
+surface mandelbrot
+param	point	center	0 0 0		%read{0,0} %write{2147483647,-1}
+param	float	scale	2		%read{7,7} %write{2147483647,-1}
+param	int	iters	100		%read{13,46} %write{2147483647,-1}
+param	int	julia	0		%read{23,23} %write{2147483647,-1}
+param	point	P_julia	0 0 0		%read{30,30} %write{2147483647,-1}
+param	color[]	colormap	0 0 0.00999999978 0 0 0.00999999978 0 0 0.5 0.75 0.25 0 0.949999988 0.949999988 0 1 1 1 1 1 1		%read{51,51} %write{2147483647,-1}
+oparam	float	fout	0		%read{2147483647,-1} %write{41,41}
+oparam	color	Cout	0 0 0		%read{2147483647,-1} %write{51,52}
+global	float	u	%read{1,1} %write{2147483647,-1}
+global	float	v	%read{3,3} %write{2147483647,-1}
+local	point	cent	%read{8,8} %write{0,0}
+local	point	c	%read{9,38} %write{8,8}
+local	point	z	%read{13,38} %write{9,38}
+local	point	iota	%read{2147483647,-1} %write{10,10}
+local	int	i	%read{13,42} %write{12,38}
+local	float	___345_x	%read{13,38} %write{13,38}
+local	float	___345_y	%read{13,38} %write{13,38}
+local	float	___348_f	%read{51,51} %write{50,50}
+temp	point	$tmp1	%read{7,7} %write{6,6}
+const	float	$const2	0.5		%read{1,4} %write{2147483647,-1}
+temp	float	$tmp2	%read{2,2} %write{1,1}
+temp	float	$tmp3	%read{6,6} %write{2,2}
+const	float	$const3	2		%read{2,34} %write{2147483647,-1}
+const	int	$const4	1		%read{12,38} %write{2147483647,-1}
+temp	float	$tmp4	%read{4,4} %write{3,3}
+const	float	$const5	1		%read{3,49} %write{2147483647,-1}
+temp	float	$tmp5	%read{5,5} %write{4,4}
+temp	float	$tmp6	%read{6,6} %write{5,5}
+const	int	$const6	0		%read{14,52} %write{2147483647,-1}
+const	float	$const7	0		%read{6,36} %write{2147483647,-1}
+temp	point	$tmp7	%read{8,8} %write{7,7}
+const	point	$const8	1 2 0		%read{10,10} %write{2147483647,-1}
+temp	int	$tmp8	%read{13,38} %write{13,38}
+temp	int	$tmp9	%read{13,38} %write{13,38}
+temp	float	$tmp10	%read{13,38} %write{13,38}
+const	float	$const9	4		%read{17,17} %write{2147483647,-1}
+temp	int	$tmp11	%read{13,38} %write{13,38}
+temp	int	$tmp12	%read{13,38} %write{13,38}
+temp	int	$tmp13	%read{11,38} %write{12,38}
+temp	point	$tmp14	%read{13,38} %write{13,38}
+temp	float	$tmp15	%read{13,38} %write{13,38}
+temp	float	$tmp16	%read{13,38} %write{13,38}
+temp	float	$tmp17	%read{13,38} %write{13,38}
+temp	float	$tmp18	%read{13,38} %write{13,38}
+temp	float	$tmp19	%read{13,38} %write{13,38}
+temp	point	$tmp20	%read{13,38} %write{13,38}
+temp	float	$tmp21	%read{13,38} %write{13,38}
+temp	float	$tmp22	%read{13,38} %write{13,38}
+temp	float	$tmp23	%read{13,38} %write{13,38}
+temp	float	$tmp24	%read{13,38} %write{13,38}
+temp	float	$tmp25	%read{13,38} %write{13,38}
+temp	int	$tmp26	%read{40,40} %write{39,39}
+temp	float	$tmp27	%read{45,45} %write{43,43}
+temp	float	$tmp28	%read{43,43} %write{42,42}
+temp	float	$tmp29	%read{50,50} %write{45,45}
+temp	float	$tmp30	%read{45,45} %write{44,44}
+temp	float	$tmp31	%read{49,49} %write{48,48}
+temp	float	$tmp32	%read{48,48} %write{47,47}
+temp	float	$tmp33	%read{47,47} %write{46,46}
+temp	float	$tmp34	%read{50,50} %write{49,49}
+const	string	$const10	"linear"		%read{51,51} %write{2147483647,-1}
+code ___main___
+	assign		cent center 	%line{36} %argrw{"wr"}
+	sub		$tmp2 u $const2 	%line{37} %argrw{"wrr"}
+	mul		$tmp3 $const3 $tmp2 	%argrw{"wrr"}
+	sub		$tmp4 $const5 v 	%argrw{"wrr"}
+	sub		$tmp5 $tmp4 $const2 	%argrw{"wrr"}
+	mul		$tmp6 $const3 $tmp5 	%argrw{"wrr"}
+	point		$tmp1 $tmp3 $tmp6 $const7 	%argrw{"wrrr"}
+	mul		$tmp7 scale $tmp1 	%argrw{"wrr"}
+	add		c $tmp7 cent 	%argrw{"wrr"}
+	assign		z c 	%line{38} %argrw{"wr"}
+	assign		iota $const8 	%line{39} %argrw{"wr"}
+	for		$tmp13 13 21 38 39 	%line{41} %argrw{"r"}
+	assign		i $const4 	%argrw{"wr"}
+	lt		$tmp8 i iters 	%argrw{"wrr"}
+	neq		$tmp9 $tmp8 $const6 	%argrw{"wrr"}
+	if		$tmp9 20 20 	%argrw{"r"}
+	dot		$tmp10 z z 	%argrw{"wrr"}
+	lt		$tmp11 $tmp10 $const9 	%argrw{"wrr"}
+	neq		$tmp12 $tmp11 $const6 	%argrw{"wrr"}
+	assign		$tmp9 $tmp12 	%argrw{"wr"}
+	neq		$tmp13 $tmp9 $const6 	%argrw{"wrr"}
+	compref		___345_x z $const6 	%line{47} %argrw{"wrr"}
+	compref		___345_y z $const4 	%argrw{"wrr"}
+	if		julia 31 38 	%line{48} %argrw{"r"}
+	mul		$tmp15 ___345_x ___345_x 	%line{49} %argrw{"wrr"}
+	mul		$tmp16 ___345_y ___345_y 	%argrw{"wrr"}
+	sub		$tmp17 $tmp15 $tmp16 	%argrw{"wrr"}
+	mul		$tmp18 $const3 ___345_x 	%argrw{"wrr"}
+	mul		$tmp19 $tmp18 ___345_y 	%argrw{"wrr"}
+	point		$tmp14 $tmp17 $tmp19 $const7 	%argrw{"wrrr"}
+	add		z $tmp14 P_julia 	%argrw{"wrr"}
+	mul		$tmp21 ___345_x ___345_x 	%line{51} %argrw{"wrr"}
+	mul		$tmp22 ___345_y ___345_y 	%argrw{"wrr"}
+	sub		$tmp23 $tmp21 $tmp22 	%argrw{"wrr"}
+	mul		$tmp24 $const3 ___345_x 	%argrw{"wrr"}
+	mul		$tmp25 $tmp24 ___345_y 	%argrw{"wrr"}
+	point		$tmp20 $tmp23 $tmp25 $const7 	%argrw{"wrrr"}
+	add		z $tmp20 c 	%argrw{"wrr"}
+	add		i i $const4 	%line{41} %argrw{"wrr"}
+	lt		$tmp26 i iters 	%line{54} %argrw{"wrr"}
+	if		$tmp26 52 53 	%argrw{"r"}
+	assign		fout i 	%line{55} %argrw{"wr"}
+	assign		$tmp28 i 	%line{56} %argrw{"wr"}
+	assign		$tmp27 $tmp28 	%argrw{"wr"}
+	assign		$tmp30 iters 	%argrw{"wr"}
+	div		$tmp29 $tmp27 $tmp30 	%argrw{"wrr"}
+	assign		$tmp33 iters 	%argrw{"wr"}
+	assign		$tmp32 $tmp33 	%argrw{"wr"}
+	log10		$tmp31 $tmp32 	%argrw{"wr"}
+	div		$tmp34 $const5 $tmp31 	%argrw{"wrr"}
+	pow		___348_f $tmp29 $tmp34 	%argrw{"wrr"}
+	spline		Cout $const10 ___348_f colormap 	%line{57} %argrw{"wrrr"}
+	assign		Cout $const6 	%line{59} %argrw{"wr"}
+	end
+)";
+
+// The baseline: a naive interpreter of the shader bytecode, with the
+// structured control flow of OSO lowered to jumps. All values live in
+// float4 registers, with scalars (ints included) splat to all lanes.
+static constexpr auto op_end = 0u;
+static constexpr auto op_jump = 1u;
+static constexpr auto op_jump_if_zero = 2u;
+static constexpr auto op_assign = 3u;
+static constexpr auto op_add = 4u;
+static constexpr auto op_sub = 5u;
+static constexpr auto op_mul = 6u;
+static constexpr auto op_div = 7u;
+static constexpr auto op_lt = 8u;
+static constexpr auto op_neq = 9u;
+static constexpr auto op_dot = 10u;
+static constexpr auto op_compref = 11u;
+static constexpr auto op_point = 12u;
+static constexpr auto op_pow = 13u;
+static constexpr auto op_log10 = 14u;
+static constexpr auto op_spline_linear = 15u;
+static constexpr auto max_registers = 128u;
+
+// instructions are (opcode | dest << 8, operands...)
+class BytecodeCompiler {
+
+private:
+    const osl::Shader &_shader;
+    luisa::unordered_map<const osl::Symbol *, uint> _registers;
+    luisa::vector<float4> _initial_registers;
+    luisa::vector<uint4> _code;
+
+public:
+    explicit BytecodeCompiler(const osl::Shader &shader) noexcept : _shader{shader} {
+        for (auto &&symbol : shader.symbols()) {
+            auto index = static_cast<uint>(_initial_registers.size());
+            auto length = std::max(symbol->array_length(), 1);
+            if (symbol->is_unbounded()) { length = static_cast<int>(symbol->initial_values().size() / 3u); }
+            auto values = symbol->initial_values();
+            for (auto i = 0; i < length; i++) {
+                auto value = make_float4(0.f);
+                if (values.size() >= static_cast<size_t>(length) * 3u) {
+                    value = make_float4(values[i * 3].as_float(), values[i * 3 + 1].as_float(),
+                                        values[i * 3 + 2].as_float(), 0.f);
+                } else if (!values.empty() && values[0].is_number()) {
+                    value = make_float4(values[0].as_float());
+                }
+                _initial_registers.emplace_back(value);
+            }
+            _registers.emplace(symbol.get(), index);
+        }
+        LUISA_ASSERT(_initial_registers.size() <= max_registers, "Too many registers.");
+        for (auto &&marker : shader.code_markers()) {
+            if (marker.identifier == "___main___") {
+                _compile(marker.instruction, static_cast<uint>(shader.instructions().size()));
+            }
+        }
+        _emit(op_end, 0u);
+    }
+    [[nodiscard]] auto code() const noexcept { return luisa::span{_code}; }
+    [[nodiscard]] auto initial_registers() const noexcept { return luisa::span{_initial_registers}; }
+    [[nodiscard]] uint register_of(luisa::string_view identifier) const noexcept {
+        for (auto &&[symbol, index] : _registers) {
+            if (symbol->identifier() == identifier) { return index; }
+        }
+        LUISA_ERROR_WITH_LOCATION("Symbol '{}' not found.", identifier);
+    }
+
+private:
+    uint _emit(uint op, uint dest, uint a = 0u, uint b = 0u, uint c = 0u) noexcept {
+        _code.emplace_back(make_uint4(op | dest << 8u, a, b, c));
+        return static_cast<uint>(_code.size() - 1u);
+    }
+    void _patch(uint jump) noexcept { _code[jump].y = static_cast<uint>(_code.size()); }
+    void _compile(uint begin, uint end) noexcept {
+        for (auto pc = begin; pc < end;) {
+            auto &&instruction = _shader.instructions()[pc];
+            auto op = instruction->opcode();
+            auto targets = instruction->jump_targets();
+            luisa::vector<uint> r;
+            for (auto arg : instruction->args()) { r.emplace_back(_registers.at(arg)); }
+            if (op == "if") {
+                auto else_begin = static_cast<uint>(targets[0]);
+                auto if_end = static_cast<uint>(targets[1]);
+                auto skip_true = _emit(op_jump_if_zero, r[0]);
+                _compile(pc + 1u, else_begin);
+                if (else_begin != if_end) {
+                    auto skip_false = _emit(op_jump, 0u);
+                    _patch(skip_true);
+                    _compile(else_begin, if_end);
+                    _patch(skip_false);
+                } else {
+                    _patch(skip_true);
+                }
+                pc = if_end;
+                continue;
+            }
+            if (op == "for") {
+                _compile(pc + 1u, targets[0]);
+                auto cond = static_cast<uint>(_code.size());
+                _compile(targets[0], targets[1]);
+                auto exit = _emit(op_jump_if_zero, r[0]);
+                _compile(targets[1], targets[3]);
+                _emit(op_jump, 0u, cond);
+                _patch(exit);
+                pc = targets[3];
+                continue;
+            }
+            if (op == "assign") {
+                _emit(op_assign, r[0], r[1]);
+            } else if (op == "add") {
+                _emit(op_add, r[0], r[1], r[2]);
+            } else if (op == "sub") {
+                _emit(op_sub, r[0], r[1], r[2]);
+            } else if (op == "mul") {
+                _emit(op_mul, r[0], r[1], r[2]);
+            } else if (op == "div") {
+                _emit(op_div, r[0], r[1], r[2]);
+            } else if (op == "lt") {
+                _emit(op_lt, r[0], r[1], r[2]);
+            } else if (op == "neq") {
+                _emit(op_neq, r[0], r[1], r[2]);
+            } else if (op == "dot") {
+                _emit(op_dot, r[0], r[1], r[2]);
+            } else if (op == "compref") {
+                _emit(op_compref, r[0], r[1], r[2]);
+            } else if (op == "point") {
+                _emit(op_point, r[0], r[1], r[2], r[3]);
+            } else if (op == "pow") {
+                _emit(op_pow, r[0], r[1], r[2]);
+            } else if (op == "log10") {
+                _emit(op_log10, r[0], r[1]);
+            } else if (op == "spline") {
+                auto knots = instruction->args()[3];
+                auto count = static_cast<uint>(knots->initial_values().size() / 3u);
+                _emit(op_spline_linear, r[0], r[2], r[3], count);
+            } else {
+                LUISA_ERROR_WITH_LOCATION("Unsupported instruction '{}'.", op);
+            }
+            pc++;
+        }
+    }
+};
+
+// calls the translated shader with its arguments looked up by name
+static void invoke(const osl::Translator::Translation &translation,
+                   const luisa::unordered_map<luisa::string, const Expression *> &arguments) noexcept {
+    luisa::vector<const Expression *> args;
+    for (auto &&argument : translation.arguments) {
+        auto iter = arguments.find(argument.identifier);
+        LUISA_ASSERT(iter != arguments.end(), "Missing argument '{}'.", argument.identifier);
+        args.emplace_back(iter->second);
+    }
+    detail::FunctionBuilder::current()->call(translation.function->function(), args);
+}
+
+// Renders mandelbrot.osl with the bytecode interpreter, the translated shader with all
+// its parameters passed in, and the translation specialized to the default parameters.
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend> [resolution]. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    constexpr auto rounds = 5u;
+    auto resolution = argc > 2 ? static_cast<uint>(std::stoul(argv[2])) : 512u;
+    auto pixel_count = static_cast<size_t>(resolution) * resolution;
+
+    auto shader = osl::OSOParser::parse(mandelbrot_oso);
+    auto specialization = osl::Translator::default_specialization(*shader);
+
+    osl::Translator translator;
+    Clock clock;
+    auto generic = translator.translate(*shader);
+    auto generic_ms = clock.toc();
+    clock.tic();
+    auto specialized = translator.translate(*shader, specialization);
+    auto specialized_ms = clock.toc();
+    LUISA_ASSERT(generic != nullptr && specialized != nullptr, "Failed to translate the shader.");
+    LUISA_INFO("Translated in {:.3f} ms (generic) and {:.3f} ms (specialized).", generic_ms, specialized_ms);
+
+    // cached by content, and the offset of julia sets is dead code when julia = 0
+    clock.tic();
+    LUISA_ASSERT(translator.translate(*shader, specialization) == specialized, "Translation is not cached.");
+    auto cached_ms = clock.toc();
+    auto offset = specialization;
+    offset["P_julia"] = {.3, .5, 0.};
+    auto offset_translation = translator.translate(*shader, offset);
+    LUISA_ASSERT(offset_translation != specialized &&
+                     offset_translation->function == specialized->function &&
+                     translator.function_count() == 2u,
+                 "Identical specializations are not deduplicated.");
+    LUISA_INFO("Cached translation in {:.3f} ms, {} distinct callables.", cached_ms, translator.function_count());
+
+    Device device = context.create_device(argv[1]);
+    Stream stream = device.create_stream();
+
+    BytecodeCompiler compiler{*shader};
+    auto code = device.create_buffer<uint4>(compiler.code().size());
+    auto initial_registers = device.create_buffer<float4>(compiler.initial_registers().size());
+    stream << code.copy_from(compiler.code().data())
+           << initial_registers.copy_from(compiler.initial_registers().data());
+    auto colormap_values = compiler.initial_registers().subspan(compiler.register_of("colormap"), 7u);
+    auto colormap = device.create_buffer<float4>(colormap_values.size());
+    stream << colormap.copy_from(colormap_values.data());
+    auto output = device.create_buffer<float4>(pixel_count);
+
+    auto uv = [resolution] {
+        auto p = dispatch_id().xy();
+        return (make_float2(p) + .5f) / static_cast<float>(resolution);
+    };
+    auto store = [resolution](BufferFloat4 &image, Expr<float3> color, Expr<float> f) noexcept {
+        auto p = dispatch_id().xy();
+        image.write(p.y * resolution + p.x, make_float4(color, f));
+    };
+
+    auto u_register = compiler.register_of("u");
+    auto v_register = compiler.register_of("v");
+    auto fout_register = compiler.register_of("fout");
+    auto cout_register = compiler.register_of("Cout");
+    auto register_count = static_cast<uint>(compiler.initial_registers().size());
+    Kernel2D interpret_kernel = [&](BufferUInt4 code, BufferFloat4 initial, BufferFloat4 image) noexcept {
+        ArrayFloat4<max_registers> r;
+        $for (i, register_count) { r[i] = initial.read(i); };
+        auto p = uv();
+        r[u_register] = make_float4(p.x);
+        r[v_register] = make_float4(p.y);
+        UInt pc = 0u;
+        $loop {
+            UInt4 instruction = code.read(pc);
+            UInt op = instruction.x & 0xffu;
+            UInt d = instruction.x >> 8u;
+            UInt a = instruction.y;
+            UInt b = instruction.z;
+            pc += 1u;
+            $if (op == op_end) { $break; };
+            $switch (op) {
+                $case (op_jump) { pc = a; };
+                $case (op_jump_if_zero) { $if (r[d].x == 0.f) { pc = a; }; };
+                $case (op_assign) { r[d] = r[a]; };
+                $case (op_add) { r[d] = r[a] + r[b]; };
+                $case (op_sub) { r[d] = r[a] - r[b]; };
+                $case (op_mul) { r[d] = r[a] * r[b]; };
+                $case (op_div) { r[d] = ite(r[b] == 0.f, 0.f, r[a] / r[b]); };
+                $case (op_lt) { r[d] = make_float4(ite(r[a].x < r[b].x, 1.f, 0.f)); };
+                $case (op_neq) { r[d] = make_float4(ite(r[a].x != r[b].x, 1.f, 0.f)); };
+                $case (op_dot) { r[d] = make_float4(dot(r[a].xyz(), r[b].xyz())); };
+                $case (op_compref) { r[d] = make_float4(r[a][cast<uint>(r[b].x)]); };
+                $case (op_point) { r[d] = make_float4(r[a].x, r[b].x, r[instruction.w].x, 0.f); };
+                $case (op_pow) { r[d] = pow(r[a], r[b]); };
+                $case (op_log10) { r[d] = log10(r[a]); };
+                $case (op_spline_linear) {
+                    auto segments = instruction.w - 3u;
+                    auto x = clamp(r[a].x, 0.f, 1.f) * cast<float>(segments);
+                    auto segment = min(cast<uint>(x), segments - 1u);
+                    auto t = x - cast<float>(segment);
+                    r[d] = lerp(r[b + segment + 1u], r[b + segment + 2u], t);
+                };
+            };
+        };
+        store(image, r[cout_register].xyz(), r[fout_register].x);
+    };
+
+    Kernel2D generic_kernel = [&](BufferFloat4 image, Float3 center, Float scale, Int iters,
+                                  Int julia, Float3 p_julia, BufferFloat4 colormap) noexcept {
+        ArrayFloat3<7> map;
+        for (auto i = 0u; i < 7u; i++) { map[i] = colormap.read(i).xyz(); }
+        auto p = uv();
+        Float u = p.x;
+        Float v = p.y;
+        Float fout = 0.f;
+        Float3 color = make_float3(0.f);
+        invoke(*generic, {{"u", u.expression()}, {"v", v.expression()}, {"center", center.expression()},
+                          {"scale", scale.expression()}, {"iters", iters.expression()},
+                          {"julia", julia.expression()}, {"P_julia", p_julia.expression()},
+                          {"colormap", map.expression()}, {"fout", fout.expression()},
+                          {"Cout", color.expression()}});
+        store(image, color, fout);
+    };
+
+    Kernel2D specialized_kernel = [&](BufferFloat4 image) noexcept {
+        auto p = uv();
+        Float u = p.x;
+        Float v = p.y;
+        Float fout = 0.f;
+        Float3 color = make_float3(0.f);
+        invoke(*specialized, {{"u", u.expression()}, {"v", v.expression()},
+                              {"fout", fout.expression()}, {"Cout", color.expression()}});
+        store(image, color, fout);
+    };
+
+    auto interpret = device.compile(interpret_kernel);
+    auto generic_shader = device.compile(generic_kernel);
+    auto specialized_shader = device.compile(specialized_kernel);
+
+    auto measure = [&](luisa::string_view name, auto &&dispatch) noexcept {
+        auto best = std::numeric_limits<double>::max();
+        for (auto r = 0u; r < rounds; r++) {
+            stream << synchronize();
+            Clock clock;
+            stream << dispatch() << synchronize();
+            best = std::min(best, clock.toc());
+        }
+        luisa::vector<float4> image(pixel_count);
+        stream << output.copy_to(image.data()) << synchronize();
+        LUISA_INFO("{} x {} {:>12}: {:8.3f} ms, {:8.2f} M pixels/s",
+                   resolution, resolution, name, best,
+                   static_cast<double>(pixel_count) / (best * 1e-3) * 1e-6);
+        return image;
+    };
+    auto interpreted = measure("interpreter", [&] {
+        return interpret(code, initial_registers, output).dispatch(resolution, resolution);
+    });
+    auto translated = measure("generic", [&] {
+        return generic_shader(output, make_float3(0.f), 2.f, 100, 0, make_float3(0.f), colormap)
+            .dispatch(resolution, resolution);
+    });
+    auto folded = measure("specialized", [&] {
+        return specialized_shader(output).dispatch(resolution, resolution);
+    });
+
+    // iteration counts may differ on the boundary of the set due to floating-point contraction
+    auto mismatches = [&](const luisa::vector<float4> &image) noexcept {
+        auto count = static_cast<size_t>(0u);
+        for (auto i = 0u; i < pixel_count; i++) {
+            for (auto k = 0u; k < 4u; k++) {
+                if (std::abs(image[i][k] - interpreted[i][k]) > 1e-3f) {
+                    count++;
+                    break;
+                }
+            }
+        }
+        return count;
+    };
+    auto generic_mismatches = mismatches(translated);
+    auto specialized_mismatches = mismatches(folded);
+    LUISA_INFO("Mismatched pixels: {} (generic), {} (specialized).", generic_mismatches, specialized_mismatches);
+    LUISA_ASSERT(generic_mismatches * 100u <= pixel_count && specialized_mismatches * 100u <= pixel_count,
+                 "Translated shaders do not match the interpreter.");
+}
@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <random>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/thread_pool.h>
+#include <luisa/core/stl/filesystem.h>
+#include <luisa/osl/shader.h>
+#include <luisa/osl/oso_parser.h>
+#include <luisa/osl/shader_library.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// generates a shader with the given number of statements, each of which
+// reads a parameter, does some arithmetic in a branch and writes an output
+[[nodiscard]] static luisa::string synthesize_oso(uint index, uint statements) noexcept {
+    std::mt19937 random{index};
+    std::uniform_real_distribution<float> uniform;
+    luisa::string oso;
+    oso.append("OpenShadingLanguage 1.00\n"
+               "# Compiled by oslc 1.13.4.0dev\n");
+    oso.append(luisa::format("surface synthetic_{}\t%meta{{string,help,\"Synthetic shader #{}\"}}\n", index, index));
+    for (auto i = 0u; i < statements; i++) {
+        oso.append(luisa::format("param\tfloat\tweight_{}\t{}\t\t%meta{{string,help,\"Weight of layer {}\"}} "
+                                 "%meta{{float,min,0}} %meta{{float,max,1}}  %read{{{},{}}} %write{{2147483647,-1}}\n",
+                                 i, uniform(random), i, i * 4u, i * 4u));
+    }
+    oso.append("param\tcolor[]\tpalette\t0 0 0.00999999978 0.5 0.75 0.25 1 1 1\t\t%read{0,0} %write{2147483647,-1}\n"
+               "oparam\tcolor\tCout\t0 0 0\t\t%read{2147483647,-1} %write{0,0}\n"
+               "global\tfloat\tu\t%read{0,0} %write{2147483647,-1}\n"
+               "global\tfloat\tv\t%read{0,0} %write{2147483647,-1}\n"
+               "local\tfloat\tacc\t%read{0,0} %write{0,0}\n");
+    for (auto i = 0u; i < statements; i++) {
+        oso.append(luisa::format("const\tfloat\t$const{}\t{}\t\t%read{{{},{}}} %write{{2147483647,-1}}\n",
+                                 i, uniform(random), i * 4u, i * 4u));
+        oso.append(luisa::format("temp\tint\t$tmp{}\t%read{{{},{}}} %write{{{},{}}}\n",
+                                 i, i * 4u, i * 4u, i * 4u, i * 4u));
+    }
+    oso.append("const\tstring\t$name\t\"linear\"\t\t%read{0,0} %write{2147483647,-1}\n"
+               "code ___main___\n");
+    for (auto i = 0u; i < statements; i++) {
+        auto pc = static_cast<uint>(i * 4u);
+        oso.append(luisa::format("# synthetic.osl:{}\n"
+                                 "\tlt\t\t$tmp{} u weight_{} \t%line{{{}}} %argrw{{\"wrr\"}}\n"
+                                 "\tif\t\t$tmp{} {} {} \t%argrw{{\"r\"}}\n"
+                                 "\tmul\t\tacc v $const{} \t%argrw{{\"wrr\"}}\n"
+                                 "\tadd\t\tacc acc weight_{} \t%argrw{{\"wrr\"}}\n",
+                                 i + 1u, i, i, i + 1u, i, pc + 3u, pc + 4u, i, i));
+    }
+    oso.append("\tspline\t\tCout $name acc palette \t%argrw{\"wrrr\"}\n"
+               "\tend\n");
+    return oso;
+}
+
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    auto file_count = argc > 1 ? static_cast<uint>(std::stoul(argv[1])) : 256u;
+    auto statements = argc > 2 ? static_cast<uint>(std::stoul(argv[2])) : 256u;
+    auto directory = luisa::filesystem::temp_directory_path() / "luisa_test_oso_parser_throughput";
+    auto cache_directory = directory / "cache";
+    std::error_code ec;
+    luisa::filesystem::remove_all(directory, ec);
+    luisa::filesystem::create_directories(directory);
+
+    luisa::vector<luisa::string> paths;
+    auto bytes = static_cast<size_t>(0u);
+    for (auto i = 0u; i < file_count; i++) {
+        auto oso = synthesize_oso(i, statements);
+        auto path = luisa::to_string(directory / luisa::format("synthetic_{}.oso", i));
+        auto file = std::fopen(path.c_str(), "wb");
+        LUISA_ASSERT(file != nullptr, "Failed to create file '{}'.", path);
+        std::fwrite(oso.data(), 1u, oso.size(), file);
+        std::fclose(file);
+        paths.emplace_back(std::move(path));
+        bytes += oso.size();
+    }
+    auto report = [bytes, file_count](luisa::string_view name, double ms) noexcept {
+        LUISA_INFO("{:<24} {:10.3f} ms, {:8.2f} MB/s, {:10.1f} files/s",
+                   name, ms, static_cast<double>(bytes) / (ms * 1e-3) * 1e-6,
+                   file_count / (ms * 1e-3));
+    };
+    LUISA_INFO("{} files with {} statements each, {:.2f} MB in total.",
+               file_count, statements, static_cast<double>(bytes) * 1e-6);
+
+    Clock clock;
+    luisa::vector<luisa::unique_ptr<osl::Shader>> serial;
+    for (auto &&path : paths) { serial.emplace_back(osl::OSOParser::parse_file(path)); }
+    report("serial parse_file", clock.toc());
+
+    ThreadPool pool;
+    clock.tic();
+    auto parallel = osl::OSOParser::parse_files(paths, pool);
+    report("parallel parse_files", clock.toc());
+
+    luisa::vector<const osl::Shader *> cold;
+    {
+        osl::ShaderLibrary library{cache_directory};
+        clock.tic();
+        cold = library.load(paths);
+        report("library (cold)", clock.toc());
+        for (auto i = 0u; i < file_count; i++) {
+            LUISA_ASSERT(cold[i] != nullptr && cold[i]->dump() == serial[i]->dump() &&
+                             parallel[i]->dump() == serial[i]->dump(),
+                         "Mismatched shader from file '{}'.", paths[i]);
+        }
+    }
+
+    osl::ShaderLibrary library{cache_directory};
+    clock.tic();
+    auto warm = library.load(paths);
+    report("library (disk cache)", clock.toc());
+    for (auto i = 0u; i < file_count; i++) {
+        LUISA_ASSERT(warm[i] != nullptr && warm[i]->dump() == serial[i]->dump(),
+                     "Mismatched shader from the cache of file '{}'.", paths[i]);
+    }
+    clock.tic();
+    auto hits = library.load(paths);
+    report("library (memory)", clock.toc());
+    for (auto i = 0u; i < file_count; i++) {
+        LUISA_ASSERT(hits[i] == warm[i], "Shader of file '{}' is loaded twice.", paths[i]);
+    }
+    LUISA_ASSERT(library.size() == file_count, "{} shaders loaded from {} files.",
+                 library.size(), file_count);
+
+    // a truncated cache is rejected instead of crashing the loader
+    auto data = osl::ShaderLibrary::serialize(*serial.front());
+    for (auto size = static_cast<size_t>(0u); size < data.size(); size += 1u + size / 8u) {
+        LUISA_ASSERT(osl::ShaderLibrary::deserialize({data.data(), size}) == nullptr,
+                     "Truncated cache of {} out of {} bytes is accepted.", size, data.size());
+    }
+    LUISA_ASSERT(osl::ShaderLibrary::deserialize(data) != nullptr, "Cache is rejected.");
+    luisa::filesystem::remove_all(directory, ec);
+}
@@ -0,0 +1,301 @@
+#include <cmath>
+#include <random>
+#include <limits>
+#include <algorithm>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/core/stl/optional.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/dsl/syntax.h>
+#include <luisa/dsl/polymorphic_wavefront.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+[[nodiscard]] static Float lcg(UInt &state) noexcept {
+    constexpr auto lcg_a = 1664525u;
+    constexpr auto lcg_c = 1013904223u;
+    state = lcg_a * state + lcg_c;
+    return cast<float>(state & 0x00ffffffu) *
+           (1.0f / static_cast<float>(0x01000000u));
+}
+
+// transforms v from the frame around the unit vector n into world space
+[[nodiscard]] static Float3 to_world(Expr<float3> n, Expr<float3> v) noexcept {
+    auto binormal = normalize(ite(abs(n.x) > abs(n.z),
+                                  make_float3(-n.y, n.x, 0.0f),
+                                  make_float3(0.0f, -n.z, n.y)));
+    auto tangent = normalize(cross(binormal, n));
+    return v.x * tangent + v.y * binormal + v.z * n;
+}
+
+[[nodiscard]] static Float3 spherical(Expr<float> cos_theta, Expr<float> phi) noexcept {
+    auto sin_theta = sqrt(max(1.0f - cos_theta * cos_theta, 0.0f));
+    return make_float3(sin_theta * cos(phi), sin_theta * sin(phi), cos_theta);
+}
+
+// the BSDFs of the path tracing tests and a few more; sample() picks the incident
+// direction wi for the outgoing direction wo and returns the sampling weight
+class Material {
+public:
+    virtual ~Material() noexcept = default;
+    [[nodiscard]] virtual Float3 sample(Expr<float3> wo, Expr<float3> n,
+                                        UInt &state, Float3 &wi) const noexcept = 0;
+};
+
+class Lambert final : public Material {
+
+private:
+    float3 _albedo;
+
+public:
+    explicit Lambert(float3 albedo) noexcept : _albedo{albedo} {}
+    [[nodiscard]] Float3 sample(Expr<float3> wo, Expr<float3> n,
+                                UInt &state, Float3 &wi) const noexcept override {
+        auto ux = lcg(state);
+        auto uy = lcg(state);
+        wi = to_world(n, spherical(sqrt(1.0f - ux), 2.0f * constants::pi * uy));
+        return def(_albedo);
+    }
+};
+
+class Phong final : public Material {
+
+private:
+    float3 _specular;
+    float _exponent;
+
+public:
+    Phong(float3 specular, float exponent) noexcept
+        : _specular{specular}, _exponent{exponent} {}
+    [[nodiscard]] Float3 sample(Expr<float3> wo, Expr<float3> n,
+                                UInt &state, Float3 &wi) const noexcept override {
+        auto ux = lcg(state);
+        auto uy = lcg(state);
+        auto r = reflect(-wo, n);
+        wi = to_world(r, spherical(pow(ux, 1.0f / (_exponent + 1.0f)), 2.0f * constants::pi * uy));
+        auto cos_wi = dot(wi, n);
+        auto scale = (_exponent + 2.0f) / (_exponent + 1.0f);
+        return ite(cos_wi > 0.0f, def(_specular) * (scale * cos_wi), make_float3(0.0f));
+    }
+};
+
+class Conductor final : public Material {
+
+private:
+    float3 _f0;
+    float _alpha;
+
+public:
+    Conductor(float3 f0, float alpha) noexcept
+        : _f0{f0}, _alpha{alpha} {}
+    [[nodiscard]] Float3 sample(Expr<float3> wo, Expr<float3> n,
+                                UInt &state, Float3 &wi) const noexcept override {
+        auto ux = lcg(state);
+        auto uy = lcg(state);
+        auto alpha2 = _alpha * _alpha;
+        auto tan2_theta = alpha2 * ux / max(1.0f - ux, 1e-6f);
+        auto cos_h = 1.0f / sqrt(1.0f + tan2_theta);
+        auto h = to_world(n, spherical(cos_h, 2.0f * constants::pi * uy));
+        auto cos_wo_h = dot(wo, h);
+        wi = 2.0f * cos_wo_h * h - wo;
+        auto cos_wo = dot(wo, n);
+        auto cos_wi = dot(wi, n);
+        auto g1 = [alpha2](Expr<float> c) noexcept {
+            return 2.0f * c / (c + sqrt(alpha2 + (1.0f - alpha2) * c * c));
+        };
+        auto m = 1.0f - saturate(cos_wo_h);
+        auto m2 = m * m;
+        auto f0 = def(_f0);
+        auto fresnel = f0 + (1.0f - f0) * (m2 * m2 * m);
+        auto g = g1(cos_wo) * g1(cos_wi);
+        auto weight = fresnel * (g * cos_wo_h / max(cos_wo * cos_h, 1e-4f));
+        return ite(cos_wo > 0.0f & cos_wi > 0.0f, weight, make_float3(0.0f));
+    }
+};
+
+class Dielectric final : public Material {
+
+private:
+    float3 _tint;
+    float _ior;
+
+public:
+    Dielectric(float3 tint, float ior) noexcept
+        : _tint{tint}, _ior{ior} {}
+    [[nodiscard]] Float3 sample(Expr<float3> wo, Expr<float3> n,
+                                UInt &state, Float3 &wi) const noexcept override {
+        auto u = lcg(state);
+        auto cos_i = dot(wo, n);
+        auto entering = cos_i > 0.0f;
+        auto eta = ite(entering, 1.0f / _ior, _ior);
+        auto nn = ite(entering, n, -n);
+        auto c = abs(cos_i);
+        auto sin2_t = eta * eta * (1.0f - c * c);
+        auto cos_t = sqrt(max(1.0f - sin2_t, 0.0f));
+        auto r0 = (1.0f - _ior) / (1.0f + _ior);
+        auto m = 1.0f - c;
+        auto m2 = m * m;
+        auto fresnel = ite(sin2_t >= 1.0f, 1.0f, r0 * r0 + (1.0f - r0 * r0) * (m2 * m2 * m));
+        wi = ite(u < fresnel,
+                 2.0f * c * nn - wo,
+                 normalize(-eta * wo + (eta * c - cos_t) * nn));
+        return def(_tint);
+    }
+};
+
+// Shades one bounce of a path tracer with many materials, with the material of each
+// path looked up by Polymorphic<Material>::dispatch in one kernel and by a wavefront
+// of per-material kernels, for incoherent (after a diffuse bounce) and coherent
+// (primary hits) tags. Checks that both give the same results.
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend>. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    constexpr auto rounds = 5u;
+    constexpr auto width = 1920u;
+    constexpr auto height = 1080u;
+    constexpr auto n = width * height;
+    constexpr auto variants = 16u;
+
+    Device device = context.create_device(argv[1]);
+    Stream stream = device.create_stream();
+
+    Polymorphic<Material> materials;
+    for (auto i = 0u; i < variants; i++) {
+        auto t = static_cast<float>(i) / static_cast<float>(variants - 1u);
+        auto color = make_float3(.2f + .6f * t, .8f - .5f * t, .3f + .4f * t * t);
+        static_cast<void>(materials.create<Lambert>(color));
+        static_cast<void>(materials.create<Phong>(color, std::exp2(1.f + .5f * static_cast<float>(i))));
+        static_cast<void>(materials.create<Conductor>(color, .05f + .6f * t));
+        static_cast<void>(materials.create<Dielectric>(color, 1.3f + .5f * t));
+    }
+    auto material_count = static_cast<uint>(materials.size());
+
+    auto tag_buffer = device.create_buffer<uint>(n);
+    auto ray_buffer = device.create_buffer<float4>(n);
+    auto normal_buffer = device.create_buffer<float4>(n);
+    auto throughput_buffer = device.create_buffer<float4>(n);
+    auto seed_buffer = device.create_buffer<uint>(n);
+
+    auto shade = [&](const Material *material, Expr<uint> i) noexcept {
+        auto wo = -ray_buffer->read(i).xyz();
+        auto normal = normal_buffer->read(i).xyz();
+        auto state = seed_buffer->read(i);
+        auto wi = def(make_float3(0.0f));
+        auto weight = material->sample(wo, normal, state, wi);
+        ray_buffer->write(i, make_float4(wi, 0.0f));
+        throughput_buffer->write(i, throughput_buffer->read(i) * make_float4(weight, 1.0f));
+        seed_buffer->write(i, state);
+    };
+    auto switch_shader = device.compile<1>([&] {
+        auto i = dispatch_x();
+        materials.dispatch(tag_buffer->read(i), [&](const Material *material) noexcept {
+            shade(material, i);
+        });
+    });
+    PolymorphicWavefront<Material> wavefront{device, materials, n, shade};
+    // the CPU backend does not support indirect dispatches
+    luisa::optional<PolymorphicWavefront<Material>> indirect_wavefront;
+    if (device.backend_name() != "cpu") {
+        indirect_wavefront.emplace(device, materials, n, shade, true);
+    }
+
+    // rays arriving at random points on the hemispheres of random normals
+    luisa::vector<float4> rays(n);
+    luisa::vector<float4> normals(n);
+    luisa::vector<float4> throughputs(n, make_float4(1.f));
+    luisa::vector<uint> seeds(n);
+    std::mt19937 random{19937u};
+    std::normal_distribution<float> gaussian;
+    for (auto i = 0u; i < n; i++) {
+        auto normal = normalize(make_float3(gaussian(random), gaussian(random), gaussian(random)));
+        auto wo = normalize(make_float3(gaussian(random), gaussian(random), gaussian(random)));
+        if (dot(wo, normal) < 0.f) { wo = -wo; }
+        rays[i] = make_float4(-wo, 0.f);
+        normals[i] = make_float4(normal, 0.f);
+        seeds[i] = random();
+    }
+    luisa::vector<uint> incoherent_tags(n);
+    luisa::vector<uint> coherent_tags(n);
+    std::uniform_int_distribution<uint> material_distribution{0u, material_count - 1u};
+    for (auto &&t : incoherent_tags) { t = material_distribution(random); }
+    // 64 x 64 pixel tiles of the same material
+    for (auto i = 0u; i < n; i++) {
+        auto tile = i % width / 64u + i / width / 64u * (width / 64u + 1u);
+        coherent_tags[i] = tile * 2654435761u % material_count;
+    }
+
+    luisa::vector<float4> expected_rays(n);
+    luisa::vector<float4> expected_throughputs(n);
+    luisa::vector<float4> result_rays(n);
+    luisa::vector<float4> result_throughputs(n);
+    struct Pattern {
+        const char *name;
+        const luisa::vector<uint> *tags;
+    };
+    Pattern patterns[] = {{"incoherent", &incoherent_tags},
+                          {"coherent", &coherent_tags}};
+    for (auto &&pattern : patterns) {
+        stream << tag_buffer.copy_from(pattern.tags->data());
+        auto measure = [&](const char *mode, auto &&dispatch) noexcept {
+            auto best = std::numeric_limits<double>::max();
+            for (auto r = 0u; r < rounds; r++) {
+                stream << ray_buffer.copy_from(rays.data())
+                       << normal_buffer.copy_from(normals.data())
+                       << throughput_buffer.copy_from(throughputs.data())
+                       << seed_buffer.copy_from(seeds.data())
+                       << synchronize();
+                Clock clock;
+                dispatch();
+                stream << synchronize();
+                best = std::min(best, clock.toc());
+            }
+            LUISA_INFO("{:>10} {:>18}: {:8.3f} ms, {:8.2f} M paths/s",
+                       pattern.name, mode, best,
+                       static_cast<double>(n) / (best * 1e-3) * 1e-6);
+        };
+        auto compare = [&](const char *mode) noexcept {
+            stream << ray_buffer.copy_to(result_rays.data())
+                   << throughput_buffer.copy_to(result_throughputs.data())
+                   << synchronize();
+            auto mismatches = 0u;
+            for (auto i = 0u; i < n; i++) {
+                auto ray_error = result_rays[i] - expected_rays[i];
+                auto throughput_error = result_throughputs[i] - expected_throughputs[i];
+                auto error = std::max(
+                    std::max(std::max(std::abs(ray_error.x), std::abs(ray_error.y)), std::abs(ray_error.z)),
+                    std::max(std::max(std::abs(throughput_error.x), std::abs(throughput_error.y)), std::abs(throughput_error.z)));
+                if (!(error <= 1e-4f)) { mismatches++; }
+            }
+            LUISA_ASSERT(mismatches == 0u, "{} of {} paths shaded by the {} mode differ from the switch.",
+                         mismatches, n, mode);
+        };
+        measure("switch", [&] { stream << switch_shader().dispatch(n); });
+        stream << ray_buffer.copy_to(expected_rays.data())
+               << throughput_buffer.copy_to(expected_throughputs.data())
+               << synchronize();
+        measure("wavefront", [&] {
+            CommandList list;
+            wavefront.dispatch(list, tag_buffer, n);
+            stream << list.commit();
+        });
+        compare("wavefront");
+        if (indirect_wavefront) {
+            measure("indirect wavefront", [&] {
+                CommandList list;
+                indirect_wavefront->dispatch(list, tag_buffer, n);
+                stream << list.commit();
+            });
+            compare("indirect wavefront");
+        }
+    }
+}
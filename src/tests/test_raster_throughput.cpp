@@ -0,0 +1,153 @@
+#include <limits>
+#include <algorithm>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/image.h>
+#include <luisa/runtime/buffer.h>
+#include <luisa/runtime/raster/raster_shader.h>
+#include <luisa/runtime/raster/raster_scene.h>
+#include <luisa/runtime/raster/depth_buffer.h>
+#include <luisa/dsl/raster/raster_kernel.h>
+#include <luisa/dsl/syntax.h>
+#include <luisa/dsl/sugar.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+struct v2p {
+    float4 pos;
+    float4 color;
+};
+LUISA_STRUCT(v2p, pos, color) {};
+
+// Measures the raster pipeline in two regimes, headless:
+// - geometry-bound: a depth-tested grid of tiny triangles covering the screen (triangles/s),
+//   which is also checked to be watertight, i.e. every pixel is covered exactly once;
+// - fill-bound: alpha-blended full-screen quads (pixels/s).
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend> [grid size]. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    auto grid = argc > 2 ? static_cast<uint>(std::stoul(argv[2])) : 512u;
+    constexpr auto width = 1024u;
+    constexpr auto height = 1024u;
+    constexpr auto rounds = 5u;
+    constexpr auto layers = 16u;
+
+    Device device = context.create_device(argv[1]);
+    Stream stream = device.create_stream(StreamTag::GRAPHICS);
+
+    RasterStageKernel vert = [](Var<AppData> v) noexcept {
+        Var<v2p> o;
+        o.pos = make_float4(v.position, 1.f);
+        o.color = make_float4(v.position * .5f + .5f, 1.f);
+        return o;
+    };
+    RasterStageKernel pixel = [](Var<v2p> i, Float alpha) noexcept {
+        return make_float4(i.color.xyz(), alpha);
+    };
+    RasterKernel<decltype(vert), decltype(pixel)> kernel{vert, pixel};
+    Kernel2D clear_kernel = [](ImageFloat image) noexcept {
+        image.write(dispatch_id().xy(), make_float4(0.f));
+    };
+    auto clear = device.compile(clear_kernel);
+    MeshFormat mesh_format;
+    VertexAttribute attributes[] = {{VertexAttributeType::Position, VertexElementFormat::XYZW32Float}};
+    mesh_format.emplace_vertex_stream(attributes);
+    auto shader = device.compile(kernel, mesh_format);
+
+    auto image = device.create_image<float>(PixelStorage::FLOAT4, width, height);
+    auto depth = device.create_depth_buffer(DepthFormat::D32, make_uint2(width, height));
+    Viewport viewport{0.f, 0.f, static_cast<float>(width), static_cast<float>(height)};
+
+    // a grid of (grid x grid) cells, two triangles each, over the whole screen
+    luisa::vector<float4> grid_vertices;
+    grid_vertices.reserve((grid + 1u) * (grid + 1u));
+    for (auto y = 0u; y <= grid; y++) {
+        for (auto x = 0u; x <= grid; x++) {
+            grid_vertices.emplace_back(make_float4(static_cast<float>(x) / static_cast<float>(grid) * 2.f - 1.f,
+                                                   1.f - static_cast<float>(y) / static_cast<float>(grid) * 2.f,
+                                                   static_cast<float>((x + y) % 7u) * .1f + .1f, 0.f));
+        }
+    }
+    luisa::vector<uint> grid_indices;
+    grid_indices.reserve(grid * grid * 6u);
+    for (auto y = 0u; y < grid; y++) {
+        for (auto x = 0u; x < grid; x++) {
+            auto v = y * (grid + 1u) + x;
+            for (auto i : {v, v + 1u, v + grid + 1u, v + 1u, v + grid + 2u, v + grid + 1u}) {
+                grid_indices.emplace_back(i);
+            }
+        }
+    }
+    float4 quad_vertices[] = {make_float4(-1.f, 1.f, .5f, 0.f), make_float4(1.f, 1.f, .5f, 0.f),
+                              make_float4(-1.f, -1.f, .5f, 0.f), make_float4(1.f, -1.f, .5f, 0.f)};
+    uint quad_indices[] = {0u, 1u, 2u, 1u, 3u, 2u};
+    auto grid_vertex_buffer = device.create_buffer<float4>(grid_vertices.size());
+    auto grid_index_buffer = device.create_buffer<uint>(grid_indices.size());
+    auto quad_vertex_buffer = device.create_buffer<float4>(4u);
+    auto quad_index_buffer = device.create_buffer<uint>(6u);
+    stream << grid_vertex_buffer.copy_from(grid_vertices.data())
+           << grid_index_buffer.copy_from(grid_indices.data())
+           << quad_vertex_buffer.copy_from(quad_vertices)
+           << quad_index_buffer.copy_from(quad_indices)
+           << synchronize();
+    VertexBufferView grid_view{grid_vertex_buffer};
+    VertexBufferView quad_view{quad_vertex_buffer};
+
+    // geometry-bound
+    {
+        RasterState state{.cull_mode = CullMode::None,
+                          .depth_state = {.enable_depth = true, .comparison = Comparison::LessEqual, .write = true}};
+        auto triangle_count = grid * grid * 2u;
+        auto best = std::numeric_limits<double>::max();
+        for (auto r = 0u; r < rounds; r++) {
+            stream << clear(image).dispatch(width, height) << depth.clear(1.f) << synchronize();
+            luisa::vector<RasterMesh> meshes;
+            meshes.emplace_back(luisa::span{&grid_view, 1u}, grid_index_buffer.view(), 1u, 0u);
+            Clock clock;
+            stream << shader(1.f).draw(std::move(meshes), viewport, state, &depth, image)
+                   << synchronize();
+            best = std::min(best, clock.toc());
+        }
+        luisa::vector<float4> pixels(width * height);
+        stream << image.copy_to(pixels.data()) << synchronize();
+        auto covered = std::count_if(pixels.cbegin(), pixels.cend(), [](float4 p) noexcept { return p.w == 1.f; });
+        LUISA_ASSERT(covered == width * height, "Grid covers {} of {} pixels.", covered, width * height);
+        LUISA_INFO("{:>16}: {:8.3f} ms, {:8.2f} M triangles/s ({} triangles)",
+                   "geometry-bound", best, triangle_count / (best * 1e-3) * 1e-6, triangle_count);
+    }
+
+    // fill-bound
+    {
+        RasterState state{.cull_mode = CullMode::None,
+                          .blend_state = {.enable_blend = true,
+                                          .op = BlendOp::Add,
+                                          .prim_op = BlendWeight::PrimAlpha,
+                                          .img_op = BlendWeight::OneMinusPrimAlpha}};
+        auto pixel_count = static_cast<double>(width) * height * layers;
+        auto best = std::numeric_limits<double>::max();
+        for (auto r = 0u; r < rounds; r++) {
+            stream << clear(image).dispatch(width, height) << synchronize();
+            luisa::vector<RasterMesh> meshes;
+            for (auto i = 0u; i < layers; i++) {
+                meshes.emplace_back(luisa::span{&quad_view, 1u}, quad_index_buffer.view(), 1u, i);
+            }
+            Clock clock;
+            stream << shader(.25f).draw(std::move(meshes), viewport, state, nullptr, image)
+                   << synchronize();
+            best = std::min(best, clock.toc());
+        }
+        LUISA_INFO("{:>16}: {:8.3f} ms, {:8.2f} M pixels/s ({} layers)",
+                   "fill-bound", best, pixel_count / (best * 1e-3) * 1e-6, layers);
+    }
+}
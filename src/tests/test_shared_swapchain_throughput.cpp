@@ -0,0 +1,153 @@
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+#ifdef LUISA_PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/image.h>
+#include <luisa/runtime/swapchain.h>
+#include <luisa/gui/framerate.h>
+#include <luisa/backends/ext/cpu_config_ext.h>
+#include <luisa/dsl/syntax.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// maps the ring as the encoder process would, by name
+[[nodiscard]] static SharedFrameRing *map_shared_frame_ring(luisa::string_view name) noexcept {
+#ifdef LUISA_PLATFORM_WINDOWS
+    auto mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, luisa::string{name}.c_str());
+    if (mapping == nullptr) { return nullptr; }
+    // the view keeps the mapping alive
+    auto memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    CloseHandle(mapping);
+    return static_cast<SharedFrameRing *>(memory);
+#else
+    auto fd = shm_open(luisa::format("/{}", name).c_str(), O_RDWR, 0);
+    if (fd < 0) { return nullptr; }
+    struct stat status {};
+    fstat(fd, &status);
+    auto memory = mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return memory == MAP_FAILED ? nullptr : static_cast<SharedFrameRing *>(memory);
+#endif
+}
+
+// Presents 1080p frames on the CPU backend through a swapchain that publishes them in
+// shared memory as BGRA8, consumed in place by a reader thread, which checks their
+// contents and measures their pacing from the presentation times.
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend>. <backend>: cpu", argv[0]);
+        exit(1);
+    }
+    constexpr auto frame_count = 600u;
+    constexpr auto width = 1920u;
+    constexpr auto height = 1080u;
+    constexpr luisa::string_view name = "luisa_test_shared_swapchain";
+
+    DeviceConfig config;
+    auto cpu_config = luisa::make_unique<CpuDeviceConfigExt>();
+    cpu_config->shared_swapchain_name = name;
+    cpu_config->shared_swapchain_format = SharedFrameFormat::BGRA8;
+    config.extension = std::move(cpu_config);
+    Device device = context.create_device(argv[1], &config);
+    Stream stream = device.create_stream(StreamTag::GRAPHICS);
+    auto swapchain = device.create_swapchain(0u, stream, make_uint2(width, height), false, false, 3u);
+    auto ring = map_shared_frame_ring(luisa::format("{}.0", name));
+    if (ring == nullptr) {
+        LUISA_WARNING("Shared swapchains are not supported by backend {}.", argv[1]);
+        return 0;
+    }
+    auto image = device.create_image<float>(swapchain.backend_storage(), width, height);
+
+    Kernel2D draw_kernel = [](ImageFloat image, UInt frame) noexcept {
+        auto p = dispatch_id().xy();
+        auto c = make_uint4(p.x + frame, p.y, p.x ^ p.y, 255u) & 255u;
+        image.write(p, make_float4(c) / 255.f);
+    };
+    auto draw = device.compile(draw_kernel);
+
+    // the frame number of the ring counts from 1
+    auto expected_pixel = [](uint x, uint y, uint64_t frame) noexcept {
+        auto r = (x + static_cast<uint>(frame - 1u)) & 255u;
+        return (r << 16u) | ((y & 255u) << 8u) | ((x ^ y) & 255u) | (255u << 24u);
+    };
+
+    std::atomic_bool done{false};
+    auto consumed = 0u;
+    auto mismatched = 0u;
+    Framerate pacing{frame_count};
+    std::thread reader{[&] {
+        auto last_frame = static_cast<uint64_t>(0u);
+        while (!done.load(std::memory_order_acquire)) {
+            auto slot = ring->acquire();
+            if (slot == SharedFrameRing::no_frame || ring->slots[slot].frame.load() == last_frame) {
+                if (slot != SharedFrameRing::no_frame) { ring->release(slot); }
+                std::this_thread::yield();
+                continue;
+            }
+            auto &s = ring->slots[slot];
+            auto frame = s.frame.load();
+            // the first frame only starts the interval of the next one
+            if (last_frame == 0u) { last_frame = frame; }
+            auto pixels = ring->frame_data(slot);
+            for (auto y = 0u; y < height; y += 37u) {
+                auto row = reinterpret_cast<const uint *>(pixels + static_cast<size_t>(y) * ring->row_pitch);
+                for (auto x = 0u; x < width; x += 13u) {
+                    if (row[x] != expected_pixel(x, y, frame)) { mismatched++; }
+                }
+            }
+            // frames missed by the reader count as presented in the interval
+            Framerate::Timepoint time{std::chrono::nanoseconds{s.present_time}};
+            pacing.record(time, frame - last_frame);
+            ring->release(slot);
+            last_frame = frame;
+            consumed++;
+        }
+    }};
+
+    Clock clock;
+    for (auto i = 0u; i < frame_count; i++) {
+        stream << draw(image, i).dispatch(width, height)
+               << swapchain.present(image);
+    }
+    stream << synchronize();
+    auto total = clock.toc();
+    // let the reader see the last frame
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    done.store(true, std::memory_order_release);
+    reader.join();
+
+    auto p = pacing.pacing();
+    LUISA_INFO("{} x {}: {} frames in {:.3f} ms, {:8.2f} M pixels/s, {} consumed, {} dropped",
+               width, height, frame_count, total,
+               static_cast<double>(width) * height * frame_count / (total * 1e-3) * 1e-6,
+               consumed, ring->dropped.load());
+    LUISA_INFO("Frame pacing: {:.2f} fps, mean {:.3f} ms, min {:.3f} ms, max {:.3f} ms, jitter {:.3f} ms",
+               pacing.report(), p.mean * 1e3, p.min * 1e3, p.max * 1e3, p.jitter * 1e3);
+    // a single reader pins at most one of the slots besides the latest one, so none is dropped
+    LUISA_ASSERT(ring->presented.load() == frame_count && ring->dropped.load() == 0u,
+                 "{} frames presented and {} dropped out of {}.",
+                 ring->presented.load(), ring->dropped.load(), frame_count);
+    LUISA_ASSERT(consumed > 0u && mismatched == 0u, "{} mismatched pixels in {} consumed frames.",
+                 mismatched, consumed);
+}
@@ -0,0 +1,132 @@
+#include <cmath>
+
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/sparse_buffer.h>
+#include <luisa/runtime/sparse_image.h>
+#include <luisa/runtime/sparse_command_list.h>
+#include <luisa/dsl/syntax.h>
+#include <luisa/dsl/sugar.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+int main(int argc, char *argv[]) {
+
+    log_level_verbose();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend>. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    Device device = context.create_device(argv[1]);
+    Stream stream = device.create_stream();
+    SparseCommandList sparse_cmdlist;
+    auto report = [&](luisa::string_view stage) noexcept {
+        if (auto memory = device.impl()->query("sparse_memory"); !memory.empty()) {
+            LUISA_INFO("Sparse memory {}: {}", stage, memory);
+        }
+    };
+
+    // sparse buffer: 32 GiB of address space with a single tile mapped
+    {
+        Kernel1D fill_kernel = [](BufferFloat buffer, UInt offset) noexcept {
+            auto x = dispatch_id().x;
+            buffer.write(x + offset, x.cast<float>() + .5f);
+        };
+        Kernel1D clear_kernel = [](BufferFloat buffer, UInt offset) noexcept {
+            buffer.write(dispatch_id().x + offset, -1.f);
+        };
+        auto fill = device.compile(fill_kernel);
+        auto clear = device.compile(clear_kernel);
+        constexpr auto buffer_size = 32ull * 1024ull * 1024ull * 1024ull / sizeof(float);
+        auto sparse_buffer = device.create_sparse_buffer<float>(buffer_size);
+        auto tile_elements = static_cast<uint>(sparse_buffer.tile_size() / sizeof(float));
+        auto heap = device.allocate_sparse_buffer_heap(sparse_buffer.tile_size());
+        auto tile = 12345u;
+        sparse_cmdlist << sparse_buffer.map_tile(tile, 1u, heap);
+        luisa::vector<float> result(tile_elements);
+        auto check = [&] {
+            stream << sparse_buffer.view(tile * tile_elements, tile_elements).copy_to(result.data())
+                   << synchronize();
+            for (auto i = 0u; i < tile_elements; i++) {
+                LUISA_ASSERT(result[i] == static_cast<float>(i) + .5f,
+                             "Sparse buffer mismatch at {}: {}.", i, result[i]);
+            }
+        };
+        stream << sparse_cmdlist.commit()
+               << fill(sparse_buffer.view(), tile * tile_elements).dispatch(tile_elements);
+        check();
+        report("after mapping a buffer tile");
+        // writes to the unmapped neighbours are discarded
+        stream << clear(sparse_buffer.view(), (tile - 1u) * tile_elements).dispatch(tile_elements)
+               << clear(sparse_buffer.view(), (tile + 1u) * tile_elements).dispatch(tile_elements);
+        check();
+        sparse_cmdlist << sparse_buffer.unmap_tile(tile, 1u);
+        stream << sparse_cmdlist.commit()
+               << clear(sparse_buffer.view(), (tile - 1u) * tile_elements).dispatch(3u * tile_elements)
+               << synchronize();
+        report("after unmapping the buffer tile");
+    }
+
+    // sparse image: 16k x 16k virtual texture with 2 x 2 tiles mapped
+    {
+        Kernel2D fill_kernel = [](ImageFloat image, UInt2 offset) noexcept {
+            auto p = dispatch_id().xy();
+            image.write(p + offset, make_float4(make_float2(p) / make_float2(dispatch_size().xy()), 1.f, 1.f));
+        };
+        Kernel2D read_kernel = [](ImageFloat image, ImageFloat out, UInt2 offset) noexcept {
+            auto p = dispatch_id().xy();
+            out.write(p, image.read(p + offset));
+        };
+        // clears the pixels in [offset, offset + dispatch size) outside [lo, hi)
+        Kernel2D clear_kernel = [](ImageFloat image, UInt2 offset, UInt2 lo, UInt2 hi) noexcept {
+            auto p = dispatch_id().xy() + offset;
+            $if (any(p < lo || p >= hi)) {
+                image.write(p, make_float4(0.f));
+            };
+        };
+        auto fill = device.compile(fill_kernel);
+        auto read = device.compile(read_kernel);
+        auto clear = device.compile(clear_kernel);
+        auto sparse_image = device.create_sparse_image<float>(PixelStorage::BYTE4, 16384u, 16384u);
+        auto tile_size = sparse_image.tile_size();
+        auto start_tile = make_uint2(37u, 51u);
+        auto tile_count = make_uint2(2u);
+        auto heap = device.allocate_sparse_texture_heap(4u * sparse_image.tile_size_bytes(), false);
+        sparse_cmdlist << sparse_image.map_tile(start_tile, tile_count, 0u, heap);
+        auto size = tile_size * tile_count;
+        auto image = device.create_image<float>(PixelStorage::BYTE4, size);
+        luisa::vector<uint> result(size.x * size.y);
+        auto check = [&] {
+            stream << read(sparse_image.view(), image, start_tile * tile_size).dispatch(size)
+                   << image.copy_to(result.data())
+                   << synchronize();
+            for (auto y = 0u; y < size.y; y++) {
+                for (auto x = 0u; x < size.x; x++) {
+                    auto pixel = result[y * size.x + x];
+                    auto expected_r = static_cast<float>(x) / static_cast<float>(size.x) * 255.f;
+                    LUISA_ASSERT(pixel >> 24u == 255u && std::abs(static_cast<float>(pixel & 0xffu) - expected_r) <= 1.f,
+                                 "Sparse image mismatch at ({}, {}): {:08x}.", x, y, pixel);
+                }
+            }
+        };
+        stream << sparse_cmdlist.commit()
+               << fill(sparse_image.view(), start_tile * tile_size).dispatch(size);
+        check();
+        report("after mapping image tiles");
+        // writes to the unmapped tiles around the mapped ones are discarded
+        auto lo = start_tile * tile_size;
+        auto hi = lo + size;
+        stream << clear(sparse_image.view(), lo - tile_size, lo, hi).dispatch(size + 2u * tile_size);
+        check();
+        sparse_cmdlist << sparse_image.unmap_tile(start_tile, tile_count, 0u);
+        stream << sparse_cmdlist.commit()
+               << clear(sparse_image.view(), lo, lo, lo).dispatch(size)
+               << synchronize();
+        report("after unmapping the image tiles");
+    }
+}
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/backends/ext/cpu_config_ext.h>
+#include <luisa/dsl/syntax.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// STREAM-like memory bandwidth benchmark (copy, scale, add, triad).
+// On the CPU backend, the allocation policy can be selected with the options
+//   thp      transparent huge pages
+//   hugetlb  explicit huge pages
+//   touch    first-touch initialization from the worker threads
+//   numa     worker threads pinned to NUMA nodes
+int main(int argc, char *argv[]) {
+
+    log_level_verbose();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend> [size in MiB] [thp|hugetlb] [touch] [numa]. "
+                   "<backend>: cuda, dx, cpu, metal",
+                   argv[0]);
+        exit(1);
+    }
+    auto size_mb = argc > 2 ? std::stoull(argv[2]) : 256ull;
+    DeviceConfig config;
+    auto cpu_config = luisa::make_unique<CpuDeviceConfigExt>();
+    for (auto i = 3; i < argc; i++) {
+        luisa::string_view option{argv[i]};
+        if (option == "thp") {
+            cpu_config->huge_pages = CpuDeviceConfigExt::HugePages::TRANSPARENT;
+        } else if (option == "hugetlb") {
+            cpu_config->huge_pages = CpuDeviceConfigExt::HugePages::EXPLICIT;
+        } else if (option == "touch") {
+            cpu_config->first_touch = true;
+        } else if (option == "numa") {
+            cpu_config->numa_pinned_workers = true;
+        } else {
+            LUISA_WARNING("Unknown option '{}'.", option);
+        }
+    }
+    config.extension = std::move(cpu_config);
+    Device device = context.create_device(argv[1], &config);
+    Stream stream = device.create_stream();
+
+    auto n = static_cast<uint>(size_mb * 1024u * 1024u / sizeof(float));
+    auto a = device.create_buffer<float>(n);
+    auto b = device.create_buffer<float>(n);
+    auto c = device.create_buffer<float>(n);
+    constexpr auto scalar = 3.f;
+
+    Kernel1D init_kernel = [](BufferFloat a, BufferFloat b, BufferFloat c) noexcept {
+        auto i = dispatch_id().x;
+        a.write(i, 1.f);
+        b.write(i, 2.f);
+        c.write(i, 0.f);
+    };
+    Kernel1D copy_kernel = [](BufferFloat a, BufferFloat c) noexcept {
+        auto i = dispatch_id().x;
+        c.write(i, a.read(i));
+    };
+    Kernel1D scale_kernel = [](BufferFloat b, BufferFloat c, Float s) noexcept {
+        auto i = dispatch_id().x;
+        b.write(i, s * c.read(i));
+    };
+    Kernel1D add_kernel = [](BufferFloat a, BufferFloat b, BufferFloat c) noexcept {
+        auto i = dispatch_id().x;
+        c.write(i, a.read(i) + b.read(i));
+    };
+    Kernel1D triad_kernel = [](BufferFloat a, BufferFloat b, BufferFloat c, Float s) noexcept {
+        auto i = dispatch_id().x;
+        a.write(i, b.read(i) + s * c.read(i));
+    };
+    auto init = device.compile(init_kernel);
+    auto copy = device.compile(copy_kernel);
+    auto scale = device.compile(scale_kernel);
+    auto add = device.compile(add_kernel);
+    auto triad = device.compile(triad_kernel);
+
+    stream << init(a, b, c).dispatch(n) << synchronize();
+
+    constexpr auto iterations = 10u;
+    constexpr std::array names{"copy", "scale", "add", "triad"};
+    constexpr std::array arrays{2.0, 2.0, 3.0, 3.0};
+    std::array<double, 4> best{};
+    std::array<double, 4> total{};
+    best.fill(std::numeric_limits<double>::max());
+    Clock clock;
+    auto timed = [&](size_t index, auto &&command) noexcept {
+        clock.tic();
+        stream << std::forward<decltype(command)>(command) << synchronize();
+        auto t = clock.toc();
+        total[index] += t;
+        best[index] = std::min(best[index], t);
+    };
+    for (auto k = 0u; k < iterations; k++) {
+        timed(0u, copy(a, c).dispatch(n));
+        timed(1u, scale(b, c, scalar).dispatch(n));
+        timed(2u, add(a, b, c).dispatch(n));
+        timed(3u, triad(a, b, c, scalar).dispatch(n));
+    }
+
+    auto bytes = static_cast<double>(n) * sizeof(float);
+    // the first iteration is included in the average, it additionally pays for page faults
+    for (auto i = 0u; i < names.size(); i++) {
+        LUISA_INFO("{:>5}: best {:8.2f} GB/s, avg {:8.3f} ms",
+                   names[i], arrays[i] * bytes / (best[i] * 1e-3) * 1e-9,
+                   total[i] / iterations);
+    }
+
+    // replay the kernels on scalars to verify the results
+    auto ea = 1.f, eb = 2.f, ec = 0.f;
+    for (auto k = 0u; k < iterations; k++) {
+        ec = ea;
+        eb = scalar * ec;
+        ec = ea + eb;
+        ea = eb + scalar * ec;
+    }
+    luisa::vector<float> ha(n), hb(n), hc(n);
+    stream << a.copy_to(ha.data())
+           << b.copy_to(hb.data())
+           << c.copy_to(hc.data())
+           << synchronize();
+    auto check = [n](luisa::string_view name, const luisa::vector<float> &h, float expected) noexcept {
+        for (auto i = 0u; i < n; i++) {
+            LUISA_ASSERT(std::abs(h[i] - expected) <= 1e-6f * std::abs(expected),
+                         "Mismatch in {} at {}: {} vs expected {}.",
+                         name, i, h[i], expected);
+        }
+    };
+    check("a", ha, ea);
+    check("b", hb, eb);
+    check("c", hc, ec);
+    LUISA_INFO("Results verified.");
+}
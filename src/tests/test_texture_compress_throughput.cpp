@@ -0,0 +1,125 @@
+#include <cmath>
+#include <array>
+#include <limits>
+#include <algorithm>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/device.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/runtime/image.h>
+#include <luisa/runtime/buffer.h>
+#include <luisa/runtime/shader.h>
+#include <luisa/dsl/syntax.h>
+#include <luisa/backends/ext/tex_compress_ext.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// Measures each block compression of TexCompressExt on a 4K image, then samples the
+// compressed texture in a kernel and checks the PSNR of its channels on the host.
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend>. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    constexpr auto rounds = 5u;
+    constexpr auto resolution = 4096u;
+
+    Device device = context.create_device(argv[1]);
+    Stream stream = device.create_stream();
+    auto tex_ext = device.extension<TexCompressExt>();
+    if (tex_ext == nullptr) {
+        LUISA_WARNING("TexCompressExt is not supported by backend {}.", argv[1]);
+        return 0;
+    }
+
+    // smooth gradients with some high-frequency detail; the HDR image spans 8 stops
+    luisa::vector<std::array<uint8_t, 4u>> ldr_pixels(resolution * resolution);
+    luisa::vector<float4> hdr_pixels(resolution * resolution);
+    for (auto i = 0u; i < ldr_pixels.size(); i++) {
+        auto x = static_cast<float>(i % resolution) / resolution;
+        auto y = static_cast<float>(i / resolution) / resolution;
+        auto detail = 0.5f + 0.5f * std::sin(64.f * x) * std::cos(48.f * y);
+        auto color = make_float4(x, 0.75f * y + 0.25f * detail, 1.f - 0.5f * (x + y), 0.5f + 0.5f * detail * x);
+        for (auto k = 0u; k < 4u; k++) {
+            ldr_pixels[i][k] = static_cast<uint8_t>(std::lround(color[k] * 255.f));
+        }
+        hdr_pixels[i] = make_float4(make_float3(color) * std::exp2(8.f * detail - 4.f), 1.f);
+    }
+    auto ldr_image = device.create_image<float>(PixelStorage::BYTE4, resolution, resolution);
+    auto hdr_image = device.create_image<float>(PixelStorage::FLOAT4, resolution, resolution);
+    auto decoded = device.create_image<float>(PixelStorage::FLOAT4, resolution, resolution);
+    stream << ldr_image.copy_from(ldr_pixels.data())
+           << hdr_image.copy_from(hdr_pixels.data())
+           << synchronize();
+
+    Kernel2D decode_kernel = [](ImageFloat compressed, ImageFloat result) noexcept {
+        auto p = dispatch_id().xy();
+        result.write(p, compressed.read(p));
+    };
+    auto decode = device.compile(decode_kernel);
+
+    struct Case {
+        const char *name;
+        PixelStorage storage;
+        uint channels;
+        double min_psnr;
+    };
+    Case cases[] = {{"BC1", PixelStorage::BC1, 3u, 36.},
+                    {"BC3", PixelStorage::BC3, 4u, 36.},
+                    {"BC4", PixelStorage::BC4, 1u, 45.},
+                    {"BC5", PixelStorage::BC5, 2u, 45.},
+                    {"BC6H", PixelStorage::BC6, 3u, 45.},
+                    {"BC7", PixelStorage::BC7, 4u, 45.}};
+    luisa::vector<float4> texels(resolution * resolution);
+    for (auto &&c : cases) {
+        auto hdr = c.storage == PixelStorage::BC6;
+        auto &source = hdr ? hdr_image : ldr_image;
+        auto compressed = device.create_image<float>(c.storage, resolution, resolution);
+        auto buffer = device.create_buffer<uint>(compressed.view().size_bytes() / sizeof(uint));
+        auto compress = [&] {
+            switch (c.storage) {
+                case PixelStorage::BC1: return tex_ext->compress_bc1(stream, source, buffer);
+                case PixelStorage::BC3: return tex_ext->compress_bc3(stream, source, buffer);
+                case PixelStorage::BC4: return tex_ext->compress_bc4(stream, source, buffer);
+                case PixelStorage::BC5: return tex_ext->compress_bc5(stream, source, buffer);
+                case PixelStorage::BC6: return tex_ext->compress_bc6h(stream, source, buffer);
+                default: return tex_ext->compress_bc7(stream, source, buffer, 1.f);
+            }
+        };
+        auto best = std::numeric_limits<double>::max();
+        for (auto r = 0u; r < rounds; r++) {
+            stream << synchronize();
+            Clock clock;
+            auto result = compress();
+            stream << synchronize();
+            best = std::min(best, clock.toc());
+            LUISA_ASSERT(result == TexCompressExt::Result::Success, "Failed to compress to {}.", c.name);
+        }
+        stream << compressed.copy_from(buffer.view())
+               << decode(compressed, decoded).dispatch(resolution, resolution)
+               << decoded.copy_to(texels.data())
+               << synchronize();
+        // HDR errors are measured on log2 values, relative to the 8 stops of the range
+        auto squared_error = 0.;
+        for (auto i = 0u; i < texels.size(); i++) {
+            for (auto k = 0u; k < c.channels; k++) {
+                auto error = hdr ? (std::log2(texels[i][k] + 1e-3) - std::log2(hdr_pixels[i][k] + 1e-3)) / 8. :
+                                   texels[i][k] - ldr_pixels[i][k] / 255.;
+                squared_error += error * error;
+            }
+        }
+        auto mse = squared_error / (static_cast<double>(texels.size()) * c.channels);
+        auto psnr = -10. * std::log10(std::max(mse, 1e-12));
+        LUISA_INFO("{:>5} x {:<5} {:>5}: {:8.3f} ms, {:8.2f} M texels/s, PSNR {:6.2f} dB",
+                   resolution, resolution, c.name, best,
+                   static_cast<double>(texels.size()) / (best * 1e-3) * 1e-6, psnr);
+        LUISA_ASSERT(psnr >= c.min_psnr, "PSNR of {} is {:.2f} dB, below {:.2f} dB.", c.name, psnr, c.min_psnr);
+    }
+}
@@ -0,0 +1,77 @@
+#include <array>
+
+#include <luisa/core/clock.h>
+#include <luisa/core/logging.h>
+#include <luisa/runtime/context.h>
+#include <luisa/runtime/event.h>
+#include <luisa/runtime/stream.h>
+#include <luisa/dsl/syntax.h>
+
+using namespace luisa;
+using namespace luisa::compute;
+
+// Measures the submission cost added by the validation layer. Two streams work on
+// disjoint halves of a buffer and exchange them through a timeline event.
+// The analysis mode of the layer is selected with the environment variables
+//   LUISA_VALIDATION_ASYNC=1             analyze hazards on a background thread
+//   LUISA_VALIDATION_SAMPLE_INTERVAL=N   only track every N-th command list
+int main(int argc, char *argv[]) {
+
+    log_level_info();
+
+    Context context{argv[0]};
+    if (argc <= 1) {
+        LUISA_INFO("Usage: {} <backend> [frames]. <backend>: cuda, dx, cpu, metal", argv[0]);
+        exit(1);
+    }
+    auto frames = argc > 2 ? std::stoull(argv[2]) : 1000ull;
+    constexpr auto half = 1024u;
+    constexpr auto dispatches_per_frame = 16u;
+
+    Kernel1D add_kernel = [](BufferUInt buffer, UInt offset) noexcept {
+        auto i = offset + dispatch_id().x;
+        buffer.write(i, buffer.read(i) + 1u);
+    };
+    auto run = [&](bool validation) noexcept {
+        Device device = context.create_device(argv[1], nullptr, validation);
+        auto add = device.compile(add_kernel);
+        auto buffer = device.create_buffer<uint>(2u * half);
+        std::array streams{device.create_stream(), device.create_stream()};
+        auto event = device.create_timeline_event();
+        luisa::vector<uint> host(2u * half, 0u);
+        streams[0] << buffer.copy_from(host.data()) << synchronize();
+
+        Clock clock;
+        for (auto f = 0ull; f < frames; f++) {
+            for (auto s = 0u; s < 2u; s++) {
+                // each stream owns one half per frame and swaps halves with the other one every frame
+                auto offset = static_cast<uint>((f + s) % 2u) * half;
+                CommandList list;
+                for (auto i = 0u; i < dispatches_per_frame; i++) {
+                    list << add(buffer, offset).dispatch(half);
+                }
+                streams[s] << event.wait(2u * f + s) << list.commit() << event.signal(2u * f + s + 1u);
+            }
+        }
+        auto submit_time = clock.toc();
+        event.synchronize(2u * frames);
+        auto total_time = clock.toc();
+        for (auto &&s : streams) { s << synchronize(); }
+
+        streams[0] << buffer.copy_to(host.data()) << synchronize();
+        for (auto i = 0u; i < host.size(); i++) {
+            LUISA_ASSERT(host[i] == frames * dispatches_per_frame,
+                         "Element {} is {}, expected {}.",
+                         i, host[i], frames * dispatches_per_frame);
+        }
+        return std::make_pair(submit_time, total_time);
+    };
+
+    auto [native_submit, native_total] = run(false);
+    auto [validated_submit, validated_total] = run(true);
+    auto lists = static_cast<double>(2u * frames);
+    LUISA_INFO("Without validation: {:.2f} us per command list submission, {:.2f} ms in total.",
+               native_submit * 1e3 / lists, native_total);
+    LUISA_INFO("With validation:    {:.2f} us per command list submission, {:.2f} ms in total.",
+               validated_submit * 1e3 / lists, validated_total);
+}
@@ -91,6 +91,30 @@ test_proj("test_ast")
 test_proj("test_atomic")
 test_proj("test_bindless", true)
 test_proj("test_callable")
+test_proj("test_compile_batch")
+test_proj("test_ir_optimization")
+test_proj("test_pinned_memory")
+test_proj("test_sparse_resources")
+test_proj("test_stream_bandwidth")
+test_proj("test_event_ping_pong")
+test_proj("test_validation_overhead")
+test_proj("test_command_reorder")
+test_proj("test_command_encode")
+test_proj("test_command_graph")
+test_proj("test_kernel_fusion")
+test_proj("test_dstorage_throughput")
+test_proj("test_raster_throughput")
+test_proj("test_mipmap_throughput")
+test_proj("test_texture_compress_throughput")
+test_proj("test_denoiser_throughput")
+test_proj("test_polymorphic_wavefront")
+test_proj("test_aosoa")
+test_proj("test_oso_parser_throughput", false, function()
+	add_deps("lc-osl")
+end)
+test_proj("test_osl_translator_throughput", false, function()
+	add_deps("lc-osl")
+end)
 -- test_proj("test_dsl")
 test_proj("test_dsl_multithread")
 test_proj("test_dsl_sugar")
@@ -115,11 +139,13 @@ test_proj("test_shader_toy", true)
 test_proj("test_shader_visuals_present", true)
 test_proj("test_texture_io")
 test_proj("test_thread_pool")
+test_proj("test_logging_throughput")
 test_proj("test_type")
 test_proj("test_raster", true)
 test_proj("test_texture_compress")
 test_proj("test_swapchain", true)
 test_proj("test_swapchain_static", true)
+test_proj("test_shared_swapchain_throughput", true)
 test_proj("test_select_device", true)
 test_proj("test_dstorage", true)
 test_proj("test_indirect", true)